@@ -8,7 +8,10 @@
 #include "option.hpp"
 #include "fs.hpp"
 #include "log.hpp"
+#include "image_decode.hpp"
 #include "utils/audio.hpp"
+#include "utils/thread.hpp"
+#include "utils/ini_store.hpp"
 
 #ifdef USE_NVJPG
 #include <nvjpg.hpp>
@@ -19,6 +22,7 @@
 #include <span>
 #include <optional>
 #include <utility>
+#include <atomic>
 
 namespace sphaira {
 
@@ -61,6 +65,13 @@ public:
     // pops all widgets above a menu
     static void PopToMenu();
 
+    // marks the ui as changed so that it's drawn, this is thread safe.
+    // the ui is drawn at full rate for a short while after input, events or
+    // this being called, otherwise it's drawn at a low rate whilst idle.
+    static void Invalidate();
+    // time since the last button press or touch, this is thread safe.
+    static auto GetInputIdleNs() -> u64;
+
     // this is thread safe
     static void Notify(const std::string& text, ui::NotifEntry::Side side = ui::NotifEntry::Side::RIGHT);
     static void Notify(ui::NotifEntry entry);
@@ -80,6 +91,13 @@ public:
 
     // returns argv[0]
     static auto GetExePath() -> fs::FsPath;
+
+    // CONFIG_PATH and PLAYLOG_PATH, changes are written on idle or menu exit.
+    static auto GetConfigStore() -> utils::ini::Store&;
+    static auto GetPlaylogStore() -> utils::ini::Store&;
+    // writes any pending changes to both stores.
+    static void FlushConfig();
+
     // returns true if we are hbmenu.
     static auto IsHbmenu() -> bool;
 
@@ -99,9 +117,17 @@ public:
     static auto GetTextScrollSpeed() -> long;
 
     static auto GetNszCompressLevel() -> u8;
+    // set if the level should be adjusted based on the export speed.
+    static auto GetNszCompressLevelAuto() -> bool;
     static auto GetNszThreadCount() -> u8;
     static auto GetNszBlockExponent() -> u8;
 
+    static auto GetTransferQueueDepth() -> u32;
+    static auto GetTransferBufferSize() -> u64;
+    static auto GetTransferAdaptiveQueue() -> bool;
+    static auto GetTransferAutoTune() -> bool;
+    static auto GetTransferShowStageSpeed() -> bool;
+
     static void SetMtpEnable(bool enable);
     static void SetFtpEnable(bool enable);
     static void SetNxlinkEnable(bool enable);
@@ -120,6 +146,8 @@ public:
 
     static auto Install(OwoConfig& config) -> Result;
     static auto Install(ui::ProgressBox* pbox, OwoConfig& config) -> Result;
+    // installs all forwarders under the one progress box.
+    static auto Install(ui::ProgressBox* pbox, std::span<OwoConfig> configs, const OnForwarderInstalled& on_installed = {}) -> Result;
 
     static void PlaySoundEffect(SoundEffect effect);
 
@@ -130,6 +158,7 @@ public:
     static void DisplayAdvancedOptions(bool left_side = true);
     static void DisplayInstallOptions(bool left_side = true);
     static void DisplayDumpOptions(bool left_side = true);
+    static void DisplayTransferOptions(bool left_side = true);
     static void DisplayFtpOptions(bool left_side = true);
     static void DisplayMtpOptions(bool left_side = true);
     static void DisplayHddOptions(bool left_side = true);
@@ -144,9 +173,15 @@ public:
     void Poll();
 
     // void DrawElement(float x, float y, float w, float h, ui::ThemeEntryID id);
-    auto LoadElementImage(std::string_view value) -> ElementEntry;
     auto LoadElementColour(std::string_view value) -> ElementEntry;
-    auto LoadElement(std::string_view data, ElementType type) -> ElementEntry;
+    // colours are set straight away, images are decoded on the decode pool.
+    void LoadThemeElement(ThemeEntryID id, std::string_view value, ElementType type);
+    // frees the texture of the previous element.
+    void SetThemeElement(ThemeEntryID id, const ElementEntry& entry);
+    // swaps in theme images once decoded, called once per frame after image::Upload().
+    void UpdateThemeImages();
+    // starts the theme music once it's been opened.
+    void UpdateThemeMusic();
 
     void LoadTheme(const ThemeMeta& meta);
     void CloseTheme();
@@ -154,6 +189,10 @@ public:
     void ScanThemes(const std::string& path);
     void ScanThemeEntries();
     void LoadAndPlayThemeMusic();
+    void LoadThemeSounds();
+    // starts the init that isn't needed for the first frame, see m_deferred_services.
+    void StartDeferredInit();
+    void WaitDeferredInit();
     static Result SetDefaultBackgroundMusic(fs::Fs* fs, const fs::FsPath& path);
     static void SetBackgroundMusicPause(bool pause);
 
@@ -230,6 +269,26 @@ public:
         }
     }
 
+    // boosts the cpu for as long as it's alive, if enabled in the options.
+    // created by compute threads (decompress, crypto, hashing), so that work
+    // started outside of a ProgressBox is still boosted.
+    struct ComputeBoost {
+        ComputeBoost() : m_enabled{GetApp()->m_progress_boost_mode.Get()} {
+            if (m_enabled) {
+                SetBoostMode(true);
+            }
+        }
+
+        ~ComputeBoost() {
+            if (m_enabled) {
+                SetBoostMode(false);
+            }
+        }
+
+    private:
+        const bool m_enabled;
+    };
+
     static auto GetAccountList() -> std::vector<AccountProfileBase> {
         std::vector<AccountProfileBase> out;
 
@@ -284,6 +343,27 @@ public:
     AppletHookCookie m_appletHookCookie{};
 
     Theme m_theme{};
+
+    struct ThemeImage {
+        // path of the texture in m_theme.elements, empty if not a texture.
+        std::string path{};
+        // image that replaces the element once decoded.
+        std::string pending_path{};
+        image::RequestHandle request{};
+    };
+
+    struct ThemeMusicLoad {
+        ~ThemeMusicLoad() {
+            audio::CloseSong(&song);
+        }
+
+        audio::SongID song{};
+        std::atomic_bool done{};
+    };
+
+    ThemeImage m_theme_images[ThemeEntryID_MAX]{};
+    // the song is closed if the theme changes before it's opened.
+    std::shared_ptr<ThemeMusicLoad> m_theme_music_load{};
     fs::FsPath theme_path{};
     s64 m_theme_index{};
 
@@ -308,6 +388,8 @@ public:
     option::OptionString m_left_menu{INI_SECTION, "left_side_menu", "FileBrowser"};
     option::OptionString m_right_menu{INI_SECTION, "right_side_menu", "Appstore"};
     option::OptionBool m_progress_boost_mode{INI_SECTION, "progress_boost_mode", true};
+    option::OptionBool m_profile_overlay{INI_SECTION, "profile_overlay", false};
+    option::OptionBool m_trace_enabled{INI_SECTION, "trace_enabled", false};
 
     // install options
     option::OptionBool m_install_sysmmc{INI_SECTION, "install_sysmmc", false};
@@ -322,6 +404,7 @@ public:
     option::OptionBool m_skip_data_patch{INI_SECTION, "skip_data_patch", false};
     option::OptionBool m_skip_ticket{INI_SECTION, "skip_ticket", false};
     option::OptionBool m_skip_nca_hash_verify{INI_SECTION, "skip_nca_hash_verify", true};
+    option::OptionBool m_skip_cached_hash_verify{INI_SECTION, "skip_cached_hash_verify", true};
     option::OptionBool m_skip_rsa_header_fixed_key_verify{INI_SECTION, "skip_rsa_header_fixed_key_verify", true};
     option::OptionBool m_skip_rsa_npdm_fixed_key_verify{INI_SECTION, "skip_rsa_npdm_fixed_key_verify", true};
     option::OptionBool m_ignore_distribution_bit{INI_SECTION, "ignore_distribution_bit", false};
@@ -329,6 +412,7 @@ public:
     option::OptionBool m_convert_to_standard_crypto{INI_SECTION, "convert_to_standard_crypto", false};
     option::OptionBool m_lower_master_key{INI_SECTION, "lower_master_key", false};
     option::OptionBool m_lower_system_version{INI_SECTION, "lower_system_version", true};
+    option::OptionBool m_install_dry_run{INI_SECTION, "dry_run", false};
 
     // dump options
     option::OptionBool m_dump_app_folder{"dump", "app_folder", true};
@@ -342,6 +426,13 @@ public:
     option::OptionBool m_nsz_compress_block{"dump", "nsz_compress_block", false};
     option::OptionLong m_nsz_compress_block_exponent{"dump", "nsz_compress_block_exponent", 6};
 
+    // transfer options.
+    option::OptionLong m_transfer_queue_depth{"transfer", "queue_depth", 1}; // 2
+    option::OptionLong m_transfer_buffer_size{"transfer", "buffer_size", 3}; // 4MiB
+    option::OptionBool m_transfer_adaptive_queue{"transfer", "adaptive_queue", false};
+    option::OptionBool m_transfer_auto_tune{"transfer", "auto_tune", false};
+    option::OptionBool m_transfer_show_stage_speed{"transfer", "show_stage_speed", false};
+
     // todo: move this into it's own menu
     option::OptionLong m_text_scroll_speed{"accessibility", "text_scroll_speed", 1}; // normal
 
@@ -386,6 +477,21 @@ public:
 #endif
 
     double m_delta_time{};
+    // set by Invalidate(), cleared once per frame.
+    std::atomic_bool m_dirty{true};
+    // wakes the loop whilst it's idle.
+    UEvent m_dirty_event{};
+
+    // started once the first frame is drawn, so that slow services and
+    // network mounts don't delay launch. the services and mounts don't
+    // depend on each other, so they run in parallel.
+    std::unique_ptr<utils::Async> m_deferred_services{};
+    std::unique_ptr<utils::Async> m_deferred_mounts{};
+    // set once audio is init, the theme music is then played on the main thread.
+    std::atomic_bool m_audio_ready{};
+    // time from the constructor until the first frame was drawn.
+    u64 m_first_frame_ns{};
+    std::atomic<u64> m_input_tick{};
 
     static constexpr const char* INSTALL_DEPENDS_STR =
         "Installing is disabled.\n\n"
@@ -675,6 +675,36 @@ enum class SphairaResult : Result {
     NszTooManyBlocks,
     // set when nca finished but not all blocks were handled.
     NszMissingBlocks,
+
+    MmzStreamBadHeader,
+    MmzStreamUnsupported,
+    MmzStreamBadCrc,
+    MmzStreamInflate,
+    MmzStreamTruncated,
+    MmzBadEndRecord,
+    MmzBadFileHeader,
+    AppstoreFailedParseRepo,
+    AppstoreBadIndex,
+    GameContentHashMismatch,
+    SaveManifestInvalid,
+    SaveChunkMissing,
+    SaveChunkHashMismatch,
+    UsbShortTransfer,
+    UsbBadZstdChunk,
+    UsbBenchNotSupported,
+    BenchZstdError,
+    BenchFailedWriteJson,
+    YatiHttpOpenFailed,
+    YatiHttpReadFailed,
+    TrashNotActive,
+    TrashInvalidPath,
+    DevoptabServerCopyNotSupported,
+    DevoptabServerCopyFailed,
+    CopyVerifyFailed,
+    YatiDeltaFragmentNotSupported,
+    BenchCryptoMismatch,
+    BenchPathIndexMismatch,
+    BenchNoFileSelected,
 };
 
 #define MAKE_SPHAIRA_RESULT_ENUM(x) Result_##x =  MAKERESULT(Module_Sphaira, (Result)SphairaResult::x)
@@ -821,6 +851,35 @@ enum : Result {
     MAKE_SPHAIRA_RESULT_ENUM(NszFailedCompressStream2),
     MAKE_SPHAIRA_RESULT_ENUM(NszTooManyBlocks),
     MAKE_SPHAIRA_RESULT_ENUM(NszMissingBlocks),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzStreamBadHeader),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzStreamUnsupported),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzStreamBadCrc),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzStreamInflate),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzStreamTruncated),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzBadEndRecord),
+    MAKE_SPHAIRA_RESULT_ENUM(MmzBadFileHeader),
+    MAKE_SPHAIRA_RESULT_ENUM(AppstoreFailedParseRepo),
+    MAKE_SPHAIRA_RESULT_ENUM(AppstoreBadIndex),
+    MAKE_SPHAIRA_RESULT_ENUM(GameContentHashMismatch),
+    MAKE_SPHAIRA_RESULT_ENUM(SaveManifestInvalid),
+    MAKE_SPHAIRA_RESULT_ENUM(SaveChunkMissing),
+    MAKE_SPHAIRA_RESULT_ENUM(SaveChunkHashMismatch),
+    MAKE_SPHAIRA_RESULT_ENUM(UsbShortTransfer),
+    MAKE_SPHAIRA_RESULT_ENUM(UsbBadZstdChunk),
+    MAKE_SPHAIRA_RESULT_ENUM(UsbBenchNotSupported),
+    MAKE_SPHAIRA_RESULT_ENUM(BenchZstdError),
+    MAKE_SPHAIRA_RESULT_ENUM(BenchFailedWriteJson),
+    MAKE_SPHAIRA_RESULT_ENUM(YatiHttpOpenFailed),
+    MAKE_SPHAIRA_RESULT_ENUM(YatiHttpReadFailed),
+    MAKE_SPHAIRA_RESULT_ENUM(TrashNotActive),
+    MAKE_SPHAIRA_RESULT_ENUM(TrashInvalidPath),
+    MAKE_SPHAIRA_RESULT_ENUM(DevoptabServerCopyNotSupported),
+    MAKE_SPHAIRA_RESULT_ENUM(DevoptabServerCopyFailed),
+    MAKE_SPHAIRA_RESULT_ENUM(CopyVerifyFailed),
+    MAKE_SPHAIRA_RESULT_ENUM(YatiDeltaFragmentNotSupported),
+    MAKE_SPHAIRA_RESULT_ENUM(BenchCryptoMismatch),
+    MAKE_SPHAIRA_RESULT_ENUM(BenchPathIndexMismatch),
+    MAKE_SPHAIRA_RESULT_ENUM(BenchNoFileSelected),
 };
 
 #undef MAKE_SPHAIRA_RESULT_ENUM
@@ -7,6 +7,8 @@
 #include <unordered_map>
 #include <algorithm>
 #include <stop_token>
+#include <memory>
+#include <atomic>
 #include <switch.h>
 
 namespace sphaira::curl {
@@ -21,6 +23,12 @@ enum {
 
     // sets CURLOPT_NOBODY.
     Flag_NoBody = 1 << 1,
+
+    // large files are downloaded in parallel ranges, used for big downloads
+    // as some servers (ie, github) throttle each connection.
+    // falls back to a normal download if the server doesn't support ranges.
+    // this api is only available on blocking downloads to file.
+    Flag_Segmented = 1 << 2,
 };
 
 enum class Priority {
@@ -31,11 +39,82 @@ enum class Priority {
 struct Api;
 struct ApiResult;
 
+// shared with the async queue, allows the ui to re-prioritise or cancel a
+// queued request, ie, based on the distance of an icon from the viewport.
+// queued requests with the lowest key are started first. requests whose key
+// hasn't been set for a short while are stale, and are started after others.
+struct Request {
+    void SetKey(s64 key) {
+        m_key = key;
+        m_tick = armGetSystemTick();
+    }
+
+    // the request is removed from the queue, or stopped if already started.
+    // OnComplete is not called.
+    void Cancel() {
+        m_cancelled = true;
+    }
+
+    auto GetKey() const -> s64 { return m_key; }
+    auto GetTick() const -> u64 { return m_tick; }
+    auto IsCancelled() const -> bool { return m_cancelled; }
+
+private:
+    std::atomic<s64> m_key{};
+    std::atomic<u64> m_tick{armGetSystemTick()};
+    std::atomic_bool m_cancelled{};
+};
+
+using RequestHandle = std::shared_ptr<Request>;
+
+inline auto CreateRequest(s64 key = 0) -> RequestHandle {
+    auto request = std::make_shared<Request>();
+    request->SetKey(key);
+    return request;
+}
+
+struct Stats {
+    // number of requests waiting to be started.
+    u32 queued;
+    // highest number of queued requests seen.
+    u32 queued_peak;
+    // number of transfers in progress.
+    u32 active;
+    // number of requests that were cancelled before starting.
+    u64 dropped;
+};
+
+// timings of a finished transfer, each is the time spent in that step.
+struct Metrics {
+    std::string host;
+    long code;
+    // 1 = http/1.x, 2 = http/2, 3 = http/3, 0 if unknown.
+    u8 http_version;
+    // set if an existing connection was used.
+    bool reused;
+    bool success;
+    // time spent in the async queue, 0 for blocking transfers.
+    u64 queue_ns;
+    u64 dns_ns;
+    u64 connect_ns;
+    u64 tls_ns;
+    // from the request being sent until the first byte of the response.
+    u64 ttfb_ns;
+    u64 total_ns;
+    s64 bytes;
+};
+
+// number of finished transfers kept by GetMetrics().
+constexpr u32 METRICS_HISTORY = 16;
+
 using Path = fs::FsPath;
 using OnComplete = std::function<void(ApiResult& result)>;
 using OnProgress = std::function<bool(s64 dltotal, s64 dlnow, s64 ultotal, s64 ulnow)>;
 using OnUploadCallback = std::function<size_t(void *ptr, size_t size)>;
 using OnUploadSeek = std::function<bool(s64 offset)>;
+// called with the data as it's downloaded, return false to stop.
+// this is only used when downloading to memory, in which case the data is not stored.
+using OnData = std::function<bool(const void* data, size_t size)>;
 using StopToken = std::stop_token;
 
 struct Url {
@@ -156,9 +235,20 @@ auto ToFileAsync(const Api& e) -> bool;
 auto FromMemoryAsync(const Api& e) -> bool;
 auto FromFileAsync(const Api& e) -> bool;
 
+// sends a HEAD request in the background so that the connection and tls
+// session to the host are cached, the next request then skips the dns
+// lookup and handshake.
+auto PrewarmAsync(const std::string& url) -> bool;
+
 // uses curl to convert string to their %XX
 auto EscapeString(const std::string& str) -> std::string;
 
+// stats of the async queue.
+auto GetStats() -> Stats;
+// metrics of the last METRICS_HISTORY transfers, newest first.
+// this is thread safe.
+void GetMetrics(std::vector<Metrics>& out);
+
 struct Api {
     Api() = default;
 
@@ -284,8 +374,10 @@ struct Api {
     }
 
     void SetUpload(bool enable) { m_is_upload = enable; }
+    void SetQueuedTick(u64 tick) { m_queued_tick = tick; }
 
     auto IsUpload() const { return m_is_upload; }
+    auto GetQueuedTick() const { return m_queued_tick; }
     auto& GetUrl() const { return m_url.m_str; }
     auto& GetFields() const { return m_fields.m_str; }
     auto& GetHeader() const { return m_header; }
@@ -301,8 +393,10 @@ struct Api {
     auto& GetOnComplete() const { return m_on_complete; }
     auto& GetOnProgress() const { return m_on_progress; }
     auto& GetOnUploadSeek() const { return m_on_upload_seek; }
+    auto& GetOnData() const { return m_on_data; }
     auto& GetPriority() const { return m_prio; }
     auto& GetToken() const { return m_stoken; }
+    auto& GetRequest() const { return m_request; }
 
     void SetOption(Url&& v) { m_url = v; }
     void SetOption(Fields&& v) { m_fields = v; }
@@ -319,8 +413,10 @@ struct Api {
     void SetOption(OnComplete&& v) { m_on_complete = v; }
     void SetOption(OnProgress&& v) { m_on_progress = v; }
     void SetOption(OnUploadSeek&& v) { m_on_upload_seek = v; }
+    void SetOption(OnData&& v) { m_on_data = v; }
     void SetOption(Priority&& v) { m_prio = v; }
     void SetOption(StopToken&& v) { m_stoken = v; }
+    void SetOption(RequestHandle&& v) { m_request = v; }
 
     template <typename T>
     void set_option(T&& t) {
@@ -349,10 +445,39 @@ private:
     OnComplete m_on_complete{};
     OnProgress m_on_progress{};
     OnUploadSeek m_on_upload_seek{};
+    OnData m_on_data{};
     Priority m_prio{Priority::High};
     std::stop_source m_stop_source{};
     StopToken m_stoken{m_stop_source.get_token()};
+    RequestHandle m_request{};
     bool m_is_upload{};
+    // set when added to the async queue.
+    u64 m_queued_tick{};
+};
+
+// blocking reads of a remote file without downloading it first, used to
+// install straight from a url. each read is split into parallel ranges.
+// the easy handles are kept between reads, so use one per thread.
+struct RemoteFile {
+    RemoteFile(const Api& api);
+    ~RemoteFile();
+
+    // sends a HEAD request for the size and whether ranges are supported.
+    auto Open() -> bool;
+    auto GetSize() const -> s64;
+    auto HasRanges() const -> bool;
+
+    // only valid if HasRanges().
+    auto Read(void* buf, s64 off, s64 size) -> bool;
+    // downloads the whole file in order, stops if on_data returns false.
+    auto ReadAll(const OnData& on_data) -> bool;
+
+    // aborts any read in progress, can be called from any thread.
+    void Cancel();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
 };
 
 } // namespace sphaira::curl
@@ -1,9 +1,8 @@
-// simple thread-safe list of events.
+// simple thread-safe queue of events.
 #pragma once
 
 #include <optional>
 #include <variant>
-#include <list>
 #include <string>
 #include <switch.h>
 #include <nxlink.h>
@@ -27,19 +26,32 @@ using EventData = std::variant<
     curl::DownloadEventData
 >;
 
+struct Stats {
+    // events replaced by a newer event of the same type before being popped.
+    u64 coalesced;
+    // events pushed whilst the ring was full, these are still delivered.
+    u64 overflowed;
+};
+
 // returns number of events
 auto count() -> std::size_t;
 
-// thread-safe
+// thread-safe, events are stored in a fixed size ring, so pushing doesn't
+// allocate or lock.
+// if the ring is full, the event is kept in an overflow list instead, so
+// events are never dropped.
+// if remove_matching is set, the event replaces any pending event of the
+// same type rather than being queued.
+// always returns true.
 auto push(const EventData& e, bool remove_matching = true) -> bool;
 auto push(EventData&& e, bool remove_matching = true) -> bool;
 
 // events are returned FIFO style, so if you push event a,b,c
 // then pop() will return a then b then c.
+// coalesced events are returned once the queue is empty.
+// must only be called from a single thread (the main thread).
 auto pop() -> std::optional<EventData>;
 
-// this pops all events, this is ideal to stop the main thread from
-// hanging if loads of events are pushed and popped at the same time.
-auto popall() -> std::list<EventData>;
+auto get_stats() -> Stats;
 
 } // namespace sphaira::evman
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "fs.hpp"
+#include "ui/progress_box.hpp"
+#include <functional>
+#include <span>
+#include <switch.h>
+
+namespace sphaira::copy {
+
+struct Entry {
+    fs::FsPath src{};
+    fs::FsPath dst{};
+    // size hint used for the progress bar, can be 0 if unknown.
+    s64 size{};
+};
+
+// called once a file has been copied, ie, to delete the src when moving.
+// this is called with a lock held, so it is never called in parallel.
+using DoneCallback = std::function<Result(const Entry& entry)>;
+
+struct Config {
+    // passed to CopyFile() for large files.
+    bool single_threaded{};
+    bool parallel_read{};
+    // reads back each dst once written and compares it against the src.
+    // the src is never read twice, small files are compared from memory and
+    // large files are hashed as they're written.
+    bool verify{};
+};
+
+// copies all entries from fs_src to fs_dst, the dst folders must already exist.
+// small files are copied whole by a pool of workers, so that the open / create
+// latency of each file overlaps with the others.
+// large files are handed back to the calling thread and streamed with CopyFile().
+Result CopyFiles(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, std::span<const Entry> entries, const Config& config = {}, const DoneCallback& done = nullptr);
+
+} // namespace sphaira::copy
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "fs.hpp"
+#include "file_copy.hpp"
+#include "ui/progress_box.hpp"
+#include <vector>
+#include <switch.h>
+
+// one way sync of a src folder into a dst folder.
+// files are copied if they're missing from the dst, differ in size or the src
+// was modified after the dst (the dst gets the time of the copy), everything
+// else is skipped. the plan is built first so that it can be shown before
+// anything is changed.
+namespace sphaira::sync {
+
+struct Config {
+    // compare the modified time of files that are the same size, off for
+    // fs that don't report it (ie, some network mounts).
+    bool compare_timestamp{true};
+};
+
+struct Plan {
+    // dirs missing from the dst, parents come before their sub dirs.
+    std::vector<fs::FsPath> dirs{};
+    // new or changed files.
+    std::vector<copy::Entry> files{};
+    // files and dirs only in the dst, dirs are in reverse walk order so that
+    // they can be deleted in order.
+    std::vector<fs::FsPath> extra_files{};
+    std::vector<fs::FsPath> extra_dirs{};
+
+    u64 new_count{};
+    u64 changed_count{};
+    u64 unchanged_count{};
+    s64 copy_size{};
+};
+
+// compares the src folder against the dst folder, appending to out.
+// the dst doesn't have to exist.
+Result BuildPlan(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, Plan& out, const Config& config = {});
+// same as above for a single file.
+Result BuildPlanFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, Plan& out, const Config& config = {});
+
+// creates the dirs, copies the files and, if set, deletes the extras.
+Result ApplyPlan(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, const Plan& plan, bool delete_extra, const copy::Config& config = {});
+
+} // namespace sphaira::sync
@@ -17,7 +17,7 @@ enum OpenMode : u32 {
     OpenMode_Write = FsOpenMode_Write,
     OpenMode_Append = FsOpenMode_Append,
 
-    // enables buffering for stdio based files.
+    // enables buffering for stdio based files, see SetStdioBufferSize().
     OpenMode_EnableBuffer = 1 << 16,
     OpenMode_ReadBuffered = OpenMode_Read | OpenMode_EnableBuffer,
     OpenMode_WriteBuffered = OpenMode_Write | OpenMode_EnableBuffer,
@@ -242,15 +242,21 @@ struct Fs;
 struct File {
     ~File();
 
+    // native reads are thread-safe and can be issued from multiple threads at once,
+    // stdio reads share the file position so each thread needs its own handle.
     Result Read(s64 off, void* buf, u64 read_size, u32 option, u64* bytes_read);
     Result Write(s64 off, const void* buf, u64 write_size, u32 option);
     Result SetSize(s64 sz);
     Result GetSize(s64* out);
-    void Close();
+    // fails if buffered writes could not be flushed, ie, to a network mount.
+    Result Close();
 
     fs::Fs* m_fs{};
     FsFile m_native{};
     std::FILE* m_stdio{};
+    // pooled buffer set with setvbuf, freed after the file is closed.
+    void* m_stdio_buf{};
+    u32 m_stdio_buf_size{};
     u32 m_mode{};
 };
 
@@ -270,15 +276,29 @@ struct Dir {
 
 FsPath AppendPath(const fs::FsPath& root_path, const fs::FsPath& file_path);
 
-Result CreateFile(FsFileSystem* fs, const FsPathReal& path, u64 size = 0, u32 option = 0, bool ignore_read_only = true);
-Result CreateDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true);
-Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& path, bool ignore_read_only = true);
-Result CreateDirectoryRecursivelyWithPath(FsFileSystem* fs, const FsPath& path, bool ignore_read_only = true);
-Result DeleteFile(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true);
-Result DeleteDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true);
-Result DeleteDirectoryRecursively(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true);
-Result RenameFile(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only = true);
-Result RenameDirectory(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only = true);
+// bumped whenever a file or folder is created, deleted, renamed or closed
+// after writing, so that callers caching directory listings (ie, mtp) can
+// tell that something changed. this is global, not per path.
+auto GetChangeGeneration() -> u64;
+void SignalChange();
+
+// size of the buffer that buffered stdio opens use for files on the device,
+// the libc default is only a few KiB which is a device call for every small
+// read on network mounts / usb drives.
+// the device is the name before the ':', 0 removes it.
+void SetStdioBufferSize(std::string_view device, u32 size);
+// returns 0 if the libc default should be used.
+auto GetStdioBufferSize(std::string_view path) -> u32;
+
+Result CreateFile(FsFileSystem* fs, const FsPathReal& path, u64 size = 0, u32 option = 0, bool ignore_read_only = true, bool commit = true);
+Result CreateDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true, bool commit = true);
+Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& path, bool ignore_read_only = true, bool commit = true);
+Result CreateDirectoryRecursivelyWithPath(FsFileSystem* fs, const FsPath& path, bool ignore_read_only = true, bool commit = true);
+Result DeleteFile(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true, bool commit = true);
+Result DeleteDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true, bool commit = true);
+Result DeleteDirectoryRecursively(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only = true, bool commit = true);
+Result RenameFile(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only = true, bool commit = true);
+Result RenameDirectory(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only = true, bool commit = true);
 Result GetEntryType(FsFileSystem* fs, const FsPathReal& path, FsDirEntryType* out);
 Result GetFileTimeStampRaw(FsFileSystem* fs, const FsPathReal& path, FsTimeStampRaw *out);
 Result SetTimestamp(FsFileSystem* fs, const FsPathReal& path, const FsTimeStampRaw* ts);
@@ -468,31 +488,31 @@ struct FsNative : Fs {
     }
 
     Result CreateFile(const FsPath& path, u64 size = 0, u32 option = 0) override {
-        return fs::CreateFile(&m_fs, path, size, option, m_ignore_read_only);
+        return fs::CreateFile(&m_fs, path, size, option, m_ignore_read_only, !IsCommitBatched());
     }
     Result CreateDirectory(const FsPath& path) override {
-        return fs::CreateDirectory(&m_fs, path, m_ignore_read_only);
+        return fs::CreateDirectory(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result CreateDirectoryRecursively(const FsPath& path) override {
-        return fs::CreateDirectoryRecursively(&m_fs, path, m_ignore_read_only);
+        return fs::CreateDirectoryRecursively(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result CreateDirectoryRecursivelyWithPath(const FsPath& path) override {
-        return fs::CreateDirectoryRecursivelyWithPath(&m_fs, path, m_ignore_read_only);
+        return fs::CreateDirectoryRecursivelyWithPath(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result DeleteFile(const FsPath& path) override {
-        return fs::DeleteFile(&m_fs, path, m_ignore_read_only);
+        return fs::DeleteFile(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result DeleteDirectory(const FsPath& path) override {
-        return fs::DeleteDirectory(&m_fs, path, m_ignore_read_only);
+        return fs::DeleteDirectory(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result DeleteDirectoryRecursively(const FsPath& path) override {
-        return fs::DeleteDirectoryRecursively(&m_fs, path, m_ignore_read_only);
+        return fs::DeleteDirectoryRecursively(&m_fs, path, m_ignore_read_only, !IsCommitBatched());
     }
     Result RenameFile(const FsPath& src, const FsPath& dst) override {
-        return fs::RenameFile(&m_fs, src, dst, m_ignore_read_only);
+        return fs::RenameFile(&m_fs, src, dst, m_ignore_read_only, !IsCommitBatched());
     }
     Result RenameDirectory(const FsPath& src, const FsPath& dst) override {
-        return fs::RenameDirectory(&m_fs, src, dst, m_ignore_read_only);
+        return fs::RenameDirectory(&m_fs, src, dst, m_ignore_read_only, !IsCommitBatched());
     }
     Result GetEntryType(const FsPath& path, FsDirEntryType* out) override {
         return fs::GetEntryType(&m_fs, path, out);
@@ -503,9 +523,7 @@ struct FsNative : Fs {
     Result SetTimestamp(const FsPath& path, const FsTimeStampRaw *ts) override {
         return fs::SetTimestamp(&m_fs, path, ts);
     }
-    Result Commit() override {
-        return fsFsCommit(&m_fs);
-    }
+    Result Commit() override;
     bool FileExists(const FsPath& path) override {
         return fs::FileExists(&m_fs, path);
     }
@@ -516,9 +534,27 @@ struct FsNative : Fs {
         return true;
     }
 
+    // defers commits until either the size written since the last commit
+    // reaches the limit, or the batch is ended.
+    // each commit flushes the journal, which is slow when restoring a save with
+    // lots of small files. the limit should be below the journal size, as
+    // the fs will fail writes once the uncommitted data no longer fits.
+    void BeginCommitBatch(s64 limit);
+    // commits anything pending and goes back to committing after every change.
+    Result EndCommitBatch();
+    void AddPendingCommit(s64 size);
+
+    bool IsCommitBatched() const {
+        return m_commit_limit > 0;
+    }
+
     FsFileSystem m_fs{};
     Result m_open_result{};
     const bool m_own{true};
+
+private:
+    s64 m_commit_limit{};
+    s64 m_commit_pending{};
 };
 
 #if 0
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
+#include <switch.h>
 
 namespace sphaira::ftpsrv {
 
@@ -15,6 +18,19 @@ using OnInstallClose = std::function<void()>;
 void InitInstallMode(const OnInstallStart& on_start, const OnInstallWrite& on_write, const OnInstallClose& on_close);
 void DisableInstallMode();
 
+struct SessionStats {
+    std::string path;
+    s64 bytes;
+    u64 elapsed_ns;
+    bool upload;
+    // false once the file has been closed.
+    bool active;
+};
+
+// files transferred through the games / mounts folders, the open ones first
+// followed by the last few that were closed.
+auto GetSessionStats() -> std::vector<SessionStats>;
+
 unsigned GetPort();
 bool IsAnon();
 const char* GetUser();
@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <span>
+#include <vector>
 #include <switch.h>
 
 namespace sphaira::hash {
@@ -23,11 +24,43 @@ struct BaseSource {
     virtual Result Read(void* buf, s64 off, s64 size, u64* bytes_read) = 0;
 };
 
+// a single hash that is updated as the data arrives, see Create().
+struct HashSource {
+    virtual ~HashSource() = default;
+    virtual void Update(const void* buf, s64 size, s64 file_size) = 0;
+    virtual void Get(std::string& out) = 0;
+};
+
 auto GetTypeStr(Type type) -> const char*;
+auto Create(Type type) -> std::unique_ptr<HashSource>;
 
 // returns the hash string.
 Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& out);
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out);
 Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::string& out);
 
+// same as above, but calculates every type in a single read of the source.
+// each hash is updated on its own thread, out is in the same order as types.
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out);
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out);
+
+struct MultiHash;
+
+// calculates every type from data as it arrives, used by Hash() above and for
+// hashing data that is already being read for something else.
+// each hash (other than the first) is updated on its own thread.
+struct MultiHasher {
+    MultiHasher(std::span<const Type> types, s64 file_size);
+    ~MultiHasher();
+
+    // blocks until every hash has been updated, so buf only has to be valid
+    // for the duration of the call.
+    void Update(const void* buf, s64 size);
+    // out is in the same order as types.
+    void Get(std::vector<std::string>& out);
+
+private:
+    std::unique_ptr<MultiHash> m_impl;
+};
+
 } // namespace sphaira::hash
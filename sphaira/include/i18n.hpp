@@ -2,7 +2,10 @@
 
 #include <string>
 #include <string_view>
+#include <switch.h>
 
+// translations are loaded into an immutable table when the language is set,
+// so lookups don't lock or allocate, and literal keys are hashed at compile time.
 namespace sphaira::i18n {
 
 enum class WordOrder {
@@ -10,9 +13,58 @@ enum class WordOrder {
     NamePhrase   // SOV (Japanese, Korean)
 };
 
+// the translation, or the key itself if there isn't one.
+// it points into the translation table, which is kept until exit(), even if
+// the language is changed.
+struct Str {
+    constexpr Str() = default;
+    constexpr Str(const char* str, size_t len) : m_str{str}, m_len{len} {}
+
+    auto c_str() const -> const char* { return m_str; }
+    auto data() const -> const char* { return m_str; }
+    auto size() const -> size_t { return m_len; }
+    auto length() const -> size_t { return m_len; }
+    auto empty() const -> bool { return !m_len; }
+
+    operator std::string() const { return {m_str, m_len}; }
+    operator std::string_view() const { return {m_str, m_len}; }
+
+private:
+    const char* m_str{""};
+    size_t m_len{};
+};
+
+inline auto operator+(Str a, Str b) -> std::string {
+    return std::string{a}.append(b);
+}
+
+inline auto operator+(Str a, std::string_view b) -> std::string {
+    return std::string{a}.append(b);
+}
+
+inline auto operator+(std::string_view a, Str b) -> std::string {
+    return std::string{a}.append(b);
+}
+
+// fnv1a, constexpr so that the hash of a literal key is folded.
+constexpr auto Hash(std::string_view str) -> u64 {
+    u64 hash = 0xCBF29CE484222325;
+    for (const auto c : str) {
+        hash ^= static_cast<u8>(c);
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+// builds the table for the language, the previous table is kept.
 bool init(long index);
+// frees all tables, any Str returned before this is no longer valid.
 void exit();
 
+// hash must be Hash(key), the key is returned if there's no translation, so it
+// must be null terminated.
+auto Find(u64 hash, std::string_view key) -> Str;
+
 std::string get(std::string_view str);
 std::string get(std::string_view str, std::string_view fallback);
 
@@ -21,10 +73,17 @@ bool WordOrderLocale();
 
 std::string Reorder(std::string_view phrase, std::string_view name);
 
+// looks up every translation iterations times, copying each into a
+// std::string if set (as a sidebar does), used by the benchmarks menu.
+// returns the number of lookups, 0 if no translations are loaded.
+auto Benchmark(u32 iterations, bool copy) -> u64;
+
 } // namespace sphaira::i18n
 
 inline namespace literals {
 
-std::string operator""_i18n(const char* str, size_t len);
+inline auto operator""_i18n(const char* str, size_t len) -> sphaira::i18n::Str {
+    return sphaira::i18n::Find(sphaira::i18n::Hash({str, len}), {str, len});
+}
 
 } // namespace literals
@@ -19,7 +19,11 @@ enum ImageFlag {
 };
 
 auto ImageLoadFromMemory(std::span<const u8> data, u32 flags = ImageFlag_None) -> ImageResult;
+// same as above, but the data is handed to nvjpg without a copy.
+auto ImageLoadFromMemory(std::vector<u8>&& data, u32 flags = ImageFlag_None) -> ImageResult;
 auto ImageLoadFromFile(const fs::FsPath& file, u32 flags = ImageFlag_None) -> ImageResult;
+// frees the surfaces kept for nvjpg, call before the decoder is closed.
+void ImageExit();
 auto ImageResize(std::span<const u8> data, int inx, int iny, int outx, int outy) -> ImageResult;
 auto ImageConvertToJpg(std::span<const u8> data, int x, int y) -> ImageResult;
 
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "image.hpp"
+#include "nanovg.h"
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <string_view>
+#include <switch.h>
+
+// decodes images on a pool of worker threads, so that loading icons whilst
+// scrolling doesn't stall the frame.
+// the main thread only uploads the decoded image to nvg in Upload(), which
+// is called once per frame and stops once the frame budget is used.
+namespace sphaira::image {
+
+// returns the encoded image, called on a worker thread.
+using Loader = std::function<std::vector<u8>()>;
+
+// images drawn smaller than their size are downscaled and saved as raw rgba
+// to /switch/sphaira/cache/thumbs, so the next load is a single read, with
+// no decode or resize.
+struct Thumb {
+    // identifies the source image, ie, a hash of the path and timestamp.
+    // if 0, the hash of the encoded image is used, which means the image still
+    // has to be loaded, but not decoded.
+    u64 id{};
+    // size the image is drawn at, 0 disables the thumbnail.
+    // thumbnails are uploaded to the icon atlas, see ui::gfx::createAtlasImage().
+    int size{};
+};
+
+// returns an id for the thumbnail from the name and anything that changes
+// when the image does, ie, the timestamp.
+auto MakeThumbId(std::string_view name, u64 version) -> u64;
+
+// shared with the decode queue, allows the ui to re-prioritise or cancel a
+// queued decode, ie, based on the distance of an icon from the viewport.
+// queued requests with the lowest key are decoded first. requests whose key
+// hasn't been set for a short while have scrolled away, and are dropped.
+struct Request {
+    // frees the image if it wasn't taken.
+    ~Request();
+
+    void SetKey(s64 key) {
+        m_key = key;
+        m_tick = armGetSystemTick();
+    }
+
+    // the request is dropped if it hasn't been decoded yet.
+    void Cancel() {
+        m_cancelled = true;
+    }
+
+    auto GetKey() const -> s64 { return m_key; }
+    auto GetTick() const -> u64 { return m_tick; }
+    auto IsCancelled() const -> bool { return m_cancelled; }
+    // set once the image has been uploaded, or failed to decode.
+    auto IsDone() const -> bool { return m_done; }
+
+    // the size of the source image, not the thumbnail.
+    auto GetWidth() const -> int { return m_w; }
+    auto GetHeight() const -> int { return m_h; }
+    // used to fill the background of images smaller than the icon.
+    auto GetFirstPixel() const -> const u8* { return m_first_pixel; }
+
+    // returns the nvg image, or 0 if it failed to decode.
+    // the caller then owns the image, only call from the main thread.
+    auto TakeImage() -> int {
+        const auto image = m_image;
+        m_image = 0;
+        return image;
+    }
+
+    // only called by the decode queue from the main thread.
+    void SetImage(int image, int w, int h, const u8* first_pixel);
+
+private:
+    std::atomic<s64> m_key{};
+    std::atomic<u64> m_tick{armGetSystemTick()};
+    std::atomic_bool m_cancelled{};
+    std::atomic_bool m_done{};
+    int m_image{};
+    int m_w{};
+    int m_h{};
+    u8 m_first_pixel[4]{};
+};
+
+using RequestHandle = std::shared_ptr<Request>;
+
+// starts the worker threads.
+Result Init();
+void ExitSignal();
+// frees any images that were uploaded but not taken, call from the main thread.
+void Exit();
+
+// queues the image to be decoded.
+// the request is dropped if the handle is released before it's decoded.
+auto Push(Loader&& loader, u32 flags = ImageFlag_None, s64 key = 0, const Thumb& thumb = {}) -> RequestHandle;
+
+// uploads decoded images to nvg, call from the main thread once per frame.
+void Upload(NVGcontext* vg);
+
+struct Stats {
+    // number of requests waiting to be decoded.
+    u32 queued;
+    // number of decoded images waiting to be uploaded.
+    u32 decoded;
+};
+
+auto GetStats() -> Stats;
+
+// helper for lazy loading images in a list, call each frame whilst the entry is
+// visible. starts the decode if needed, keeps it from going stale, and sets
+// image once it's been uploaded. a request that scrolled away, or an image
+// evicted from the atlas, is pushed again.
+// failed images are not retried as the finished request is kept.
+void LoadAsync(RequestHandle& request, int& image, s64 key, u32 flags, const Thumb& thumb, const std::function<Loader()>& create);
+
+} // namespace sphaira::image
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ui/progress_box.hpp"
+#include <switch.h>
+#include <string>
+#include <vector>
+
+// runs progress box callbacks in the background, rather than blocking the ui
+// with a modal box.
+// each job is tagged with the device it's bound by, jobs on the same device
+// queue up to that device's limit, so that jobs on different devices overlap.
+// the ui thread owns the jobs, finished jobs are destroyed in Update(), which
+// is also where the done callback is called.
+namespace sphaira::jobs {
+
+enum Device {
+    Device_Sd,
+    Device_Nand,
+    Device_Usb,
+    Device_Network,
+    Device_Other,
+    Device_MAX,
+};
+
+struct Info {
+    u32 id;
+    std::string title;
+    std::string transfer;
+    s64 offset;
+    s64 size;
+    // bytes per second.
+    s64 speed;
+    bool queued;
+    bool paused;
+};
+
+// cancels all jobs.
+void ExitSignal();
+// waits for all jobs to finish, must be called whilst nvg is alive.
+void Exit();
+
+// callbacks must not reference anything owned by a menu, as the menu may be
+// closed before the job finishes.
+void Push(Device device, const std::string& action, const std::string& title, const ui::ProgressBoxCallback& callback, const ui::ProgressBoxDoneCallback& done = nullptr);
+
+// called once per frame on the ui thread.
+void Update();
+
+auto GetCount() -> u32;
+auto GetInfo() -> std::vector<Info>;
+
+void SetPaused(u32 id, bool paused);
+void Cancel(u32 id);
+
+} // namespace sphaira::jobs
@@ -8,6 +8,26 @@ extern "C" {
 
 #include <stdarg.h>
 
+// log_write() is always compiled in, log_debug() is only compiled in if
+// SPHAIRA_LOG_LEVEL (LOG_LEVEL in cmake) is at least LOG_LEVEL_DEBUG.
+// debug logs are for per call / per block logging on the data path, ie,
+// path fixups and stream offsets, and are also filtered at runtime by
+// category, see log_set_category_mask().
+#define LOG_LEVEL_INFO 0
+#define LOG_LEVEL_DEBUG 1
+
+#ifndef SPHAIRA_LOG_LEVEL
+#define SPHAIRA_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+enum LogCategory {
+    LogCategory_Fs = 1 << 0,
+    LogCategory_Devoptab = 1 << 1,
+    LogCategory_Yati = 1 << 2,
+    LogCategory_Ncz = 1 << 3,
+    LogCategory_Net = 1 << 4,
+};
+
 #if sphaira_USE_LOG
 bool log_file_init();
 bool log_nxlink_init();
@@ -17,6 +37,10 @@ bool log_is_init();
 void log_nxlink_exit();
 void log_write(const char* s, ...) __attribute__ ((format (printf, 1, 2)));
 void log_write_arg(const char* s, va_list* v);
+
+// all categories are enabled by default.
+void log_set_category_mask(unsigned mask);
+bool log_is_category_enabled(unsigned category);
 #else
 inline bool log_file_init() {
     return true;
@@ -28,6 +52,19 @@ inline bool log_nxlink_init() {
 #define log_nxlink_exit()
 #define log_write(...)
 #define log_write_arg(...)
+#define log_set_category_mask(...)
+#define log_is_category_enabled(...) 0
+#endif
+
+// the arguments are only evaluated if the log is going to be written.
+#if sphaira_USE_LOG && SPHAIRA_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(category, ...) do { \
+    if (log_is_init() && log_is_category_enabled(category)) { \
+        log_write(__VA_ARGS__); \
+    } \
+} while (0)
+#else
+#define log_debug(category, ...) do { } while (0)
 #endif
 
 #ifdef __cplusplus
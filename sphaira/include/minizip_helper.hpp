@@ -1,8 +1,10 @@
 #pragma once
 
 #include <minizip/ioapi.h>
+#include <zlib.h>
 #include <vector>
 #include <span>
+#include <functional>
 #include <switch.h>
 #include "fs.hpp"
 
@@ -29,4 +31,88 @@ void FileFuncNative(zlib_filefunc64_def* funcs);
 // which takes 1-2ms.
 Result PeekFirstFileName(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& name);
 
+// entry from the central directory.
+struct CentralEntry {
+    fs::FsPath name{};
+    u16 flags{};
+    u16 compression{};
+    u32 crc32{};
+    s64 compressed_size{};
+    s64 uncompressed_size{};
+    s64 local_hdr_off{};
+};
+
+using CentralEntries = std::vector<CentralEntry>;
+
+// finds the end record in the last bytes of a zip, ie, fetched using a http range.
+// zip64 isn't supported.
+Result FindCentralDirectory(std::span<const u8> tail, s64& off, s64& size, u32& count);
+// parses the central directory, data must contain the whole directory.
+Result ParseCentralDirectory(std::span<const u8> data, u32 count, CentralEntries& out);
+
+// extracts a zip as the data arrives, ie, whilst downloading, so that the zip
+// doesn't have to be written to disk first.
+// only the local headers are parsed, the central directory is ignored.
+// stored entries with a data descriptor can't be streamed, as the size isn't known.
+struct StreamUnzip {
+    // returns the path to extract the entry to, or an empty path to skip it.
+    using OnEntry = std::function<fs::FsPath(const fs::FsPath& name, s64 size)>;
+
+    StreamUnzip(fs::Fs* fs, const OnEntry& on_entry);
+    ~StreamUnzip();
+
+    Result Push(const void* data, u64 size);
+    // fails if the stream ended part way through an entry.
+    Result Finish();
+
+private:
+    enum class State {
+        Header,
+        Data,
+        Descriptor,
+        // reached the central directory.
+        Done,
+    };
+
+    auto Avail() const -> u64 {
+        return m_buf.size() - m_buf_off;
+    }
+
+    auto Ptr() const -> const u8* {
+        return m_buf.data() + m_buf_off;
+    }
+
+    Result ParseHeader(bool& more);
+    Result ParseData(bool& more);
+    Result ParseDescriptor(bool& more);
+    Result WriteOut(const void* data, u64 size);
+    Result CloseEntry(u32 crc);
+
+private:
+    fs::Fs* const m_fs;
+    const OnEntry m_on_entry;
+    State m_state{State::Header};
+
+    // pending input, m_buf_off is how much has been consumed.
+    std::vector<u8> m_buf{};
+    u64 m_buf_off{};
+    std::vector<u8> m_out{};
+
+    // current entry.
+    fs::FsPath m_name{};
+    fs::File m_file{};
+    bool m_skip{};
+    bool m_has_descriptor{};
+    bool m_zip64{};
+    u16 m_compression{};
+    u32 m_crc{};
+    u32 m_crc_calc{};
+    // compressed bytes left, or -1 if unknown (data descriptor).
+    s64 m_comp_left{};
+    s64 m_out_off{};
+
+    z_stream m_z{};
+    bool m_z_init{};
+};
+
 } // namespace sphaira::mz
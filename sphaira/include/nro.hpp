@@ -6,6 +6,7 @@
 #include <span>
 #include <optional>
 #include "fs.hpp"
+#include "image_decode.hpp"
 
 namespace sphaira {
 
@@ -36,6 +37,7 @@ struct NroEntry {
     Hbini hbini{};
 
     int image{}; // nvg image
+    image::RequestHandle image_request{};
     int x,y,w,h{}; // image
     bool is_nacp_valid{};
     std::optional<bool> has_star{std::nullopt};
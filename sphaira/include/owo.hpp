@@ -3,6 +3,8 @@
 #include <switch.h>
 #include <string>
 #include <vector>
+#include <span>
+#include <functional>
 #include "ui/progress_box.hpp"
 
 namespace sphaira {
@@ -23,4 +25,12 @@ struct OwoConfig {
 auto install_forwarder(OwoConfig& config, NcmStorageId storage_id) -> Result;
 auto install_forwarder(ui::ProgressBox* pbox, OwoConfig& config, NcmStorageId storage_id) -> Result;
 
+// called on the pbox thread after each forwarder is installed.
+using OnForwarderInstalled = std::function<void(const OwoConfig& config)>;
+
+// installs every config under the one progress box, stopping at the first error.
+// the keys, services and logo are shared between the forwarders, and each is
+// built on a worker whilst the previous one is being installed.
+auto install_forwarders(ui::ProgressBox* pbox, std::span<OwoConfig> configs, NcmStorageId storage_id, const OnForwarderInstalled& on_installed = {}) -> Result;
+
 } // namespace sphaira
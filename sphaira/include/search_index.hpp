@@ -0,0 +1,43 @@
+#pragma once
+
+#include "fs.hpp"
+#include <switch.h>
+#include <string_view>
+#include <vector>
+
+// background index of file names across the sd card and other mounts.
+// the roots are walked on a low priority thread, the index is saved to the
+// sd card so that it's available straight away on the next boot, and dirs
+// whose modified time hasn't changed since the last walk are not read again.
+// names are found using a (hashed) trigram index, so a search only checks
+// names that could match, rather than every name in the index.
+namespace sphaira::search {
+
+struct Match {
+    // full path, sd paths start with "/", others with the mount, ie "ums0:/".
+    fs::FsPath path{};
+    s64 size{};
+    bool is_dir{};
+};
+
+struct Stats {
+    u32 entries{};
+    bool indexing{};
+};
+
+// loads the saved index and starts a walk of the roots.
+// the roots are "/" (sd card) and any mounts listed in the config, ie
+// [search] roots=ums0:/,smb:/
+void Init();
+void ExitSignal();
+void Exit();
+
+// walks all the roots again, only reading dirs that have changed.
+void Rescan();
+
+// case insensitive search of names containing the query, upto max results.
+Result Find(std::string_view query, u32 max, std::vector<Match>& out);
+
+auto GetStats() -> Stats;
+
+} // namespace sphaira::search
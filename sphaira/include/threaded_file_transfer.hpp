@@ -2,6 +2,10 @@
 
 #include "ui/progress_box.hpp"
 #include <functional>
+#include <string>
+#include <span>
+#include <tuple>
+#include <utility>
 #include <switch.h>
 
 namespace sphaira::thread {
@@ -13,6 +17,56 @@ enum class Mode {
     SingleThreaded,
     // check buffer size, if smaller, single thread.
     SingleThreadedIfSmaller,
+    // same as MultiThreaded, but multiple read threads fetch disjoint chunks in parallel.
+    // the read callback must be thread-safe and the source must support random access.
+    ParallelRead,
+};
+
+// configures the queues placed between the read, decompress and write threads.
+// a value of 0 uses the value set in the config.
+struct PipelineConfig {
+    // number of buffers queued between each thread.
+    u32 slot_count{};
+    // size of each buffer.
+    u64 slot_size{};
+    // grows the queue whilst the consumer is starved, shrinks it under memory pressure.
+    bool adaptive{};
+    // number of read threads used by Mode::ParallelRead.
+    u32 reader_count{};
+    // if set (and enabled by the user), the values above that weren't set are
+    // picked from the speeds measured on this route, see transfer_tune.hpp.
+    std::string tune_route{};
+};
+
+// max number of read threads used by Mode::ParallelRead.
+constexpr u32 MAX_READER_COUNT = 4;
+
+// returns the config set by the user, used by all transfers by default.
+auto GetPipelineConfig() -> PipelineConfig;
+
+// file based emummc can't keep up with back to back requests, so they're
+// spaced out to 1 per 2ms. call once the request is done with the tick from
+// before it started, only the time that's left is slept, so that slow
+// requests don't pay for the sleep as well.
+void EmummcThrottle(u64 start_tick);
+
+// timings for a single stage (read, decompress or write) of a transfer.
+struct StageStats {
+    // bytes that passed through the stage.
+    s64 bytes{};
+    // time spent doing work, excludes time spent blocked.
+    u64 busy_ns{};
+    // time spent waiting on the previous / next stage.
+    u64 blocked_ns{};
+    // number of times the stage had to wait.
+    u32 waits{};
+};
+
+struct TransferStats {
+    StageStats read{};
+    StageStats decompress{};
+    StageStats write{};
+    u64 elapsed_ns{};
 };
 
 using DecompressWriteCallback = std::function<Result(const void* data, s64 size)>;
@@ -37,6 +91,75 @@ using StartCallback2 = std::function<Result(StartThreadCallback start, PullCallb
 // reads data from rfunc into wfunc.
 Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const WriteCallback& wfunc, Mode mode = Mode::MultiThreaded);
 Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const DecompressCallback& dfunc, const WriteCallback& wfunc, Mode mode = Mode::MultiThreaded);
+// same as above, but uses the provided config rather than the default one.
+// if stats is set, it is filled with the per-stage timings once the transfer finishes.
+Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const DecompressCallback& dfunc, const WriteCallback& wfunc, const PipelineConfig& config, Mode mode = Mode::MultiThreaded, TransferStats* stats = nullptr);
+
+// chains any number of transform stages (decrypt, hash, compress...) into a
+// single DecompressCallback, so they all run on the decompress thread.
+// the stages are called directly rather than through a std::function, which
+// inlines the hop between each stage, only the first stage and the final
+// write are type-erased.
+// a stage is any callable with the signature:
+//   template<typename Next>
+//   Result operator()(void* data, s64 off, s64 size, const Next& next);
+// which calls next(void* data, s64 off, s64 size) zero or more times with its
+// output. off is the offset of the output, stages that change the size of
+// the data (ie, compression) track their own output offset.
+// data may be modified in place, ie, decrypting.
+// stages are copied into the transfer, so results (ie, a hash) should be
+// written through a pointer.
+template<typename... Stages>
+struct Pipeline {
+    Pipeline(Stages... stages) : m_stages{std::move(stages)...} {}
+
+    Result operator()(void* data, s64 off, s64 size, const DecompressWriteCallback& write) {
+        return Run<0>(data, off, size, write);
+    }
+
+private:
+    template<std::size_t I>
+    Result Run(void* data, s64 off, s64 size, const DecompressWriteCallback& write) {
+        if constexpr (I == sizeof...(Stages)) {
+            return write(data, size);
+        } else {
+            return std::get<I>(m_stages)(data, off, size, [this, &write](void* data, s64 off, s64 size) -> Result {
+                return Run<I + 1>(data, off, size, write);
+            });
+        }
+    }
+
+private:
+    std::tuple<Stages...> m_stages;
+};
+
+// passes the data through unchanged, calling func(data, size) on each chunk.
+// used for hashing / progress without an extra stage in the transfer.
+template<typename Func>
+struct PeekStage {
+    PeekStage(Func func) : m_func{std::move(func)} {}
+
+    template<typename Next>
+    Result operator()(void* data, s64 off, s64 size, const Next& next) {
+        m_func(data, size);
+        return next(data, off, size);
+    }
+
+private:
+    Func m_func;
+};
+
+// reads data from rfunc, passing it through each stage of the pipeline into wfunc.
+template<typename... Stages>
+Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, Pipeline<Stages...> pipeline, const WriteCallback& wfunc, Mode mode = Mode::MultiThreaded) {
+    return Transfer(pbox, size, rfunc, DecompressCallback{std::move(pipeline)}, wfunc, mode);
+}
+
+// same as above, but uses the provided config rather than the default one.
+template<typename... Stages>
+Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, Pipeline<Stages...> pipeline, const WriteCallback& wfunc, const PipelineConfig& config, Mode mode = Mode::MultiThreaded, TransferStats* stats = nullptr) {
+    return Transfer(pbox, size, rfunc, DecompressCallback{std::move(pipeline)}, wfunc, config, mode, stats);
+}
 
 // reads data from rfunc, pull data from provided pull() callback.
 Result TransferPull(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const StartCallback& sfunc, Mode mode = Mode::MultiThreaded);
@@ -49,11 +172,30 @@ Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::F
 // same as above but for zipping files.
 Result TransferZip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, u32* crc32 = nullptr, Mode mode = Mode::SingleThreadedIfSmaller);
 
+// opens a new entry in the zip, compresses the file into it and closes the entry.
+// zip_info is a zip_fileinfo* and level is the zlib compression level.
+// large files are split into blocks that are deflated in parallel and joined
+// into a single deflate stream, so the zip is still readable by any unzip tool.
+Result TransferZipEntry(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, const char* name_in_zip, const void* zip_info, int level, Mode mode = Mode::SingleThreadedIfSmaller);
+
+struct ZipEntry {
+    fs::FsPath path;
+    std::string name_in_zip;
+};
+
+// same as above, but for many files.
+// small files are deflated in parallel, each by a different worker, and are
+// then added to the zip in order.
+Result TransferZipEntries(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, std::span<const ZipEntry> entries, const void* zip_info, int level, Mode mode = Mode::SingleThreadedIfSmaller);
+
 // passes the name inside the zip an final output path.
 using UnzipAllFilter = std::function<bool(const fs::FsPath& name, fs::FsPath& path)>;
 
 // helper all-in-one unzip function that unzips a zip (either open or path provided).
 // the filter function can be used to modify the path and filter out unwanted files.
+// when a path is provided, the central directory is parsed once and the files are
+// extracted in parallel by a pool of workers, unless mode is SingleThreaded.
+// note that the filter is always called from the calling thread.
 Result TransferUnzipAll(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& base_path, const UnzipAllFilter& filter = nullptr, Mode mode = Mode::SingleThreadedIfSmaller);
 Result TransferUnzipAll(ui::ProgressBox* pbox, const fs::FsPath& zip_out, fs::Fs* fs, const fs::FsPath& base_path, const UnzipAllFilter& filter = nullptr, Mode mode = Mode::SingleThreadedIfSmaller);
 
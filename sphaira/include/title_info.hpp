@@ -50,15 +50,19 @@ struct ThreadResultData {
 
 using MetaEntries = std::vector<NsApplicationContentMetaStatus>;
 
-// starts background thread (ref counted).
+// starts background threads (ref counted).
 Result Init();
-// closes the background thread.
+// closes the background threads.
 void Exit();
 // clears cache and empties the result array.
 void Clear();
 
-// adds new entry to queue.
-void PushAsync(u64 app_id);
+// adds new entry to queue, or updates its key if already queued.
+// entries with the lowest key are loaded first, so pass the distance from the
+// selected entry whilst it's drawn, and push it again each frame until loaded.
+// entries not pushed again are loaded once all visible ones are done.
+void PushAsync(u64 app_id, s64 key);
+// queued behind any visible entries, in the order pushed.
 void PushAsync(const std::span<const NsApplicationRecord> app_ids);
 // gets entry without removing it from the queue.
 auto GetAsync(u64 app_id) -> ThreadResultData*;
@@ -68,7 +72,12 @@ auto Get(u64 app_id, bool* cached = nullptr) -> ThreadResultData*;
 auto GetNcmCs(u8 storage_id) -> NcmContentStorage&;
 auto GetNcmDb(u8 storage_id) -> NcmContentMetaDatabase&;
 
-// gets all meta entries for an id.
+// updates the meta cache from the application records, call this whenever
+// the records are listed. entries that changed are loaded again
+// and titles not in the list are never cached.
+void UpdateRecords(std::span<const NsApplicationRecord> records);
+
+// gets all meta entries for an id, from the cache if the record hasn't changed.
 Result GetMetaEntries(u64 id, MetaEntries& out, u32 flags = ContentFlag_All);
 
 // returns the nca path of a control nca.
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "fs.hpp"
+#include "threaded_file_transfer.hpp"
+#include <string>
+#include <switch.h>
+
+// learns which pipeline settings are the fastest for each pair of source and
+// destination (ie, sd -> usb), and uses the best known for new transfers.
+// the user's settings are always one of the candidates, so a route that hasn't
+// been measured yet behaves as before.
+// now and then another candidate is tried so that the speeds stay up to date.
+// the table is kept in the cache folder and updated after each large transfer.
+namespace sphaira::thread::tune {
+
+// returns a short name for the storage, ie, "sd", "native" or the mount name.
+auto GetKind(const fs::Fs* fs) -> std::string;
+// the route to set in PipelineConfig::tune_route.
+auto MakeRoute(const fs::Fs* src, const fs::Fs* dst) -> std::string;
+
+// fills in the settings for the route that weren't already set, returns the
+// index of the profile that was picked, to be passed to Record().
+auto Pick(const std::string& route, PipelineConfig& config) -> u32;
+// records the speed of a finished transfer, small transfers are ignored.
+void Record(const std::string& route, u32 profile, s64 size, u64 elapsed_ns);
+
+} // namespace sphaira::thread::tune
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "fs.hpp"
+#include <switch.h>
+#include <memory>
+
+// deletes files and folders in the background.
+// the entry is renamed into a trash dir at the root of its fs straight away,
+// so it's gone from the filebrowser, then a low priority thread deletes the
+// contents of the trash dir whilst the user carries on.
+// anything left in the sd card's trash dir is deleted on the next boot, other
+// trash dirs are emptied when something is next pushed to them.
+namespace sphaira::trash {
+
+// starts the thread and resumes deleting the sd card's trash dir.
+void Init();
+void ExitSignal();
+void Exit();
+
+// moves path into the trash dir of fs and queues it for deletion.
+// fails if path is the trash dir or is already inside of it.
+Result Push(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path, bool is_dir);
+
+// path of the trash dir used for fs.
+auto GetTrashPath(const fs::Fs* fs) -> fs::FsPath;
+
+} // namespace sphaira::trash
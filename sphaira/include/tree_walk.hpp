@@ -0,0 +1,95 @@
+#pragma once
+
+#include "fs.hpp"
+#include <atomic>
+#include <span>
+#include <vector>
+#include <switch.h>
+
+namespace sphaira::walk {
+
+// list of dir entries where the names are packed into a single buffer and
+// each entry only stores an offset into it, so an entry costs 16 bytes plus
+// the length of its name rather than the 0x310 of a FsDirectoryEntry.
+// walking a large sd card keeps every entry in memory, so this adds up.
+struct Entries {
+    struct Entry {
+        // valid until the list is modified.
+        const char* name;
+        s64 file_size;
+        FsDirEntryType type;
+    };
+
+    struct Iterator {
+        auto operator*() const -> Entry {
+            return (*entries)[index];
+        }
+
+        auto operator++() -> Iterator& {
+            index++;
+            return *this;
+        }
+
+        auto operator==(const Iterator&) const -> bool = default;
+
+        const Entries* entries;
+        size_t index;
+    };
+
+    void Add(const FsDirectoryEntry& e);
+    // replaces the list with the entries.
+    void Assign(std::span<const FsDirectoryEntry> entries);
+    void Reverse();
+
+    auto operator[](size_t index) const -> Entry {
+        const auto& e = m_entries[index];
+        return {m_names.data() + e.name_offset, e.file_size, (FsDirEntryType)e.type};
+    }
+
+    auto size() const -> size_t { return m_entries.size(); }
+    auto empty() const -> bool { return m_entries.empty(); }
+    auto begin() const -> Iterator { return {this, 0}; }
+    auto end() const -> Iterator { return {this, size()}; }
+
+private:
+    struct Packed {
+        u32 name_offset;
+        u32 type;
+        s64 file_size;
+    };
+
+    std::vector<Packed> m_entries{};
+    // null terminated names, back to back.
+    std::vector<char> m_names{};
+};
+
+// the files and dirs inside of a single dir.
+struct Collection {
+    fs::FsPath path{};
+    // path relative to where the walk started.
+    fs::FsPath parent_name{};
+    Entries files{};
+    Entries dirs{};
+};
+
+using Collections = std::vector<Collection>;
+
+struct Config {
+    // fetch the size of files, can be slow on some fs.
+    bool inc_size{};
+    // max number of dirs read at once, 0 picks a count for the fs.
+    u32 worker_count{};
+    // optional, the walk stops early once this is set.
+    const std::atomic_bool* stop{};
+};
+
+// number of dirs that can be read at once without slowing down the fs.
+auto GetWorkerCount(fs::Fs* fs) -> u32;
+
+// walks every dir under path, several dirs are read at once so that the
+// round trip of each read overlaps with the others (ie, network mounts).
+// a dir is always added to out before any of its sub dirs, so out can be
+// walked in order to create dirs and in reverse to delete them.
+Result Walk(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, Collections& out, const Config& config = {});
+
+} // namespace sphaira::walk
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ui/widget.hpp"
+#include "ui/list.hpp"
+#include "jobs.hpp"
+#include <vector>
+
+namespace sphaira::ui {
+
+// lists the background jobs with their progress and speed.
+class JobsBox final : public Widget {
+public:
+    JobsBox();
+
+    auto Update(Controller* controller, TouchInfo* touch) -> void override;
+    auto Draw(NVGcontext* vg, Theme* theme) -> void override;
+
+private:
+    void UpdateActions();
+
+private:
+    static constexpr Vec2 m_title_pos{70.f, 28.f};
+    static constexpr Vec4 m_block{280.f, 110.f, SCREEN_HEIGHT, 60.f};
+    static constexpr float m_text_xoffset{15.f};
+    static constexpr float m_line_width{1220.f};
+
+    std::vector<jobs::Info> m_info{};
+    s64 m_index{};
+
+    std::unique_ptr<List> m_list{};
+    float m_line_top{};
+    float m_line_bottom{};
+};
+
+} // namespace sphaira::ui
@@ -6,7 +6,11 @@
 #include "ui/list.hpp"
 #include "fs.hpp"
 #include "option.hpp"
+#include "download.hpp"
+#include "image_decode.hpp"
 #include <span>
+#include <string>
+#include <string_view>
 
 namespace sphaira::ui::menu::appstore {
 
@@ -33,6 +37,10 @@ struct LazyImage {
     bool cached{};
     ImageDownloadState state{ImageDownloadState::None};
     u8 first_pixel[4]{};
+    // used to re-prioritise the download whilst it's queued.
+    curl::RequestHandle request{};
+    // decode of the cached file.
+    image::RequestHandle decode{};
 };
 
 enum class EntryStatus {
@@ -42,24 +50,52 @@ enum class EntryStatus {
     Update,
 };
 
+// string in the repo index string pool, always null terminated.
+// the pool is owned by the menu, so this is only valid whilst it's loaded.
+struct PoolString {
+    PoolString() = default;
+    PoolString(const char* str, u32 len) : m_str{str}, m_len{len} {}
+
+    auto c_str() const -> const char* { return m_str; }
+    auto data() const -> const char* { return m_str; }
+    auto length() const -> size_t { return m_len; }
+    auto size() const -> size_t { return m_len; }
+    auto empty() const -> bool { return !m_len; }
+
+    operator std::string_view() const { return {m_str, m_len}; }
+    operator std::string() const { return {m_str, m_len}; }
+
+    auto operator==(const PoolString& rhs) const -> bool {
+        return std::string_view{*this} == std::string_view{rhs};
+    }
+
+    auto operator==(std::string_view rhs) const -> bool {
+        return std::string_view{*this} == rhs;
+    }
+
+private:
+    const char* m_str{""};
+    u32 m_len{};
+};
+
 struct Entry {
-    std::string category{}; // todo: lable
-    std::string binary{}; // optional, only valid for .nro
-    std::string updated{}; // date of update
-    std::string name{};
-    std::string license{}; // optional
-    std::string title{}; // same as name but with spaces
-    std::string url{}; // url of repo (optional?)
-    std::string description{};
-    std::string author{};
-    std::string changelog{}; // optional
+    PoolString category{}; // todo: lable
+    PoolString binary{}; // optional, only valid for .nro
+    PoolString updated{}; // date of update
+    PoolString name{};
+    PoolString license{}; // optional
+    PoolString title{}; // same as name but with spaces
+    PoolString url{}; // url of repo (optional?)
+    PoolString description{};
+    PoolString author{};
+    PoolString changelog{}; // optional
     u64 screens{}; // number of screenshots
     u64 extracted{}; // extracted size in KiB
-    std::string version{};
+    PoolString version{};
     u64 filesize{}; // compressed size in KiB
-    std::string details{};
+    PoolString details{};
     u64 app_dls{};
-    std::string md5{}; // md5 of the zip
+    PoolString md5{}; // md5 of the zip
 
     LazyImage image{};
     u32 updated_num{};
@@ -134,11 +170,13 @@ enum SortType {
     SortType_Downloads,
     SortType_Size,
     SortType_Alphabetical,
+    SortType_MAX,
 };
 
 enum OrderType {
     OrderType_Descending,
     OrderType_Ascending,
+    OrderType_MAX,
 };
 
 using LayoutType = grid::LayoutType;
@@ -168,6 +206,7 @@ struct Menu final : grid::Menu {
 
 private:
     void SetIndex(s64 index);
+    Result LoadIndex();
     void ScanHomebrew();
     void Sort();
     void SortAndFindLastFile();
@@ -178,6 +217,20 @@ private:
 private:
     static constexpr inline const char* INI_SECTION = "appstore";
 
+    // the repo index file, the entry strings point into it.
+    std::vector<u8> m_index_data{};
+    std::string m_index_etag{};
+    // position of each entry in the presorted index, per sort and order.
+    std::vector<u32> m_sort_rank[SortType_MAX][OrderType_MAX]{};
+    // set if the index was rebuilt whilst the menu didn't have focus.
+    bool m_index_changed{};
+    // sorted search words, and the string pool, both point into the index.
+    const void* m_search_tokens{};
+    u32 m_search_token_count{};
+    const char* m_search_pool{};
+    // score of each entry for the current search, higher is a better match.
+    std::vector<u32> m_search_score{};
+
     std::vector<Entry> m_entries{};
     std::vector<EntryMini> m_entries_index[Filter_MAX]{};
     std::vector<EntryMini> m_entries_index_author{};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ui/menus/menu_base.hpp"
+#include "ui/list.hpp"
+#include "ui/progress_box.hpp"
+#include "fs.hpp"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sphaira::ui::menu::bench {
+
+// runs a single sample of the test, setting the speed in MiB/s.
+using SampleFunc = std::function<Result(ProgressBox* pbox, double& speed)>;
+// called once all the samples have been run, ie, to delete test files.
+using CleanupFunc = std::function<void()>;
+
+struct Stats {
+    double min;
+    double median;
+    double max;
+    std::vector<double> samples;
+};
+
+// file picked by the user for the tests that need one, ie, the install test.
+struct PickedFile {
+    std::shared_ptr<fs::Fs> fs{};
+    fs::FsPath path{};
+};
+
+struct Entry {
+    std::string name{};
+    SampleFunc func{};
+    CleanupFunc cleanup{};
+    // unit of the speed set by the test.
+    std::string unit{"MiB/s"};
+    // if set, a file with one of these extensions is picked before the test is run.
+    std::vector<std::string> pick_filter{};
+    Stats stats{};
+    Result rc{};
+    bool has_result{};
+};
+
+struct Menu final : MenuBase {
+    Menu(u32 flags);
+    ~Menu();
+
+    auto GetShortTitle() const -> const char* override { return "Benchmarks"; };
+    void Update(Controller* controller, TouchInfo* touch) override;
+    void Draw(NVGcontext* vg, Theme* theme) override;
+    void OnFocusGained() override;
+
+private:
+    void SetIndex(s64 index);
+    // runs the entries, then saves all results to a json file.
+    void Run(std::vector<u32> indices);
+    // opens the file picker, the entry is run once a file is picked.
+    void PickFile(u32 index);
+    void UpdateSubheading();
+
+private:
+    std::vector<Entry> m_entries{};
+    std::shared_ptr<PickedFile> m_picked_file{std::make_shared<PickedFile>()};
+    // set once a file is picked, run after the picker has closed as only
+    // the top most widget can be popped.
+    std::optional<u32> m_pending_run{};
+    s64 m_index{};
+    std::unique_ptr<List> m_list{};
+};
+
+} // namespace sphaira::ui::menu::bench
@@ -5,15 +5,18 @@
 namespace sphaira::ui::menu::filebrowser::picker {
 
 using Callback = std::function<bool(const fs::FsPath& path)>;
+// same as above, but also given the fs the file is on, for files outside the sd card.
+using FsCallback = std::function<bool(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path)>;
 
 struct Menu final : Base {
     explicit Menu(const Callback& cb, const std::vector<std::string>& filter = {}, const fs::FsPath& path = {});
+    explicit Menu(const FsCallback& cb, const std::vector<std::string>& filter = {}, const fs::FsPath& path = {});
 
 private:
     void OnClick(FsView* view, const FsEntry& fs_entry, const FileEntry& entry, const fs::FsPath& path) override;
 
 private:
-    const Callback m_callback;
+    const FsCallback m_callback;
 };
 
 } // namespace sphaira::ui::menu::filebrowser::picker
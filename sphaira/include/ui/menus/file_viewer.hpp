@@ -1,11 +1,35 @@
 #pragma once
 
 #include "ui/menus/menu_base.hpp"
-#include "ui/scrollable_text.hpp"
+#include "yati/source/base.hpp"
 #include "fs.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace sphaira::ui::menu::fileview {
 
+// offsets of every Nth line in the file, built on a thread so that the file
+// can be shown straight away, no matter how large it is.
+struct LineIndex {
+    ~LineIndex();
+
+    fs::Fs* fs{};
+    fs::FsPath path{};
+    s64 file_size{};
+
+    Thread thread{};
+    Mutex mutex{};
+    // offset of each CHECKPOINT_LINES'th line, starting with line 0.
+    std::vector<s64> checkpoints{};
+    // lines found so far.
+    s64 line_count{};
+    std::atomic_bool stop{};
+    std::atomic_bool done{};
+    bool started{};
+};
+
 struct Menu final : MenuBase {
     Menu(fs::Fs* fs, const fs::FsPath& path);
 
@@ -14,17 +38,26 @@ struct Menu final : MenuBase {
     void Draw(NVGcontext* vg, Theme* theme) override;
     void OnFocusGained() override;
 
+private:
+    auto GetLineCount() -> s64;
+    void SetLine(s64 line);
+    // reads the visible lines, starting from the closest checkpoint.
+    Result LoadWindow();
+
 private:
     fs::Fs* const m_fs;
     const fs::FsPath m_path;
-    fs::File m_file{};
     s64 m_file_size{};
-    s64 m_file_offset{};
 
-    std::unique_ptr<ScrollableText> m_scroll_text{};
+    // only the visible lines are read, through a buffer.
+    std::shared_ptr<yati::source::Base> m_source{};
+    std::unique_ptr<LineIndex> m_line_index{};
 
-    s64 m_start{};
-    s64 m_index{}; // where i am in the array
+    // first visible line.
+    s64 m_line{};
+    // line that m_lines starts at, -1 if they need to be read.
+    s64 m_lines_start{-1};
+    std::vector<std::string> m_lines{};
 };
 
 } // namespace sphaira::ui::menu::fileview
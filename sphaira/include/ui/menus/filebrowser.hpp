@@ -7,8 +7,18 @@
 #include "fs.hpp"
 #include "option.hpp"
 #include "hasher.hpp"
+#include "tree_walk.hpp"
 #include "nro.hpp"
+#include "utils/arena.hpp"
 #include <span>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <memory_resource>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
 
 namespace sphaira::ui::menu::filebrowser {
 
@@ -172,12 +182,152 @@ struct FileEntry final : FsDirectoryEntry {
     }
 };
 
+// info that is only fetched for entries that are shown / highlighted.
+// allocated from the FileList arena, including the strings.
+struct FileEntryInfo {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    FileEntryInfo() = default;
+    explicit FileEntryInfo(const allocator_type& alloc)
+    : internal_name{alloc}, internal_extension{alloc} {}
+
+    FileEntryInfo(const FileEntryInfo& rhs, const allocator_type& alloc)
+    : internal_name{rhs.internal_name, alloc}
+    , internal_extension{rhs.internal_extension, alloc}
+    , file_count{rhs.file_count}
+    , dir_count{rhs.dir_count}
+    , time_stamp{rhs.time_stamp}
+    , checked_internal_extension{rhs.checked_internal_extension}
+    , done_stat{rhs.done_stat} {}
+
+    std::pmr::string internal_name{}; // if any
+    std::pmr::string internal_extension{}; // if any
+    s64 file_count{-1}; // number of files in a folder, non-recursive
+    s64 dir_count{-1}; // number folders in a folder, non-recursive
+    FsTimeStampRaw time_stamp{};
+    bool checked_internal_extension{}; // did we already search for an ext?
+    bool done_stat{}; // have we checked file_size / count.
+};
+
+// compact storage for the entries of a dir.
+// a FileEntry is over 1KiB due to the fixed size name, so instead the names
+// are stored back to back in a single arena and the fixed size fields in
+// separate arrays, which is ~20 bytes + the name length per entry.
+// FileEntryInfo is only stored for entries that have been looked at, these
+// are kept in an arena that's released in one go by Clear().
+// use Get() to create a FileEntry for a single entry, ie, for passing to ops.
+struct FileList {
+    void Clear();
+    void Reserve(u32 count);
+    void Add(const FsDirectoryEntry& e);
+    auto Get(u32 i) const -> FileEntry;
+
+    auto Size() const -> u32 {
+        return m_name_off.size();
+    }
+
+    auto IsEmpty() const -> bool {
+        return m_name_off.empty();
+    }
+
+    // hash of the names / types, used to check if a dir has changed.
+    auto GetHash() const -> u64 {
+        return m_hash;
+    }
+
+    auto GetName(u32 i) const -> const char* {
+        return m_names.data() + m_name_off[i];
+    }
+
+    auto GetExtension(u32 i) const -> std::string_view {
+        if (auto ext = std::strrchr(GetName(i), '.')) {
+            return ext + 1;
+        }
+        return {};
+    }
+
+    auto GetType(u32 i) const -> FsDirEntryType {
+        return (FsDirEntryType)m_type[i];
+    }
+
+    auto IsFile(u32 i) const -> bool {
+        return GetType(i) == FsDirEntryType_File;
+    }
+
+    auto IsDir(u32 i) const -> bool {
+        return !IsFile(i);
+    }
+
+    auto IsHidden(u32 i) const -> bool {
+        return GetName(i)[0] == '.';
+    }
+
+    auto GetFileSize(u32 i) const -> s64 {
+        return m_file_size[i];
+    }
+
+    auto GetFileSizeRef(u32 i) -> s64& {
+        return m_file_size[i];
+    }
+
+    auto IsSelected(u32 i) const -> bool {
+        return m_selected[i];
+    }
+
+    void SetSelected(u32 i, bool selected) {
+        m_selected[i] = selected;
+    }
+
+    void ClearSelection() {
+        std::ranges::fill(m_selected, false);
+    }
+
+    // creates the info if it doesn't yet exist.
+    auto GetInfo(u32 i) -> FileEntryInfo& {
+        return m_info.Get()[i];
+    }
+
+    auto FindInfo(u32 i) const -> const FileEntryInfo* {
+        if (auto info = m_info.Find()) {
+            if (auto it = info->find(i); it != info->end()) {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    std::vector<char> m_names{};
+    std::vector<u32> m_name_off{};
+    std::vector<s64> m_file_size{};
+    std::vector<u8> m_type{};
+    std::vector<u8> m_selected{};
+    utils::Arena<std::pmr::unordered_map<u32, FileEntryInfo>> m_info{};
+
+    // fnv-1a.
+    static constexpr u64 HASH_INIT = 0xCBF29CE484222325;
+    static constexpr u64 FNV_PRIME = 0x100000001B3;
+    u64 m_hash{HASH_INIT};
+};
+
+// sorted order of a previously sorted dir, so that walking back up to a
+// large dir doesn't need to sort it again.
+struct SortCacheEntry {
+    fs::FsPath path{};
+    // FileList::GetHash() when it was sorted.
+    u64 hash{};
+    // the sort options used.
+    u32 settings{};
+    std::vector<u32> order{};
+};
+
 struct FileAssocEntry {
     fs::FsPath path{}; // ini name
     std::string name{}; // ini name
     std::vector<std::string> ext{}; // list of ext
     std::vector<std::string> database{}; // list of systems
     bool use_base_name{}; // if set, uses base name (rom.zip) otherwise uses internal name (rom.gba)
+    u64 db_mask{}; // bit set for each matching rom database, set once loaded
 
     auto IsExtension(std::string_view extension, std::string_view internal_extension) const -> bool {
         for (const auto& assoc_ext : ext) {
@@ -199,16 +349,80 @@ struct LastFile {
     s64 entries_count{};
 };
 
-struct FsDirCollection {
+using FsDirCollection = walk::Collection;
+using FsDirCollections = walk::Collections;
+
+void SignalChange();
+
+// used when a dir has more entries than fit in the first batch.
+// the remaining entries are read on a thread and added to the view as they
+// arrive, so that large or slow (network) dirs can be shown straight away.
+struct ScanData {
+    ~ScanData();
+
+    fs::Dir dir{};
+    Thread thread{};
+    Mutex mutex{};
+    // entries read by the thread that haven't been added to the view yet.
+    std::vector<FsDirectoryEntry> pending{};
+    std::atomic_bool stop{};
+    std::atomic_bool done{};
+    // set before done.
+    Result rc{};
+    bool started{};
+};
+
+// calculates the size of a dir and everything inside it on a thread, so
+// that the dir can be left whilst it's still being calculated.
+struct DirSizeData {
+    ~DirSizeData();
+
+    std::shared_ptr<fs::Fs> fs{};
+    FsEntry fs_entry{};
     fs::FsPath path{};
-    fs::FsPath parent_name{};
-    std::vector<FsDirectoryEntry> files{};
-    std::vector<FsDirectoryEntry> dirs{};
+    Thread thread{};
+    std::atomic_bool stop{};
+    std::atomic_bool done{};
+    // set before done.
+    Result rc{};
+    s64 size{};
+    s64 file_count{};
+    s64 dir_count{};
+    bool started{};
 };
 
-using FsDirCollections = std::vector<FsDirCollection>;
+// files being deleted by the pool of workers in DeleteAllFiles().
+struct DeleteData {
+    fs::Fs* const fs;
+    const FsDirCollections& collections;
+    // index of the collection and the file within it.
+    std::vector<std::pair<u32, u32>> files{};
+    std::atomic<size_t> next_index{};
+    std::atomic<size_t> done_count{};
+    std::atomic<Result> result{};
+    std::atomic_bool stop{};
+    bool throttle{};
+};
 
-void SignalChange();
+struct DirSize {
+    FsEntry fs_entry{};
+    fs::FsPath path{};
+    s64 size{};
+    s64 file_count{};
+    s64 dir_count{};
+};
+
+// listing of a dir on a non native fs (ie, network mounts), so that going
+// back and forth between dirs doesn't need to read them again.
+struct ListingCacheEntry {
+    FsEntry fs_entry{};
+    fs::FsPath path{};
+    // modified time of the dir when it was read, if the fs reports it.
+    FsTimeStampRaw time_stamp{};
+    // when it was read, used instead if there's no timestamp.
+    u64 tick{};
+    FileList entries{};
+};
 
 struct Base;
 
@@ -239,6 +453,7 @@ struct FsView final : Widget {
     void SetSide(ViewSide side);
 
     static Result DeleteAllCollections(ProgressBox* pbox, fs::Fs* fs, const FsDirCollections& collections, u32 mode = FsDirOpenMode_ReadDirs|FsDirOpenMode_ReadFiles);
+    static Result DeleteAllFiles(ProgressBox* pbox, fs::Fs* fs, const FsDirCollections& collections);
     static auto get_collection(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, FsDirCollection& out, bool inc_file, bool inc_dir, bool inc_size) -> Result;
     static auto get_collections(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, FsDirCollections& out, bool inc_size = false) -> Result;
 
@@ -247,6 +462,7 @@ struct FsView final : Widget {
 
     void SetIndex(s64 index);
     void InstallForwarder();
+    void InstallForwarders();
 
     void InstallFiles();
     void UnzipFiles(fs::FsPath folder);
@@ -254,13 +470,28 @@ struct FsView final : Widget {
     void UploadFiles();
 
     auto Scan(fs::FsPath new_path, bool is_walk_up = false) -> Result;
+    void AddEntries(std::span<const FsDirectoryEntry> entries);
+    // adds entries from start to the (hidden) index lists.
+    void IndexEntries(u32 start);
+    void UpdateScan();
+    void StopScan();
+    // store is set if the listing was read from the fs, rather than the cache.
+    void OnScanDone(bool store = true);
+
+    auto IsScanning() const -> bool {
+        return m_scan != nullptr;
+    }
+
+    void CalculateDirSize(const fs::FsPath& path);
+    void UpdateDirSizes();
+    auto FindDirSize(const fs::FsPath& path) const -> const DirSize*;
 
     auto GetNewPath(const FileEntry& entry) const -> fs::FsPath {
         return GetNewPath(m_path, entry.name);
     }
 
     auto GetNewPath(s64 index) const -> fs::FsPath {
-        return GetNewPath(m_path, GetEntry(index).name);
+        return GetNewPath(m_path, GetEntryName(index));
     }
 
     auto GetNewPathCurrent() const -> fs::FsPath {
@@ -273,9 +504,9 @@ struct FsView final : Widget {
         if (!m_selected_count) {
             out.emplace_back(GetEntry());
         } else {
-            for (auto&e : m_entries) {
-                if (e.IsSelected()) {
-                    out.emplace_back(e);
+            for (u32 i = 0; i < m_entries.Size(); i++) {
+                if (m_entries.IsSelected(i)) {
+                    out.emplace_back(m_entries.Get(i));
                 }
             }
         }
@@ -283,22 +514,33 @@ struct FsView final : Widget {
         return out;
     }
 
-    auto GetEntry(u32 index) -> FileEntry& {
-        return m_entries[m_entries_current[index]];
+    // index into m_entries for the (sorted / filtered) index.
+    auto GetEntryIndex(u32 index) const -> u32 {
+        return m_entries_current[index];
     }
 
-    auto GetEntry(u32 index) const -> const FileEntry& {
-        return m_entries[m_entries_current[index]];
+    auto GetEntry(u32 index) const -> FileEntry {
+        return m_entries.Get(GetEntryIndex(index));
     }
 
-    auto GetEntry() -> FileEntry& {
+    auto GetEntry() const -> FileEntry {
         return GetEntry(m_index);
     }
 
-    auto GetEntry() const -> const FileEntry& {
-        return GetEntry(m_index);
+    auto GetEntryName(u32 index) const -> const char* {
+        return m_entries.GetName(GetEntryIndex(index));
+    }
+
+    auto GetEntryName() const -> const char* {
+        return GetEntryName(m_index);
+    }
+
+    auto IsEntrySelected(u32 index) const -> bool {
+        return m_entries.IsSelected(GetEntryIndex(index));
     }
 
+    void SetEntrySelected(u32 index, bool selected);
+
     auto IsSd() const -> bool {
         return m_fs_entry.IsSd();
     }
@@ -306,9 +548,13 @@ struct FsView final : Widget {
     void Sort();
     void SortAndFindLastFile(bool scan = false);
     void SetIndexFromLastFile(const LastFile& last_file);
+    // same as above, but waits until the scan has finished.
+    void SetIndexFromLastFileAfterScan(const LastFile& last_file);
 
     void OnDeleteCallback();
-    void OnPasteCallback();
+    void OnDeleteBackgroundCallback();
+    void OnPasteCallback(bool background = false, bool verify = false);
+    void OnSyncCallback();
     void OnRenameCallback();
     auto CheckIfUpdateFolder() -> Result;
 
@@ -322,9 +568,13 @@ struct FsView final : Widget {
     }
 
     void DisplayHash(hash::Type type);
+    void DisplayHash(std::span<const hash::Type> types);
+    void DisplayVerify(const fs::FsPath& manifest_path);
 
     void DisplayOptions();
     void DisplayAdvancedOptions();
+    void DisplaySearch();
+    void OpenPath(const fs::FsPath& path);
 
     using MountFsFunc = Result(*)(fs::Fs *fs, const fs::FsPath &path, fs::FsPath &out_path);
     // using MountFsFunc = std::function<Result(fs::Fs *fs, const fs::FsPath &path, fs::FsPath &out_path)>;
@@ -339,12 +589,22 @@ struct FsView final : Widget {
     std::shared_ptr<fs::Fs> m_fs{};
     FsEntry m_fs_entry{};
     fs::FsPath m_path{};
-    std::vector<FileEntry> m_entries{};
+    FileList m_entries{};
     std::vector<u32> m_entries_index{}; // files not including hidden
     std::vector<u32> m_entries_index_hidden{}; // includes hidden files
     std::vector<u32> m_entries_index_search{}; // files found via search
     std::span<u32> m_entries_current{};
 
+    // set whilst the dir is still being read in the background.
+    std::unique_ptr<ScanData> m_scan{};
+    // applied once the scan has finished.
+    std::optional<LastFile> m_scan_last_file{};
+    // most recently used first.
+    std::vector<SortCacheEntry> m_sort_cache{};
+    // dir sizes still being calculated, and the ones that have finished.
+    std::vector<std::unique_ptr<DirSizeData>> m_dir_size_jobs{};
+    std::vector<DirSize> m_dir_sizes{};
+
     std::unique_ptr<List> m_list{};
     std::optional<fs::FsPath> m_daybreak_path{};
 
@@ -435,6 +695,7 @@ protected:
 
     void LoadAssocEntriesPath(const fs::FsPath& path);
     void LoadAssocEntries();
+    void BuildAssocTable();
     auto FindFileAssocFor() -> std::vector<FileAssocEntry>;
 
     void AddSelectedEntries(SelectedType type) {
@@ -450,6 +711,11 @@ protected:
         m_selected.Reset();
     }
 
+    // returns the cached listing for the path, if it's still valid.
+    auto FindListing(const FsEntry& fs_entry, fs::Fs* fs, const fs::FsPath& path) -> const FileList*;
+    void StoreListing(const FsEntry& fs_entry, fs::Fs* fs, const fs::FsPath& path, const FileList& entries);
+    void InvalidateListingCache();
+
     void UpdateSubheading();
 
     void PromptIfShouldExit();
@@ -476,8 +742,13 @@ protected:
     std::unique_ptr<FsView> view_right{};
 
     std::vector<FileAssocEntry> m_assoc_entries{};
+    // hashed lowercase extension to the index of each assoc entry that supports it.
+    std::unordered_map<u32, std::vector<u32>> m_assoc_table{};
     SelectedStash m_selected{};
 
+    // most recently used first.
+    std::vector<ListingCacheEntry> m_listing_cache{};
+
     std::vector<std::string> m_filter{};
 
     // local copy of nro entries that is loaded in LoadAssocEntriesPath()
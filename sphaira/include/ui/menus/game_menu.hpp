@@ -7,6 +7,7 @@
 #include "yati/nx/keys.hpp"
 
 #include "title_info.hpp"
+#include "image_decode.hpp"
 #include "fs.hpp"
 #include "option.hpp"
 #include <memory>
@@ -18,8 +19,10 @@ namespace sphaira::ui::menu::game {
 struct Entry {
     u64 app_id{};
     u8 last_event{};
+    u64 last_updated{};
     NacpLanguageEntry lang{};
     int image{};
+    image::RequestHandle image_request{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
 
@@ -57,6 +60,10 @@ struct Menu final : grid::Menu {
 private:
     void SetIndex(s64 index);
     void ScanHomebrew();
+    // lists the next page of records, returns false once all have been listed.
+    bool ScanNextPage(s32 count);
+    // lists all the remaining records.
+    void FinishScan();
     void Sort();
     void SortAndFindLastFile(bool scan);
     void FreeEntries();
@@ -86,6 +93,7 @@ private:
     }
 
     void DeleteGames();
+    void VerifyGames();
     void ExportOptions(bool to_nsz);
     void DumpGames(u32 flags, bool to_nsz);
     void CreateSaves(AccountUid uid);
@@ -100,6 +108,9 @@ private:
     std::unique_ptr<List> m_list{};
     bool m_is_reversed{};
     bool m_dirty{};
+    // records are listed a page per frame after the first, see ScanNextPage().
+    s32 m_record_offset{};
+    bool m_scanning{};
 
     // use for detection game card removal to force a refresh.
     Event m_gc_event{};
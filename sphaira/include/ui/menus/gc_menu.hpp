@@ -180,7 +180,14 @@ struct GcCollection : yati::container::CollectionEntry {
     u8 id_offset{};
 };
 
-using GcCollections = std::vector<GcCollection>;
+struct GcCollections {
+    // taken from the cnmt header.
+    u64 title_id{};
+    u32 title_version{};
+    u8 meta_type{};
+    // the cnmt is always the first entry.
+    std::vector<GcCollection> collections{};
+};
 
 struct ApplicationEntry {
     u64 app_id{};
@@ -209,6 +216,8 @@ struct Menu final : MenuBase {
     void OnFocusGained() override;
 
     Result GcStorageRead(void* buf, s64 off, s64 size);
+    // read size used for the inserted card, set by the benchmark.
+    auto GcGetReadSize() const -> s64;
 
 private:
     Result GcPoll(bool* inserted);
@@ -228,6 +237,10 @@ private:
     // taken from nxdumptool.
     Result GcGetSecurityInfo(GameCardSecurityInformation& out);
 
+    void GcBenchmark();
+    // exports each title on the gamecard as its own nsp / nsz.
+    Result DumpNsp(bool to_nsz);
+
     Result LoadControlData(ApplicationEntry& e);
     Result UpdateStorageSize();
     void FreeImage();
@@ -268,6 +281,8 @@ private:
     // reported size via rom_size in the xci header.
     s64 m_storage_full_size{};
     // found in xci header.
+    u8 m_rom_size{};
+    // found in xci header.
     u64 m_package_id{};
     // found in xci header.
     u8 m_initial_data_hash[SHA256_HASH_SIZE]{};
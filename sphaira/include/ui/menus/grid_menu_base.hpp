@@ -19,6 +19,8 @@ struct Menu : MenuBase {
 
 protected:
     void OnLayoutChange(std::unique_ptr<List>& list, int layout);
+    // size the image is drawn at for the layout, used for the thumbnail cache.
+    static auto GetThumbSize(int layout) -> int;
     void DrawEntry(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, int image, const char* name, const char* author, const char* version);
     // same as above but doesn't draw image and returns image dimension.
     Vec4 DrawEntryNoImage(NVGcontext* vg, Theme* theme, int layout, const Vec4& v, bool selected, const char* name, const char* author, const char* version);
@@ -66,6 +66,7 @@ private:
     void FreeEntries();
     void OnLayoutChange();
     void DisplayOptions();
+    void LoadIcon(NroEntry& e, s64 pos);
 
     auto IsStarEnabled() -> bool {
         return m_sort.Get() >= SortType_UpdatedStar;
@@ -75,6 +76,8 @@ private:
 
 private:
     static constexpr inline const char* INI_SECTION = "homebrew";
+    // rows of icons loaded either side of the list.
+    static constexpr inline s64 ICON_PREFETCH_ROWS = 1;
 
     std::vector<NroEntry> m_entries{};
     std::vector<u32> m_entries_index[Filter_MAX]{};
@@ -19,9 +19,34 @@ struct Menu final : Widget {
 
     void UpdateSize();
 
+private:
+    // level 0 is the full image, each level after is half the size of the last.
+    struct Level {
+        std::vector<u8> data;
+        int w, h;
+    };
+
+    struct Tile {
+        int image;
+        u32 level;
+        u32 x, y;
+        u64 last_used;
+        // size of the texture in bytes.
+        u32 size;
+    };
+
+    auto GetLevelIndex() const -> u32;
+    auto GetLevel(u32 index) -> const Level*;
+    auto GetTile(u32 level, u32 x, u32 y) -> int;
+    void EvictTiles();
+
 private:
     const fs::FsPath m_path;
-    int m_image{};
+    // built on first use, so only the levels that are drawn are made.
+    std::vector<Level> m_levels{};
+    // textures are only made for the tiles that are on screen.
+    std::vector<Tile> m_tiles{};
+    u64 m_frame{};
     float m_image_width{};
     float m_image_height{};
 
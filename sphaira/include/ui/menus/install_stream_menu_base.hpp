@@ -2,6 +2,8 @@
 
 #include "ui/menus/menu_base.hpp"
 #include "yati/source/stream.hpp"
+#include "threaded_file_transfer.hpp"
+#include "utils/spsc_ring.hpp"
 
 namespace sphaira::ui::menu::stream {
 
@@ -22,6 +24,16 @@ using OnInstallStart = std::function<bool(const char* path)>;
 using OnInstallWrite = std::function<bool(const void* buf, size_t size)>;
 using OnInstallClose = std::function<void()>;
 
+struct StreamStats {
+    // data pushed by mtp / ftp, blocked is the time spent waiting for a free block.
+    thread::StageStats push{};
+    // data read by the install, blocked is the time spent waiting for data.
+    thread::StageStats read{};
+};
+
+// pushed data is moved through a fixed size ring without a lock, the mutex is
+// only used to block when the ring is empty / full.
+// shared by the mtp and ftp install modes.
 struct Stream final : yati::source::Stream {
     Stream(const fs::FsPath& path, std::stop_token token);
 
@@ -29,13 +41,27 @@ struct Stream final : yati::source::Stream {
     bool Push(const void* buf, s64 size);
     void Disable();
     auto& GetPath() const { return m_path; }
+    auto GetStats() -> StreamStats;
 
 private:
+    void WakePull();
+    void WakePush();
+
+private:
+    static constexpr size_t RING_SIZE = 1024 * 1024 * 4;
+
     fs::FsPath m_path{};
     std::stop_token m_token{};
-    std::vector<u8> m_buffer{};
+    utils::SpscRing m_ring;
     CondVar m_can_read{};
     CondVar m_can_write{};
+    // set whilst blocked waiting for data / space.
+    std::atomic<bool> m_pull_waiting{};
+    std::atomic<bool> m_push_waiting{};
+    // bytes are counted without the lock, the rest of the stats are locked.
+    std::atomic<s64> m_pushed{};
+    std::atomic<s64> m_read{};
+    StreamStats m_stats{};
 
 public:
     Mutex m_mutex{};
@@ -59,6 +85,8 @@ private:
     std::unique_ptr<Stream> m_source{};
     Thread m_thread{};
     Mutex m_mutex{};
+    // signalled when the state or install state changes.
+    CondVar m_state_changed{};
     State m_state{State::None};
 };
 
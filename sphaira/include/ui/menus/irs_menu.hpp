@@ -64,6 +64,9 @@ private:
     Rotation m_rotation{Rotation_90};
     Colour m_colour{Colour_Grey};
     int m_image{};
+    // size the image was created at, it's updated in place if it matches.
+    u32 m_image_width{};
+    u32 m_image_height{};
     s64 m_index{};
 };
 
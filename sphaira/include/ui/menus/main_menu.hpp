@@ -29,6 +29,8 @@ enum MiscMenuFlag : u8 {
 struct MiscMenuEntry {
     const char* name;
     const char* title;
+    // same as the menu's GetShortTitle().
+    const char* short_title;
     MiscMenuFunction func;
     u8 flag;
     const char* info;
@@ -59,13 +61,22 @@ struct MainMenu final : Widget {
     }
 
 private:
-    void OnLRPress(MenuBase* menu, Button b);
+    // created on first use.
+    struct TabMenu {
+        auto Get() -> MenuBase*;
+
+        const MiscMenuEntry* entry{};
+        std::unique_ptr<MenuBase> menu{};
+    };
+
+private:
+    void OnLRPress(TabMenu& menu, Button b);
     void AddOnLRPress();
 
 private:
     std::unique_ptr<MenuBase> m_centre_menu{};
-    std::unique_ptr<MenuBase> m_left_menu{};
-    std::unique_ptr<MenuBase> m_right_menu{};
+    TabMenu m_left_menu{};
+    TabMenu m_right_menu{};
     MenuBase* m_current_menu{};
 
     std::string m_update_url{};
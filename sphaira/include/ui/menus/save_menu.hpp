@@ -3,6 +3,7 @@
 #include "ui/menus/grid_menu_base.hpp"
 #include "ui/list.hpp"
 #include "title_info.hpp"
+#include "image_decode.hpp"
 #include "fs.hpp"
 #include "option.hpp"
 #include "dumper.hpp"
@@ -18,13 +19,21 @@ enum BackupFlag {
     BackupFlag_SetName = 1 << 0,
     // set if this is a auto backup (on restore).
     BackupFlag_IsAuto = 1 << 1,
+    // set if the backup is a manifest in the chunk store, rather than a zip.
+    BackupFlag_Incremental = 1 << 2,
 };
 
 struct Entry final : FsSaveDataInfo {
     NacpLanguageEntry lang{};
     int image{};
+    image::RequestHandle image_request{};
     bool selected{};
     title::NacpLoadStatus status{title::NacpLoadStatus::None};
+    // position returned by the reader, which is the most recently updated first.
+    u32 read_index{};
+    // space used by the save, -1 until known.
+    s64 used_size{-1};
+    bool size_pending{};
 
     auto GetName() const -> const char* {
         return lang.name;
@@ -37,6 +46,7 @@ struct Entry final : FsSaveDataInfo {
 
 enum SortType {
     SortType_Updated,
+    SortType_Size,
 };
 
 enum OrderType {
@@ -48,6 +58,8 @@ using LayoutType = grid::LayoutType;
 
 void SignalChange();
 
+struct SizeQueue;
+
 struct Menu final : grid::Menu {
     Menu(u32 flags);
     ~Menu();
@@ -60,6 +72,10 @@ struct Menu final : grid::Menu {
 private:
     void SetIndex(s64 index);
     void ScanHomebrew();
+    void ReadBatch();
+    void CloseReader();
+    void QueueSizes();
+    void UpdateSizes();
     void Sort();
     void SortAndFindLastFile(bool scan);
     void FreeEntries();
@@ -95,6 +111,8 @@ private:
 
     auto BuildSavePath(const Entry& e, u32 flags) const -> fs::FsPath;
     Result RestoreSaveInternal(ProgressBox* pbox, const Entry& e, const fs::FsPath& path);
+    Result RestoreSaveIncrementalInternal(ProgressBox* pbox, const Entry& e, const dump::DumpLocation& location, const fs::FsPath& path);
+    Result BackupSaveIncrementalInternal(ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& mount, const Entry& e, const fs::FsPath& path);
     Result BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& location, Entry& e, u32 flags);
     Result BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& location, std::span<const std::reference_wrapper<Entry>> entries, u32 flags);
 
@@ -107,9 +125,17 @@ private:
     s64 m_index{}; // where i am in the array
     s64 m_selected_count{};
     std::unique_ptr<List> m_list{};
-    bool m_is_reversed{};
     bool m_dirty{};
 
+    // the list is read a batch per frame, so that it shows up straight away.
+    FsSaveDataInfoReader m_reader{};
+    bool m_reader_open{};
+    TimeStamp m_scan_ts{};
+
+    // sizes are only fetched when sorting by size, as each save has to be mounted.
+    std::shared_ptr<SizeQueue> m_size_queue{};
+    s64 m_size_pending{};
+
     std::vector<AccountProfileBase> m_accounts{};
     s64 m_account_index{};
     u8 m_data_type{FsSaveDataType_Account};
@@ -119,6 +145,7 @@ private:
     option::OptionLong m_layout{INI_SECTION, "layout", LayoutType::LayoutType_Grid};
     option::OptionBool m_auto_backup_on_restore{INI_SECTION, "auto_backup_on_restore", true};
     option::OptionBool m_compress_save_backup{INI_SECTION, "compress_save_backup", true};
+    option::OptionBool m_incremental_save_backup{INI_SECTION, "incremental_save_backup", false};
 };
 
 } // namespace sphaira::ui::menu::save
@@ -12,6 +12,8 @@ enum class State {
     Connected_WaitForFileList,
     // just connected, starts the transfer.
     Connected_StartingTransfer,
+    // connected to a host in bench mode, waits for the benchmark to be started.
+    Connected_Bench,
     // set whilst transfer is in progress.
     Progress,
     // set when the transfer is finished.
@@ -30,6 +32,10 @@ struct Menu final : MenuBase {
 
     void ThreadFunction();
 
+private:
+    void DisplayBenchOptions();
+    void StartBench();
+
 private:
     std::unique_ptr<yati::source::Usb> m_usb_source{};
     bool m_was_mtp_enabled{};
@@ -37,6 +43,13 @@ private:
     Thread m_thread{};
     std::atomic<State> m_state{State::None};
     std::vector<std::string> m_names{};
+
+    bool m_bench_ready{};
+    // 0 is all, otherwise the index + 1.
+    s64 m_bench_mode_index{};
+    s64 m_bench_size_index{};
+    s64 m_bench_depth_index{};
+    std::vector<std::string> m_bench_results{};
 };
 
 } // namespace sphaira::ui::menu::usb
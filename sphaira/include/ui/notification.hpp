@@ -35,6 +35,7 @@ public:
     void Pop(NotifEntry::Side side);
     void Clear(NotifEntry::Side side);
     void Clear();
+    auto IsEmpty() -> bool;
 
 private:
     using Entries = std::deque<NotifEntry>;
@@ -9,6 +9,22 @@ namespace sphaira::ui::gfx {
 void drawImage(NVGcontext*, float x, float y, float w, float h, int texture, float rounded = 0.F, float alpha = 1.0F);
 void drawImage(NVGcontext*, const Vec4& v, int texture, float rounded = 0.F, float alpha = 1.0F);
 
+// icons shown in the grids are packed into a few large textures, so that
+// scrolling doesn't create and delete lots of small images, and a page of icons
+// only binds a couple of textures.
+// the returned id is drawn with drawImage() like any other image, and freed
+// with deleteImage(). once the atlas is full, the least recently drawn icon is
+// evicted, check isImageEvicted() and reload the icon if so.
+// size is the size of a slot, a normal image is returned if the icon doesn't
+// fit or the atlas is full. only call these from the main thread.
+auto createAtlasImage(NVGcontext*, int size, int w, int h, const u8* data) -> int;
+// frees both atlas and normal images.
+void deleteImage(NVGcontext*, int image);
+auto isImageEvicted(int image) -> bool;
+// uploads icons added since the last frame, call once per frame.
+void flushAtlas(NVGcontext*);
+void exitAtlas(NVGcontext*);
+
 void dimBackground(NVGcontext*);
 
 void drawRect(NVGcontext*, float x, float y, float w, float h, const NVGcolor& c, float rounding = 0.F);
@@ -33,6 +49,15 @@ void drawTextBox(NVGcontext*, float x, float y, float size, float bound, const N
 void textBounds(NVGcontext*, float x, float y, float *bounds, const char* str);
 void textBoundsArgs(NVGcontext*, float x, float y, float *bounds, const char* str, ...) __attribute__ ((format (printf, 5, 6)));
 
+// same as nvgTextBounds() at 0,0 but the result is cached, for text that's
+// measured every frame. sets the font size and align. returns the advance.
+auto textBoundsCached(NVGcontext*, float size, int align, const char* str, float* bounds) -> float;
+// same as above but for nvgTextBoxBounds(), also sets the line height.
+void textBoxBoundsCached(NVGcontext*, float size, int align, float line_height, float break_w, const char* str, float* bounds);
+// rasterises the common glyphs into the font atlas, so that the first time
+// a menu is opened doesn't stall on drawing its text. call once in a frame.
+void prewarmGlyphs(NVGcontext*);
+
 auto getButton(Button button) -> const char*;
 void drawScrollbar(NVGcontext*, const Theme*, u32 index_off, u32 count, u32 max_per_page);
 void drawScrollbar(NVGcontext*, const Theme*, float x, float y, float h, u32 index_off, u32 count, u32 max_per_page);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "nanovg.h"
+#include "ui/types.hpp"
+
+// draws the frame time histogram, phase timings, per menu draw cost and
+// counters from the transfer, download and image decode queues on top of
+// everything else. enabled in the advanced options.
+// heap usage per tag is also shown when built with ENABLE_MEM_TRACK.
+namespace sphaira::ui::profile {
+
+void Draw(NVGcontext* vg, Theme* theme);
+
+} // namespace sphaira::ui::profile
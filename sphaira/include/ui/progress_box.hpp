@@ -5,6 +5,7 @@
 #include "fs.hpp"
 #include <functional>
 #include <span>
+#include <atomic>
 
 namespace sphaira::ui {
 
@@ -28,9 +29,13 @@ struct ProgressBox final : Widget {
     auto SetActionName(const std::string& action) -> ProgressBox&;
     auto SetTitle(const std::string& title) -> ProgressBox&;
     auto NewTransfer(const std::string& transfer) -> ProgressBox&;
+    // same as above, but keeps the progress, used when a transfer spans multiple files.
+    auto SetTransferName(const std::string& transfer) -> ProgressBox&;
     // zeros the saved offset.
     auto ResetTranfser() -> ProgressBox&;
     auto UpdateTransfer(s64 offset, s64 size) -> ProgressBox&;
+    // sets the offset of each stage of a threaded transfer, used to show per-stage speed.
+    auto UpdateStageTransfer(s64 read, s64 decompress, s64 write) -> ProgressBox&;
     // not const in order to avoid copy by using std::swap
     auto SetImage(int image) -> ProgressBox&;
     auto SetImageData(std::vector<u8>& data) -> ProgressBox&;
@@ -40,11 +45,23 @@ struct ProgressBox final : Widget {
     auto ShouldExit() -> bool;
     auto ShouldExitResult() -> Result;
 
+    // blocks the worker in UpdateTransfer() / Yield() until resumed.
+    void SetPaused(bool paused);
+    auto IsPaused() const -> bool;
+
+    // used by jobs to show the progress of boxes that aren't pushed.
+    auto GetTitle(u32& seq, std::string& out) const -> bool;
+    auto GetTransferName(u32& seq, std::string& out) const -> bool;
+    void GetTransfer(s64& offset, s64& size) const;
+
     void AddCancelEvent(UEvent* event);
     void RemoveCancelEvent(const UEvent* event);
 
     // helper functions
-    auto CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, bool single_threaded = false) -> Result;
+    // set parallel_read if the src supports random access, this will read multiple chunks at once.
+    // native sources always read in parallel.
+    // set verify to hash the src as it's written, then read back the dst and compare.
+    auto CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, bool single_threaded = false, bool parallel_read = false, bool verify = false) -> Result;
     auto CopyFile(fs::Fs* fs, const fs::FsPath& src, const fs::FsPath& dst, bool single_threaded = false) -> Result;
     auto CopyFile(const fs::FsPath& src, const fs::FsPath& dst, bool single_threaded = false) -> Result;
     void Yield();
@@ -72,6 +89,7 @@ struct ProgressBox final : Widget {
 
 private:
     void FreeImage();
+    void WaitWhilePaused();
 
 public:
     struct ThreadData {
@@ -88,25 +106,58 @@ private:
     ProgressBoxDoneCallback m_done{};
     std::vector<UEvent*> m_cancel_events{};
 
+    // strings set by the worker and read every frame by the ui.
+    // writers are serialised by m_mutex, the ui never takes the lock, it
+    // instead retries on the next frame if it raced with a writer.
+    struct SharedString {
+        void Set(const std::string& str);
+        // returns true and updates out if the string changed since seq.
+        bool Get(u32& seq, std::string& out) const;
+
+    private:
+        std::atomic<u32> m_seq{};
+        char m_buf[FS_MAX_PATH]{};
+    };
+
     // shared data start.
-    std::string m_action{};
-    std::string m_title{};
-    std::string m_transfer{};
-    s64 m_size{};
-    s64 m_offset{};
-    s64 m_last_offset{};
-    s64 m_speed{};
-    TimeStamp m_timestamp{};
+    SharedString m_action{};
+    SharedString m_title{};
+    SharedString m_transfer{};
+    std::atomic<s64> m_size{};
+    std::atomic<s64> m_offset{};
+    // read, decompress, write.
+    std::atomic<s64> m_stage_offset[3]{};
+    std::atomic_bool m_has_stage{};
+    std::atomic_bool m_paused{};
+    // bumped on each new transfer, so that the ui resets the speed.
+    std::atomic<u32> m_transfer_gen{};
     std::vector<u8> m_image_data{};
     int m_image_pending{};
     bool m_is_image_pending{};
     // shared data end.
 
+    // ui only.
+    std::string m_ui_action{};
+    std::string m_ui_title{};
+    std::string m_ui_transfer{};
+    u32 m_ui_action_seq{};
+    u32 m_ui_title_seq{};
+    u32 m_ui_transfer_seq{};
+    u32 m_ui_transfer_gen{};
+    s64 m_last_offset{};
+    // smoothed bytes per second.
+    s64 m_speed{};
+    s64 m_stage_last_offset[3]{};
+    s64 m_stage_speed[3]{};
+    TimeStamp m_timestamp{};
+
     ScrollingText m_scroll_title{};
     ScrollingText m_scroll_transfer{};
 
     int m_image{};
     bool m_own_image{};
+    // set if boost mode was enabled for the lifetime of the box.
+    bool m_boost{};
 };
 
 // this is a helper function that does many things.
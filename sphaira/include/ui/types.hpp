@@ -2,6 +2,7 @@
 
 #include "nanovg.h"
 #include "fs.hpp"
+#include "utils/audio.hpp"
 
 #include <switch.h>
 #include <string>
@@ -229,6 +230,8 @@ struct Theme {
     ThemeMeta meta;
     ElementEntry elements[ThemeEntryID_MAX];
     fs::FsPath music_path;
+    // wav files that replace the qlaunch sound effects, empty if not set.
+    fs::FsPath sound_paths[std::to_underlying(audio::SoundEffect::MAX)];
 
     auto GetColour(ThemeEntryID id) const {
         return elements[id].colour;
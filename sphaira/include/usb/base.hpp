@@ -8,6 +8,10 @@
 namespace sphaira::usb {
 
 struct Base {
+    // number of transfers TransferStream() keeps in flight.
+    static constexpr u32 STREAM_QUEUE_DEPTH = 4;
+    static constexpr u32 STREAM_QUEUE_DEPTH_MAX = 8;
+
     Base(u64 transfer_timeout);
     virtual ~Base();
 
@@ -29,6 +33,17 @@ struct Base {
         return TransferAll(read, data, size, m_transfer_timeout);
     }
 
+    // same as TransferAll(), but splits the data into chunks and keeps several
+    // transfers in flight, so the controller doesn't idle between each one.
+    // use for bulk data, small packets should use TransferAll().
+    Result TransferStream(bool read, void *data, u32 size, u64 timeout, u32 queue_depth = STREAM_QUEUE_DEPTH);
+    Result TransferStream(bool read, void *data, u32 size) {
+        return TransferStream(read, data, size, m_transfer_timeout);
+    }
+
+    // max size of each transfer in flight, anything smaller isn't split up.
+    static auto GetStreamSlotSize(u32 queue_depth) -> u32;
+
     // returns the cancel event.
     auto GetCancelEvent() {
         return &m_uevent;
@@ -54,6 +69,16 @@ protected:
     virtual Result TransferAsync(UsbSessionEndpoint ep, void *buffer, u32 remaining, u32 size, u32 *out_xfer_id) = 0;
     virtual Result GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_requested_size, u32 *out_transferred_size) = 0;
 
+    struct TransferReport {
+        u32 xfer_id;
+        u32 transferred_size;
+        Result rc;
+    };
+
+    // appends a report for every finished transfer and clears the completion event.
+    // a transfer may be reported more than once, the caller ignores ids it isn't waiting on.
+    virtual Result GetTransferReports(UsbSessionEndpoint ep, std::vector<TransferReport>& out) = 0;
+
 private:
     u64 m_transfer_timeout{};
     UEvent m_uevent{};
@@ -14,6 +14,12 @@ enum : u32 {
     CMD_QUIT = 0,
     CMD_OPEN = 1,
     CMD_EXPORT = 1,
+    // CAP_BENCH, SendPacket::BuildBench().
+    CMD_BENCH = 2,
+    // CAP_SESSION, see below.
+    CMD_EXPORT_OPEN = 3,
+    CMD_EXPORT_DATA = 4,
+    CMD_EXPORT_CLOSE = 5,
 };
 
 enum : u32 {
@@ -26,6 +32,37 @@ enum : u32 {
     FLAG_STREAM = 1 << 0,
 };
 
+// capabilities sent by the switch in the first packet (arg4 for export, arg3
+// for install), the host replies with the ones it supports in arg4.
+// an old host replies with 0, so both sides fallback to the original protocol.
+enum : u32 {
+    CAP_NONE = 0,
+    // install: a data request asks for a number of chunks (SendDataPacket::arg5),
+    // which the host sends back to back, each with its own ResultPacket header.
+    // export: the data follows the header straight away and is acked once.
+    CAP_STREAM = 1 << 0,
+    // install: the host may zstd compress a chunk, ResultPacket::arg5 is then
+    // the decompressed size and arg3 the compressed size.
+    CAP_ZSTD = 1 << 1,
+    // install: the host accepts CMD_BENCH, it only sets this when started in
+    // bench mode, in which case the file list is empty.
+    CAP_BENCH = 1 << 2,
+    // export: the file opened by CMD_EXPORT is file id 0 of a session. other
+    // files are opened with CMD_EXPORT_OPEN(id, path length) followed by the path,
+    // written with CMD_EXPORT_DATA(id, size, crc32c) followed by the data, and
+    // closed with CMD_EXPORT_CLOSE(id). the host doesn't reply to any of these,
+    // the result for the whole session is the reply to CMD_QUIT.
+    CAP_SESSION = 1 << 3,
+};
+
+// CMD_BENCH, the host replies and then sends (download) or reads (upload)
+// count transfers of size bytes. the data is not checked or stored.
+// once an upload has been read, the host replies again.
+enum : u32 {
+    BENCH_DOWNLOAD = 0,
+    BENCH_UPLOAD = 1,
+};
+
 struct UsbPacket {
     u32 magic{};
     u32 arg2{};
@@ -51,12 +88,16 @@ protected:
 };
 
 struct SendPacket : UsbPacket {
-    static SendPacket Build(u32 cmd, u32 arg3 = 0, u32 arg4 = 0) {
-        SendPacket packet{MAGIC, cmd, arg3, arg4};
+    static SendPacket Build(u32 cmd, u32 arg3 = 0, u32 arg4 = 0, u32 arg5 = 0) {
+        SendPacket packet{MAGIC, cmd, arg3, arg4, arg5};
         packet.GenerateCrc32c();
         return packet;
     }
 
+    static SendPacket BuildBench(u32 mode, u32 size, u32 count) {
+        return Build(CMD_BENCH, mode, size, count);
+    }
+
     Result Verify() const {
         return UsbPacket::Verify();
     }
@@ -73,6 +114,11 @@ struct ResultPacket : UsbPacket {
         return packet;
     }
 
+    // CAP_ZSTD, 0 if the data isn't compressed.
+    u32 GetDecompressedSize() const {
+        return arg5;
+    }
+
     Result Verify() const {
         R_TRY(UsbPacket::Verify());
         R_UNLESS(arg2 == RESULT_OK, 1); // todo: create error code.
@@ -87,6 +133,11 @@ struct SendDataPacket : UsbPacket {
         return packet;
     }
 
+    // CAP_STREAM, requests count chunks of size starting at off.
+    static SendDataPacket BuildStream(u64 off, u32 size, u32 count) {
+        return Build(off, size, count);
+    }
+
     Result Verify() const {
         return UsbPacket::Verify();
     }
@@ -19,10 +19,19 @@ struct Usb {
 
     // waits for connection and then sends file list.
     Result IsUsbConnected(u64 timeout);
-    Result WaitForConnection(std::string_view path, u64 timeout);
+    // if session is set, CAP_SESSION is asked for, check IsSession() to see if
+    // the host supports it.
+    Result WaitForConnection(std::string_view path, u64 timeout, bool session = false);
 
-    // Result OpenFile(u32 index, s64& file_size);
+    // CAP_SESSION, opens the next file without a handshake.
+    Result OpenFile(std::string_view path);
     Result CloseFile();
+    // CAP_SESSION, ends the session and returns the result of every file.
+    Result EndSession();
+
+    bool IsSession() const {
+        return m_caps & api::CAP_SESSION;
+    }
 
     auto GetOpenResult() const {
         return m_open_result;
@@ -40,6 +49,12 @@ private:
     std::unique_ptr<usb::UsbDs> m_usb{};
     Result m_open_result{};
     bool m_was_connected{};
+    // negotiated api::CAP_* flags.
+    u32 m_caps{};
+
+    // CAP_SESSION, id and write offset of the open file.
+    u32 m_file_id{};
+    u64 m_file_off{};
 };
 
-} // namespace sphaira::usb::dumpl
+} // namespace sphaira::usb::dump
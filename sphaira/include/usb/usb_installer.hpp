@@ -2,6 +2,7 @@
 
 #include "usb/usbds.hpp"
 #include "usb/usb_api.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <string>
 #include <vector>
@@ -10,6 +11,13 @@
 
 namespace sphaira::usb::install {
 
+struct BenchResult {
+    // time taken by each transfer.
+    std::vector<u64> latency_ns;
+    // time from the first transfer until the host has all of the data.
+    u64 total_ns;
+};
+
 struct Usb {
     Usb(u64 transfer_timeout);
     ~Usb();
@@ -25,6 +33,14 @@ struct Usb {
     Result OpenFile(u32 index, s64& file_size);
     Result CloseFile();
 
+    // CAP_BENCH, times count transfers of size bytes to (upload) or from
+    // (download) the host using api::BENCH_*, nothing is read or written to storage.
+    Result Bench(u32 mode, u32 size, u32 count, u32 queue_depth, BenchResult& out);
+
+    u32 GetCaps() const {
+        return m_caps;
+    }
+
     auto GetOpenResult() const {
         return m_open_result;
     }
@@ -37,11 +53,29 @@ private:
     Result SendAndVerify(const void* data, u32 size, u64 timeout, api::ResultPacket* out = nullptr);
     Result SendAndVerify(const void* data, u32 size, api::ResultPacket* out = nullptr);
 
+    // CAP_STREAM, reads from the chunks that the host sends after a request.
+    Result ReadStream(void* buf, u64 off, u32 size, u64* bytes_read);
+    // receives the next chunk header and its data.
+    Result ReceiveChunk(void* buf, u32 size, u64* bytes_read);
+    // receives and discards the chunks still on their way, needed before
+    // sending any new request.
+    Result DrainStream();
+
 private:
     std::unique_ptr<usb::UsbDs> m_usb{};
     Result m_open_result{};
     bool m_was_connected{};
     u32 m_flags{};
+    // negotiated api::CAP_* flags.
+    u32 m_caps{};
+    s64 m_file_size{};
+
+    // offset and size of the next chunk the host will send.
+    u64 m_stream_off{};
+    u32 m_stream_size{};
+    u32 m_stream_pending{};
+    // compressed chunks / drained chunks are received into this.
+    utils::pool::Vector<u8> m_chunk_buf{};
 };
 
 } // namespace sphaira::usb::install
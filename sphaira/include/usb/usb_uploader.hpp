@@ -1,6 +1,7 @@
 #pragma once
 
 #include "usb/usbhs.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <string>
 #include <memory>
@@ -40,9 +41,35 @@ struct Usb {
 private:
     Result SendResult(u32 result, u32 arg3 = 0, u32 arg4 = 0);
 
+    // reads the chunk after the one being sent on a thread, as the pc asks for
+    // the file in order, so that the read and send overlap.
+    Result StartPrefetch(u64 off, u32 size);
+    // returns true and swaps buf if the prefetched chunk matches off / size.
+    bool TakePrefetch(u64 off, u32 size, u32& crc32);
+    void WaitForPrefetch();
+    static void prefetch_thread_func(void* arg);
+
 private:
     std::unique_ptr<usb::UsbHs> m_usb{};
-    std::vector<u8> m_buf{};
+    utils::pool::Vector<u8> m_buf{};
+    s64 m_file_size{};
+
+    struct Prefetch {
+        Thread thread{};
+        Mutex mutex{};
+        CondVar can_read{};
+        CondVar can_take{};
+        utils::pool::Vector<u8> buf{};
+        u64 off{};
+        u32 size{};
+        u32 crc32{};
+        Result rc{};
+        bool pending{};
+        bool valid{};
+        bool exit{};
+        bool running{};
+    } m_prefetch{};
+
     Result m_open_result{};
     bool m_was_connected{};
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+
+namespace sphaira::utils {
+
+// owns a pmr container (or anything built from a memory_resource) along with
+// the monotonic arena that it allocates from.
+// meant for data that's built up during a scan and freed in one go when the
+// menu rescans or closes, allocations just bump a pointer and frees are
+// no-ops, so there's no churn or fragmentation on the heap.
+// the value lives next to the arena on the heap, so moving doesn't leave
+// the value pointing at the old arena. copying copies the value into a new
+// arena.
+template<typename T, std::size_t InitialSize = 1024 * 16>
+struct Arena {
+    Arena() = default;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    Arena(const Arena& rhs) {
+        *this = rhs;
+    }
+
+    Arena& operator=(const Arena& rhs) {
+        if (this != &rhs) {
+            Release();
+            if (rhs.m_data) {
+                Get() = rhs.m_data->value;
+            }
+        }
+        return *this;
+    }
+
+    // creates the arena on first use.
+    auto Get() -> T& {
+        if (!m_data) {
+            m_data = std::make_unique<Data>();
+        }
+        return m_data->value;
+    }
+
+    // nullptr if nothing has been allocated yet.
+    auto Find() const -> const T* {
+        return m_data ? &m_data->value : nullptr;
+    }
+
+    // frees everything in the arena at once.
+    void Release() {
+        m_data.reset();
+    }
+
+private:
+    struct Data {
+        std::pmr::monotonic_buffer_resource resource{InitialSize};
+        T value{&resource};
+    };
+
+    std::unique_ptr<Data> m_data{};
+};
+
+} // namespace sphaira::utils
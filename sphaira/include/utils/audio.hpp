@@ -4,6 +4,7 @@
 #include "image.hpp"
 #include <string>
 #include <memory>
+#include <span>
 
 namespace sphaira::audio {
 
@@ -58,6 +59,12 @@ void Exit();
 
 Result PlaySoundEffect(SoundEffect effect);
 
+// decodes the sound effects into memory, indexed by SoundEffect, each one
+// replaces the qlaunch sound. empty paths keep the qlaunch sound.
+// only wav is supported.
+Result LoadSoundBank(fs::Fs* fs, std::span<const fs::FsPath> paths);
+void CloseSoundBank();
+
 Result OpenSong(fs::Fs* fs, const fs::FsPath& path, u32 flags, SongID* id);
 Result CloseSong(SongID* id);
 
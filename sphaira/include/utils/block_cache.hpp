@@ -0,0 +1,44 @@
+#pragma once
+
+#include <switch.h>
+#include <vector>
+#include <cstddef>
+
+// process-wide cache of blocks read from devoptab mount sources.
+// every mount shares the one memory budget, so opening several mounts doesn't
+// multiply memory use and a busy mount can use the space of idle ones.
+// blocks are evicted in lru order across all sources, however a source is
+// never evicted below a small reserve unless it's the one asking for space.
+namespace sphaira::utils::block_cache {
+
+struct Stats {
+    // max amount of memory used by cached blocks.
+    u64 budget;
+    // memory currently used by cached blocks.
+    u64 used;
+    // reads that were served from the cache.
+    u64 hits;
+    // reads that needed to read from the source.
+    u64 misses;
+};
+
+// registers a new source, the name is only used for logging.
+auto Register(const char* name) -> u32;
+// removes all blocks of the source and logs its stats.
+void Unregister(u32 id);
+
+// copies from the cached block at block_off into buf, returns false if not cached.
+// block_off must be aligned to block_size, off is the offset within the block.
+bool Read(u32 id, u64 block_off, u64 block_size, void* buf, u64 off, u64 size, u64* bytes_read);
+// adds a block to the cache, evicting the oldest blocks if over budget.
+// data may be smaller than block_size if this is the last block of the source.
+void Insert(u32 id, u64 block_off, u64 block_size, std::vector<u8>&& data);
+
+// sets the max amount of memory used, evicts blocks if needed.
+void SetBudget(u64 budget);
+
+auto GetStats() -> Stats;
+auto GetStats(u32 id) -> Stats;
+void LogStats(const char* tag);
+
+} // namespace sphaira::utils::block_cache
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <switch.h>
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+
+// process-wide pool of large transfer buffers.
+// blocks are rounded up to a power of 2 size class (64KiB - 16MiB) and kept
+// on a free list when released, up to a fixed budget of cached memory.
+// this avoids each transfer allocating (and faulting in) its own set of
+// multi-MiB buffers, which fragments the heap over time.
+namespace sphaira::utils::pool {
+
+struct Stats {
+    // max amount of memory that can be cached in the free lists.
+    u64 budget;
+    // memory currently leased out (rounded to size class).
+    u64 leased;
+    // memory currently sitting in the free lists.
+    u64 cached;
+    // highest value of leased since boot / last reset.
+    u64 high_water;
+    // leases that were served from the free list.
+    u64 hits;
+    // leases that needed a new allocation.
+    u64 misses;
+};
+
+void* Allocate(std::size_t size);
+void Free(void* ptr, std::size_t size);
+
+// sets the max amount of memory kept cached, trims the cache if needed.
+void SetBudget(u64 budget);
+// frees all cached blocks.
+void Trim();
+
+auto GetStats() -> Stats;
+void ResetHighWater();
+void LogStats(const char* tag);
+
+// stateless allocator so that vectors using the pool can still be swapped
+// between threads / ring buffers.
+template<typename T>
+struct Allocator {
+    using value_type = T;
+
+    Allocator() noexcept = default;
+    template<typename U>
+    Allocator(const Allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        auto ptr = static_cast<T*>(Allocate(n * sizeof(T)));
+        if (!ptr) {
+            std::abort();
+        }
+        return ptr;
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        Free(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const Allocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+template<typename T = u8>
+using Vector = std::vector<T, Allocator<T>>;
+
+} // namespace sphaira::utils::pool
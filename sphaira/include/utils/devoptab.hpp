@@ -18,6 +18,8 @@ Result MountNca(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path);
 Result MountNcaNcm(NcmContentStorage* cs, const NcmContentId* id, fs::FsPath& out_path);
 Result MountBfsar(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path);
 Result MountNro(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path);
+// mounts a read cache over the usbdvd mount point.
+Result MountUsbDvd(const fs::FsPath& root, fs::FsPath& out_path);
 
 Result MountVfsAll();
 Result MountWebdavAll();
@@ -34,6 +36,11 @@ Result GetNetworkDevices(location::StdioEntries& out);
 void UmountAllNeworkDevices();
 void UmountNeworkDevice(const fs::FsPath& mount);
 
+// copies the file on the server if both paths are on the same network mount.
+// returns Result_DevoptabServerCopyNotSupported if the mount can't do this,
+// in which case the file should be copied normally.
+Result ServerCopyFile(const fs::FsPath& src, const fs::FsPath& dst);
+
 // manually set the array so that we can avoid nullptr access.
 // SEE: https://github.com/devkitPro/newlib/issues/35
 void FixDkpBug();
@@ -1,13 +1,20 @@
 #pragma once
 
 #include "yati/source/file.hpp"
-#include "utils/lru.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/spsc_ring.hpp"
+#include "utils/devoptab_path.hpp"
 #include "location.hpp"
 #include <memory>
+#include <atomic>
 #include <optional>
 #include <span>
 #include <functional>
 #include <unordered_map>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
 #include <curl/curl.h>
 
 namespace sphaira::devoptab::common {
@@ -45,60 +52,105 @@ struct BufferedData : BufferedDataBase {
 private:
     u64 m_off{};
     u64 m_size{};
-    std::vector<u8> m_data{};
+    utils::pool::Vector<u8> m_data{};
 };
 
-struct BufferedFileData {
-    u8* data{};
-    u64 off{};
-    u64 size{};
+// same as BufferedData, but once reads are sequential the next chunk is
+// fetched on a background thread whilst the current chunk is being read.
+// the read ahead size doubles each time the fetched data is used, up to max.
+// useful for streaming, such as audio or media files from network mounts.
+struct ReadAheadBufferedData : BufferedDataBase {
+    ReadAheadBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, u64 _alloc = 1024 * 512, u64 _max = 1024 * 1024 * 4);
+    ~ReadAheadBufferedData();
 
-    ~BufferedFileData() {
-        if (data) {
-            free(data);
-        }
-    }
+    virtual Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
 
-    void Allocate(u64 new_size) {
-        data = (u8*)realloc(data, new_size * sizeof(*data));
-        off = 0;
-        size = 0;
-    }
+private:
+    // must be called with the lock held.
+    void StartFetch(u64 off);
+    void FetchThread();
+    static void FetchThreadFunc(void* arg);
+
+private:
+    const u64 m_alloc;
+    const u64 m_window_max;
+    u64 m_window;
+
+    u64 m_off{};
+    u64 m_size{};
+    utils::pool::Vector<u8> m_data{};
+
+    // protects the fetch state below.
+    Mutex m_mutex{};
+    // signalled when a fetch is requested, or on exit.
+    CondVar m_can_fetch{};
+    // signalled when a fetch has finished.
+    CondVar m_can_read{};
+
+    // only accessed by the fetch thread whilst busy.
+    utils::pool::Vector<u8> m_fetch_data{};
+    u64 m_fetch_off{};
+    u64 m_fetch_size{};
+    Result m_fetch_rc{};
+    bool m_fetch_busy{};
+
+    Thread m_thread{};
+    bool m_thread_created{};
+    bool m_exit{};
 };
 
 constexpr u64 CACHE_LARGE_ALLOC_SIZE = 1024 * 512;
 constexpr u64 CACHE_LARGE_SIZE = 1024 * 16;
 
+// caches reads in the block cache shared by all mounts, see utils/block_cache.hpp.
+// small reads are cached in 16k blocks and large reads in 512k blocks.
 struct LruBufferedData : BufferedDataBase {
-    LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, u32 small = 1024, u32 large = 2)
-    : BufferedDataBase{_source, _size} {
-        buffered_small.resize(small);
-        buffered_large.resize(large);
-        lru_cache[0].Init(buffered_small);
-        lru_cache[1].Init(buffered_large);
-    }
+    LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, const char* name = "devoptab");
+    ~LruBufferedData();
 
     virtual Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
 
 private:
-    utils::Lru<BufferedFileData> lru_cache[2]{};
-    std::vector<BufferedFileData> buffered_small{}; // 1MiB (usually).
-    std::vector<BufferedFileData> buffered_large{}; // 1MiB
+    const u32 m_cache_id;
 };
 
-bool fix_path(const char* str, char* out, bool strip_leading_slash = false);
+// same as LruBufferedData, but once reads are sequential the next blocks are
+// read into the cache on a worker whilst the caller is using the current one.
+// reads are serialised, so the source doesn't need to be thread safe.
+struct PrefetchCachedData final : yati::source::Base {
+    // prefetch_blocks is the number of 512k blocks read ahead of the caller.
+    PrefetchCachedData(const std::shared_ptr<yati::source::Base>& source, u64 size, const char* name, u32 prefetch_blocks = 1);
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+
+private:
+    struct State;
+    void Prefetch(u64 end);
+
+private:
+    std::shared_ptr<State> m_state;
+    const u32 m_prefetch_blocks;
+    // only accessed by the caller, which is already locked by the device.
+    s64 m_last_end{-1};
+    u64 m_prefetch_end{};
+};
 
 void update_devoptab_for_read_only(devoptab_t* devoptab, bool read_only);
 
 struct PushPullThreadData {
-    static constexpr size_t MAX_BUFFER_SIZE = 1024 * 64; // 64KB max buffer
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 512;
+    // curl may write upto this much in a single callback.
+    static constexpr size_t MIN_BUFFER_SIZE = 1024 * 64;
 
-    explicit PushPullThreadData(CURL* _curl);
+    explicit PushPullThreadData(CURL* _curl, size_t buffer_size = DEFAULT_BUFFER_SIZE);
     virtual ~PushPullThreadData();
 
     Result CreateAndStart();
     void Cancel();
     bool IsRunning();
+    // ends the data and waits for curl to finish sending it.
+    // returns false if the transfer failed.
+    bool Finish();
 
     // only set curl=true if called from a curl callback.
     size_t PullData(char* data, size_t total_size, bool curl = false);
@@ -108,17 +160,24 @@ struct PushPullThreadData {
 
 private:
     static void thread_func(void* arg);
+    void WakePull();
+    void WakePush();
 
 public:
     CURL* const curl{};
-    std::vector<char> buffer{};
+    // data is moved through the ring without a lock, the mutex is only
+    // used to block when the ring is empty / full.
+    utils::SpscRing ring;
     Mutex mutex{};
     CondVar can_push{};
     CondVar can_pull{};
+    // set whilst blocked waiting for data / space.
+    std::atomic<bool> pull_waiting{};
+    std::atomic<bool> push_waiting{};
 
     long code{};
-    bool error{};
-    bool finished{};
+    std::atomic<bool> error{};
+    std::atomic<bool> finished{};
     bool started{};
 
 private:
@@ -133,16 +192,86 @@ struct MountConfig {
     std::string dump_path{};
     long port{};
     long timeout{};
+    // ms to wait for the host to accept the connection, 0 for the default.
+    long connect_timeout{};
     bool read_only{};
     bool no_stat_file{true};
     bool no_stat_dir{true};
     bool fs_hidden{};
     bool dump_hidden{};
+    // seconds that stat results and dir listings are cached for, 0 to disable.
+    long cache_ttl{};
+    // size of the buffer used for file transfers, 0 for the default.
+    long buffer_size{};
+    // size of the buffer used for buffered stdio opens (ie, zips), 0 for the default.
+    long stdio_buffer_size{};
 
     std::unordered_map<std::string, std::string> extra{};
+
+    // falls back to timeout if set, so that an unreachable host fails quickly.
+    auto GetConnectTimeout() const -> long {
+        if (connect_timeout > 0) {
+            return connect_timeout;
+        }
+        if (timeout > 0) {
+            return timeout;
+        }
+        return DEFAULT_CONNECT_TIMEOUT_MS;
+    }
+
+    static constexpr long DEFAULT_CONNECT_TIMEOUT_MS = 3000;
 };
 using MountConfigs = std::vector<MountConfig>;
 
+// caches lstat results and dir listings so that repeated calls for the same
+// path don't need to go over the network.
+// dir listings also fill the stat cache for each entry.
+// paths are the fixed path, entries are removed on local changes.
+struct MetadataCache {
+    struct DirEntry {
+        std::string name{};
+        struct stat st{};
+    };
+    using DirEntries = std::vector<DirEntry>;
+
+    explicit MetadataCache(long ttl_seconds);
+
+    auto IsEnabled() const -> bool {
+        return m_ttl_ns;
+    }
+
+    // returns true if cached, ret is the result of the lstat call.
+    bool GetStat(const std::string& path, struct stat* st, int& ret);
+    void SetStat(const std::string& path, const struct stat* st, int ret);
+
+    bool GetDir(const std::string& path, DirEntries& out);
+    void SetDir(const std::string& path, DirEntries&& entries);
+
+    // removes the path, its parent listing and anything inside it.
+    void Invalidate(const std::string& path);
+    void Clear();
+
+private:
+    struct StatEntry {
+        struct stat st{};
+        int ret{};
+        u64 tick{};
+    };
+
+    struct DirListing {
+        DirEntries entries{};
+        u64 tick{};
+    };
+
+    auto IsExpired(u64 tick) const -> bool;
+
+private:
+    const u64 m_ttl_ns;
+    // ordered so that everything inside a dir can be found.
+    std::map<std::string, StatEntry> m_stats{};
+    std::map<std::string, DirListing> m_dirs{};
+};
+
 struct PullThreadData final : PushPullThreadData {
     using PushPullThreadData::PushPullThreadData;
     static size_t pull_thread_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
@@ -154,7 +283,7 @@ struct PushThreadData final : PushPullThreadData {
 };
 
 struct MountDevice {
-    MountDevice(const MountConfig& _config) : config{_config} {}
+    MountDevice(const MountConfig& _config) : config{_config}, metadata_cache{_config.cache_ttl} {}
     virtual ~MountDevice() = default;
 
     virtual bool fix_path(const char* str, char* out, bool strip_leading_slash = false) {
@@ -162,6 +291,13 @@ struct MountDevice {
     }
 
     virtual bool Mount() = 0;
+    // return false if multiple files cannot be read from at the same time.
+    virtual bool IsRandomAccessSafe() const { return true; }
+    // size of the buffer for buffered stdio opens, as every call to the device
+    // is a round trip. 0 uses the libc default.
+    virtual u32 GetStdioBufferSize() const {
+        return config.stdio_buffer_size > 0 ? config.stdio_buffer_size : DEFAULT_STDIO_BUFFER_SIZE;
+    }
     virtual int devoptab_open(void *fileStruct, const char *path, int flags, int mode) { return -EIO; }
     virtual int devoptab_close(void *fd) { return -EIO; }
     virtual ssize_t devoptab_read(void *fd, char *ptr, size_t len) { return -EIO; }
@@ -181,8 +317,15 @@ struct MountDevice {
     virtual int devoptab_statvfs(const char *_path, struct statvfs *buf) { return -EIO; }
     virtual int devoptab_fsync(void *fd) { return -EIO; }
     virtual int devoptab_utimes(const char *_path, const struct timeval times[2]) { return -EIO; }
+    // optional, copies a file without the data going through the switch.
+    // both paths are on this device.
+    virtual int devoptab_copy(const char *src, const char *dst) { return -ENOTSUP; }
+
+    static constexpr u32 DEFAULT_STDIO_BUFFER_SIZE = 1024 * 256;
 
     const MountConfig config;
+    // used by the devoptab wrapper, protected by the device lock.
+    MetadataCache metadata_cache;
 };
 
 struct MountCurlDevice : MountDevice {
@@ -193,19 +336,32 @@ struct MountCurlDevice : MountDevice {
     PullThreadData* CreatePullData(CURL* curl, const std::string& url, bool append = false);
 
     virtual bool Mount();
+    // each open file streams a single transfer, so seeking restarts it.
+    virtual bool IsRandomAccessSafe() const override { return false; }
     virtual void curl_set_common_options(CURL* curl,  const std::string& url);
     static size_t write_memory_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
     static size_t write_data_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
     static size_t read_data_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
-    static std::string html_decode(const std::string_view& str);
-    static std::string url_decode(const std::string& str);
+    static std::string html_decode(const std::string_view& str) {
+        return common::html_decode(str);
+    }
+    static std::string url_decode(const std::string& str) {
+        return common::url_decode(str);
+    }
     std::string build_url(const std::string& path, bool is_dir);
 
+    // handles are leased per open file, so that transfers run alongside each
+    // other and alongside listings on curl.
+    // idle handles are kept so that their connections stay alive via the share.
+    CURL* acquire_handle();
+    void release_handle(CURL* handle);
+
 protected:
+    // used for listings / stat / commands, transfers lease their own handle.
     CURL* curl{};
-    CURL* transfer_curl{};
 
 private:
+    std::vector<CURL*> m_handle_pool{};
     // path extracted from the url.
     std::string m_url_path{};
     CURLU* curlu{};
@@ -217,6 +373,10 @@ private:
 void LoadConfigsFromIni(const fs::FsPath& path, MountConfigs& out_configs);
 
 using CreateDeviceCallback = std::function<std::unique_ptr<MountDevice>(const MountConfig& config)>;
+// mounts the configs in /config/sphaira/mount/name.ini.
+// each mount is connected on a background worker, and is listed by
+// GetNetworkDevices() once the connect has been tried. mounts that failed to
+// connect are tried again on first access.
 Result MountNetworkDevice(const CreateDeviceCallback& create_device, size_t file_size, size_t dir_size, const char* name, bool force_read_only = false);
 
 // same as above but takes in the device and expects the mount name to be set.
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// path and name helpers used by the devoptab mounts.
+// these don't depend on libnx or newlib, so they're also built for the host
+// benchmarks, see tools/host_bench.
+namespace sphaira::devoptab::common {
+
+// strips the mount name and fixes up the slashes of a devoptab path.
+// returns false if there's no mount name.
+bool fix_path(const char* str, char* out, bool strip_leading_slash = false);
+
+// decodes html entities, ie, &amp; to &.
+std::string html_decode(const std::string_view& str);
+// url decodes, then html decodes str.
+std::string url_decode(const std::string& str);
+
+} // namespace sphaira::devoptab::common
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "yati/source/base.hpp"
+#include "utils/path_index.hpp"
 #include <memory>
 #include <span>
 #include <vector>
@@ -14,6 +15,9 @@ struct RomfsCollection {
     std::vector<u8> dir_table;
     std::vector<u8> file_table;
     u64 offset;
+    // maps "dir/name" (no leading slash) to the offset in the dir / file table.
+    utils::PathIndex dir_index;
+    utils::PathIndex file_index;
 };
 
 struct FileEntry {
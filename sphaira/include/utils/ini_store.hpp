@@ -0,0 +1,89 @@
+#pragma once
+
+#include <switch.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+namespace sphaira::utils::ini {
+
+// in-memory copy of an ini file, loaded once on first use.
+// sets only update the copy and mark it dirty, so any number of changes are
+// written in a single Flush(), rather than minIni rewriting the file on each put.
+// the file is written to path.tmp and then renamed over the old one, so a crash
+// mid-write always leaves a complete file behind.
+// section and key names are case-insensitive, same as minIni.
+// the lines of the file are kept as is, so comments, blank lines and the
+// order survive a write, only the lines of keys that were set are rewritten.
+struct Store {
+    // return false to stop browsing.
+    // the store is locked during the callback, so it must not call back into it.
+    using BrowseCallback = std::function<bool(const char* section, const char* key, const char* value)>;
+
+    Store(const char* path);
+
+    // returns false if the key doesn't exist.
+    bool Get(std::string_view section, std::string_view key, std::string& out);
+    auto GetString(std::string_view section, std::string_view key, std::string_view def) -> std::string;
+    auto GetLong(std::string_view section, std::string_view key, long def) -> long;
+    auto GetBool(std::string_view section, std::string_view key, bool def) -> bool;
+    bool Has(std::string_view section, std::string_view key);
+
+    void Set(std::string_view section, std::string_view key, std::string_view value);
+    void SetLong(std::string_view section, std::string_view key, long value);
+
+    // calls cb for every key in file order.
+    void Browse(const BrowseCallback& cb);
+
+    // true if there are changes that haven't been written.
+    bool IsDirty();
+    // true if dirty and nothing has been set for idle_ns, used to coalesce writes.
+    bool IsDirtyAndIdle(u64 idle_ns);
+    // writes the file if dirty, on failure it stays dirty so it's tried again.
+    Result Flush();
+
+private:
+    // lines of the file from a section header up to the next one, the first
+    // chunk is the lines before any section and has no header.
+    struct Chunk {
+        std::vector<std::string> lines;
+        // new keys are inserted here, after the last key of the chunk.
+        u32 insert_pos;
+    };
+
+    struct Key {
+        std::string name;
+        std::string value;
+        // where the key is in the file.
+        u32 chunk;
+        u32 line;
+    };
+
+    struct Section {
+        std::string name;
+        std::vector<Key> keys;
+        // chunk that new keys are added to.
+        u32 chunk;
+    };
+
+    void LoadInternal();
+    void Parse(std::string_view data);
+    auto FindSection(std::string_view section) -> Section*;
+    auto FindKey(std::string_view section, std::string_view key) -> Key*;
+    auto Serialise() const -> std::string;
+    Result Write(const std::string& data);
+
+private:
+    const std::string m_path;
+    Mutex m_mutex{};
+    // only one flush writes at a time, without holding m_mutex during the write.
+    Mutex m_flush_mutex{};
+    std::vector<Section> m_sections{};
+    std::vector<Chunk> m_chunks{};
+    u64 m_last_set_tick{};
+    bool m_loaded{};
+    bool m_dirty{};
+};
+
+} // namespace sphaira::utils::ini
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <span>
+#include <unordered_map>
+#include <cstdint>
 
 namespace sphaira::utils {
 
@@ -20,6 +22,9 @@ struct Lru {
     void Init(std::span<T> data) {
         list_flat_array.clear();
         list_flat_array.resize(data.size());
+        index.clear();
+        index_keys.clear();
+        index_keys.resize(data.size());
 
         auto list_entry = list_head = list_flat_array.data();
 
@@ -59,18 +64,53 @@ struct Lru {
     }
 
     // moves last entry (tail) to the front of the list.
+    // the entry is removed from the index as it's about to be reused.
     auto GetNextFree() {
+        Unindex(list_tail);
         Update(list_tail);
         return list_head->data;
     }
 
+    // optional index so that lookups don't need to walk the list.
+    // an entry can be indexed by many keys, if a key is already used then
+    // it will point to the new entry.
+    void Index(std::uint64_t key, ListEntry* entry) {
+        auto& old = index[key];
+        if (old == entry) {
+            return;
+        }
+
+        old = entry;
+        index_keys[entry - list_flat_array.data()].emplace_back(key);
+    }
+
+    auto Find(std::uint64_t key) const -> ListEntry* {
+        const auto it = index.find(key);
+        return it == index.end() ? nullptr : it->second;
+    }
+
     auto begin() const { return list_head; }
     auto end() const { return list_tail; }
 
+private:
+    void Unindex(ListEntry* entry) {
+        auto& keys = index_keys[entry - list_flat_array.data()];
+        for (const auto key : keys) {
+            // the key may have been taken by a newer entry.
+            if (const auto it = index.find(key); it != index.end() && it->second == entry) {
+                index.erase(it);
+            }
+        }
+        keys.clear();
+    }
+
 private:
     ListEntry* list_head{};
     ListEntry* list_tail{};
     std::vector<ListEntry> list_flat_array{};
+    std::unordered_map<std::uint64_t, ListEntry*> index{};
+    // keys for each entry in list_flat_array, used to remove them on reuse.
+    std::vector<std::vector<std::uint64_t>> index_keys{};
 };
 
 } // namespace sphaira::utils
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <switch.h>
+
+namespace sphaira::utils {
+
+// md5 that works on the input in place, rather than copying each block,
+// with the rounds unrolled at compile time.
+// sha1 / sha256 / crc32 don't need this as the libnx versions already use
+// the armv8 crypto / crc32 instructions.
+struct Md5 {
+    static constexpr u32 HASH_SIZE = 16;
+
+    void Update(const void* data, u64 size);
+    void GetHash(u8 out[HASH_SIZE]);
+
+private:
+    void ProcessBlocks(const u8* data, u64 count);
+
+private:
+    u32 m_state[4]{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    u64 m_size{};
+    u8 m_buf[64]{};
+    u32 m_buf_size{};
+};
+
+} // namespace sphaira::utils
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <switch.h>
+#include <cstdlib>
+#include <cstring>
+#include "defines.hpp"
+
+// optional per subsystem heap accounting, enabled with ENABLE_MEM_TRACK.
+// allocations made through operator new are charged to the tag set for the
+// calling thread (see SCOPED_MEM_TAG), c libraries that allow custom
+// allocators (curl, zstd) use Malloc() / Free() with their own tag.
+// memory that is allocated elsewhere, ie, pooled buffers, is added manually.
+// when compiled out, everything here is a no-op and operator new is untouched.
+namespace sphaira::utils::mem {
+
+enum Tag {
+    // anything not allocated within a tagged scope.
+    Tag_Other,
+    // transfer threads, ring buffers and pooled buffers.
+    Tag_Transfer,
+    // block cache and ncz lru.
+    Tag_Cache,
+    // decoded images and textures.
+    Tag_Image,
+    Tag_Curl,
+    Tag_Zstd,
+    Tag_MAX,
+};
+
+struct Stats {
+    s64 current;
+    // highest value of current since boot.
+    s64 peak;
+    u64 allocs;
+    u64 failed;
+};
+
+#ifdef ENABLE_MEM_TRACK
+
+constexpr bool IsEnabled = true;
+
+void Add(Tag tag, u64 size);
+void Remove(Tag tag, u64 size);
+
+// tag that operator new charges on the calling thread.
+auto GetTag() -> Tag;
+void SetTag(Tag tag);
+
+auto GetName(Tag tag) -> const char*;
+auto GetStats(Tag tag) -> Stats;
+// logs the usage of each tag along with the heap usage.
+// this is called automatically when an allocation fails.
+void LogStats(const char* reason);
+
+// the size is stored before the returned pointer, so memory from these must
+// only be freed with Free().
+void* Malloc(Tag tag, std::size_t size);
+void* Calloc(Tag tag, std::size_t count, std::size_t size);
+void* Realloc(Tag tag, void* ptr, std::size_t size);
+char* Strdup(Tag tag, const char* str);
+void Free(void* ptr);
+
+struct ScopedTag final {
+    ScopedTag(Tag tag) : m_old{GetTag()} {
+        SetTag(tag);
+    }
+
+    ~ScopedTag() {
+        SetTag(m_old);
+    }
+
+private:
+    const Tag m_old;
+};
+
+#define SCOPED_MEM_TAG(tag) sphaira::utils::mem::ScopedTag ANONYMOUS_VARIABLE(SCOPED_MEM_TAG_STATE_){tag}
+
+#else
+
+constexpr bool IsEnabled = false;
+
+inline void Add(Tag tag, u64 size) {}
+inline void Remove(Tag tag, u64 size) {}
+inline auto GetTag() -> Tag { return Tag_Other; }
+inline void SetTag(Tag tag) {}
+inline auto GetName(Tag tag) -> const char* { return ""; }
+inline auto GetStats(Tag tag) -> Stats { return {}; }
+inline void LogStats(const char* reason) {}
+
+inline void* Malloc(Tag tag, std::size_t size) { return std::malloc(size); }
+inline void* Calloc(Tag tag, std::size_t count, std::size_t size) { return std::calloc(count, size); }
+inline void* Realloc(Tag tag, void* ptr, std::size_t size) { return std::realloc(ptr, size); }
+inline char* Strdup(Tag tag, const char* str) { return strdup(str); }
+inline void Free(void* ptr) { std::free(ptr); }
+
+#define SCOPED_MEM_TAG(tag)
+
+#endif // ENABLE_MEM_TRACK
+
+} // namespace sphaira::utils::mem
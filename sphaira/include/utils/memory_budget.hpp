@@ -0,0 +1,38 @@
+#pragma once
+
+#include <switch.h>
+
+// splits the heap between the subsystems that keep large buffers around.
+// the heap in applet mode is a fraction of the size it is in application
+// mode, so rather than each subsystem using a fixed size, they ask for their
+// share of the heap, which is capped at the size they'd use normally.
+namespace sphaira::utils::budget {
+
+enum Subsystem {
+    // transfer ring buffers (read + write queues).
+    Subsystem_Transfer,
+    // free blocks cached by utils::pool.
+    Subsystem_BufferPool,
+    // devoptab read cache, see utils::block_cache.
+    Subsystem_BlockCache,
+    // ncz block lru used when reading ncz.
+    Subsystem_Ncz,
+    // blocks in flight when compressing to nsz.
+    Subsystem_NszCompress,
+    Subsystem_MAX,
+};
+
+// reads the heap size, must be called before Get().
+void Init();
+
+// size of the heap, not how much of it is free.
+auto GetHeapSize() -> u64;
+
+// max amount of memory the subsystem should use.
+auto Get(Subsystem subsystem) -> u64;
+
+// halves the preferred size until count buffers fit in the budget,
+// the returned size is never smaller than min.
+auto FitBufferSize(Subsystem subsystem, u64 preferred, u32 count, u64 min) -> u64;
+
+} // namespace sphaira::utils::budget
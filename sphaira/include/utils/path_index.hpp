@@ -0,0 +1,50 @@
+#pragma once
+
+#include <switch.h>
+#include <vector>
+#include <string_view>
+
+namespace sphaira::utils {
+
+// flat hash table that maps a path to a u32 value, used by the read only
+// devoptabs so that open / stat don't need to walk the file tree.
+// uses open addressing with linear probing, and all paths are copied into
+// a single arena, so a table of 10k+ paths is only a few allocations.
+struct PathIndex {
+    // reserves space for count paths, avoids rehashing while building.
+    void Reserve(u32 count, u32 arena_size = 0);
+    // returns false if the path already exists, in which case the value is not updated.
+    bool Add(std::string_view path, u32 value);
+    // returns false if the path isn't found.
+    bool Find(std::string_view path, u32& out) const;
+    void Clear();
+
+    auto Size() const -> u32 {
+        return m_count;
+    }
+
+    auto IsEmpty() const -> bool {
+        return !m_count;
+    }
+
+private:
+    struct Slot {
+        u32 hash;
+        u32 path_off;
+        u32 path_len;
+        u32 value;
+    };
+
+    static auto Hash(std::string_view path) -> u32;
+    auto IsMatch(const Slot& slot, std::string_view path, u32 hash) const -> bool;
+    void Grow(u32 capacity);
+    auto FindSlot(std::string_view path, u32 hash) const -> const Slot*;
+
+private:
+    std::vector<char> m_arena{};
+    // size is always a power of 2, a path_off of ~0 marks an empty slot.
+    std::vector<Slot> m_slots{};
+    u32 m_count{};
+};
+
+} // namespace sphaira::utils
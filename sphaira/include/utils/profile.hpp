@@ -2,6 +2,8 @@
 
 #include "ui/types.hpp"
 #include "log.hpp"
+#include <string>
+#include <vector>
 
 namespace sphaira::utils {
 
@@ -25,4 +27,63 @@ private:
 
 #define SCOPED_TIMESTAMP(name) sphaira::utils::ScopedTimestampProfile ANONYMOUS_VARIABLE(SCOPE_PROFILE_STATE_){name};
 
+// timings shown by the profiler overlay, only call from the main thread
+// unless stated otherwise.
+namespace profile {
+
+enum Phase {
+    Phase_Events,
+    Phase_Poll,
+    Phase_Update,
+    Phase_Draw,
+    Phase_MAX,
+};
+
+// number of frames kept for the frame time histogram.
+constexpr u32 FRAME_HISTORY = 120;
+
+struct MenuTime {
+    std::string name;
+    u64 ns;
+};
+
+struct Snapshot {
+    // oldest first.
+    u64 frame_ns[FRAME_HISTORY];
+    // averaged over the last few frames.
+    u64 phase_ns[Phase_MAX];
+    // draw cost of each widget drawn in the last frame.
+    std::vector<MenuTime> menus;
+    // bytes per second reported by transfers.
+    u64 transfer_speed;
+    // time from launch until the first frame was drawn.
+    u64 startup_ns;
+};
+
+void SetPhase(Phase phase, u64 ns);
+void AddMenuDraw(const char* name, u64 ns);
+// call once per loop, after the frame has been drawn or skipped.
+void EndFrame(u64 frame_ns);
+// this is thread safe.
+void AddTransferBytes(s64 bytes);
+// true if a transfer reported progress within the last second, this is thread safe.
+bool IsTransferActive();
+void SetStartupTime(u64 ns);
+void GetSnapshot(Snapshot& out);
+
+struct ScopedPhase final {
+    ScopedPhase(Phase phase) : m_phase{phase}, m_start{armGetSystemTick()} {}
+    ~ScopedPhase() {
+        SetPhase(m_phase, armTicksToNs(armGetSystemTick() - m_start));
+    }
+
+private:
+    const Phase m_phase;
+    const u64 m_start;
+};
+
+#define SCOPED_PROFILE_PHASE(phase) sphaira::utils::profile::ScopedPhase ANONYMOUS_VARIABLE(SCOPE_PROFILE_PHASE_){phase};
+
+} // namespace profile
+
 } // namespace sphaira::utils
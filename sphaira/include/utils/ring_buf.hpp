@@ -0,0 +1,85 @@
+#pragma once
+
+#include "utils/buffer_pool.hpp"
+#include <switch.h>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace sphaira::utils {
+
+// ring of pooled buffers queued between the threads of thread::Transfer().
+// the capacity can change at runtime, storage is allocated for the max slot
+// count and the limit caps how many are in use.
+// not thread safe, the caller holds the lock of the queue.
+struct RingBuf {
+public:
+    using Buffer = pool::Vector<u8>;
+
+private:
+    struct Slot {
+        Buffer buf;
+        s64 off;
+    };
+
+    std::vector<Slot> buf;
+    unsigned r_index{};
+    unsigned w_index{};
+    unsigned count{};
+    unsigned limit{};
+
+public:
+    RingBuf(unsigned _limit, unsigned max) : buf(std::max(_limit, max)), limit{_limit} {
+    }
+
+    void ringbuf_reset() {
+        this->r_index = this->w_index;
+        this->count = 0;
+    }
+
+    unsigned ringbuf_capacity() const {
+        return this->limit;
+    }
+
+    unsigned ringbuf_max_capacity() const {
+        return this->buf.size();
+    }
+
+    void ringbuf_set_capacity(unsigned _limit) {
+        this->limit = std::clamp<unsigned>(_limit, 1, ringbuf_max_capacity());
+    }
+
+    unsigned ringbuf_size() const {
+        return this->count;
+    }
+
+    unsigned ringbuf_free() const {
+        return this->count >= this->limit ? 0 : this->limit - this->count;
+    }
+
+    void ringbuf_push(Buffer& buf_in, s64 off_in) {
+        auto& value = this->buf[this->w_index];
+        value.off = off_in;
+        std::swap(value.buf, buf_in);
+
+        this->w_index = (this->w_index + 1U) % ringbuf_max_capacity();
+        this->count++;
+    }
+
+    void ringbuf_pop(Buffer& buf_out, s64& off_out) {
+        auto& value = this->buf[this->r_index];
+        off_out = value.off;
+        std::swap(value.buf, buf_out);
+
+        // if the ring was shrunk, release the memory of the slot we swapped into
+        // rather than keeping it around until the transfer finishes.
+        if (this->count > this->limit) {
+            Buffer{}.swap(value.buf);
+        }
+
+        this->r_index = (this->r_index + 1U) % ringbuf_max_capacity();
+        this->count--;
+    }
+};
+
+} // namespace sphaira::utils
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "utils/buffer_pool.hpp"
+#include <switch.h>
+#include <atomic>
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <cstring>
+
+namespace sphaira::utils {
+
+// single producer / single consumer byte ring buffer.
+// Write() is only called from the producer thread and Peek() / Consume() / Read()
+// from the consumer thread, so no lock is needed to move data.
+struct SpscRing {
+    // size is rounded up to a power of 2.
+    explicit SpscRing(size_t size) {
+        m_data.resize(std::bit_ceil(std::max<size_t>(size, 1)));
+        m_mask = m_data.size() - 1;
+    }
+
+    auto Capacity() const -> size_t {
+        return m_data.size();
+    }
+
+    // amount of data that can be read.
+    auto Size() const -> size_t {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    // amount of data that can be written.
+    auto Space() const -> size_t {
+        return Capacity() - Size();
+    }
+
+    auto IsEmpty() const -> bool {
+        return !Size();
+    }
+
+    // returns as much data as can be read without wrapping, call Consume() once done.
+    auto Peek() const -> std::span<const u8> {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        const auto size = m_tail.load(std::memory_order_acquire) - head;
+        const auto off = head & m_mask;
+        return {m_data.data() + off, std::min(size, Capacity() - off)};
+    }
+
+    void Consume(size_t size) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + size, std::memory_order_seq_cst);
+    }
+
+    // reads up to size, returns the amount read.
+    auto Read(void* _data, size_t size) -> size_t {
+        auto data = static_cast<u8*>(_data);
+        size_t total{};
+
+        // at most 2 spans due to wrapping.
+        while (total < size) {
+            const auto span = Peek();
+            if (span.empty()) {
+                break;
+            }
+
+            const auto rsize = std::min(size - total, span.size());
+            std::memcpy(data + total, span.data(), rsize);
+            Consume(rsize);
+            total += rsize;
+        }
+
+        return total;
+    }
+
+    // writes up to size, returns the amount written.
+    auto Write(const void* _data, size_t size) -> size_t {
+        auto data = static_cast<const u8*>(_data);
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto wsize = std::min(size, Capacity() - (tail - m_head.load(std::memory_order_acquire)));
+
+        const auto off = tail & m_mask;
+        const auto first = std::min(wsize, Capacity() - off);
+        std::memcpy(m_data.data() + off, data, first);
+        std::memcpy(m_data.data(), data + first, wsize - first);
+
+        m_tail.store(tail + wsize, std::memory_order_seq_cst);
+        return wsize;
+    }
+
+private:
+    pool::Vector<u8> m_data{};
+    size_t m_mask{};
+    // both only ever increase, the index is the position & mask.
+    std::atomic<size_t> m_head{};
+    std::atomic<size_t> m_tail{};
+};
+
+} // namespace sphaira::utils
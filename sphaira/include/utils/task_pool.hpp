@@ -0,0 +1,64 @@
+#pragma once
+
+#include <switch.h>
+#include <functional>
+#include <atomic>
+
+// shared pool of workers for short background jobs, so that each job doesn't
+// create (and allocate the stack of) its own thread.
+// there's a worker per application core, pinned to that core, each with its
+// own queue. a worker takes its newest task first, and once empty, steals the
+// oldest task from the other workers.
+// workers run one priority below the main, audio and server threads
+// (core0=main, core1=audio, core2=servers), so tasks only use the time those
+// leave spare.
+// tasks must not block waiting on each other, use a Group to wait for tasks,
+// which runs queued tasks whilst it waits so that it can't deadlock.
+// long running loops (ie, the transfer stages) should still use their own
+// thread.
+namespace sphaira::utils::task {
+
+enum class Priority {
+    High,
+    Normal,
+    Low,
+    MAX,
+};
+
+using Task = std::function<void()>;
+
+// starts the workers, if this fails (or isn't called) tasks run on the
+// calling thread.
+Result Init();
+// runs any tasks left in the queue, then joins the workers.
+void Exit();
+
+// number of workers, 0 if not started.
+auto GetWorkerCount() -> u32;
+
+// queues a task that isn't waited on.
+void Push(Task&& task, Priority prio = Priority::Normal);
+
+// a set of tasks that can be waited on, ie, fork / join.
+// the destructor waits for any tasks still running.
+struct Group {
+    Group();
+    ~Group();
+
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+    void Push(Task&& task, Priority prio = Priority::Normal);
+    // blocks until every task pushed to the group has finished.
+    void Wait();
+
+private:
+    void OnTaskDone();
+
+private:
+    Mutex m_mutex{};
+    CondVar m_done{};
+    std::atomic<u32> m_pending{};
+};
+
+} // namespace sphaira::utils::task
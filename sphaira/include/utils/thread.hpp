@@ -10,7 +10,67 @@ static inline Result CreateThread(Thread *t, ThreadFunc entry, void *arg, size_t
     u64 core_mask = 0;
     R_TRY(svcGetInfo(&core_mask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0));
     R_TRY(threadCreate(t, entry, arg, nullptr, stack_sz, prio, -2));
-    R_TRY(svcSetThreadCoreMask(t->handle, -1, core_mask));
+    // -3 keeps the ideal core set above.
+    R_TRY(svcSetThreadCoreMask(t->handle, -3, core_mask));
+    R_SUCCEED();
+}
+
+// what a thread is used for, which decides the cores it runs on and its priority.
+// core0=main (ui), core1=audio, core2=servers (ftp,mtp,nxlink)
+enum class ThreadRole {
+    // core 1, high priority, as a stall is heard.
+    Audio,
+    // any core, mostly waiting on ipc / the sd card, ie, read and write stages.
+    Io,
+    // cores 1-2, below io, ie, decompress, crypto and hashing.
+    // kept off core 0 so that the ui keeps drawing at 60fps during installs.
+    Compute,
+    // any core, lowest priority, ie, logging and indexing.
+    Background,
+};
+
+struct ThreadPolicy {
+    u64 core_mask;
+    int prio;
+};
+
+static inline auto GetThreadPolicy(ThreadRole role) -> ThreadPolicy {
+    switch (role) {
+        case ThreadRole::Audio: return { 0b010, 0x20 };
+        case ThreadRole::Io: return { 0b111, 0x3B };
+        case ThreadRole::Compute: return { 0b110, 0x3C };
+        case ThreadRole::Background: return { 0b111, 0x3F };
+    }
+    return { 0b111, 0x3B };
+}
+
+static inline Result CreateThread(Thread *t, ThreadFunc entry, void *arg, ThreadRole role, size_t stack_sz = 1024*128) {
+    // compute threads are given a different ideal core each, so that they
+    // start spread over the cores, rather than all on the first.
+    static std::atomic<u32> next_core{};
+
+    u64 process_mask = 0;
+    R_TRY(svcGetInfo(&process_mask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0));
+
+    const auto policy = GetThreadPolicy(role);
+    auto core_mask = policy.core_mask & process_mask;
+    if (!core_mask) {
+        core_mask = process_mask;
+    }
+
+    s32 ideal_core = __builtin_ctzll(core_mask);
+    if (role == ThreadRole::Compute) {
+        auto n = next_core++ % __builtin_popcountll(core_mask);
+        for (ideal_core = 0; ; ideal_core++) {
+            if ((core_mask & (1ULL << ideal_core)) && !n--) {
+                break;
+            }
+        }
+    }
+
+    R_TRY(threadCreate(t, entry, arg, nullptr, stack_sz, policy.prio, ideal_core));
+    // -3 keeps the ideal core set above.
+    R_TRY(svcSetThreadCoreMask(t->handle, -3, core_mask));
     R_SUCCEED();
 }
 
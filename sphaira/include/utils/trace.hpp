@@ -0,0 +1,43 @@
+#pragma once
+
+#include "fs.hpp"
+#include "defines.hpp"
+#include <switch.h>
+
+// records spans of work on each thread, which are exported in the chrome
+// trace format, so that the overlap of the transfer, install and ui threads
+// can be inspected in perfetto (ui.perfetto.dev).
+// each thread writes to its own ring buffer, so recording doesn't lock, once a
+// buffer is full the oldest spans are overwritten.
+// tracing is disabled by default, in which case a span is a single load.
+namespace sphaira::utils::trace {
+
+// this is thread safe.
+void SetEnabled(bool enable);
+auto IsEnabled() -> bool;
+
+// records a span from start_tick until now, name must be a string literal.
+void Record(const char* name, u64 start_tick);
+// same as above, but for spans that overlap others on the same thread,
+// ie, transfers driven by curl multi.
+void RecordAsync(const char* name, u64 start_tick);
+
+// writes the spans recorded by all threads.
+Result Export(const fs::FsPath& path = "/switch/sphaira/trace.json");
+
+struct ScopedSpan final {
+    ScopedSpan(const char* name) : m_name{name}, m_start{IsEnabled() ? armGetSystemTick() : 0} {}
+    ~ScopedSpan() {
+        if (m_start) {
+            Record(m_name, m_start);
+        }
+    }
+
+private:
+    const char* const m_name;
+    const u64 m_start;
+};
+
+#define TRACE_SCOPE(name) sphaira::utils::trace::ScopedSpan ANONYMOUS_VARIABLE(TRACE_SCOPE_STATE_){name};
+
+} // namespace sphaira::utils::trace
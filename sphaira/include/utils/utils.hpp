@@ -29,4 +29,7 @@ std::string formatSizeStorage(u64 size);
 // formats size to 1.23 MB in 1000 base (used for progress bars).
 std::string formatSizeNetwork(u64 size);
 
+// returns the number of bytes that can still be allocated from the heap.
+u64 GetFreeHeapSize();
+
 } // namespace sphaira::utils
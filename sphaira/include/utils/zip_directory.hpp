@@ -0,0 +1,37 @@
+#pragma once
+
+#include "yati/source/base.hpp"
+#include <switch.h>
+#include <string>
+#include <vector>
+
+// reads the file table of a zip from its central directory.
+// this doesn't depend on the devoptab, so it's also built for the host
+// benchmarks, see tools/host_bench.
+namespace sphaira::utils::zip {
+
+struct FileEntry {
+    std::string path;
+    u16 flags;
+    u16 compression_type;
+    u16 modtime;
+    u16 moddate;
+    u32 compressed_size; // may be zero.
+    u32 uncompressed_size; // may be zero.
+    u32 local_file_header_off;
+};
+
+struct DirectoryEntry {
+    std::string path;
+    std::vector<DirectoryEntry> dir_child;
+    std::vector<FileEntry> file_child;
+};
+
+using FileTableEntries = std::vector<FileEntry>;
+
+// finds the end record and reads every file header of the central directory.
+Result ParseCentralDirectory(yati::source::Base* source, s64 size, FileTableEntries& out);
+// builds the directory tree from the file table, the root is "/".
+void BuildTree(const FileTableEntries& entries, DirectoryEntry& out);
+
+} // namespace sphaira::utils::zip
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <switch.h>
+#include <memory>
+#include <zstd.h>
+
+// process-wide pool of zstd contexts.
+// creating a context allocates its tables / window, which is wasteful when
+// done per nca or per block, so released contexts are reset and kept for reuse.
+namespace sphaira::utils::zstd {
+
+// returns nullptr if a context could not be created.
+auto AcquireDCtx() -> ZSTD_DCtx*;
+void ReleaseDCtx(ZSTD_DCtx* dctx);
+
+// the context is reset to the default parameters on release.
+auto AcquireCCtx() -> ZSTD_CCtx*;
+void ReleaseCCtx(ZSTD_CCtx* cctx);
+
+// frees all cached contexts.
+void Trim();
+
+struct DCtxDeleter {
+    void operator()(ZSTD_DCtx* dctx) const {
+        ReleaseDCtx(dctx);
+    }
+};
+
+struct CCtxDeleter {
+    void operator()(ZSTD_CCtx* cctx) const {
+        ReleaseCCtx(cctx);
+    }
+};
+
+// scoped handles that return the context to the pool.
+using DCtx = std::unique_ptr<ZSTD_DCtx, DCtxDeleter>;
+using CCtx = std::unique_ptr<ZSTD_CCtx, CCtxDeleter>;
+
+} // namespace sphaira::utils::zstd
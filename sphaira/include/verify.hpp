@@ -0,0 +1,67 @@
+#pragma once
+
+#include "fs.hpp"
+#include "ui/progress_box.hpp"
+#include <string>
+#include <vector>
+#include <span>
+#include <switch.h>
+
+// checks a set of files against the hashes listed in a manifest, ie a dat,
+// sfv or md5sum file, or a json object of path to hash.
+namespace sphaira::verify {
+
+struct Entry {
+    // relative to the dir the manifest is in.
+    fs::FsPath path{};
+    // -1 if not listed.
+    s64 size{-1};
+    // lowercase hex, empty if not listed.
+    std::string crc32{};
+    std::string md5{};
+    std::string sha1{};
+    std::string sha256{};
+};
+
+enum class Status {
+    Ok,
+    Mismatch,
+    Missing,
+    Error,
+};
+
+struct Failure {
+    fs::FsPath path{};
+    Status status{};
+    // the hash or size that didn't match.
+    std::string reason{};
+};
+
+struct Report {
+    u32 ok{};
+    u32 mismatch{};
+    u32 missing{};
+    u32 error{};
+    // entries skipped as they were verified by a previous run.
+    u32 resumed{};
+    s64 bytes{};
+    u64 elapsed_ns{};
+    std::vector<Failure> failures{};
+};
+
+// returns true if the file extension is a supported manifest.
+auto IsManifest(std::string_view path) -> bool;
+
+Result LoadManifest(fs::Fs* fs, const fs::FsPath& path, std::vector<Entry>& out);
+
+// path of the results file for a manifest, kept on the sd card so that
+// manifests on read only mounts can still be resumed.
+auto GetResultsPath(const fs::FsPath& manifest_path) -> fs::FsPath;
+
+// verifies every entry using a pool of workers, each file is read once no
+// matter how many hashes are listed for it.
+// each result is appended to the results file as it finishes, entries that
+// are already in the results file are skipped, so a verify can be resumed.
+Result Verify(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& manifest_path, std::span<const Entry> entries, Report& out);
+
+} // namespace sphaira::verify
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "fs.hpp"
+#include "yati/container/base.hpp"
+#include <switch.h>
+#include <vector>
+
+// remembers the parsed collections of recently installed files, along with
+// the ncas that passed the sha256 verify, so that installing the same file
+// again doesn't have to parse the container or hash the ncas a second time.
+// entries are keyed by the path, size and timestamp of the file, so a changed
+// file is never matched.
+namespace sphaira::yati::cache {
+
+struct Entry {
+    u8 key[SHA256_HASH_SIZE]{};
+    container::Collections collections{};
+    // ncas whose sha256 matched their content id.
+    std::vector<NcmContentId> verified{};
+
+    auto IsVerified(const NcmContentId& content_id) const -> bool;
+};
+
+// returns false if the file can't be stat'd, or the mount doesn't return a timestamp.
+bool CreateKey(fs::Fs* fs, const fs::FsPath& path, u8 (&out)[SHA256_HASH_SIZE]);
+
+// returns a copy of the entry, if found.
+bool Find(const u8 (&key)[SHA256_HASH_SIZE], Entry& out);
+// inserts or replaces the entry as the most recent, then writes the cache to disk.
+Result Update(const Entry& entry);
+
+} // namespace sphaira::yati::cache
@@ -36,6 +36,12 @@ struct Base {
         return m_source;
     }
 
+protected:
+    // reads a pfs0 / hfs0 header along with its file and string tables into out.
+    // a large window is read first so that the whole header is usually a single
+    // read, rather than a round trip for each table.
+    static Result ReadPartitionHeader(Source* source, s64 off, u32 magic, Result bad_magic, u64 entry_size, std::vector<u8>& out);
+
 protected:
     Source* m_source;
 };
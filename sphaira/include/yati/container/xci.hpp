@@ -63,6 +63,8 @@ struct Xci final : Base {
     Result GetRoot(Root& out);
 
 private:
+    // reads the root hfs0, but not the partitions.
+    Result GetRootHfs0(Root& out);
     Result Hfs0GetPartition(source::Base* source, s64 off, Hfs0& out);
     Result ReadPartitionFromHfs0(source::Base* source, const Hfs0& root, u32 index, Partition& out);
 };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "fs.hpp"
+#include "yati/container/base.hpp"
+#include "yati/nx/nca.hpp"
+#include <switch.h>
+#include <vector>
+
+// records the progress of each nca so that a failed install can be resumed.
+// only a single journal is kept, starting an install of a different container
+// discards the old journal.
+namespace sphaira::yati::journal {
+
+struct Entry {
+    NcmContentId content_id{};
+    NcmPlaceHolderId placeholder_id{};
+    // size of the nca in the container.
+    s64 size{};
+    // bytes written and hashed, the data upto here is known to be good.
+    s64 offset{};
+    // running hash upto offset, only valid if has_hash is set.
+    Sha256Context sha256{};
+    bool has_hash{};
+    // set once the nca has been fully installed and verified.
+    bool complete{};
+    bool modified{};
+    u8 hash[SHA256_HASH_SIZE]{};
+    // the unmodified decrypted header.
+    nca::Header header{};
+};
+
+struct Journal {
+    // loads the journal for the key, returns true if it matched.
+    // if it doesn't match, old contains the entries of the previous journal
+    // so that their placeholders can be deleted from old_storage_id.
+    bool Load(const u8 (&key)[SHA256_HASH_SIZE], NcmStorageId storage_id, std::vector<Entry>& old, NcmStorageId& old_storage_id);
+
+    // returns a copy of the entry, if found.
+    bool Find(const NcmContentId& content_id, Entry& out);
+    // inserts or replaces the entry, then writes the journal to disk.
+    Result Update(const Entry& entry);
+    // removes the entry, ie on hash mismatch.
+    Result Remove(const NcmContentId& content_id);
+    // deletes the journal, called once the install has finished.
+    void Delete();
+
+    auto IsActive() const -> bool {
+        return m_active;
+    }
+
+private:
+    Result Save();
+
+private:
+    Mutex m_mutex{};
+    u8 m_key[SHA256_HASH_SIZE]{};
+    NcmStorageId m_storage_id{};
+    std::vector<Entry> m_entries{};
+    bool m_active{};
+};
+
+// creates the key for a container from the name and size of each collection.
+void CreateKey(const container::Collections& collections, NcmStorageId storage_id, u8 (&out)[SHA256_HASH_SIZE]);
+
+} // namespace sphaira::yati::journal
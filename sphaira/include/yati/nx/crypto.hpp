@@ -1,6 +1,7 @@
 #pragma once
 
 #include <switch.h>
+#include <cstring>
 
 namespace sphaira::crypto {
 
@@ -23,26 +24,48 @@ private:
     bool m_is_encryptor;
 };
 
+// the ctr / xts kernels below process multiple blocks at once using the armv8
+// aes instructions when the compiler targets them, otherwise they use libnx.
+struct Aes128Ctr {
+    Aes128Ctr() = default;
+    Aes128Ctr(const void* key, const void* ctr) {
+        Create(key, ctr);
+    }
+
+    void Create(const void* key, const void* ctr) {
+        aes128ContextCreate(&m_ctx, key, true);
+        ResetCtr(ctr);
+    }
+
+    void ResetCtr(const void* ctr) {
+        std::memcpy(m_ctr, ctr, sizeof(m_ctr));
+        m_keystream_offset = sizeof(m_keystream);
+    }
+
+    void Crypt(void* dst, const void* src, u64 size);
+
+private:
+    Aes128Context m_ctx{};
+    u8 m_ctr[AES_BLOCK_SIZE]{};
+    // left over keystream from the last partial block.
+    u8 m_keystream[AES_BLOCK_SIZE]{};
+    u64 m_keystream_offset{AES_BLOCK_SIZE};
+};
+
 struct Aes128Xts {
     Aes128Xts(const u8 *key, bool is_encryptor) : Aes128Xts{key, key + 0x10, is_encryptor} { }
     Aes128Xts(const void *key0, const void *key1, bool is_encryptor) {
         m_is_encryptor = is_encryptor;
-        aes128XtsContextCreate(&m_ctx, key0, key1, is_encryptor);
+        aes128ContextCreate(&m_ctx, key0, is_encryptor);
+        aes128ContextCreate(&m_tweak_ctx, key1, true);
     }
 
-    void Run(void *dst, const void *src, u64 sector, u64 sector_size, u64 data_size) {
-        for (u64 pos = 0; pos < data_size; pos += sector_size) {
-            aes128XtsContextResetSector(&m_ctx, sector++, true);
-            if (m_is_encryptor) {
-                aes128XtsEncrypt(&m_ctx, static_cast<u8*>(dst) + pos, static_cast<const u8*>(src) + pos, sector_size);
-            } else {
-                aes128XtsDecrypt(&m_ctx, static_cast<u8*>(dst) + pos, static_cast<const u8*>(src) + pos, sector_size);
-            }
-        }
-    }
+    // uses the nintendo (big endian) tweak.
+    void Run(void *dst, const void *src, u64 sector, u64 sector_size, u64 data_size);
 
 private:
-    Aes128XtsContext m_ctx;
+    Aes128Context m_ctx;
+    Aes128Context m_tweak_ctx;
     bool m_is_encryptor;
 };
 
@@ -65,6 +65,7 @@ struct Keys {
 };
 
 void parse_hex_key(void* key, const char* hex);
+// the keys are cached after the first call, so this is cheap to call per operation.
 Result parse_keys(Keys& out, bool read_from_file);
 
 } // namespace sphaira::keys
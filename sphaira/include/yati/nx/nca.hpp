@@ -4,6 +4,7 @@
 #include "keys.hpp"
 #include "ncm.hpp"
 #include "yati/source/base.hpp"
+#include "yati/nx/crypto.hpp"
 
 #include <switch.h>
 #include <vector>
@@ -353,8 +354,10 @@ private:
     Result Decrypt(void* buf, s64 off, s64 size) override;
 
 private:
-    Aes128CtrContext m_ctx{};
+    crypto::Aes128Ctr m_ctx{};
     u8 m_ctr[AES_BLOCK_SIZE]{};
+    // used to create a context per task for large reads.
+    u8 m_key[0x10]{};
 };
 
 struct NcaReader final : yati::source::Base {
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "yati/source/base.hpp"
+#include "yati/nx/ncz_block_cache.hpp"
 #include "utils/lru.hpp"
+#include "utils/zstd_pool.hpp"
 #include "defines.hpp"
+#include "fs.hpp"
 
 #include <switch.h>
 #include <vector>
@@ -45,20 +48,6 @@ struct BlockHeader {
     }
 };
 
-struct Block {
-    u32 size;
-};
-using Blocks = std::vector<Block>;
-
-struct BlockInfo {
-    u64 offset; // compressed offset.
-    u64 size; // compressed size.
-
-    auto InRange(u64 off) const -> bool {
-        return off < offset + size && off >= offset;
-    }
-};
-
 struct Section {
     u64 offset;
     u64 size;
@@ -73,11 +62,93 @@ struct Section {
 };
 using Sections = std::vector<Section>;
 
+// the parsed tables of a block compressed ncz.
+struct Index {
+    Header header{};
+    Sections sections{};
+    BlockHeader block_header{};
+    Blocks blocks{};
+    // offset of the first block, or the start of the zstd stream if solid.
+    u64 block_offset{};
+    // set if there's no block table, see NczSolidReader.
+    bool solid{};
+};
+
+// reads the section and block tables following the header.
+// solid ncz only have the section table, so solid is set instead.
+Result ReadIndex(yati::source::Base* source, const Header& header, Index& out);
+
+// the index is cached to the sd card so that mounting large ncz libraries
+// doesn't need to re-read the tables each time.
+// the cache is keyed by path and is only used if the size and timestamp match.
+bool LoadIndexCache(const fs::FsPath& path, s64 size, const FsTimeStampRaw& ts, Index& out);
+Result SaveIndexCache(const fs::FsPath& path, s64 size, const FsTimeStampRaw& ts, const Index& index);
+
 struct NczBlockReader final : yati::source::Base {
     explicit NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source);
+    ~NczBlockReader();
+    Result Read(void *_buf, s64 off, s64 size, u64* bytes_read) override;
+
+private:
+    Result ReadInternal(void *_buf, s64 off, s64 size, u64* bytes_read, bool decrypt);
+    // reads and decompresses the block, called without the lock held.
+    Result LoadBlock(u64 block_id, std::vector<u8>& out);
+    // same as above, out must be GetBlockSize() in size.
+    Result LoadBlock(u64 block_id, void* out);
+    // must be called with the lock held.
+    void UpdatePrefetch(u64 first_block, u64 last_block);
+
+    void PrefetchThread();
+    static void PrefetchThreadFunc(void* arg);
+
+private:
+    const Header m_header;
+    const Sections m_sections;
+    const u64 m_block_offset;
+    std::shared_ptr<yati::source::Base> m_source;
+
+    // block table and lru cache of blocks.
+    BlockCache m_cache;
+
+    // protects the lru and prefetch state.
+    Mutex m_mutex{};
+    // only one block is read from the source at a time.
+    Mutex m_source_mutex{};
+    // signalled when there are new blocks to prefetch, or on exit.
+    CondVar m_can_prefetch{};
+    // signalled when the prefetch thread has loaded a block.
+    CondVar m_can_read{};
+
+    // blocks are only prefetched once the reads are sequential.
+    u64 m_last_block{UINT64_MAX};
+    u32 m_sequential_count{};
+    // max number of blocks to load ahead of the reader.
+    u32 m_prefetch_max{};
+    // range of blocks left to prefetch [next, end).
+    u64 m_prefetch_next{};
+    u64 m_prefetch_end{};
+    // block being loaded by the prefetch thread.
+    u64 m_inflight_block{UINT64_MAX};
+
+    Thread m_thread{};
+    bool m_thread_created{};
+    bool m_exit{};
+};
+
+// solid ncz are a single zstd stream, so they can only be decompressed in order.
+// checkpoints are recorded at each zstd frame boundary on the first pass, and
+// decompressed chunks are kept in an lru, so that a backward seek resumes from
+// the nearest checkpoint rather than from the start of the stream.
+struct NczSolidReader final : yati::source::Base {
+    explicit NczSolidReader(const Sections& sections, u64 offset, s64 compressed_end, const std::shared_ptr<yati::source::Base>& source);
     Result Read(void *_buf, s64 off, s64 size, u64* bytes_read) override;
 
 private:
+    struct Checkpoint {
+        u64 in_off; // compressed offset of the frame.
+        u64 out_off; // decompressed offset of the frame.
+    };
+
     struct LruData {
         s64 offset{};
         std::vector<u8> data{};
@@ -88,22 +159,41 @@ private:
     };
 
 private:
-    Result ReadInternal(void *_buf, s64 off, s64 size, u64* bytes_read, bool decrypt);
+    // moves the stream to off, restarting from a checkpoint if needed.
+    Result Seek(u64 off);
+    // decompresses size bytes from the current position of the stream.
+    Result Decompress(void* out, u64 size);
+    auto FindChunk(u64 off) -> LruData*;
 
 private:
-    const Header m_header;
     const Sections m_sections;
-    const BlockHeader m_block_header;
-    const Blocks m_blocks;
-    const u64 m_block_offset;
+    const u64 m_offset;
+    const s64 m_compressed_end;
     std::shared_ptr<yati::source::Base> m_source;
 
-    u32 m_block_size{};
-    std::vector<BlockInfo> m_block_infos{};
+    // decompressed size of the stream.
+    u64 m_size{};
+    utils::zstd::DCtx m_dctx{};
+
+    // compressed data waiting to be decompressed.
+    std::vector<u8> m_in_buf{};
+    ZSTD_inBuffer m_input{};
+    // compressed offset of m_in_buf.
+    u64 m_in_buf_off{};
+    // compressed offset of the next read from the source.
+    u64 m_in_off{};
+    // decompressed offset of the stream.
+    u64 m_out_off{};
 
-    // lru cache of blocks
+    // sorted by offset, the first is the start of the stream.
+    std::vector<Checkpoint> m_checkpoints{};
+
+    // lru cache of decompressed chunks.
     std::vector<LruData> m_lru_data{};
     utils::Lru<LruData> m_lru{};
+
+    // the stream can only be used by one reader at a time.
+    Mutex m_mutex{};
 };
 
 } // namespace sphaira::ncz
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "utils/lru.hpp"
+#include <switch.h>
+#include <vector>
+
+namespace sphaira::ncz {
+
+struct Block {
+    u32 size;
+};
+using Blocks = std::vector<Block>;
+
+struct BlockInfo {
+    u64 offset; // compressed offset.
+    u64 size; // compressed size.
+
+    auto InRange(u64 off) const -> bool {
+        return off < offset + size && off >= offset;
+    }
+};
+
+// finds the block that a decompressed offset is in, and keeps the most
+// recently used blocks of a NczBlockReader in an lru.
+// not thread safe, the reader holds its lock whilst using this.
+// this doesn't depend on zstd or the source, so it's also built for the host
+// benchmarks, see tools/host_bench.
+struct BlockCache {
+    struct Data {
+        s64 offset{};
+        std::vector<u8> data{};
+
+        auto InRange(u64 off) const -> bool {
+            return off < offset + data.size() && off >= offset;
+        }
+    };
+
+    // offset is the compressed offset of the first block.
+    BlockCache(u8 block_size_exponent, u64 decompressed_size, const Blocks& blocks, u64 offset, u32 lru_count);
+
+    // the lru points into m_lru_data.
+    BlockCache(const BlockCache&) = delete;
+    void operator=(const BlockCache&) = delete;
+
+    auto GetBlockSize() const -> u32 {
+        return m_block_size;
+    }
+
+    auto GetBlockCount() const -> u64 {
+        return m_block_infos.size();
+    }
+
+    auto GetBlockInfo(u64 block_id) const -> const BlockInfo& {
+        return m_block_infos[block_id];
+    }
+
+    auto GetLruCount() const -> u32 {
+        return m_lru_data.size();
+    }
+
+    // returns the decompressed size of the block.
+    auto GetBlockSize(u64 block_id) const -> u64;
+
+    // returns the cached block that off is in, update moves it to the front.
+    auto Find(u64 off, bool update) -> Data*;
+    // replaces the least recently used block, data is swapped into the cache.
+    auto Insert(u64 block_id, std::vector<u8>& data) -> Data*;
+
+private:
+    const u64 m_decompressed_size;
+    const u32 m_block_size;
+    std::vector<BlockInfo> m_block_infos{};
+
+    std::vector<Data> m_lru_data{};
+    utils::Lru<Data> m_lru{};
+};
+
+} // namespace sphaira::ncz
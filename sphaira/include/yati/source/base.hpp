@@ -19,6 +19,11 @@ struct Base {
         return false;
     }
 
+    // set if Read() can be called from multiple threads at once.
+    virtual bool CanReadConcurrently() const {
+        return false;
+    }
+
     virtual void SignalCancel() {
 
     }
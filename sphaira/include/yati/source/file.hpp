@@ -12,6 +12,10 @@ struct File final : Base {
     Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
     Result GetSize(s64* out);
 
+    bool CanReadConcurrently() const override {
+        return m_fs->IsNative();
+    }
+
 private:
     fs::Fs* m_fs{};
     fs::File m_file{};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base.hpp"
+#include "stream.hpp"
+#include "download.hpp"
+#include "utils/thread.hpp"
+#include <switch.h>
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace sphaira::yati::source {
+
+// reads straight from a url, each read is fetched in parallel ranges.
+struct Http final : Base {
+    Http(const curl::Api& api);
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+    void SignalCancel() override;
+
+    auto GetSize() const -> s64 {
+        return m_file.GetSize();
+    }
+
+    auto HasRanges() const -> bool {
+        return m_file.HasRanges();
+    }
+
+private:
+    curl::RemoteFile m_file;
+};
+
+// used if the server doesn't support ranges, the file is downloaded in order
+// on a thread and buffered until read.
+struct HttpStream final : Stream {
+    HttpStream(const curl::Api& api);
+    ~HttpStream();
+    Result ReadChunk(void* buf, s64 size, u64* bytes_read) override;
+    void SignalCancel() override;
+
+private:
+    auto OnData(const void* data, size_t size) -> bool;
+
+private:
+    curl::RemoteFile m_file;
+    Mutex m_mutex{};
+    CondVar m_can_read{};
+    CondVar m_can_write{};
+    std::vector<u8> m_buffer{};
+    // data before this has already been read.
+    size_t m_buffer_off{};
+    bool m_done{};
+    bool m_cancelled{};
+    bool m_failed{};
+    std::unique_ptr<utils::Async> m_thread{};
+};
+
+// opens the url with ranges if the server supports them, otherwise as a stream.
+Result OpenHttp(const curl::Api& api, std::shared_ptr<Base>& out, s64* size);
+
+} // namespace sphaira::yati::source
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "base.hpp"
+#include "fs.hpp"
+#include <switch.h>
+#include <memory>
+#include <vector>
+
+namespace sphaira::yati::source {
+
+// a file that's been split into parts (for fat32), read as one file.
+// supports a folder of parts named 00, 01, ... (the archive bit folder, for
+// when the fs doesn't join them for us), and name.xc0, name.xc1, ... / name.ns0, ...
+struct Split final : Base {
+    Split(fs::Fs* fs, const fs::FsPath& path);
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override;
+    Result GetSize(s64* out);
+
+    bool CanReadConcurrently() const override {
+        return m_fs->IsNative();
+    }
+
+    // returns true if the path is the folder or first part of a split file.
+    static bool IsSplit(fs::Fs* fs, const fs::FsPath& path);
+
+private:
+    struct Part {
+        fs::File file{};
+        s64 off{};
+        s64 size{};
+    };
+
+    Result ReadPart(u32 index, void* buf, s64 off, s64 size, u64* bytes_read);
+
+private:
+    fs::Fs* m_fs{};
+    std::unique_ptr<Part[]> m_parts{};
+    u32 m_count{};
+    s64 m_size{};
+};
+
+// opens the path as a split file, or as a normal file if it's not split.
+Result OpenFile(fs::Fs* fs, const fs::FsPath& path, std::shared_ptr<Base>& out, s64* size);
+
+} // namespace sphaira::yati::source
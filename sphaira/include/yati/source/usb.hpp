@@ -43,6 +43,14 @@ struct Usb final : Base {
         return m_usb->CloseFile();
     }
 
+    Result Bench(u32 mode, u32 size, u32 count, u32 queue_depth, usb::install::BenchResult& out) {
+        return m_usb->Bench(mode, size, count, queue_depth, out);
+    }
+
+    bool IsBench() const {
+        return m_usb->GetCaps() & usb::api::CAP_BENCH;
+    }
+
     auto GetOpenResult() const {
         return m_usb->GetOpenResult();
     }
@@ -11,8 +11,10 @@
 #include "source/base.hpp"
 #include "container/base.hpp"
 #include "ui/progress_box.hpp"
+#include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 
 namespace sphaira::yati {
 
@@ -39,6 +41,10 @@ struct Config {
     // enables the option to skip sha256 verification.
     bool skip_nca_hash_verify{};
 
+    // skips the sha256 verification of ncas that were verified when the same
+    // file (path, size and timestamp) was last installed.
+    bool skip_cached_hash_verify{};
+
     // enables the option to skip rsa nca fixed key verification.
     bool skip_rsa_header_fixed_key_verify{};
 
@@ -63,6 +69,11 @@ struct Config {
     // if mkey is higher than fw version, the game still won't launch
     // as the fw won't have the key to decrypt keak.
     bool lower_system_version{};
+
+    // runs the install pipeline but discards the output, used to benchmark
+    // the source / cpu without writing to storage.
+    // the cnmt nca is still written to a placeholder as it needs to be parsed.
+    bool dry_run{};
 };
 
 // overridable options, set to avoid
@@ -76,11 +87,23 @@ struct ConfigOverride {
     std::optional<bool> convert_to_standard_crypto{};
     std::optional<bool> lower_master_key{};
     std::optional<bool> lower_system_version{};
+    std::optional<bool> dry_run{};
 };
 
 Result InstallFromFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& path, const ConfigOverride& override = {});
 Result InstallFromSource(ui::ProgressBox* pbox, source::Base* source, const fs::FsPath& path, const ConfigOverride& override = {});
+// installs straight from a http(s) url, nothing is written to the sd card.
+// the container type is taken from the file name at the end of the url.
+Result InstallFromUrl(ui::ProgressBox* pbox, const std::string& url, const ConfigOverride& override = {});
 Result InstallFromContainer(ui::ProgressBox* pbox, container::Base* container, const ConfigOverride& override = {});
 Result InstallFromCollections(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override = {});
 
+// called once a file in the batch has been installed.
+using BatchCallback = std::function<void(const fs::FsPath& path)>;
+
+// installs multiple files, the next file is opened and parsed whilst the
+// current one installs. tickets and ncas shared between files are only
+// installed once.
+Result InstallFromFiles(ui::ProgressBox* pbox, fs::Fs* fs, std::span<const fs::FsPath> paths, const ConfigOverride& override = {}, const BatchCallback& on_installed = nullptr);
+
 } // namespace sphaira::yati
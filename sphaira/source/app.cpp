@@ -4,6 +4,7 @@
 #include "ui/option_box.hpp"
 #include "ui/progress_box.hpp"
 #include "ui/error_box.hpp"
+#include "ui/profile_overlay.hpp"
 
 #include "ui/menus/main_menu.hpp"
 
@@ -14,19 +15,29 @@
 #include "evman.hpp"
 #include "owo.hpp"
 #include "image.hpp"
+#include "image_decode.hpp"
 #include "nxlink.h"
 #include "fs.hpp"
 #include "defines.hpp"
 #include "i18n.hpp"
 #include "ftpsrv_helper.hpp"
+#include "search_index.hpp"
+#include "trash.hpp"
+#include "jobs.hpp"
 #include "haze_helper.hpp"
 #include "web.hpp"
 #include "swkbd.hpp"
 #include "usbdvd.hpp"
 
 #include "utils/profile.hpp"
+#include "utils/trace.hpp"
 #include "utils/thread.hpp"
+#include "utils/task_pool.hpp"
 #include "utils/devoptab.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/block_cache.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/mem_track.hpp"
 
 #include <nanovg_dk.h>
 #include <minIni.h>
@@ -36,7 +47,9 @@
 #include <cstring>
 #include <ctime>
 #include <span>
+#include <unordered_map>
 #include <dirent.h>
+#include <sys/stat.h>
 
 #ifdef ENABLE_LIBUSBHSFS
     #include <usbhsfs.h>
@@ -53,9 +66,45 @@ constexpr const u8 DEFAULT_IMAGE_DATA[]{
     #embed <icons/default.png>
 };
 
+// ini file that a theme was resolved from, along with its stamp when parsed.
+struct ThemeStamp {
+    fs::FsPath path;
+    u64 stamp;
+};
+
 struct ThemeData {
     fs::FsPath music_path{};
+    fs::FsPath sound_paths[std::to_underlying(audio::SoundEffect::MAX)]{};
     std::string elements[ThemeEntryID_MAX]{};
+    // set if any ini in the chain set the music, otherwise the default is used.
+    bool has_music{};
+    // the theme ini and every ini that it inherits from.
+    std::vector<ThemeStamp> stamps{};
+};
+
+// resolved themes, keyed by the path of the theme ini.
+// switching themes only parses the ini chain again if one of the files changed.
+std::vector<std::pair<fs::FsPath, ThemeData>> g_theme_cache{};
+
+// romfs can't be mounted from the decode threads, so romfs images are read on
+// the main thread and kept, romfs never changes so these are never stale.
+std::unordered_map<std::string, std::shared_ptr<const std::vector<u8>>> g_theme_romfs_images{};
+
+// theme images are decoded before the icons in the menus.
+constexpr s64 THEME_IMAGE_KEY = -1;
+
+struct ThemeSoundPair {
+    const char* label;
+    audio::SoundEffect id;
+};
+
+constexpr ThemeSoundPair THEME_SOUND_ENTRIES[] = {
+    { "sound_focus", audio::SoundEffect::Focus },
+    { "sound_scroll", audio::SoundEffect::Scroll },
+    { "sound_limit", audio::SoundEffect::Limit },
+    { "sound_startup", audio::SoundEffect::Startup },
+    { "sound_install", audio::SoundEffect::Install },
+    { "sound_error", audio::SoundEffect::Error },
 };
 
 struct ThemeIdPair {
@@ -74,6 +123,11 @@ struct NszOption {
     const char* name;
 };
 
+struct TransferOption {
+    u64 value;
+    const char* name;
+};
+
 constexpr KeyboardState::MapEntry KEYBOARD_BUTTON_MAP[] = {
     {HidKeyboardKey_UpArrow,        static_cast<u64>(Button::DPAD_UP)},
     {HidKeyboardKey_DownArrow,      static_cast<u64>(Button::DPAD_DOWN)},
@@ -115,8 +169,13 @@ constexpr NszOption NSZ_COMPRESS_LEVEL_OPTIONS[] = {
     { .value = 6, .name = "Level 6" },
     { .value = 7, .name = "Level 7" },
     { .value = 8, .name = "Level 8" },
+    // starts at level 3 and is adjusted during the export.
+    { .value = 3, .name = "Auto" },
 };
 
+// index of the auto entry above.
+constexpr long NSZ_COMPRESS_LEVEL_AUTO_INDEX = std::size(NSZ_COMPRESS_LEVEL_OPTIONS) - 1;
+
 constexpr NszOption NSZ_COMPRESS_THREAD_OPTIONS[] = {
     { .value = 0, .name = "0 (single threaded)" },
     { .value = 1, .name = "1" },
@@ -139,6 +198,24 @@ constexpr NszOption NSZ_COMPRESS_BLOCK_OPTIONS[] = {
     { .value = 24, .name = "16 MB" },
 };
 
+constexpr TransferOption TRANSFER_QUEUE_DEPTH_OPTIONS[] = {
+    { .value = 1, .name = "1" },
+    { .value = 2, .name = "2 (default)" },
+    { .value = 3, .name = "3" },
+    { .value = 4, .name = "4" },
+    { .value = 6, .name = "6" },
+    { .value = 8, .name = "8" },
+};
+
+constexpr TransferOption TRANSFER_BUFFER_SIZE_OPTIONS[] = {
+    { .value = 1024 * 512, .name = "512 KB" },
+    { .value = 1024 * 1024 * 1, .name = "1 MB" },
+    { .value = 1024 * 1024 * 2, .name = "2 MB" },
+    { .value = 1024 * 1024 * 4, .name = "4 MB (default)" },
+    { .value = 1024 * 1024 * 8, .name = "8 MB" },
+    { .value = 1024 * 1024 * 16, .name = "16 MB" },
+};
+
 constexpr ThemeIdPair THEME_ENTRIES[] = {
     { "background", ThemeEntryID_BACKGROUND },
     { "grid", ThemeEntryID_GRID },
@@ -402,6 +479,20 @@ auto LoadThemeMeta(const fs::FsPath& path, ThemeMeta& meta) -> bool {
     return true;
 }
 
+// romfs never changes, so it's always 0.
+auto GetThemeStamp(const fs::FsPath& path) -> u64 {
+    if (path.starts_with("romfs:")) {
+        return 0;
+    }
+
+    struct stat st;
+    if (stat(path, &st)) {
+        return UINT64_MAX;
+    }
+
+    return st.st_mtime;
+}
+
 void LoadThemeInternal(ThemeMeta meta, ThemeData& theme_data, int inherit_level = 0) {
     constexpr auto inherit_level_max = 5;
 
@@ -434,6 +525,14 @@ void LoadThemeInternal(ThemeMeta meta, ThemeData& theme_data, int inherit_level
         if (!std::strcmp(Section, "theme")) {
             if (!std::strcmp(Key, "music")) {
                 theme_data->music_path = Value;
+                theme_data->has_music = true;
+            } else if (!std::strncmp(Key, "sound_", std::strlen("sound_"))) {
+                for (auto& e : THEME_SOUND_ENTRIES) {
+                    if (!std::strcmp(Key, e.label)) {
+                        theme_data->sound_paths[std::to_underlying(e.id)] = Value;
+                        break;
+                    }
+                }
             } else {
                 for (auto& e : THEME_ENTRIES) {
                     if (!std::strcmp(Key, e.label)) {
@@ -456,6 +555,63 @@ void LoadThemeInternal(ThemeMeta meta, ThemeData& theme_data, int inherit_level
             log_write("opened ini: %s\n", meta.ini_path.s);
         }
     }
+
+    // stamped even if it failed to open, so that it's parsed again once it exists.
+    theme_data.stamps.emplace_back(meta.ini_path, GetThemeStamp(meta.ini_path));
+}
+
+// returns the cached theme if none of the ini files have changed since it
+// was parsed, otherwise the theme is parsed again.
+auto GetThemeData(const ThemeMeta& meta) -> const ThemeData& {
+    const auto it = std::ranges::find_if(g_theme_cache, [&meta](auto& e) {
+        return e.first == meta.ini_path;
+    });
+
+    if (it != g_theme_cache.end()) {
+        const auto is_valid = std::ranges::all_of(it->second.stamps, [](auto& e) {
+            return GetThemeStamp(e.path) == e.stamp;
+        });
+
+        if (is_valid) {
+            log_write("[THEME] using cached theme: %s\n", meta.ini_path.s);
+            return it->second;
+        }
+
+        g_theme_cache.erase(it);
+    }
+
+    ThemeData theme_data{};
+    LoadThemeInternal(meta, theme_data);
+    return g_theme_cache.emplace_back(meta.ini_path, std::move(theme_data)).second;
+}
+
+// returns the loader for a theme image, which is called on a decode thread.
+// call from the main thread with romfs mounted.
+auto CreateThemeImageLoader(const std::string& path) -> image::Loader {
+    if (path.starts_with("romfs:")) {
+        auto it = g_theme_romfs_images.find(path);
+        if (it == g_theme_romfs_images.end()) {
+            std::vector<u8> buf;
+            if (R_FAILED(fs::FsStdio().read_entire_file(path.c_str(), buf))) {
+                log_write("[THEME] failed to read image: %s\n", path.c_str());
+                return {};
+            }
+
+            it = g_theme_romfs_images.emplace(path, std::make_shared<const std::vector<u8>>(std::move(buf))).first;
+        }
+
+        return [data = it->second]() {
+            return *data;
+        };
+    }
+
+    return [path]() {
+        std::vector<u8> buf;
+        if (R_FAILED(fs::FsStdio().read_entire_file(path.c_str(), buf))) {
+            log_write("[THEME] failed to read image: %s\n", path.c_str());
+        }
+        return buf;
+    };
 }
 
 void nxlink_callback(const NxlinkCallbackData *data) {
@@ -464,7 +620,7 @@ void nxlink_callback(const NxlinkCallbackData *data) {
 }
 
 void on_i18n_change() {
-    i18n::exit();
+    // the previous table is kept as widgets may still point into it.
     i18n::init(App::GetLanguage());
 }
 
@@ -475,26 +631,43 @@ void App::Loop() {
     constexpr double min_delta    = 1000.0 / 120.0; // 120 fps
     constexpr double max_delta    = 1000.0 / 15.0;  // 15  fps
     constexpr double target_delta = 1000.0 / 60.0;  // 60  fps
+    // keep drawing for a while after the last change, this covers transitions,
+    // scrolling and images loading in.
+    constexpr u64 active_ns       = 2e+9;  // 2s
+    // whilst idle, the clock and animations are drawn at a low rate.
+    constexpr u64 idle_draw_ns    = 1e+8;  // 100ms
+    // input can't be waited on, so it's polled at the normal rate.
+    constexpr u64 idle_poll_ns    = target_delta * 1e+6;
+    constexpr u64 stats_ns        = 1e+10; // 10s
+    constexpr u64 config_flush_ns = 1e+9;  // 1s
 
     u64 start = armTicksToNs(armGetSystemTick());
     m_delta_time = 1.0;
 
+    u64 last_dirty_tick = armGetSystemTick();
+    u64 last_draw_tick = 0;
+    u64 stats_tick = armGetSystemTick();
+    u32 frames_drawn = 0;
+    u32 frames_skipped = 0;
+
     while (!m_quit && appletMainLoop()) {
         if (m_widgets.empty()) {
             m_quit = true;
             break;
         }
 
+        TRACE_SCOPE("app::frame");
         ui::gfx::updateHighlightAnimation();
 
-        // fire all events in in a 3ms timeslice
+        // fire a batch of events in in a 3ms timeslice
         TimeStamp ts_event;
         const u64 event_timeout = 3;
+        const u32 max_events = 64;
 
         // limit events to a max per frame in order to not block for too long.
-        while (true) {
-            if (ts_event.GetMs() >= event_timeout) {
-                log_write("event loop timed-out\n");
+        for (u32 event_count = 0; ; event_count++) {
+            if (event_count >= max_events || ts_event.GetMs() >= event_timeout) {
+                log_write("event loop timed-out, handled: %u pending: %zu\n", event_count, evman::count());
                 break;
             }
 
@@ -503,6 +676,8 @@ void App::Loop() {
                 break;
             }
 
+            m_dirty = true;
+
             std::visit([this](auto&& arg){
                 using T = std::decay_t<decltype(arg)>;
                 if constexpr(std::is_same_v<T, evman::LaunchNroEventData>) {
@@ -512,7 +687,7 @@ void App::Loop() {
                     const auto nro_path = nro_normalise_path(arg.path);
 
                     // update timestamp
-                    ini_putl(nro_path.c_str(), "timestamp", timestamp, App::PLAYLOG_PATH);
+                    GetPlaylogStore().SetLong(nro_path, "timestamp", timestamp);
                     log_write("updating timestamp for: %s %lu\n", nro_path.c_str(), timestamp);
 
                     // force disable pop-back to main menu.
@@ -550,6 +725,8 @@ void App::Loop() {
             }, event.value());
         }
 
+        utils::profile::SetPhase(utils::profile::Phase_Events, ts_event.GetNs());
+
         const auto fb = GetFrameBufferSize();
         if (fb.size.x != s_width || fb.size.y != s_height) {
             s_width = fb.size.x;
@@ -558,14 +735,81 @@ void App::Loop() {
             this->destroyFramebufferResources();
             this->createFramebufferResources();
             renderer->UpdateViewSize(s_width, s_height);
+            m_dirty = true;
+        }
+
+        {
+            SCOPED_PROFILE_PHASE(utils::profile::Phase_Poll);
+            TRACE_SCOPE("app::poll");
+            this->Poll();
+        }
+
+        {
+            SCOPED_PROFILE_PHASE(utils::profile::Phase_Update);
+            TRACE_SCOPE("app::update");
+            this->Update();
+        }
+
+        // the overlay shows live timings.
+        if (m_profile_overlay.Get()) {
+            m_dirty = true;
+        }
+
+        if (m_controller.m_kdown || m_controller.m_kheld || m_controller.m_kup) {
+            m_dirty = true;
+            m_input_tick = armGetSystemTick();
+        }
+
+        if (m_touch_info.is_touching || m_touch_info.is_clicked || m_touch_info.is_end) {
+            m_dirty = true;
+            m_input_tick = armGetSystemTick();
+        }
+
+        // notifications count down whilst drawn.
+        if (!m_notif_manager.IsEmpty()) {
+            m_dirty = true;
+        }
+
+        const auto tick = armGetSystemTick();
+        if (m_dirty.exchange(false)) {
+            last_dirty_tick = tick;
+        }
+
+        if (armTicksToNs(tick - last_dirty_tick) < active_ns || armTicksToNs(tick - last_draw_tick) >= idle_draw_ns) {
+            SCOPED_PROFILE_PHASE(utils::profile::Phase_Draw);
+            TRACE_SCOPE("app::draw");
+            this->Draw();
+            last_draw_tick = tick;
+            frames_drawn++;
+
+            if (!m_first_frame_ns) {
+                m_first_frame_ns = armTicksToNs(armGetSystemTick() - m_start_timestamp);
+                log_write("[APP] time to first frame: %.2fms\n", m_first_frame_ns / 1e+6);
+                utils::trace::Record("app::startup", m_start_timestamp);
+                utils::profile::SetStartupTime(m_first_frame_ns);
+                StartDeferredInit();
+            }
+        } else {
+            // write settings once they've stopped changing, rather than on every set.
+            if (GetConfigStore().IsDirtyAndIdle(config_flush_ns) || GetPlaylogStore().IsDirtyAndIdle(config_flush_ns)) {
+                TRACE_SCOPE("app::flush_config");
+                FlushConfig();
+            }
+
+            // nothing changed, so sleep until the next input poll, or until woken.
+            waitSingle(waiterForUEvent(&m_dirty_event), idle_poll_ns);
+            frames_skipped++;
         }
 
-        this->Poll();
-        this->Update();
-        this->Draw();
+        if (armTicksToNs(tick - stats_tick) >= stats_ns) {
+            log_write("[APP] frames drawn: %u skipped: %u\n", frames_drawn, frames_skipped);
+            stats_tick = tick;
+            frames_drawn = frames_skipped = 0;
+        }
 
         // check how long this frame took.
         const u64 now = armTicksToNs(armGetSystemTick());
+        utils::profile::EndFrame(now - start);
         // convert to ns.
         const double delta = (double)(now - start) / 1e+6;
         // clamp and normalise to 1.0 as the target, higher values if we took too long.
@@ -595,11 +839,28 @@ auto App::Push(std::unique_ptr<ui::Widget>&& widget) -> void {
         g_app->m_widgets.back()->OnFocusLost();
     }
 
+    App::Invalidate();
+
     log_write("doing focus gained\n");
     g_app->m_widgets.emplace_back(std::forward<decltype(widget)>(widget))->OnFocusGained();
     log_write("did it\n");
 }
 
+void App::Invalidate() {
+    if (g_app) {
+        g_app->m_dirty = true;
+        ueventSignal(&g_app->m_dirty_event);
+    }
+}
+
+auto App::GetInputIdleNs() -> u64 {
+    if (!g_app) {
+        return 0;
+    }
+
+    return armTicksToNs(armGetSystemTick() - g_app->m_input_tick);
+}
+
 auto App::PopToMenu() -> void {
     for (auto& p : std::ranges::views::reverse(g_app->m_widgets)) {
         if (p->IsMenu()) {
@@ -688,6 +949,21 @@ auto App::GetExePath() -> fs::FsPath {
     return g_app->m_app_path;
 }
 
+auto App::GetConfigStore() -> utils::ini::Store& {
+    static utils::ini::Store store{CONFIG_PATH};
+    return store;
+}
+
+auto App::GetPlaylogStore() -> utils::ini::Store& {
+    static utils::ini::Store store{PLAYLOG_PATH};
+    return store;
+}
+
+void App::FlushConfig() {
+    GetConfigStore().Flush();
+    GetPlaylogStore().Flush();
+}
+
 auto App::IsHbmenu() -> bool {
     return !strcasecmp(GetExePath().s, "/hbmenu.nro");
 }
@@ -756,6 +1032,10 @@ auto App::GetNszCompressLevel() -> u8 {
     return NSZ_COMPRESS_LEVEL_OPTIONS[App::GetApp()->m_nsz_compress_level.Get()].value;
 }
 
+auto App::GetNszCompressLevelAuto() -> bool {
+    return App::GetApp()->m_nsz_compress_level.Get() == NSZ_COMPRESS_LEVEL_AUTO_INDEX;
+}
+
 auto App::GetNszThreadCount() -> u8 {
     return NSZ_COMPRESS_THREAD_OPTIONS[App::GetApp()->m_nsz_compress_threads.Get()].value;
 }
@@ -764,6 +1044,28 @@ auto App::GetNszBlockExponent() -> u8 {
     return NSZ_COMPRESS_BLOCK_OPTIONS[App::GetApp()->m_nsz_compress_block_exponent.Get()].value;
 }
 
+auto App::GetTransferQueueDepth() -> u32 {
+    const auto index = std::clamp<long>(g_app->m_transfer_queue_depth.Get(), 0, std::size(TRANSFER_QUEUE_DEPTH_OPTIONS) - 1);
+    return TRANSFER_QUEUE_DEPTH_OPTIONS[index].value;
+}
+
+auto App::GetTransferBufferSize() -> u64 {
+    const auto index = std::clamp<long>(g_app->m_transfer_buffer_size.Get(), 0, std::size(TRANSFER_BUFFER_SIZE_OPTIONS) - 1);
+    return TRANSFER_BUFFER_SIZE_OPTIONS[index].value;
+}
+
+auto App::GetTransferAdaptiveQueue() -> bool {
+    return g_app->m_transfer_adaptive_queue.Get();
+}
+
+auto App::GetTransferAutoTune() -> bool {
+    return g_app->m_transfer_auto_tune.Get();
+}
+
+auto App::GetTransferShowStageSpeed() -> bool {
+    return g_app->m_transfer_show_stage_speed.Get();
+}
+
 void App::SetNxlinkEnable(bool enable) {
     if (App::GetNxlinkEnable() != enable) {
         g_app->m_nxlink_enabled.Set(enable);
@@ -1003,20 +1305,38 @@ auto App::Install(OwoConfig& config) -> Result {
 }
 
 auto App::Install(ui::ProgressBox* pbox, OwoConfig& config) -> Result {
-    config.nro_path = nro_add_arg_file(config.nro_path);
-    if (!config.icon.empty()) {
-        config.icon = GetNroIcon(config.icon);
-    }
+    return Install(pbox, {&config, 1});
+}
 
-    if (config.logo.empty()) {
-        g_app->m_fs->read_entire_file("/config/sphaira/logo/NintendoLogo.png", config.logo);
-    }
+auto App::Install(ui::ProgressBox* pbox, std::span<OwoConfig> configs, const OnForwarderInstalled& on_installed) -> Result {
+    // the default logo is only read once for the whole batch.
+    std::vector<u8> default_logo, default_gif;
+    bool read_default_logo{};
+
+    for (auto& config : configs) {
+        config.nro_path = nro_add_arg_file(config.nro_path);
+        if (!config.icon.empty()) {
+            config.icon = GetNroIcon(config.icon);
+        }
 
-    if (config.gif.empty()) {
-        g_app->m_fs->read_entire_file("/config/sphaira/logo/StartupMovie.gif", config.gif);
+        if (config.logo.empty() || config.gif.empty()) {
+            if (!read_default_logo) {
+                read_default_logo = true;
+                g_app->m_fs->read_entire_file("/config/sphaira/logo/NintendoLogo.png", default_logo);
+                g_app->m_fs->read_entire_file("/config/sphaira/logo/StartupMovie.gif", default_gif);
+            }
+
+            if (config.logo.empty()) {
+                config.logo = default_logo;
+            }
+
+            if (config.gif.empty()) {
+                config.gif = default_gif;
+            }
+        }
     }
 
-    return install_forwarder(pbox, config, GetInstallSdEnable() ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser);
+    return install_forwarders(pbox, configs, GetInstallSdEnable() ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser, on_installed);
 }
 
 auto App::IsEmummc() -> bool {
@@ -1155,6 +1475,15 @@ void App::Poll() {
 }
 
 void App::Update() {
+    // audio is init after the first frame.
+    if (m_audio_ready.exchange(false)) {
+        LoadAndPlayThemeMusic();
+        LoadThemeSounds();
+    }
+
+    UpdateThemeMusic();
+    jobs::Update();
+
     // loop background music if it has finished.
     audio::State song_state;
     if (R_SUCCEEDED(audio::GetProgress(m_background_music, nullptr, &song_state))) {
@@ -1184,6 +1513,8 @@ void App::Update() {
 
     if (!m_widgets.empty() && popped_at_least1) {
         m_widgets.back()->OnFocusGained();
+        // leaving a menu is when its settings are done with.
+        FlushConfig();
     }
 }
 
@@ -1194,6 +1525,12 @@ void App::Draw() {
     nvgBeginFrame(this->vg, s_width, s_height, 1.f);
     nvgScale(vg, m_scale.x, m_scale.y);
 
+    // upload images decoded since the last frame, before the menus use them.
+    image::Upload(this->vg);
+    UpdateThemeImages();
+    ui::gfx::flushAtlas(this->vg);
+    ui::gfx::prewarmGlyphs(this->vg);
+
     // find the last menu in the list, start drawing from there
     auto menu_it = m_widgets.rend();
     for (auto it = m_widgets.rbegin(); it != m_widgets.rend(); it++) {
@@ -1211,7 +1548,11 @@ void App::Draw() {
 
             // draw everything not hidden on top of the menu.
             if (!p->IsHidden()) {
+                const auto draw_start = armGetSystemTick();
                 p->Draw(vg, &m_theme);
+
+                const auto name = p->IsMenu() ? static_cast<ui::menu::MenuBase*>(p.get())->GetShortTitle() : "popup";
+                utils::profile::AddMenuDraw(name, armTicksToNs(armGetSystemTick() - draw_start));
             }
 
             if (it == m_widgets.rbegin()) {
@@ -1222,6 +1563,10 @@ void App::Draw() {
 
     m_notif_manager.Draw(vg, &m_theme);
 
+    if (m_profile_overlay.Get()) {
+        ui::profile::Draw(vg, &m_theme);
+    }
+
     nvgResetTransform(vg);
     nvgEndFrame(this->vg);
     this->queue.presentImage(this->swapchain, slot);
@@ -1261,17 +1606,6 @@ void DrawElement(const Vec4& v, ThemeEntryID id) {
     }
 }
 
-auto App::LoadElementImage(std::string_view value) -> ElementEntry {
-    ElementEntry entry{};
-
-    entry.texture = nvgCreateImage(vg, value.data(), 0);
-    if (entry.texture) {
-        entry.type = ElementType::Texture;
-    }
-
-    return entry;
-}
-
 auto App::LoadElementColour(std::string_view value) -> ElementEntry {
     ElementEntry entry{};
 
@@ -1298,50 +1632,107 @@ auto App::LoadElementColour(std::string_view value) -> ElementEntry {
     return entry;
 }
 
-auto App::LoadElement(std::string_view value, ElementType type) -> ElementEntry {
-    if (value.size() <= 1) {
-        return {};
-    }
+void App::LoadThemeElement(ThemeEntryID id, std::string_view value, ElementType type) {
+    auto& slot = m_theme_images[id];
 
-    if (type == ElementType::None || type == ElementType::Colour) {
+    if (value.size() > 1) {
         // most assets are colours, so prioritise this first
-        if (auto e = LoadElementColour(value); e.type != ElementType::None) {
-            return e;
+        if (type == ElementType::None || type == ElementType::Colour) {
+            if (auto e = LoadElementColour(value); e.type != ElementType::None) {
+                slot.request.reset();
+                SetThemeElement(id, e);
+                return;
+            }
         }
-    }
 
-    if (type == ElementType::None || type == ElementType::Texture) {
-        if (auto e = LoadElementImage(value); e.type != ElementType::None) {
-            return e;
+        if (type == ElementType::None || type == ElementType::Texture) {
+            // themes inheriting from the same base share the image, so keep it.
+            if (slot.request ? slot.pending_path == value : slot.path == value) {
+                return;
+            }
+
+            // the previous element is kept until the image is decoded.
+            if (auto loader = CreateThemeImageLoader(std::string{value})) {
+                slot.pending_path = value;
+                slot.request = image::Push(std::move(loader), ImageFlag_None, THEME_IMAGE_KEY);
+                return;
+            }
         }
     }
 
-    return {};
+    slot.request.reset();
+    SetThemeElement(id, {});
+}
+
+void App::SetThemeElement(ThemeEntryID id, const ElementEntry& entry) {
+    auto& e = m_theme.elements[id];
+    if (e.type == ElementType::Texture) {
+        ui::gfx::deleteImage(vg, e.texture);
+    }
+
+    e = entry;
+    m_theme_images[id].path.clear();
+}
+
+void App::UpdateThemeImages() {
+    for (u32 i = 0; i < ThemeEntryID_MAX; i++) {
+        auto& slot = m_theme_images[i];
+        if (!slot.request) {
+            continue;
+        }
+
+        // dropped if it sat in the queue for too long, so push it again.
+        if (slot.request->IsCancelled()) {
+            slot.request.reset();
+            if (auto loader = CreateThemeImageLoader(slot.pending_path)) {
+                slot.request = image::Push(std::move(loader), ImageFlag_None, THEME_IMAGE_KEY);
+            }
+        } else if (!slot.request->IsDone()) {
+            slot.request->SetKey(THEME_IMAGE_KEY);
+        } else {
+            ElementEntry entry{};
+            if (const auto texture = slot.request->TakeImage()) {
+                entry.type = ElementType::Texture;
+                entry.texture = texture;
+            } else {
+                log_write("[THEME] failed to decode image: %s\n", slot.pending_path.c_str());
+            }
+
+            SetThemeElement((ThemeEntryID)i, entry);
+            slot.path = std::move(slot.pending_path);
+            slot.pending_path.clear();
+            slot.request.reset();
+            Invalidate();
+        }
+    }
 }
 
 void App::CloseThemeBackgroundMusic() {
+    m_theme_music_load.reset();
     audio::CloseSong(&m_background_music);
 }
 
 void App::CloseTheme() {
     CloseThemeBackgroundMusic();
+    audio::CloseSoundBank();
 
     for (auto& e : m_theme.elements) {
         if (e.type == ElementType::Texture) {
-            nvgDeleteImage(vg, e.texture);
+            ui::gfx::deleteImage(vg, e.texture);
         }
     }
 
+    std::ranges::fill(m_theme_images, ThemeImage{});
     m_theme = {};
 }
 
 void App::LoadTheme(const ThemeMeta& meta) {
-    // reset theme
-    CloseTheme();
+    // the elements are replaced in place rather than closing the theme, so
+    // that the previous images are drawn until the new ones are decoded.
+    CloseThemeBackgroundMusic();
+    audio::CloseSoundBank();
 
-    ThemeData theme_data{};
-    theme_data.music_path = m_default_music.Get();
-    LoadThemeInternal(meta, theme_data);
+    const auto& theme_data = GetThemeData(meta);
     m_theme.meta = meta;
 
     if (R_SUCCEEDED(romfsInit())) {
@@ -1349,13 +1740,17 @@ void App::LoadTheme(const ThemeMeta& meta) {
 
         // load all assets / colours.
         for (auto& e : THEME_ENTRIES) {
-            m_theme.elements[e.id] = LoadElement(theme_data.elements[e.id], e.type);
+            LoadThemeElement(e.id, theme_data.elements[e.id], e.type);
         }
-
-        // load music
-        m_theme.music_path = theme_data.music_path;
-        LoadAndPlayThemeMusic();
     }
+
+    // load music
+    m_theme.music_path = theme_data.has_music ? theme_data.music_path : fs::FsPath{m_default_music.Get()};
+    LoadAndPlayThemeMusic();
+
+    // load sound effects
+    std::ranges::copy(theme_data.sound_paths, m_theme.sound_paths);
+    LoadThemeSounds();
 }
 
 // todo: only use opendir on if romfs, otherwise use native fs
@@ -1403,12 +1798,34 @@ void App::ScanThemeEntries() {
 
 void App::LoadAndPlayThemeMusic() {
     if (App::GetThemeMusicEnable() && !m_theme.music_path.empty()) {
-        audio::CloseSong(&m_background_music);
-        audio::OpenSong(m_fs.get(), m_theme.music_path, audio::Flag_Loop, &m_background_music);
+        CloseThemeBackgroundMusic();
+
+        // opening the song reads and probes the file, so it's done off the
+        // main thread and started in Update() once it's open.
+        auto load = std::make_shared<ThemeMusicLoad>();
+        m_theme_music_load = load;
+        utils::task::Push([load, fs = m_fs, path = m_theme.music_path]() {
+            audio::OpenSong(fs.get(), path, audio::Flag_Loop, &load->song);
+            load->done = true;
+        });
+    }
+}
+
+void App::UpdateThemeMusic() {
+    if (m_theme_music_load && m_theme_music_load->done) {
+        m_background_music = std::exchange(m_theme_music_load->song, nullptr);
+        m_theme_music_load.reset();
         audio::PlaySong(m_background_music);
     }
 }
 
+// decoded once here, so that playing them never has to.
+void App::LoadThemeSounds() {
+    if (std::ranges::any_of(m_theme.sound_paths, [](auto& e){ return !e.empty(); })) {
+        audio::LoadSoundBank(m_fs.get(), m_theme.sound_paths);
+    }
+}
+
 Result App::SetDefaultBackgroundMusic(fs::Fs* fs, const fs::FsPath& path) {
     constexpr const char* base_path = "/config/sphaira/themes/default_music.";
 
@@ -1475,6 +1892,7 @@ App::App(const char* argv0) {
     SCOPED_TIMESTAMP("App Constructor");
 
     g_app = this;
+    ueventCreate(&m_dirty_event, true);
     m_start_timestamp = armGetSystemTick();
     if (!std::strncmp(argv0, "sdmc:/", 6)) {
         // memmove(path, path + 5, strlen(path)-5);
@@ -1488,6 +1906,11 @@ App::App(const char* argv0) {
         __nx_applet_exit_mode = 1;
     }
 
+    // applet mode has a much smaller heap, so keep less memory cached.
+    utils::budget::Init();
+    utils::pool::SetBudget(utils::budget::Get(utils::budget::Subsystem_BufferPool));
+    utils::block_cache::SetBudget(utils::budget::Get(utils::budget::Subsystem_BlockCache));
+
     // init fs for app use.
     m_fs = std::make_shared<fs::FsNativeSd>(true);
 
@@ -1514,6 +1937,8 @@ App::App(const char* argv0) {
             else if (app->m_install_emummc.LoadFrom(Key, Value)) {}
             else if (app->m_install_sd.LoadFrom(Key, Value)) {}
             else if (app->m_progress_boost_mode.LoadFrom(Key, Value)) {}
+            else if (app->m_profile_overlay.LoadFrom(Key, Value)) {}
+            else if (app->m_trace_enabled.LoadFrom(Key, Value)) {}
             else if (app->m_allow_downgrade.LoadFrom(Key, Value)) {}
             else if (app->m_skip_if_already_installed.LoadFrom(Key, Value)) {}
             else if (app->m_ticket_only.LoadFrom(Key, Value)) {}
@@ -1523,6 +1948,7 @@ App::App(const char* argv0) {
             else if (app->m_skip_data_patch.LoadFrom(Key, Value)) {}
             else if (app->m_skip_ticket.LoadFrom(Key, Value)) {}
             else if (app->m_skip_nca_hash_verify.LoadFrom(Key, Value)) {}
+            else if (app->m_skip_cached_hash_verify.LoadFrom(Key, Value)) {}
             else if (app->m_skip_rsa_header_fixed_key_verify.LoadFrom(Key, Value)) {}
             else if (app->m_skip_rsa_npdm_fixed_key_verify.LoadFrom(Key, Value)) {}
             else if (app->m_ignore_distribution_bit.LoadFrom(Key, Value)) {}
@@ -1530,6 +1956,7 @@ App::App(const char* argv0) {
             else if (app->m_convert_to_standard_crypto.LoadFrom(Key, Value)) {}
             else if (app->m_lower_master_key.LoadFrom(Key, Value)) {}
             else if (app->m_lower_system_version.LoadFrom(Key, Value)) {}
+            else if (app->m_install_dry_run.LoadFrom(Key, Value)) {}
         } else if (!std::strcmp(Section, "accessibility")) {
             if (app->m_text_scroll_speed.LoadFrom(Key, Value)) {}
         } else if (!std::strcmp(Section, "dump")) {
@@ -1574,6 +2001,12 @@ App::App(const char* argv0) {
             else if (app->m_mtp_show_install.LoadFrom(Key, Value)) {}
             else if (app->m_mtp_show_mounts.LoadFrom(Key, Value)) {}
             else if (app->m_mtp_show_speedtest.LoadFrom(Key, Value)) {}
+        } else if (!std::strcmp(Section, "transfer")) {
+            if (app->m_transfer_queue_depth.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_buffer_size.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_adaptive_queue.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_auto_tune.LoadFrom(Key, Value)) {}
+            else if (app->m_transfer_show_stage_speed.LoadFrom(Key, Value)) {}
         }
 
         return 1;
@@ -1583,9 +2016,15 @@ App::App(const char* argv0) {
     // loading each config one by one as it avoids re-opening the file multiple times.
     {
         SCOPED_TIMESTAMP("config init");
-        ini_browse(cb, this, CONFIG_PATH);
+        GetConfigStore().Browse([this](auto section, auto key, auto value) {
+            return cb(section, key, value, this);
+        });
     }
 
+    utils::trace::SetEnabled(m_trace_enabled.Get());
+    // bitmask of LogCategory, only used for debug logs.
+    log_set_category_mask(GetConfigStore().GetLong("log", "category_mask", -1));
+
     if (App::GetLogEnable()) {
         log_file_init();
         log_write("hello world v%s\n", APP_DISPLAY_VERSION);
@@ -1598,6 +2037,7 @@ App::App(const char* argv0) {
     // - 2: cannot use nvg code as its not thread-safe.
     // - 3: cannot be too slow that async takes longer than the main thread (ie, balance the load).
     // currrent load time is 60ms without logs, 90 with (down from 230ms).
+    // - 4: anything not needed for the first frame goes in StartDeferredInit().
     utils::Async async_init([this](){
         SCOPED_TIMESTAMP("App async load");
 
@@ -1618,34 +2058,6 @@ App::App(const char* argv0) {
             m_fs->DeleteFile("/switch/sphaira/cache/cache.json"); // old etag cache.
         }
 
-        if (log_is_init()) {
-            SCOPED_TIMESTAMP("fw log init");
-            SetSysFirmwareVersion fw_version{};
-            setsysInitialize();
-            ON_SCOPE_EXIT(setsysExit());
-            setsysGetFirmwareVersion(&fw_version);
-
-            log_write("[version] platform: %s\n", fw_version.platform);
-            log_write("[version] version_hash: %s\n", fw_version.version_hash);
-            log_write("[version] display_version: %s\n", fw_version.display_version);
-            log_write("[version] display_title: %s\n", fw_version.display_title);
-
-            splInitialize();
-            ON_SCOPE_EXIT(splExit());
-
-            u64 out{};
-            splGetConfig((SplConfigItem)65000, &out);
-            log_write("[ams] version: %lu.%lu.%lu\n", (out >> 56) & 0xFF, (out >> 48) & 0xFF, (out >> 40) & 0xFF);
-            log_write("[ams] target version: %lu.%lu.%lu\n", (out >> 24) & 0xFF, (out >> 16) & 0xFF, (out >> 8) & 0xFF);
-            log_write("[ams] key gen: %lu\n", (out >> 32) & 0xFF);
-
-            splGetConfig((SplConfigItem)65003, &out);
-            log_write("[ams] hash: %lx\n", out);
-
-            splGetConfig((SplConfigItem)65010, &out);
-            log_write("[ams] usb 3.0 enabled: %lu\n", out);
-        }
-
         // get emummc config.
         {
             SCOPED_TIMESTAMP("emummc detect init");
@@ -1666,97 +2078,20 @@ App::App(const char* argv0) {
 
         devoptab::FixDkpBug();
 
-#ifdef ENABLE_LIBHAZE
-        if (App::GetMtpEnable()) {
-            SCOPED_TIMESTAMP("mtp init");
-            libhaze::Init();
-        }
-#endif // ENABLE_LIBHAZE
-
-#ifdef ENABLE_FTPSRV
-        if (App::GetFtpEnable()) {
-            SCOPED_TIMESTAMP("ftp init");
-            ftpsrv::Init();
-        }
-#endif // ENABLE_FTPSRV
-
-        if (App::GetNxlinkEnable()) {
-            SCOPED_TIMESTAMP("nxlink init");
-            nxlinkInitialize(nxlink_callback);
-        }
-
-#ifdef ENABLE_LIBUSBHSFS
-        if (App::GetHddEnable()) {
-            SCOPED_TIMESTAMP("hdd init");
-            if (App::GetWriteProtect()) {
-                usbHsFsSetFileSystemMountFlags(UsbHsFsMountFlags_ReadOnly);
-            }
-
-            usbHsFsInitialize(1);
-        }
-#endif // ENABLE_LIBUSBHSFS
-
-#ifdef ENABLE_LIBUSBDVD
-        {
-            SCOPED_TIMESTAMP("usbdvd init");
-            if (R_FAILED(usbdvd::MountAll())) {
-                log_write("[USBDVD] failed to mount\n");
-            }
-        }
-#endif // ENABLE_LIBUSBDVD
-
         {
             SCOPED_TIMESTAMP("curl init");
             curl::Init();
         }
 
-        // this has to come after curl init as it inits curl global.
         {
-            SCOPED_TIMESTAMP("vfs init");
-            devoptab::MountVfsAll();
-        }
-
-        #ifdef ENABLE_DEVOPTAB_HTTP
-        {
-            SCOPED_TIMESTAMP("http init");
-            devoptab::MountHttpAll();
-        }
-        #endif // ENABLE_DEVOPTAB_HTTP
-
-        #ifdef ENABLE_DEVOPTAB_WEBDAV
-        {
-            SCOPED_TIMESTAMP("webdav init");
-            devoptab::MountWebdavAll();
-        }
-        #endif // ENABLE_DEVOPTAB_WEBDAV
-
-        #ifdef ENABLE_DEVOPTAB_FTP
-        {
-            SCOPED_TIMESTAMP("ftp init");
-            devoptab::MountFtpAll();
-        }
-        #endif // ENABLE_DEVOPTAB_FTP
-
-        #ifdef ENABLE_DEVOPTAB_SFTP
-        {
-            SCOPED_TIMESTAMP("sftp init");
-            devoptab::MountSftpAll();
-        }
-        #endif // ENABLE_DEVOPTAB_SFTP
-
-        #ifdef ENABLE_DEVOPTAB_NFS
-        {
-            SCOPED_TIMESTAMP("nfs init");
-            devoptab::MountNfsAll();
+            SCOPED_TIMESTAMP("task pool init");
+            utils::task::Init();
         }
-        #endif // ENABLE_DEVOPTAB_NFS
 
-        #ifdef ENABLE_DEVOPTAB_SMB2
         {
-            SCOPED_TIMESTAMP("smb init");
-            devoptab::MountSmb2All();
+            SCOPED_TIMESTAMP("image decode init");
+            image::Init();
         }
-        #endif // ENABLE_DEVOPTAB_SMB2
 
         {
             SCOPED_TIMESTAMP("game init");
@@ -1906,11 +2241,6 @@ App::App(const char* argv0) {
     // see: https://github.com/ITotalJustice/sphaira/issues/92
     if (IsAppletWithSuspendedApp()) {
         App::Notify("Audio disabled due to suspended game"_i18n);
-    } else {
-        SCOPED_TIMESTAMP("audio init");
-        if (R_FAILED(audio::Init())) {
-            log_write("[AUDIO] failed to init\n");
-        }
     }
 
     {
@@ -1941,6 +2271,167 @@ App::App(const char* argv0) {
     }
 }
 
+void App::StartDeferredInit() {
+    if (m_deferred_services || m_deferred_mounts) {
+        return;
+    }
+
+    const auto audio_enable = !IsAppletWithSuspendedApp();
+
+    m_deferred_services = std::make_unique<utils::Async>([this, audio_enable](){
+        SCOPED_TIMESTAMP("deferred services init");
+        TRACE_SCOPE("app::deferred_services");
+
+        if (log_is_init()) {
+            SCOPED_TIMESTAMP("fw log init");
+            SetSysFirmwareVersion fw_version{};
+            setsysInitialize();
+            ON_SCOPE_EXIT(setsysExit());
+            setsysGetFirmwareVersion(&fw_version);
+
+            log_write("[version] platform: %s\n", fw_version.platform);
+            log_write("[version] version_hash: %s\n", fw_version.version_hash);
+            log_write("[version] display_version: %s\n", fw_version.display_version);
+            log_write("[version] display_title: %s\n", fw_version.display_title);
+
+            splInitialize();
+            ON_SCOPE_EXIT(splExit());
+
+            u64 out{};
+            splGetConfig((SplConfigItem)65000, &out);
+            log_write("[ams] version: %lu.%lu.%lu\n", (out >> 56) & 0xFF, (out >> 48) & 0xFF, (out >> 40) & 0xFF);
+            log_write("[ams] target version: %lu.%lu.%lu\n", (out >> 24) & 0xFF, (out >> 16) & 0xFF, (out >> 8) & 0xFF);
+            log_write("[ams] key gen: %lu\n", (out >> 32) & 0xFF);
+
+            splGetConfig((SplConfigItem)65003, &out);
+            log_write("[ams] hash: %lx\n", out);
+
+            splGetConfig((SplConfigItem)65010, &out);
+            log_write("[ams] usb 3.0 enabled: %lu\n", out);
+        }
+
+#ifdef ENABLE_LIBHAZE
+        if (App::GetMtpEnable()) {
+            SCOPED_TIMESTAMP("mtp init");
+            libhaze::Init();
+        }
+#endif // ENABLE_LIBHAZE
+
+#ifdef ENABLE_FTPSRV
+        if (App::GetFtpEnable()) {
+            SCOPED_TIMESTAMP("ftp init");
+            ftpsrv::Init();
+        }
+#endif // ENABLE_FTPSRV
+
+        if (App::GetNxlinkEnable()) {
+            SCOPED_TIMESTAMP("nxlink init");
+            nxlinkInitialize(nxlink_callback);
+        }
+
+#ifdef ENABLE_LIBUSBHSFS
+        if (App::GetHddEnable()) {
+            SCOPED_TIMESTAMP("hdd init");
+            if (App::GetWriteProtect()) {
+                usbHsFsSetFileSystemMountFlags(UsbHsFsMountFlags_ReadOnly);
+            }
+
+            usbHsFsInitialize(1);
+        }
+#endif // ENABLE_LIBUSBHSFS
+
+#ifdef ENABLE_LIBUSBDVD
+        {
+            SCOPED_TIMESTAMP("usbdvd init");
+            if (R_FAILED(usbdvd::MountAll())) {
+                log_write("[USBDVD] failed to mount\n");
+            }
+        }
+#endif // ENABLE_LIBUSBDVD
+
+        if (audio_enable) {
+        SCOPED_TIMESTAMP("audio init");
+        if (R_FAILED(audio::Init())) {
+            log_write("[AUDIO] failed to init\n");
+        } else {
+            m_audio_ready = true;
+            App::Invalidate();
+        }
+        }
+    });
+
+    // network mounts may block on an unreachable host.
+    m_deferred_mounts = std::make_unique<utils::Async>([](){
+        SCOPED_TIMESTAMP("deferred mounts init");
+        TRACE_SCOPE("app::deferred_mounts");
+
+        // this has to come after curl init as it inits curl global, which is
+        // done in the constructor.
+        {
+            SCOPED_TIMESTAMP("vfs init");
+            devoptab::MountVfsAll();
+        }
+
+        #ifdef ENABLE_DEVOPTAB_HTTP
+        {
+            SCOPED_TIMESTAMP("http init");
+            devoptab::MountHttpAll();
+        }
+        #endif // ENABLE_DEVOPTAB_HTTP
+
+        #ifdef ENABLE_DEVOPTAB_WEBDAV
+        {
+            SCOPED_TIMESTAMP("webdav init");
+            devoptab::MountWebdavAll();
+        }
+        #endif // ENABLE_DEVOPTAB_WEBDAV
+
+        #ifdef ENABLE_DEVOPTAB_FTP
+        {
+            SCOPED_TIMESTAMP("ftp init");
+            devoptab::MountFtpAll();
+        }
+        #endif // ENABLE_DEVOPTAB_FTP
+
+        #ifdef ENABLE_DEVOPTAB_SFTP
+        {
+            SCOPED_TIMESTAMP("sftp init");
+            devoptab::MountSftpAll();
+        }
+        #endif // ENABLE_DEVOPTAB_SFTP
+
+        #ifdef ENABLE_DEVOPTAB_NFS
+        {
+            SCOPED_TIMESTAMP("nfs init");
+            devoptab::MountNfsAll();
+        }
+        #endif // ENABLE_DEVOPTAB_NFS
+
+        #ifdef ENABLE_DEVOPTAB_SMB2
+        {
+            SCOPED_TIMESTAMP("smb init");
+            devoptab::MountSmb2All();
+        }
+        #endif // ENABLE_DEVOPTAB_SMB2
+
+        // this has to come after all the mounts as it may index them.
+        {
+            SCOPED_TIMESTAMP("search init");
+            search::Init();
+        }
+
+        {
+            SCOPED_TIMESTAMP("trash init");
+            trash::Init();
+        }
+    });
+}
+
+void App::WaitDeferredInit() {
+    m_deferred_services.reset();
+    m_deferred_mounts.reset();
+}
+
 void App::PlaySoundEffect(SoundEffect effect) {
     audio::PlaySoundEffect(effect);
 }
@@ -2088,6 +2579,22 @@ void App::DisplayAdvancedOptions(bool left_side) {
             "Enables boost mode during transfers which can improve transfer speed. "
             "This sets the CPU to 1785mhz and lowers the GPU 76mhz"));
 
+    options->Add<ui::SidebarEntryBool>("Show profiler overlay"_i18n, App::GetApp()->m_profile_overlay,
+        "Shows frame times, the time spent drawing each menu and counters from the download and image queues."_i18n);
+
+    options->Add<ui::SidebarEntryBool>("Tracing"_i18n, App::GetApp()->m_trace_enabled, [](bool& enable){
+        utils::trace::SetEnabled(enable);
+    }, "Records the time spent in the ui, transfer, install, network and mount threads."_i18n);
+
+    options->Add<ui::SidebarEntryCallback>("Export trace"_i18n, [](){
+        const auto rc = utils::trace::Export();
+        if (R_FAILED(rc)) {
+            App::PushErrorBox(rc, "Failed to export trace"_i18n);
+        } else {
+            App::Notify("Exported to /switch/sphaira/trace.json"_i18n);
+        }
+    }, "Writes the recorded trace to /switch/sphaira/trace.json, which can be opened in ui.perfetto.dev"_i18n);
+
     options->Add<ui::SidebarEntryArray>("Text scroll speed"_i18n, text_scroll_speed_items, [](s64& index_out){
         App::SetTextScrollSpeed(index_out);
     }, App::GetTextScrollSpeed(), "Change how fast the scrolling text updates"_i18n);
@@ -2159,6 +2666,10 @@ void App::DisplayAdvancedOptions(bool left_side) {
     options->Add<ui::SidebarEntryCallback>("Export options"_i18n, [left_side](){
         App::DisplayDumpOptions(left_side);
     },  "Change the export options."_i18n);
+
+    options->Add<ui::SidebarEntryCallback>("Transfer options"_i18n, [left_side](){
+        App::DisplayTransferOptions(left_side);
+    },  "Change the buffering used when copying, installing and exporting."_i18n);
 }
 
 void App::DisplayInstallOptions(bool left_side) {
@@ -2213,6 +2724,9 @@ void App::DisplayInstallOptions(bool left_side) {
             "That check performs various hash checks, including the hash over the NCA.\n\n"
             "It is recommended to keep this disabled."));
 
+    options->Add<ui::SidebarEntryBool>("Skip verify on reinstall"_i18n, App::GetApp()->m_skip_cached_hash_verify,
+        "Skips the NCA hash verify when reinstalling a file that was verified before and hasn't changed since."_i18n);
+
     options->Add<ui::SidebarEntryBool>("Skip RSA header verify"_i18n, App::GetApp()->m_skip_rsa_header_fixed_key_verify,
         i18n::get("nca_verify_info",
             "Enables the option to skip RSA NCA fixed key verification. "
@@ -2254,6 +2768,12 @@ void App::DisplayInstallOptions(bool left_side) {
             "Sets the system_firmware field in the cnmt extended header to 0. "
             "Note: if the master key is higher than fw version, the game still won't launch as the fw won't have the key to decrypt keak (see above).\n\n"
             "It is recommended to keep this disabled."));
+
+    options->Add<ui::SidebarEntryBool>("Dry run (benchmark)"_i18n, App::GetApp()->m_install_dry_run,
+        i18n::get("install_dry_run_info",
+            "Runs the install without writing anything to storage, the read / decompress / hash speed of each NCA is written to the log. "
+            "Used to check whether the source or the SD card / NAND is limiting the install speed.\n\n"
+            "Nothing is installed whilst this is enabled."));
 }
 
 void App::DisplayDumpOptions(bool left_side) {
@@ -2312,6 +2832,8 @@ void App::DisplayDumpOptions(bool left_side) {
             "Sets the compression level used when exporting to NSZ.\n\n"
             "NOTE: The switch CPU is not very fast, and setting the value too high can "
             "result in exporting taking a very long time for very little gain in size.\n\n"
+            "Auto raises the level whilst the export is limited by the read / write speed, "
+            "and lowers it if compressing becomes the slowest part.\n\n"
             "It is recommended to set this value to 3."
         )
     );
@@ -2350,6 +2872,61 @@ void App::DisplayDumpOptions(bool left_side) {
     block_size_option->Depends(App::GetApp()->m_nsz_compress_block, "NSZ block compression is disabled."_i18n);
 }
 
+void App::DisplayTransferOptions(bool left_side) {
+    auto options = std::make_unique<ui::Sidebar>("Transfer Options"_i18n, left_side ? ui::Sidebar::Side::LEFT : ui::Sidebar::Side::RIGHT);
+    ON_SCOPE_EXIT(App::Push(std::move(options)));
+
+    ui::SidebarEntryArray::Items queue_depth_items;
+    for (auto& e : TRANSFER_QUEUE_DEPTH_OPTIONS) {
+        queue_depth_items.emplace_back(i18n::get(e.name));
+    }
+
+    ui::SidebarEntryArray::Items buffer_size_items;
+    for (auto& e : TRANSFER_BUFFER_SIZE_OPTIONS) {
+        buffer_size_items.emplace_back(i18n::get(e.name));
+    }
+
+    options->Add<ui::SidebarEntryArray>("Queue depth"_i18n, queue_depth_items, [](s64& index_out){
+        g_app->m_transfer_queue_depth.Set(index_out);
+    }, g_app->m_transfer_queue_depth.Get(),
+        i18n::get("transfer_queue_depth_info",
+            "Sets the number of buffers queued between the read, decompress and write threads.\n\n"
+            "A higher value can help absorb slow downs from bursty sources, such as network mounts or USB, "
+            "at the cost of using more memory."
+        )
+    );
+
+    options->Add<ui::SidebarEntryArray>("Buffer size"_i18n, buffer_size_items, [](s64& index_out){
+        g_app->m_transfer_buffer_size.Set(index_out);
+    }, g_app->m_transfer_buffer_size.Get(),
+        "Sets the size of each buffer in the queue."_i18n
+    );
+
+    options->Add<ui::SidebarEntryBool>("Adaptive queue depth"_i18n, g_app->m_transfer_adaptive_queue,
+        i18n::get("transfer_adaptive_queue_info",
+            "Grows the queue whilst the writer is waiting on data, up to 8 buffers. "
+            "In applet mode, the queue is shrunk if memory is running low."
+        )
+    );
+
+    options->Add<ui::SidebarEntryBool>("Auto tune"_i18n, g_app->m_transfer_auto_tune,
+        i18n::get("transfer_auto_tune_info",
+            "Measures the speed of each copy between two places, ie, SD card to USB, "
+            "and picks the fastest buffer size, queue depth and number of readers for the next copy.
+
+"
+            "Now and then different settings are tried to keep the speeds up to date."
+        )
+    );
+
+    options->Add<ui::SidebarEntryBool>("Show stage speed"_i18n, g_app->m_transfer_show_stage_speed,
+        i18n::get("transfer_show_stage_speed_info",
+            "Shows the read, decompress and write speed in the progress box.\n\n"
+            "Useful for finding out which stage is slowing down a transfer."
+        )
+    );
+}
+
 void App::DisplayFtpOptions(bool left_side) {
     // todo: prompt on exit to restart ftp server if options were changed.
     auto options = std::make_unique<ui::Sidebar>("FTP Options"_i18n, left_side ? ui::Sidebar::Side::LEFT : ui::Sidebar::Side::RIGHT);
@@ -2653,10 +3230,23 @@ App::~App() {
     App::SetBoostMode(true);
 
     log_write("starting to exit\n");
+    {
+        const auto stats = evman::get_stats();
+        log_write("[EVMAN] coalesced: %lu overflowed: %lu\n", stats.coalesced, stats.overflowed);
+    }
+
+    utils::mem::LogStats("exit");
+
     {
         SCOPED_TIMESTAMP("TOTAL EXIT");
         appletUnhook(&m_appletHookCookie);
 
+        // the services have to be init before they can be signalled to exit.
+        {
+            SCOPED_TIMESTAMP("deferred init wait");
+            WaitDeferredInit();
+        }
+
         // async exit as these threads sleep every 100ms.
         {
             SCOPED_TIMESTAMP("async signal");
@@ -2664,6 +3254,10 @@ App::~App() {
             ftpsrv::ExitSignal();
 #endif // ENABLE_FTPSRV
             nxlinkSignalExit();
+            search::ExitSignal();
+            trash::ExitSignal();
+            jobs::ExitSignal();
+            image::ExitSignal();
             audio::ExitSignal();
             curl::ExitSignal();
         }
@@ -2678,7 +3272,37 @@ App::~App() {
             }
         }
 
+        // jobs are progress boxes, so they also free images.
+        {
+            SCOPED_TIMESTAMP("jobs exit");
+            jobs::Exit();
+        }
+
+        // after the widgets, as they may still be waiting on tasks.
+        {
+            SCOPED_TIMESTAMP("task pool exit");
+            utils::task::Exit();
+        }
+
+        // this frees images that weren't taken, so it also needs nvg.
+        {
+            SCOPED_TIMESTAMP("image decode exit");
+            image::Exit();
+            ui::gfx::exitAtlas(this->vg);
+        }
+
         utils::Async async_exit([this](){
+            // this has to come before any of the mounts are removed.
+            {
+                SCOPED_TIMESTAMP("search exit");
+                search::Exit();
+            }
+
+            {
+                SCOPED_TIMESTAMP("trash exit");
+                trash::Exit();
+            }
+
             {
                 SCOPED_TIMESTAMP("i18n_exit");
                 i18n::exit();
@@ -2739,10 +3363,16 @@ App::~App() {
         // do not async close theme as it frees textures.
         {
             SCOPED_TIMESTAMP("theme exit");
-            ini_puts("config", "theme", m_theme.meta.ini_path, CONFIG_PATH);
+            GetConfigStore().Set("config", "theme", m_theme.meta.ini_path.s);
             CloseTheme();
         }
 
+        // widgets and the theme save their state above.
+        {
+            SCOPED_TIMESTAMP("config flush");
+            FlushConfig();
+        }
+
         {
             SCOPED_TIMESTAMP("destroy frame buffer resources");
             this->destroyFramebufferResources();
@@ -2755,6 +3385,7 @@ App::~App() {
             this->renderer.reset();
 
     #ifdef USE_NVJPG
+            ImageExit();
             m_decoder.finalize();
             nj::finalize();
     #endif
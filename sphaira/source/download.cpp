@@ -5,17 +5,23 @@
 #include "fs.hpp"
 #include "app.hpp"
 #include "utils/thread.hpp"
+#include "utils/trace.hpp"
+#include "utils/mem_track.hpp"
 
 #include <switch.h>
 #include <cstring>
 #include <cassert>
 #include <vector>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <algorithm>
 #include <ranges>
+#include <bit>
+#include <string_view>
+#include <ctime>
+#include <span>
 #include <curl/curl.h>
-#include <yyjson.h>
 
 namespace sphaira::curl {
 namespace {
@@ -25,6 +31,11 @@ namespace {
         log_write("curl_easy_setopt(%s, %s) msg: %s\n", #opt, #v, curl_easy_strerror(r)); \
     } \
 
+#define CURL_MULTI_SETOPT_LOG(handle, opt, v) \
+    if (auto r = curl_multi_setopt(handle, opt, v); r != CURLM_OK) { \
+        log_write("curl_multi_setopt(%s, %s) msg: %s\n", #opt, #v, curl_multi_strerror(r)); \
+    } \
+
 #define CURL_SHARE_SETOPT_LOG(handle, opt, v) \
     if (auto r = curl_share_setopt(handle, opt, v); r != CURLSHE_OK) { \
         log_write("curl_share_setopt(%s, %s) msg: %s\n", #opt, #v, curl_share_strerror(r)); \
@@ -32,9 +43,38 @@ namespace {
 
 constexpr auto API_AGENT = "TotalJustice";
 constexpr u64 CHUNK_SIZE = 1024*1024;
-constexpr auto MAX_THREADS = 4;
+// max number of async transfers that are active at once.
+constexpr auto MAX_TRANSFERS = 16;
+// how long to poll the sockets for before checking the queue again.
+// this is only hit if curl_multi_wakeup() isn't supported.
+constexpr int POLL_TIMEOUT_MS = 50;
+// max connections per host, http2 hosts only use one connection as the
+// transfers are multiplexed over it, this limit is for http1 hosts.
+constexpr auto MAX_HOST_CONNECTIONS = 6;
+// number of ranges a segmented download is split into.
+constexpr auto SEGMENT_COUNT = 4;
+// files smaller than this are downloaded normally.
+constexpr s64 SEGMENT_MIN_SIZE = 1024 * 1024 * 16;
+// tls sessions are saved on exit so that the first connection to a host
+// on the next launch can resume rather than do a full handshake.
+constexpr fs::FsPath TLS_SESSION_PATH{"/switch/sphaira/cache/tls_sessions.bin"};
+constexpr u32 TLS_SESSION_MAGIC = 0x31534C54; // TLS1
+// reads of a remote file smaller than this are not split.
+constexpr s64 REMOTE_SEGMENT_MIN_SIZE = 1024 * 512;
+// how many times a single segment is retried before giving up.
+constexpr u32 SEGMENT_RETRY_MAX = 3;
+// queued requests whose key hasn't been set for this long are stale.
+constexpr u64 REQUEST_STALE_NS = 5e+8; // 500ms
+// partial downloads smaller than this are not kept for resuming.
+constexpr s64 RESUME_MIN_SIZE = 1024 * 1024;
 
 std::atomic_bool g_running{};
+// ring buffer of the last finished transfers.
+Mutex g_metrics_mutex{};
+Metrics g_metrics[METRICS_HISTORY]{};
+u64 g_metrics_index{};
+// set if libcurl was built with http2 support.
+bool g_has_http2{};
 CURLSH* g_curl_share{};
 // this is used for single threaded blocking installs.
 // avoids the needed for re-creating the handle each time.
@@ -53,6 +93,10 @@ struct DataStruct {
     s64 offset{};
     fs::File f{};
     s64 file_offset{};
+    // set when resuming a partial download, see WriteFileCallback().
+    CURL* curl{};
+    s64 resume_offset{};
+    bool resume_checked{};
 };
 
 struct SeekCustomData {
@@ -60,38 +104,27 @@ struct SeekCustomData {
     s64 size{};
 };
 
-auto generate_key_from_path(const fs::FsPath& path) -> std::string {
-    const auto key = crc32Calculate(path.s, path.size());
-    return std::to_string(key);
-}
-
 void Yield() {
     svcSleepThread(YieldType_WithoutCoreMigration);
 }
 
+auto IsStopRequested(const Api& api) -> bool {
+    return api.GetToken().stop_requested() || (api.GetRequest() && api.GetRequest()->IsCancelled());
+}
+
+// etag / last-modified cache, keyed by a hash of the download path.
+// the cache is an append only log of records, later records replace earlier ones.
+// updates are batched and appended on idle / exit, the log is rewritten once
+// it contains too many replaced records.
+// lookups are done using an in memory open addressed table.
 struct Cache {
     using Value = std::pair<std::string, std::string>;
 
     bool init() {
         SCOPED_MUTEX(&m_mutex);
 
-        if (!m_json) {
-            auto json_in = yyjson_read_file(JSON_PATH, YYJSON_READ_NOFLAG, nullptr, nullptr);
-            if (json_in) {
-                log_write("loading old json doc\n");
-                m_json = yyjson_doc_mut_copy(json_in, nullptr);
-                yyjson_doc_free(json_in);
-                m_root = yyjson_mut_doc_get_root(m_json);
-            } else {
-                log_write("creating new json doc\n");
-                m_json = yyjson_mut_doc_new(nullptr);
-                m_root = yyjson_mut_obj(m_json);
-                yyjson_mut_doc_set_root(m_json, m_root);
-            }
-        }
-
-        if (!m_json) {
-            return false;
+        if (!m_init_ref_count) {
+            load();
         }
 
         m_init_ref_count++;
@@ -102,7 +135,7 @@ struct Cache {
     void exit() {
         SCOPED_MUTEX(&m_mutex);
 
-        if (!m_json) {
+        if (!m_init_ref_count) {
             return;
         }
 
@@ -111,20 +144,20 @@ struct Cache {
             return;
         }
 
-        // note: this takes 20ms
-        if (!yyjson_mut_write_file(JSON_PATH, m_json, YYJSON_WRITE_NOFLAG, nullptr, nullptr)) {
-            log_write("[ETAG] failed to write etag json: %s\n", JSON_PATH.s);
-        }
-
-        yyjson_mut_doc_free(m_json);
-        m_json = nullptr;
-        m_root = nullptr;
+        flush_internal();
+        m_slots.clear();
+        m_values.clear();
+        m_pending.clear();
         log_write("[ETAG] exit\n");
     }
 
-    void get(const fs::FsPath& path, curl::Header& header) {
-        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+    // appends any pending updates to the log.
+    void flush() {
+        SCOPED_MUTEX(&m_mutex);
+        flush_internal();
+    }
 
+    void get(const fs::FsPath& path, curl::Header& header) {
         const auto [etag, last_modified] = get_internal(path);
         if (!etag.empty()) {
             header.m_map.emplace("if-none-match", etag);
@@ -136,8 +169,6 @@ struct Cache {
     }
 
     void set(const fs::FsPath& path, const curl::Header& value) {
-        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
-
         std::string etag_str;
         std::string last_modified_str;
 
@@ -149,198 +180,333 @@ struct Cache {
         }
 
         if (!etag_str.empty() || !last_modified_str.empty()) {
+            SCOPED_MUTEX(&m_mutex);
             set_internal(path, Value{etag_str, last_modified_str});
         }
     }
 
 private:
-    auto get_internal(const fs::FsPath& path) -> Value {
-        if (!fs::FsNativeSd().FileExists(path)) {
-            return {};
+    struct Slot {
+        u64 key;
+        // index into m_values, or EMPTY_SLOT.
+        u32 index;
+    };
+
+    struct RecordHeader {
+        u64 key;
+        u16 etag_len;
+        u16 last_modified_len;
+    };
+
+    struct FileHeader {
+        u32 magic;
+        u32 version;
+    };
+
+    // fnv-1a, 64bit so that collisions between paths are very unlikely.
+    static auto hash_path(const fs::FsPath& path) -> u64 {
+        u64 hash = 0xCBF29CE484222325ULL;
+        for (const auto c : std::string_view{path.s, path.size()}) {
+            hash ^= (u8)c;
+            hash *= 0x100000001B3ULL;
         }
+        return hash;
+    }
 
-        const auto kkey = generate_key_from_path(path);
-        const auto it = m_cache.find(kkey);
-        if (it != m_cache.end()) {
-            return it->second;
+    // returns the slot for the key, which is either the matching or empty slot.
+    auto find_slot(u64 key) -> Slot& {
+        const auto mask = m_slots.size() - 1;
+        for (auto i = key & mask;; i = (i + 1) & mask) {
+            auto& slot = m_slots[i];
+            if (slot.index == EMPTY_SLOT || slot.key == key) {
+                return slot;
+            }
         }
+    }
 
-        auto hash_key = yyjson_mut_obj_getn(m_root, kkey.c_str(), kkey.length());
-        if (!hash_key) {
-            return {};
+    // grows the table so that it stays at most half full.
+    void reserve_slots(size_t count) {
+        if (m_slots.size() >= count * 2 && !m_slots.empty()) {
+            return;
         }
 
-        auto etag_key = yyjson_mut_obj_get(hash_key, ETAG_STR);
-        auto last_modified_key = yyjson_mut_obj_get(hash_key, LAST_MODIFIED_STR);
+        const auto old_slots = std::move(m_slots);
+        m_slots.assign(std::bit_ceil(std::max<size_t>(count * 2, MIN_SLOTS)), Slot{0, EMPTY_SLOT});
+        for (const auto& slot : old_slots) {
+            if (slot.index != EMPTY_SLOT) {
+                find_slot(slot.key) = slot;
+            }
+        }
+    }
 
-        const auto etag_value = yyjson_mut_get_str(etag_key);
-        const auto etag_value_len = yyjson_mut_get_len(etag_key);
-        const auto last_modified_value = yyjson_mut_get_str(last_modified_key);
-        const auto last_modified_value_len = yyjson_mut_get_len(last_modified_key);
+    // inserts or replaces the value, returns true if the value changed.
+    auto insert(u64 key, const Value& value) -> bool {
+        reserve_slots(m_values.size() + 1);
 
-        if ((!etag_value || !etag_value_len) && (!last_modified_value || !last_modified_value_len)) {
-            return {};
+        auto& slot = find_slot(key);
+        if (slot.index != EMPTY_SLOT) {
+            if (m_values[slot.index].second == value) {
+                return false;
+            }
+
+            m_values[slot.index].second = value;
+            return true;
+        }
+
+        slot = Slot{key, (u32)m_values.size()};
+        m_values.emplace_back(key, value);
+        return true;
+    }
+
+    void load() {
+        m_slots.clear();
+        m_values.clear();
+        m_pending.clear();
+        m_log_records = 0;
+        reserve_slots(0);
+
+        fs::FsNativeSd fs;
+        std::vector<u8> buf;
+        if (R_FAILED(fs.read_entire_file(BIN_PATH, buf))) {
+            // the old json cache is no longer used.
+            fs.DeleteFile(OLD_JSON_PATH);
+            log_write("[ETAG] creating new cache\n");
+            return;
+        }
+
+        FileHeader file_header{};
+        if (buf.size() < sizeof(file_header)) {
+            log_write("[ETAG] cache too small, ignoring\n");
+            return;
         }
 
-        std::string etag;
-        std::string last_modified;
-        if (etag_value && etag_value_len) {
-            etag.assign(etag_value, etag_value_len);
+        std::memcpy(&file_header, buf.data(), sizeof(file_header));
+        if (file_header.magic != MAGIC || file_header.version != VERSION) {
+            log_write("[ETAG] bad cache header, ignoring\n");
+            return;
         }
-        if (last_modified_value && last_modified_value_len) {
-            last_modified.assign(last_modified_value, last_modified_value_len);
+
+        // a partially written record at the end is ignored, it will be
+        // removed on the next compaction.
+        for (size_t off = sizeof(file_header); off + sizeof(RecordHeader) <= buf.size();) {
+            RecordHeader header;
+            std::memcpy(&header, buf.data() + off, sizeof(header));
+            off += sizeof(header);
+
+            if (off + header.etag_len + header.last_modified_len > buf.size()) {
+                break;
+            }
+
+            const auto str = (const char*)buf.data() + off;
+            insert(header.key, Value{std::string{str, header.etag_len}, std::string{str + header.etag_len, header.last_modified_len}});
+            off += header.etag_len + header.last_modified_len;
+            m_log_records++;
         }
 
-        const Value ret{etag, last_modified};
-        m_cache.insert_or_assign(it, kkey, ret);
-        return ret;
+        log_write("[ETAG] loaded %zu entries from %u records\n", m_values.size(), m_log_records);
     }
 
-    void set_internal(const fs::FsPath& path, const Value& value) {
-        const auto kkey = generate_key_from_path(path);
+    static void append_record(std::vector<u8>& buf, u64 key, const Value& value) {
+        const auto& [etag, last_modified] = value;
+        const RecordHeader header{key, (u16)std::min<size_t>(etag.length(), UINT16_MAX), (u16)std::min<size_t>(last_modified.length(), UINT16_MAX)};
+
+        const auto off = buf.size();
+        buf.resize(off + sizeof(header) + header.etag_len + header.last_modified_len);
+        std::memcpy(buf.data() + off, &header, sizeof(header));
+        std::memcpy(buf.data() + off + sizeof(header), etag.data(), header.etag_len);
+        std::memcpy(buf.data() + off + sizeof(header) + header.etag_len, last_modified.data(), header.last_modified_len);
+    }
 
-        // check if we already have this entry
-        const auto it = m_cache.find(kkey);
-        if (it != m_cache.end() && it->second == value) {
-            log_write("already has etag, not updating, path: %s key: %s\n", path.s, kkey.c_str());
+    void flush_internal() {
+        if (m_pending.empty()) {
             return;
         }
 
-        if (it != m_cache.end()) {
-            log_write("updating etag, path: %s key: %s\n", path.s, kkey.c_str());
+        fs::FsNativeSd fs;
+        fs.CreateDirectoryRecursivelyWithPath(BIN_PATH);
+
+        std::vector<u8> buf;
+        const auto compact = !m_log_records || m_log_records + m_pending.size() > m_values.size() * COMPACT_RATIO;
+
+        if (compact) {
+            // rewrite the whole log with only the latest records.
+            const FileHeader file_header{MAGIC, VERSION};
+            buf.resize(sizeof(file_header));
+            std::memcpy(buf.data(), &file_header, sizeof(file_header));
+
+            for (const auto& [key, value] : m_values) {
+                append_record(buf, key, value);
+            }
+
+            if (R_FAILED(fs.write_entire_file(BIN_PATH, buf))) {
+                log_write("[ETAG] failed to write cache: %s\n", BIN_PATH.s);
+                return;
+            }
+
+            m_log_records = m_values.size();
+            log_write("[ETAG] compacted cache, entries: %zu\n", m_values.size());
         } else {
-            log_write("setting new etag, path: %s key: %s\n", path.s, kkey.c_str());
+            for (const auto key : m_pending) {
+                append_record(buf, key, m_values[find_slot(key).index].second);
+            }
+
+            fs::File f;
+            s64 size;
+            if (R_FAILED(fs.OpenFile(BIN_PATH, FsOpenMode_Write|FsOpenMode_Append, &f)) || R_FAILED(f.GetSize(&size)) || R_FAILED(f.Write(size, buf.data(), buf.size(), FsWriteOption_None))) {
+                log_write("[ETAG] failed to append cache: %s\n", BIN_PATH.s);
+                return;
+            }
+
+            m_log_records += m_pending.size();
+            log_write("[ETAG] appended %zu records\n", m_pending.size());
         }
 
-        // insert new entry into cache, this will never fail.
-        const auto& [jkey, jvalue] = *m_cache.insert_or_assign(it, kkey, value);
-        const auto& [etag, last_modified] = jvalue;
+        m_pending.clear();
+    }
 
-        // check if we need to add a new entry to root or simply update the value.
-        auto hash_key = yyjson_mut_obj_getn(m_root, kkey.c_str(), kkey.length());
-        if (!hash_key) {
-            hash_key = yyjson_mut_obj_add_obj(m_json, m_root, jkey.c_str());
+    auto get_internal(const fs::FsPath& path) -> Value {
+        if (!fs::FsNativeSd().FileExists(path)) {
+            return {};
         }
 
-        if (!hash_key) {
-            log_write("failed to set new cache key obj, path: %s key: %s\n", path.s, jkey.c_str());
-        } else {
-            const auto update_entry = [this, &hash_key](const char* tag, const std::string& value) {
-                if (value.empty()) {
-                    // workaround for appstore accepting etags but not returning them.
-                    yyjson_mut_obj_remove_str(hash_key, tag);
-                    return true;
-                } else {
-                    auto key = yyjson_mut_obj_get(hash_key, tag);
-                    if (!key) {
-                        return yyjson_mut_obj_add_str(m_json, hash_key, tag, value.c_str());
-                    } else {
-                        return yyjson_mut_set_str(key, value.c_str());
-                    }
-                }
-            };
+        SCOPED_MUTEX(&m_mutex);
+        if (m_slots.empty()) {
+            return {};
+        }
 
-            if (!update_entry("etag", etag)) {
-                log_write("failed to set new etag, path: %s key: %s\n", path.s, jkey.c_str());
-            }
+        const auto& slot = find_slot(hash_path(path));
+        if (slot.index == EMPTY_SLOT) {
+            return {};
+        }
 
-            if (!update_entry("last-modified", last_modified)) {
-                log_write("failed to set new last-modified, path: %s key: %s\n", path.s, jkey.c_str());
-            }
+        return m_values[slot.index].second;
+    }
+
+    void set_internal(const fs::FsPath& path, const Value& value) {
+        // note: the cache is only usable between init() and exit().
+        if (!m_init_ref_count) {
+            return;
+        }
+
+        const auto key = hash_path(path);
+        if (!insert(key, value)) {
+            log_write("already has etag, not updating, path: %s\n", path.s);
+            return;
+        }
+
+        log_write("setting etag, path: %s\n", path.s);
+        if (std::ranges::find(m_pending, key) == m_pending.end()) {
+            m_pending.emplace_back(key);
+        }
+
+        if (m_pending.size() >= FLUSH_THRESHOLD) {
+            flush_internal();
         }
     }
 
-    static constexpr inline fs::FsPath JSON_PATH{"/switch/sphaira/cache/etag_v2.json"};
+    static constexpr inline fs::FsPath BIN_PATH{"/switch/sphaira/cache/etag_v3.bin"};
+    static constexpr inline fs::FsPath OLD_JSON_PATH{"/switch/sphaira/cache/etag_v2.json"};
     static constexpr inline const char* ETAG_STR{"etag"};
     static constexpr inline const char* LAST_MODIFIED_STR{"last-modified"};
+    static constexpr u32 MAGIC = 0x33475445; // ETG3
+    static constexpr u32 VERSION = 1;
+    static constexpr u32 EMPTY_SLOT = UINT32_MAX;
+    static constexpr size_t MIN_SLOTS = 256;
+    // pending updates are written once there's this many, or on idle / exit.
+    static constexpr size_t FLUSH_THRESHOLD = 64;
+    // the log is compacted once it's this many times larger than the entries.
+    static constexpr size_t COMPACT_RATIO = 2;
 
     Mutex m_mutex{};
-    yyjson_mut_doc* m_json{};
-    yyjson_mut_val* m_root{};
-    std::unordered_map<std::string, Value> m_cache{};
+    std::vector<Slot> m_slots{};
+    std::vector<std::pair<u64, Value>> m_values{};
+    // keys of updates that have yet to be written.
+    std::vector<u64> m_pending{};
+    // number of records in the log on disk.
+    u32 m_log_records{};
     u32 m_init_ref_count{};
 };
 
-struct ThreadEntry {
-    auto Create() -> Result {
-        m_curl = curl_easy_init();
-        R_UNLESS(m_curl != nullptr, Result_CurlFailedEasyInit);
-
-        ueventCreate(&m_uevent, true);
-        R_TRY(utils::CreateThread(&m_thread, ThreadFunc, this, 1024*32));
-        R_TRY(threadStart(&m_thread));
-        R_SUCCEED();
-    }
+// per transfer state, curl holds pointers into this so it must not be moved
+// until the transfer has finished.
+struct Transfer {
+    Transfer(const Api& _api, CURL* _curl, bool _is_upload) : api{_api}, curl{_curl}, is_upload{_is_upload} {}
+    Transfer(const Transfer&) = delete;
+    Transfer& operator=(const Transfer&) = delete;
 
-    void SignalClose() {
-        ueventSignal(&m_uevent);
-    }
+    ~Transfer() {
+        utils::trace::RecordAsync(is_upload ? "curl::upload" : "curl::download", start_tick);
 
-    void Close() {
-        SignalClose();
-        threadWaitForExit(&m_thread);
-        threadClose(&m_thread);
-        if (m_curl) {
-            curl_easy_cleanup(m_curl);
-            m_curl = nullptr;
+        if (list) {
+            curl_slist_free_all(list);
         }
-    }
-
-    auto InProgress() -> bool {
-        return m_in_progress == true;
-    }
 
-    auto Setup(const Api& api) -> bool {
-        assert(m_in_progress == false && "Setting up thread while active");
-        mutexLock(&m_mutex);
-        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+        if (auto_sleep_disabled) {
+            App::SetAutoSleepDisabled(false);
+        }
 
-        if (m_in_progress) {
-            return false;
+        if (has_resume_key) {
+            ReleaseResumeKey(resume_key);
         }
-        m_api = api;
-        m_in_progress = true;
-        // log_write("started download :)\n");
-        ueventSignal(&m_uevent);
-        return true;
     }
 
-    static void ThreadFunc(void* p);
-
-    CURL* m_curl{};
-    Thread m_thread{};
-    Api m_api{};
-    std::atomic_bool m_in_progress{};
-    Mutex m_mutex{};
-    UEvent m_uevent{};
-};
+    const Api api;
+    CURL* const curl;
+    const bool is_upload;
+    const u64 start_tick{armGetSystemTick()};
 
-struct ThreadQueueEntry {
-    Api api;
-    bool m_delete{};
+    bool has_file{};
+    bool auto_sleep_disabled{};
+    std::string url{};
+    std::string encoded_url{};
+    fs::FsNativeSd fs{};
+    fs::FsPath tmp_buf{};
+    bool has_resume_key{};
+    u32 resume_key{};
+    fs::FsPath meta_buf{};
+    Cache::Value resume_meta{};
+    UploadStruct chunk_in{};
+    DataStruct chunk{};
+    SeekCustomData seek_data{};
+    Header header_in{};
+    Header header_out{};
+    curl_slist* list{};
 };
 
-struct ThreadQueue {
-    std::deque<ThreadQueueEntry> m_entries{};
-    Thread m_thread{};
-    Mutex m_mutex{};
-    UEvent m_uevent{};
-
+// a single thread drives all async transfers using the curl multi interface.
+// transfers are started from the queue as slots free up, in priority order.
+// the multi handle (and share handle) keeps connections alive between transfers
+// so that requests to the same host reuse the connection.
+struct TransferQueue {
     auto Create() -> Result {
         ueventCreate(&m_uevent, true);
-        R_TRY(utils::CreateThread(&m_thread, ThreadFunc, this, 1024*32));
+
+        m_multi = curl_multi_init();
+        R_UNLESS(m_multi != nullptr, Result_CurlFailedEasyInit);
+
+        CURL_MULTI_SETOPT_LOG(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)MAX_TRANSFERS);
+        CURL_MULTI_SETOPT_LOG(m_multi, CURLMOPT_MAXCONNECTS, (long)MAX_TRANSFERS);
+        CURL_MULTI_SETOPT_LOG(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)MAX_HOST_CONNECTIONS);
+        CURL_MULTI_SETOPT_LOG(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+        R_TRY(utils::CreateThread(&m_thread, ThreadFunc, this, 1024*64));
         R_TRY(threadStart(&m_thread));
         R_SUCCEED();
     }
 
     void SignalClose() {
-        ueventSignal(&m_uevent);
+        Wakeup();
     }
 
     void Close() {
         SignalClose();
         threadWaitForExit(&m_thread);
         threadClose(&m_thread);
+
+        if (m_multi) {
+            curl_multi_cleanup(m_multi);
+            m_multi = nullptr;
+        }
     }
 
     auto Add(const Api& api, bool is_upload = false) -> bool {
@@ -351,24 +517,100 @@ struct ThreadQueue {
         mutexLock(&m_mutex);
         ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
+        Api* entry{};
         switch (api.GetPriority()) {
             case Priority::Normal:
-                m_entries.emplace_back(api).api.SetUpload(is_upload);
+                entry = &m_entries.emplace_back(api);
                 break;
             case Priority::High:
-                m_entries.emplace_front(api).api.SetUpload(is_upload);
+                entry = &m_entries.emplace_front(api);
                 break;
         }
 
+        entry->SetUpload(is_upload);
+        entry->SetQueuedTick(armGetSystemTick());
+
+        m_queued_peak = std::max<u32>(m_queued_peak, m_entries.size());
+        Wakeup();
+        return true;
+    }
+
+    void Wakeup() {
+        // the uevent wakes the thread when idle, curl_multi_wakeup wakes it
+        // whilst it's polling the sockets of active transfers.
         ueventSignal(&m_uevent);
+        if (m_multi) {
+            curl_multi_wakeup(m_multi);
+        }
+    }
+
+    // pops the queued request with the lowest key, requests without a key
+    // have a key of 0, ties are started in queue order.
+    auto Pop(Api& out) -> bool {
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        m_dropped += std::erase_if(m_entries, [](auto& e) {
+            return IsStopRequested(e);
+        });
+
+        if (m_entries.empty()) {
+            return false;
+        }
+
+        const auto now = armGetSystemTick();
+        const auto get_key = [now](const Api& e) -> std::pair<bool, s64> {
+            const auto& request = e.GetRequest();
+            if (!request) {
+                return {false, 0};
+            }
+
+            const auto stale = armTicksToNs(now - request->GetTick()) >= REQUEST_STALE_NS;
+            return {stale, request->GetKey()};
+        };
+
+        auto best = m_entries.begin();
+        auto best_key = get_key(*best);
+        for (auto it = std::next(best); it != m_entries.end(); it++) {
+            const auto key = get_key(*it);
+            if (key < best_key) {
+                best = it;
+                best_key = key;
+            }
+        }
+
+        out = *best;
+        m_entries.erase(best);
         return true;
     }
 
+    auto GetStats() -> Stats {
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        return Stats{
+            .queued = (u32)m_entries.size(),
+            .queued_peak = m_queued_peak,
+            .active = m_active,
+            .dropped = m_dropped,
+        };
+    }
+
     static void ThreadFunc(void* p);
+
+    std::deque<Api> m_entries{};
+    Thread m_thread{};
+    Mutex m_mutex{};
+    UEvent m_uevent{};
+    CURLM* m_multi{};
+
+    // stats, protected by m_mutex, apart from m_active.
+    u32 m_queued_peak{};
+    std::atomic<u32> m_active{};
+    u64 m_dropped{};
 };
 
-ThreadEntry g_threads[MAX_THREADS]{};
-ThreadQueue g_thread_queue;
+TransferQueue g_transfer_queue;
 Cache g_cache;
 
 void GetDownloadTempPath(fs::FsPath& buf) {
@@ -383,8 +625,60 @@ void GetDownloadTempPath(fs::FsPath& buf) {
     std::snprintf(buf, sizeof(buf), "/switch/sphaira/cache/download_temp%lu", count_copy);
 }
 
+// partial downloads are kept at a path keyed by the url so that they can be
+// resumed, the etag / last-modified of the partial response is saved next to it.
+Mutex g_resume_mutex{};
+std::vector<u32> g_resume_keys{};
+
+// returns false if the key is already used by an active download.
+auto AcquireResumeKey(u32 key) -> bool {
+    SCOPED_MUTEX(&g_resume_mutex);
+
+    if (std::ranges::find(g_resume_keys, key) != g_resume_keys.end()) {
+        return false;
+    }
+
+    g_resume_keys.emplace_back(key);
+    return true;
+}
+
+void ReleaseResumeKey(u32 key) {
+    SCOPED_MUTEX(&g_resume_mutex);
+    std::erase(g_resume_keys, key);
+}
+
+void GetResumePaths(u32 key, fs::FsPath& tmp_buf, fs::FsPath& meta_buf) {
+    std::snprintf(tmp_buf, sizeof(tmp_buf), "/switch/sphaira/cache/download_resume_%08X", key);
+    std::snprintf(meta_buf, sizeof(meta_buf), "%s.meta", tmp_buf.s);
+}
+
+// the meta file is the etag and last-modified, separated by a newline.
+auto LoadResumeMeta(fs::Fs& fs, const fs::FsPath& path, Cache::Value& out) -> bool {
+    std::vector<u8> buf;
+    if (R_FAILED(fs.read_entire_file(path, buf))) {
+        return false;
+    }
+
+    const std::string_view str{(const char*)buf.data(), buf.size()};
+    const auto pos = str.find('\n');
+    if (pos == str.npos) {
+        return false;
+    }
+
+    out.first = str.substr(0, pos);
+    out.second = str.substr(pos + 1);
+    return !out.first.empty() || !out.second.empty();
+}
+
+auto SaveResumeMeta(fs::Fs& fs, const fs::FsPath& path, const Cache::Value& value) -> bool {
+    const auto str = value.first + "\n" + value.second;
+    fs.DeleteFile(path);
+    return R_SUCCEEDED(fs.write_entire_file(path, {(const u8*)str.data(), str.length()}));
+}
+
 auto ProgressCallbackFunc1(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> size_t {
-    if (!g_running) {
+    auto api = static_cast<Api*>(clientp);
+    if (!g_running || IsStopRequested(*api)) {
         return 1;
     }
 
@@ -394,7 +688,7 @@ auto ProgressCallbackFunc1(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
 
 auto ProgressCallbackFunc2(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> size_t {
     auto api = static_cast<Api*>(clientp);
-    if (!g_running || api->GetToken().stop_requested()) {
+    if (!g_running || IsStopRequested(*api)) {
         return 1;
     }
 
@@ -516,6 +810,22 @@ auto WriteMemoryCallback(void *contents, size_t size, size_t num_files, void *us
     return realsize;
 }
 
+auto WriteCustomCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+    if (!g_running) {
+        return 0;
+    }
+
+    auto api = static_cast<const Api*>(userp);
+    const auto realsize = size * num_files;
+
+    if (!api->GetOnData()(contents, realsize)) {
+        return 0;
+    }
+
+    Yield();
+    return realsize;
+}
+
 auto WriteFileCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
     if (!g_running) {
         return 0;
@@ -524,6 +834,23 @@ auto WriteFileCallback(void *contents, size_t size, size_t num_files, void *user
     auto data_struct = static_cast<DataStruct*>(userp);
     const auto realsize = size * num_files;
 
+    // the server ignored the range or the file has changed since the partial
+    // download, in which case the whole file is sent, so start from the beginning.
+    if (data_struct->resume_offset && !data_struct->resume_checked) {
+        data_struct->resume_checked = true;
+
+        long http_code = 0;
+        curl_easy_getinfo(data_struct->curl, CURLINFO_RESPONSE_CODE, &http_code);
+        if (http_code != 206) {
+            log_write("[CURL] unable to resume, code: %ld\n", http_code);
+            data_struct->resume_offset = 0;
+            data_struct->file_offset = 0;
+            if (R_FAILED(data_struct->f.SetSize(0))) {
+                return 0;
+            }
+        }
+    }
+
     // flush data if incomming data would overflow the buffer
     if (data_struct->offset && data_struct->data.size() < data_struct->offset + realsize) {
         if (R_FAILED(data_struct->f.Write(data_struct->file_offset, data_struct->data.data(), data_struct->offset, FsWriteOption_None))) {
@@ -634,6 +961,11 @@ void SetCommonCurlOptions(CURL* curl, const Api& e) {
     // enable TE is server supports it.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_TRANSFER_ENCODING, 1L);
 
+    // use http2 for https if the server supports it, otherwise falls back to http1.1.
+    if (g_has_http2) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    }
+
     // set flags.
     if (e.GetFlags() & Flag_NoBody) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_NOBODY, 1L);
@@ -671,112 +1003,211 @@ void SetCommonCurlOptions(CURL* curl, const Api& e) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_PORT, (long)e.GetPort());
     }
 
-    // progress calls.
+    // progress calls, these also abort the transfer if stop is requested.
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, &e);
     if (e.GetOnProgress()) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, &e);
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc2);
     } else {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
     }
+}
+
+void SetHeaders(CURL* curl, const Header& header_in, curl_slist*& list) {
+    for (const auto& [key, value] : header_in.m_map) {
+        if (value.empty()) {
+            continue;
+        }
+
+        // create header key value pair.
+        const auto header_str = key + ": " + value;
+
+        // try to append header chunk.
+        auto temp = curl_slist_append(list, header_str.c_str());
+        if (temp) {
+            log_write("adding header: %s\n", header_str.c_str());
+            list = temp;
+        } else {
+            log_write("failed to append header\n");
+        }
+    }
 
+    if (list) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+    }
 }
-auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
-    App::SetAutoSleepDisabled(true);
-    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
+
+auto SetupDownload(Transfer& t) -> bool {
+    const auto& e = t.api;
+    const auto curl = t.curl;
 
     // check if stop has been requested before starting download
-    if (e.GetToken().stop_requested()) {
-        return {};
+    if (IsStopRequested(e)) {
+        return false;
     }
 
-    fs::FsPath tmp_buf;
-    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
+    App::SetAutoSleepDisabled(true);
+    t.auto_sleep_disabled = true;
+
+    t.has_file = !e.GetPath().empty() && e.GetPath() != "";
     const bool has_post = !e.GetFields().empty() && e.GetFields() != "";
-    const auto encoded_url = EncodeUrl(e.GetUrl());
+    t.encoded_url = EncodeUrl(e.GetUrl());
+    t.header_in = e.GetHeader();
+
+    if (t.has_file) {
+        // if the same url is already being downloaded, use a normal temp file.
+        const auto key = crc32Calculate(e.GetUrl().data(), e.GetUrl().length());
+        if (AcquireResumeKey(key)) {
+            t.has_resume_key = true;
+            t.resume_key = key;
+            GetResumePaths(key, t.tmp_buf, t.meta_buf);
+        } else {
+            GetDownloadTempPath(t.tmp_buf);
+        }
 
-    DataStruct chunk;
-    Header header_in = e.GetHeader();
-    Header header_out;
-    fs::FsNativeSd fs;
+        t.fs.CreateDirectoryRecursivelyWithPath(t.tmp_buf);
 
-    if (has_file) {
-        GetDownloadTempPath(tmp_buf);
-        fs.CreateDirectoryRecursivelyWithPath(tmp_buf);
+        // check for a partial download that can be resumed.
+        s64 resume_offset{};
+        if (t.has_resume_key && LoadResumeMeta(t.fs, t.meta_buf, t.resume_meta)) {
+            fs::File f;
+            if (R_SUCCEEDED(t.fs.OpenFile(t.tmp_buf, FsOpenMode_Read, &f))) {
+                f.GetSize(&resume_offset);
+            }
+        }
 
-        if (auto rc = fs.CreateFile(tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
-            log_write("failed to create file: %s\n", tmp_buf.s);
-            return {};
+        if (auto rc = t.fs.CreateFile(t.tmp_buf, 0, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+            log_write("failed to create file: %s\n", t.tmp_buf.s);
+            return false;
         }
 
-        if (R_FAILED(fs.OpenFile(tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &chunk.f))) {
-            log_write("failed to open file: %s\n", tmp_buf.s);
-            return {};
+        if (R_FAILED(t.fs.OpenFile(t.tmp_buf, FsOpenMode_Write|FsOpenMode_Append, &t.chunk.f))) {
+            log_write("failed to open file: %s\n", t.tmp_buf.s);
+            return false;
+        }
+
+        if (resume_offset) {
+            // If-Range makes the server send the whole file if it has changed.
+            const auto& [etag, last_modified] = t.resume_meta;
+            log_write("[CURL] resuming download from: %zd %s\n", resume_offset, e.GetUrl().c_str());
+            t.header_in.m_map.insert_or_assign("range", "bytes=" + std::to_string(resume_offset) + "-");
+            t.header_in.m_map.insert_or_assign("if-range", !etag.empty() ? etag : last_modified);
+            t.chunk.curl = curl;
+            t.chunk.resume_offset = resume_offset;
+            t.chunk.file_offset = resume_offset;
+        } else {
+            t.resume_meta = {};
+            // remove any stale data left from a previous download.
+            t.chunk.f.SetSize(0);
         }
 
         // only add etag if the dst file still exists.
-        if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&fs.m_fs, e.GetPath())) {
-            g_cache.get(e.GetPath(), header_in);
+        if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&t.fs.m_fs, e.GetPath())) {
+            g_cache.get(e.GetPath(), t.header_in);
         }
     }
 
+    const bool has_on_data = !t.has_file && e.GetOnData();
+
     // reserve the first chunk
-    chunk.data.reserve(CHUNK_SIZE);
+    if (!has_on_data) {
+        t.chunk.data.reserve(CHUNK_SIZE);
+    }
 
     curl_easy_reset(curl);
     SetCommonCurlOptions(curl, e);
 
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, t.encoded_url.c_str());
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &t.header_out);
 
     if (has_post) {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_POSTFIELDS, e.GetFields().c_str());
         log_write("setting post field: %s\n", e.GetFields().c_str());
     }
 
-    struct curl_slist* list = NULL;
-    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
+    SetHeaders(curl, t.header_in, t.list);
 
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
+    // write calls.
+    if (has_on_data) {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, WriteCustomCallback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &e);
+    } else {
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, t.has_file ? WriteFileCallback : WriteMemoryCallback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &t.chunk);
+    }
+    return true;
+}
 
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
+// saves the meta of a failed download so that it can be resumed on the next attempt.
+// compressed responses are not kept as the range would be of the compressed data.
+auto KeepPartialDownload(Transfer& t, long http_code) -> bool {
+    if (!t.has_resume_key || t.chunk.file_offset < RESUME_MIN_SIZE || http_code == 416) {
+        return false;
+    }
 
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
+    if (auto it = t.header_out.Find("content-encoding"); it != t.header_out.m_map.end() && it->second != "identity") {
+        return false;
     }
 
-    if (list) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+    // use the validators of this response, otherwise the ones the partial was resumed with.
+    Cache::Value meta{};
+    if (auto it = t.header_out.Find("etag"); it != t.header_out.m_map.end()) {
+        meta.first = it->second;
+    }
+    if (auto it = t.header_out.Find("last-modified"); it != t.header_out.m_map.end()) {
+        meta.second = it->second;
+    }
+    if (meta.first.empty() && meta.second.empty()) {
+        meta = t.resume_meta;
     }
 
-    // write calls.
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, has_file ? WriteFileCallback : WriteMemoryCallback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk);
+    // weak etags can't be used with If-Range.
+    if (meta.first.starts_with("W/")) {
+        meta.first.clear();
+    }
 
-    // perform download and cleanup after and report the result.
-    const auto res = curl_easy_perform(curl);
+    if (meta.first.empty() && meta.second.empty()) {
+        return false;
+    }
+
+    if (!SaveResumeMeta(t.fs, t.meta_buf, meta)) {
+        return false;
+    }
+
+    log_write("[CURL] keeping partial download: %zd %s\n", t.chunk.file_offset, t.api.GetUrl().c_str());
+    return true;
+}
+
+auto FinishDownload(Transfer& t, CURLcode res) -> ApiResult {
+    const auto& e = t.api;
     bool success = res == CURLE_OK;
 
     long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(t.curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+    if (t.has_file) {
+        bool keep_partial{};
+        ON_SCOPE_EXIT(
+            if (!keep_partial) {
+                t.fs.DeleteFile(t.tmp_buf);
+                if (t.has_resume_key) {
+                    t.fs.DeleteFile(t.meta_buf);
+                }
+            }
+        );
 
-    if (has_file) {
-        ON_SCOPE_EXIT( fs.DeleteFile(tmp_buf) );
-        if (res == CURLE_OK && chunk.offset) {
-            chunk.f.Write(chunk.file_offset, chunk.data.data(), chunk.offset, FsWriteOption_None);
+        // flush on failure as well, as the data is kept for resuming.
+        if (t.chunk.offset) {
+            if (R_SUCCEEDED(t.chunk.f.Write(t.chunk.file_offset, t.chunk.data.data(), t.chunk.offset, FsWriteOption_None))) {
+                t.chunk.file_offset += t.chunk.offset;
+            }
         }
 
-        chunk.f.Close();
+        t.chunk.f.Close();
+
+        if (res != CURLE_OK) {
+            keep_partial = KeepPartialDownload(t, http_code);
+        }
 
         if (res == CURLE_OK) {
             if (http_code == 304) {
@@ -784,59 +1215,57 @@ auto DownloadInternal(CURL* curl, const Api& e) -> ApiResult {
             } else {
                 log_write("un-cached download: %s code: %lu\n", e.GetUrl().c_str(), http_code);
                 if (e.GetFlags() & Flag_Cache) {
-                    g_cache.set(e.GetPath(), header_out);
+                    g_cache.set(e.GetPath(), t.header_out);
                 }
 
                 // enable to log received headers.
                 #if 0
                 log_write("\n\nLOGGING HEADER\n");
-                    for (auto [a, b] : header_out.m_map) {
+                    for (auto [a, b] : t.header_out.m_map) {
                         log_write("\t%s: %s\n", a.c_str(), b.c_str());
                     }
                 log_write("\n\n");
                 #endif
 
-                fs.DeleteFile(e.GetPath());
-                fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
-                if (R_FAILED(fs.RenameFile(tmp_buf, e.GetPath()))) {
+                t.fs.DeleteFile(e.GetPath());
+                t.fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
+                if (R_FAILED(t.fs.RenameFile(t.tmp_buf, e.GetPath()))) {
                     success = false;
                 }
             }
         }
-        chunk.data.clear();
+        t.chunk.data.clear();
     } else {
         // empty data if we failed
         if (res != CURLE_OK) {
-            chunk.data.clear();
+            t.chunk.data.clear();
         }
     }
 
     log_write("Downloaded %s code: %ld %s\n", e.GetUrl().c_str(), http_code, curl_easy_strerror(res));
-    return {success, http_code, header_out, chunk.data, e.GetPath()};
+    return {success, http_code, t.header_out, std::move(t.chunk.data), e.GetPath()};
 }
 
-auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
+auto SetupUpload(Transfer& t) -> bool {
+    const auto& e = t.api;
+    const auto curl = t.curl;
+
     // check if stop has been requested before starting download
-    if (e.GetToken().stop_requested()) {
-        return {};
+    if (IsStopRequested(e)) {
+        return false;
     }
 
     const auto& info = e.GetUploadInfo();
-    const auto url = e.GetUrl() + "/" + info.m_name;
-    const auto encoded_url = EncodeUrl(url);
-    const bool has_file = !e.GetPath().empty() && e.GetPath() != "";
-
-    UploadStruct chunk{};
-    DataStruct chunk_out{};
-    SeekCustomData seek_data{};
-    Header header_in = e.GetHeader();
-    Header header_out;
-    fs::FsNativeSd fs{};
-
-    if (has_file) {
-        if (R_FAILED(fs.OpenFile(e.GetPath(), FsOpenMode_Read, &chunk.f))) {
+    t.url = e.GetUrl() + "/" + info.m_name;
+    t.encoded_url = EncodeUrl(t.url);
+    t.has_file = !e.GetPath().empty() && e.GetPath() != "";
+    t.header_in = e.GetHeader();
+
+    auto& chunk = t.chunk_in;
+    if (t.has_file) {
+        if (R_FAILED(t.fs.OpenFile(e.GetPath(), FsOpenMode_Read, &chunk.f))) {
             log_write("failed to open file: %s\n", e.GetPath().s);
-            return {};
+            return false;
         }
 
         chunk.f.GetSize(&chunk.size);
@@ -851,24 +1280,24 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
         }
     }
 
-    if (url.starts_with("file://")) {
-        const auto folder_path = fs::AppendPath("/", url.substr(std::strlen("file://")));
+    if (t.url.starts_with("file://")) {
+        const auto folder_path = fs::AppendPath("/", t.url.substr(std::strlen("file://")));
         log_write("creating local folder: %s\n", folder_path.s);
         // create the folder as libcurl doesn't seem to manually create it.
-        fs.CreateDirectoryRecursivelyWithPath(folder_path);
+        t.fs.CreateDirectoryRecursivelyWithPath(folder_path);
         // remove the path so that libcurl can upload over it.
-        fs.DeleteFile(folder_path);
+        t.fs.DeleteFile(folder_path);
     }
 
     // reserve the first chunk
-    chunk_out.data.reserve(CHUNK_SIZE);
+    t.chunk.data.reserve(CHUNK_SIZE);
 
     curl_easy_reset(curl);
     SetCommonCurlOptions(curl, e);
 
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, t.encoded_url.c_str());
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &t.header_out);
 
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_UPLOAD, 1L);
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)chunk.size);
@@ -876,30 +1305,7 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
     // instruct libcurl to create ftp folders if they don't yet exist.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_FTP_CREATE_MISSING_DIRS, CURLFTP_CREATE_DIR_RETRY);
 
-    struct curl_slist* list = NULL;
-    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
-
-    for (const auto& [key, value] : header_in.m_map) {
-        if (value.empty()) {
-            continue;
-        }
-
-        // create header key value pair.
-        const auto header_str = key + ": " + value;
-
-        // try to append header chunk.
-        auto temp = curl_slist_append(list, header_str.c_str());
-        if (temp) {
-            log_write("adding header: %s\n", header_str.c_str());
-            list = temp;
-        } else {
-            log_write("failed to append header\n");
-        }
-    }
-
-    if (list) {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
-    }
+    SetHeaders(curl, t.header_in, t.list);
 
     // set callback for reading more data.
     if (info.m_callback) {
@@ -907,13 +1313,13 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_READDATA, &info);
 
         if (e.GetOnUploadSeek()) {
-            seek_data.cb = e.GetOnUploadSeek();
-            seek_data.size = chunk.size;
+            t.seek_data.cb = e.GetOnUploadSeek();
+            t.seek_data.size = chunk.size;
             CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKFUNCTION, SeekCustomCallback);
-            CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKDATA, &seek_data);
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_SEEKDATA, &t.seek_data);
         }
     } else {
-        CURL_EASY_SETOPT_LOG(curl, CURLOPT_READFUNCTION, has_file ? ReadFileCallback : ReadMemoryCallback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_READFUNCTION, t.has_file ? ReadFileCallback : ReadMemoryCallback);
         CURL_EASY_SETOPT_LOG(curl, CURLOPT_READDATA, &chunk);
 
         // allow for seeking upon uploads, may be used for ftp and http.
@@ -923,21 +1329,416 @@ auto UploadInternal(CURL* curl, const Api& e) -> ApiResult {
 
     // write calls.
     CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &chunk_out);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_WRITEDATA, &t.chunk);
+    return true;
+}
 
-    // perform upload and cleanup after and report the result.
-    const auto res = curl_easy_perform(curl);
-    bool success = res == CURLE_OK;
+auto FinishUpload(Transfer& t, CURLcode res) -> ApiResult {
+    const bool success = res == CURLE_OK;
 
     long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(t.curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+    if (t.has_file) {
+        t.chunk_in.f.Close();
+    }
+
+    log_write("Uploaded %s code: %ld %s\n", t.url.c_str(), http_code, curl_easy_strerror(res));
+    return {success, http_code, t.header_out, std::move(t.chunk.data)};
+}
+
+auto SetupTransfer(Transfer& t) -> bool {
+    return t.is_upload ? SetupUpload(t) : SetupDownload(t);
+}
+
+auto GetInfoNs(CURL* curl, CURLINFO info) -> u64 {
+    curl_off_t us{};
+    curl_easy_getinfo(curl, info, &us);
+    return us * 1000;
+}
+
+void RecordMetrics(const Transfer& t, CURLcode res) {
+    Metrics m{};
+    m.success = res == CURLE_OK;
+    curl_easy_getinfo(t.curl, CURLINFO_RESPONSE_CODE, &m.code);
+
+    char* url{};
+    if (curl_easy_getinfo(t.curl, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK && url) {
+        std::string_view host{url};
+        if (const auto pos = host.find("://"); pos != host.npos) {
+            host.remove_prefix(pos + 3);
+        }
+        m.host = host.substr(0, host.find('/'));
+    }
+
+    long version{};
+    curl_easy_getinfo(t.curl, CURLINFO_HTTP_VERSION, &version);
+    switch (version) {
+        case CURL_HTTP_VERSION_1_0: case CURL_HTTP_VERSION_1_1: m.http_version = 1; break;
+        case CURL_HTTP_VERSION_2_0: m.http_version = 2; break;
+        case CURL_HTTP_VERSION_3: m.http_version = 3; break;
+    }
+
+    long connects{};
+    curl_easy_getinfo(t.curl, CURLINFO_NUM_CONNECTS, &connects);
+    m.reused = !connects;
+
+    // curl reports the time from the start until each step, so take the
+    // previous step away to get the time spent in each one.
+    const auto dns = GetInfoNs(t.curl, CURLINFO_NAMELOOKUP_TIME_T);
+    const auto connect = GetInfoNs(t.curl, CURLINFO_CONNECT_TIME_T);
+    const auto tls = GetInfoNs(t.curl, CURLINFO_APPCONNECT_TIME_T);
+    const auto ttfb = GetInfoNs(t.curl, CURLINFO_STARTTRANSFER_TIME_T);
+    m.dns_ns = dns;
+    m.connect_ns = connect > dns ? connect - dns : 0;
+    m.tls_ns = tls > connect ? tls - connect : 0;
+    m.ttfb_ns = ttfb > std::max(connect, tls) ? ttfb - std::max(connect, tls) : 0;
+    m.total_ns = GetInfoNs(t.curl, CURLINFO_TOTAL_TIME_T);
+
+    curl_off_t bytes{};
+    curl_easy_getinfo(t.curl, t.is_upload ? CURLINFO_SIZE_UPLOAD_T : CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    m.bytes = bytes;
+
+    if (const auto queued = t.api.GetQueuedTick(); queued && t.start_tick > queued) {
+        m.queue_ns = armTicksToNs(t.start_tick - queued);
+    }
+
+    log_write("[CURL] metrics {\"host\":\"%s\",\"code\":%ld,\"http\":%u,\"reused\":%u,\"queue_ms\":%.2f,\"dns_ms\":%.2f,\"connect_ms\":%.2f,\"tls_ms\":%.2f,\"ttfb_ms\":%.2f,\"total_ms\":%.2f,\"bytes\":%zd}\n",
+        m.host.c_str(), m.code, m.http_version, m.reused, m.queue_ns / 1e+6, m.dns_ns / 1e+6, m.connect_ns / 1e+6, m.tls_ns / 1e+6, m.ttfb_ns / 1e+6, m.total_ns / 1e+6, m.bytes);
+
+    SCOPED_MUTEX(&g_metrics_mutex);
+    g_metrics[g_metrics_index++ % METRICS_HISTORY] = std::move(m);
+}
+
+auto FinishTransfer(Transfer& t, CURLcode res) -> ApiResult {
+    RecordMetrics(t, res);
+    return t.is_upload ? FinishUpload(t, res) : FinishDownload(t, res);
+}
+
+// blocking transfer on the calling thread.
+auto PerformTransfer(CURL* curl, const Api& e, bool is_upload) -> ApiResult {
+    if (!curl) {
+        return {};
+    }
+
+    Transfer t{e, curl, is_upload};
+    if (!SetupTransfer(t)) {
+        return {};
+    }
+
+    return FinishTransfer(t, curl_easy_perform(curl));
+}
+
+struct Segment {
+    fs::File* f{};
+    // offset the segment started at, used for progress.
+    s64 begin{};
+    // next offset to write to.
+    s64 offset{};
+    // last byte of the segment, inclusive.
+    s64 end{};
+    u32 retries{};
+    CURL* curl{};
+    std::string range{};
+};
+
+auto WriteSegmentCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+    if (!g_running) {
+        return 0;
+    }
+
+    auto segment = static_cast<Segment*>(userp);
+    const auto realsize = size * num_files;
+
+    // the server ignored the range and is sending more than was asked for.
+    if (segment->offset + (s64)realsize > segment->end + 1) {
+        log_write("[CURL] segment overflow, offset: %zd end: %zd size: %zu\n", segment->offset, segment->end, realsize);
+        return 0;
+    }
 
-    if (has_file) {
-        chunk.f.Close();
+    if (R_FAILED(segment->f->Write(segment->offset, contents, realsize, FsWriteOption_None))) {
+        return 0;
     }
 
-    log_write("Uploaded %s code: %ld %s\n", url.c_str(), http_code, curl_easy_strerror(res));
-    return {success, http_code, header_out, chunk_out.data};
+    segment->offset += realsize;
+    return realsize;
+}
+
+// downloads the file in parallel ranges, falls back to a normal download if
+// the file is small or the server doesn't support ranges.
+auto DownloadSegmented(CURL* curl, const Api& e) -> ApiResult {
+    TRACE_SCOPE("curl::download_segmented");
+    if (!curl || IsStopRequested(e)) {
+        return {};
+    }
+
+    App::SetAutoSleepDisabled(true);
+    ON_SCOPE_EXIT(App::SetAutoSleepDisabled(false));
+
+    const auto encoded_url = EncodeUrl(e.GetUrl());
+    Header header_in = e.GetHeader();
+    Header header_out;
+    fs::FsNativeSd fs;
+
+    // only add etag if the dst file still exists.
+    if ((e.GetFlags() & Flag_Cache) && fs::FileExists(&fs.m_fs, e.GetPath())) {
+        g_cache.get(e.GetPath(), header_in);
+    }
+
+    // 1. get the size and check that ranges are supported.
+    long http_code{};
+    curl_off_t size{};
+    {
+        curl_slist* list{};
+        ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
+
+        curl_easy_reset(curl);
+        SetCommonCurlOptions(curl, e);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_NOBODY, 1L);
+        // ranges are of the encoded data, so disable compression.
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_ACCEPT_ENCODING, (char*)nullptr);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+        SetHeaders(curl, header_in, list);
+
+        const auto res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+
+        if (res == CURLE_OK && http_code == 304) {
+            log_write("cached download: %s\n", e.GetUrl().c_str());
+            return {true, http_code, header_out, {}, e.GetPath()};
+        }
+
+        const auto it = header_out.Find("accept-ranges");
+        const auto has_ranges = it != header_out.m_map.end() && it->second == "bytes";
+
+        if (res != CURLE_OK || !has_ranges || size < SEGMENT_MIN_SIZE) {
+            log_write("[CURL] not using segments, res: %s ranges: %u size: %zd\n", curl_easy_strerror(res), has_ranges, (s64)size);
+            return PerformTransfer(curl, e, false);
+        }
+    }
+
+    // 2. create the temp file at its full size so that segments can be written in any order.
+    fs::FsPath tmp_buf;
+    GetDownloadTempPath(tmp_buf);
+    fs.CreateDirectoryRecursivelyWithPath(tmp_buf);
+    ON_SCOPE_EXIT(fs.DeleteFile(tmp_buf));
+
+    if (auto rc = fs.CreateFile(tmp_buf, size, 0); R_FAILED(rc) && rc != FsError_PathAlreadyExists) {
+        log_write("failed to create file: %s\n", tmp_buf.s);
+        return {};
+    }
+
+    fs::File f;
+    if (R_FAILED(fs.OpenFile(tmp_buf, FsOpenMode_Write, &f)) || R_FAILED(f.SetSize(size))) {
+        log_write("failed to open file: %s\n", tmp_buf.s);
+        return {};
+    }
+
+    // 3. download all segments in parallel.
+    auto multi = curl_multi_init();
+    if (!multi) {
+        return {};
+    }
+    ON_SCOPE_EXIT(curl_multi_cleanup(multi));
+
+    // conditional headers are only used for the HEAD request above.
+    curl_slist* list{};
+    ON_SCOPE_EXIT(if (list) { curl_slist_free_all(list); } );
+
+    Segment segments[SEGMENT_COUNT]{};
+    ON_SCOPE_EXIT(
+        for (auto& s : segments) {
+            if (s.curl) {
+                curl_multi_remove_handle(multi, s.curl);
+                curl_easy_cleanup(s.curl);
+            }
+        }
+    );
+
+    const auto start_segment = [&](Segment& s) -> bool {
+        if (!s.curl) {
+            s.curl = curl_easy_init();
+            if (!s.curl) {
+                return false;
+            }
+        }
+
+        curl_easy_reset(s.curl);
+        SetCommonCurlOptions(s.curl, e);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_URL, encoded_url.c_str());
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_ACCEPT_ENCODING, (char*)nullptr);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_XFERINFOFUNCTION, ProgressCallbackFunc1);
+        if (list) {
+            CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_HTTPHEADER, list);
+        }
+
+        // resumes from where the segment got to if this is a retry.
+        s.range = std::to_string(s.offset) + "-" + std::to_string(s.end);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_RANGE, s.range.c_str());
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_WRITEFUNCTION, WriteSegmentCallback);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_WRITEDATA, &s);
+
+        if (g_has_http2) {
+            CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_PIPEWAIT, 1L);
+        }
+
+        return curl_multi_add_handle(multi, s.curl) == CURLM_OK;
+    };
+
+    for (const auto& [key, value] : e.GetHeader().m_map) {
+        if (value.empty()) {
+            continue;
+        }
+
+        const auto header_str = key + ": " + value;
+        if (auto temp = curl_slist_append(list, header_str.c_str())) {
+            list = temp;
+        }
+    }
+
+    const auto segment_size = (size + SEGMENT_COUNT - 1) / SEGMENT_COUNT;
+    for (s64 i = 0; i < SEGMENT_COUNT; i++) {
+        auto& s = segments[i];
+        s.f = &f;
+        s.begin = s.offset = i * segment_size;
+        s.end = std::min<s64>(size, (i + 1) * segment_size) - 1;
+
+        if (!start_segment(s)) {
+            log_write("[CURL] failed to start segment: %zd\n", i);
+            return {};
+        }
+    }
+
+    u32 active = SEGMENT_COUNT;
+    bool failed{};
+    while (active && !failed) {
+        int running{};
+        curl_multi_perform(multi, &running);
+
+        int msgs_left{};
+        while (auto msg = curl_multi_info_read(multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // msg is invalid once the handle is removed.
+            const auto handle = msg->easy_handle;
+            const auto res = msg->data.result;
+
+            auto it = std::ranges::find_if(segments, [handle](auto& s) {
+                return s.curl == handle;
+            });
+
+            if (it == std::end(segments)) {
+                continue;
+            }
+
+            curl_multi_remove_handle(multi, handle);
+
+            if (res == CURLE_OK && it->offset == it->end + 1) {
+                active--;
+            } else if (g_running && !IsStopRequested(e) && it->retries < SEGMENT_RETRY_MAX) {
+                it->retries++;
+                log_write("[CURL] retrying segment: %zd-%zd retry: %u %s\n", it->offset, it->end, it->retries, curl_easy_strerror(res));
+                if (!start_segment(*it)) {
+                    failed = true;
+                }
+            } else {
+                log_write("[CURL] segment failed: %zd-%zd %s\n", it->offset, it->end, curl_easy_strerror(res));
+                failed = true;
+            }
+        }
+
+        if (e.GetOnProgress()) {
+            s64 done{};
+            for (const auto& s : segments) {
+                done += s.offset - s.begin;
+            }
+
+            if (!e.GetOnProgress()(size, done, 0, 0)) {
+                failed = true;
+            }
+        }
+
+        if (active && !failed) {
+            curl_multi_poll(multi, nullptr, 0, POLL_TIMEOUT_MS, nullptr);
+        }
+    }
+
+    if (failed) {
+        return {};
+    }
+
+    f.Close();
+
+    log_write("un-cached download: %s code: %lu\n", e.GetUrl().c_str(), http_code);
+    if (e.GetFlags() & Flag_Cache) {
+        g_cache.set(e.GetPath(), header_out);
+    }
+
+    fs.DeleteFile(e.GetPath());
+    fs.CreateDirectoryRecursivelyWithPath(e.GetPath());
+    if (R_FAILED(fs.RenameFile(tmp_buf, e.GetPath()))) {
+        return {};
+    }
+
+    log_write("Downloaded %s in %u segments, size: %zd\n", e.GetUrl().c_str(), SEGMENT_COUNT, (s64)size);
+    return {true, http_code, header_out, {}, e.GetPath()};
+}
+
+struct RemoteSegment {
+    u8* buf{};
+    // offset the read started at, the buffer is relative to this.
+    s64 base{};
+    // next offset to write to.
+    s64 offset{};
+    // last byte of the segment, inclusive.
+    s64 end{};
+    u32 retries{};
+    CURL* curl{};
+    std::string range{};
+    const Api* api{};
+    const std::atomic_bool* cancelled{};
+};
+
+auto IsRemoteCancelled(const RemoteSegment* segment) -> bool {
+    return !g_running || *segment->cancelled || IsStopRequested(*segment->api);
+}
+
+auto RemoteProgressCallback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) -> int {
+    return IsRemoteCancelled(static_cast<const RemoteSegment*>(clientp));
+}
+
+auto WriteRemoteSegmentCallback(void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+    auto segment = static_cast<RemoteSegment*>(userp);
+    const auto realsize = size * num_files;
+
+    if (IsRemoteCancelled(segment)) {
+        return 0;
+    }
+
+    // the server ignored the range and is sending more than was asked for.
+    if (segment->offset + (s64)realsize > segment->end + 1) {
+        log_write("[CURL] remote overflow, offset: %zd end: %zd size: %zu\n", segment->offset, segment->end, realsize);
+        return 0;
+    }
+
+    std::memcpy(segment->buf + (segment->offset - segment->base), contents, realsize);
+    segment->offset += realsize;
+    return realsize;
+}
+
+void PushResult(const Api& api, const ApiResult& result) {
+    if (g_running && api.GetOnComplete() && !IsStopRequested(api)) {
+        evman::push(
+            DownloadEventData{api.GetOnComplete(), result, api.GetToken()},
+            false
+        );
+    }
 }
 
 void my_lock(CURL *handle, curl_lock_data data, curl_lock_access laccess, void *useptr) {
@@ -948,104 +1749,521 @@ void my_unlock(CURL *handle, curl_lock_data data, void *useptr) {
     mutexUnlock(&g_mutex_share[data]);
 }
 
-void ThreadEntry::ThreadFunc(void* p) {
-    auto data = static_cast<ThreadEntry*>(p);
+void TransferQueue::ThreadFunc(void* p) {
+    auto data = static_cast<TransferQueue*>(p);
+    SCOPED_MEM_TAG(utils::mem::Tag_Curl);
 
     if (!g_cache.init()) {
         log_write("failed to init json cache\n");
     }
     ON_SCOPE_EXIT(g_cache.exit());
 
+    // easy handles are kept once a transfer finishes so that they can be reused.
+    std::vector<CURL*> free_handles;
+    std::vector<std::unique_ptr<Transfer>> active;
+
+    ON_SCOPE_EXIT(
+        for (auto& t : active) {
+            curl_multi_remove_handle(data->m_multi, t->curl);
+            // cleans up the temp file, nothing is pushed as we are exiting.
+            FinishTransfer(*t, CURLE_ABORTED_BY_CALLBACK);
+            free_handles.emplace_back(t->curl);
+        }
+        active.clear();
+
+        for (auto curl : free_handles) {
+            curl_easy_cleanup(curl);
+        }
+    );
+
     while (g_running) {
-        auto rc = waitSingle(waiterForUEvent(&data->m_uevent), UINT64_MAX);
-        // log_write("woke up\n");
+        // start as many queued transfers as there are free slots.
+        Api api;
+        while (g_running && active.size() < MAX_TRANSFERS && data->Pop(api)) {
+            if (IsStopRequested(api)) {
+                continue;
+            }
+
+            CURL* curl{};
+            if (!free_handles.empty()) {
+                curl = free_handles.back();
+                free_handles.pop_back();
+            } else {
+                curl = curl_easy_init();
+            }
+
+            if (!curl) {
+                log_write("[CURL] failed to create easy handle\n");
+                PushResult(api, {});
+                continue;
+            }
+
+            auto t = std::make_unique<Transfer>(api, curl, api.IsUpload());
+            if (!SetupTransfer(*t)) {
+                PushResult(t->api, {});
+                free_handles.emplace_back(curl);
+                continue;
+            }
+
+            // wait for an existing connection to the host to be confirmed as
+            // http2 so that the transfer is multiplexed over it, rather than
+            // opening a new connection and tls session for each transfer.
+            if (g_has_http2) {
+                CURL_EASY_SETOPT_LOG(curl, CURLOPT_PIPEWAIT, 1L);
+            }
+
+            if (auto rc = curl_multi_add_handle(data->m_multi, curl); rc != CURLM_OK) {
+                log_write("[CURL] failed to add handle: %s\n", curl_multi_strerror(rc));
+                PushResult(t->api, FinishTransfer(*t, CURLE_FAILED_INIT));
+                free_handles.emplace_back(curl);
+                continue;
+            }
+
+            active.emplace_back(std::move(t));
+        }
+
         if (!g_running) {
             break;
         }
 
-        if (R_FAILED(rc)) {
+        data->m_active = active.size();
+
+        // nothing to do, write any cache updates and sleep until a transfer is queued.
+        if (active.empty()) {
+            g_cache.flush();
+            waitSingle(waiterForUEvent(&data->m_uevent), UINT64_MAX);
             continue;
         }
 
-        const auto result = data->m_api.IsUpload() ? UploadInternal(data->m_curl, data->m_api) : DownloadInternal(data->m_curl, data->m_api);
-        if (g_running && data->m_api.GetOnComplete() && !data->m_api.GetToken().stop_requested()) {
-            evman::push(
-                DownloadEventData{data->m_api.GetOnComplete(), result, data->m_api.GetToken()},
-                false
-            );
+        int running{};
+        curl_multi_perform(data->m_multi, &running);
+
+        int msgs_left{};
+        while (auto msg = curl_multi_info_read(data->m_multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // msg is invalid once the handle is removed.
+            const auto curl = msg->easy_handle;
+            const auto res = msg->data.result;
+
+            const auto it = std::ranges::find_if(active, [curl](auto& e) {
+                return e->curl == curl;
+            });
+
+            if (it == active.end()) {
+                continue;
+            }
+
+            curl_multi_remove_handle(data->m_multi, curl);
+            PushResult((*it)->api, FinishTransfer(**it, res));
+            free_handles.emplace_back(curl);
+            active.erase(it);
         }
 
-        data->m_in_progress = false;
-        // notify the queue that there's a space free
-        ueventSignal(&g_thread_queue.m_uevent);
+        // wait for socket activity, or for a new transfer to be queued.
+        if (!active.empty()) {
+            curl_multi_poll(data->m_multi, nullptr, 0, POLL_TIMEOUT_MS, nullptr);
+        }
     }
+
+    const auto stats = data->GetStats();
+    log_write("[CURL] queue stats, queued: %u peak: %u dropped: %lu\n", stats.queued, stats.queued_peak, stats.dropped);
     log_write("exited download thread\n");
 }
 
-void ThreadQueue::ThreadFunc(void* p) {
-    auto data = static_cast<ThreadQueue*>(p);
+// session export was added in 8.12.0.
+#if LIBCURL_VERSION_NUM >= 0x080C00
+struct TlsSessionHeader {
+    u32 key_len;
+    u32 shmac_len;
+    u32 sdata_len;
+    u32 pad;
+    s64 valid_until;
+};
+
+auto ExportTlsSessionCallback(CURL* curl, void* userptr, const char* session_key, const unsigned char* shmac, size_t shmac_len, const unsigned char* sdata, size_t sdata_len, curl_off_t valid_until, int ietf_tls_id, const char* alpn, size_t earlydata_max) -> CURLcode {
+    auto& out = *static_cast<std::vector<u8>*>(userptr);
+    if (!session_key || valid_until <= std::time(nullptr)) {
+        return CURLE_OK;
+    }
+
+    const TlsSessionHeader header{
+        .key_len = (u32)std::strlen(session_key),
+        .shmac_len = (u32)shmac_len,
+        .sdata_len = (u32)sdata_len,
+        .valid_until = valid_until,
+    };
+
+    const auto add = [&out](const void* data, size_t size) {
+        const auto ptr = static_cast<const u8*>(data);
+        out.insert(out.end(), ptr, ptr + size);
+    };
+
+    add(&header, sizeof(header));
+    add(session_key, header.key_len);
+    add(shmac, shmac_len);
+    add(sdata, sdata_len);
+    return CURLE_OK;
+}
+
+void LoadTlsSessions(CURL* curl) {
+    fs::FsNativeSd fs;
+    std::vector<u8> data;
+    if (R_FAILED(fs.read_entire_file(TLS_SESSION_PATH, data)) || data.size() < sizeof(u32)) {
+        return;
+    }
 
-    while (g_running) {
-        auto rc = waitSingle(waiterForUEvent(&data->m_uevent), UINT64_MAX);
-        log_write("[thread queue] woke up\n");
-        if (!g_running) {
-            return;
+    u32 magic;
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    if (magic != TLS_SESSION_MAGIC) {
+        return;
+    }
+
+    u32 count{};
+    for (size_t off = sizeof(magic); off + sizeof(TlsSessionHeader) <= data.size();) {
+        TlsSessionHeader header;
+        std::memcpy(&header, data.data() + off, sizeof(header));
+        off += sizeof(header);
+
+        const auto size = (size_t)header.key_len + header.shmac_len + header.sdata_len;
+        if (off + size > data.size()) {
+            break;
         }
-        if (R_FAILED(rc)) {
-            continue;
+
+        if (header.valid_until > std::time(nullptr)) {
+            const std::string key{(const char*)data.data() + off, header.key_len};
+            const auto shmac = data.data() + off + header.key_len;
+            const auto sdata = shmac + header.shmac_len;
+            if (curl_easy_ssls_import(curl, key.c_str(), shmac, header.shmac_len, sdata, header.sdata_len) == CURLE_OK) {
+                count++;
+            }
         }
 
-        mutexLock(&data->m_mutex);
-        ON_SCOPE_EXIT(mutexUnlock(&data->m_mutex));
-        if (data->m_entries.empty()) {
+        off += size;
+    }
+
+    log_write("[CURL] imported %u tls sessions\n", count);
+}
+
+void SaveTlsSessions(CURL* curl) {
+    std::vector<u8> data(sizeof(TLS_SESSION_MAGIC));
+    std::memcpy(data.data(), &TLS_SESSION_MAGIC, sizeof(TLS_SESSION_MAGIC));
+
+    if (const auto res = curl_easy_ssls_export(curl, ExportTlsSessionCallback, &data); res != CURLE_OK) {
+        log_write("[CURL] failed to export tls sessions: %s\n", curl_easy_strerror(res));
+        return;
+    }
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursivelyWithPath(TLS_SESSION_PATH);
+    fs.DeleteFile(TLS_SESSION_PATH);
+    if (data.size() > sizeof(TLS_SESSION_MAGIC)) {
+        fs.write_entire_file(TLS_SESSION_PATH, data);
+    }
+}
+#else
+void LoadTlsSessions(CURL* curl) {}
+void SaveTlsSessions(CURL* curl) {}
+#endif
+
+#ifdef ENABLE_MEM_TRACK
+void* CurlMalloc(size_t size) {
+    return utils::mem::Malloc(utils::mem::Tag_Curl, size);
+}
+
+void CurlFree(void* ptr) {
+    utils::mem::Free(ptr);
+}
+
+void* CurlRealloc(void* ptr, size_t size) {
+    return utils::mem::Realloc(utils::mem::Tag_Curl, ptr, size);
+}
+
+char* CurlStrdup(const char* str) {
+    return utils::mem::Strdup(utils::mem::Tag_Curl, str);
+}
+
+void* CurlCalloc(size_t count, size_t size) {
+    return utils::mem::Calloc(utils::mem::Tag_Curl, count, size);
+}
+#endif // ENABLE_MEM_TRACK
+
+} // namespace
+
+struct RemoteFile::Impl {
+    // sets the options shared by all requests on the handle.
+    auto Setup(RemoteSegment& s) -> bool {
+        auto& curl = s.curl;
+        if (!curl) {
+            curl = curl_easy_init();
+            if (!curl) {
+                return false;
+            }
+        }
+
+        curl_easy_reset(curl);
+        SetCommonCurlOptions(curl, api);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_URL, encoded_url.c_str());
+        // ranges are of the encoded data, so disable compression.
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_ACCEPT_ENCODING, (char*)nullptr);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFOFUNCTION, RemoteProgressCallback);
+        CURL_EASY_SETOPT_LOG(curl, CURLOPT_XFERINFODATA, &s);
+        if (list) {
+            CURL_EASY_SETOPT_LOG(curl, CURLOPT_HTTPHEADER, list);
+        }
+
+        return true;
+    }
+
+    auto StartSegment(RemoteSegment& s) -> bool {
+        if (!Setup(s)) {
+            return false;
+        }
+
+        // resumes from where the segment got to if this is a retry.
+        s.range = std::to_string(s.offset) + "-" + std::to_string(s.end);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_RANGE, s.range.c_str());
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_WRITEFUNCTION, WriteRemoteSegmentCallback);
+        CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_WRITEDATA, &s);
+
+        if (g_has_http2) {
+            CURL_EASY_SETOPT_LOG(s.curl, CURLOPT_PIPEWAIT, 1L);
+        }
+
+        return curl_multi_add_handle(multi, s.curl) == CURLM_OK;
+    }
+
+    Api api;
+    std::string encoded_url{};
+    curl_slist* list{};
+    CURLM* multi{};
+    RemoteSegment segments[SEGMENT_COUNT]{};
+    s64 size{};
+    bool has_ranges{};
+    std::atomic_bool cancelled{};
+};
+
+RemoteFile::RemoteFile(const Api& api) : m_impl{std::make_unique<Impl>()} {
+    m_impl->api = api;
+    m_impl->encoded_url = EncodeUrl(api.GetUrl());
+    m_impl->multi = curl_multi_init();
+
+    for (const auto& [key, value] : api.GetHeader().m_map) {
+        if (value.empty()) {
             continue;
         }
 
-        // find the next avaliable thread
-        for (auto& entry : data->m_entries) {
-            if (!g_running) {
-                return;
+        const auto header_str = key + ": " + value;
+        if (auto temp = curl_slist_append(m_impl->list, header_str.c_str())) {
+            m_impl->list = temp;
+        }
+    }
+
+    for (auto& s : m_impl->segments) {
+        s.api = &m_impl->api;
+        s.cancelled = &m_impl->cancelled;
+    }
+}
+
+RemoteFile::~RemoteFile() {
+    for (auto& s : m_impl->segments) {
+        if (s.curl) {
+            if (m_impl->multi) {
+                curl_multi_remove_handle(m_impl->multi, s.curl);
             }
+            curl_easy_cleanup(s.curl);
+        }
+    }
 
-            bool keep_going{};
+    if (m_impl->multi) {
+        curl_multi_cleanup(m_impl->multi);
+    }
 
-            for (auto& thread : g_threads) {
-                if (!g_running) {
-                    return;
-                }
+    if (m_impl->list) {
+        curl_slist_free_all(m_impl->list);
+    }
+}
 
-                if (!thread.InProgress()) {
-                    if (thread.Setup(entry.api)) {
-                        // log_write("[dl queue] starting download\n");
-                        // mark entry for deletion
-                        entry.m_delete = true;
-                        // pop_count++;
-                        keep_going = true;
-                        break;
-                    }
-                }
+auto RemoteFile::Open() -> bool {
+    auto& segment = m_impl->segments[0];
+    if (!m_impl->multi || !m_impl->Setup(segment)) {
+        return false;
+    }
+
+    const auto curl = segment.curl;
+
+    Header header_out;
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_NOBODY, 1L);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    CURL_EASY_SETOPT_LOG(curl, CURLOPT_HEADERDATA, &header_out);
+
+    const auto res = curl_easy_perform(curl);
+    curl_off_t size{};
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+
+    if (res != CURLE_OK || size <= 0) {
+        log_write("[CURL] failed to open remote: %s size: %zd %s\n", m_impl->api.GetUrl().c_str(), (s64)size, curl_easy_strerror(res));
+        return false;
+    }
+
+    const auto it = header_out.Find("accept-ranges");
+    m_impl->has_ranges = it != header_out.m_map.end() && it->second == "bytes";
+    m_impl->size = size;
+    log_write("[CURL] opened remote: %s size: %zd ranges: %u\n", m_impl->api.GetUrl().c_str(), m_impl->size, m_impl->has_ranges);
+    return true;
+}
+
+auto RemoteFile::GetSize() const -> s64 {
+    return m_impl->size;
+}
+
+auto RemoteFile::HasRanges() const -> bool {
+    return m_impl->has_ranges;
+}
+
+auto RemoteFile::Read(void* buf, s64 off, s64 size) -> bool {
+    TRACE_SCOPE("curl::remote_read");
+    if (!m_impl->has_ranges || off < 0 || off + size > m_impl->size) {
+        return false;
+    }
+
+    if (!size) {
+        return true;
+    }
+
+    // small reads, ie, headers, aren't worth splitting.
+    const auto segment_size = std::max<s64>(REMOTE_SEGMENT_MIN_SIZE, (size + SEGMENT_COUNT - 1) / SEGMENT_COUNT);
+    const auto count = (u32)((size + segment_size - 1) / segment_size);
+
+    for (u32 i = 0; i < count; i++) {
+        auto& s = m_impl->segments[i];
+        s.buf = static_cast<u8*>(buf);
+        s.base = off;
+        s.offset = off + i * segment_size;
+        s.end = std::min<s64>(off + size, s.offset + segment_size) - 1;
+        s.retries = 0;
+
+        if (!m_impl->StartSegment(s)) {
+            log_write("[CURL] failed to start remote segment: %u\n", i);
+            for (u32 j = 0; j < i; j++) {
+                curl_multi_remove_handle(m_impl->multi, m_impl->segments[j].curl);
             }
+            return false;
+        }
+    }
 
-            if (!keep_going) {
-                break;
+    const auto segments = std::span{m_impl->segments, count};
+    u32 active = count;
+    bool failed{};
+    while (active && !failed) {
+        int running{};
+        curl_multi_perform(m_impl->multi, &running);
+
+        int msgs_left{};
+        while (auto msg = curl_multi_info_read(m_impl->multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // msg is invalid once the handle is removed.
+            const auto handle = msg->easy_handle;
+            const auto res = msg->data.result;
+
+            auto it = std::ranges::find_if(segments, [handle](auto& s) {
+                return s.curl == handle;
+            });
+
+            if (it == segments.end()) {
+                continue;
+            }
+
+            curl_multi_remove_handle(m_impl->multi, handle);
+
+            if (res == CURLE_OK && it->offset == it->end + 1) {
+                active--;
+            } else if (!IsRemoteCancelled(&*it) && it->retries < SEGMENT_RETRY_MAX) {
+                it->retries++;
+                log_write("[CURL] retrying remote segment: %zd-%zd retry: %u %s\n", it->offset, it->end, it->retries, curl_easy_strerror(res));
+                if (!m_impl->StartSegment(*it)) {
+                    failed = true;
+                }
+            } else {
+                log_write("[CURL] remote segment failed: %zd-%zd %s\n", it->offset, it->end, curl_easy_strerror(res));
+                failed = true;
             }
         }
 
-        // delete all entries marked for deletion
-        std::erase_if(data->m_entries, [](auto& e){
-            return e.m_delete;
-        });
+        if (active && !failed) {
+            curl_multi_poll(m_impl->multi, nullptr, 0, POLL_TIMEOUT_MS, nullptr);
+        }
     }
 
-    log_write("exited download thread queue\n");
+    // remove whatever is still running so the handles can be reused.
+    if (failed) {
+        for (auto& s : segments) {
+            curl_multi_remove_handle(m_impl->multi, s.curl);
+        }
+    }
+
+    return !failed;
 }
 
-} // namespace
+auto RemoteFile::ReadAll(const OnData& on_data) -> bool {
+    TRACE_SCOPE("curl::remote_read_all");
+    auto& segment = m_impl->segments[0];
+    if (!m_impl->Setup(segment)) {
+        return false;
+    }
+
+    struct Data {
+        const OnData& on_data;
+        const RemoteSegment& segment;
+    } data{on_data, segment};
+
+    const auto write = [](void *contents, size_t size, size_t num_files, void *userp) -> size_t {
+        auto data = static_cast<Data*>(userp);
+        const auto realsize = size * num_files;
+
+        if (IsRemoteCancelled(&data->segment) || !data->on_data(contents, realsize)) {
+            return 0;
+        }
+
+        return realsize;
+    };
+
+    CURL_EASY_SETOPT_LOG(segment.curl, CURLOPT_WRITEFUNCTION, +write);
+    CURL_EASY_SETOPT_LOG(segment.curl, CURLOPT_WRITEDATA, &data);
+
+    const auto res = curl_easy_perform(segment.curl);
+    if (res != CURLE_OK) {
+        log_write("[CURL] remote read all failed: %s\n", curl_easy_strerror(res));
+        return false;
+    }
+
+    return true;
+}
+
+void RemoteFile::Cancel() {
+    m_impl->cancelled = true;
+}
 
 auto Init() -> bool {
+#ifdef ENABLE_MEM_TRACK
+    if (CURLE_OK != curl_global_init_mem(CURL_GLOBAL_DEFAULT, CurlMalloc, CurlFree, CurlRealloc, CurlStrdup, CurlCalloc)) {
+        return false;
+    }
+#else
     if (CURLE_OK != curl_global_init(CURL_GLOBAL_DEFAULT)) {
         return false;
     }
+#endif
+
+    if (auto info = curl_version_info(CURLVERSION_NOW); info) {
+        g_has_http2 = info->features & CURL_VERSION_HTTP2;
+        log_write("[CURL] version: %s http2: %u\n", info->version, g_has_http2);
+    }
 
     g_curl_share = curl_share_init();
     if (g_curl_share) {
@@ -1060,22 +2278,20 @@ auto Init() -> bool {
 
     g_running = true;
 
-    if (R_FAILED(g_thread_queue.Create())) {
+    if (R_FAILED(g_transfer_queue.Create())) {
         log_write("!failed to create download thread queue\n");
     }
 
-    for (auto& entry : g_threads) {
-        if (R_FAILED(entry.Create())) {
-            log_write("!failed to create download thread\n");
-        }
-    }
-
     g_curl_single = curl_easy_init();
     if (!g_curl_single) {
         log_write("failed to create g_curl_single\n");
+    } else if (g_curl_share) {
+        // sessions are imported into the shared cache, so every handle can use them.
+        CURL_EASY_SETOPT_LOG(g_curl_single, CURLOPT_SHARE, g_curl_share);
+        LoadTlsSessions(g_curl_single);
     }
 
-    log_write("finished creating threads\n");
+    log_write("finished creating download thread\n");
 
     return true;
 }
@@ -1083,27 +2299,24 @@ auto Init() -> bool {
 void ExitSignal() {
     g_running = false;
 
-    g_thread_queue.SignalClose();
-
-    for (auto& entry : g_threads) {
-        entry.SignalClose();
-    }
+    g_transfer_queue.SignalClose();
 }
 
 void Exit() {
     ExitSignal();
 
-    g_thread_queue.Close();
+    g_transfer_queue.Close();
 
     if (g_curl_single) {
+        if (g_curl_share) {
+            curl_easy_reset(g_curl_single);
+            CURL_EASY_SETOPT_LOG(g_curl_single, CURLOPT_SHARE, g_curl_share);
+            SaveTlsSessions(g_curl_single);
+        }
         curl_easy_cleanup(g_curl_single);
         g_curl_single = nullptr;
     }
 
-    for (auto& entry : g_threads) {
-        entry.Close();
-    }
-
     if (g_curl_share) {
         curl_share_cleanup(g_curl_share);
         g_curl_share = {};
@@ -1116,48 +2329,72 @@ auto ToMemory(const Api& e) -> ApiResult {
     if (!e.GetPath().empty()) {
         return {};
     }
-    return DownloadInternal(g_curl_single, e);
+    return PerformTransfer(g_curl_single, e, false);
 }
 
 auto ToFile(const Api& e) -> ApiResult {
     if (e.GetPath().empty()) {
         return {};
     }
-    return DownloadInternal(g_curl_single, e);
+
+    if (e.GetFlags() & Flag_Segmented) {
+        return DownloadSegmented(g_curl_single, e);
+    }
+
+    return PerformTransfer(g_curl_single, e, false);
 }
 
 auto FromMemory(const Api& e) -> ApiResult {
     if (!e.GetPath().empty()) {
         return {};
     }
-    return UploadInternal(g_curl_single, e);
+    return PerformTransfer(g_curl_single, e, true);
 }
 
 auto FromFile(const Api& e) -> ApiResult {
     if (e.GetPath().empty()) {
         return {};
     }
-    return UploadInternal(g_curl_single, e);
+    return PerformTransfer(g_curl_single, e, true);
 }
 
 auto ToMemoryAsync(const Api& api) -> bool {
-    return g_thread_queue.Add(api);
+    return g_transfer_queue.Add(api);
 }
 
 auto ToFileAsync(const Api& e) -> bool {
-    return g_thread_queue.Add(e);
+    return g_transfer_queue.Add(e);
+}
+
+auto PrewarmAsync(const std::string& url) -> bool {
+    // the queue only takes transfers with a callback.
+    return g_transfer_queue.Add(Api{Url{url}, Flags{Flag_NoBody}, Priority::Normal, OnComplete{[](auto&){}}});
 }
 
 auto FromMemoryAsync(const Api& api) -> bool {
-    return g_thread_queue.Add(api, true);
+    return g_transfer_queue.Add(api, true);
 }
 
 auto FromFileAsync(const Api& e) -> bool {
-    return g_thread_queue.Add(e, true);
+    return g_transfer_queue.Add(e, true);
 }
 
 auto EscapeString(const std::string& str) -> std::string {
     return EscapeString(nullptr, str);
 }
 
+void GetMetrics(std::vector<Metrics>& out) {
+    SCOPED_MUTEX(&g_metrics_mutex);
+    out.clear();
+
+    const auto count = std::min<u64>(g_metrics_index, METRICS_HISTORY);
+    for (u64 i = 0; i < count; i++) {
+        out.emplace_back(g_metrics[(g_metrics_index - 1 - i) % METRICS_HISTORY]);
+    }
+}
+
+auto GetStats() -> Stats {
+    return g_transfer_queue.GetStats();
+}
+
 } // namespace sphaira::curl
@@ -7,6 +7,8 @@
 #include "i18n.hpp"
 #include "location.hpp"
 #include "threaded_file_transfer.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/thread.hpp"
 
 #include "ui/sidebar.hpp"
 #include "ui/error_box.hpp"
@@ -21,6 +23,9 @@
 #include "usb/usb_dumper.hpp"
 #include "usb/usbds.hpp"
 
+#include <algorithm>
+#include <sys/statvfs.h>
+
 namespace sphaira::dump {
 namespace {
 
@@ -104,20 +109,230 @@ struct DumpLocationEntry {
     const char* name;
 };
 
+// writes smaller than this are coalesced before hitting the fs.
+// custom transfers (xci / nsp / zip) write lots of small chunks, which is slow
+// over ipc and fragments files on exfat / usb drives.
+constexpr s64 WRITE_ALIGN_SD_CARD = 1024 * 1024;
+// stdio is unbuffered and libusbhsfs does a usb transfer per write.
+constexpr s64 WRITE_ALIGN_STDIO = 1024 * 1024 * 4;
+
+// rounds the write size up to a multiple of the cluster size of the mount, so
+// that every write (other than the last) covers whole clusters.
+auto GetStdioWriteAlign(const fs::FsPath& path) -> s64 {
+    struct statvfs st{};
+    if (statvfs(path, &st) || !st.f_bsize) {
+        return WRITE_ALIGN_STDIO;
+    }
+
+    const auto cluster = (s64)st.f_bsize;
+    log_write("[DUMP] stdio cluster size: %zu\n", (size_t)cluster);
+    return (WRITE_ALIGN_STDIO + cluster - 1) / cluster * cluster;
+}
+
+// writes full buffers on a thread, so that the next buffer can be filled
+// whilst the previous one is being written.
+// usb drives are slow per write, so without this the writer stalls on every
+// flush rather than overlapping it with the copy.
+struct WriteBehind {
+    WriteBehind(fs::File* file) : m_file{file} {
+        mutexInit(&m_mutex);
+        condvarInit(&m_can_write);
+        condvarInit(&m_can_submit);
+    }
+
+    ~WriteBehind() {
+        if (m_running) {
+            {
+                SCOPED_MUTEX(&m_mutex);
+                m_exit = true;
+                condvarWakeOne(&m_can_write);
+            }
+
+            threadWaitForExit(&m_thread);
+            threadClose(&m_thread);
+        }
+    }
+
+    Result Start() {
+        R_TRY(utils::CreateThread(&m_thread, thread_func, this, utils::ThreadRole::Io));
+        if (const auto rc = threadStart(&m_thread); R_FAILED(rc)) {
+            threadClose(&m_thread);
+            R_THROW(rc);
+        }
+
+        m_running = true;
+        R_SUCCEED();
+    }
+
+    // swaps the buffer with the one that was last written.
+    Result Submit(utils::pool::Vector<u8>& buf, s64 off) {
+        SCOPED_MUTEX(&m_mutex);
+        R_TRY(WaitInternal());
+
+        std::swap(m_buf, buf);
+        buf.clear();
+        m_off = off;
+        m_pending = true;
+        condvarWakeOne(&m_can_write);
+        R_SUCCEED();
+    }
+
+    // waits for the pending write to complete.
+    Result Wait() {
+        SCOPED_MUTEX(&m_mutex);
+        return WaitInternal();
+    }
+
+private:
+    Result WaitInternal() {
+        while (m_pending) {
+            condvarWait(&m_can_submit, &m_mutex);
+        }
+        return m_rc;
+    }
+
+    static void thread_func(void* arg) {
+        auto t = static_cast<WriteBehind*>(arg);
+
+        SCOPED_MUTEX(&t->m_mutex);
+        while (true) {
+            while (!t->m_pending && !t->m_exit) {
+                condvarWait(&t->m_can_write, &t->m_mutex);
+            }
+
+            if (!t->m_pending) {
+                break;
+            }
+
+            // the buffer isn't touched by the writer until the write is complete.
+            mutexUnlock(&t->m_mutex);
+            const auto rc = t->m_file->Write(t->m_off, t->m_buf.data(), t->m_buf.size(), FsWriteOption_None);
+            mutexLock(&t->m_mutex);
+
+            if (R_FAILED(rc) && R_SUCCEEDED(t->m_rc)) {
+                t->m_rc = rc;
+            }
+
+            t->m_pending = false;
+            condvarWakeOne(&t->m_can_submit);
+        }
+    }
+
+private:
+    fs::File* const m_file;
+    Thread m_thread{};
+    Mutex m_mutex{};
+    CondVar m_can_write{};
+    CondVar m_can_submit{};
+    utils::pool::Vector<u8> m_buf{};
+    s64 m_off{};
+    Result m_rc{};
+    bool m_pending{};
+    bool m_exit{};
+    bool m_running{};
+};
+
 struct WriteFileSource final : WriteSource {
-    WriteFileSource(fs::File* file) : m_file{file} {
+    WriteFileSource(fs::File* file, s64 align, bool write_behind = false) : m_file{file}, m_align{align}, m_write_behind{write_behind} {
     }
 
     Result Write(const void* buf, s64 off, s64 size) override {
-        return m_file->Write(off, buf, size, FsWriteOption_None);
+        // flush if this write isn't contiguous with the buffered data.
+        if (!m_buf.empty() && off != m_buf_off + (s64)m_buf.size()) {
+            R_TRY(Flush());
+        }
+
+        auto data = static_cast<const u8*>(buf);
+        while (size) {
+            // large aligned writes are already fast, so skip the copy.
+            // only whole blocks are written so that the next write stays aligned.
+            if (m_buf.empty() && !(off % m_align) && size >= m_align) {
+                const auto n = size / m_align * m_align;
+                R_TRY(WaitWriteBehind());
+                R_TRY(m_file->Write(off, data, n, FsWriteOption_None));
+                data += n;
+                off += n;
+                size -= n;
+                continue;
+            }
+
+            if (m_buf.empty()) {
+                m_buf_off = off;
+                m_buf.reserve(m_align);
+            }
+
+            // fill up to the next aligned offset, rather than a full buffer, so that
+            // flushes always end on a block boundary.
+            const auto n = std::min<s64>(size, m_align - (off % m_align));
+            m_buf.insert(m_buf.end(), data, data + n);
+            data += n;
+            off += n;
+            size -= n;
+
+            if (!(off % m_align)) {
+                R_TRY(FlushBlock());
+            }
+        }
+
+        R_SUCCEED();
     }
 
     Result SetSize(s64 size) override {
+        R_TRY(Flush());
         return m_file->SetSize(size);
     }
 
+    // must be called before the file is closed.
+    Result Flush() {
+        R_TRY(WaitWriteBehind());
+
+        if (!m_buf.empty()) {
+            R_TRY(m_file->Write(m_buf_off, m_buf.data(), m_buf.size(), FsWriteOption_None));
+            m_buf_off += m_buf.size();
+            m_buf.clear();
+        }
+
+        R_SUCCEED();
+    }
+
+private:
+    // writes a full block, on the write behind thread if enabled.
+    Result FlushBlock() {
+        if (!m_write_behind) {
+            return Flush();
+        }
+
+        // the thread is only started once a file needs more than one block.
+        if (!m_thread) {
+            m_thread = std::make_unique<WriteBehind>(m_file);
+            if (R_FAILED(m_thread->Start())) {
+                log_write("[DUMP] failed to start write behind thread\n");
+                m_thread.reset();
+                m_write_behind = false;
+                return Flush();
+            }
+        }
+
+        const auto off = m_buf_off;
+        m_buf_off += m_buf.size();
+        return m_thread->Submit(m_buf, off);
+    }
+
+    Result WaitWriteBehind() {
+        if (m_thread) {
+            R_TRY(m_thread->Wait());
+        }
+        R_SUCCEED();
+    }
+
 private:
     fs::File* m_file;
+    const s64 m_align;
+    bool m_write_behind;
+    utils::pool::Vector<u8> m_buf{};
+    s64 m_buf_off{};
+    // joins the thread when destroyed, so must be reset before the file is closed.
+    std::unique_ptr<WriteBehind> m_thread{};
 };
 
 struct WriteNullSource final : WriteSource {
@@ -152,10 +367,26 @@ struct WriteUsbSource final : WriteSource {
         return m_usb->WaitForConnection(path, timeout);
     }
 
+    Result WaitForSession(std::string_view path, u64 timeout) {
+        return m_usb->WaitForConnection(path, timeout, true);
+    }
+
+    Result OpenFile(std::string_view path) {
+        return m_usb->OpenFile(path);
+    }
+
     Result CloseFile() {
         return m_usb->CloseFile();
     }
 
+    Result EndSession() {
+        return m_usb->EndSession();
+    }
+
+    bool IsSession() const {
+        return m_usb->IsSession();
+    }
+
     Result Write(const void* buf, s64 off, s64 size) override {
         return m_usb->Write(buf, off, size);
     }
@@ -271,6 +502,206 @@ private:
     u32 m_current_file_index{};
 };
 
+// receives each file of a batch in order, see TransferBatch().
+struct BatchWriter {
+    virtual ~BatchWriter() = default;
+    // called before the first write to the file.
+    virtual Result Open(const fs::FsPath& path, s64 size) = 0;
+    virtual Result Write(const void* buf, s64 off, s64 size) = 0;
+    // called once all of the file has been written.
+    virtual Result Close() = 0;
+};
+
+// streams every file through a single transfer, rather than each file starting
+// and then draining its own pipeline, so the next file is read whilst the
+// previous one is still being written.
+// the progress, speed and eta shown are for the whole batch.
+Result TransferBatch(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::FsPath> paths, BatchWriter* writer) {
+    // offset of each file within the batch, the last entry is the total size.
+    std::vector<s64> starts(paths.size() + 1);
+    for (u32 i = 0; i < paths.size(); i++) {
+        starts[i + 1] = starts[i] + source->GetSize(paths[i]);
+    }
+
+    // the last file starting at or before off, which skips empty files.
+    const auto find = [&starts](s64 off) -> u32 {
+        return std::upper_bound(starts.begin(), starts.end() - 1, off) - starts.begin() - 1;
+    };
+
+    // only used by the write thread, and then by us once the transfer has finished.
+    s64 current = -1;
+    const auto advance = [&](s64 index) -> Result {
+        while (current < index) {
+            if (current >= 0) {
+                R_TRY(writer->Close());
+            }
+
+            if (++current == (s64)paths.size()) {
+                break;
+            }
+
+            const auto& path = paths[current];
+            pbox->SetImage(source->GetIcon(path));
+            pbox->SetTitle(source->GetName(path));
+            pbox->SetTransferName(path);
+            R_TRY(writer->Open(path, starts[current + 1] - starts[current]));
+        }
+
+        R_SUCCEED();
+    };
+
+    log_write("[DUMP] batch of %zu files, size: %.2f MiB\n", paths.size(), starts.back() / 1024.0 / 1024.0);
+
+    R_TRY(thread::Transfer(pbox, starts.back(),
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            // reads are split at the end of each file, the next read starts the next file.
+            const auto i = find(off);
+            size = std::min(size, starts[i + 1] - off);
+            return source->Read(paths[i], data, off - starts[i], size, bytes_read);
+        },
+        [&](const void* _data, s64 off, s64 size) -> Result {
+            auto data = static_cast<const u8*>(_data);
+
+            while (size) {
+                const auto i = find(off);
+                R_TRY(advance(i));
+
+                const auto n = std::min(size, starts[i + 1] - off);
+                R_TRY(writer->Write(data, off - starts[i], n));
+                data += n;
+                off += n;
+                size -= n;
+            }
+
+            R_SUCCEED();
+        }
+    ));
+
+    // closes the last file, and opens / closes any empty files at the end.
+    return advance(paths.size());
+}
+
+struct BatchFileWriter final : BatchWriter {
+    BatchFileWriter(fs::Fs* fs, const fs::FsPath& root, s64 write_align, bool write_behind)
+    : m_fs{fs}
+    , m_root{root}
+    , m_write_align{write_align}
+    , m_write_behind{write_behind}
+    , m_is_file_based_emummc{App::IsFileBaseEmummc()} {
+    }
+
+    // deletes the temp file if the batch failed part way through a file.
+    ~BatchFileWriter() {
+        if (m_has_temp) {
+            m_writer.reset();
+            m_file.Close();
+            m_fs->DeleteFile(m_temp_path);
+        }
+    }
+
+    Result Open(const fs::FsPath& path, s64 size) override {
+        m_base_path = fs::AppendPath(m_root, path);
+        m_temp_path = m_base_path + ".temp";
+        m_fs->CreateDirectoryRecursivelyWithPath(m_temp_path);
+        m_fs->DeleteFile(m_temp_path);
+
+        // the file is created at its final size so that the clusters are
+        // allocated up front, rather than extended on every write.
+        R_TRY(m_fs->CreateFile(m_temp_path, size));
+        m_has_temp = true;
+
+        R_TRY(m_fs->OpenFile(m_temp_path, FsOpenMode_Write|FsOpenMode_Append, &m_file));
+        m_writer = std::make_unique<WriteFileSource>(&m_file, m_write_align, m_write_behind);
+        R_SUCCEED();
+    }
+
+    Result Write(const void* buf, s64 off, s64 size) override {
+        const auto start = armGetSystemTick();
+        const auto rc = m_writer->Write(buf, off, size);
+        if (m_is_file_based_emummc) {
+            thread::EmummcThrottle(start);
+        }
+        return rc;
+    }
+
+    Result Close() override {
+        R_TRY(m_writer->Flush());
+        m_writer.reset();
+        R_TRY(m_file.Close());
+
+        m_fs->DeleteFile(m_base_path);
+        R_TRY(m_fs->RenameFile(m_temp_path, m_base_path));
+        m_has_temp = false;
+        R_SUCCEED();
+    }
+
+private:
+    fs::Fs* const m_fs;
+    const fs::FsPath m_root;
+    const s64 m_write_align;
+    const bool m_write_behind;
+    const bool m_is_file_based_emummc;
+    fs::FsPath m_base_path{};
+    fs::FsPath m_temp_path{};
+    fs::File m_file{};
+    std::unique_ptr<WriteFileSource> m_writer{};
+    bool m_has_temp{};
+};
+
+struct BatchNullWriter final : BatchWriter {
+    Result Open(const fs::FsPath& path, s64 size) override {
+        R_SUCCEED();
+    }
+    Result Write(const void* buf, s64 off, s64 size) override {
+        R_SUCCEED();
+    }
+    Result Close() override {
+        R_SUCCEED();
+    }
+};
+
+// the first file starts a session, after which every file is sent without a
+// handshake. if the host doesn't support sessions, each file gets its own.
+struct BatchUsbWriter final : BatchWriter {
+    BatchUsbWriter(ui::ProgressBox* pbox, WriteUsbSource* usb, u64 timeout)
+    : m_pbox{pbox}
+    , m_usb{usb}
+    , m_timeout{timeout} {
+    }
+
+    Result Open(const fs::FsPath& path, s64 size) override {
+        if (m_connected && m_usb->IsSession()) {
+            return m_usb->OpenFile(path);
+        }
+
+        // wait until usb is ready.
+        while (true) {
+            R_TRY(m_pbox->ShouldExitResult());
+
+            if (R_SUCCEEDED(m_usb->WaitForSession(path, m_timeout))) {
+                break;
+            }
+        }
+
+        m_connected = true;
+        R_SUCCEED();
+    }
+
+    Result Write(const void* buf, s64 off, s64 size) override {
+        return m_usb->Write(buf, off, size);
+    }
+
+    Result Close() override {
+        return m_usb->CloseFile();
+    }
+
+private:
+    ui::ProgressBox* const m_pbox;
+    WriteUsbSource* const m_usb;
+    const u64 m_timeout;
+    bool m_connected{};
+};
+
 Result DumpToUsb(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer) {
     // create write source and verify that it opened.
     constexpr u64 timeout = UINT64_MAX;
@@ -281,6 +712,15 @@ Result DumpToUsb(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::
     pbox->AddCancelEvent(write_source->GetCancelEvent());
     ON_SCOPE_EXIT(pbox->RemoveCancelEvent(write_source->GetCancelEvent()));
 
+    // custom transfers (nsz, xci) write with their own pipeline per file.
+    if (!custom_transfer && paths.size() > 1) {
+        pbox->NewTransfer("Waiting for USB connection..."_i18n);
+
+        BatchUsbWriter writer{pbox, write_source.get(), timeout};
+        R_TRY(TransferBatch(pbox, source, paths, &writer));
+        return write_source->EndSession();
+    }
+
     for (const auto& path : paths) {
         const auto file_size = source->GetSize(path);
         pbox->SetImage(source->GetIcon(path));
@@ -317,9 +757,15 @@ Result DumpToUsb(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::
     R_SUCCEED();
 }
 
-Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer) {
+Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer, s64 write_align, bool write_behind = false) {
     const auto is_file_based_emummc = App::IsFileBaseEmummc();
 
+    // custom transfers (nsz, xci) write with their own pipeline per file.
+    if (!custom_transfer && paths.size() > 1) {
+        BatchFileWriter writer{fs, root, write_align, write_behind};
+        return TransferBatch(pbox, source, paths, &writer);
+    }
+
     for (const auto& path : paths) {
         const auto base_path = fs::AppendPath(root, path);
         const auto file_size = source->GetSize(path);
@@ -331,13 +777,15 @@ Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, Bas
         fs->CreateDirectoryRecursivelyWithPath(temp_path);
         fs->DeleteFile(temp_path);
 
+        // the file is created at its final size so that the clusters are
+        // allocated up front, rather than extended on every write.
         R_TRY(fs->CreateFile(temp_path, file_size));
         ON_SCOPE_EXIT(fs->DeleteFile(temp_path));
 
         {
             fs::File file;
             R_TRY(fs->OpenFile(temp_path, FsOpenMode_Write|FsOpenMode_Append, &file));
-            auto write_source = std::make_unique<WriteFileSource>(&file);
+            auto write_source = std::make_unique<WriteFileSource>(&file, write_align, write_behind);
 
             if (custom_transfer) {
                 R_TRY(custom_transfer(pbox, source, write_source.get(), path));
@@ -347,14 +795,19 @@ Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, Bas
                         return source->Read(path, data, off, size, bytes_read);
                     },
                     [&](const void* data, s64 off, s64 size) -> Result {
+                        const auto start = armGetSystemTick();
                         const auto rc = write_source->Write(data, off, size);
                         if (is_file_based_emummc) {
-                            svcSleepThread(2e+6); // 2ms
+                            thread::EmummcThrottle(start);
                         }
                         return rc;
                     }
                 ));
             }
+
+            R_TRY(write_source->Flush());
+            write_source.reset();
+            R_TRY(file.Close());
         }
 
         fs->DeleteFile(base_path);
@@ -366,13 +819,13 @@ Result DumpToFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& root, Bas
 
 Result DumpToFileNative(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer) {
     fs::FsNativeSd fs{};
-    return DumpToFile(pbox, &fs, "/", source, paths, custom_transfer);
+    return DumpToFile(pbox, &fs, "/", source, paths, custom_transfer, WRITE_ALIGN_SD_CARD);
 }
 
 Result DumpToStdio(ui::ProgressBox* pbox, const location::StdioEntry& loc, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer) {
     fs::FsStdio fs{};
     const auto mount_path = fs::AppendPath(loc.mount, loc.dump_path);
-    return DumpToFile(pbox, &fs, mount_path, source, paths, custom_transfer);
+    return DumpToFile(pbox, &fs, mount_path, source, paths, custom_transfer, GetStdioWriteAlign(mount_path), true);
 }
 
 Result DumpToUsbS2SInternal(ui::ProgressBox* pbox, UsbTest* usb) {
@@ -459,6 +912,11 @@ Result DumpToUsbS2S(ui::ProgressBox* pbox, BaseSource* source, std::span<const f
 }
 
 Result DumpToDevNull(ui::ProgressBox* pbox, BaseSource* source, std::span<const fs::FsPath> paths, const CustomTransfer& custom_transfer) {
+    if (!custom_transfer && paths.size() > 1) {
+        BatchNullWriter writer{};
+        return TransferBatch(pbox, source, paths, &writer);
+    }
+
     for (auto path : paths) {
         R_TRY(pbox->ShouldExitResult());
 
@@ -528,6 +986,19 @@ void DumpGetLocation(const std::string& title, u32 location_flags, const OnLocat
 }
 
 Result Dump(ui::ProgressBox* pbox, const std::shared_ptr<BaseSource>& source, const DumpLocation& location, const std::vector<fs::FsPath>& paths, const CustomTransfer& custom_transfer) {
+    // log the speed of each dump, /dev/null gives the baseline read speed to compare against.
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT(
+        s64 total_size{};
+        for (const auto& path : paths) {
+            total_size += source->GetSize(path);
+        }
+
+        const auto seconds = armTicksToNs(armGetSystemTick() - start) / 1e+9;
+        const auto speed = seconds ? total_size / seconds / 1024.0 / 1024.0 : 0.0;
+        log_write("[dump] location: %u size: %.2f MiB took: %.2fs speed: %.2f MiB/s\n", location.entry.type, total_size / 1024.0 / 1024.0, seconds, speed);
+    );
+
     if (location.entry.type == DumpLocationType_Stdio) {
         R_TRY(DumpToStdio(pbox, location.stdio[location.entry.index], source.get(), paths, custom_transfer));
     } else if (location.entry.type == DumpLocationType_SdCard) {
@@ -1,57 +1,213 @@
 #include "evman.hpp"
-#include <mutex>
+#include "defines.hpp"
+#include <atomic>
+#include <array>
 #include <optional>
-#include <algorithm>
-#include <list>
+#include <vector>
 
 namespace sphaira::evman {
 namespace {
 
-std::mutex mutex{};
-std::list<EventData> events;
+// must be a power of 2.
+// large enough for hundreds of icon downloads completing at once.
+constexpr std::size_t QUEUE_SIZE = 1024;
+constexpr std::size_t QUEUE_MASK = QUEUE_SIZE - 1;
+static_assert(!(QUEUE_SIZE & QUEUE_MASK), "queue size must be a power of 2");
 
-void remove_if_matching(const EventData& e, bool remove_matching) {
-    if (remove_matching) {
-        events.remove_if([&e](const EventData&a) { return e.index() == a.index(); });
+// bounded multi-producer, single-consumer ring.
+// each cell has a sequence number which says whether it's free to be written
+// (seq == pos) or ready to be read (seq == pos + 1).
+struct Cell {
+    std::atomic<std::size_t> seq;
+    std::optional<EventData> data;
+};
+
+struct Ring {
+    Ring() {
+        for (std::size_t i = 0; i < QUEUE_SIZE; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    std::array<Cell, QUEUE_SIZE> cells{};
+    std::atomic<std::size_t> enqueue_pos{};
+    std::atomic<std::size_t> dequeue_pos{};
+};
+
+// an event that replaces older events of the same type, so only the newest
+// is kept. these are rare (launch / exit), so a lock is fine here.
+struct CoalesceSlot {
+    CoalesceSlot() {
+        mutexInit(&mutex);
+    }
+
+    Mutex mutex;
+    std::optional<EventData> data;
+    std::atomic_bool pending;
+};
+
+// events that didn't fit in the ring, ie, a completion, must still be
+// delivered, so they're kept here until the ring has been drained.
+// only used once the ring is full, so a lock is fine here.
+struct Overflow {
+    Overflow() {
+        mutexInit(&mutex);
     }
+
+    Mutex mutex;
+    std::vector<EventData> data;
+    std::size_t head{};
+    std::atomic_bool pending;
+};
+
+Ring g_ring{};
+Overflow g_overflow{};
+std::array<CoalesceSlot, std::variant_size_v<EventData>> g_slots{};
+std::atomic<u64> g_coalesced{};
+std::atomic<u64> g_overflowed{};
+
+auto push_ring(EventData&& e) -> bool {
+    auto pos = g_ring.enqueue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+
+    for (;;) {
+        cell = &g_ring.cells[pos & QUEUE_MASK];
+        const auto seq = cell->seq.load(std::memory_order_acquire);
+        const auto diff = (std::intptr_t)seq - (std::intptr_t)pos;
+
+        if (diff == 0) {
+            if (g_ring.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the consumer hasn't freed this cell yet, so the ring is full.
+            return false;
+        } else {
+            pos = g_ring.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data.emplace(std::move(e));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+auto pop_ring() -> std::optional<EventData> {
+    const auto pos = g_ring.dequeue_pos.load(std::memory_order_relaxed);
+    auto& cell = g_ring.cells[pos & QUEUE_MASK];
+
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) {
+        return std::nullopt;
+    }
+
+    auto e = std::move(cell.data);
+    cell.data.reset();
+    cell.seq.store(pos + QUEUE_SIZE, std::memory_order_release);
+    g_ring.dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+    return e;
+}
+
+void push_overflow(EventData&& e) {
+    SCOPED_MUTEX(&g_overflow.mutex);
+    g_overflow.data.emplace_back(std::move(e));
+    g_overflow.pending = true;
+    g_overflowed++;
+}
+
+auto pop_overflow() -> std::optional<EventData> {
+    if (!g_overflow.pending) {
+        return std::nullopt;
+    }
+
+    SCOPED_MUTEX(&g_overflow.mutex);
+    if (g_overflow.head >= g_overflow.data.size()) {
+        return std::nullopt;
+    }
+
+    auto e = std::move(g_overflow.data[g_overflow.head++]);
+    if (g_overflow.head == g_overflow.data.size()) {
+        g_overflow.data.clear();
+        g_overflow.head = 0;
+        g_overflow.pending = false;
+    }
+    return e;
+}
+
+auto push_coalesce(EventData&& e) -> bool {
+    auto& slot = g_slots[e.index()];
+    SCOPED_MUTEX(&slot.mutex);
+
+    if (slot.data.has_value()) {
+        g_coalesced++;
+    }
+
+    slot.data.emplace(std::move(e));
+    slot.pending = true;
+    return true;
+}
+
+auto pop_coalesce() -> std::optional<EventData> {
+    for (auto& slot : g_slots) {
+        if (!slot.pending) {
+            continue;
+        }
+
+        SCOPED_MUTEX(&slot.mutex);
+        slot.pending = false;
+        auto e = std::move(slot.data);
+        slot.data.reset();
+        if (e.has_value()) {
+            return e;
+        }
+    }
+
+    return std::nullopt;
 }
 
 } // namespace
 
 auto push(const EventData& e, bool remove_matching) -> bool {
-    std::scoped_lock lock(mutex);
-    remove_if_matching(e, remove_matching);
-    events.push_back(e);
-    return true;
+    return push(EventData{e}, remove_matching);
 }
 
 auto push(EventData&& e, bool remove_matching) -> bool {
-    std::scoped_lock lock(mutex);
-    remove_if_matching(e, remove_matching);
-    events.emplace_back(std::forward<EventData>(e));
+    if (remove_matching) {
+        return push_coalesce(std::forward<EventData>(e));
+    }
+
+    // once events have overflowed, newer events go after them so that the
+    // order is kept.
+    if (g_overflow.pending || !push_ring(std::forward<EventData>(e))) {
+        push_overflow(std::forward<EventData>(e));
+    }
     return true;
 }
 
 auto count() -> std::size_t {
-    std::scoped_lock lock(mutex);
-    return events.size();
+    std::size_t count = g_ring.enqueue_pos.load() - g_ring.dequeue_pos.load();
+    for (const auto& slot : g_slots) {
+        count += slot.pending;
+    }
+
+    if (g_overflow.pending) {
+        SCOPED_MUTEX(&g_overflow.mutex);
+        count += g_overflow.data.size() - g_overflow.head;
+    }
+    return count;
 }
 
 auto pop() -> std::optional<EventData> {
-    std::scoped_lock lock(mutex);
-    if (events.empty()) {
-        return std::nullopt;
+    if (auto e = pop_ring()) {
+        return e;
     }
-    auto e = events.front();
-    events.pop_front();
-    return e;
+    if (auto e = pop_overflow()) {
+        return e;
+    }
+    return pop_coalesce();
 }
 
-auto popall() -> std::list<EventData> {
-    std::scoped_lock lock(mutex);
-    auto list_copy = events;
-    events.clear();
-    return list_copy;
+auto get_stats() -> Stats {
+    return {g_coalesced.load(), g_overflowed.load()};
 }
 
 } // namespace sphaira::evman
@@ -0,0 +1,296 @@
+#include "file_copy.hpp"
+#include "app.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+#include "i18n.hpp"
+#include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <optional>
+#include <cstring>
+#include <cstdio>
+
+namespace sphaira::copy {
+namespace {
+
+// files up to this size are read into a single buffer and written in one go.
+constexpr s64 SMALL_FILE_MAX = 1024 * 1024;
+constexpr u32 WORKER_COUNT = 3;
+
+struct ThreadData {
+    ThreadData(ui::ProgressBox* _pbox, fs::Fs* _fs_src, fs::Fs* _fs_dst, std::span<const Entry> _entries, const DoneCallback& _done, bool _throttle, bool _verify, u32 worker_count)
+    : pbox{_pbox}
+    , fs_src{_fs_src}
+    , fs_dst{_fs_dst}
+    , entries{_entries}
+    , done{_done}
+    , throttle{_throttle}
+    , verify{_verify}
+    , active_workers{worker_count} {
+        mutexInit(std::addressof(mutex));
+        mutexInit(std::addressof(done_mutex));
+        condvarInit(std::addressof(can_stream));
+    }
+
+    auto GetResults() volatile -> Result {
+        R_TRY(pbox->ShouldExitResult());
+        R_TRY(result.load());
+        R_SUCCEED();
+    }
+
+    void SetResult(Result rc) {
+        if (R_FAILED(rc)) {
+            result = rc;
+        }
+    }
+
+    Result OnDone(const Entry& entry, s64 size) {
+        if (done) {
+            SCOPED_MUTEX(std::addressof(done_mutex));
+            R_TRY(done(entry));
+        }
+
+        bytes_done += size;
+        files_done++;
+        R_SUCCEED();
+    }
+
+    Result CopySmallFile(const Entry& entry, bool& is_large);
+    Result VerifySmallFile(const Entry& entry, std::span<const u8> data);
+    Result workerFuncInternal();
+
+    ui::ProgressBox* const pbox;
+    fs::Fs* const fs_src;
+    fs::Fs* const fs_dst;
+    const std::span<const Entry> entries;
+    const DoneCallback& done;
+    const bool throttle;
+    const bool verify;
+
+    Mutex mutex{};
+    Mutex done_mutex{};
+    // signalled when a large file is queued or a worker exits.
+    CondVar can_stream{};
+    // index of files too large for the workers, protected by mutex.
+    std::vector<size_t> large_files{};
+
+    std::atomic<size_t> next_index{};
+    std::atomic<size_t> files_done{};
+    std::atomic<s64> bytes_done{};
+    std::atomic<u32> active_workers;
+    std::atomic<Result> result{};
+};
+
+Result ThreadData::CopySmallFile(const Entry& entry, bool& is_large) {
+    fs::File src_file;
+    R_TRY(fs_src->OpenFile(entry.src, FsOpenMode_Read, &src_file));
+
+    s64 size;
+    R_TRY(src_file.GetSize(&size));
+    if (size > SMALL_FILE_MAX) {
+        is_large = true;
+        R_SUCCEED();
+    }
+
+    utils::pool::Vector<u8> buf(size);
+    s64 offset{};
+    while (offset < size) {
+        u64 bytes_read;
+        R_TRY(src_file.Read(offset, buf.data() + offset, size - offset, 0, &bytes_read));
+        if (!bytes_read) {
+            break;
+        }
+
+        offset += bytes_read;
+    }
+    src_file.Close();
+
+    // this can fail if it already exists so we ignore the result.
+    fs_dst->CreateFile(entry.dst, offset, 0);
+
+    fs::File dst_file;
+    R_TRY(fs_dst->OpenFile(entry.dst, FsOpenMode_Write, &dst_file));
+    R_TRY(dst_file.SetSize(offset));
+    if (offset) {
+        R_TRY(dst_file.Write(0, buf.data(), offset, 0));
+    }
+
+    if (verify) {
+        // close first so that everything is flushed before reading it back.
+        R_TRY(dst_file.Close());
+        R_TRY(VerifySmallFile(entry, std::span{buf.data(), (size_t)offset}));
+    }
+
+    if (throttle) {
+        svcSleepThread(2e+6); // 2ms
+    }
+
+    return OnDone(entry, offset);
+}
+
+Result ThreadData::VerifySmallFile(const Entry& entry, std::span<const u8> data) {
+    fs::File file;
+    R_TRY(fs_dst->OpenFile(entry.dst, FsOpenMode_Read, &file));
+
+    s64 size;
+    R_TRY(file.GetSize(&size));
+    R_UNLESS(size == (s64)data.size(), Result_CopyVerifyFailed);
+
+    utils::pool::Vector<u8> buf(size);
+    s64 offset{};
+    while (offset < size) {
+        u64 bytes_read;
+        R_TRY(file.Read(offset, buf.data() + offset, size - offset, 0, &bytes_read));
+        R_UNLESS(bytes_read, Result_CopyVerifyFailed);
+        offset += bytes_read;
+    }
+
+    if (std::memcmp(buf.data(), data.data(), size)) {
+        log_write("[COPY] verify failed: %s\n", entry.dst.s);
+        R_THROW(Result_CopyVerifyFailed);
+    }
+
+    R_SUCCEED();
+}
+
+Result ThreadData::workerFuncInternal() {
+    ON_SCOPE_EXIT(
+        SCOPED_MUTEX(std::addressof(mutex));
+        active_workers--;
+        condvarWakeAll(std::addressof(can_stream));
+    );
+
+    while (R_SUCCEEDED(GetResults())) {
+        const auto index = next_index++;
+        if (index >= entries.size()) {
+            break;
+        }
+
+        bool is_large{};
+        R_TRY(CopySmallFile(entries[index], is_large));
+
+        if (is_large) {
+            SCOPED_MUTEX(std::addressof(mutex));
+            large_files.emplace_back(index);
+            condvarWakeOne(std::addressof(can_stream));
+        }
+    }
+
+    R_SUCCEED();
+}
+
+void workerFunc(void* d) {
+    auto t = static_cast<ThreadData*>(d);
+    t->SetResult(t->workerFuncInternal());
+}
+
+} // namespace
+
+Result CopyFiles(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, std::span<const Entry> entries, const Config& config, const DoneCallback& done) {
+    if (entries.empty()) {
+        R_SUCCEED();
+    }
+
+    // file based emummc can't handle lots of parallel io, so only use 1 worker.
+    const auto throttle = App::IsFileBaseEmummc() && fs_src->IsNative() && fs_dst->IsNative();
+    const auto worker_count = std::min<u32>(throttle ? 1 : WORKER_COUNT, entries.size());
+
+    s64 total_size{};
+    for (const auto& e : entries) {
+        total_size += e.size;
+    }
+
+    ThreadData t_data{pbox, fs_src, fs_dst, entries, done, throttle, config.verify, worker_count};
+
+    Thread t_workers[WORKER_COUNT]{};
+    u32 t_worker_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadClose(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < worker_count; i++) {
+        R_TRY(utils::CreateThread(&t_workers[i], workerFunc, std::addressof(t_data)));
+        t_worker_count++;
+    }
+
+    ON_SCOPE_EXIT(
+        // ensure the workers exit if we return early.
+        t_data.SetResult(0x1);
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadWaitForExit(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < t_worker_count; i++) {
+        R_TRY(threadStart(&t_workers[i]));
+    }
+
+    const auto start = armGetSystemTick();
+    const auto new_transfer = [&]() {
+        pbox->NewTransfer("Copying files"_i18n);
+    };
+
+    const auto update_progress = [&]() {
+        const auto files_done = t_data.files_done.load();
+        const auto seconds = armTicksToNs(armGetSystemTick() - start) / 1e+9;
+        const auto files_per_second = seconds ? files_done / seconds : 0.0;
+
+        char str[128];
+        std::snprintf(str, sizeof(str), "%zu / %zu files (%.1f files/s)"_i18n.c_str(), files_done, entries.size(), files_per_second);
+        pbox->SetTitle(str);
+
+        if (total_size) {
+            pbox->UpdateTransfer(std::min<s64>(t_data.bytes_done, total_size), total_size);
+        } else {
+            pbox->UpdateTransfer(files_done, entries.size());
+        }
+    };
+
+    new_transfer();
+
+    for (;;) {
+        R_TRY(t_data.GetResults());
+
+        mutexLock(std::addressof(t_data.mutex));
+        if (t_data.large_files.empty() && t_data.active_workers) {
+            condvarWaitTimeout(std::addressof(t_data.can_stream), std::addressof(t_data.mutex), 1e+8); // 100ms
+        }
+
+        std::optional<size_t> index{};
+        if (!t_data.large_files.empty()) {
+            index = t_data.large_files.back();
+            t_data.large_files.pop_back();
+        }
+        const auto workers_done = !t_data.active_workers;
+        mutexUnlock(std::addressof(t_data.mutex));
+
+        if (index) {
+            const auto& entry = entries[*index];
+            log_write("[COPY] streaming large file: %s\n", entry.src.s);
+
+            pbox->SetTitle(std::strrchr(entry.src, '/') ? std::strrchr(entry.src, '/') + 1 : entry.src.s);
+            pbox->NewTransfer(i18n::Reorder("Copying ", entry.src));
+            R_TRY(pbox->CopyFile(fs_src, fs_dst, entry.src, entry.dst, config.single_threaded, config.parallel_read, config.verify));
+            R_TRY(t_data.OnDone(entry, entry.size));
+            new_transfer();
+        } else if (workers_done) {
+            break;
+        }
+
+        update_progress();
+    }
+
+    // the workers may have exited due to an error.
+    R_TRY(t_data.GetResults());
+
+    const auto seconds = armTicksToNs(armGetSystemTick() - start) / 1e+9;
+    log_write("[COPY] copied %zu files in %.2fs\n", t_data.files_done.load(), seconds);
+    R_SUCCEED();
+}
+
+} // namespace sphaira::copy
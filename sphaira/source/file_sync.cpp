@@ -0,0 +1,214 @@
+#include "file_sync.hpp"
+#include "tree_walk.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+#include "i18n.hpp"
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <ranges>
+
+namespace sphaira::sync {
+namespace {
+
+// returns true if src needs to be copied over dst.
+auto IsChanged(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, s64 src_size, s64 dst_size, const Config& config) -> bool {
+    if (src_size != dst_size) {
+        return true;
+    }
+
+    if (!config.compare_timestamp) {
+        return false;
+    }
+
+    // copy if either time is unknown, as that's the safe option.
+    FsTimeStampRaw src_ts{}, dst_ts{};
+    if (R_FAILED(fs_src->GetFileTimeStampRaw(src, &src_ts)) || R_FAILED(fs_dst->GetFileTimeStampRaw(dst, &dst_ts))) {
+        return true;
+    }
+
+    if (!src_ts.is_valid || !dst_ts.is_valid) {
+        return true;
+    }
+
+    return src_ts.modified > dst_ts.modified;
+}
+
+// path of dir relative to root, empty for root itself.
+auto GetRelativePath(const fs::FsPath& root, const fs::FsPath& dir) -> std::string {
+    std::string_view rel{dir};
+    rel.remove_prefix(std::min(rel.length(), std::strlen(root)));
+    while (rel.starts_with('/')) {
+        rel.remove_prefix(1);
+    }
+    return std::string{rel};
+}
+
+auto JoinPath(const std::string& rel, const char* name) -> std::string {
+    return rel.empty() ? name : rel + '/' + name;
+}
+
+void AddFile(Plan& out, const fs::FsPath& src, const fs::FsPath& dst, s64 size, bool is_new) {
+    out.files.emplace_back(src, dst, size);
+    out.copy_size += size;
+    if (is_new) {
+        out.new_count++;
+    } else {
+        out.changed_count++;
+    }
+}
+
+} // namespace
+
+Result BuildPlan(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, Plan& out, const Config& config) {
+    walk::Config walk_config{};
+    walk_config.inc_size = true;
+
+    pbox->NewTransfer(i18n::Reorder("Scanning ", src.toString()));
+    walk::Collections src_collections;
+    R_TRY(walk::Walk(fs_src, src, src, src_collections, walk_config));
+    R_TRY(pbox->ShouldExitResult());
+
+    // paths relative to the folder being synced.
+    std::unordered_map<std::string, s64> dst_files;
+    std::unordered_set<std::string> dst_dirs;
+    walk::Collections dst_collections;
+
+    const auto dst_exists = fs_dst->DirExists(dst);
+    if (dst_exists) {
+        pbox->NewTransfer(i18n::Reorder("Scanning ", dst.toString()));
+        R_TRY(walk::Walk(fs_dst, dst, dst, dst_collections, walk_config));
+        R_TRY(pbox->ShouldExitResult());
+
+        for (const auto& c : dst_collections) {
+            const auto rel = GetRelativePath(dst, c.path);
+            for (const auto& e : c.files) {
+                dst_files.emplace(JoinPath(rel, e.name), e.file_size);
+            }
+            for (const auto& e : c.dirs) {
+                dst_dirs.emplace(JoinPath(rel, e.name));
+            }
+        }
+    } else {
+        out.dirs.emplace_back(dst);
+    }
+
+    std::unordered_set<std::string> src_files;
+    std::unordered_set<std::string> src_dirs;
+
+    for (const auto& c : src_collections) {
+        const auto rel_dir = GetRelativePath(src, c.path);
+        const auto dst_path = rel_dir.empty() ? dst : fs::AppendPath(dst, rel_dir);
+
+        for (const auto& e : c.dirs) {
+            const auto rel = JoinPath(rel_dir, e.name);
+            src_dirs.emplace(rel);
+
+            if (!dst_dirs.contains(rel)) {
+                out.dirs.emplace_back(fs::AppendPath(dst_path, e.name));
+            }
+        }
+
+        for (const auto& e : c.files) {
+            pbox->Yield();
+            R_TRY(pbox->ShouldExitResult());
+
+            const auto rel = JoinPath(rel_dir, e.name);
+            const auto src_file = fs::AppendPath(c.path, e.name);
+            const auto dst_file = fs::AppendPath(dst_path, e.name);
+            src_files.emplace(rel);
+
+            const auto it = dst_files.find(rel);
+            if (it == dst_files.end()) {
+                AddFile(out, src_file, dst_file, e.file_size, true);
+            } else {
+                pbox->NewTransfer(i18n::Reorder("Comparing ", src_file.toString()));
+                if (IsChanged(fs_src, fs_dst, src_file, dst_file, e.file_size, it->second, config)) {
+                    AddFile(out, src_file, dst_file, e.file_size, false);
+                } else {
+                    out.unchanged_count++;
+                }
+            }
+        }
+    }
+
+    // sub dirs come after their parent, so walk in reverse for deleting.
+    for (const auto& c : std::views::reverse(dst_collections)) {
+        const auto rel = GetRelativePath(dst, c.path);
+        for (const auto& e : c.files) {
+            if (!src_files.contains(JoinPath(rel, e.name))) {
+                out.extra_files.emplace_back(fs::AppendPath(c.path, e.name));
+            }
+        }
+
+        for (const auto& e : c.dirs) {
+            if (!src_dirs.contains(JoinPath(rel, e.name))) {
+                out.extra_dirs.emplace_back(fs::AppendPath(c.path, e.name));
+            }
+        }
+    }
+
+    log_write("[SYNC] %s -> %s new: %zu changed: %zu unchanged: %zu extra: %zu\n", src.s, dst.s, out.new_count, out.changed_count, out.unchanged_count, out.extra_files.size() + out.extra_dirs.size());
+    R_SUCCEED();
+}
+
+Result BuildPlanFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src, const fs::FsPath& dst, Plan& out, const Config& config) {
+    FsTimeStampRaw ts;
+    s64 src_size;
+    R_TRY(fs_src->FileGetSizeAndTimestamp(src, &ts, &src_size));
+
+    if (!fs_dst->FileExists(dst)) {
+        AddFile(out, src, dst, src_size, true);
+        R_SUCCEED();
+    }
+
+    s64 dst_size;
+    R_TRY(fs_dst->FileGetSizeAndTimestamp(dst, &ts, &dst_size));
+
+    if (IsChanged(fs_src, fs_dst, src, dst, src_size, dst_size, config)) {
+        AddFile(out, src, dst, src_size, false);
+    } else {
+        out.unchanged_count++;
+    }
+
+    R_SUCCEED();
+}
+
+Result ApplyPlan(ui::ProgressBox* pbox, fs::Fs* fs_src, fs::Fs* fs_dst, const Plan& plan, bool delete_extra, const copy::Config& config) {
+    for (const auto& path : plan.dirs) {
+        pbox->Yield();
+        R_TRY(pbox->ShouldExitResult());
+
+        pbox->NewTransfer(i18n::Reorder("Creating ", path.toString()));
+        fs_dst->CreateDirectory(path);
+    }
+
+    R_TRY(copy::CopyFiles(pbox, fs_src, fs_dst, plan.files, config));
+
+    if (delete_extra) {
+        // files first, so that the dirs are empty.
+        for (const auto& path : plan.extra_files) {
+            pbox->Yield();
+            R_TRY(pbox->ShouldExitResult());
+
+            pbox->NewTransfer(i18n::Reorder("Deleting ", path.toString()));
+            R_TRY(fs_dst->DeleteFile(path));
+        }
+
+        for (const auto& path : plan.extra_dirs) {
+            pbox->Yield();
+            R_TRY(pbox->ShouldExitResult());
+
+            pbox->NewTransfer(i18n::Reorder("Deleting ", path.toString()));
+            R_TRY(fs_dst->DeleteDirectory(path));
+        }
+    }
+
+    R_SUCCEED();
+}
+
+} // namespace sphaira::sync
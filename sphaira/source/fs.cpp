@@ -2,9 +2,11 @@
 #include "defines.hpp"
 #include "ui/nvg_util.hpp"
 #include "log.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <switch.h>
 #include <cstdio>
+#include <atomic>
 #include <cstring>
 #include <vector>
 #include <string_view>
@@ -101,8 +103,65 @@ bool is_read_only(std::string_view path) {
     return false;
 }
 
+std::atomic<u64> g_change_generation{};
+
+// usb drives are mounted by libusbhsfs as ums0:, ums1: etc.
+constexpr u32 USB_STDIO_BUFFER_SIZE = 1024 * 256;
+
+struct StdioBufferSize {
+    std::string device;
+    u32 size;
+};
+
+Mutex g_stdio_buffer_mutex{};
+std::vector<StdioBufferSize> g_stdio_buffer_sizes{};
+
 } // namespace
 
+auto GetChangeGeneration() -> u64 {
+    return g_change_generation;
+}
+
+void SignalChange() {
+    g_change_generation++;
+}
+
+void SetStdioBufferSize(std::string_view device, u32 size) {
+    SCOPED_MUTEX(&g_stdio_buffer_mutex);
+
+    std::erase_if(g_stdio_buffer_sizes, [device](const auto& e) {
+        return e.device == device;
+    });
+
+    if (size) {
+        g_stdio_buffer_sizes.emplace_back(std::string{device}, size);
+    }
+}
+
+auto GetStdioBufferSize(std::string_view path) -> u32 {
+    const auto device = path.substr(0, path.find(':'));
+    if (device.size() == path.size()) {
+        return 0;
+    }
+
+    {
+        SCOPED_MUTEX(&g_stdio_buffer_mutex);
+        const auto it = std::ranges::find_if(g_stdio_buffer_sizes, [device](const auto& e) {
+            return e.device == device;
+        });
+
+        if (it != g_stdio_buffer_sizes.end()) {
+            return it->size;
+        }
+    }
+
+    if (device.starts_with("ums")) {
+        return USB_STDIO_BUFFER_SIZE;
+    }
+
+    return 0;
+}
+
 FsPath AppendPath(const FsPath& root_path, const FsPath& _file_path) {
     // strip leading '/' in file path.
     auto file_path = _file_path.s;
@@ -157,7 +216,8 @@ Result copy_entire_file(Fs* fs, const FsPath& dst, const FsPath& src, bool ignor
     return write_entire_file(fs, dst, data, ignore_read_only);
 }
 
-Result CreateFile(FsFileSystem* fs, const FsPathReal& path, u64 size, u32 option, bool ignore_read_only) {
+Result CreateFile(FsFileSystem* fs, const FsPathReal& path, u64 size, u32 option, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only_root(path), Result_FsReadOnly);
 
     if (size >= 1024ULL*1024ULL*1024ULL*4ULL) {
@@ -166,25 +226,30 @@ Result CreateFile(FsFileSystem* fs, const FsPathReal& path, u64 size, u32 option
 
     log_write("trying to create path: %s\n", path.s);
     R_TRY(fsFsCreateFile(fs, path, size, option));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result CreateDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only) {
+Result CreateDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only_root(path), Result_FsReadOnly);
 
     R_TRY(fsFsCreateDirectory(fs, path));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& _path, bool ignore_read_only) {
+Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& _path, bool ignore_read_only, bool commit) {
     R_UNLESS(ignore_read_only || !is_read_only_root(_path), Result_FsReadOnly);
 
     // try and create the directory / see if it already exists before the loop.
     Result rc;
     if (fs) {
-        rc = CreateDirectory(fs, _path, ignore_read_only);
+        rc = CreateDirectory(fs, _path, ignore_read_only, commit);
     } else {
         rc = CreateDirectory(_path, ignore_read_only);
     }
@@ -210,7 +275,7 @@ Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& _path, bool ig
         log_write("[FS] dir creation path is now: %s\n", path.s);
 
         if (fs) {
-            rc = CreateDirectory(fs, path, ignore_read_only);
+            rc = CreateDirectory(fs, path, ignore_read_only, commit);
         } else {
             rc = CreateDirectory(path, ignore_read_only);
         }
@@ -230,7 +295,7 @@ Result CreateDirectoryRecursively(FsFileSystem* fs, const FsPath& _path, bool ig
     R_SUCCEED();
 }
 
-Result CreateDirectoryRecursivelyWithPath(FsFileSystem* fs, const FsPath& _path, bool ignore_read_only) {
+Result CreateDirectoryRecursivelyWithPath(FsFileSystem* fs, const FsPath& _path, bool ignore_read_only, bool commit) {
     R_UNLESS(ignore_read_only || !is_read_only_root(_path), Result_FsReadOnly);
 
     // strip file name form path.
@@ -241,48 +306,63 @@ Result CreateDirectoryRecursivelyWithPath(FsFileSystem* fs, const FsPath& _path,
 
     FsPath new_path{};
     std::snprintf(new_path, sizeof(new_path), "%.*s", (int)(last_slash - _path.s), _path.s);
-    R_TRY(CreateDirectoryRecursively(fs, new_path, ignore_read_only));
+    R_TRY(CreateDirectoryRecursively(fs, new_path, ignore_read_only, commit));
     R_SUCCEED();
 }
 
-Result DeleteFile(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only) {
+Result DeleteFile(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(path), Result_FsReadOnly);
     R_TRY(fsFsDeleteFile(fs, path));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result DeleteDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only) {
+Result DeleteDirectory(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(path), Result_FsReadOnly);
 
     R_TRY(fsFsDeleteDirectory(fs, path));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result DeleteDirectoryRecursively(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only) {
+Result DeleteDirectoryRecursively(FsFileSystem* fs, const FsPathReal& path, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(path), Result_FsReadOnly);
 
     R_TRY(fsFsDeleteDirectoryRecursively(fs, path));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result RenameFile(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only) {
+Result RenameFile(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(src), Result_FsReadOnly);
     R_UNLESS(ignore_read_only || !is_read_only(dst), Result_FsReadOnly);
 
     R_TRY(fsFsRenameFile(fs, src, dst));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
-Result RenameDirectory(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only) {
+Result RenameDirectory(FsFileSystem* fs, const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only, bool commit) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(src), Result_FsReadOnly);
     R_UNLESS(ignore_read_only || !is_read_only(dst), Result_FsReadOnly);
 
     R_TRY(fsFsRenameDirectory(fs, src, dst));
-    fsFsCommit(fs);
+    if (commit) {
+        fsFsCommit(fs);
+    }
     R_SUCCEED();
 }
 
@@ -312,6 +392,7 @@ bool DirExists(FsFileSystem* fs, const FsPath& path) {
 }
 
 Result CreateFile(const FsPathReal& path, u64 size, u32 option, bool ignore_read_only) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only_root(path), Result_FsReadOnly);
 
     auto fd = open(path, O_WRONLY | O_CREAT, DEFFILEMODE);
@@ -333,6 +414,7 @@ Result CreateFile(const FsPathReal& path, u64 size, u32 option, bool ignore_read
 }
 
 Result CreateDirectory(const FsPathReal& path, bool ignore_read_only) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only_root(path), Result_FsReadOnly);
 
     if (mkdir(path, ACCESSPERMS)) {
@@ -359,6 +441,7 @@ Result CreateDirectoryRecursivelyWithPath(const FsPath& path, bool ignore_read_o
 }
 
 Result DeleteFile(const FsPathReal& path, bool ignore_read_only) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(path), Result_FsReadOnly);
 
     if (unlink(path)) {
@@ -369,6 +452,7 @@ Result DeleteFile(const FsPathReal& path, bool ignore_read_only) {
 }
 
 Result DeleteDirectory(const FsPathReal& path, bool ignore_read_only) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(path), Result_FsReadOnly);
 
     if (rmdir(path)) {
@@ -400,6 +484,7 @@ Result DeleteDirectoryRecursively(const FsPath& path, bool ignore_read_only) {
 }
 
 Result RenameFile(const FsPathReal& src, const FsPathReal& dst, bool ignore_read_only) {
+    ON_SCOPE_EXIT(SignalChange());
     R_UNLESS(ignore_read_only || !is_read_only(src), Result_FsReadOnly);
     R_UNLESS(ignore_read_only || !is_read_only(dst), Result_FsReadOnly);
 
@@ -442,6 +527,7 @@ Result GetFileTimeStampRaw(const FsPathReal& path, FsTimeStampRaw *out) {
 }
 
 Result SetTimestamp(const FsPathReal& path, const FsTimeStampRaw* ts) {
+    ON_SCOPE_EXIT(SignalChange());
     if (ts->is_valid) {
         timeval val[2]{};
         val[0].tv_sec = ts->accessed;
@@ -496,6 +582,12 @@ Result OpenFile(fs::Fs* fs, const FsPathReal& path, u32 mode, File* f) {
         // which kills performance (see sftp).
         if (!should_buffer) {
             std::setvbuf(f->m_stdio, nullptr, _IONBF, 0);
+        } else if (const auto size = GetStdioBufferSize(path.s)) {
+            // if the pool is out of memory then the libc default is kept.
+            if ((f->m_stdio_buf = sphaira::utils::pool::Allocate(size))) {
+                f->m_stdio_buf_size = size;
+                std::setvbuf(f->m_stdio, (char*)f->m_stdio_buf, _IOFBF, size);
+            }
         }
     }
 
@@ -517,7 +609,7 @@ Result File::Read( s64 off, void* buf, u64 read_size, u32 option, u64* bytes_rea
 
         if (off != std::ftell(m_stdio)) {
             const auto ret = std::fseek(m_stdio, off, SEEK_SET);
-            log_write("[FS] fseek to %ld ret: %d new_off: %zd\n", off, ret, std::ftell(m_stdio));
+            log_debug(LogCategory_Fs, "[FS] fseek to %ld ret: %d new_off: %zd\n", off, ret, std::ftell(m_stdio));
             R_UNLESS(ret == 0, Result_FsStdioFailedToSeek);
             R_UNLESS(off == std::ftell(m_stdio), Result_FsStdioFailedToSeek);
         }
@@ -541,6 +633,7 @@ Result File::Write(s64 off, const void* buf, u64 write_size, u32 option) {
 
     if (m_fs->IsNative()) {
         R_TRY(fsFileWrite(&m_native, off, buf, write_size, option));
+        ((FsNative*)m_fs)->AddPendingCommit(write_size);
     } else {
         R_UNLESS(m_stdio, Result_FsUnknownStdioError);
 
@@ -589,9 +682,9 @@ Result File::GetSize(s64* out) {
     R_SUCCEED();
 }
 
-void File::Close() {
+Result File::Close() {
     if (!m_fs) {
-        return;
+        R_SUCCEED();
     }
 
     if (m_fs->IsNative()) {
@@ -599,16 +692,58 @@ void File::Close() {
             fsFileClose(&m_native);
             if (m_mode & FsOpenMode_Write) {
                 m_fs->Commit();
+                SignalChange();
             }
             m_native = {};
         }
     } else {
         if (m_stdio) {
-            log_write("[FS] closing stdio file\n");
-            std::fclose(m_stdio);
+            log_debug(LogCategory_Fs, "[FS] closing stdio file\n");
+            const auto ret = std::fclose(m_stdio);
+            const auto err = errno;
             m_stdio = {};
+            if (m_stdio_buf) {
+                sphaira::utils::pool::Free(m_stdio_buf, m_stdio_buf_size);
+                m_stdio_buf = {};
+                m_stdio_buf_size = {};
+            }
+            if (m_mode & FsOpenMode_Write) {
+                SignalChange();
+            }
+
+            if (ret) {
+                log_write("[FS] fclose() failed: %s\n", std::strerror(err));
+                R_THROW(Result_FsStdioFailedToFlush);
+            }
         }
     }
+
+    R_SUCCEED();
+}
+
+Result FsNative::Commit() {
+    // files that are still open for writing can't be committed, so a batch is
+    // only ever flushed here once the file that went over the limit is closed.
+    if (IsCommitBatched() && m_commit_pending < m_commit_limit) {
+        R_SUCCEED();
+    }
+
+    m_commit_pending = 0;
+    return fsFsCommit(&m_fs);
+}
+
+void FsNative::BeginCommitBatch(s64 limit) {
+    m_commit_limit = limit;
+    m_commit_pending = 0;
+}
+
+Result FsNative::EndCommitBatch() {
+    m_commit_limit = 0;
+    return Commit();
+}
+
+void FsNative::AddPendingCommit(s64 size) {
+    m_commit_pending += size;
 }
 
 Result OpenDirectory(fs::Fs* fs, const FsPathReal& path, u32 mode, Dir* d) {
@@ -4,14 +4,19 @@
 #include "fs.hpp"
 #include "log.hpp"
 #include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <cstring>
 #include <ftpsrv.h>
 #include <ftpsrv_vfs.h>
 #include <nx/vfs_nx.h>
 #include <nx/utils.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/iosupport.h>
 
 namespace sphaira::ftpsrv {
 namespace {
@@ -282,14 +287,116 @@ struct FtpVfsFile {
     int valid;
 };
 
+// reads / writes through the stdio vfs are done in blocks of this size, rather
+// than one ftp buffer at a time, as each devoptab call has a fixed cost.
+constexpr size_t FILE_BUFFER_SIZE = 1024 * 1024;
+// number of closed files kept for GetSessionStats().
+constexpr size_t MAX_FINISHED_STATS = 4;
+
+// read-ahead / write-behind buffer of an open file.
+// only used by the ftp thread, apart from the stats.
+struct FileBuffer {
+    utils::pool::Vector<u8> data{};
+    fs::FsPath path{};
+    // read: the valid bytes and the read offset, write: the pending bytes.
+    size_t size{};
+    size_t offset{};
+    u64 start_tick{};
+    std::atomic<s64> bytes{};
+    bool write{};
+};
+
+// keyed by fd, as the file struct is allocated by ftpsrv.
+std::unordered_map<int, std::unique_ptr<FileBuffer>> g_file_buffers{};
+std::deque<SessionStats> g_finished_stats{};
+Mutex g_file_mutex{};
+
+auto GetFileBuffer(int fd) -> FileBuffer* {
+    SCOPED_MUTEX(&g_file_mutex);
+    const auto it = g_file_buffers.find(fd);
+    return it == g_file_buffers.end() ? nullptr : it->second.get();
+}
+
+auto GetFileStats(const FileBuffer* b, bool active) -> SessionStats {
+    return SessionStats{
+        .path = b->path.s,
+        .bytes = b->bytes,
+        .elapsed_ns = armTicksToNs(armGetSystemTick() - b->start_tick),
+        .upload = b->write,
+        .active = active,
+    };
+}
+
+int FlushFileBuffer(int fd, FileBuffer* b) {
+    size_t done = 0;
+    while (done < b->size) {
+        const auto rc = write(fd, b->data.data() + done, b->size - done);
+        if (rc <= 0) {
+            if (!rc) {
+                errno = EIO;
+            }
+            return -1;
+        }
+        done += rc;
+    }
+
+    b->size = 0;
+    return 0;
+}
+
+struct DirListingEntry {
+    std::string name;
+    struct stat st;
+};
+
+struct DirListing {
+    std::vector<DirListingEntry> entries;
+    size_t index;
+};
+
+// these are allocated by ftpsrv, so they're kept the same size as before.
 struct FtpVfsDir {
-    DIR* fd;
+    DirListing* listing;
 };
 
 struct FtpVfsDirEntry {
-    struct dirent* buf;
+    const DirListingEntry* entry;
 };
 
+// reads the whole dir from the devoptab in one go when opened.
+// dirnext returns the stat along with the name, which readdir() throws away,
+// so LIST / MLSD would then lstat every entry again.
+int ReadDirListing(const fs::FsPath& path, std::vector<DirListingEntry>& out) {
+    const auto device = FindDevice(path);
+    const auto dev = GetDeviceOpTab(path);
+    if (device < 0 || !dev || !dev->diropen_r) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    std::vector<u8> state(dev->dirStateSize);
+    DIR_ITER dir{};
+    dir.device = device;
+    dir.dirStruct = state.data();
+
+    auto r = _REENT;
+    if (!dev->diropen_r(r, &dir, path)) {
+        return -1;
+    }
+    ON_SCOPE_EXIT(dev->dirclose_r(r, &dir));
+
+    char name[NAME_MAX + 1];
+    struct stat st;
+    while (!dev->dirnext_r(r, &dir, name, &st)) {
+        if (std::strcmp(name, ".") && std::strcmp(name, "..")) {
+            out.emplace_back(name, st);
+        }
+    }
+
+    errno = 0;
+    return 0;
+}
+
 auto vfs_stdio_fix_path(const char* str) -> fs::FsPath {
     while (*str == '/') {
         str++;
@@ -326,6 +433,15 @@ int vfs_stdio_open(void* user, const char* _path, enum FtpVfsOpenMode mode) {
     f->fd = open(path, flags, args);
     if (f->fd >= 0) {
         f->valid = 1;
+
+        auto b = std::make_unique<FileBuffer>();
+        b->data.resize(FILE_BUFFER_SIZE);
+        b->path = path;
+        b->start_tick = armGetSystemTick();
+        b->write = mode != FtpVfsOpenMode_READ;
+
+        SCOPED_MUTEX(&g_file_mutex);
+        g_file_buffers[f->fd] = std::move(b);
     }
 
     return f->fd;
@@ -333,16 +449,68 @@ int vfs_stdio_open(void* user, const char* _path, enum FtpVfsOpenMode mode) {
 
 int vfs_stdio_read(void* user, void* buf, size_t size) {
     auto f = static_cast<FtpVfsFile*>(user);
-    return read(f->fd, buf, size);
+    auto b = GetFileBuffer(f->fd);
+    if (!b) {
+        return read(f->fd, buf, size);
+    }
+
+    if (b->offset == b->size) {
+        const auto rc = read(f->fd, b->data.data(), b->data.size());
+        if (rc <= 0) {
+            return rc;
+        }
+
+        b->size = rc;
+        b->offset = 0;
+    }
+
+    const auto rsize = std::min(size, b->size - b->offset);
+    std::memcpy(buf, b->data.data() + b->offset, rsize);
+    b->offset += rsize;
+    b->bytes += rsize;
+    return rsize;
 }
 
 int vfs_stdio_write(void* user, const void* buf, size_t size) {
     auto f = static_cast<FtpVfsFile*>(user);
-    return write(f->fd, buf, size);
+    auto b = GetFileBuffer(f->fd);
+    if (!b) {
+        return write(f->fd, buf, size);
+    }
+
+    if (b->size + size > b->data.size() && FlushFileBuffer(f->fd, b)) {
+        return -1;
+    }
+
+    // too large to buffer, the buffer was flushed above so the order is kept.
+    if (size >= b->data.size()) {
+        const auto rc = write(f->fd, buf, size);
+        if (rc > 0) {
+            b->bytes += rc;
+        }
+        return rc;
+    }
+
+    std::memcpy(b->data.data() + b->size, buf, size);
+    b->size += size;
+    b->bytes += size;
+    return size;
 }
 
 int vfs_stdio_seek(void* user, const void* buf, size_t size, size_t off) {
     auto f = static_cast<FtpVfsFile*>(user);
+
+    // the buffered data is only valid at the current position.
+    if (auto b = GetFileBuffer(f->fd)) {
+        if (b->write) {
+            if (FlushFileBuffer(f->fd, b)) {
+                return -1;
+            }
+        } else {
+            b->size = b->offset = 0;
+        }
+    }
+
     const auto pos = lseek(f->fd, off, SEEK_SET);
     if (pos < 0) {
         return -1;
@@ -359,7 +527,35 @@ int vfs_stdio_close(void* user) {
     auto f = static_cast<FtpVfsFile*>(user);
     int rc = 0;
     if (vfs_stdio_isfile_open(f)) {
-        rc = close(f->fd);
+        // a failed flush is reported, the file is closed either way.
+        std::unique_ptr<FileBuffer> b;
+        {
+            SCOPED_MUTEX(&g_file_mutex);
+            if (auto it = g_file_buffers.find(f->fd); it != g_file_buffers.end()) {
+                b = std::move(it->second);
+                g_file_buffers.erase(it);
+            }
+        }
+
+        if (b && b->write) {
+            rc = FlushFileBuffer(f->fd, b.get());
+        }
+
+        if (close(f->fd)) {
+            rc = -1;
+        }
+
+        if (b) {
+            const auto stats = GetFileStats(b.get(), false);
+            log_write("[FTP] closed: %s size: %.2f MiB speed: %.2f MiB/s\n", stats.path.c_str(), stats.bytes / 1024.0 / 1024.0, stats.bytes / 1024.0 / 1024.0 / std::max(stats.elapsed_ns / 1e+9, 1e-3));
+
+            SCOPED_MUTEX(&g_file_mutex);
+            g_finished_stats.emplace_front(stats);
+            if (g_finished_stats.size() > MAX_FINISHED_STATS) {
+                g_finished_stats.pop_back();
+            }
+        }
+
         f->fd = -1;
         f->valid = 0;
     }
@@ -370,10 +566,12 @@ int vfs_stdio_opendir(void* user, const char* _path) {
     auto f = static_cast<FtpVfsDir*>(user);
     const auto path = vfs_stdio_fix_path(_path);
 
-    f->fd = opendir(path);
-    if (!f->fd) {
+    auto listing = std::make_unique<DirListing>();
+    if (ReadDirListing(path, listing->entries)) {
         return -1;
     }
+
+    f->listing = listing.release();
     return 0;
 }
 
@@ -381,24 +579,23 @@ const char* vfs_stdio_readdir(void* user, void* user_entry) {
     auto f = static_cast<FtpVfsDir*>(user);
     auto entry = static_cast<FtpVfsDirEntry*>(user_entry);
 
-    entry->buf = readdir(f->fd);
-    if (!entry->buf) {
+    if (f->listing->index >= f->listing->entries.size()) {
+        entry->entry = nullptr;
         return NULL;
     }
-    return entry->buf->d_name;
+
+    entry->entry = &f->listing->entries[f->listing->index++];
+    return entry->entry->name.c_str();
 }
 
 int vfs_stdio_dirlstat(void* user, const void* user_entry, const char* _path, struct stat* st) {
-    // could probably be optimised to th below, but we won't know its r/w perms.
-    #if 0
-    auto entry = static_cast<FtpVfsDirEntry*>(user_entry);
-    if (entry->buf->d_type == DT_DIR) {
-        st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-        st->st_nlink = 1;
+    // the stat from the listing is used unless the backend didn't return a
+    // type, same as the devoptab metadata cache.
+    auto entry = static_cast<const FtpVfsDirEntry*>(user_entry);
+    if (entry->entry && entry->entry->st.st_mode) {
+        *st = entry->entry->st;
         return 0;
     }
-    #else
-    #endif
 
     const auto path = vfs_stdio_fix_path(_path);
     return lstat(path, st);
@@ -406,17 +603,16 @@ int vfs_stdio_dirlstat(void* user, const void* user_entry, const char* _path, st
 
 int vfs_stdio_isdir_open(void* user) {
     auto f = static_cast<FtpVfsDir*>(user);
-    return f->fd != NULL;
+    return f->listing != nullptr;
 }
 
 int vfs_stdio_closedir(void* user) {
     auto f = static_cast<FtpVfsDir*>(user);
-    int rc = 0;
     if (vfs_stdio_isdir_open(f)) {
-        rc = closedir(f->fd);
-        f->fd = NULL;
+        delete f->listing;
+        f->listing = nullptr;
     }
-    return rc;
+    return 0;
 }
 
 int vfs_stdio_stat(const char* _path, struct stat* st) {
@@ -642,6 +838,18 @@ void DisableInstallMode() {
     g_shared_data.enabled = false;
 }
 
+auto GetSessionStats() -> std::vector<SessionStats> {
+    SCOPED_MUTEX(&g_file_mutex);
+
+    std::vector<SessionStats> out;
+    for (const auto& [fd, b] : g_file_buffers) {
+        out.emplace_back(GetFileStats(b.get(), true));
+    }
+
+    out.insert(out.end(), g_finished_stats.begin(), g_finished_stats.end());
+    return out;
+}
+
 unsigned GetPort() {
     SCOPED_MUTEX(&g_mutex);
     return g_ftpsrv_config.port;
@@ -1,8 +1,11 @@
 #include "hasher.hpp"
 #include "app.hpp"
 #include "threaded_file_transfer.hpp"
-#include <mbedtls/md5.h>
+#include "defines.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/md5.hpp"
 #include <utility>
+#include <vector>
 
 namespace sphaira::hash {
 namespace {
@@ -57,12 +60,6 @@ private:
     const std::span<const u8> m_data;
 };
 
-struct HashSource {
-    virtual ~HashSource() = default;
-    virtual void Update(const void* buf, s64 size, s64 file_size) = 0;
-    virtual void Get(std::string& out) = 0;
-};
-
 struct HashNull final : HashSource {
     void Update(const void* buf, s64 size, s64 file_size) override {
         m_in_size += size;
@@ -94,22 +91,13 @@ private:
 };
 
 struct HashMd5 final : HashSource {
-    HashMd5() {
-        mbedtls_md5_init(&m_ctx);
-        mbedtls_md5_starts_ret(&m_ctx);
-    }
-
-    ~HashMd5() {
-        mbedtls_md5_free(&m_ctx);
-    }
-
     void Update(const void* buf, s64 size, s64 file_size) override {
-        mbedtls_md5_update_ret(&m_ctx, (const u8*)buf, size);
+        m_ctx.Update(buf, size);
     }
 
     void Get(std::string& out) override {
-        u8 hash[16];
-        mbedtls_md5_finish_ret(&m_ctx, hash);
+        u8 hash[utils::Md5::HASH_SIZE];
+        m_ctx.GetHash(hash);
 
         char str[CalculateHashStrLen(sizeof(hash))];
         for (u32 i = 0; i < sizeof(hash); i++) {
@@ -120,7 +108,7 @@ struct HashMd5 final : HashSource {
     }
 
 private:
-    mbedtls_md5_context m_ctx{};
+    utils::Md5 m_ctx{};
 };
 
 struct HashSha1 final : HashSource {
@@ -193,6 +181,17 @@ Result Hash(ui::ProgressBox* pbox, std::unique_ptr<HashSource> hash, BaseSource*
 
 } // namespace
 
+auto Create(Type type) -> std::unique_ptr<HashSource> {
+    switch (type) {
+        case Type::Crc32: return std::make_unique<HashCrc32>();
+        case Type::Md5: return std::make_unique<HashMd5>();
+        case Type::Sha1: return std::make_unique<HashSha1>();
+        case Type::Sha256: return std::make_unique<HashSha256>();
+        case Type::Null: return std::make_unique<HashNull>();
+    }
+    std::unreachable();
+}
+
 auto GetTypeStr(Type type) -> const char* {
     switch (type) {
         case Type::Crc32: return "CRC32";
@@ -204,15 +203,83 @@ auto GetTypeStr(Type type) -> const char* {
     return "";
 }
 
+// each hash (other than the first, which is updated by the calling thread)
+// is updated by a task so that they can run on different cores.
+struct MultiHash {
+    MultiHash(std::span<const Type> types, s64 _file_size) : file_size{_file_size} {
+        for (const auto type : types) {
+            hashes.emplace_back(Create(type));
+        }
+    }
+
+    void Update(const void* data, s64 size) {
+        if (hashes.empty()) {
+            return;
+        }
+
+        utils::task::Group group;
+        for (u32 i = 1; i < hashes.size(); i++) {
+            group.Push([this, i, data, size]() {
+                hashes[i]->Update(data, size, file_size);
+            }, utils::task::Priority::High);
+        }
+
+        hashes[0]->Update(data, size, file_size);
+        group.Wait();
+    }
+
+    std::vector<std::unique_ptr<HashSource>> hashes{};
+    const s64 file_size;
+};
+
+MultiHasher::MultiHasher(std::span<const Type> types, s64 file_size)
+: m_impl{std::make_unique<MultiHash>(types, file_size)} {
+}
+
+MultiHasher::~MultiHasher() = default;
+
+void MultiHasher::Update(const void* buf, s64 size) {
+    m_impl->Update(buf, size);
+}
+
+void MultiHasher::Get(std::vector<std::string>& out) {
+    out.clear();
+    for (auto& hash : m_impl->hashes) {
+        hash->Get(out.emplace_back());
+    }
+}
+
 Result Hash(ui::ProgressBox* pbox, Type type, BaseSource* source, std::string& out) {
-    switch (type) {
-        case Type::Crc32: return Hash(pbox, std::make_unique<HashCrc32>(), source, out);
-        case Type::Md5: return Hash(pbox, std::make_unique<HashMd5>(), source, out);
-        case Type::Sha1: return Hash(pbox, std::make_unique<HashSha1>(), source, out);
-        case Type::Sha256: return Hash(pbox, std::make_unique<HashSha256>(), source, out);
-        case Type::Null: return Hash(pbox, std::make_unique<HashNull>(), source, out);
+    return Hash(pbox, Create(type), source, out);
+}
+
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, BaseSource* source, std::vector<std::string>& out) {
+    out.clear();
+    if (types.empty()) {
+        R_SUCCEED();
     }
-    std::unreachable();
+
+    if (types.size() == 1) {
+        return Hash(pbox, types[0], source, out.emplace_back());
+    }
+
+    s64 file_size;
+    R_TRY(source->Size(&file_size));
+
+    MultiHasher multi{types, file_size};
+
+    R_TRY(thread::Transfer(pbox, file_size,
+        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            return source->Read(data, off, size, bytes_read);
+        },
+        [&](const void* data, s64 off, s64 size) -> Result {
+            multi.Update(data, size);
+            R_SUCCEED();
+        }
+    ));
+
+    multi.Get(out);
+    R_SUCCEED();
 }
 
 Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path, std::string& out) {
@@ -220,6 +287,11 @@ Result Hash(ui::ProgressBox* pbox, Type type, fs::Fs* fs, const fs::FsPath& path
     return Hash(pbox, type, source.get(), out);
 }
 
+Result Hash(ui::ProgressBox* pbox, std::span<const Type> types, fs::Fs* fs, const fs::FsPath& path, std::vector<std::string>& out) {
+    auto source = std::make_unique<FileSource>(fs, path);
+    return Hash(pbox, types, source.get(), out);
+}
+
 Result Hash(ui::ProgressBox* pbox, Type type, std::span<const u8> data, std::string& out) {
     auto source = std::make_unique<MemSource>(data);
     return Hash(pbox, type, source.get(), out);
@@ -7,6 +7,8 @@
 #include "i18n.hpp"
 
 #include <algorithm>
+#include <unordered_map>
+#include <memory>
 #include <haze.h>
 
 namespace sphaira::libhaze {
@@ -33,6 +35,15 @@ Mutex g_mutex{};
 
 InstallSharedData g_shared_data{};
 
+// pc clients list the same folder again on every refresh and then get the
+// attributes of every entry, so listings and attributes are kept until
+// something is written, either through mtp or by sphaira (see
+// fs::GetChangeGeneration()). writes that don't go through fs, ie, installs,
+// are picked up once the cache expires.
+constexpr u64 CACHE_EXPIRE_NS = 1e+10; // 10s
+// cleared when full, a listing of a big folder is one entry.
+constexpr u64 CACHE_MAX_ENTRIES = 1024 * 64;
+
 const char* SUPPORTED_EXT[] = {
     ".nsp", ".xci", ".nsz", ".xcz",
 };
@@ -90,8 +101,15 @@ protected:
 
 struct FsProxy final : FsProxyBase {
     using File = fs::File;
-    using Dir = fs::Dir;
     using DirEntry = FsDirectoryEntry;
+    using DirEntries = std::shared_ptr<const std::vector<DirEntry>>;
+
+    // the entries are shared with the cache, so the listing stays valid
+    // even if the cache is cleared whilst the dir is open.
+    struct Dir {
+        DirEntries entries;
+        s64 pos;
+    };
 
     FsProxy(std::unique_ptr<fs::Fs>&& fs, const char* name, const char* display_name)
     : FsProxyBase{name, display_name}
@@ -135,6 +153,11 @@ struct FsProxy final : FsProxyBase {
     }
 
     Result GetEntryType(const char *path, haze::FileAttrType *out_entry_type) override {
+        if (auto attr = FindAttr(path)) {
+            *out_entry_type = attr->type;
+            R_SUCCEED();
+        }
+
         FsDirEntryType type;
         R_TRY(m_fs->GetEntryType(FixPath(path), &type));
         *out_entry_type = (type == FsDirEntryType_Dir) ? haze::FileAttrType_DIR : haze::FileAttrType_FILE;
@@ -142,6 +165,17 @@ struct FsProxy final : FsProxyBase {
     }
 
     Result GetEntryAttributes(const char *path, haze::FileAttr *out) override {
+        if (auto attr = FindAttr(path)) {
+            *out = *attr;
+            R_SUCCEED();
+        }
+
+        R_TRY(GetEntryAttributesInternal(path, out));
+        AddToCache(m_attr_cache, FixPath(path).toString(), *out);
+        R_SUCCEED();
+    }
+
+    Result GetEntryAttributesInternal(const char *path, haze::FileAttr *out) {
         FsDirEntryType type;
         R_TRY(m_fs->GetEntryType(FixPath(path), &type));
 
@@ -246,34 +280,48 @@ struct FsProxy final : FsProxyBase {
     }
 
     Result OpenDirectory(const char *path, haze::Dir *out_dir) override {
-        auto dir = new Dir();
-        const auto rc = m_fs->OpenDirectory(FixPath(path), FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles | FsDirOpenMode_NoFileSize, dir);
-        if (R_FAILED(rc)) {
-            log_write("[HAZE] OpenDirectory(%s) failed: 0x%X\n", path, rc);
-            delete dir;
-            return rc;
+        const auto fixed_path = FixPath(path);
+        ValidateCache();
+
+        DirEntries entries;
+        if (const auto it = m_dir_cache.find(fixed_path.s); it != m_dir_cache.end()) {
+            entries = it->second;
+        } else {
+            fs::Dir dir;
+            const auto rc = m_fs->OpenDirectory(fixed_path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles | FsDirOpenMode_NoFileSize, &dir);
+            if (R_FAILED(rc)) {
+                log_write("[HAZE] OpenDirectory(%s) failed: 0x%X\n", path, rc);
+                return rc;
+            }
+
+            std::vector<DirEntry> buf;
+            R_TRY(dir.ReadAll(buf));
+
+            entries = std::make_shared<const std::vector<DirEntry>>(std::move(buf));
+            AddToCache(m_dir_cache, fixed_path.toString(), entries);
         }
 
-        out_dir->impl = dir;
+        out_dir->impl = new Dir{entries, 0};
         R_SUCCEED();
     }
 
     Result ReadDirectory(haze::Dir *d, s64 *out_total_entries, size_t max_entries, haze::DirEntry *buf) override {
         auto dir = static_cast<Dir*>(d->impl);
+        const auto& entries = *dir->entries;
 
-        std::vector<FsDirectoryEntry> entries(max_entries);
-        R_TRY(dir->Read(out_total_entries, entries.size(), entries.data()));
-
+        *out_total_entries = std::min<s64>(max_entries, entries.size() - dir->pos);
         for (s64 i = 0; i < *out_total_entries; i++) {
-            std::strcpy(buf[i].name, entries[i].name);
+            std::strcpy(buf[i].name, entries[dir->pos + i].name);
         }
 
+        dir->pos += *out_total_entries;
         R_SUCCEED();
     }
 
     Result GetDirectoryEntryCount(haze::Dir *d, s64 *out_count) override {
         auto dir = static_cast<Dir*>(d->impl);
-        return dir->GetEntryCount(out_count);
+        *out_count = dir->entries->size();
+        R_SUCCEED();
     }
 
     void CloseDirectory(haze::Dir *d) override {
@@ -284,8 +332,48 @@ struct FsProxy final : FsProxyBase {
         }
     }
 
+private:
+    // clears the cache if anything was written, or if it has expired.
+    void ValidateCache() {
+        const auto generation = fs::GetChangeGeneration();
+        const auto now = armGetSystemTick();
+
+        if (m_cache_generation != generation || armTicksToNs(now - m_cache_tick) >= CACHE_EXPIRE_NS) {
+            m_dir_cache.clear();
+            m_attr_cache.clear();
+            m_cache_generation = generation;
+            m_cache_tick = now;
+        }
+    }
+
+    auto FindAttr(const char* path) -> const haze::FileAttr* {
+        ValidateCache();
+
+        const auto it = m_attr_cache.find(FixPath(path).s);
+        if (it == m_attr_cache.end()) {
+            return nullptr;
+        }
+
+        return &it->second;
+    }
+
+    template<typename T>
+    static void AddToCache(std::unordered_map<std::string, T>& cache, std::string&& key, const T& value) {
+        if (cache.size() >= CACHE_MAX_ENTRIES) {
+            cache.clear();
+        }
+
+        cache.insert_or_assign(std::move(key), value);
+    }
+
 private:
     std::unique_ptr<fs::Fs> m_fs{};
+
+    // only accessed from the haze thread.
+    std::unordered_map<std::string, DirEntries> m_dir_cache{};
+    std::unordered_map<std::string, haze::FileAttr> m_attr_cache{};
+    u64 m_cache_generation{};
+    u64 m_cache_tick{};
 };
 
 // fake fs that allows for files to create r/w on the root.
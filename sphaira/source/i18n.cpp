@@ -1,17 +1,49 @@
 #include "i18n.hpp"
 #include "fs.hpp"
 #include "log.hpp"
+#include "defines.hpp"
 #include <yyjson.h>
 #include <vector>
-#include <unordered_map>
+#include <memory>
+#include <atomic>
 
 namespace sphaira::i18n {
 namespace {
 
-std::vector<u8> g_i18n_data{};
-yyjson_doc* json{};
-yyjson_val* root{};
-std::unordered_map<std::string, std::string> g_tr_cache{};
+struct Table {
+    struct Entry {
+        u64 hash;
+        u32 key_offset;
+        u32 key_len;
+        u32 value_offset;
+        u32 value_len;
+    };
+
+    auto Find(u64 hash, std::string_view key) const -> const Entry* {
+        for (auto i = hash & mask;; i = (i + 1) & mask) {
+            const auto& e = entries[i];
+            if (!e.key_len) {
+                return nullptr;
+            }
+
+            if (e.hash == hash && key == std::string_view{strings.data() + e.key_offset, e.key_len}) {
+                return &e;
+            }
+        }
+    }
+
+    // open addressed, at most half full, empty entries have no key.
+    std::vector<Entry> entries{};
+    u64 mask{};
+    // keys and values, each null terminated.
+    std::vector<char> strings{};
+};
+
+// the current table, read without locking.
+std::atomic<const Table*> g_table{};
+// every table built, kept so that strings returned before a language
+// change are still valid, protected by g_mutex.
+std::vector<std::unique_ptr<Table>> g_tables{};
 Mutex g_mutex{};
 
 static WordOrder g_word_order = WordOrder::PhraseName;
@@ -25,39 +57,17 @@ static WordOrder DetectWordOrder(const std::string& lang) {
     return WordOrder::PhraseName;
 }
 
-static std::string get_internal(std::string_view str, std::string_view fallback) {
-    SCOPED_MUTEX(&g_mutex);
-
-    const std::string kkey{str.data(), str.length()};
-
-    if (auto it = g_tr_cache.find(kkey); it != g_tr_cache.end()) {
-        return it->second;
-    }
-
-    // add default entry
-    const auto it = g_tr_cache.emplace(kkey, std::string{fallback}).first;
-
-    if (!json || !root) {
-        log_write("no json or root\n");
-        return std::string{fallback};
-    }
-
-    yyjson_val* node = yyjson_obj_getn(root, str.data(), str.length());
-    if (!node && str != fallback) {
-        node = yyjson_obj_getn(root, fallback.data(), fallback.length());
-        if (node) {
-            log_write("\tfallback-key matched: [%s]\n", std::string(fallback).c_str());
-        }
-    }
-
-    if (!node) {
-        log_write("\tfailed to find key: [%s]\n", kkey.c_str());
-        return std::string{fallback};
-    }
+auto AddString(Table& table, std::string_view str) -> u32 {
+    const u32 offset = table.strings.size();
+    table.strings.insert(table.strings.end(), str.begin(), str.end());
+    table.strings.emplace_back('\0');
+    return offset;
+}
 
+// key > string, or key > array of strings (multi-line).
+auto GetValue(yyjson_val* node) -> std::string {
     std::string ret;
 
-    // key > string
     if (const char* val = yyjson_get_str(node)) {
         size_t len = yyjson_get_len(node);
         if (len) {
@@ -65,7 +75,6 @@ static std::string get_internal(std::string_view str, std::string_view fallback)
         }
     }
 
-    // key > array of strings (multi-line)
     if (ret.empty() && yyjson_is_arr(node)) {
         size_t idx, max;
         yyjson_val* elem;
@@ -80,14 +89,75 @@ static std::string get_internal(std::string_view str, std::string_view fallback)
         }
     }
 
-    if (ret.empty()) {
-        log_write("\tfailed to get value: [%s]\n", kkey.c_str());
-        ret = std::string{fallback};
+    return ret;
+}
+
+auto BuildTable(yyjson_val* root) -> std::unique_ptr<Table> {
+    auto table = std::make_unique<Table>();
+
+    u64 size = 16;
+    while (size < yyjson_obj_size(root) * 2) {
+        size *= 2;
     }
+    table->entries.resize(size);
+    table->mask = size - 1;
+
+    size_t idx, max;
+    yyjson_val *key, *val;
+    yyjson_obj_foreach(root, idx, max, key, val) {
+        const std::string_view k{yyjson_get_str(key), yyjson_get_len(key)};
+        const auto v = GetValue(val);
+        if (k.empty() || v.empty()) {
+            log_write("\tfailed to get value: [%.*s]\n", (int)k.length(), k.data());
+            continue;
+        }
 
-    // update entry in cache
-    g_tr_cache.insert_or_assign(it, kkey, ret);
-    return ret;
+        const auto hash = Hash(k);
+        if (table->Find(hash, k)) {
+            continue;
+        }
+
+        auto i = hash & table->mask;
+        while (table->entries[i].key_len) {
+            i = (i + 1) & table->mask;
+        }
+
+        auto& e = table->entries[i];
+        e.hash = hash;
+        e.key_offset = AddString(*table, k);
+        e.key_len = k.length();
+        e.value_offset = AddString(*table, v);
+        e.value_len = v.length();
+    }
+
+    return table;
+}
+
+auto FindValue(const Table* table, u64 hash, std::string_view key) -> const char* {
+    if (!table) {
+        return nullptr;
+    }
+
+    if (const auto e = table->Find(hash, key)) {
+        return table->strings.data() + e->value_offset;
+    }
+
+    return nullptr;
+}
+
+static std::string get_internal(std::string_view str, std::string_view fallback) {
+    const auto table = g_table.load(std::memory_order_acquire);
+
+    auto value = FindValue(table, Hash(str), str);
+    if (!value && str != fallback) {
+        value = FindValue(table, Hash(fallback), fallback);
+    }
+
+    if (!value) {
+        return std::string{fallback};
+    }
+
+    return value;
 }
 
 static std::string get_internal(std::string_view str) {
@@ -99,7 +169,6 @@ static std::string get_internal(std::string_view str) {
 bool init(long index) {
     SCOPED_MUTEX(&g_mutex);
 
-    g_tr_cache.clear();
     R_TRY_RESULT(romfsInit(), false);
     ON_SCOPE_EXIT( romfsExit() );
 
@@ -153,18 +222,23 @@ bool init(long index) {
     fs::FsPath path = sdmc_path;
 
     // try and load override translation first
-    Result rc = fs::FsNativeSd().read_entire_file(path, g_i18n_data);
+    std::vector<u8> data;
+    Result rc = fs::FsNativeSd().read_entire_file(path, data);
     if (R_FAILED(rc)) {
         path = romfs_path;
-        rc = fs::FsStdio().read_entire_file(path, g_i18n_data);
+        rc = fs::FsStdio().read_entire_file(path, data);
     }
 
     if (R_SUCCEEDED(rc)) {
-        json = yyjson_read((const char*)g_i18n_data.data(), g_i18n_data.size(), YYJSON_READ_ALLOW_TRAILING_COMMAS|YYJSON_READ_ALLOW_COMMENTS|YYJSON_READ_ALLOW_INVALID_UNICODE);
+        auto json = yyjson_read((const char*)data.data(), data.size(), YYJSON_READ_ALLOW_TRAILING_COMMAS|YYJSON_READ_ALLOW_COMMENTS|YYJSON_READ_ALLOW_INVALID_UNICODE);
         if (json) {
-            root = yyjson_doc_get_root(json);
-            if (root) {
-                log_write("opened json: %s\n", path.s);
+            ON_SCOPE_EXIT(yyjson_doc_free(json));
+            auto root = yyjson_doc_get_root(json);
+            if (root && yyjson_is_obj(root)) {
+                auto table = BuildTable(root);
+                log_write("opened json: %s entries: %zu\n", path.s, yyjson_obj_size(root));
+                g_table.store(table.get(), std::memory_order_release);
+                g_tables.emplace_back(std::move(table));
                 return true;
             } else {
                 log_write("failed to find root\n");
@@ -176,18 +250,27 @@ bool init(long index) {
         log_write("failed to read file\n");
     }
 
+    // fallback to the untranslated keys.
+    g_table = nullptr;
     return false;
 }
 
 void exit() {
     SCOPED_MUTEX(&g_mutex);
 
-    if (json) {
-        yyjson_doc_free(json);
-        json = nullptr;
-        root = nullptr;
+    g_table = nullptr;
+    g_tables.clear();
+}
+
+auto Find(u64 hash, std::string_view key) -> Str {
+    const auto table = g_table.load(std::memory_order_acquire);
+    if (table) {
+        if (const auto e = table->Find(hash, key)) {
+            return {table->strings.data() + e->value_offset, e->value_len};
+        }
     }
-    g_i18n_data.clear();
+
+    return {key.data(), key.length()};
 }
 
 std::string get(std::string_view str) {
@@ -222,12 +305,34 @@ std::string Reorder(std::string_view phrase, std::string_view name) {
     return out;
 }
 
-} // namespace sphaira::i18n
+auto Benchmark(u32 iterations, bool copy) -> u64 {
+    const auto table = g_table.load();
+    if (!table) {
+        return 0;
+    }
 
-namespace literals {
+    std::vector<std::string_view> keys;
+    for (const auto& e : table->entries) {
+        if (e.key_len) {
+            keys.emplace_back(table->strings.data() + e.key_offset, e.key_len);
+        }
+    }
 
-std::string operator""_i18n(const char* str, size_t len) {
-    return sphaira::i18n::get({str, len});
+    // the total is logged so that the lookups aren't optimised out.
+    size_t total{};
+    for (u32 i = 0; i < iterations; i++) {
+        for (const auto& key : keys) {
+            if (copy) {
+                const std::string title = Find(Hash(key), key);
+                total += title.size();
+            } else {
+                total += Find(Hash(key), key).size();
+            }
+        }
+    }
+
+    log_write("[I18N] %zu keys, iterations: %u copy: %u (%zu)\n", keys.size(), iterations, copy, total);
+    return keys.size() * iterations;
 }
 
-} // namespace literals
+} // namespace sphaira::i18n
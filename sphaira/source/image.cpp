@@ -21,17 +21,64 @@
 #pragma GCC diagnostic pop
 
 #include "app.hpp"
+#include "defines.hpp"
 #include "log.hpp"
 #ifdef USE_NVJPG
 #include <nvjpg.hpp>
 #endif
 #include <cstring>
+#include <memory>
+#include <algorithm>
 
 namespace sphaira {
 namespace {
 
 constexpr int BPP = 4;
 
+#ifdef USE_NVJPG
+// the decoder is shared, and images are decoded from the image decode threads.
+// only the render is locked, so that one thread can parse / copy out an image
+// whilst another image is on the decoder.
+Mutex g_nvjpg_mutex{};
+
+// allocating a surface maps new memory for the decoder, which is slow, so
+// surfaces are kept for the next image of the same size, ie, icons.
+constexpr u32 SURFACE_POOL_MAX = 4;
+Mutex g_surface_mutex{};
+std::vector<std::unique_ptr<nj::Surface>> g_surfaces{};
+
+auto AcquireSurface(const nj::Image& image) -> std::unique_ptr<nj::Surface> {
+    {
+        SCOPED_MUTEX(&g_surface_mutex);
+        const auto it = std::ranges::find_if(g_surfaces, [&image](const auto& e) {
+            return e->width == image.width && e->height == image.height;
+        });
+
+        if (it != g_surfaces.end()) {
+            auto surf = std::move(*it);
+            g_surfaces.erase(it);
+            return surf;
+        }
+    }
+
+    auto surf = std::make_unique<nj::Surface>(image.width, image.height);
+    if (surf->allocate()) {
+        return {};
+    }
+
+    return surf;
+}
+
+void ReleaseSurface(std::unique_ptr<nj::Surface>&& surf) {
+    SCOPED_MUTEX(&g_surface_mutex);
+
+    if (g_surfaces.size() >= SURFACE_POOL_MAX) {
+        g_surfaces.erase(g_surfaces.begin());
+    }
+    g_surfaces.emplace_back(std::move(surf));
+}
+#endif
+
 auto ImageLoadInternal(stbi_uc* image_data, int x, int y) -> ImageResult {
     if (image_data) {
         ImageResult result{};
@@ -54,20 +101,27 @@ auto ImageLoadInternal(nj::Image&& image) -> ImageResult {
         return {};
     }
 
-    nj::Surface surf{image.width, image.height};
-    if (surf.allocate()) {
+    auto surf_ptr = AcquireSurface(image);
+    if (!surf_ptr) {
         log_write("[NVJPG] failed to allocate surf\n");
         return {};
     }
 
-    if (R_FAILED(App::GetApp()->m_decoder.render(image, surf, 255))) {
-        log_write("[NVJPG] failed to render\n");
-        return {};
-    }
+    auto& surf = *surf_ptr;
+    ON_SCOPE_EXIT(ReleaseSurface(std::move(surf_ptr)));
 
-    if (R_FAILED(App::GetApp()->m_decoder.wait(surf))) {
-        log_write("[NVJPG] failed to wait\n");
-        return {};
+    {
+        SCOPED_MUTEX(&g_nvjpg_mutex);
+
+        if (R_FAILED(App::GetApp()->m_decoder.render(image, surf, 255))) {
+            log_write("[NVJPG] failed to render\n");
+            return {};
+        }
+
+        if (R_FAILED(App::GetApp()->m_decoder.wait(surf))) {
+            log_write("[NVJPG] failed to wait\n");
+            return {};
+        }
     }
 
     ImageResult result{};
@@ -95,12 +149,7 @@ auto ImageLoadInternal(nj::Image&& image) -> ImageResult {
 auto ImageLoadFromMemory(std::span<const u8> data, u32 flags) -> ImageResult {
 #ifdef USE_NVJPG
     if (flags & ImageFlag_JPEG) {
-        auto shared_vec = std::make_shared<std::vector<u8>>(data.size());
-        std::memcpy(shared_vec->data(), data.data(), shared_vec->size());
-        // don't make const as it prevents RTO.
-        auto result = ImageLoadInternal(nj::Image{shared_vec});
-        // if it failed, try again but without using oss-jpg.
-        return result.data.empty() ? ImageLoadFromMemory(data, 0) : result;
+        return ImageLoadFromMemory(std::vector<u8>{data.begin(), data.end()}, flags);
     }
     else
 #endif
@@ -110,6 +159,20 @@ auto ImageLoadFromMemory(std::span<const u8> data, u32 flags) -> ImageResult {
     }
 }
 
+auto ImageLoadFromMemory(std::vector<u8>&& data, u32 flags) -> ImageResult {
+#ifdef USE_NVJPG
+    if (flags & ImageFlag_JPEG) {
+        const auto shared_vec = std::make_shared<std::vector<u8>>(std::move(data));
+        // don't make const as it prevents RTO.
+        auto result = ImageLoadInternal(nj::Image{shared_vec});
+        // if it failed, try again but without using oss-jpg.
+        return result.data.empty() ? ImageLoadFromMemory(std::span<const u8>{*shared_vec}, 0) : result;
+    }
+#endif
+
+    return ImageLoadFromMemory(std::span<const u8>{data}, flags);
+}
+
 auto ImageLoadFromFile(const fs::FsPath& file, u32 flags) -> ImageResult {
 #ifdef USE_NVJPG
     if (flags & ImageFlag_JPEG) {
@@ -126,6 +189,13 @@ auto ImageLoadFromFile(const fs::FsPath& file, u32 flags) -> ImageResult {
     }
 }
 
+void ImageExit() {
+#ifdef USE_NVJPG
+    SCOPED_MUTEX(&g_surface_mutex);
+    g_surfaces.clear();
+#endif
+}
+
 auto ImageResize(std::span<const u8> data, int inx, int iny, int outx, int outy) -> ImageResult {
     log_write("doing resize inx: %d iny: %d outx: %d outy: %d\n", inx, iny, outx, outy);
     std::vector<u8> resized_data(outx*outy*BPP);
@@ -0,0 +1,427 @@
+#include "image_decode.hpp"
+#include "app.hpp"
+#include "defines.hpp"
+#include "fs.hpp"
+#include "log.hpp"
+#include "utils/thread.hpp"
+#include "utils/mem_track.hpp"
+#include "ui/nvg_util.hpp"
+
+#include <deque>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace sphaira::image {
+namespace {
+
+constexpr u32 WORKER_COUNT = 2;
+// requests not updated within this time have scrolled away.
+constexpr u64 REQUEST_STALE_NS = 5e+8; // 500ms
+// time spent uploading images each frame, at least 1 is always uploaded.
+constexpr u64 UPLOAD_BUDGET_NS = 2e+6; // 2ms
+
+constexpr fs::FsPath THUMB_PATH{"/switch/sphaira/cache/thumbs"};
+constexpr u32 THUMB_MAGIC = 0x424D4854; // THMB
+constexpr u32 THUMB_VERSION = 1;
+
+struct ThumbHeader {
+    u32 magic;
+    u32 version;
+    // size of the source image.
+    s32 src_w;
+    s32 src_h;
+    // size of the rgba data that follows.
+    s32 w;
+    s32 h;
+};
+
+struct Job {
+    RequestHandle request{};
+    Loader loader{};
+    u32 flags{};
+    Thumb thumb{};
+    ImageResult result{};
+    int src_w{};
+    int src_h{};
+};
+
+auto IsDropped(const Job& job) -> bool {
+    // nobody is waiting for the result if the queue holds the only reference.
+    return job.request->IsCancelled() || job.request.use_count() == 1;
+}
+
+auto fnv1a64(const void* data, u64 size, u64 hash = 0xCBF29CE484222325) -> u64 {
+    auto p = static_cast<const u8*>(data);
+    for (u64 i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+auto BuildThumbPath(u64 id, int size) -> fs::FsPath {
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/%016lX_%d.rgba", THUMB_PATH.s, id, size);
+    return path;
+}
+
+auto LoadThumb(const fs::FsPath& path, Job& job) -> bool {
+    std::vector<u8> data;
+    if (R_FAILED(fs::FsNativeSd().read_entire_file(path, data))) {
+        return false;
+    }
+
+    ThumbHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    if (header.magic != THUMB_MAGIC || header.version != THUMB_VERSION || header.w <= 0 || header.h <= 0) {
+        return false;
+    }
+
+    if (data.size() != sizeof(header) + (u64)header.w * header.h * 4) {
+        return false;
+    }
+
+    data.erase(data.begin(), data.begin() + sizeof(header));
+    job.result = {std::move(data), header.w, header.h};
+    job.src_w = header.src_w;
+    job.src_h = header.src_h;
+    return true;
+}
+
+void SaveThumb(const fs::FsPath& path, const Job& job) {
+    ThumbHeader header{};
+    header.magic = THUMB_MAGIC;
+    header.version = THUMB_VERSION;
+    header.src_w = job.src_w;
+    header.src_h = job.src_h;
+    header.w = job.result.w;
+    header.h = job.result.h;
+
+    std::vector<u8> data(sizeof(header) + job.result.data.size());
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), job.result.data.data(), job.result.data.size());
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursively(THUMB_PATH);
+    if (R_FAILED(fs.write_entire_file(path, data))) {
+        log_write("[IMAGE] failed to save thumb: %s\n", path.s);
+        fs.DeleteFile(path);
+    }
+}
+
+void Decode(Job& job) {
+    const auto& thumb = job.thumb;
+
+    fs::FsPath thumb_path;
+    if (thumb.size && thumb.id) {
+        thumb_path = BuildThumbPath(thumb.id, thumb.size);
+        if (LoadThumb(thumb_path, job)) {
+            return;
+        }
+    }
+
+    auto data = job.loader();
+    if (data.empty() || IsDropped(job)) {
+        return;
+    }
+
+    if (thumb.size && !thumb.id) {
+        thumb_path = BuildThumbPath(fnv1a64(data.data(), data.size()), thumb.size);
+        if (LoadThumb(thumb_path, job)) {
+            return;
+        }
+    }
+
+    job.result = ImageLoadFromMemory(std::move(data), job.flags);
+    job.src_w = job.result.w;
+    job.src_h = job.result.h;
+    if (job.result.data.empty() || !thumb.size) {
+        return;
+    }
+
+    // downscale to the size it's drawn at, keeping the aspect ratio.
+    const auto max = std::max(job.result.w, job.result.h);
+    if (max > thumb.size) {
+        const auto w = std::max(1, job.result.w * thumb.size / max);
+        const auto h = std::max(1, job.result.h * thumb.size / max);
+        auto resized = ImageResize(job.result.data, job.result.w, job.result.h, w, h);
+        if (!resized.data.empty()) {
+            job.result = std::move(resized);
+        }
+    }
+
+    SaveThumb(thumb_path, job);
+}
+
+struct DecodeQueue {
+    auto Create() -> Result {
+        mutexInit(&m_mutex);
+        condvarInit(&m_can_pop);
+        m_quit = false;
+
+        for (u32 i = 0; i < WORKER_COUNT; i++) {
+            R_TRY(utils::CreateThread(&m_threads[i], ThreadFunc, this, 1024*128));
+            if (R_FAILED(threadStart(&m_threads[i]))) {
+                threadClose(&m_threads[i]);
+                break;
+            }
+            m_thread_count++;
+        }
+
+        R_SUCCEED();
+    }
+
+    void SignalClose() {
+        SCOPED_MUTEX(&m_mutex);
+        m_quit = true;
+        condvarWakeAll(&m_can_pop);
+    }
+
+    void Close() {
+        SignalClose();
+        for (u32 i = 0; i < m_thread_count; i++) {
+            threadWaitForExit(&m_threads[i]);
+            threadClose(&m_threads[i]);
+        }
+        m_thread_count = 0;
+
+        // release the requests here, as uploaded images have to be freed
+        // on the main thread.
+        m_entries.clear();
+        m_decoded.clear();
+    }
+
+    void Add(Job&& job) {
+        SCOPED_MUTEX(&m_mutex);
+        m_entries.emplace_back(std::forward<Job>(job));
+        condvarWakeOne(&m_can_pop);
+    }
+
+    // pops the queued request with the lowest key, stale requests are dropped.
+    // blocks until a request is queued, returns false on exit.
+    auto Pop(Job& out) -> bool {
+        SCOPED_MUTEX(&m_mutex);
+
+        for (;;) {
+            if (m_quit) {
+                return false;
+            }
+
+            const auto now = armGetSystemTick();
+            std::erase_if(m_entries, [now](auto& e) {
+                if (IsDropped(e)) {
+                    return true;
+                }
+
+                // the request is marked as cancelled so that it's pushed
+                // again once it's visible.
+                if (armTicksToNs(now - e.request->GetTick()) >= REQUEST_STALE_NS) {
+                    e.request->Cancel();
+                    return true;
+                }
+
+                return false;
+            });
+
+            if (!m_entries.empty()) {
+                break;
+            }
+
+            condvarWait(&m_can_pop, &m_mutex);
+        }
+
+        auto best = std::ranges::min_element(m_entries, {}, [](auto& e) {
+            return e.request->GetKey();
+        });
+
+        out = std::move(*best);
+        m_entries.erase(best);
+        return true;
+    }
+
+    void AddDecoded(Job&& job) {
+        SCOPED_MUTEX(&m_mutex);
+        m_decoded.emplace_back(std::forward<Job>(job));
+        App::Invalidate();
+    }
+
+    auto PopDecoded(Job& out) -> bool {
+        SCOPED_MUTEX(&m_mutex);
+
+        if (m_decoded.empty()) {
+            return false;
+        }
+
+        out = std::move(m_decoded.front());
+        m_decoded.pop_front();
+        return true;
+    }
+
+    auto GetStats() -> Stats {
+        SCOPED_MUTEX(&m_mutex);
+        return Stats{(u32)m_entries.size(), (u32)m_decoded.size()};
+    }
+
+    static void ThreadFunc(void* p);
+
+    std::deque<Job> m_entries{};
+    // decoded and waiting to be uploaded by the main thread.
+    std::deque<Job> m_decoded{};
+    Thread m_threads[WORKER_COUNT]{};
+    u32 m_thread_count{};
+    Mutex m_mutex{};
+    CondVar m_can_pop{};
+    bool m_quit{};
+};
+
+DecodeQueue g_queue;
+bool g_init{};
+
+void DecodeQueue::ThreadFunc(void* p) {
+    auto queue = static_cast<DecodeQueue*>(p);
+    SCOPED_MEM_TAG(utils::mem::Tag_Image);
+
+    Job job;
+    while (queue->Pop(job)) {
+        if (!IsDropped(job)) {
+            Decode(job);
+        }
+
+        // decode failures are still handed back so that the request is done.
+        if (!IsDropped(job)) {
+            queue->AddDecoded(std::move(job));
+        }
+
+        job = {};
+    }
+
+    log_write("exited image decode thread\n");
+}
+
+} // namespace
+
+auto MakeThumbId(std::string_view name, u64 version) -> u64 {
+    return fnv1a64(&version, sizeof(version), fnv1a64(name.data(), name.size()));
+}
+
+Request::~Request() {
+    if (m_image) {
+        ui::gfx::deleteImage(App::GetVg(), m_image);
+    }
+}
+
+void Request::SetImage(int image, int w, int h, const u8* first_pixel) {
+    m_image = image;
+    m_w = w;
+    m_h = h;
+    if (first_pixel) {
+        std::memcpy(m_first_pixel, first_pixel, sizeof(m_first_pixel));
+    }
+    m_done = true;
+}
+
+Result Init() {
+    if (g_init) {
+        R_SUCCEED();
+    }
+
+    R_TRY(g_queue.Create());
+    g_init = true;
+    R_SUCCEED();
+}
+
+void ExitSignal() {
+    if (g_init) {
+        g_queue.SignalClose();
+    }
+}
+
+void Exit() {
+    if (g_init) {
+        g_queue.Close();
+        g_init = false;
+    }
+}
+
+auto Push(Loader&& loader, u32 flags, s64 key, const Thumb& thumb) -> RequestHandle {
+    auto request = std::make_shared<Request>();
+    request->SetKey(key);
+
+    if (!g_init) {
+        // nothing to decode it, so fail the request straight away.
+        request->SetImage(0, 0, 0, nullptr);
+        return request;
+    }
+
+    g_queue.Add(Job{request, std::forward<Loader>(loader), flags, thumb});
+    return request;
+}
+
+void Upload(NVGcontext* vg) {
+    if (!g_init) {
+        return;
+    }
+
+    const auto start = armGetSystemTick();
+
+    Job job;
+    while (g_queue.PopDecoded(job)) {
+        if (!IsDropped(job)) {
+            const auto& result = job.result;
+            int image{};
+            if (!result.data.empty()) {
+                // thumbnails are packed into the icon atlas.
+                image = ui::gfx::createAtlasImage(vg, job.thumb.size, result.w, result.h, result.data.data());
+            }
+
+            job.request->SetImage(image, job.src_w, job.src_h, result.data.empty() ? nullptr : result.data.data());
+        }
+
+        job = {};
+        if (armTicksToNs(armGetSystemTick() - start) >= UPLOAD_BUDGET_NS) {
+            break;
+        }
+    }
+}
+
+auto GetStats() -> Stats {
+    if (!g_init) {
+        return {};
+    }
+
+    return g_queue.GetStats();
+}
+
+void LoadAsync(RequestHandle& request, int& image, s64 key, u32 flags, const Thumb& thumb, const std::function<Loader()>& create) {
+    if (image) {
+        if (!ui::gfx::isImageEvicted(image)) {
+            return;
+        }
+
+        // evicted from the atlas, so load it again.
+        image = 0;
+        request.reset();
+    }
+
+    // dropped whilst it was scrolled away.
+    if (request && request->IsCancelled()) {
+        request.reset();
+    }
+
+    if (!request) {
+        if (auto loader = create()) {
+            request = Push(std::move(loader), flags, key, thumb);
+        }
+    } else if (!request->IsDone()) {
+        request->SetKey(key);
+    } else {
+        image = request->TakeImage();
+    }
+}
+
+} // namespace sphaira::image
@@ -0,0 +1,199 @@
+#include "jobs.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "i18n.hpp"
+#include "defines.hpp"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace sphaira::jobs {
+namespace {
+
+// max number of jobs running at once on each device.
+// the sd card and nand are slower with writes interleaved, network jobs are
+// mostly waiting on the other end so two are allowed.
+constexpr u32 DEVICE_LIMIT[Device_MAX]{
+    1, // Device_Sd
+    1, // Device_Nand
+    1, // Device_Usb
+    2, // Device_Network
+    2, // Device_Other
+};
+
+// how often a queued job checks if it was cancelled.
+constexpr u64 QUEUE_POLL_NS = 1e+8; // 100ms
+
+// weight given to the latest sample when smoothing the speed.
+constexpr double SPEED_EMA_ALPHA = 0.3;
+
+struct Shared {
+    std::atomic_bool queued{true};
+};
+
+struct Entry {
+    u32 id{};
+    Device device{};
+    std::unique_ptr<ui::ProgressBox> pbox{};
+    std::shared_ptr<Shared> shared{};
+
+    // ui only.
+    std::string title{};
+    std::string transfer{};
+    u32 title_seq{};
+    u32 transfer_seq{};
+    s64 last_offset{};
+    s64 speed{};
+    ui::TimeStamp timestamp{};
+};
+
+// zero is the initial state of both, so they don't need an init.
+Mutex g_mutex{};
+CondVar g_can_run{};
+// number of jobs running on each device, protected by g_mutex.
+u32 g_running[Device_MAX]{};
+
+// ui thread only.
+std::vector<Entry> g_jobs{};
+u32 g_next_id{};
+
+Result AcquireDevice(Device device, ui::ProgressBox* pbox) {
+    SCOPED_MUTEX(&g_mutex);
+    while (g_running[device] >= DEVICE_LIMIT[device]) {
+        R_TRY(pbox->ShouldExitResult());
+        condvarWaitTimeout(&g_can_run, &g_mutex, QUEUE_POLL_NS);
+    }
+
+    g_running[device]++;
+    R_SUCCEED();
+}
+
+void ReleaseDevice(Device device) {
+    SCOPED_MUTEX(&g_mutex);
+    g_running[device]--;
+    condvarWakeAll(&g_can_run);
+}
+
+auto Find(u32 id) -> Entry* {
+    const auto it = std::ranges::find_if(g_jobs, [id](const auto& e) {
+        return e.id == id;
+    });
+
+    if (it == g_jobs.end()) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+} // namespace
+
+void ExitSignal() {
+    for (auto& e : g_jobs) {
+        e.pbox->RequestExit();
+    }
+}
+
+void Exit() {
+    ExitSignal();
+    // destroying the box joins its thread.
+    g_jobs.clear();
+}
+
+void Push(Device device, const std::string& action, const std::string& title, const ui::ProgressBoxCallback& callback, const ui::ProgressBoxDoneCallback& done) {
+    auto shared = std::make_shared<Shared>();
+
+    const auto job_callback = [device, shared, callback](ui::ProgressBox* pbox) -> Result {
+        R_TRY(AcquireDevice(device, pbox));
+        ON_SCOPE_EXIT(ReleaseDevice(device));
+
+        shared->queued = false;
+        return callback(pbox);
+    };
+
+    const auto job_done = [title, done](Result rc) {
+        if (R_SUCCEEDED(rc)) {
+            App::Notify(i18n::Reorder("Finished ", title));
+        } else if (rc != Result_TransferCancelled) {
+            log_write("[JOBS] %s failed: 0x%X\n", title.c_str(), rc);
+            App::Notify(i18n::Reorder("Failed ", title));
+        }
+
+        if (done) {
+            done(rc);
+        }
+    };
+
+    Entry entry{};
+    entry.id = g_next_id++;
+    entry.device = device;
+    entry.shared = shared;
+    entry.title = title;
+    entry.pbox = std::make_unique<ui::ProgressBox>(0, action, title, job_callback, job_done);
+
+    log_write("[JOBS] queued %s on device: %u\n", title.c_str(), device);
+    App::Notify(i18n::Reorder("Queued ", title));
+    g_jobs.emplace_back(std::move(entry));
+}
+
+void Update() {
+    for (auto it = g_jobs.begin(); it != g_jobs.end();) {
+        if (it->pbox->ShouldExit()) {
+            // calls the done callback.
+            it = g_jobs.erase(it);
+            continue;
+        }
+
+        auto& e = *it++;
+        e.pbox->GetTitle(e.title_seq, e.title);
+        e.pbox->GetTransferName(e.transfer_seq, e.transfer);
+
+        if (e.timestamp.GetSeconds()) {
+            e.timestamp.Update();
+
+            s64 offset, size;
+            e.pbox->GetTransfer(offset, size);
+
+            // the offset goes back to 0 on each new file.
+            const auto sample = offset >= e.last_offset ? offset - e.last_offset : offset;
+            e.speed = e.speed ? e.speed + (sample - e.speed) * SPEED_EMA_ALPHA : sample;
+            e.last_offset = offset;
+        }
+    }
+}
+
+auto GetCount() -> u32 {
+    return g_jobs.size();
+}
+
+auto GetInfo() -> std::vector<Info> {
+    std::vector<Info> out;
+    out.reserve(g_jobs.size());
+
+    for (const auto& e : g_jobs) {
+        auto& info = out.emplace_back();
+        info.id = e.id;
+        info.title = e.title;
+        info.transfer = e.transfer;
+        e.pbox->GetTransfer(info.offset, info.size);
+        info.speed = e.pbox->IsPaused() ? 0 : e.speed;
+        info.queued = e.shared->queued;
+        info.paused = e.pbox->IsPaused();
+    }
+
+    return out;
+}
+
+void SetPaused(u32 id, bool paused) {
+    if (auto e = Find(id)) {
+        e->pbox->SetPaused(paused);
+    }
+}
+
+void Cancel(u32 id) {
+    if (auto e = Find(id)) {
+        e->pbox->RequestExit();
+    }
+}
+
+} // namespace sphaira::jobs
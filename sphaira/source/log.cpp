@@ -1,9 +1,12 @@
 #include "log.hpp"
 #include "defines.hpp"
+#include "utils/thread.hpp"
 #include <cstdio>
 #include <cstdarg>
+#include <cstring>
 #include <ctime>
 #include <atomic>
+#include <algorithm>
 #include <unistd.h>
 #include <switch.h>
 
@@ -12,28 +15,183 @@ namespace {
 
 constexpr const char* logpath = "/config/sphaira/log.txt";
 
+// records are formatted by the caller and queued for the writer thread, so
+// that logging never blocks on the sd card or the nxlink socket.
+// once the queue is full, records are dropped and counted rather than blocking.
+constexpr u32 RECORD_MAX = 512;
+constexpr u32 QUEUE_MAX = 512; // must be a power of 2.
+// the writer wakes up this often to flush the queue.
+constexpr u64 FLUSH_INTERVAL_NS = 1e+7; // 10ms
+
 std::atomic_int32_t nxlink_socket{};
 std::atomic_bool g_file_open{};
+std::atomic<unsigned> g_category_mask{~0U};
+// protects init / exit, records are queued without it.
 Mutex g_mutex;
+// the queue has a single consumer, so the writer and exit take turns.
+Mutex g_flush_mutex;
 
-void log_write_arg_internal(const char* s, std::va_list* v) {
-    const auto t = std::time(nullptr);
-    const auto tm = std::localtime(&t);
+// bounded mpsc queue, each cell's sequence says whether it's free to write
+// (seq == pos) or ready to read (seq == pos + 1).
+struct Cell {
+    std::atomic<u32> seq;
+    u32 len;
+    char data[RECORD_MAX];
+};
 
-    char buf[512];
-    const auto len = std::snprintf(buf, sizeof(buf), "[%02u:%02u:%02u] -> ", tm->tm_hour, tm->tm_min, tm->tm_sec);
-    std::vsnprintf(buf + len, sizeof(buf) - len, s, *v);
+Cell g_cells[QUEUE_MAX];
+std::atomic<u32> g_enqueue_pos{};
+u32 g_dequeue_pos{};
+std::atomic<u32> g_dropped{};
 
-    SCOPED_MUTEX(&g_mutex);
+Thread g_thread{};
+std::atomic_bool g_thread_running{};
+std::atomic_bool g_thread_quit{};
+
+auto Push(const char* data, u32 len) -> bool {
+    auto pos = g_enqueue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+
+    for (;;) {
+        cell = &g_cells[pos & (QUEUE_MAX - 1)];
+        const auto seq = cell->seq.load(std::memory_order_acquire);
+        const auto diff = (s32)(seq - pos);
+
+        if (diff == 0) {
+            if (g_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // the writer hasn't caught up.
+            return false;
+        } else {
+            pos = g_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::memcpy(cell->data, data, len);
+    cell->len = len;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+auto Pop(char* out, u32& len) -> bool {
+    auto cell = &g_cells[g_dequeue_pos & (QUEUE_MAX - 1)];
+    const auto seq = cell->seq.load(std::memory_order_acquire);
+    if ((s32)(seq - (g_dequeue_pos + 1)) < 0) {
+        return false;
+    }
+
+    len = cell->len;
+    std::memcpy(out, cell->data, len);
+    cell->seq.store(g_dequeue_pos + QUEUE_MAX, std::memory_order_release);
+    g_dequeue_pos++;
+    return true;
+}
+
+void Output(const char* data, u32 len) {
     if (g_file_open) {
         auto file = std::fopen(logpath, "a");
         if (file) {
-            std::fprintf(file, "%s", buf);
+            std::fwrite(data, 1, len, file);
             std::fclose(file);
         }
     }
     if (nxlink_socket) {
-        std::printf("%s", buf);
+        std::fwrite(data, 1, len, stdout);
+    }
+}
+
+// writes everything queued in as few writes as possible.
+void Flush() {
+    SCOPED_MUTEX(&g_flush_mutex);
+    static char batch[RECORD_MAX * 16];
+    u32 batch_len = 0;
+
+    const auto dropped = g_dropped.exchange(0);
+    if (dropped) {
+        batch_len = std::snprintf(batch, sizeof(batch), "[log] dropped %u records\n", dropped);
+    }
+
+    char record[RECORD_MAX];
+    u32 len;
+    while (Pop(record, len)) {
+        if (batch_len + len > sizeof(batch)) {
+            Output(batch, batch_len);
+            batch_len = 0;
+        }
+
+        std::memcpy(batch + batch_len, record, len);
+        batch_len += len;
+    }
+
+    if (batch_len) {
+        Output(batch, batch_len);
+    }
+}
+
+void WriterThread(void*) {
+    while (!g_thread_quit) {
+        svcSleepThread(FLUSH_INTERVAL_NS);
+        Flush();
+    }
+
+    Flush();
+}
+
+void StartWriter() {
+    if (g_thread_running) {
+        return;
+    }
+
+    for (u32 i = 0; i < QUEUE_MAX; i++) {
+        g_cells[i].seq = i;
+    }
+    g_enqueue_pos = 0;
+    g_dequeue_pos = 0;
+    g_thread_quit = false;
+
+    // low priority, it only needs to keep up with the queue.
+    if (R_FAILED(sphaira::utils::CreateThread(&g_thread, WriterThread, nullptr, sphaira::utils::ThreadRole::Background, 1024*16))) {
+        return;
+    }
+
+    if (R_FAILED(threadStart(&g_thread))) {
+        threadClose(&g_thread);
+        return;
+    }
+
+    g_thread_running = true;
+}
+
+// flushes the queue before returning.
+void StopWriter() {
+    if (!g_thread_running || g_file_open || nxlink_socket) {
+        return;
+    }
+
+    g_thread_quit = true;
+    threadWaitForExit(&g_thread);
+    threadClose(&g_thread);
+    g_thread_running = false;
+}
+
+void log_write_arg_internal(const char* s, std::va_list* v) {
+    const auto t = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&t, &tm);
+
+    char buf[RECORD_MAX];
+    const auto len = std::snprintf(buf, sizeof(buf), "[%02u:%02u:%02u] -> ", tm.tm_hour, tm.tm_min, tm.tm_sec);
+    const auto msg_len = std::vsnprintf(buf + len, sizeof(buf) - len, s, *v);
+    const auto total = std::min<u32>(len + std::max(msg_len, 0), sizeof(buf) - 1);
+
+    if (!g_thread_running) {
+        // the writer failed to start, so write it here.
+        SCOPED_MUTEX(&g_mutex);
+        Output(buf, total);
+    } else if (!Push(buf, total)) {
+        g_dropped++;
     }
 }
 
@@ -51,6 +209,7 @@ auto log_file_init() -> bool {
     if (file) {
         g_file_open = true;
         std::fclose(file);
+        StartWriter();
         return true;
     }
 
@@ -64,21 +223,29 @@ auto log_nxlink_init() -> bool {
     }
 
     nxlink_socket = nxlinkConnectToHost(true, false);
+    if (nxlink_socket) {
+        StartWriter();
+    }
     return nxlink_socket != 0;
 }
 
 void log_file_exit() {
     SCOPED_MUTEX(&g_mutex);
     if (g_file_open) {
+        // write out anything queued before closing.
+        Flush();
         g_file_open = false;
+        StopWriter();
     }
 }
 
 void log_nxlink_exit() {
     SCOPED_MUTEX(&g_mutex);
     if (nxlink_socket) {
+        Flush();
         close(nxlink_socket);
         nxlink_socket = 0;
+        StopWriter();
     }
 }
 
@@ -105,6 +272,14 @@ void log_write_arg(const char* s, va_list* v) {
     log_write_arg_internal(s, v);
 }
 
+void log_set_category_mask(unsigned mask) {
+    g_category_mask = mask;
+}
+
+bool log_is_category_enabled(unsigned category) {
+    return g_category_mask & category;
+}
+
 } // extern "C"
 
 #endif
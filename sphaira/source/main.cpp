@@ -2,6 +2,7 @@
 #include <memory>
 #include "app.hpp"
 #include "log.hpp"
+#include "threaded_file_transfer.hpp"
 #include "ui/menus/main_menu.hpp"
 
 int main(int argc, char** argv) {
@@ -17,6 +18,12 @@ int main(int argc, char** argv) {
 
 extern "C" {
 
+// libnx spreads fs ipc across this many sessions (default 3, max 8), a request
+// blocks until a session is free. a native to native copy has up to
+// MAX_READER_COUNT readers and 1 writer in flight, plus 1 left for the ui
+// (config saves, icons, dir listing) so it doesn't stall behind the transfer.
+u32 __nx_fs_num_sessions = sphaira::thread::MAX_READER_COUNT + 2;
+
 void userAppInit(void) {
     sphaira::App::SetBoostMode(true);
 
@@ -3,6 +3,7 @@
 #include <minizip/zip.h>
 #include <cstring>
 #include <cstdio>
+#include <algorithm>
 
 #include "log.hpp"
 
@@ -13,6 +14,8 @@ namespace {
 #define LOCAL_HEADER_SIG 0x4034B50
 #define FILE_HEADER_SIG 0x2014B50
 #define END_RECORD_SIG 0x6054B50
+#define DATA_DESCRIPTOR_SIG 0x8074B50
+#define ZIP64_EXTRA_ID 0x0001
 
 // 30 bytes (0x1E)
 #pragma pack(push,1)
@@ -388,4 +391,318 @@ Result PeekFirstFileName(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& name) {
     R_SUCCEED();
 }
 
+Result FindCentralDirectory(std::span<const u8> tail, s64& off, s64& size, u32& count) {
+    mmz_EndRecord record;
+    R_UNLESS(tail.size() >= sizeof(record), Result_MmzBadEndRecord);
+
+    // check in reverse order as it's more likely at the end.
+    for (s64 i = tail.size() - sizeof(record); i >= 0; i--) {
+        u32 sig;
+        std::memcpy(&sig, tail.data() + i, sizeof(sig));
+        if (sig != END_RECORD_SIG) {
+            continue;
+        }
+
+        std::memcpy(&record, tail.data() + i, sizeof(record));
+        R_UNLESS(record.total_entries != UINT16_MAX, Result_MmzStreamUnsupported);
+        R_UNLESS(record.file_hdr_off != UINT32_MAX, Result_MmzStreamUnsupported);
+        R_UNLESS(record.central_directory_size != UINT32_MAX, Result_MmzStreamUnsupported);
+
+        off = record.file_hdr_off;
+        size = record.central_directory_size;
+        count = record.total_entries;
+        R_SUCCEED();
+    }
+
+    R_THROW(Result_MmzBadEndRecord);
+}
+
+Result ParseCentralDirectory(std::span<const u8> data, u32 count, CentralEntries& out) {
+    out.clear();
+    out.reserve(count);
+
+    u64 off = 0;
+    for (u32 i = 0; i < count; i++) {
+        mmz_FileHeader file_hdr;
+        R_UNLESS(off + sizeof(file_hdr) <= data.size(), Result_MmzBadFileHeader);
+        std::memcpy(&file_hdr, data.data() + off, sizeof(file_hdr));
+        R_UNLESS(file_hdr.sig == FILE_HEADER_SIG, Result_MmzBadFileHeader);
+
+        const auto total = sizeof(file_hdr) + file_hdr.filename_len + file_hdr.extrafield_len + file_hdr.filecomment_len;
+        R_UNLESS(off + total <= data.size(), Result_MmzBadFileHeader);
+
+        auto& entry = out.emplace_back();
+        entry.flags = file_hdr.flags;
+        entry.compression = file_hdr.compression;
+        entry.crc32 = file_hdr.crc32;
+        entry.compressed_size = file_hdr.compressed_size;
+        entry.uncompressed_size = file_hdr.uncompressed_size;
+        entry.local_hdr_off = file_hdr.local_hdr_off;
+
+        const auto name_len = std::min<u64>(file_hdr.filename_len, sizeof(entry.name) - 1);
+        std::memcpy(entry.name.s, data.data() + off + sizeof(file_hdr), name_len);
+        entry.name.s[name_len] = '\0';
+
+        off += total;
+    }
+
+    R_SUCCEED();
+}
+
+StreamUnzip::StreamUnzip(fs::Fs* fs, const OnEntry& on_entry) : m_fs{fs}, m_on_entry{on_entry} {
+    m_out.resize(1024 * 256);
+}
+
+StreamUnzip::~StreamUnzip() {
+    if (m_z_init) {
+        inflateEnd(&m_z);
+    }
+}
+
+Result StreamUnzip::Push(const void* data, u64 size) {
+    if (m_state == State::Done) {
+        R_SUCCEED();
+    }
+
+    // remove what was consumed by the last push.
+    if (m_buf_off) {
+        m_buf.erase(m_buf.begin(), m_buf.begin() + m_buf_off);
+        m_buf_off = 0;
+    }
+
+    const auto off = m_buf.size();
+    m_buf.resize(off + size);
+    std::memcpy(m_buf.data() + off, data, size);
+
+    for (bool more = true; more && m_state != State::Done;) {
+        switch (m_state) {
+            case State::Header: R_TRY(ParseHeader(more)); break;
+            case State::Data: R_TRY(ParseData(more)); break;
+            case State::Descriptor: R_TRY(ParseDescriptor(more)); break;
+            case State::Done: break;
+        }
+    }
+
+    R_SUCCEED();
+}
+
+Result StreamUnzip::Finish() {
+    R_UNLESS(m_state == State::Done || (m_state == State::Header && !Avail()), Result_MmzStreamTruncated);
+    R_SUCCEED();
+}
+
+Result StreamUnzip::ParseHeader(bool& more) {
+    u32 sig;
+    if (Avail() < sizeof(sig)) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    std::memcpy(&sig, Ptr(), sizeof(sig));
+    if (sig == FILE_HEADER_SIG || sig == END_RECORD_SIG) {
+        m_state = State::Done;
+        R_SUCCEED();
+    }
+
+    R_UNLESS(sig == LOCAL_HEADER_SIG, Result_MmzStreamBadHeader);
+
+    mmz_LocalHeader hdr;
+    if (Avail() < sizeof(hdr)) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    std::memcpy(&hdr, Ptr(), sizeof(hdr));
+    if (Avail() < sizeof(hdr) + hdr.filename_len + hdr.extrafield_len) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    m_has_descriptor = hdr.flags & (1 << 3);
+    // encrypted entries are not supported.
+    R_UNLESS(!(hdr.flags & (1 << 0)), Result_MmzStreamUnsupported);
+    R_UNLESS(hdr.compression == 0 || hdr.compression == Z_DEFLATED, Result_MmzStreamUnsupported);
+    R_UNLESS(!m_has_descriptor || hdr.compression == Z_DEFLATED, Result_MmzStreamUnsupported);
+
+    const auto name = (const char*)Ptr() + sizeof(hdr);
+    const auto name_len = std::min<u64>(hdr.filename_len, sizeof(m_name) - 1);
+    std::memcpy(m_name.s, name, name_len);
+    m_name.s[name_len] = '\0';
+
+    s64 compressed_size = hdr.compressed_size;
+    s64 uncompressed_size = hdr.uncompressed_size;
+
+    // the zip64 extra field stores the sizes that didn't fit.
+    m_zip64 = false;
+    auto extra = Ptr() + sizeof(hdr) + hdr.filename_len;
+    for (u32 off = 0; off + 4 <= hdr.extrafield_len;) {
+        u16 id, size;
+        std::memcpy(&id, extra + off, sizeof(id));
+        std::memcpy(&size, extra + off + 2, sizeof(size));
+        off += 4;
+
+        if (id == ZIP64_EXTRA_ID) {
+            m_zip64 = true;
+            u32 field_off = 0;
+            if (hdr.uncompressed_size == UINT32_MAX && field_off + 8 <= size) {
+                std::memcpy(&uncompressed_size, extra + off + field_off, 8);
+                field_off += 8;
+            }
+            if (hdr.compressed_size == UINT32_MAX && field_off + 8 <= size) {
+                std::memcpy(&compressed_size, extra + off + field_off, 8);
+                field_off += 8;
+            }
+        }
+
+        off += size;
+    }
+
+    m_buf_off += sizeof(hdr) + hdr.filename_len + hdr.extrafield_len;
+    m_compression = hdr.compression;
+    m_crc = hdr.crc32;
+    m_crc_calc = 0;
+    m_comp_left = m_has_descriptor ? -1 : compressed_size;
+    m_out_off = 0;
+
+    // folders are created when extracting the files inside them.
+    fs::FsPath path{};
+    if (name_len && m_name.s[name_len - 1] != '/') {
+        path = m_on_entry(m_name, uncompressed_size);
+    }
+
+    m_skip = path.empty();
+    if (!m_skip) {
+        m_fs->CreateDirectoryRecursivelyWithPath(path);
+        m_fs->DeleteFile(path);
+        R_TRY(m_fs->CreateFile(path, 0, 0));
+        R_TRY(m_fs->OpenFile(path, FsOpenMode_Write|FsOpenMode_Append, &m_file));
+    }
+
+    if (m_compression == Z_DEFLATED) {
+        if (!m_z_init) {
+            R_UNLESS(inflateInit2(&m_z, -MAX_WBITS) == Z_OK, Result_MmzStreamInflate);
+            m_z_init = true;
+        } else {
+            R_UNLESS(inflateReset(&m_z) == Z_OK, Result_MmzStreamInflate);
+        }
+    }
+
+    m_state = State::Data;
+    R_SUCCEED();
+}
+
+Result StreamUnzip::ParseData(bool& more) {
+    bool entry_done{};
+
+    if (m_compression == 0) {
+        const auto size = std::min<u64>(Avail(), m_comp_left);
+        if (size) {
+            R_TRY(WriteOut(Ptr(), size));
+            m_buf_off += size;
+            m_comp_left -= size;
+        }
+
+        entry_done = !m_comp_left;
+    } else {
+        auto in_size = Avail();
+        if (m_comp_left >= 0) {
+            in_size = std::min<u64>(in_size, m_comp_left);
+        }
+
+        m_z.next_in = const_cast<u8*>(Ptr());
+        m_z.avail_in = in_size;
+
+        int zr;
+        for (;;) {
+            m_z.next_out = m_out.data();
+            m_z.avail_out = m_out.size();
+
+            zr = inflate(&m_z, Z_NO_FLUSH);
+            R_UNLESS(zr == Z_OK || zr == Z_STREAM_END || zr == Z_BUF_ERROR, Result_MmzStreamInflate);
+
+            if (const auto produced = m_out.size() - m_z.avail_out) {
+                R_TRY(WriteOut(m_out.data(), produced));
+            }
+
+            // stop once the stream has ended or needs more input.
+            if (zr != Z_OK || (!m_z.avail_in && m_z.avail_out)) {
+                break;
+            }
+        }
+
+        const auto consumed = in_size - m_z.avail_in;
+        m_buf_off += consumed;
+        if (m_comp_left >= 0) {
+            m_comp_left -= consumed;
+        }
+
+        if (zr == Z_STREAM_END) {
+            entry_done = true;
+        } else {
+            // the compressed data ended before the deflate stream did.
+            R_UNLESS(m_comp_left != 0, Result_MmzStreamInflate);
+        }
+    }
+
+    if (!entry_done) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    if (m_has_descriptor) {
+        m_state = State::Descriptor;
+        R_SUCCEED();
+    }
+
+    return CloseEntry(m_crc);
+}
+
+Result StreamUnzip::ParseDescriptor(bool& more) {
+    u32 sig;
+    if (Avail() < sizeof(sig)) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    // the signature is optional.
+    std::memcpy(&sig, Ptr(), sizeof(sig));
+    const u64 sig_size = sig == DATA_DESCRIPTOR_SIG ? sizeof(sig) : 0;
+    const u64 size = sig_size + sizeof(u32) + (m_zip64 ? sizeof(u64) * 2 : sizeof(u32) * 2);
+    if (Avail() < size) {
+        more = false;
+        R_SUCCEED();
+    }
+
+    u32 crc;
+    std::memcpy(&crc, Ptr() + sig_size, sizeof(crc));
+    m_buf_off += size;
+
+    return CloseEntry(crc);
+}
+
+Result StreamUnzip::WriteOut(const void* data, u64 size) {
+    m_crc_calc = crc32CalculateWithSeed(m_crc_calc, data, size);
+
+    if (!m_skip) {
+        R_TRY(m_file.Write(m_out_off, data, size, FsWriteOption_None));
+    }
+
+    m_out_off += size;
+    R_SUCCEED();
+}
+
+Result StreamUnzip::CloseEntry(u32 crc) {
+    if (!m_skip) {
+        m_file.Close();
+    }
+
+    if (m_crc_calc != crc) {
+        log_write("[MZ] bad crc for: %s got: %08X expected: %08X\n", m_name.s, m_crc_calc, crc);
+        R_THROW(Result_MmzStreamBadCrc);
+    }
+
+    m_state = State::Header;
+    R_SUCCEED();
+}
+
 } // namespace sphaira::mz
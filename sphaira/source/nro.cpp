@@ -3,29 +3,24 @@
 #include "evman.hpp"
 #include "app.hpp"
 #include "log.hpp"
+#include "utils/task_pool.hpp"
 
 #include <switch.h>
 #include <vector>
 #include <cstring>
 #include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
 #include <minIni.h>
 
 namespace sphaira {
 namespace {
 
-auto nro_parse_internal(fs::Fs* fs, const fs::FsPath& path, NroEntry& entry) -> Result {
+// parses the header, nacp and icon offsets, without the timestamp.
+auto nro_parse_file(fs::Fs* fs, const fs::FsPath& path, NroEntry& entry) -> Result {
     entry.path = path;
 
-    // todo: special sorting for fw 2.0.0 to make it not look like shit
-    if (hosversionAtLeast(3,0,0)) {
-        // it doesn't matter if we fail
-        entry.timestamp.is_valid = false;
-        fs->GetFileTimeStampRaw(entry.path, &entry.timestamp);
-        // if (R_FAILED(fsFsGetFileTimeStampRaw(fs, entry.path, &entry.timestamp))) {
-        //     // log_write("failed to get timestamp for: %s\n", path);
-        // }
-    }
-
     fs::File f;
     R_TRY(fs->OpenFile(entry.path, FsOpenMode_Read, &f));
 
@@ -71,67 +66,321 @@ auto nro_parse_internal(fs::Fs* fs, const fs::FsPath& path, NroEntry& entry) ->
     R_SUCCEED();
 }
 
-// this function is recursive by 1 level deep
-// if the nro is in switch/folder/folder2/app.nro it will NOT be found
-// switch/folder/app.nro for example will work fine.
-auto nro_scan_internal(fs::Fs* fs, const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir, bool root) -> Result {
-    // we don't need to scan for folders if we are not root
-    u32 dir_open_type = FsDirOpenMode_ReadFiles | FsDirOpenMode_NoFileSize;
-    if (root) {
-        dir_open_type |= FsDirOpenMode_ReadDirs;
+auto nro_parse_internal(fs::Fs* fs, const fs::FsPath& path, NroEntry& entry) -> Result {
+    // todo: special sorting for fw 2.0.0 to make it not look like shit
+    if (hosversionAtLeast(3,0,0)) {
+        // it doesn't matter if we fail
+        entry.timestamp.is_valid = false;
+        fs->GetFileTimeStampRaw(path, &entry.timestamp);
+    }
+
+    return nro_parse_file(fs, path, entry);
+}
+
+constexpr fs::FsPath NRO_CACHE_PATH{"/switch/sphaira/cache/nro_scan.bin"};
+constexpr u32 NRO_CACHE_MAGIC = 0x43524F4E; // NROC
+constexpr u32 NRO_CACHE_VERSION = 1;
+
+struct NroCacheHeader {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 reserved;
+};
+
+// a parsed nro, which is valid for as long as the size and modified time
+// of the file are the same.
+struct NroCacheEntry {
+    fs::FsPath path;
+    s64 file_size;
+    FsTimeStampRaw timestamp;
+    s64 size;
+    MiniNacp nacp;
+    u64 icon_size;
+    u64 icon_offset;
+    u8 is_nacp_valid;
+    u8 reserved[7];
+};
+
+// parsed nro's from the last scan, so that only new or changed nro's are opened.
+// the cache is read-only during a scan, the results are then written back once
+// the scan has finished, which also removes any nro's that no longer exist.
+struct NroCache {
+    auto Find(const fs::FsPath& path, s64 file_size, const FsTimeStampRaw& timestamp) const -> const NroCacheEntry* {
+        const auto it = m_entries.find(path.s);
+        if (it == m_entries.end()) {
+            return nullptr;
+        }
+
+        const auto& e = it->second;
+        if (e.file_size != file_size || e.timestamp.modified != timestamp.modified) {
+            return nullptr;
+        }
+
+        return &e;
     }
 
+    void Update(std::unordered_map<std::string, NroCacheEntry>&& entries, bool changed) {
+        if (!changed && entries.size() == m_entries.size()) {
+            return;
+        }
+
+        m_entries = std::move(entries);
+        Save();
+    }
+
+    void Load() {
+        if (m_loaded) {
+            return;
+        }
+        m_loaded = true;
+
+        std::vector<u8> data;
+        if (R_FAILED(fs::FsNativeSd().read_entire_file(NRO_CACHE_PATH, data))) {
+            return;
+        }
+
+        NroCacheHeader header;
+        if (data.size() < sizeof(header)) {
+            return;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (header.magic != NRO_CACHE_MAGIC || header.version != NRO_CACHE_VERSION) {
+            return;
+        }
+
+        if (data.size() < sizeof(header) + (u64)header.count * sizeof(NroCacheEntry)) {
+            return;
+        }
+
+        for (u32 i = 0; i < header.count; i++) {
+            NroCacheEntry e;
+            std::memcpy(&e, data.data() + sizeof(header) + i * sizeof(e), sizeof(e));
+            e.path.s[sizeof(e.path.s) - 1] = '\0';
+            m_entries.emplace(e.path.s, e);
+        }
+
+        log_write("[NRO] loaded scan cache: %zu entries\n", m_entries.size());
+    }
+
+private:
+    void Save() {
+        std::vector<u8> data(sizeof(NroCacheHeader) + m_entries.size() * sizeof(NroCacheEntry));
+        const NroCacheHeader header{NRO_CACHE_MAGIC, NRO_CACHE_VERSION, (u32)m_entries.size()};
+        std::memcpy(data.data(), &header, sizeof(header));
+
+        u64 off = sizeof(header);
+        for (const auto& [path, e] : m_entries) {
+            std::memcpy(data.data() + off, &e, sizeof(e));
+            off += sizeof(e);
+        }
+
+        fs::FsNativeSd fs;
+        fs.CreateDirectoryRecursivelyWithPath(NRO_CACHE_PATH);
+        if (R_FAILED(fs.write_entire_file(NRO_CACHE_PATH, data))) {
+            log_write("[NRO] failed to save scan cache\n");
+            fs.DeleteFile(NRO_CACHE_PATH);
+        }
+    }
+
+private:
+    std::unordered_map<std::string, NroCacheEntry> m_entries{};
+    bool m_loaded{};
+};
+
+// only one scan at a time, as it updates the cache.
+Mutex g_cache_mutex{};
+NroCache g_cache{};
+
+// state of a single scan, each worker has its own results so that nothing
+// needs to be locked, these are merged in order once the scan is done.
+struct ScanContext {
+    const NroCache& cache;
+    bool scan_all_dir;
+    bool use_cache;
+};
+
+struct ScanResult {
+    std::vector<NroEntry> nros;
+    // every nro found, which becomes the new cache.
+    std::vector<NroCacheEntry> cache_entries;
+    // number of nro's that had to be parsed.
+    u32 parsed{};
+};
+
+// the nro is only opened if it's not in the cache, or has changed since.
+auto nro_parse_cached(const ScanContext& ctx, fs::Fs* fs, const fs::FsPath& path, s64 file_size, ScanResult& out) -> Result {
+    NroEntry entry;
+
+    if (!ctx.use_cache) {
+        R_TRY(nro_parse_internal(fs, path, entry));
+        out.nros.emplace_back(entry);
+        R_SUCCEED();
+    }
+
+    entry.timestamp.is_valid = false;
+    R_TRY(fs->GetFileTimeStampRaw(path, &entry.timestamp));
+
+    if (const auto e = ctx.cache.Find(path, file_size, entry.timestamp)) {
+        out.cache_entries.emplace_back(*e);
+        entry.path = path;
+        entry.size = e->size;
+        entry.nacp = e->nacp;
+        entry.icon_size = e->icon_size;
+        entry.icon_offset = e->icon_offset;
+        entry.is_nacp_valid = e->is_nacp_valid;
+    } else {
+        R_TRY(nro_parse_file(fs, path, entry));
+
+        out.parsed++;
+        auto& e = out.cache_entries.emplace_back();
+        e.path = path;
+        e.file_size = file_size;
+        e.timestamp = entry.timestamp;
+        e.size = entry.size;
+        e.nacp = entry.nacp;
+        e.icon_size = entry.icon_size;
+        e.icon_offset = entry.icon_offset;
+        e.is_nacp_valid = entry.is_nacp_valid;
+    }
+
+    out.nros.emplace_back(entry);
+    R_SUCCEED();
+}
+
+auto is_nro_file(const FsDirectoryEntry& e) -> bool {
+    // skip hidden files
+    return e.type == FsDirEntryType_File && '.' != e.name[0] && std::string_view{e.name}.ends_with(".nro");
+}
+
+// if the nro is in switch/folder/folder2/app.nro it will NOT be found
+// switch/folder/app.nro for example will work fine.
+void nro_scan_folder(const ScanContext& ctx, fs::Fs* fs, const fs::FsPath& path, const char* name, ScanResult& out) {
     fs::Dir d;
-    R_TRY(fs->OpenDirectory(path, dir_open_type, &d));
+    if (R_FAILED(fs->OpenDirectory(path, FsDirOpenMode_ReadFiles, &d))) {
+        return;
+    }
 
-    // we won't run out of memory here
+    // the file sizes are needed for the cache.
     std::vector<FsDirectoryEntry> entries;
-    R_TRY(d.ReadAll(entries));
+    if (R_FAILED(d.ReadAll(entries))) {
+        return;
+    }
+
+    // fast path for detecting an nro in a folder, ie folder/folder.nro
+    fs::FsPath fullpath;
+    const auto it = std::ranges::find_if(entries, [name](auto& e) {
+        const std::string_view file_name{e.name};
+        return is_nro_file(e) && file_name.length() == std::strlen(name) + 4 && file_name.starts_with(name);
+    });
+
+    if (it != entries.end()) {
+        std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, it->name);
+        if (R_SUCCEEDED(nro_parse_cached(ctx, fs, fullpath, it->file_size, out))) {
+            return;
+        }
+    }
 
+    // slow path...
     for (const auto& e : entries) {
-        // skip hidden files / folders
-        if ('.' == e.name[0]) {
+        if (!is_nro_file(e) || (it != entries.end() && &e == &*it)) {
             continue;
         }
 
+        std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
+        if (R_SUCCEEDED(nro_parse_cached(ctx, fs, fullpath, e.file_size, out))) {
+            if (!ctx.scan_all_dir) {
+                return;
+            }
+        } else {
+            log_write("error when trying to parse %s\n", fullpath.s);
+        }
+    }
+}
+
+auto nro_scan_internal(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir) -> Result {
+    SCOPED_MUTEX(&g_cache_mutex);
+
+    // the modified time is needed to know if the nro has changed.
+    const auto use_cache = hosversionAtLeast(3,0,0);
+    if (use_cache) {
+        g_cache.Load();
+    }
+
+    const ScanContext ctx{g_cache, scan_all_dir, use_cache};
+
+    fs::FsNativeSd fs;
+    std::vector<FsDirectoryEntry> entries;
+    {
+        u32 dir_open_type = FsDirOpenMode_ReadFiles;
+        if (nested) {
+            dir_open_type |= FsDirOpenMode_ReadDirs;
+        }
+
+        fs::Dir d;
+        R_TRY(fs.OpenDirectory(path, dir_open_type, &d));
+
+        // we won't run out of memory here
+        R_TRY(d.ReadAll(entries));
+    }
+
+    // nro's in the root are parsed first, then each folder is scanned by a task,
+    // as most of the time is spent waiting on the sd card.
+    ScanResult root_result;
+    std::vector<u32> folders;
+    for (u32 i = 0; i < entries.size(); i++) {
+        const auto& e = entries[i];
         if (e.type == FsDirEntryType_Dir) {
-            // assert(!root && "dir should only be scanned on non-root!");
-            fs::FsPath fullpath;
-            std::snprintf(fullpath, sizeof(fullpath), "%s/%s/%s.nro", path.s, e.name, e.name);
-
-            // fast path for detecting an nro in a folder
-            NroEntry entry;
-            if (R_SUCCEEDED(nro_parse_internal(fs, fullpath, entry))) {
-                // log_write("NRO: fast path for: %s\n", fullpath);
-                nros.emplace_back(entry);
-            } else {
-                // slow path...
-                std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
-                nro_scan_internal(fs, fullpath, nros, nested, scan_all_dir, false);
+            // skip hidden folders
+            if ('.' != e.name[0]) {
+                folders.emplace_back(i);
             }
-        } else if (e.type == FsDirEntryType_File && std::string_view{e.name}.ends_with(".nro")) {
+        } else if (is_nro_file(e)) {
             fs::FsPath fullpath;
             std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
 
-            NroEntry entry;
-            if (R_SUCCEEDED(nro_parse_internal(fs, fullpath, entry))) {
-                nros.emplace_back(entry);
-                if (!root && !scan_all_dir) {
-                    // log_write("NRO: slow path for: %s\n", fullpath);
-                    R_SUCCEED();
-                }
-            } else {
+            if (R_FAILED(nro_parse_cached(ctx, &fs, fullpath, e.file_size, root_result))) {
                 log_write("error when trying to parse %s\n", fullpath.s);
             }
         }
     }
 
-    R_SUCCEED();
-}
+    std::vector<ScanResult> results(folders.size());
+    {
+        utils::task::Group group;
+        for (u32 i = 0; i < folders.size(); i++) {
+            group.Push([&, i]() {
+                fs::FsNativeSd fs;
+                const auto& e = entries[folders[i]];
+                fs::FsPath fullpath;
+                std::snprintf(fullpath, sizeof(fullpath), "%s/%s", path.s, e.name);
+                nro_scan_folder(ctx, &fs, fullpath, e.name, results[i]);
+            });
+        }
 
-auto nro_scan_internal(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir, bool root) -> Result {
-    fs::FsNativeSd fs;
-    return nro_scan_internal(&fs, path, nros, nested, scan_all_dir, root);
+        group.Wait();
+    }
+
+    // root nro's first, then each folder in the order it was listed.
+    std::unordered_map<std::string, NroCacheEntry> cache_entries;
+    u32 parsed{};
+
+    results.insert(results.begin(), std::move(root_result));
+    for (auto& result : results) {
+        std::ranges::move(result.nros, std::back_inserter(nros));
+        for (const auto& e : result.cache_entries) {
+            cache_entries.emplace(e.path.s, e);
+        }
+        parsed += result.parsed;
+    }
+
+    if (use_cache) {
+        log_write("[NRO] scanned: %zu parsed: %u\n", nros.size(), parsed);
+        g_cache.Update(std::move(cache_entries), parsed);
+    }
+
+    R_SUCCEED();
 }
 
 auto nro_get_icon_internal(fs::File* f, u64 size, u64 offset) -> std::vector<u8> {
@@ -189,7 +438,7 @@ auto nro_parse(const fs::FsPath& path, NroEntry& entry) -> Result {
 }
 
 auto nro_scan(const fs::FsPath& path, std::vector<NroEntry>& nros, bool nested, bool scan_all_dir) -> Result {
-    return nro_scan_internal(path, nros, nested, scan_all_dir, true);
+    return nro_scan_internal(path, nros, nested, scan_all_dir);
 }
 
 auto nro_get_icon(const fs::FsPath& path, u64 size, u64 offset) -> std::vector<u8> {
@@ -5,6 +5,7 @@
 #include "log.hpp"
 #include "fs.hpp"
 #include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include <cstring>
 #include <vector>
@@ -26,6 +27,10 @@ using Socket = int;
 constexpr s32 SERVER_PORT = NXLINK_SERVER_PORT;
 constexpr s32 CLIENT_PORT = NXLINK_CLIENT_PORT;
 constexpr s32 ZLIB_CHUNK = 1024*64;
+// inflated data is written in blocks of this size, with this many queued
+// for the write thread, so memory use doesn't depend on the file size.
+constexpr s64 WRITE_BLOCK_SIZE = 1024*1024;
+constexpr u32 WRITE_BLOCK_COUNT = 4;
 
 constexpr s32 ERR_OK = 0;
 constexpr s32 ERR_FILE = -1;
@@ -161,19 +166,152 @@ auto acceptall(Socket sock, sockaddr* addr, socklen_t* addrlen) -> Socket {
     return -1;
 }
 
-auto get_file_data(Socket sock, int max) -> std::vector<u8> {
-    std::vector<u8> buf(max);
+// writes blocks to the file on its own thread, so that receiving and inflating
+// the next block overlaps with writing the previous one to the sd card.
+struct FileWriter {
+    struct Block {
+        sphaira::utils::pool::Vector<u8> data;
+        s64 size;
+    };
+
+    FileWriter(fs::File* f) : m_file{f} {
+        mutexInit(&m_mutex);
+        condvarInit(&m_can_push);
+        condvarInit(&m_can_pull);
+
+        for (auto& e : m_blocks) {
+            e.data.resize(WRITE_BLOCK_SIZE);
+        }
+    }
+
+    ~FileWriter() {
+        Finish();
+    }
+
+    Result Start() {
+        R_TRY(sphaira::utils::CreateThread(&m_thread, thread_func, this, 1024*32));
+
+        Result rc;
+        if (R_FAILED(rc = threadStart(&m_thread))) {
+            threadClose(&m_thread);
+            return rc;
+        }
+
+        m_started = true;
+        R_SUCCEED();
+    }
+
+    // waits for all pushed blocks to be written, returns the first error.
+    Result Finish() {
+        if (m_started) {
+            {
+                SCOPED_MUTEX(&m_mutex);
+                m_done = true;
+                condvarWakeOne(&m_can_pull);
+            }
+
+            threadWaitForExit(&m_thread);
+            threadClose(&m_thread);
+            m_started = false;
+        }
+
+        return m_rc;
+    }
+
+    // waits for a free block, returns nullptr if the write thread failed.
+    auto GetBlock() -> Block* {
+        SCOPED_MUTEX(&m_mutex);
+        while (R_SUCCEEDED(m_rc) && m_pushed - m_written >= WRITE_BLOCK_COUNT) {
+            condvarWait(&m_can_push, &m_mutex);
+        }
+
+        if (R_FAILED(m_rc)) {
+            return nullptr;
+        }
+
+        return &m_blocks[m_pushed % WRITE_BLOCK_COUNT];
+    }
+
+    // queues the block returned by GetBlock().
+    void Push() {
+        SCOPED_MUTEX(&m_mutex);
+        m_pushed++;
+        condvarWakeOne(&m_can_pull);
+    }
+
+private:
+    static void thread_func(void* arg) {
+        static_cast<FileWriter*>(arg)->Loop();
+    }
+
+    void Loop() {
+        for (;;) {
+            const Block* block;
+            {
+                SCOPED_MUTEX(&m_mutex);
+                while (!m_done && m_written == m_pushed) {
+                    condvarWait(&m_can_pull, &m_mutex);
+                }
+
+                if (m_written == m_pushed) {
+                    return;
+                }
+
+                block = &m_blocks[m_written % WRITE_BLOCK_COUNT];
+            }
+
+            const auto rc = m_file->Write(m_offset, block->data.data(), block->size, FsWriteOption_None);
+            m_offset += block->size;
+
+            SCOPED_MUTEX(&m_mutex);
+            if (R_FAILED(rc)) {
+                m_rc = rc;
+                condvarWakeOne(&m_can_push);
+                return;
+            }
+
+            m_written++;
+            condvarWakeOne(&m_can_push);
+        }
+    }
+
+private:
+    fs::File* m_file;
+    Thread m_thread{};
+    Mutex m_mutex{};
+    CondVar m_can_push{};
+    CondVar m_can_pull{};
+    Block m_blocks[WRITE_BLOCK_COUNT]{};
+    u64 m_pushed{};
+    u64 m_written{};
+    s64 m_offset{};
+    Result m_rc{};
+    bool m_done{};
+    bool m_started{};
+};
+
+// receives and inflates the file straight into the writer's blocks.
+// the start of the file is copied into header, so that it can be verified.
+auto get_file_data(Socket sock, s64 max, FileWriter& writer, std::vector<u8>& header) -> bool {
     std::vector<u8> chunk(ZLIB_CHUNK);
-    ZlibWrapper zlib{buf.data(), buf.size()};
+    ZlibWrapper zlib{};
     u32 want{};
 
-    while (zlib.strm.total_out < buf.size()) {
+    auto block = writer.GetBlock();
+    if (!block) {
+        return false;
+    }
+
+    zlib.strm.next_out = block->data.data();
+    zlib.strm.avail_out = block->data.size();
+
+    while ((s64)zlib.strm.total_out < max) {
         if (g_quit) {
-            return {};
+            return false;
         }
 
         if (!recvall(sock, &want, sizeof(want))) {
-            return {};
+            return false;
         }
 
         if (want > chunk.size()) {
@@ -181,15 +319,48 @@ auto get_file_data(Socket sock, int max) -> std::vector<u8> {
         }
 
         if (!recvall(sock, chunk.data(), want)) {
-            return {};
+            return false;
         }
 
         WriteCallbackProgress(NxlinkCallbackType_WriteProgress, want, max);
         zlib.Setup(chunk.data(), want);
-        zlib.Inflate(Z_NO_FLUSH);
+
+        while (zlib.strm.avail_in && (s64)zlib.strm.total_out < max) {
+            const auto rc = zlib.Inflate(Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END) {
+                log_write("[NXLINK] failed to inflate: %d\n", rc);
+                return false;
+            }
+
+            const auto done = (s64)zlib.strm.total_out >= max;
+            if (!zlib.strm.avail_out || done) {
+                block->size = block->data.size() - zlib.strm.avail_out;
+                if (header.empty()) {
+                    header.assign(block->data.data(), block->data.data() + std::min<s64>(block->size, sizeof(sphaira::NroData)));
+                }
+                writer.Push();
+
+                if (done) {
+                    break;
+                }
+
+                if (!(block = writer.GetBlock())) {
+                    return false;
+                }
+
+                zlib.strm.next_out = block->data.data();
+                zlib.strm.avail_out = block->data.size();
+            }
+
+            // the stream ended before the size that was sent.
+            if (rc == Z_STREAM_END) {
+                log_write("[NXLINK] stream ended early: %zu / %zd\n", (size_t)zlib.strm.total_out, (ssize_t)max);
+                return false;
+            }
+        }
     }
 
-    return buf;
+    return true;
 }
 
 void loop(void* args) {
@@ -347,16 +518,6 @@ void loop(void* args) {
                 continue;
             }
 
-            // todo: verify nro magic here
-            WriteCallbackFile(NxlinkCallbackType_WriteBegin, name);
-            const auto file_data = get_file_data(connfd, filesize);
-            WriteCallbackFile(NxlinkCallbackType_WriteEnd, name);
-
-            if (file_data.empty()) {
-                log_write("[NXLINK] failed to get file data: 0x%X %s\n", socketGetLastResult(), strerror(errno));
-                continue;
-            }
-
             fs::FsPath path;
             // if (!name_view.starts_with("/") && !name_view.starts_with("sdmc:/")) {
             if (name[0] != '/' && strncasecmp(name, "sdmc:/", std::strlen("sdmc:/"))) {
@@ -365,6 +526,7 @@ void loop(void* args) {
                 path = name;
             }
 
+            // the file is written as it's received, so it's created up front.
             // if (R_FAILED(rc = create_directories(fs, path))) {
             if (R_FAILED(rc = fs.CreateDirectoryRecursivelyWithPath(path))) {
                 sendall(connfd, &ERR_FILE, sizeof(ERR_FILE));
@@ -374,13 +536,14 @@ void loop(void* args) {
 
             // this is the path we will write to
             const auto temp_path = path + "~";
-            if (R_FAILED(rc = fs.CreateFile(temp_path, file_data.size(), 0)) && rc != FsError_PathAlreadyExists) {
+            if (R_FAILED(rc = fs.CreateFile(temp_path, filesize, 0)) && rc != FsError_PathAlreadyExists) {
                 sendall(connfd, &ERR_FILE, sizeof(ERR_FILE));
                 log_write("[NXLINK] failed to create file: %X\n", rc);
                 continue;
             }
             ON_SCOPE_EXIT(fs.DeleteFile(temp_path));
 
+            std::vector<u8> header;
             {
                 fs::File f;
                 if (R_FAILED(rc = fs.OpenFile(temp_path, FsOpenMode_Write, &f))) {
@@ -389,30 +552,31 @@ void loop(void* args) {
                     continue;
                 }
 
-                if (R_FAILED(rc = f.SetSize(file_data.size()))) {
+                if (R_FAILED(rc = f.SetSize(filesize))) {
                     sendall(connfd, &ERR_FILE, sizeof(ERR_FILE));
-                    log_write("[NXLINK] failed to set file size: 0x%X\n", socketGetLastResult());
+                    log_write("[NXLINK] failed to set file size: 0x%X\n", rc);
                     continue;
                 }
 
-                u64 offset = 0;
-                while (offset < file_data.size()) {
-                    svcSleepThread(YieldType_WithoutCoreMigration);
-
-                    u64 chunk_size = 1024*1024;
-                    if (offset + chunk_size > file_data.size()) {
-                        chunk_size = file_data.size() - offset;
-                    }
-                    if (R_FAILED(rc = f.Write(offset, file_data.data() + offset, chunk_size, FsWriteOption_None))) {
-                        break;
-                    }
-                    offset += chunk_size;
+                FileWriter writer{&f};
+                if (R_FAILED(rc = writer.Start())) {
+                    sendall(connfd, &ERR_FILE, sizeof(ERR_FILE));
+                    log_write("[NXLINK] failed to start writer: 0x%X\n", rc);
+                    continue;
                 }
 
-                // if (R_FAILED(rc = fsFileWrite(&f, 0, file_data.data(), file_data.size(), FsWriteOption_None))) {
-                if (R_FAILED(rc)) {
+                WriteCallbackFile(NxlinkCallbackType_WriteBegin, name);
+                const auto got_data = get_file_data(connfd, filesize, writer, header);
+                WriteCallbackFile(NxlinkCallbackType_WriteEnd, name);
+
+                if (R_FAILED(rc = writer.Finish())) {
                     sendall(connfd, &ERR_FILE, sizeof(ERR_FILE));
-                    log_write("[NXLINK] failed to write: 0x%X\n", socketGetLastResult());
+                    log_write("[NXLINK] failed to write: 0x%X\n", rc);
+                    continue;
+                }
+
+                if (!got_data) {
+                    log_write("[NXLINK] failed to get file data: 0x%X %s\n", socketGetLastResult(), strerror(errno));
                     continue;
                 }
             }
@@ -434,7 +598,7 @@ void loop(void* args) {
                 continue;
             }
 
-            if (R_SUCCEEDED(sphaira::nro_verify(file_data))) {
+            if (R_SUCCEEDED(sphaira::nro_verify(header))) {
                 std::string args{};
 
                 // try and get args
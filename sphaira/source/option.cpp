@@ -13,16 +13,16 @@ template<typename T>
 auto OptionBase<T>::GetInternal(const char* name) -> T {
     if (!m_value.has_value()) {
         if (m_file) {
+            auto& config = App::GetConfigStore();
             if constexpr(std::is_same_v<T, bool>) {
-                m_value = ini_getbool(m_section.c_str(), name, m_default_value, App::CONFIG_PATH);
+                m_value = config.GetBool(m_section, name, m_default_value);
             } else if constexpr(std::is_same_v<T, long>) {
-                m_value = ini_getl(m_section.c_str(), name, m_default_value, App::CONFIG_PATH);
+                m_value = config.GetLong(m_section, name, m_default_value);
             } else if constexpr(std::is_same_v<T, float>) {
-                m_value = ini_getf(m_section.c_str(), name, m_default_value, App::CONFIG_PATH);
+                std::string value;
+                m_value = config.Get(m_section, name, value) ? ini_atof(value.c_str()) : m_default_value;
             } else if constexpr(std::is_same_v<T, std::string>) {
-                char buf[PATH_MAX]{};
-                ini_gets(m_section.c_str(), name, m_default_value.c_str(), buf, sizeof(buf), App::CONFIG_PATH);
-                m_value = buf;
+                m_value = config.GetString(m_section, name, m_default_value);
             }
         } else {
             m_value = m_default_value;
@@ -39,25 +39,27 @@ auto OptionBase<T>::Get() -> T {
 
 template<typename T>
 auto OptionBase<T>::GetOr(const char* name) -> T {
-    if (m_file && ini_haskey(m_section.c_str(), m_name.c_str(), App::CONFIG_PATH)) {
+    if (m_file && App::GetConfigStore().Has(m_section, m_name)) {
         return Get();
     } else {
         return GetInternal(name);
     }
 }
 
+// only updates the config store, which is written on idle or menu exit.
 template<typename T>
 void OptionBase<T>::Set(T value) {
     m_value = value;
     if (m_file) {
+        auto& config = App::GetConfigStore();
         if constexpr(std::is_same_v<T, bool>) {
-            ini_putl(m_section.c_str(), m_name.c_str(), value, App::CONFIG_PATH);
+            config.SetLong(m_section, m_name, value);
         } else if constexpr(std::is_same_v<T, long>) {
-            ini_putl(m_section.c_str(), m_name.c_str(), value, App::CONFIG_PATH);
+            config.SetLong(m_section, m_name, value);
         } else if constexpr(std::is_same_v<T, float>) {
-            ini_putf(m_section.c_str(), m_name.c_str(), value, App::CONFIG_PATH);
+            config.Set(m_section, m_name, std::to_string(value));
         } else if constexpr(std::is_same_v<T, std::string>) {
-            ini_puts(m_section.c_str(), m_name.c_str(), value.c_str(), App::CONFIG_PATH);
+            config.Set(m_section, m_name, value);
         }
     }
 }
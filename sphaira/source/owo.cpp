@@ -6,6 +6,9 @@
 #include <string>
 #include <string_view>
 #include <span>
+#include <algorithm>
+#include <memory>
+#include <atomic>
 
 #include "yati/nx/nca.hpp"
 #include "yati/nx/ncm.hpp"
@@ -19,6 +22,8 @@
 #include "defines.hpp"
 #include "app.hpp"
 #include "ui/progress_box.hpp"
+#include "threaded_file_transfer.hpp"
+#include "utils/task_pool.hpp"
 #include "i18n.hpp"
 #include "log.hpp"
 
@@ -75,12 +80,12 @@ struct BufHelper {
 };
 
 struct NcaEntry {
-    NcaEntry(const BufHelper& buf, NcmContentType _type) : data{buf.buf}, type{_type} {
+    NcaEntry(BufHelper&& buf, NcmContentType _type) : data{std::move(buf.buf)}, type{_type} {
         sha256CalculateHash(hash, data.data(), data.size());
     }
 
-    const std::vector<u8> data;
-    const u8 type;
+    std::vector<u8> data;
+    u8 type;
     u8 hash[SHA256_HASH_SIZE];
 };
 
@@ -104,7 +109,7 @@ struct NcmContentMetaData {
 };
 
 struct NcaMetaEntry {
-    NcaMetaEntry(const BufHelper& buf, NcmContentType type) : nca_entry{buf, type} { }
+    NcaMetaEntry(BufHelper&& buf, NcmContentType type) : nca_entry{std::move(buf), type} { }
 
     NcaEntry nca_entry;
     NcmContentMetaHeader content_meta_header{};
@@ -179,6 +184,11 @@ typedef struct {
     u64 file_partition_size;
 } romfs_ctx_t;
 
+// size of off once padded by write_padding(), which always adds at least 1 byte.
+auto padded_size(u64 off, u64 block) -> u64 {
+    return off + block - (off % block);
+}
+
 auto write_padding(BufHelper& buf, u64 off, u64 block) -> u64 {
     const u64 size = block - (off % block);
     if (size) {
@@ -398,19 +408,6 @@ void build_romfs_into_file(const FileEntries& entries, BufHelper& buf) {
     free(file_table);
 }
 
-auto romfs_build(const FileEntries& entries, u64 *out_size) -> std::vector<u8> {
-    BufHelper buf;
-
-    build_romfs_into_file(entries, buf);
-
-    // Write Padding
-    buf.seek(buf.buf.size());
-    *out_size = buf.tell();
-    write_padding(buf, buf.tell(), IVFC_HASH_BLOCK_SIZE);
-
-    return buf.buf;
-}
-
 auto npdm_patch_kc(std::vector<u8>& npdm, u32 off, u32 size, u32 bitmask, u32 value) -> bool {
     const u32 pattern = BIT(bitmask) - 1;
     const u32 mask = BIT(bitmask) | pattern;
@@ -522,7 +519,7 @@ void add_file_entry(FileEntries& entries, const char* name, const void* data, u6
     entry.name = name;
     entry.data.resize(size);
     std::memcpy(entry.data.data(), data, size);
-    entries.emplace_back(entry);
+    entries.emplace_back(std::move(entry));
 }
 
 void add_file_entry(FileEntries& entries, const char* name, std::span<const u8> data) {
@@ -535,7 +532,8 @@ auto build_ivfc_master_hash(std::span<const u8> level1) -> std::vector<u8> {
     return hash;
 }
 
-auto build_pfs0(const FileEntries& entries) -> std::vector<u8> {
+// the header, file table and string table, the file data follows in order.
+auto build_pfs0_header(const FileEntries& entries, u64* data_size) -> std::vector<u8> {
     BufHelper buf;
 
     Pfs0Header header{};
@@ -570,30 +568,18 @@ auto build_pfs0(const FileEntries& entries) -> std::vector<u8> {
     buf.write(file_table.data(), sizeof(Pfs0FileTable) * file_table.size());
     buf.write(string_table.data(), string_table.size());
 
-    for (const auto&e : entries) {
-        buf.write(e.data.data(), e.data.size());
-    }
-
-    return buf.buf;
+    *data_size = data_offset;
+    return std::move(buf.buf);
 }
 
-auto build_pfs0_hash_table(const std::vector<u8>& pfs0, u32 block_size) -> std::vector<u8> {
-    BufHelper buf;
-    u8 hash[SHA256_HASH_SIZE];
-    u32 read_size = block_size;
-
-    for (u32 i = 0; i < pfs0.size(); i += read_size) {
-        if (i + read_size >= pfs0.size()) {
-            read_size = pfs0.size() - i;
-        }
-        sha256CalculateHash(hash, pfs0.data() + i, read_size);
-        buf.write(hash, sizeof(hash));
+// hashes src in blocks, writing each hash to out.
+void build_hash_table(u8* out, const u8* src, u64 size, u64 block_size) {
+    for (u64 i = 0; i < size; i += block_size) {
+        sha256CalculateHash(out + i / block_size * SHA256_HASH_SIZE, src + i, std::min(block_size, size - i));
     }
-
-    return buf.buf;
 }
 
-auto build_pfs0_master_hash(const std::vector<u8>& pfs0_hash_table) -> std::vector<u8> {
+auto build_pfs0_master_hash(std::span<const u8> pfs0_hash_table) -> std::vector<u8> {
     std::vector<u8> hash(SHA256_HASH_SIZE);
     sha256CalculateHash(hash.data(), pfs0_hash_table.data(), pfs0_hash_table.size());
     return hash;
@@ -604,14 +590,7 @@ void write_nca_padding(BufHelper& buf) {
 }
 
 void nca_encrypt_header(nca::Header* header, std::span<const u8> key) {
-    Aes128XtsContext ctx{};
-    aes128XtsContextCreate(&ctx, key.data(), key.data() + 0x10, true);
-
-    u8 sector{};
-    for (u64 pos = 0; pos < 0xC00; pos += 0x200) {
-        aes128XtsContextResetSector(&ctx, sector++, true);
-        aes128XtsEncrypt(&ctx, (u8*)header + pos, (const u8*)header + pos, 0x200);
-    }
+    crypto::Aes128Xts(key.data(), true).Run(header, header, 0, 0x200, 0xC00);
 }
 
 void write_nca_section(nca::Header& nca_header, u8 index, u64 start, u64 end) {
@@ -648,55 +627,92 @@ void write_nca_fs_header_romfs(nca::Header& nca_header, u8 index) {
     sha256CalculateHash(&nca_header.fs_header_hash[index], &fs_header, sizeof(fs_header));
 }
 
-void write_nca_pfs0(nca::Header& nca_header, u8 index, const FileEntries& entries, u32 block_size, BufHelper& buf) {
-    const auto pfs0 = build_pfs0(entries);
-    const auto pfs0_hash_table = build_pfs0_hash_table(pfs0, block_size);
-    const auto pfs0_master_hash = build_pfs0_master_hash(pfs0_hash_table);
+// a pfs0 section, which doesn't depend on where it's placed in the nca, so that
+// it can be shared between ncas.
+struct Pfs0Section {
+    std::vector<u8> data;
+    std::vector<u8> master_hash;
+    u64 hash_table_size;
+    u64 pfs0_offset;
+    u64 pfs0_size;
+};
+
+// the pfs0 is written after its hash table, which is then filled in by
+// hashing the pfs0 in place.
+auto build_pfs0_section(const FileEntries& entries, u32 block_size) -> Pfs0Section {
+    u64 data_size;
+    const auto pfs0_header = build_pfs0_header(entries, &data_size);
+    const auto pfs0_size = pfs0_header.size() + data_size;
+    const auto hash_table_size = (pfs0_size + block_size - 1) / block_size * SHA256_HASH_SIZE;
 
-    buf.write(pfs0_hash_table.data(), pfs0_hash_table.size());
-    const auto padding_size = write_padding(buf, pfs0_hash_table.size(), PFS0_PADDING_SIZE);
+    BufHelper buf;
+    buf.seek(hash_table_size);
+    write_padding(buf, hash_table_size, PFS0_PADDING_SIZE);
+
+    const auto pfs0_offset = buf.tell();
+    buf.write(pfs0_header);
+    for (const auto& e : entries) {
+        buf.write(e.data);
+    }
 
-    nca_header.fs_header[index].hash_data.hierarchical_sha256_data.pfs0_layer.offset = pfs0_hash_table.size() + padding_size;
-    nca_header.fs_header[index].hash_data.hierarchical_sha256_data.pfs0_layer.size = pfs0.size();
+    const auto base = buf.buf.data();
+    build_hash_table(base, base + pfs0_offset, pfs0_size, block_size);
+    auto master_hash = build_pfs0_master_hash({base, hash_table_size});
 
-    buf.write(pfs0.data(), pfs0.size());
+    // sections start 0x200 aligned, so this is the same as padding in the nca.
     write_nca_padding(buf);
 
-    const auto section_start = index == 0 ? sizeof(nca_header) : nca_header.fs_table[index-1].media_end_offset * 0x200;
-    write_nca_section(nca_header, index, section_start, buf.tell());
-    write_nca_fs_header_pfs0(nca_header, index, pfs0_master_hash, pfs0_hash_table.size(), block_size);
+    return {std::move(buf.buf), std::move(master_hash), hash_table_size, pfs0_offset, pfs0_size};
 }
 
-auto ivfc_create_level(const std::vector<u8>& src) -> std::vector<u8> {
-    BufHelper buf;
-    u8 hash[SHA256_HASH_SIZE];
-    u64 read_size = IVFC_HASH_BLOCK_SIZE;
+void write_nca_pfs0(nca::Header& nca_header, u8 index, const Pfs0Section& section, u32 block_size, BufHelper& buf) {
+    nca_header.fs_header[index].hash_data.hierarchical_sha256_data.pfs0_layer.offset = section.pfs0_offset;
+    nca_header.fs_header[index].hash_data.hierarchical_sha256_data.pfs0_layer.size = section.pfs0_size;
 
-    for (u32 i = 0; i < src.size(); i += read_size) {
-        if (i + read_size >= src.size()) {
-            read_size = src.size() - i;
-        }
-        sha256CalculateHash(hash, src.data() + i, read_size);
-        buf.write(hash, sizeof(hash));
-    }
+    buf.write(section.data);
 
-    write_padding(buf, buf.tell(), IVFC_HASH_BLOCK_SIZE);
+    const auto section_start = index == 0 ? sizeof(nca_header) : nca_header.fs_table[index-1].media_end_offset * 0x200;
+    write_nca_section(nca_header, index, section_start, buf.tell());
+    write_nca_fs_header_pfs0(nca_header, index, section.master_hash, section.hash_table_size, block_size);
+}
 
-    return buf.buf;
+void write_nca_pfs0(nca::Header& nca_header, u8 index, const FileEntries& entries, u32 block_size, BufHelper& buf) {
+    write_nca_pfs0(nca_header, index, build_pfs0_section(entries, block_size), block_size, buf);
 }
 
+// the levels are laid out in the nca from 0 to 5, with the romfs as level 5.
+// each level is the padded hash table of the level after it, so they're
+// filled in last to first, hashing the nca in place.
 void write_nca_romfs(nca::Header& nca_header, u8 index, const FileEntries& entries, u32 block_size, BufHelper& buf) {
     auto& fs_header = nca_header.fs_header[index];
     auto& meta_info = fs_header.hash_data.integrity_meta_info;
     auto& info_level_hash = meta_info.info_level_hash;
 
-    std::vector<u8> ivfc[IVFC_MAX_LEVEL];
+    BufHelper romfs;
+    build_romfs_into_file(entries, romfs);
+    info_level_hash.levels[5].hash_data_size = romfs.buf.size();
+
+    u64 level_size[IVFC_MAX_LEVEL];
+    level_size[5] = padded_size(romfs.buf.size(), IVFC_HASH_BLOCK_SIZE);
+    for (int b = 4; b >= 0; b--) {
+        const auto hash_count = (level_size[b + 1] + IVFC_HASH_BLOCK_SIZE - 1) / IVFC_HASH_BLOCK_SIZE;
+        level_size[b] = padded_size(hash_count * SHA256_HASH_SIZE, IVFC_HASH_BLOCK_SIZE);
+    }
+
+    u64 level_offset[IVFC_MAX_LEVEL];
+    level_offset[0] = buf.tell();
+    for (u32 i = 1; i < IVFC_MAX_LEVEL; i++) {
+        level_offset[i] = level_offset[i - 1] + level_size[i - 1];
+    }
 
-    ivfc[5] = romfs_build(entries, &info_level_hash.levels[5].hash_data_size);
+    const auto end = level_offset[5] + level_size[5];
+    buf.buf.resize(std::max<u64>(buf.buf.size(), end));
+    const auto base = buf.buf.data();
+    std::memcpy(base + level_offset[5], romfs.buf.data(), romfs.buf.size());
 
     for (int b = 4; b >= 0; b--) {
-        ivfc[b] = ivfc_create_level(ivfc[b + 1]);
-        info_level_hash.levels[b].hash_data_size = ivfc[b].size();
+        build_hash_table(base + level_offset[b], base + level_offset[b + 1], level_size[b + 1], IVFC_HASH_BLOCK_SIZE);
+        info_level_hash.levels[b].hash_data_size = level_size[b];
         info_level_hash.levels[b].block_size = 0x0E; // 0x4000
     }
 
@@ -705,15 +721,12 @@ void write_nca_romfs(nca::Header& nca_header, u8 index, const FileEntries& entri
         info_level_hash.levels[i].logical_offset = info_level_hash.levels[i - 1].logical_offset + info_level_hash.levels[i - 1].hash_data_size;
     }
 
-    for (const auto& iv : ivfc) {
-        buf.write(iv.data(), iv.size());
-    }
+    const auto ivfc_master_hash = build_ivfc_master_hash({base + level_offset[0], level_size[0]});
+    std::memcpy(meta_info.master_hash, ivfc_master_hash.data(), sizeof(meta_info.master_hash));
 
+    buf.seek(end);
     write_nca_padding(buf);
 
-    const auto ivfc_master_hash = build_ivfc_master_hash(ivfc[0]);
-    std::memcpy(meta_info.master_hash, ivfc_master_hash.data(), sizeof(meta_info.master_hash));
-
     const auto section_start = index == 0 ? sizeof(nca_header) : nca_header.fs_table[index-1].media_end_offset * 0x200;
     write_nca_section(nca_header, index, section_start, buf.tell());
     write_nca_fs_header_romfs(nca_header, index);
@@ -732,20 +745,20 @@ void write_nca_header_encypted(nca::Header& nca_header, u64 tid, const keys::Key
     buf.write(&nca_header, sizeof(nca_header));
 }
 
-auto create_program_nca(u64 tid, const keys::Keys& keys, const FileEntries& exefs, const FileEntries& romfs, const FileEntries& logo) -> NcaEntry {
+// logo is optional.
+auto create_program_nca(u64 tid, const keys::Keys& keys, const FileEntries& exefs, const FileEntries& romfs, const Pfs0Section* logo) -> NcaEntry {
     BufHelper buf;
     nca::Header nca_header{};
     buf.write(&nca_header, sizeof(nca_header));
 
     write_nca_pfs0(nca_header, 0, exefs, PFS0_EXEFS_HASH_BLOCK_SIZE, buf);
     write_nca_romfs(nca_header, 1, romfs, IVFC_HASH_BLOCK_SIZE, buf);
-    // only write logo if set (can only 1 file be added?)
-    if (logo.size() == 2 && !logo[0].data.empty() && !logo[1].data.empty()) {
-        write_nca_pfs0(nca_header, 2, logo, PFS0_LOGO_HASH_BLOCK_SIZE, buf);
+    if (logo) {
+        write_nca_pfs0(nca_header, 2, *logo, PFS0_LOGO_HASH_BLOCK_SIZE, buf);
     }
     write_nca_header_encypted(nca_header, tid, keys, nca::ContentType_Program, buf);
 
-    return {buf, NcmContentType_Program};
+    return {std::move(buf), NcmContentType_Program};
 }
 
 auto create_control_nca(u64 tid, const keys::Keys& keys, const FileEntries& romfs) -> NcaEntry{
@@ -756,7 +769,7 @@ auto create_control_nca(u64 tid, const keys::Keys& keys, const FileEntries& romf
     write_nca_romfs(nca_header, 0, romfs, IVFC_HASH_BLOCK_SIZE, buf);
     write_nca_header_encypted(nca_header, tid, keys, nca::ContentType_Control, buf);
 
-    return {buf, NcmContentType_Control};
+    return {std::move(buf), NcmContentType_Control};
 }
 
 auto create_meta_nca(u64 tid, const keys::Keys& keys, NcmStorageId storage_id, const std::vector<NcaEntry>& ncas) -> NcaMetaEntry {
@@ -801,7 +814,7 @@ auto create_meta_nca(u64 tid, const keys::Keys& keys, NcmStorageId storage_id, c
     write_nca_header_encypted(nca_header, tid, keys, nca::ContentType_Meta, buf);
 
     // entry
-    NcaMetaEntry entry{buf, NcmContentType_Meta};
+    NcaMetaEntry entry{std::move(buf), NcmContentType_Meta};
 
     // header
     entry.content_meta_header = cnmt_header.meta_header;
@@ -838,24 +851,32 @@ auto create_meta_nca(u64 tid, const keys::Keys& keys, NcmStorageId storage_id, c
     return entry;
 }
 
-auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStorageId storage_id) -> Result {
-    pbox->SetTitle(config.name);
-    pbox->SetImageDataConst(config.icon);
-
-    R_UNLESS(!config.nro_path.empty(), Result_OwoBadArgs);
-    R_UNLESS(!config.icon.empty(), Result_OwoBadArgs);
-
-    R_TRY(splCryptoInitialize());
-    ON_SCOPE_EXIT(splCryptoExit());
+// only written if both are set (can only 1 file be added?)
+auto build_logo_section(const OwoConfig& config) -> std::shared_ptr<const Pfs0Section> {
+    if (config.logo.empty() || config.gif.empty()) {
+        return {};
+    }
 
-    R_TRY(ncmInitialize());
-    ON_SCOPE_EXIT(ncmExit());
+    FileEntries logo;
+    add_file_entry(logo, "NintendoLogo.png", config.logo);
+    add_file_entry(logo, "StartupMovie.gif", config.gif);
+    return std::make_shared<Pfs0Section>(build_pfs0_section(logo, PFS0_LOGO_HASH_BLOCK_SIZE));
+}
 
-    R_TRY(ns::Initialize());
-    ON_SCOPE_EXIT(ns::Exit());
+// the ncas and records of a forwarder, built ahead of installing it.
+struct BuiltForwarder {
+    u64 tid;
+    u64 old_tid;
+    std::vector<NcaEntry> nca_entries;
+    NcmContentMetaKey content_meta_key;
+    ncm::ContentStorageRecord content_storage_record;
+    NcmContentMetaData content_meta_data;
+};
 
-    keys::Keys keys;
-    R_TRY(keys::parse_keys(keys, false));
+// doesn't touch the progress box so that it can be run on any thread.
+auto build_forwarder(const keys::Keys& keys, OwoConfig& config, NcmStorageId storage_id, const Pfs0Section* logo, BuiltForwarder& out) -> Result {
+    R_UNLESS(!config.nro_path.empty(), Result_OwoBadArgs);
+    R_UNLESS(!config.icon.empty(), Result_OwoBadArgs);
 
     // fix args to include nro path
     if (config.args.empty()) {
@@ -868,14 +889,12 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
     u64 hash_data[SHA256_HASH_SIZE / sizeof(u64)];
     const auto hash_path = config.nro_path + config.args;
     sha256CalculateHash(hash_data, hash_path.data(), hash_path.length());
-    const u64 old_tid = 0x0100000000000000 | (hash_data[0] & 0x00FFFFFFFFFFF000);
-    const u64 tid = 0x0500000000000000 | (hash_data[0] & 0x00FFFFFFFFFFF000);
-
-    std::vector<NcaEntry> nca_entries;
+    out.old_tid = 0x0100000000000000 | (hash_data[0] & 0x00FFFFFFFFFFF000);
+    out.tid = 0x0500000000000000 | (hash_data[0] & 0x00FFFFFFFFFFF000);
+    const auto tid = out.tid;
 
     // create program
     if (config.program_nca.empty()) {
-        pbox->NewTransfer("Creating Program"_i18n).UpdateTransfer(0, 8);
         FileEntries exefs;
         add_file_entry(exefs, "main", HBL_MAIN_DATA);
         add_file_entry(exefs, "main.npdm", HBL_NPDM_DATA);
@@ -884,30 +903,21 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
         add_file_entry(romfs, "/nextArgv", config.args.data(), config.args.length());
         add_file_entry(romfs, "/nextNroPath", config.nro_path.data(), config.nro_path.length());
 
-        FileEntries logo;
-        if (!config.logo.empty()) {
-            add_file_entry(logo, "NintendoLogo.png", config.logo);
-        }
-        if (!config.gif.empty()) {
-            add_file_entry(logo, "StartupMovie.gif", config.gif);
-        }
-
         NpdmPatch npdm_patch;
         npdm_patch.tid = tid;
         patch_npdm(exefs[1].data, npdm_patch);
 
-        nca_entries.emplace_back(
+        out.nca_entries.emplace_back(
             create_program_nca(tid, keys, exefs, romfs, logo)
         );
     } else {
-        nca_entries.emplace_back(
+        out.nca_entries.emplace_back(
             BufHelper{config.program_nca}, NcmContentType_Program
         );
     }
 
     // create control
     {
-        pbox->NewTransfer("Creating Control"_i18n).UpdateTransfer(1, 8);
         // patch nacp
         NcapPatch nacp_patch{};
         nacp_patch.tid = tid;
@@ -919,34 +929,32 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
         add_file_entry(romfs, "/control.nacp", &config.nacp, sizeof(config.nacp));
         add_file_entry(romfs, "/icon_AmericanEnglish.dat", config.icon);
 
-        nca_entries.emplace_back(
+        out.nca_entries.emplace_back(
             create_control_nca(tid, keys, romfs)
         );
     }
 
     // create meta
-    NcmContentMetaHeader content_meta_header;
-    NcmContentMetaKey content_meta_key;
-    ncm::ContentStorageRecord content_storage_record;
-    NcmContentMetaData content_meta_data;
     {
-        pbox->NewTransfer("Creating Meta"_i18n).UpdateTransfer(2, 8);
-        const auto meta_entry = create_meta_nca(tid, keys, storage_id, nca_entries);
+        auto meta_entry = create_meta_nca(tid, keys, storage_id, out.nca_entries);
 
-        nca_entries.emplace_back(meta_entry.nca_entry);
-        content_meta_header = meta_entry.content_meta_header;
-        content_meta_key = meta_entry.content_meta_key;
-        content_storage_record = meta_entry.content_storage_record;
-        content_meta_data = meta_entry.content_meta_data;
+        out.nca_entries.emplace_back(std::move(meta_entry.nca_entry));
+        out.content_meta_key = meta_entry.content_meta_key;
+        out.content_storage_record = meta_entry.content_storage_record;
+        out.content_meta_data = meta_entry.content_meta_data;
     }
 
+    R_SUCCEED();
+}
+
+auto install_built_forwarder(ui::ProgressBox* pbox, NcmStorageId storage_id, BuiltForwarder& forwarder) -> Result {
     // write ncas
     {
         NcmContentStorage cs;
         R_TRY(ncmOpenContentStorage(&cs, storage_id));
         ON_SCOPE_EXIT(ncmContentStorageClose(&cs));
 
-        for (const auto& nca : nca_entries) {
+        for (const auto& nca : forwarder.nca_entries) {
             pbox->NewTransfer("Writing Nca"_i18n).UpdateTransfer(3, 8);
             NcmContentId content_id;
             NcmPlaceHolderId placeholder_id;
@@ -954,7 +962,21 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
             R_TRY(ncmContentStorageGeneratePlaceHolderId(&cs, &placeholder_id));
             ncmContentStorageDeletePlaceHolder(&cs, &placeholder_id);
             R_TRY(ncmContentStorageCreatePlaceHolder(&cs, &content_id, &placeholder_id, nca.data.size()));
-            R_TRY(ncmContentStorageWritePlaceHolder(&cs, &placeholder_id, 0, nca.data.data(), nca.data.size()));
+
+            // written in chunks, rather than the whole nca in one ipc call.
+            R_TRY(thread::Transfer(pbox, nca.data.size(),
+                [&nca](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+                    size = std::min<s64>(size, nca.data.size() - off);
+                    std::memcpy(data, nca.data.data() + off, size);
+                    *bytes_read = size;
+                    R_SUCCEED();
+                },
+                [&cs, &placeholder_id](const void* data, s64 off, s64 size) -> Result {
+                    return ncmContentStorageWritePlaceHolder(&cs, &placeholder_id, off, data, size);
+                },
+                thread::Mode::SingleThreadedIfSmaller
+            ));
+
             ncmContentStorageDelete(&cs, &content_id);
             R_TRY(ncmContentStorageRegister(&cs, &content_id, &placeholder_id));
         }
@@ -967,7 +989,7 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
         R_TRY(ncmOpenContentMetaDatabase(&db, storage_id));
         ON_SCOPE_EXIT(ncmContentMetaDatabaseClose(&db));
 
-        R_TRY(ncmContentMetaDatabaseSet(&db, &content_meta_key, &content_meta_data, sizeof(content_meta_data)));
+        R_TRY(ncmContentMetaDatabaseSet(&db, &forwarder.content_meta_key, &forwarder.content_meta_data, sizeof(forwarder.content_meta_data)));
         R_TRY(ncmContentMetaDatabaseCommit(&db));
     }
 
@@ -976,18 +998,136 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
         pbox->NewTransfer("Pushing application record"_i18n).UpdateTransfer(5, 8);
 
         // remove old id for forwarders.
-        const auto rc = nsDeleteApplicationCompletely(old_tid);
+        const auto rc = nsDeleteApplicationCompletely(forwarder.old_tid);
         if (R_FAILED(rc) && rc != 0x410) { // not found
             App::Notify("Failed to remove old forwarder, please manually remove it!"_i18n);
         }
 
         // remove previous ncas.
-        nsDeleteApplicationEntity(tid);
+        nsDeleteApplicationEntity(forwarder.tid);
 
-        R_TRY(ns::PushApplicationRecord(tid, &content_storage_record, 1));
+        R_TRY(ns::PushApplicationRecord(forwarder.tid, &forwarder.content_storage_record, 1));
 
         // force flush.
-        ns::InvalidateApplicationControlCache(tid);
+        ns::InvalidateApplicationControlCache(forwarder.tid);
+    }
+
+    R_SUCCEED();
+}
+
+// forwarders are built by tasks, at most this many ahead of the one being
+// installed, whilst the installs are done in order on the pbox thread.
+constexpr u32 BATCH_BUILD_AHEAD = 4;
+
+struct BatchState {
+    std::span<OwoConfig> configs;
+    const keys::Keys* keys;
+    NcmStorageId storage_id;
+    // indexed by config, shared with the other configs that have the same logo.
+    std::vector<std::shared_ptr<const Pfs0Section>> logos;
+
+    Mutex mutex;
+    CondVar can_install;
+    std::vector<BuiltForwarder> built;
+    std::vector<Result> results;
+    std::vector<u8> done;
+    std::atomic_bool exit;
+};
+
+void batch_build(BatchState& state, u32 i) {
+    BuiltForwarder forwarder{};
+    Result rc = Result_OwoBadArgs;
+    if (!state.exit) {
+        rc = build_forwarder(*state.keys, state.configs[i], state.storage_id, state.logos[i].get(), forwarder);
+    }
+
+    SCOPED_MUTEX(&state.mutex);
+    state.built[i] = std::move(forwarder);
+    state.results[i] = rc;
+    state.done[i] = true;
+    condvarWakeAll(&state.can_install);
+}
+
+auto install_forwaders_internal(ui::ProgressBox* pbox, std::span<OwoConfig> configs, NcmStorageId storage_id, const OnForwarderInstalled& on_installed) -> Result {
+    R_UNLESS(!configs.empty(), Result_OwoBadArgs);
+
+    R_TRY(splCryptoInitialize());
+    ON_SCOPE_EXIT(splCryptoExit());
+
+    R_TRY(ncmInitialize());
+    ON_SCOPE_EXIT(ncmExit());
+
+    R_TRY(ns::Initialize());
+    ON_SCOPE_EXIT(ns::Exit());
+
+    // shared by all forwarders.
+    keys::Keys keys;
+    R_TRY(keys::parse_keys(keys, false));
+
+    BatchState state{};
+    state.configs = configs;
+    state.keys = &keys;
+    state.storage_id = storage_id;
+    state.built.resize(configs.size());
+    state.results.resize(configs.size());
+    state.done.resize(configs.size());
+    mutexInit(&state.mutex);
+    condvarInit(&state.can_install);
+
+    // the logo section is usually the same for every forwarder, so only built once.
+    pbox->NewTransfer("Creating Program"_i18n).UpdateTransfer(0, 8);
+    for (const auto& config : configs) {
+        const auto it = std::ranges::find_if(configs.first(state.logos.size()), [&config](auto& e) {
+            return e.logo == config.logo && e.gif == config.gif;
+        });
+
+        if (it != configs.begin() + state.logos.size()) {
+            state.logos.emplace_back(state.logos[it - configs.begin()]);
+        } else {
+            state.logos.emplace_back(build_logo_section(config));
+        }
+    }
+
+    // declared after the state, so that the tasks finish before it's freed.
+    utils::task::Group group;
+    ON_SCOPE_EXIT(
+        state.exit = true;
+        group.Wait();
+    );
+
+    const auto push_build = [&state, &group](u32 i) {
+        if (i < state.configs.size()) {
+            group.Push([&state, i]() { batch_build(state, i); });
+        }
+    };
+
+    for (u32 i = 0; i < BATCH_BUILD_AHEAD; i++) {
+        push_build(i);
+    }
+
+    for (u32 i = 0; i < configs.size(); i++) {
+        auto& config = configs[i];
+        pbox->SetTitle(config.name);
+        pbox->SetImageDataConst(config.icon);
+        pbox->NewTransfer("Creating Meta"_i18n).UpdateTransfer(2, 8);
+
+        {
+            SCOPED_MUTEX(&state.mutex);
+            while (!state.done[i]) {
+                R_TRY(pbox->ShouldExitResult());
+                condvarWaitTimeout(&state.can_install, &state.mutex, 1e+8);
+            }
+        }
+
+        R_TRY(state.results[i]);
+        push_build(i + BATCH_BUILD_AHEAD);
+        R_TRY(install_built_forwarder(pbox, storage_id, state.built[i]));
+
+        if (on_installed) {
+            on_installed(config);
+        }
+
+        state.built[i] = {};
     }
 
     R_SUCCEED();
@@ -996,7 +1136,13 @@ auto install_forwader_internal(ui::ProgressBox* pbox, OwoConfig& config, NcmStor
 } // namespace
 
 auto install_forwarder(ui::ProgressBox* pbox, OwoConfig& config, NcmStorageId storage_id) -> Result {
-    return install_forwader_internal(pbox, config, storage_id);
+    pbox->SetTitle(config.name);
+    pbox->SetImageDataConst(config.icon);
+    return install_forwaders_internal(pbox, {&config, 1}, storage_id, {});
+}
+
+auto install_forwarders(ui::ProgressBox* pbox, std::span<OwoConfig> configs, NcmStorageId storage_id, const OnForwarderInstalled& on_installed) -> Result {
+    return install_forwaders_internal(pbox, configs, storage_id, on_installed);
 }
 
 auto install_forwarder(OwoConfig& config, NcmStorageId storage_id) -> Result {
@@ -0,0 +1,613 @@
+#include "search_index.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include "utils/thread.hpp"
+#include "utils/path_index.hpp"
+
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cctype>
+#include <strings.h>
+#include <algorithm>
+#include <span>
+#include <type_traits>
+
+namespace sphaira::search {
+namespace {
+
+constexpr fs::FsPath CACHE_PATH{"/switch/sphaira/cache/search"};
+constexpr fs::FsPath INDEX_PATH{"/switch/sphaira/cache/search/index.bin"};
+constexpr u32 INDEX_MAGIC = 0x58444953; // SIDX
+constexpr u32 INDEX_VERSION = 1;
+
+// trigrams are hashed into this many buckets, collisions are fine as
+// every candidate is checked against the query anyway.
+constexpr u32 BUCKET_COUNT = 1 << 16;
+// stops the index from using too much memory on huge drives.
+constexpr u32 MAX_NODES = 1024 * 512;
+constexpr u32 DIR_READ_BATCH = 256;
+constexpr u32 NO_PARENT = ~0U;
+
+struct Node {
+    u32 name_off;
+    u32 parent;
+    // range of child nodes, dirs only.
+    u32 first_child;
+    u32 child_count;
+    // size for files, modified time for dirs (0 if unknown).
+    s64 value;
+    u8 type;
+    u8 pad[7];
+};
+static_assert(sizeof(Node) == 0x20);
+
+struct Header {
+    u32 magic;
+    u32 version;
+    u32 node_count;
+    u32 names_size;
+    u32 postings_size;
+    u32 reserved[3];
+};
+
+struct Index {
+    auto GetName(u32 i) const -> const char* {
+        return names.data() + nodes[i].name_off;
+    }
+
+    auto IsDir(u32 i) const -> bool {
+        return nodes[i].type == FsDirEntryType_Dir;
+    }
+
+    auto AddNode(const char* name, u32 parent, u8 type, s64 value) -> u32 {
+        const auto id = nodes.size();
+        nodes.emplace_back(Node{(u32)names.size(), parent, 0, 0, value, type});
+        names.insert(names.end(), name, name + std::strlen(name) + 1);
+        return id;
+    }
+
+    auto GetPath(u32 i) const -> fs::FsPath;
+    void BuildPostings();
+    auto Serialise() const -> std::vector<u8>;
+    bool Deserialise(std::span<const u8> data);
+
+    std::vector<Node> nodes{};
+    std::vector<char> names{};
+    // node ids for each bucket, delta encoded as varints.
+    std::vector<u32> bucket_off{};
+    std::vector<u32> bucket_count{};
+    std::vector<u8> postings{};
+};
+
+struct ThreadData {
+    Thread thread{};
+    Mutex mutex{};
+    CondVar cond{};
+    // the current index, replaced once a walk finishes.
+    std::shared_ptr<const Index> index{};
+    bool rescan{};
+    std::atomic_bool indexing{};
+    std::atomic_bool stop{};
+};
+
+std::unique_ptr<ThreadData> g_data{};
+
+auto fold(char c) -> char {
+    return std::tolower((u8)c);
+}
+
+auto hash_trigram(char a, char b, char c) -> u32 {
+    const u32 v = (u8)a << 16 | (u8)b << 8 | (u8)c;
+    return (v * 2654435761U) >> 16;
+}
+
+template<typename F>
+void for_each_trigram(const char* name, F&& func) {
+    const auto len = std::strlen(name);
+    for (size_t i = 0; i + 2 < len; i++) {
+        func(hash_trigram(fold(name[i]), fold(name[i + 1]), fold(name[i + 2])));
+    }
+}
+
+auto varint_size(u32 v) -> u32 {
+    u32 size = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        size++;
+    }
+    return size;
+}
+
+auto varint_write(u8* out, u32 v) -> u32 {
+    u32 size = 0;
+    while (v >= 0x80) {
+        out[size++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    out[size++] = v;
+    return size;
+}
+
+auto varint_read(const u8*& in, const u8* end) -> u32 {
+    u32 v = 0;
+    for (u32 shift = 0; in < end && shift < 32; shift += 7) {
+        const auto b = *in++;
+        v |= (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    return v;
+}
+
+// query must already be folded.
+auto contains_folded(const char* name, std::string_view query) -> bool {
+    const auto len = std::strlen(name);
+    if (len < query.length()) {
+        return false;
+    }
+
+    for (size_t i = 0; i + query.length() <= len; i++) {
+        size_t j = 0;
+        while (j < query.length() && fold(name[i + j]) == query[j]) {
+            j++;
+        }
+
+        if (j == query.length()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto Index::GetPath(u32 i) const -> fs::FsPath {
+    u32 chain[FS_MAX_PATH / 2];
+    u32 depth = 0;
+
+    for (auto id = i; id != NO_PARENT && depth < std::size(chain); id = nodes[id].parent) {
+        chain[depth++] = id;
+    }
+
+    std::string path;
+    while (depth--) {
+        if (!path.empty() && !path.ends_with('/')) {
+            path += '/';
+        }
+        path += GetName(chain[depth]);
+    }
+
+    return path;
+}
+
+// done in 2 passes so that the postings can be written in place, the first
+// pass works out the size of each bucket.
+void Index::BuildPostings() {
+    std::vector<u32> last(BUCKET_COUNT, NO_PARENT);
+    std::vector<u32> sizes(BUCKET_COUNT);
+    bucket_count.assign(BUCKET_COUNT, 0);
+
+    const auto add = [&last](u32 bucket, u32 id) -> u32 {
+        const auto prev = last[bucket];
+        last[bucket] = id;
+        return prev == NO_PARENT ? id : id - prev;
+    };
+
+    for (u32 i = 0; i < nodes.size(); i++) {
+        for_each_trigram(GetName(i), [&](u32 bucket) {
+            // same trigram more than once in a name.
+            if (last[bucket] == i) {
+                return;
+            }
+
+            sizes[bucket] += varint_size(add(bucket, i));
+            bucket_count[bucket]++;
+        });
+    }
+
+    bucket_off.resize(BUCKET_COUNT + 1);
+    bucket_off[0] = 0;
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        bucket_off[i + 1] = bucket_off[i] + sizes[i];
+    }
+
+    postings.resize(bucket_off[BUCKET_COUNT]);
+    std::ranges::fill(last, NO_PARENT);
+    std::ranges::copy(bucket_off.begin(), bucket_off.end() - 1, sizes.begin());
+
+    for (u32 i = 0; i < nodes.size(); i++) {
+        for_each_trigram(GetName(i), [&](u32 bucket) {
+            if (last[bucket] == i) {
+                return;
+            }
+
+            sizes[bucket] += varint_write(postings.data() + sizes[bucket], add(bucket, i));
+        });
+    }
+}
+
+auto Index::Serialise() const -> std::vector<u8> {
+    const Header header{INDEX_MAGIC, INDEX_VERSION, (u32)nodes.size(), (u32)names.size(), (u32)postings.size()};
+
+    std::vector<u8> out;
+    const auto append = [&out](const void* data, size_t size) {
+        out.insert(out.end(), (const u8*)data, (const u8*)data + size);
+    };
+
+    append(&header, sizeof(header));
+    append(nodes.data(), nodes.size() * sizeof(Node));
+    append(names.data(), names.size());
+    append(bucket_off.data(), bucket_off.size() * sizeof(u32));
+    append(bucket_count.data(), bucket_count.size() * sizeof(u32));
+    append(postings.data(), postings.size());
+    return out;
+}
+
+bool Index::Deserialise(std::span<const u8> data) {
+    Header header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION || header.node_count > MAX_NODES) {
+        return false;
+    }
+
+    const u64 expected = sizeof(header) + (u64)header.node_count * sizeof(Node) + header.names_size + (BUCKET_COUNT * 2 + 1) * sizeof(u32) + header.postings_size;
+    if (data.size() != expected) {
+        return false;
+    }
+
+    auto ptr = data.data() + sizeof(header);
+    const auto read = [&ptr](auto& vec, size_t count) {
+        using T = typename std::remove_reference_t<decltype(vec)>::value_type;
+        vec.resize(count);
+        std::memcpy(vec.data(), ptr, count * sizeof(T));
+        ptr += count * sizeof(T);
+    };
+
+    read(nodes, header.node_count);
+    read(names, header.names_size);
+    read(bucket_off, BUCKET_COUNT + 1);
+    read(bucket_count, BUCKET_COUNT);
+    read(postings, header.postings_size);
+
+    // validate everything that is used as an offset.
+    if (!names.empty() && names.back() != '\0') {
+        return false;
+    }
+
+    for (u32 i = 0; i < nodes.size(); i++) {
+        const auto& n = nodes[i];
+        if (n.name_off >= names.size() || (n.parent != NO_PARENT && n.parent >= nodes.size())) {
+            return false;
+        }
+        if (n.first_child > nodes.size() || n.child_count > nodes.size() - n.first_child) {
+            return false;
+        }
+    }
+
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        if (bucket_off[i] > bucket_off[i + 1] || bucket_off[i + 1] > postings.size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct Root {
+    fs::FsPath path;
+    std::unique_ptr<fs::Fs> fs;
+};
+
+auto get_roots() -> std::vector<Root> {
+    std::vector<Root> roots;
+    roots.emplace_back("/", std::make_unique<fs::FsNativeSd>());
+
+    const auto buf = App::GetConfigStore().GetString("search", "roots", "");
+
+    std::string_view view{buf};
+    while (!view.empty()) {
+        const auto end = view.find(',');
+        auto root = view.substr(0, end);
+        view = end == view.npos ? std::string_view{} : view.substr(end + 1);
+
+        while (root.starts_with(' ')) {
+            root.remove_prefix(1);
+        }
+
+        if (!root.empty() && root.find(':') != root.npos) {
+            const fs::FsPath path{root};
+            roots.emplace_back(path, std::make_unique<fs::FsStdio>(true, path));
+        }
+    }
+
+    return roots;
+}
+
+// walks the dirs breadth first, so that the children of a dir are stored
+// next to each other and can be copied from the old index if the dir's
+// modified time hasn't changed.
+void walk_root(ThreadData* data, const Index* old, const utils::PathIndex& old_dirs, Root& root, Index& out) {
+    std::deque<u32> pending;
+    pending.emplace_back(out.AddNode(root.path, NO_PARENT, FsDirEntryType_Dir, 0));
+
+    std::vector<FsDirectoryEntry> batch(DIR_READ_BATCH);
+    u32 reused{}, read{};
+
+    while (!pending.empty() && !data->stop && out.nodes.size() < MAX_NODES) {
+        const auto id = pending.front();
+        pending.pop_front();
+
+        const auto path = out.GetPath(id);
+        FsTimeStampRaw ts{};
+        s64 mtime{};
+        if (R_SUCCEEDED(root.fs->GetFileTimeStampRaw(path, &ts)) && ts.is_valid) {
+            mtime = ts.modified;
+        }
+
+        out.nodes[id].value = mtime;
+        out.nodes[id].first_child = out.nodes.size();
+
+        const auto add_child = [&](const char* name, u8 type, s64 value) {
+            if (name[0] == '.' || out.nodes.size() >= MAX_NODES) {
+                return;
+            }
+
+            // the sd card nintendo folder only contains encrypted data.
+            if (root.fs->IsNative() && out.nodes[id].parent == NO_PARENT && !strcasecmp(name, "Nintendo")) {
+                return;
+            }
+
+            const auto child = out.AddNode(name, id, type, type == FsDirEntryType_Dir ? 0 : value);
+            if (type == FsDirEntryType_Dir) {
+                pending.emplace_back(child);
+            }
+        };
+
+        u32 old_id;
+        if (mtime && old && old_dirs.Find(path.s, old_id) && old->nodes[old_id].value == mtime) {
+            const auto& old_node = old->nodes[old_id];
+            for (u32 i = 0; i < old_node.child_count; i++) {
+                const auto c = old_node.first_child + i;
+                add_child(old->GetName(c), old->nodes[c].type, old->nodes[c].value);
+            }
+            reused++;
+        } else {
+            fs::Dir d;
+            if (R_SUCCEEDED(root.fs->OpenDirectory(path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &d))) {
+                s64 total;
+                while (!data->stop && R_SUCCEEDED(d.Read(&total, batch.size(), batch.data())) && total) {
+                    for (s64 i = 0; i < total; i++) {
+                        add_child(batch[i].name, batch[i].type, batch[i].file_size);
+                    }
+
+                    if (total < (s64)batch.size()) {
+                        break;
+                    }
+                }
+            }
+            read++;
+        }
+
+        out.nodes[id].child_count = out.nodes.size() - out.nodes[id].first_child;
+    }
+
+    if (out.nodes.size() >= MAX_NODES) {
+        log_write("[SEARCH] hit max entries whilst indexing: %s\n", root.path.s);
+    }
+
+    log_write("[SEARCH] indexed %s, read %u dirs, reused %u dirs\n", root.path.s, read, reused);
+}
+
+void build_index(ThreadData* data) {
+    std::shared_ptr<const Index> old;
+    {
+        SCOPED_MUTEX(&data->mutex);
+        old = data->index;
+    }
+
+    TimeStamp ts;
+
+    // map the dirs of the old index so that unchanged dirs can be found.
+    utils::PathIndex old_dirs;
+    if (old) {
+        for (u32 i = 0; i < old->nodes.size(); i++) {
+            if (old->IsDir(i)) {
+                old_dirs.Add(old->GetPath(i).s, i);
+            }
+        }
+    }
+
+    auto index = std::make_shared<Index>();
+    auto roots = get_roots();
+    for (auto& root : roots) {
+        walk_root(data, old.get(), old_dirs, root, *index);
+    }
+
+    if (data->stop) {
+        return;
+    }
+
+    index->BuildPostings();
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursively(CACHE_PATH);
+    if (R_FAILED(fs.write_entire_file(INDEX_PATH, index->Serialise()))) {
+        log_write("[SEARCH] failed to save index\n");
+    }
+
+    log_write("[SEARCH] index has %zu entries, %zu bytes of postings, time taken: %.2fs\n", index->nodes.size(), index->postings.size(), ts.GetSecondsD());
+
+    SCOPED_MUTEX(&data->mutex);
+    data->index = std::move(index);
+}
+
+void load_index(ThreadData* data) {
+    std::vector<u8> buf;
+    fs::FsNativeSd fs;
+    if (R_FAILED(fs.read_entire_file(INDEX_PATH, buf))) {
+        return;
+    }
+
+    auto index = std::make_shared<Index>();
+    if (!index->Deserialise(buf)) {
+        log_write("[SEARCH] saved index is invalid, ignoring\n");
+        return;
+    }
+
+    SCOPED_MUTEX(&data->mutex);
+    data->index = std::move(index);
+}
+
+void thread_func(void* arg) {
+    auto data = static_cast<ThreadData*>(arg);
+    load_index(data);
+
+    while (!data->stop) {
+        data->indexing = true;
+        build_index(data);
+        data->indexing = false;
+
+        SCOPED_MUTEX(&data->mutex);
+        while (!data->rescan && !data->stop) {
+            condvarWait(&data->cond, &data->mutex);
+        }
+        data->rescan = false;
+    }
+}
+
+} // namespace
+
+void Init() {
+    if (g_data || !App::GetConfigStore().GetBool("search", "enabled", true)) {
+        return;
+    }
+
+    auto data = std::make_unique<ThreadData>();
+    mutexInit(&data->mutex);
+    condvarInit(&data->cond);
+
+    if (R_FAILED(utils::CreateThread(&data->thread, thread_func, data.get(), utils::ThreadRole::Background, 1024 * 64))) {
+        log_write("[SEARCH] failed to create thread\n");
+        return;
+    }
+
+    if (R_FAILED(threadStart(&data->thread))) {
+        log_write("[SEARCH] failed to start thread\n");
+        threadClose(&data->thread);
+        return;
+    }
+
+    g_data = std::move(data);
+}
+
+void ExitSignal() {
+    if (g_data) {
+        SCOPED_MUTEX(&g_data->mutex);
+        g_data->stop = true;
+        condvarWakeAll(&g_data->cond);
+    }
+}
+
+void Exit() {
+    if (!g_data) {
+        return;
+    }
+
+    ExitSignal();
+    threadWaitForExit(&g_data->thread);
+    threadClose(&g_data->thread);
+    g_data.reset();
+}
+
+void Rescan() {
+    if (g_data) {
+        SCOPED_MUTEX(&g_data->mutex);
+        g_data->rescan = true;
+        condvarWakeAll(&g_data->cond);
+    }
+}
+
+Result Find(std::string_view query, u32 max, std::vector<Match>& out) {
+    out.clear();
+    if (!g_data || query.empty()) {
+        R_SUCCEED();
+    }
+
+    std::shared_ptr<const Index> index;
+    {
+        SCOPED_MUTEX(&g_data->mutex);
+        index = g_data->index;
+    }
+
+    if (!index) {
+        R_SUCCEED();
+    }
+
+    std::string folded{query};
+    for (auto& c : folded) {
+        c = fold(c);
+    }
+
+    const auto check = [&](u32 id) -> bool {
+        // the roots themselves are not results.
+        if (index->nodes[id].parent != NO_PARENT && contains_folded(index->GetName(id), folded)) {
+            const auto& n = index->nodes[id];
+            out.emplace_back(index->GetPath(id), n.type == FsDirEntryType_Dir ? 0 : n.value, n.type == FsDirEntryType_Dir);
+        }
+        return out.size() < max;
+    };
+
+    if (folded.length() < 3) {
+        for (u32 i = 0; i < index->nodes.size(); i++) {
+            if (!check(i)) {
+                break;
+            }
+        }
+        R_SUCCEED();
+    }
+
+    // only the smallest bucket is needed, as every candidate is checked.
+    u32 best = 0;
+    u32 best_count = ~0U;
+    for_each_trigram(folded.c_str(), [&](u32 bucket) {
+        if (index->bucket_count[bucket] < best_count) {
+            best = bucket;
+            best_count = index->bucket_count[bucket];
+        }
+    });
+
+    auto ptr = index->postings.data() + index->bucket_off[best];
+    const auto end = index->postings.data() + index->bucket_off[best + 1];
+    u32 id = 0;
+    for (u32 i = 0; i < best_count && ptr < end; i++) {
+        id += varint_read(ptr, end);
+        if (id >= index->nodes.size() || !check(id)) {
+            break;
+        }
+    }
+
+    R_SUCCEED();
+}
+
+auto GetStats() -> Stats {
+    Stats stats{};
+    if (g_data) {
+        SCOPED_MUTEX(&g_data->mutex);
+        if (g_data->index) {
+            stats.entries = g_data->index->nodes.size();
+        }
+        stats.indexing = g_data->indexing;
+    }
+
+    return stats;
+}
+
+} // namespace sphaira::search
@@ -1,14 +1,23 @@
 #include "threaded_file_transfer.hpp"
 #include "log.hpp"
+#include "i18n.hpp"
 #include "defines.hpp"
 #include "app.hpp"
 #include "minizip_helper.hpp"
+#include "transfer_tune.hpp"
 #include "utils/thread.hpp"
+#include "utils/utils.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/ring_buf.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/mem_track.hpp"
+#include "utils/trace.hpp"
 
 #include <vector>
 #include <algorithm>
 #include <cstring>
 #include <atomic>
+#include <span>
 #include <minizip/unzip.h>
 #include <minizip/zip.h>
 
@@ -19,61 +28,63 @@ namespace {
 constexpr u64 SMALL_BUFFER_SIZE = 1024 * 512;
 // used for everything else.
 constexpr u64 NORMAL_BUFFER_SIZE = 1024*1024*4;
+// default number of buffers queued between each thread.
+constexpr u32 DEFAULT_SLOT_COUNT = 2;
+// max number of buffers that adaptive mode can grow the queue to.
+constexpr u32 MAX_SLOT_COUNT = 8;
+// in applet mode, shrink the queue if the free heap drops below this many buffers.
+constexpr u32 LOW_MEMORY_SLOT_COUNT = 4;
+// default number of read threads used by Mode::ParallelRead.
+constexpr u32 DEFAULT_READER_COUNT = 3;
+// min time between requests on file based emummc.
+constexpr u64 EMUMMC_THROTTLE_NS = 2e+6; // 2ms
+
+// buffers are leased from the shared pool so that back to back transfers
+// reuse the same memory rather than each allocating their own.
+using PoolBuffer = utils::pool::Vector<u8>;
+
+// cached pool blocks can be reused by this transfer, so count them as free.
+auto GetAvailableMemory() -> u64 {
+    return utils::GetFreeHeapSize() + utils::pool::GetStats().cached;
+}
 
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(NORMAL_BUFFER_SIZE);
-    }
+using RingBuf = utils::RingBuf;
 
-    std::vector<u8> buf;
-    s64 off;
+// collected by each stage, converted to StageStats at the end of the transfer.
+struct StageCounter {
+    // total time the stage's threads were running.
+    std::atomic<u64> active_ticks{};
+    std::atomic<u64> blocked_ticks{};
+    std::atomic<u32> waits{};
 };
 
-template<std::size_t Size>
-struct RingBuf {
-private:
-    ThreadBuffer buf[Size]{};
-    unsigned r_index{};
-    unsigned w_index{};
-
-    static_assert((sizeof(RingBuf::buf) & (sizeof(RingBuf::buf) - 1)) == 0, "Must be power of 2!");
-
-public:
-    void ringbuf_reset() {
-        this->r_index = this->w_index;
-    }
-
-    unsigned ringbuf_capacity() const {
-        return sizeof(this->buf) / sizeof(this->buf[0]);
-    }
-
-    unsigned ringbuf_size() const {
-        return (this->w_index - this->r_index) % (ringbuf_capacity() * 2U);
-    }
-
-    unsigned ringbuf_free() const {
-        return ringbuf_capacity() - ringbuf_size();
-    }
-
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
-        auto& value = this->buf[this->w_index % ringbuf_capacity()];
-        value.off = off_in;
-        std::swap(value.buf, buf_in);
+auto ToStageStats(const StageCounter& counter, s64 bytes) -> StageStats {
+    const auto active = counter.active_ticks.load();
+    const auto blocked = std::min(counter.blocked_ticks.load(), active);
 
-        this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
-    }
-
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
-        auto& value = this->buf[this->r_index % ringbuf_capacity()];
-        off_out = value.off;
-        std::swap(value.buf, buf_out);
+    return StageStats{
+        .bytes = bytes,
+        .busy_ns = armTicksToNs(active - blocked),
+        .blocked_ns = armTicksToNs(blocked),
+        .waits = counter.waits.load(),
+    };
+}
 
-        this->r_index = (this->r_index + 1U) % (ringbuf_capacity() * 2U);
-    }
-};
+// format: MiB busy/blocked (waits)
+void LogTransferStats(const TransferStats& stats) {
+    const auto& r = stats.read;
+    const auto& d = stats.decompress;
+    const auto& w = stats.write;
+
+    log_write("[THREAD] took: %.3fs read: %.2f MiB %.3fs/%.3fs (%u) decompress: %.2f MiB %.3fs/%.3fs (%u) write: %.2f MiB %.3fs/%.3fs (%u)\n",
+        stats.elapsed_ns / 1e+9,
+        r.bytes / 1024.0 / 1024.0, r.busy_ns / 1e+9, r.blocked_ns / 1e+9, r.waits,
+        d.bytes / 1024.0 / 1024.0, d.busy_ns / 1e+9, d.blocked_ns / 1e+9, d.waits,
+        w.bytes / 1024.0 / 1024.0, w.busy_ns / 1e+9, w.blocked_ns / 1e+9, w.waits);
+}
 
 struct ThreadData {
-    ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size);
+    ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, const PipelineConfig& config, u32 reader_count);
 
     auto GetResults() volatile -> Result;
     void WakeAllThreads();
@@ -115,7 +126,11 @@ struct ThreadData {
     }
 
     void SetReadResult(Result result) {
-        read_result = result;
+        // only store errors as there may be multiple read threads,
+        // a thread finishing successfully must not clear the error of another.
+        if (R_FAILED(result)) {
+            read_result = result;
+        }
 
         // wake up decompress thread as it may be waiting on data that never comes.
         condvarWakeOne(std::addressof(can_decompress));
@@ -139,12 +154,25 @@ struct ThreadData {
     void SetWriteResult(Result result) {
         write_result = result;
 
+        // wake up read thread if it's handing buffers directly to us.
+        if (!has_decompress) {
+            condvarWakeAll(std::addressof(can_read));
+        }
+
         // wake up decompress thread as it may be waiting on data that never comes.
         condvarWakeOne(std::addressof(can_decompress_write));
 
         ueventSignal(GetDoneEvent());
     }
 
+    auto GetStats() const -> TransferStats {
+        return TransferStats{
+            .read = ToStageStats(read_stage, read_offset),
+            .decompress = ToStageStats(decompress_stage, decompress_offset),
+            .write = ToStageStats(write_stage, write_offset),
+        };
+    }
+
     void SetPullResult(Result result) {
         pull_result = result;
         if (R_FAILED(result)) {
@@ -154,19 +182,29 @@ struct ThreadData {
 
     Result Pull(void* data, s64 size, u64* bytes_read);
     Result readFuncInternal();
+    Result readParallelFuncInternal();
     Result decompressFuncInternal();
     Result writeFuncInternal();
 
 private:
-    Result SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size);
-    Result GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out);
-    Result SetWriteBuf(std::vector<u8>& buf, s64 size);
-    Result GetWriteBuf(std::vector<u8>& buf_out, s64& off_out);
-    Result SetPullBuf(std::vector<u8>& buf, s64 size);
+    Result SetDecompressBuf(PoolBuffer& buf, s64 off, s64 size);
+    // same as above, but waits until all data before off has been queued.
+    Result SetDecompressBufOrdered(PoolBuffer& buf, s64 off, s64 size, bool eof);
+    Result GetDecompressBuf(PoolBuffer& buf_out, s64& off_out);
+    Result SetWriteBuf(PoolBuffer& buf, s64 size);
+    Result GetWriteBuf(PoolBuffer& buf_out, s64& off_out);
+    Result SetPullBuf(PoolBuffer& buf, s64 size);
     Result GetPullBuf(void* data, s64 size, u64* bytes_read);
 
     Result Read(void* buf, s64 size, u64* bytes_read);
 
+    // same as condvarWait(), but records the time blocked against the stage.
+    Result WaitStage(CondVar* var, Mutex* mutex, StageCounter& stage);
+
+    // called with the queue's mutex locked.
+    void GrowQueue(RingBuf& ring);
+    void ShrinkQueueIfLowMemory(RingBuf& ring);
+
 private:
     // these need to be copied
     ui::ProgressBox* const pbox;
@@ -185,6 +223,9 @@ private:
     CondVar can_decompress{};
     CondVar can_decompress_write{};
 
+    // only used when reading in parallel.
+    CondVar can_commit{};
+
     // only used when pull is active.
     CondVar can_pull{};
     CondVar can_pull_write{};
@@ -194,37 +235,62 @@ private:
     UEvent m_uevent_decompress_progress{};
     UEvent m_uevent_write_progress{};
 
-    RingBuf<2> read_buffers{};
-    RingBuf<2> write_buffers{};
+    RingBuf read_buffers;
+    RingBuf write_buffers;
 
-    std::vector<u8> pull_buffer{};
+    PoolBuffer pull_buffer{};
     s64 pull_buffer_offset{};
 
+    // next offset to be read, claimed by each read thread.
+    std::atomic<s64> next_read_offset{};
+    // offset of the next chunk to be queued, protected by read_mutex.
+    s64 commit_offset{};
+    // set to the end of the data if a read thread hit eof early.
+    s64 read_end;
+
     const u64 read_buffer_size;
     const s64 write_size;
+    const bool adaptive;
+    const bool is_applet;
+    // if false, the read thread hands buffers straight to the write thread.
+    const bool has_decompress;
 
     // these are shared between threads
     std::atomic<s64> read_offset{};
     std::atomic<s64> decompress_offset{};
     std::atomic<s64> write_offset{};
 
+    StageCounter read_stage{};
+    StageCounter decompress_stage{};
+    StageCounter write_stage{};
+
     std::atomic<Result> read_result{};
     std::atomic<Result> decompress_result{};
     std::atomic<Result> write_result{};
     std::atomic<Result> pull_result{};
 
     std::atomic_bool read_running{true};
+    std::atomic<u32> active_readers;
     std::atomic_bool decompress_running{true};
     std::atomic_bool write_running{true};
 };
 
-ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, u64 buffer_size)
+ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rfunc, const DecompressCallback& _dfunc, const WriteCallback& _wfunc, const PipelineConfig& config, u32 reader_count)
 : pbox{_pbox}
 , rfunc{_rfunc}
 , dfunc{_dfunc}
 , wfunc{_wfunc}
-, read_buffer_size{buffer_size}
-, write_size{size} {
+, read_buffers{config.slot_count, config.adaptive ? MAX_SLOT_COUNT : config.slot_count}
+, write_buffers{config.slot_count, config.adaptive ? MAX_SLOT_COUNT : config.slot_count}
+, read_end{size}
+, read_buffer_size{config.slot_size}
+, write_size{size}
+, adaptive{config.adaptive}
+, is_applet{App::IsApplet()}
+, has_decompress{_dfunc != nullptr}
+, active_readers{reader_count} {
+    decompress_running = has_decompress;
+
     mutexInit(std::addressof(read_mutex));
     mutexInit(std::addressof(write_mutex));
     mutexInit(std::addressof(pull_mutex));
@@ -233,6 +299,7 @@ ThreadData::ThreadData(ui::ProgressBox* _pbox, s64 size, const ReadCallback& _rf
     condvarInit(std::addressof(can_decompress));
     condvarInit(std::addressof(can_decompress_write));
     condvarInit(std::addressof(can_write));
+    condvarInit(std::addressof(can_commit));
 
     condvarInit(std::addressof(can_pull));
     condvarInit(std::addressof(can_pull_write));
@@ -257,6 +324,7 @@ void ThreadData::WakeAllThreads() {
     condvarWakeAll(std::addressof(can_write));
     condvarWakeAll(std::addressof(can_decompress));
     condvarWakeAll(std::addressof(can_decompress_write));
+    condvarWakeAll(std::addressof(can_commit));
     condvarWakeAll(std::addressof(can_pull));
     condvarWakeAll(std::addressof(can_pull_write));
 
@@ -265,15 +333,55 @@ void ThreadData::WakeAllThreads() {
     mutexUnlock(std::addressof(pull_mutex));
 }
 
-Result ThreadData::SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
+Result ThreadData::WaitStage(CondVar* var, Mutex* mutex, StageCounter& stage) {
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT(
+        stage.blocked_ticks += armGetSystemTick() - start;
+        stage.waits++;
+    );
+
+    return condvarWait(var, mutex);
+}
+
+void ThreadData::GrowQueue(RingBuf& ring) {
+    if (!adaptive || ring.ringbuf_capacity() >= ring.ringbuf_max_capacity()) {
+        return;
+    }
+
+    if (is_applet && GetAvailableMemory() < read_buffer_size * LOW_MEMORY_SLOT_COUNT) {
+        return;
+    }
+
+    // both queues may grow, so leave room in the budget for the other one.
+    if ((ring.ringbuf_capacity() + 1) * read_buffer_size * 2 > utils::budget::Get(utils::budget::Subsystem_Transfer)) {
+        return;
+    }
+
+    ring.ringbuf_set_capacity(ring.ringbuf_capacity() + 1);
+    log_write("[THREAD] consumer starved, queue grown to: %u\n", ring.ringbuf_capacity());
+}
+
+void ThreadData::ShrinkQueueIfLowMemory(RingBuf& ring) {
+    if (!adaptive || !is_applet || ring.ringbuf_capacity() <= 1) {
+        return;
+    }
+
+    if (GetAvailableMemory() < read_buffer_size * LOW_MEMORY_SLOT_COUNT) {
+        ring.ringbuf_set_capacity(ring.ringbuf_capacity() - 1);
+        log_write("[THREAD] low memory, queue shrunk to: %u\n", ring.ringbuf_capacity());
+    }
+}
+
+Result ThreadData::SetDecompressBuf(PoolBuffer& buf, s64 off, s64 size) {
     buf.resize(size);
 
     mutexLock(std::addressof(read_mutex));
+    ShrinkQueueIfLowMemory(read_buffers);
     if (!read_buffers.ringbuf_free()) {
         if (!write_running) {
             R_SUCCEED();
         }
-        R_TRY(condvarWait(std::addressof(can_read), std::addressof(read_mutex)));
+        R_TRY(WaitStage(std::addressof(can_read), std::addressof(read_mutex), read_stage));
     }
 
     ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
@@ -282,31 +390,79 @@ Result ThreadData::SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
     return condvarWakeOne(std::addressof(can_decompress));
 }
 
-Result ThreadData::GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out) {
+Result ThreadData::SetDecompressBufOrdered(PoolBuffer& buf, s64 off, s64 size, bool eof) {
+    buf.resize(size);
+
+    mutexLock(std::addressof(read_mutex));
+    ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
+
+    if (eof) {
+        read_end = std::min(read_end, off + size);
+        condvarWakeAll(std::addressof(can_commit));
+    }
+
+    // this is the reorder stage, chunks are queued in offset order
+    // regardless of which read thread finished first.
+    while (commit_offset != off) {
+        R_TRY(GetResults());
+
+        // another thread hit eof before this chunk, so drop it.
+        if (off >= read_end) {
+            R_SUCCEED();
+        }
+
+        R_TRY(WaitStage(std::addressof(can_commit), std::addressof(read_mutex), read_stage));
+    }
+
+    ShrinkQueueIfLowMemory(read_buffers);
+    while (!read_buffers.ringbuf_free()) {
+        if (!write_running) {
+            R_SUCCEED();
+        }
+        R_TRY(GetResults());
+        R_TRY(WaitStage(std::addressof(can_read), std::addressof(read_mutex), read_stage));
+    }
+
+    R_TRY(GetResults());
+    read_buffers.ringbuf_push(buf, off);
+    commit_offset += size;
+    condvarWakeAll(std::addressof(can_commit));
+    return condvarWakeOne(std::addressof(can_decompress));
+}
+
+Result ThreadData::GetDecompressBuf(PoolBuffer& buf_out, s64& off_out) {
+    // without a decompress thread, the write thread takes the buffers directly.
+    auto& stage = has_decompress ? decompress_stage : write_stage;
+
     mutexLock(std::addressof(read_mutex));
-    if (!read_buffers.ringbuf_size()) {
+    ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
+
+    // loop as the read thread wakes us when it exits.
+    while (!read_buffers.ringbuf_size()) {
         if (!read_running) {
             buf_out.resize(0);
             R_SUCCEED();
         }
-        R_TRY(condvarWait(std::addressof(can_decompress), std::addressof(read_mutex)));
+        R_TRY(GetResults());
+        GrowQueue(read_buffers);
+        R_TRY(WaitStage(std::addressof(can_decompress), std::addressof(read_mutex), stage));
     }
 
-    ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
     R_TRY(GetResults());
     read_buffers.ringbuf_pop(buf_out, off_out);
     return condvarWakeOne(std::addressof(can_read));
 }
 
-Result ThreadData::SetWriteBuf(std::vector<u8>& buf, s64 size) {
+Result ThreadData::SetWriteBuf(PoolBuffer& buf, s64 size) {
     buf.resize(size);
 
     mutexLock(std::addressof(write_mutex));
+    ShrinkQueueIfLowMemory(write_buffers);
     if (!write_buffers.ringbuf_free()) {
         if (!decompress_running) {
             R_SUCCEED();
         }
-        R_TRY(condvarWait(std::addressof(can_decompress_write), std::addressof(write_mutex)));
+        R_TRY(WaitStage(std::addressof(can_decompress_write), std::addressof(write_mutex), decompress_stage));
     }
 
     ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
@@ -315,14 +471,15 @@ Result ThreadData::SetWriteBuf(std::vector<u8>& buf, s64 size) {
     return condvarWakeOne(std::addressof(can_write));
 }
 
-Result ThreadData::GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
+Result ThreadData::GetWriteBuf(PoolBuffer& buf_out, s64& off_out) {
     mutexLock(std::addressof(write_mutex));
     if (!write_buffers.ringbuf_size()) {
         if (!decompress_running) {
             buf_out.resize(0);
             R_SUCCEED();
         }
-        R_TRY(condvarWait(std::addressof(can_write), std::addressof(write_mutex)));
+        GrowQueue(write_buffers);
+        R_TRY(WaitStage(std::addressof(can_write), std::addressof(write_mutex), write_stage));
     }
 
     ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
@@ -331,12 +488,12 @@ Result ThreadData::GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
     return condvarWakeOne(std::addressof(can_decompress_write));
 }
 
-Result ThreadData::SetPullBuf(std::vector<u8>& buf, s64 size) {
+Result ThreadData::SetPullBuf(PoolBuffer& buf, s64 size) {
     buf.resize(size);
 
     mutexLock(std::addressof(pull_mutex));
     if (!pull_buffer.empty()) {
-        R_TRY(condvarWait(std::addressof(can_pull_write), std::addressof(pull_mutex)));
+        R_TRY(WaitStage(std::addressof(can_pull_write), std::addressof(pull_mutex), write_stage));
     }
 
     ON_SCOPE_EXIT(mutexUnlock(std::addressof(pull_mutex)));
@@ -382,9 +539,11 @@ Result ThreadData::Pull(void* data, s64 size, u64* bytes_read) {
 // read thread reads all data from the source
 Result ThreadData::readFuncInternal() {
     ON_SCOPE_EXIT( read_running = false; );
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT( read_stage.active_ticks += armGetSystemTick() - start; );
 
     // the main buffer which data is read into.
-    std::vector<u8> buf;
+    PoolBuffer buf;
     buf.reserve(this->read_buffer_size);
 
     while (this->read_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
@@ -394,7 +553,10 @@ Result ThreadData::readFuncInternal() {
 
         u64 bytes_read{};
         buf.resize(read_size);
-        R_TRY(this->Read(buf.data(), read_size, std::addressof(bytes_read)));
+        {
+            TRACE_SCOPE("transfer::read");
+            R_TRY(this->Read(buf.data(), read_size, std::addressof(bytes_read)));
+        }
         if (!bytes_read) {
             break;
         }
@@ -408,12 +570,64 @@ Result ThreadData::readFuncInternal() {
     R_SUCCEED();
 }
 
+// each read thread claims the next chunk, reads it and then queues it in order.
+Result ThreadData::readParallelFuncInternal() {
+    ON_SCOPE_EXIT(
+        if (!--active_readers) {
+            read_running = false;
+        }
+    );
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT( read_stage.active_ticks += armGetSystemTick() - start; );
+
+    PoolBuffer buf;
+    buf.reserve(this->read_buffer_size);
+
+    while (R_SUCCEEDED(this->GetResults())) {
+        const auto buffer_offset = this->next_read_offset.fetch_add(this->read_buffer_size);
+        if (buffer_offset >= this->write_size) {
+            break;
+        }
+
+        // chunks must be filled completely, otherwise there would be a gap
+        // between this chunk and the one claimed by the next thread.
+        const auto read_size = std::min<s64>(this->read_buffer_size, this->write_size - buffer_offset);
+        buf.resize(read_size);
+
+        TRACE_SCOPE("transfer::read_parallel");
+        s64 buf_size{};
+        while (buf_size < read_size) {
+            u64 bytes_read{};
+            R_TRY(this->rfunc(buf.data() + buf_size, buffer_offset + buf_size, read_size - buf_size, std::addressof(bytes_read)));
+            if (!bytes_read) {
+                break;
+            }
+
+            buf_size += bytes_read;
+        }
+
+        this->read_offset += buf_size;
+        ueventSignal(GetReadProgressEvent());
+
+        const auto eof = buf_size < read_size;
+        R_TRY(this->SetDecompressBufOrdered(buf, buffer_offset, buf_size, eof));
+        if (eof) {
+            break;
+        }
+    }
+
+    log_write("finished parallel read thread success!\n");
+    R_SUCCEED();
+}
+
 // read thread reads all data from the source
 Result ThreadData::decompressFuncInternal() {
     ON_SCOPE_EXIT( decompress_running = false; );
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT( decompress_stage.active_ticks += armGetSystemTick() - start; );
 
-    std::vector<u8> buf{};
-    std::vector<u8> temp_buf{};
+    PoolBuffer buf{};
+    PoolBuffer temp_buf{};
     buf.reserve(this->read_buffer_size);
     temp_buf.reserve(this->read_buffer_size);
     const auto temp_buf_flush_max = this->read_buffer_size / 2;
@@ -427,6 +641,7 @@ Result ThreadData::decompressFuncInternal() {
         }
 
         if (this->dfunc) {
+            TRACE_SCOPE("transfer::decompress");
             R_TRY(this->dfunc(buf.data(), decompress_buf_off, buf.size(), [&](const void* _data, s64 size) -> Result {
                 auto data = (const u8*)_data;
 
@@ -472,13 +687,19 @@ Result ThreadData::decompressFuncInternal() {
 // write thread writes data to wfunc.
 Result ThreadData::writeFuncInternal() {
     ON_SCOPE_EXIT( write_running = false; );
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT( write_stage.active_ticks += armGetSystemTick() - start; );
 
-    std::vector<u8> buf;
+    PoolBuffer buf;
     buf.reserve(this->read_buffer_size);
 
     while (this->write_offset < this->write_size && R_SUCCEEDED(this->GetResults())) {
         s64 dummy_off;
-        R_TRY(this->GetWriteBuf(buf, dummy_off));
+        if (this->has_decompress) {
+            R_TRY(this->GetWriteBuf(buf, dummy_off));
+        } else {
+            R_TRY(this->GetDecompressBuf(buf, dummy_off));
+        }
         const auto size = buf.size();
         if (!size) {
             log_write("exiting write func early because no data was received\n");
@@ -488,6 +709,7 @@ Result ThreadData::writeFuncInternal() {
         if (!this->wfunc) {
             R_TRY(this->SetPullBuf(buf, buf.size()));
         } else {
+            TRACE_SCOPE("transfer::write");
             R_TRY(this->wfunc(buf.data(), this->write_offset, buf.size()));
         }
 
@@ -500,31 +722,89 @@ Result ThreadData::writeFuncInternal() {
 }
 
 void readFunc(void* d) {
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
     auto t = static_cast<ThreadData*>(d);
     t->SetReadResult(t->readFuncInternal());
     log_write("read thread returned now\n");
 }
 
+void readParallelFunc(void* d) {
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
+    auto t = static_cast<ThreadData*>(d);
+    t->SetReadResult(t->readParallelFuncInternal());
+    log_write("parallel read thread returned now\n");
+}
+
 void decompressFunc(void* d) {
     log_write("hello decomp thread func\n");
+    App::ComputeBoost boost;
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
     auto t = static_cast<ThreadData*>(d);
     t->SetDecompressResult(t->decompressFuncInternal());
     log_write("decompress thread returned now\n");
 }
 
 void writeFunc(void* d) {
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
     auto t = static_cast<ThreadData*>(d);
     t->SetWriteResult(t->writeFuncInternal());
     log_write("write thread returned now\n");
 }
 
-Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const DecompressCallback& dfunc, const WriteCallback& wfunc, const StartCallback2& sfunc, Mode mode, u64 buffer_size = NORMAL_BUFFER_SIZE) {
+Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const DecompressCallback& dfunc, const WriteCallback& wfunc, const StartCallback2& sfunc, Mode mode, PipelineConfig config = {}, TransferStats* out_stats = nullptr) {
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
     const auto is_file_based_emummc = App::IsFileBaseEmummc();
+    const auto start_tick = armGetSystemTick();
+    TransferStats stats{};
+
+    ON_SCOPE_EXIT(
+        stats.elapsed_ns = armTicksToNs(armGetSystemTick() - start_tick);
+        LogTransferStats(stats);
+        if (out_stats) {
+            *out_stats = stats;
+        }
+    );
 
-    if (is_file_based_emummc) {
-        buffer_size = SMALL_BUFFER_SIZE;
+    // the tuned settings are picked first, the user config fills in the rest.
+    // file based emummc is always given small buffers, so there's nothing to tune.
+    const auto tune = !config.tune_route.empty() && !is_file_based_emummc && App::GetTransferAutoTune();
+    u32 tune_profile{};
+    if (tune) {
+        tune_profile = tune::Pick(config.tune_route, config);
+        if (config.slot_size && config.slot_count) {
+            config.slot_size = utils::budget::FitBufferSize(utils::budget::Subsystem_Transfer, config.slot_size, config.slot_count * 2, SMALL_BUFFER_SIZE);
+        }
+    }
+
+    // only transfers that finished are recorded.
+    ON_SCOPE_EXIT(
+        if (tune && stats.write.bytes >= size) {
+            tune::Record(config.tune_route, tune_profile, size, armTicksToNs(armGetSystemTick() - start_tick));
+        }
+    );
+
+    // fill in any values that were not set with the user config.
+    const auto default_config = GetPipelineConfig();
+    if (!config.slot_count) {
+        config.slot_count = default_config.slot_count;
+    }
+    if (!config.slot_size) {
+        config.slot_size = default_config.slot_size;
+    }
+    config.adaptive |= default_config.adaptive;
+
+    // the small buffers are aligned to any cluster size of the emummc file,
+    // so every write (bar the last) covers whole clusters.
+    // the queue is made deeper to keep the same amount of data in flight,
+    // otherwise the reader stalls each time the writer is throttled.
+    if (is_file_based_emummc && config.slot_size > SMALL_BUFFER_SIZE) {
+        const auto slot_count = config.slot_count * (config.slot_size / SMALL_BUFFER_SIZE);
+        config.slot_count = std::clamp<u32>(slot_count, config.slot_count, MAX_SLOT_COUNT);
+        config.slot_size = SMALL_BUFFER_SIZE;
     }
 
+    const auto buffer_size = config.slot_size;
+
     if (mode == Mode::SingleThreadedIfSmaller) {
         if (size <= buffer_size) {
             mode = Mode::SingleThreaded;
@@ -533,14 +813,19 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
         }
     }
 
+    // no point spinning up multiple readers if there's only 1 chunk to read.
+    if (mode == Mode::ParallelRead && size <= buffer_size) {
+        mode = Mode::MultiThreaded;
+    }
+
     // single threaded pull buffer is not supported.
     log_write("checking invalid transfer mode: %u %u\n", mode == Mode::MultiThreaded, !sfunc);
-    R_UNLESS(mode == Mode::MultiThreaded || !sfunc, 0x1);
+    R_UNLESS(mode != Mode::SingleThreaded || !sfunc, 0x1);
     log_write("valid transfer mode\n");
 
     // todo: support single threaded pull buffer.
     if (mode == Mode::SingleThreaded) {
-        std::vector<u8> buf(buffer_size);
+        PoolBuffer buf(buffer_size);
 
         s64 offset{};
         while (offset < size) {
@@ -548,44 +833,82 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
 
             u64 bytes_read;
             const auto rsize = std::min<s64>(buf.size(), size - offset);
+            const auto read_start = armGetSystemTick();
             R_TRY(rfunc(buf.data(), offset, rsize, &bytes_read));
+            stats.read.busy_ns += armTicksToNs(armGetSystemTick() - read_start);
             if (!bytes_read) {
                 break;
             }
 
+            const auto write_start = armGetSystemTick();
             R_TRY(wfunc(buf.data(), offset, bytes_read));
+            stats.write.busy_ns += armTicksToNs(armGetSystemTick() - write_start);
 
             offset += bytes_read;
+            stats.read.bytes = stats.write.bytes = offset;
             pbox->UpdateTransfer(offset, size);
         }
 
         R_SUCCEED();
     }
     else {
-        ThreadData t_data{pbox, size, rfunc, dfunc, wfunc, buffer_size};
+        const auto is_parallel_read = mode == Mode::ParallelRead;
+        const auto reader_count = is_parallel_read ? std::clamp<u32>(config.reader_count ? config.reader_count : DEFAULT_READER_COUNT, 1, MAX_READER_COUNT) : 1;
+        ThreadData t_data{pbox, size, rfunc, dfunc, wfunc, config, reader_count};
+        // declared after t_data so that this runs once all threads have exited.
+        ON_SCOPE_EXIT(stats = t_data.GetStats());
+
+        Thread t_read[MAX_READER_COUNT]{};
+        u32 t_read_count{};
+        ON_SCOPE_EXIT(
+            for (u32 i = 0; i < t_read_count; i++) {
+                threadClose(&t_read[i]);
+            }
+        );
 
-        Thread t_read{};
-        R_TRY(utils::CreateThread(&t_read, readFunc, std::addressof(t_data)));
-        ON_SCOPE_EXIT(threadClose(&t_read));
+        for (u32 i = 0; i < reader_count; i++) {
+            R_TRY(utils::CreateThread(&t_read[i], is_parallel_read ? readParallelFunc : readFunc, std::addressof(t_data), utils::ThreadRole::Io));
+            t_read_count++;
+        }
 
+        // plain copies skip the decompress thread, the reader hands buffers straight to the writer.
+        const auto has_decompress = dfunc != nullptr;
         Thread t_decompress{};
-        R_TRY(utils::CreateThread(&t_decompress, decompressFunc, std::addressof(t_data)));
-        ON_SCOPE_EXIT(threadClose(&t_decompress));
+        if (has_decompress) {
+            R_TRY(utils::CreateThread(&t_decompress, decompressFunc, std::addressof(t_data), utils::ThreadRole::Compute));
+        }
+        ON_SCOPE_EXIT(
+            if (has_decompress) {
+                threadClose(&t_decompress);
+            }
+        );
 
         Thread t_write{};
-        R_TRY(utils::CreateThread(&t_write, writeFunc, std::addressof(t_data)));
+        R_TRY(utils::CreateThread(&t_write, writeFunc, std::addressof(t_data), utils::ThreadRole::Io));
         ON_SCOPE_EXIT(threadClose(&t_write));
 
         const auto start_threads = [&]() -> Result {
             log_write("starting threads\n");
-            R_TRY(threadStart(std::addressof(t_read)));
-            R_TRY(threadStart(std::addressof(t_decompress)));
+            for (u32 i = 0; i < t_read_count; i++) {
+                R_TRY(threadStart(std::addressof(t_read[i])));
+            }
+            if (has_decompress) {
+                R_TRY(threadStart(std::addressof(t_decompress)));
+            }
             R_TRY(threadStart(std::addressof(t_write)));
             R_SUCCEED();
         };
 
-        ON_SCOPE_EXIT(threadWaitForExit(std::addressof(t_read)));
-        ON_SCOPE_EXIT(threadWaitForExit(std::addressof(t_decompress)));
+        ON_SCOPE_EXIT(
+            for (u32 i = 0; i < t_read_count; i++) {
+                threadWaitForExit(std::addressof(t_read[i]));
+            }
+        );
+        ON_SCOPE_EXIT(
+            if (has_decompress) {
+                threadWaitForExit(std::addressof(t_decompress));
+            }
+        );
         ON_SCOPE_EXIT(threadWaitForExit(std::addressof(t_write)));
 
         if (sfunc) {
@@ -615,6 +938,7 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
 
                 if (!idx) {
                     pbox->UpdateTransfer(t_data.GetWriteOffset(), t_data.GetWriteSize());
+                    pbox->UpdateStageTransfer(t_data.GetReadOffset(), t_data.GetDecompressOffset(), t_data.GetWriteOffset());
                 } else {
                     break;
                 }
@@ -627,9 +951,17 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
             t_data.WakeAllThreads();
             pbox->Yield();
 
-            if (R_FAILED(waitSingleHandle(t_read.handle, 1000))) {
+            bool read_closed = true;
+            for (u32 i = 0; i < t_read_count; i++) {
+                if (R_FAILED(waitSingleHandle(t_read[i].handle, 1000))) {
+                    read_closed = false;
+                    break;
+                }
+            }
+
+            if (!read_closed) {
                 continue;
-            } else if (R_FAILED(waitSingleHandle(t_decompress.handle, 1000))) {
+            } else if (has_decompress && R_FAILED(waitSingleHandle(t_decompress.handle, 1000))) {
                 continue;
             } else if (R_FAILED(waitSingleHandle(t_write.handle, 1000))) {
                 continue;
@@ -637,6 +969,7 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
             break;
         }
         log_write("threads closed\n");
+        utils::pool::LogStats("transfer");
 
         // if any of the threads failed, wake up all threads so they can exit.
         if (R_FAILED(t_data.GetResults())) {
@@ -652,6 +985,36 @@ Result TransferInternal(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfu
 
 } // namespace
 
+auto GetPipelineConfig() -> PipelineConfig {
+    PipelineConfig config{};
+    config.slot_count = App::GetTransferQueueDepth();
+    config.slot_size = App::GetTransferBufferSize();
+    config.adaptive = App::GetTransferAdaptiveQueue();
+
+    if (!config.slot_count) {
+        config.slot_count = DEFAULT_SLOT_COUNT;
+    }
+    if (!config.slot_size) {
+        config.slot_size = NORMAL_BUFFER_SIZE;
+    }
+
+    // each slot is used by both the read and write queue.
+    const auto slot_size = utils::budget::FitBufferSize(utils::budget::Subsystem_Transfer, config.slot_size, config.slot_count * 2, SMALL_BUFFER_SIZE);
+    if (slot_size != config.slot_size) {
+        log_write("[THREAD] buffer size lowered to fit the budget: %zu -> %zu\n", config.slot_size, slot_size);
+        config.slot_size = slot_size;
+    }
+
+    return config;
+}
+
+void EmummcThrottle(u64 start_tick) {
+    const auto elapsed = armTicksToNs(armGetSystemTick() - start_tick);
+    if (elapsed < EMUMMC_THROTTLE_NS) {
+        svcSleepThread(EMUMMC_THROTTLE_NS - elapsed);
+    }
+}
+
 Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const WriteCallback& wfunc, Mode mode) {
     return TransferInternal(pbox, size, rfunc, nullptr, wfunc, nullptr, mode);
 }
@@ -660,6 +1023,10 @@ Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, cons
     return TransferInternal(pbox, size, rfunc, dfunc, wfunc, nullptr, mode);
 }
 
+Result Transfer(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const DecompressCallback& dfunc, const WriteCallback& wfunc, const PipelineConfig& config, Mode mode, TransferStats* stats) {
+    return TransferInternal(pbox, size, rfunc, dfunc, wfunc, nullptr, mode, config, stats);
+}
+
 Result TransferPull(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc, const StartCallback& sfunc, Mode mode) {
     return TransferInternal(pbox, size, rfunc, nullptr, nullptr, [sfunc](StartThreadCallback start, PullCallback pull) -> Result {
         R_TRY(start());
@@ -671,7 +1038,10 @@ Result TransferPull(ui::ProgressBox* pbox, s64 size, const ReadCallback& rfunc,
     return TransferInternal(pbox, size, rfunc, nullptr, nullptr, sfunc, mode);
 }
 
-Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, s64 size, u32 crc32, Mode mode) {
+namespace {
+
+// creates and opens the output file for an entry in a zip.
+Result OpenUnzipOutput(fs::Fs* fs, const fs::FsPath& path, s64 size, fs::File& f) {
     Result rc;
     if (R_FAILED(rc = fs->CreateDirectoryRecursivelyWithPath(path)) && rc != FsError_PathAlreadyExists) {
         log_write("failed to create folder: %s 0x%04X\n", path.s, rc);
@@ -683,7 +1053,6 @@ Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::F
         R_THROW(rc);
     }
 
-    fs::File f;
     R_TRY(fs->OpenFile(path, FsOpenMode_Write, &f));
 
     // only update the size if this is an existing file.
@@ -691,6 +1060,227 @@ Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::F
         R_TRY(f.SetSize(size));
     }
 
+    R_SUCCEED();
+}
+
+// number of threads used by TransferUnzipAll() when extracting from a path.
+constexpr u32 UNZIP_WORKER_COUNT = 3;
+
+struct UnzipEntry {
+    // position of the entry in the central directory.
+    unz64_file_pos pos;
+    fs::FsPath path;
+    s64 size;
+    u32 crc32;
+};
+
+struct UnzipThreadData {
+    ui::ProgressBox* const pbox;
+    const fs::FsPath& zip_path;
+    fs::Fs* const fs;
+    const std::span<const UnzipEntry> entries;
+
+    std::atomic<size_t> next_index{};
+    std::atomic<s64> bytes_done{};
+    std::atomic<Result> result{};
+
+    auto GetResults() -> Result {
+        R_TRY(pbox->ShouldExitResult());
+        R_TRY(result.load());
+        R_SUCCEED();
+    }
+};
+
+// each worker opens its own handle to the zip and extracts the next entry in the list.
+Result unzipFuncInternal(UnzipThreadData* t) {
+    zlib_filefunc64_def file_func;
+    mz::FileFuncStdio(&file_func);
+
+    auto zfile = unzOpen2_64(t->zip_path, &file_func);
+    R_UNLESS(zfile, Result_UnzOpen2_64);
+    ON_SCOPE_EXIT(unzClose(zfile));
+
+    PoolBuffer buf(SMALL_BUFFER_SIZE);
+
+    while (R_SUCCEEDED(t->GetResults())) {
+        const auto index = t->next_index++;
+        if (index >= t->entries.size()) {
+            break;
+        }
+
+        const auto& e = t->entries[index];
+        auto pos = e.pos;
+        if (UNZ_OK != unzGoToFilePos64(zfile, &pos)) {
+            log_write("failed to go to file pos: %s\n", e.path.s);
+            R_THROW(Result_UnzLocateFile);
+        }
+
+        if (UNZ_OK != unzOpenCurrentFile(zfile)) {
+            log_write("failed to open current file\n");
+            R_THROW(Result_UnzOpenCurrentFile);
+        }
+        ON_SCOPE_EXIT(unzCloseCurrentFile(zfile));
+
+        fs::File f;
+        R_TRY(OpenUnzipOutput(t->fs, e.path, e.size, f));
+
+        u32 crc32_out{};
+        s64 offset{};
+        while (offset < e.size) {
+            R_TRY(t->GetResults());
+
+            const auto result = unzReadCurrentFile(zfile, buf.data(), std::min<s64>(buf.size(), e.size - offset));
+            if (result <= 0) {
+                log_write("failed to read zip file: %s %d\n", e.path.s, result);
+                R_THROW(Result_UnzReadCurrentFile);
+            }
+
+            if (e.crc32) {
+                crc32_out = crc32CalculateWithSeed(crc32_out, buf.data(), result);
+            }
+
+            R_TRY(f.Write(offset, buf.data(), result, FsWriteOption_None));
+            offset += result;
+            t->bytes_done += result;
+        }
+
+        // validate crc32 (if set in the info).
+        R_UNLESS(!e.crc32 || e.crc32 == crc32_out, 0x8);
+    }
+
+    R_SUCCEED();
+}
+
+void unzipFunc(void* d) {
+    App::ComputeBoost boost;
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
+    auto t = static_cast<UnzipThreadData*>(d);
+    const auto rc = unzipFuncInternal(t);
+    if (R_FAILED(rc)) {
+        t->result = rc;
+    }
+}
+
+// parses the central directory once, then extracts the files using a pool of workers.
+Result TransferUnzipAllParallel(ui::ProgressBox* pbox, const fs::FsPath& zip_out, fs::Fs* fs, const fs::FsPath& base_path, const UnzipAllFilter& filter) {
+    std::vector<UnzipEntry> entries;
+    s64 total_size{};
+
+    {
+        zlib_filefunc64_def file_func;
+        mz::FileFuncStdio(&file_func);
+
+        auto zfile = unzOpen2_64(zip_out, &file_func);
+        R_UNLESS(zfile, Result_UnzOpen2_64);
+        ON_SCOPE_EXIT(unzClose(zfile));
+
+        unz_global_info64 ginfo;
+        if (UNZ_OK != unzGetGlobalInfo64(zfile, &ginfo)) {
+            R_THROW(Result_UnzGetGlobalInfo64);
+        }
+
+        if (UNZ_OK != unzGoToFirstFile(zfile)) {
+            R_THROW(Result_UnzGoToFirstFile);
+        }
+
+        for (s64 i = 0; i < ginfo.number_entry; i++) {
+            R_TRY(pbox->ShouldExitResult());
+
+            if (i > 0) {
+                if (UNZ_OK != unzGoToNextFile(zfile)) {
+                    log_write("failed to unzGoToNextFile\n");
+                    R_THROW(Result_UnzGoToNextFile);
+                }
+            }
+
+            unz_file_info64 info;
+            fs::FsPath name;
+            if (UNZ_OK != unzGetCurrentFileInfo64(zfile, &info, name, sizeof(name), 0, 0, 0, 0)) {
+                log_write("failed to get current info\n");
+                R_THROW(Result_UnzGetCurrentFileInfo64);
+            }
+
+            auto path = fs::AppendPath(base_path, name);
+            if (filter && !filter(name, path)) {
+                continue;
+            }
+
+            const auto path_len = std::strlen(path);
+            if (!path_len) {
+                continue;
+            }
+
+            if (path[path_len -1] == '/') {
+                Result rc;
+                if (R_FAILED(rc = fs->CreateDirectoryRecursively(path)) && rc != FsError_PathAlreadyExists) {
+                    log_write("failed to create folder: %s 0x%04X\n", path.s, rc);
+                    R_THROW(rc);
+                }
+            } else {
+                unz64_file_pos pos;
+                if (UNZ_OK != unzGetFilePos64(zfile, &pos)) {
+                    R_THROW(Result_UnzLocateFile);
+                }
+
+                entries.emplace_back(pos, path, info.uncompressed_size, info.crc);
+                total_size += info.uncompressed_size;
+            }
+        }
+    }
+
+    if (entries.empty()) {
+        R_SUCCEED();
+    }
+
+    UnzipThreadData t_data{pbox, zip_out, fs, entries};
+    const auto worker_count = std::min<u32>(UNZIP_WORKER_COUNT, entries.size());
+
+    Thread t_workers[UNZIP_WORKER_COUNT]{};
+    u32 t_worker_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadClose(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < worker_count; i++) {
+        R_TRY(utils::CreateThread(&t_workers[i], unzipFunc, std::addressof(t_data), utils::ThreadRole::Compute));
+        t_worker_count++;
+    }
+
+    ON_SCOPE_EXIT(
+        // ensure the workers exit if we return early.
+        for (u32 i = 0; i < t_worker_count; i++) {
+            if (R_SUCCEEDED(t_data.result.load())) {
+                t_data.result = 0x1;
+            }
+            threadWaitForExit(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < t_worker_count; i++) {
+        R_TRY(threadStart(&t_workers[i]));
+    }
+
+    pbox->NewTransfer("Extracting files"_i18n);
+
+    for (u32 i = 0; i < t_worker_count;) {
+        pbox->UpdateTransfer(t_data.bytes_done, total_size);
+        if (R_SUCCEEDED(waitSingleHandle(t_workers[i].handle, 1e+8))) { // 100ms
+            i++;
+        }
+    }
+
+    log_write("[UNZIP] extracted %zu files using %u workers\n", entries.size(), t_worker_count);
+    return t_data.result.load();
+}
+
+} // namespace
+
+Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, s64 size, u32 crc32, Mode mode) {
+    fs::File f;
+    R_TRY(OpenUnzipOutput(fs, path, size, f));
+
     // NOTES: do not use temp file with rename / delete after as it massively slows
     // down small file transfers (RA 21s -> 50s).
     u32 crc32_out{};
@@ -713,7 +1303,7 @@ Result TransferUnzip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::F
         [&](const void* data, s64 off, s64 size) -> Result {
             return f.Write(off, data, size, FsWriteOption_None);
         },
-        nullptr, mode, SMALL_BUFFER_SIZE
+        nullptr, mode, PipelineConfig{.slot_size = SMALL_BUFFER_SIZE}
     ));
 
     // validate crc32 (if set in the info).
@@ -749,10 +1339,430 @@ Result TransferZip(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsP
             }
             R_SUCCEED();
         },
-        nullptr, mode, SMALL_BUFFER_SIZE
+        nullptr, mode, PipelineConfig{.slot_size = SMALL_BUFFER_SIZE}
     );
 }
 
+namespace {
+
+// size of each block that is deflated by a worker.
+constexpr u64 DEFLATE_BLOCK_SIZE = 1024 * 512;
+// each block is primed with the tail of the previous block, so the output
+// compresses (almost) as well as a single stream.
+constexpr u64 DEFLATE_DICT_SIZE = 1024 * 32;
+constexpr u32 DEFLATE_WORKER_COUNT = 3;
+constexpr u32 DEFLATE_SLOT_COUNT = DEFLATE_WORKER_COUNT * 2;
+
+struct DeflateSlot {
+    PoolBuffer in{};
+    PoolBuffer out{};
+    std::vector<u8> dict{};
+    bool last{};
+};
+
+struct DeflateThreadData {
+    DeflateThreadData(int _level) : level{_level} {
+        mutexInit(std::addressof(mutex));
+        condvarInit(std::addressof(can_deflate));
+        condvarInit(std::addressof(can_write));
+    }
+
+    auto GetResults() volatile -> Result {
+        R_TRY(result.load());
+        R_SUCCEED();
+    }
+
+    void SetResult(Result rc) {
+        if (R_FAILED(rc)) {
+            result = rc;
+        }
+    }
+
+    // wakes up everything so that the workers and the writer can exit.
+    void Cancel(Result rc) {
+        SetResult(rc);
+        SCOPED_MUTEX(std::addressof(mutex));
+        condvarWakeAll(std::addressof(can_deflate));
+        condvarWakeAll(std::addressof(can_write));
+    }
+
+    Result deflateFuncInternal();
+
+    const int level;
+    DeflateSlot slots[DEFLATE_SLOT_COUNT]{};
+
+    Mutex mutex{};
+    // signalled when a block has been queued.
+    CondVar can_deflate{};
+    // signalled when a block has been deflated.
+    CondVar can_write{};
+
+    // all protected by mutex.
+    u64 queued{};
+    u64 next_job{};
+    u64 deflated{};
+    bool done_deflated[DEFLATE_SLOT_COUNT]{};
+    bool finished{};
+
+    std::atomic<Result> result{};
+};
+
+// deflates a single block into a raw deflate stream.
+// every block but the last ends with a sync flush, so that the blocks can be
+// joined together byte aligned.
+Result DeflateBlock(int level, DeflateSlot& slot) {
+    z_stream z{};
+    if (Z_OK != deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)) {
+        R_THROW(Result_ZipWriteInFileInZip);
+    }
+    ON_SCOPE_EXIT(deflateEnd(&z));
+
+    if (!slot.dict.empty() && Z_OK != deflateSetDictionary(&z, slot.dict.data(), slot.dict.size())) {
+        R_THROW(Result_ZipWriteInFileInZip);
+    }
+
+    // the bound doesn't account for the sync flush marker, so add some slack.
+    slot.out.resize(deflateBound(&z, slot.in.size()) + 64);
+    z.next_in = slot.in.data();
+    z.avail_in = slot.in.size();
+    z.next_out = slot.out.data();
+    z.avail_out = slot.out.size();
+
+    const auto flush = slot.last ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;) {
+        const auto rc = deflate(&z, flush);
+        if (rc == Z_STREAM_ERROR) {
+            log_write("[ZIP] failed to deflate block\n");
+            R_THROW(Result_ZipWriteInFileInZip);
+        }
+
+        if (slot.last ? rc == Z_STREAM_END : (!z.avail_in && z.avail_out)) {
+            break;
+        }
+
+        // should never happen, but grow the buffer rather than fail.
+        const auto offset = slot.out.size() - z.avail_out;
+        slot.out.resize(slot.out.size() * 2);
+        z.next_out = slot.out.data() + offset;
+        z.avail_out = slot.out.size() - offset;
+    }
+
+    slot.out.resize(slot.out.size() - z.avail_out);
+    R_SUCCEED();
+}
+
+Result DeflateThreadData::deflateFuncInternal() {
+    while (R_SUCCEEDED(GetResults())) {
+        mutexLock(std::addressof(mutex));
+        while (next_job == queued && !finished && R_SUCCEEDED(GetResults())) {
+            condvarWait(std::addressof(can_deflate), std::addressof(mutex));
+        }
+
+        if (next_job == queued || R_FAILED(GetResults())) {
+            mutexUnlock(std::addressof(mutex));
+            break;
+        }
+
+        const auto job = next_job++;
+        mutexUnlock(std::addressof(mutex));
+
+        auto& slot = slots[job % DEFLATE_SLOT_COUNT];
+        R_TRY(DeflateBlock(level, slot));
+
+        SCOPED_MUTEX(std::addressof(mutex));
+        done_deflated[job % DEFLATE_SLOT_COUNT] = true;
+        condvarWakeAll(std::addressof(can_write));
+    }
+
+    R_SUCCEED();
+}
+
+void deflateFunc(void* d) {
+    App::ComputeBoost boost;
+    SCOPED_MEM_TAG(utils::mem::Tag_Transfer);
+    auto t = static_cast<DeflateThreadData*>(d);
+    const auto rc = t->deflateFuncInternal();
+    if (R_FAILED(rc)) {
+        t->Cancel(rc);
+    }
+}
+
+// runs deflateFunc on every worker until this goes out of scope.
+struct DeflateWorkers {
+    DeflateWorkers(DeflateThreadData& data) : m_data{data} {}
+
+    ~DeflateWorkers() {
+        // ensure the workers exit if we return early.
+        m_data.Cancel(0x1);
+        for (u32 i = 0; i < m_started; i++) {
+            threadWaitForExit(&m_threads[i]);
+        }
+
+        for (u32 i = 0; i < m_created; i++) {
+            threadClose(&m_threads[i]);
+        }
+    }
+
+    Result Start() {
+        for (u32 i = 0; i < DEFLATE_WORKER_COUNT; i++) {
+            R_TRY(utils::CreateThread(&m_threads[i], deflateFunc, std::addressof(m_data), utils::ThreadRole::Compute));
+            m_created++;
+        }
+
+        for (u32 i = 0; i < m_created; i++) {
+            R_TRY(threadStart(&m_threads[i]));
+            m_started++;
+        }
+
+        R_SUCCEED();
+    }
+
+private:
+    DeflateThreadData& m_data;
+    Thread m_threads[DEFLATE_WORKER_COUNT]{};
+    u32 m_created{};
+    u32 m_started{};
+};
+
+// blocks until the job in the slot has been deflated, then frees the slot.
+Result WaitForDeflate(DeflateThreadData& t_data, u32 index) {
+    mutexLock(std::addressof(t_data.mutex));
+    while (!t_data.done_deflated[index] && R_SUCCEEDED(t_data.GetResults())) {
+        condvarWait(std::addressof(t_data.can_write), std::addressof(t_data.mutex));
+    }
+    t_data.done_deflated[index] = false;
+    mutexUnlock(std::addressof(t_data.mutex));
+    return t_data.GetResults();
+}
+
+// reads the file in blocks on the calling thread, deflates them on the workers
+// and writes them back in order as a raw entry.
+Result TransferZipParallel(ui::ProgressBox* pbox, void* zfile, fs::File& f, s64 file_size, const fs::FsPath& path, int level, u32* crc32) {
+    DeflateThreadData t_data{level};
+    DeflateWorkers workers{t_data};
+    R_TRY(workers.Start());
+
+    s64 written{};
+    const auto write_next = [&]() -> Result {
+        const auto index = t_data.deflated % DEFLATE_SLOT_COUNT;
+        R_TRY(WaitForDeflate(t_data, index));
+
+        auto& slot = t_data.slots[index];
+        if (ZIP_OK != zipWriteInFileInZip(zfile, slot.out.data(), slot.out.size())) {
+            log_write("failed to write zip file: %s\n", path.s);
+            R_THROW(Result_ZipWriteInFileInZip);
+        }
+
+        written += slot.in.size();
+        pbox->UpdateTransfer(written, file_size);
+
+        SCOPED_MUTEX(std::addressof(t_data.mutex));
+        t_data.deflated++;
+        R_SUCCEED();
+    };
+
+    const auto block_count = std::max<u64>(1, (file_size + DEFLATE_BLOCK_SIZE - 1) / DEFLATE_BLOCK_SIZE);
+    const DeflateSlot* prev{};
+
+    for (u64 i = 0; i < block_count; i++) {
+        R_TRY(pbox->ShouldExitResult());
+
+        // wait for the block using this slot to be written out.
+        if (i >= DEFLATE_SLOT_COUNT) {
+            R_TRY(write_next());
+        }
+
+        auto& slot = t_data.slots[i % DEFLATE_SLOT_COUNT];
+        const auto off = i * DEFLATE_BLOCK_SIZE;
+        const auto size = std::min<s64>(DEFLATE_BLOCK_SIZE, file_size - off);
+
+        slot.in.resize(size);
+        s64 offset{};
+        while (offset < size) {
+            u64 bytes_read;
+            R_TRY(f.Read(off + offset, slot.in.data() + offset, size - offset, FsReadOption_None, &bytes_read));
+            R_UNLESS(bytes_read, Result_ZipWriteInFileInZip);
+            offset += bytes_read;
+        }
+
+        *crc32 = crc32CalculateWithSeed(*crc32, slot.in.data(), slot.in.size());
+
+        slot.dict.clear();
+        if (prev) {
+            const auto dict_size = std::min<u64>(DEFLATE_DICT_SIZE, prev->in.size());
+            slot.dict.assign(prev->in.end() - dict_size, prev->in.end());
+        }
+        slot.last = i + 1 == block_count;
+        prev = &slot;
+
+        SCOPED_MUTEX(std::addressof(t_data.mutex));
+        t_data.queued++;
+        condvarWakeOne(std::addressof(t_data.can_deflate));
+    }
+
+    {
+        SCOPED_MUTEX(std::addressof(t_data.mutex));
+        t_data.finished = true;
+        condvarWakeAll(std::addressof(t_data.can_deflate));
+    }
+
+    while (t_data.deflated < block_count) {
+        R_TRY(write_next());
+    }
+
+    R_SUCCEED();
+}
+
+} // namespace
+
+Result TransferZipEntry(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& path, const char* name_in_zip, const void* zip_info, int level, Mode mode) {
+    fs::File f;
+    R_TRY(fs->OpenFile(path, FsOpenMode_Read, &f));
+
+    s64 file_size;
+    R_TRY(f.GetSize(&file_size));
+
+    // small and stored files aren't worth spinning up the workers for.
+    const auto parallel = mode != Mode::SingleThreaded && level != Z_NO_COMPRESSION && file_size > DEFLATE_BLOCK_SIZE * 2;
+    const auto info = static_cast<const zip_fileinfo*>(zip_info);
+
+    if (!parallel) {
+        f.Close();
+
+        if (ZIP_OK != zipOpenNewFileInZip(zfile, name_in_zip, info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, level)) {
+            log_write("failed to add zip for %s\n", path.s);
+            R_THROW(Result_ZipOpenNewFileInZip);
+        }
+        ON_SCOPE_EXIT(zipCloseFileInZip(zfile));
+
+        return TransferZip(pbox, zfile, fs, path, nullptr, mode);
+    }
+
+    // the entry is opened in raw mode as the data is already deflated.
+    if (ZIP_OK != zipOpenNewFileInZip2_64(zfile, name_in_zip, info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, level, 1, file_size >= 0xFFFFFFFF)) {
+        log_write("failed to add zip for %s\n", path.s);
+        R_THROW(Result_ZipOpenNewFileInZip);
+    }
+
+    u32 crc32{};
+    const auto rc = TransferZipParallel(pbox, zfile, f, file_size, path, level, &crc32);
+    zipCloseFileInZipRaw64(zfile, file_size, crc32);
+    R_TRY(rc);
+
+    log_write("[ZIP] deflated %s in parallel\n", path.s);
+    R_SUCCEED();
+}
+
+Result TransferZipEntries(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, std::span<const ZipEntry> entries, const void* zip_info, int level, Mode mode) {
+    // stored files are only as fast as the reads, so there's nothing to gain.
+    if (mode == Mode::SingleThreaded || level == Z_NO_COMPRESSION || entries.size() <= 1) {
+        for (const auto& e : entries) {
+            R_TRY(pbox->ShouldExitResult());
+            pbox->NewTransfer(e.name_in_zip);
+            R_TRY(TransferZipEntry(pbox, zfile, fs, e.path, e.name_in_zip.c_str(), zip_info, level, mode));
+        }
+        R_SUCCEED();
+    }
+
+    const auto info = static_cast<const zip_fileinfo*>(zip_info);
+
+    // small files are read whole on this thread and each is deflated as a single
+    // block by the workers, the finished entries are appended in order.
+    DeflateThreadData t_data{level};
+    DeflateWorkers workers{t_data};
+    R_TRY(workers.Start());
+
+    struct Pending {
+        const ZipEntry* entry;
+        u32 crc32;
+    };
+    Pending pending[DEFLATE_SLOT_COUNT]{};
+
+    const auto write_next = [&]() -> Result {
+        const auto index = t_data.deflated % DEFLATE_SLOT_COUNT;
+        R_TRY(WaitForDeflate(t_data, index));
+
+        const auto& slot = t_data.slots[index];
+        const auto& e = *pending[index].entry;
+
+        if (ZIP_OK != zipOpenNewFileInZip2_64(zfile, e.name_in_zip.c_str(), info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, level, 1, 0)) {
+            log_write("failed to add zip for %s\n", e.path.s);
+            R_THROW(Result_ZipOpenNewFileInZip);
+        }
+
+        const auto write_rc = zipWriteInFileInZip(zfile, slot.out.data(), slot.out.size());
+        zipCloseFileInZipRaw64(zfile, slot.in.size(), pending[index].crc32);
+        if (ZIP_OK != write_rc) {
+            log_write("failed to write zip file: %s\n", e.path.s);
+            R_THROW(Result_ZipWriteInFileInZip);
+        }
+
+        pbox->NewTransfer(e.name_in_zip).UpdateTransfer(slot.in.size(), slot.in.size());
+
+        SCOPED_MUTEX(std::addressof(t_data.mutex));
+        t_data.deflated++;
+        R_SUCCEED();
+    };
+
+    const auto drain = [&]() -> Result {
+        while (t_data.deflated < t_data.queued) {
+            R_TRY(write_next());
+        }
+        R_SUCCEED();
+    };
+
+    for (const auto& e : entries) {
+        R_TRY(pbox->ShouldExitResult());
+
+        fs::File f;
+        R_TRY(fs->OpenFile(e.path, FsOpenMode_Read, &f));
+
+        s64 file_size;
+        R_TRY(f.GetSize(&file_size));
+
+        // large files are already split across the workers, so they're written
+        // once everything before them is in the zip.
+        if (file_size > DEFLATE_BLOCK_SIZE * 2) {
+            f.Close();
+            R_TRY(drain());
+
+            pbox->NewTransfer(e.name_in_zip);
+            R_TRY(TransferZipEntry(pbox, zfile, fs, e.path, e.name_in_zip.c_str(), zip_info, level, mode));
+            continue;
+        }
+
+        // wait for the entry using this slot to be written out.
+        if (t_data.queued - t_data.deflated >= DEFLATE_SLOT_COUNT) {
+            R_TRY(write_next());
+        }
+
+        const auto index = t_data.queued % DEFLATE_SLOT_COUNT;
+        auto& slot = t_data.slots[index];
+
+        slot.in.resize(file_size);
+        s64 offset{};
+        while (offset < file_size) {
+            u64 bytes_read;
+            R_TRY(f.Read(offset, slot.in.data() + offset, file_size - offset, FsReadOption_None, &bytes_read));
+            R_UNLESS(bytes_read, Result_ZipWriteInFileInZip);
+            offset += bytes_read;
+        }
+
+        pending[index].entry = &e;
+        pending[index].crc32 = crc32CalculateWithSeed(0, slot.in.data(), slot.in.size());
+        slot.dict.clear();
+        slot.last = true;
+
+        SCOPED_MUTEX(std::addressof(t_data.mutex));
+        t_data.queued++;
+        condvarWakeOne(std::addressof(t_data.can_deflate));
+    }
+
+    R_TRY(drain());
+    log_write("[ZIP] deflated %zu entries in parallel\n", entries.size());
+    R_SUCCEED();
+}
+
 Result TransferUnzipAll(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs::FsPath& base_path, const UnzipAllFilter& filter, Mode mode) {
     unz_global_info64 ginfo;
     if (UNZ_OK != unzGetGlobalInfo64(zfile, &ginfo)) {
@@ -816,6 +1826,11 @@ Result TransferUnzipAll(ui::ProgressBox* pbox, void* zfile, fs::Fs* fs, const fs
 }
 
 Result TransferUnzipAll(ui::ProgressBox* pbox, const fs::FsPath& zip_out, fs::Fs* fs, const fs::FsPath& base_path, const UnzipAllFilter& filter, Mode mode) {
+    // the zip can be reopened from the path, so each worker can have its own handle.
+    if (mode != Mode::SingleThreaded && !App::IsFileBaseEmummc()) {
+        return TransferUnzipAllParallel(pbox, zip_out, fs, base_path, filter);
+    }
+
     zlib_filefunc64_def file_func;
     mz::FileFuncStdio(&file_func);
 
@@ -2,18 +2,22 @@
 #include "defines.hpp"
 #include "ui/types.hpp"
 #include "log.hpp"
+#include "app.hpp"
 
 #include "yati/nx/ns.hpp"
 #include "yati/nx/nca.hpp"
 #include "yati/nx/ncm.hpp"
 
 #include "utils/thread.hpp"
+#include "utils/profile.hpp"
 #include "i18n.hpp"
 
 #include <cstring>
 #include <atomic>
 #include <ranges>
 #include <algorithm>
+#include <unordered_map>
+#include <tuple>
 
 #include <nxtc.h>
 #include <minIni.h>
@@ -21,14 +25,26 @@
 namespace sphaira::title {
 namespace {
 
+constexpr u32 WORKER_COUNT = 3;
+// requests not pushed within this time have scrolled away.
+constexpr u64 REQUEST_STALE_NS = 5e+8; // 500ms
+// the extra workers only run once there's been no input for this long.
+constexpr u64 BURST_IDLE_NS = 1e+9; // 1s
+// how often the extra workers check if they can run.
+constexpr u64 WORKER_POLL_NS = 1e+8; // 100ms
+// the cache is written once nothing has been loaded for this long.
+constexpr u64 CACHE_FLUSH_NS = 3e+9; // 3s
+// min time between uncached loads whilst throttled.
+constexpr u64 THROTTLE_NS = 2e+6; // 2ms
+
 struct ThreadData {
-    ThreadData(bool title_cache);
+    ThreadData(bool title_cache, bool game_running);
 
-    void Run();
+    void Run(u32 index);
     void Close();
     void Clear();
 
-    void PushAsync(u64 id);
+    void PushAsync(u64 id, s64 key);
     void PushAsync(const std::span<const NsApplicationRecord> app_ids);
     auto GetAsync(u64 app_id) -> ThreadResultData*;
     auto Get(u64 app_id, bool* cached = nullptr) -> ThreadResultData*;
@@ -41,23 +57,51 @@ struct ThreadData {
         return m_title_cache;
     }
 
+private:
+    struct Request {
+        s64 key;
+        // last time the key was pushed, 0 if pushed in the background.
+        u64 tick;
+        // order pushed, background requests are loaded in this order.
+        u64 order;
+    };
+
+    // a game or transfer needs the cpu, so only load on 1 worker and sleep between loads.
+    auto IsThrottled() const -> bool;
+    // the user is idle, so all workers can run.
+    auto IsBurst() const -> bool;
+    auto CanPop(u32 index) const -> bool;
+    // returns false if nothing was popped within the timeout.
+    auto Pop(u32 index, u64& out) -> bool;
+
 private:
     fs::FsNativeSd m_fs{};
-    UEvent m_uevent{};
+    CondVar m_can_pop{};
     Mutex m_mutex_id{};
     Mutex m_mutex_result{};
-    bool m_title_cache{};
+    const bool m_title_cache;
+    const bool m_game_running;
 
-    // app_ids pushed to the queue, signal uevent when pushed.
-    std::vector<u64> m_ids{};
-    // control data pushed to the queue.
-    std::vector<std::unique_ptr<ThreadResultData>> m_result{};
+    // app_ids pushed to the queue, waiting to be loaded.
+    std::unordered_map<u64, Request> m_requests{};
+    u64 m_request_order{};
+    // control data loaded by the workers.
+    std::unordered_map<u64, std::unique_ptr<ThreadResultData>> m_result{};
 
     std::atomic_bool m_running{};
+    // new entries that haven't been written to the cache file.
+    std::atomic_bool m_cache_dirty{};
+};
+
+struct Worker {
+    ThreadData* data;
+    u32 index;
+    Thread thread;
 };
 
 Mutex g_mutex{};
-Thread g_thread{};
+Worker g_workers[WORKER_COUNT]{};
+u32 g_worker_count{};
 u32 g_ref_count{};
 std::unique_ptr<ThreadData> g_thread_data{};
 
@@ -110,6 +154,196 @@ auto& GetNcmEntry(u8 storage_id) {
     return *it;
 }
 
+constexpr fs::FsPath META_CACHE_PATH{"/switch/sphaira/cache/title_meta.bin"};
+constexpr u32 META_CACHE_MAGIC = 0x4154454D; // META
+constexpr u32 META_CACHE_VERSION = 1;
+
+struct MetaCacheHeader {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 reserved;
+};
+
+struct MetaCacheEntryHeader {
+    u64 app_id;
+    u64 last_updated;
+    u8 last_event;
+    u8 reserved[3];
+    // number of NsApplicationContentMetaStatus that follow.
+    u32 count;
+};
+
+// meta status of each title, so that listing the contents doesn't need any ns calls.
+// entries are checked against the application record, which changes whenever
+// the title is installed, updated, deleted or a gamecard is inserted / removed.
+struct MetaCache {
+    void UpdateRecords(std::span<const NsApplicationRecord> records) {
+        SCOPED_MUTEX(&m_mutex);
+        Load();
+
+        for (const auto& record : records) {
+            auto& e = m_entries[record.application_id];
+            if (e.loaded && (e.last_updated != record.last_updated || e.last_event != record.last_event)) {
+                e.loaded = false;
+                e.entries.clear();
+                m_dirty = true;
+            }
+
+            e.last_updated = record.last_updated;
+            e.last_event = record.last_event;
+            e.validated = true;
+        }
+    }
+
+    auto Get(u64 id, MetaEntries& out) -> bool {
+        SCOPED_MUTEX(&m_mutex);
+        Load();
+
+        const auto it = m_entries.find(id);
+        if (it == m_entries.end() || !it->second.validated || !it->second.loaded) {
+            return false;
+        }
+
+        out = it->second.entries;
+        return true;
+    }
+
+    void Set(u64 id, const MetaEntries& entries) {
+        SCOPED_MUTEX(&m_mutex);
+
+        // only cache titles where the record is known, and not gamecards as
+        // they're removed without the record changing.
+        const auto it = m_entries.find(id);
+        if (it == m_entries.end() || !it->second.validated) {
+            return;
+        }
+
+        if (std::ranges::any_of(entries, [](auto& e){ return e.storageID == NcmStorageId_GameCard; })) {
+            return;
+        }
+
+        it->second.entries = entries;
+        it->second.loaded = true;
+        m_dirty = true;
+    }
+
+    void Clear() {
+        SCOPED_MUTEX(&m_mutex);
+        for (auto& [id, e] : m_entries) {
+            e.loaded = false;
+            e.entries.clear();
+        }
+
+        m_dirty = false;
+        fs::FsNativeSd().DeleteFile(META_CACHE_PATH);
+    }
+
+    void Save() {
+        SCOPED_MUTEX(&m_mutex);
+        if (!m_dirty) {
+            return;
+        }
+        m_dirty = false;
+
+        std::vector<u8> data(sizeof(MetaCacheHeader));
+        u32 count{};
+
+        for (const auto& [id, e] : m_entries) {
+            if (!e.loaded) {
+                continue;
+            }
+
+            MetaCacheEntryHeader header{};
+            header.app_id = id;
+            header.last_updated = e.last_updated;
+            header.last_event = e.last_event;
+            header.count = e.entries.size();
+
+            const auto off = data.size();
+            data.resize(off + sizeof(header) + e.entries.size() * sizeof(NsApplicationContentMetaStatus));
+            std::memcpy(data.data() + off, &header, sizeof(header));
+            std::memcpy(data.data() + off + sizeof(header), e.entries.data(), e.entries.size() * sizeof(NsApplicationContentMetaStatus));
+            count++;
+        }
+
+        const MetaCacheHeader header{META_CACHE_MAGIC, META_CACHE_VERSION, count};
+        std::memcpy(data.data(), &header, sizeof(header));
+
+        fs::FsNativeSd fs;
+        fs.CreateDirectoryRecursivelyWithPath(META_CACHE_PATH);
+        if (R_FAILED(fs.write_entire_file(META_CACHE_PATH, data))) {
+            log_write("[TITLE] failed to save meta cache\n");
+            fs.DeleteFile(META_CACHE_PATH);
+        }
+    }
+
+private:
+    struct Entry {
+        u64 last_updated{};
+        u8 last_event{};
+        // the record was seen this session, so the entries are up to date.
+        bool validated{};
+        bool loaded{};
+        MetaEntries entries{};
+    };
+
+    void Load() {
+        if (m_loaded) {
+            return;
+        }
+        m_loaded = true;
+
+        std::vector<u8> data;
+        if (R_FAILED(fs::FsNativeSd().read_entire_file(META_CACHE_PATH, data))) {
+            return;
+        }
+
+        MetaCacheHeader header;
+        if (data.size() < sizeof(header)) {
+            return;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (header.magic != META_CACHE_MAGIC || header.version != META_CACHE_VERSION) {
+            return;
+        }
+
+        u64 off = sizeof(header);
+        for (u32 i = 0; i < header.count; i++) {
+            MetaCacheEntryHeader entry_header;
+            if (data.size() < off + sizeof(entry_header)) {
+                break;
+            }
+            std::memcpy(&entry_header, data.data() + off, sizeof(entry_header));
+            off += sizeof(entry_header);
+
+            const auto size = (u64)entry_header.count * sizeof(NsApplicationContentMetaStatus);
+            if (data.size() < off + size) {
+                break;
+            }
+
+            auto& e = m_entries[entry_header.app_id];
+            e.last_updated = entry_header.last_updated;
+            e.last_event = entry_header.last_event;
+            e.loaded = true;
+            e.entries.resize(entry_header.count);
+            std::memcpy(e.entries.data(), data.data() + off, size);
+            off += size;
+        }
+
+        log_write("[TITLE] loaded meta cache: %zu entries\n", m_entries.size());
+    }
+
+private:
+    Mutex m_mutex{};
+    std::unordered_map<u64, Entry> m_entries{};
+    bool m_loaded{};
+    bool m_dirty{};
+};
+
+MetaCache g_meta_cache{};
+
 // also sets the status to error.
 void FakeNacpEntry(ThreadResultData* e) {
     e->status = NacpLoadStatus::Error;
@@ -134,58 +368,85 @@ Result LoadControlManual(u64 id, NacpStruct& nacp, ThreadResultData* data) {
     R_SUCCEED();
 }
 
-ThreadData::ThreadData(bool title_cache) : m_title_cache{title_cache} {
-    ueventCreate(&m_uevent, true);
+ThreadData::ThreadData(bool title_cache, bool game_running) : m_title_cache{title_cache}, m_game_running{game_running} {
+    condvarInit(&m_can_pop);
     mutexInit(&m_mutex_id);
     mutexInit(&m_mutex_result);
     m_running = true;
 }
 
-void ThreadData::Run() {
-    TimeStamp ts{};
-    bool cached{true};
-    const auto waiter = waiterForUEvent(&m_uevent);
+auto ThreadData::IsThrottled() const -> bool {
+    return m_game_running || utils::profile::IsTransferActive();
+}
 
-    while (IsRunning()) {
-        const auto rc = waitSingle(waiter, 3e+9);
+auto ThreadData::IsBurst() const -> bool {
+    return !IsThrottled() && App::GetInputIdleNs() >= BURST_IDLE_NS;
+}
 
-        // if we timed out, flush the cache and poll again.
-        if (R_FAILED(rc)) {
-            nxtcFlushCacheFile();
-            continue;
-        }
+auto ThreadData::CanPop(u32 index) const -> bool {
+    // the first worker always runs, the rest only help out when idle.
+    return !m_requests.empty() && (!index || IsBurst());
+}
 
-        if (!IsRunning()) {
-            return;
+auto ThreadData::Pop(u32 index, u64& out) -> bool {
+    SCOPED_MUTEX(&m_mutex_id);
+
+    if (!CanPop(index)) {
+        condvarWaitTimeout(&m_can_pop, &m_mutex_id, index ? WORKER_POLL_NS : CACHE_FLUSH_NS);
+        if (!IsRunning() || !CanPop(index)) {
+            return false;
         }
+    }
 
-        std::vector<u64> ids;
-        {
-            SCOPED_MUTEX(&m_mutex_id);
-            std::swap(ids, m_ids);
+    // visible requests by key, then everything else in the order pushed.
+    const auto now = armGetSystemTick();
+    const auto sort_key = [now](const Request& e) {
+        const bool visible = e.tick && armTicksToNs(now - e.tick) < REQUEST_STALE_NS;
+        return std::make_tuple(!visible, visible ? e.key : 0, e.order);
+    };
+
+    auto best = m_requests.begin();
+    for (auto it = std::next(best); it != m_requests.end(); ++it) {
+        if (sort_key(it->second) < sort_key(best->second)) {
+            best = it;
         }
+    }
 
-        for (u64 i = 0; i < std::size(ids); i++) {
-            if (!IsRunning()) {
-                return;
-            }
+    out = best->first;
+    m_requests.erase(best);
+    return true;
+}
+
+void ThreadData::Run(u32 index) {
+    TimeStamp ts{};
+    bool cached{true};
 
-            // sleep after every other entry loaded.
-            const auto elapsed = (s64)2e+6 - (s64)ts.GetNs();
-            if (!cached && elapsed > 0) {
-                svcSleepThread(elapsed);
+    while (IsRunning()) {
+        u64 id;
+        if (!Pop(index, id)) {
+            // nothing to load for a while, so write the new entries to the cache.
+            if (!index && m_cache_dirty.exchange(false)) {
+                nxtcFlushCacheFile();
             }
+            continue;
+        }
 
-            // loads new entry into cache.
-            std::ignore = Get(ids[i], &cached);
-            ts.Update();
+        // only sleep between loads when something else needs the cpu.
+        const auto elapsed = (s64)THROTTLE_NS - (s64)ts.GetNs();
+        if (!cached && elapsed > 0 && IsThrottled()) {
+            svcSleepThread(elapsed);
         }
+
+        // loads new entry into cache.
+        std::ignore = Get(id, &cached);
+        ts.Update();
     }
 }
 
 void ThreadData::Close() {
+    SCOPED_MUTEX(&m_mutex_id);
     m_running = false;
-    ueventSignal(&m_uevent);
+    condvarWakeAll(&m_can_pop);
 }
 
 void ThreadData::Clear() {
@@ -195,18 +456,21 @@ void ThreadData::Clear() {
     nxtcWipeCache();
 }
 
-void ThreadData::PushAsync(u64 id) {
+void ThreadData::PushAsync(u64 id, s64 key) {
     SCOPED_MUTEX(&m_mutex_id);
     SCOPED_MUTEX(&m_mutex_result);
 
-    const auto it_id = std::ranges::find(m_ids, id);
-    const auto it_result = std::ranges::find_if(m_result, [id](auto& e){
-        return id == e->id;
-    });
+    if (m_result.contains(id)) {
+        return;
+    }
 
-    if (it_id == m_ids.end() && it_result == m_result.end()) {
-        m_ids.emplace_back(id);
-        ueventSignal(&m_uevent);
+    const auto tick = armGetSystemTick();
+    if (auto it = m_requests.find(id); it != m_requests.end()) {
+        it->second.key = key;
+        it->second.tick = tick;
+    } else {
+        m_requests.emplace(id, Request{key, tick, m_request_order++});
+        condvarWakeAll(&m_can_pop);
     }
 }
 
@@ -218,29 +482,22 @@ void ThreadData::PushAsync(const std::span<const NsApplicationRecord> app_ids) {
     for (auto& record : app_ids) {
         const auto id = record.application_id;
 
-        const auto it_id = std::ranges::find(m_ids, id);
-        const auto it_result = std::ranges::find_if(m_result, [id](auto& e){
-            return id == e->id;
-        });
-
-        if (it_id == m_ids.end() && it_result == m_result.end()) {
-            m_ids.emplace_back(id);
+        if (!m_result.contains(id) && !m_requests.contains(id)) {
+            m_requests.emplace(id, Request{0, 0, m_request_order++});
             added_at_least_one = true;
         }
     }
 
     if (added_at_least_one) {
-        ueventSignal(&m_uevent);
+        condvarWakeAll(&m_can_pop);
     }
 }
 
 auto ThreadData::GetAsync(u64 app_id) -> ThreadResultData* {
     SCOPED_MUTEX(&m_mutex_result);
 
-    for (s64 i = 0; i < std::size(m_result); i++) {
-        if (app_id == m_result[i]->id) {
-            return m_result[i].get();
-        }
+    if (auto it = m_result.find(app_id); it != m_result.end()) {
+        return it->second.get();
     }
 
     return {};
@@ -323,6 +580,7 @@ auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
             // add new entry to cache, if valid.
             if (valid) {
                 nxtcAddEntry(app_id, &control->nacp, result->icon.size(), result->icon.data(), true);
+                m_cache_dirty = true;
             }
 
             result->status = NacpLoadStatus::Loaded;
@@ -376,21 +634,15 @@ auto ThreadData::Get(u64 app_id, bool* cached) -> ThreadResultData* {
         }
     }
 
+    // another worker may have loaded it at the same time, in which case
+    // the first result is kept as it may already be in use.
     SCOPED_MUTEX(&m_mutex_result);
-    return m_result.emplace_back(std::move(result)).get();
+    return m_result.try_emplace(app_id, std::move(result)).first->second.get();
 }
 
 void ThreadFunc(void* user) {
-    auto data = static_cast<ThreadData*>(user);
-
-    if (data->IsTitleCacheEnabled() && !nxtcInitialize()) {
-        log_write("[NXTC] failed to init cache\n");
-    }
-    ON_SCOPE_EXIT(nxtcExit());
-
-    while (data->IsRunning()) {
-        data->Run();
-    }
+    auto worker = static_cast<Worker*>(user);
+    worker->data->Run(worker->index);
 }
 
 } // namespace
@@ -407,9 +659,24 @@ Result Init() {
             e.Open();
         }
 
-        g_thread_data = std::make_unique<ThreadData>(true);
-        R_TRY(utils::CreateThread(&g_thread, ThreadFunc, g_thread_data.get(), 1024*32));
-        R_TRY(threadStart(&g_thread));
+        // the cache is thread-safe, so it's shared by all workers.
+        g_thread_data = std::make_unique<ThreadData>(true, App::IsAppletWithSuspendedApp());
+        if (g_thread_data->IsTitleCacheEnabled() && !nxtcInitialize()) {
+            log_write("[NXTC] failed to init cache\n");
+        }
+
+        for (u32 i = 0; i < WORKER_COUNT; i++) {
+            auto& worker = g_workers[i];
+            worker.data = g_thread_data.get();
+            worker.index = i;
+
+            R_TRY(utils::CreateThread(&worker.thread, ThreadFunc, &worker, 1024*32));
+            if (R_FAILED(threadStart(&worker.thread))) {
+                threadClose(&worker.thread);
+                break;
+            }
+            g_worker_count++;
+        }
     }
 
     g_ref_count++;
@@ -427,9 +694,15 @@ void Exit() {
     if (!g_ref_count) {
         g_thread_data->Close();
 
-        threadWaitForExit(&g_thread);
-        threadClose(&g_thread);
+        for (u32 i = 0; i < g_worker_count; i++) {
+            threadWaitForExit(&g_workers[i].thread);
+            threadClose(&g_workers[i].thread);
+        }
+        g_worker_count = 0;
+
+        nxtcExit();
         g_thread_data.reset();
+        g_meta_cache.Save();
 
         for (auto& e : ncm_entries) {
             e.Close();
@@ -445,12 +718,13 @@ void Clear() {
     if (g_thread_data) {
         g_thread_data->Clear();
     }
+    g_meta_cache.Clear();
 }
 
-void PushAsync(u64 app_id) {
+void PushAsync(u64 app_id, s64 key) {
     SCOPED_MUTEX(&g_mutex);
     if (g_thread_data) {
-        g_thread_data->PushAsync(app_id);
+        g_thread_data->PushAsync(app_id, key);
     }
 }
 
@@ -485,13 +759,21 @@ auto GetNcmDb(u8 storage_id) -> NcmContentMetaDatabase& {
     return GetNcmEntry(storage_id).db;
 }
 
-Result GetMetaEntries(u64 id, MetaEntries& out, u32 flags) {
-    s32 count;
-    R_TRY(nsCountApplicationContentMeta(id, &count));
+void UpdateRecords(std::span<const NsApplicationRecord> records) {
+    g_meta_cache.UpdateRecords(records);
+}
 
-    std::vector<NsApplicationContentMetaStatus> entries(count);
-    R_TRY(nsListApplicationContentMetaStatus(id, 0, entries.data(), entries.size(), &count));
-    entries.resize(count);
+Result GetMetaEntries(u64 id, MetaEntries& out, u32 flags) {
+    MetaEntries entries;
+    if (!g_meta_cache.Get(id, entries)) {
+        s32 count;
+        R_TRY(nsCountApplicationContentMeta(id, &count));
+
+        entries.resize(count);
+        R_TRY(nsListApplicationContentMetaStatus(id, 0, entries.data(), entries.size(), &count));
+        entries.resize(count);
+        g_meta_cache.Set(id, entries);
+    }
 
     for (const auto& e : entries) {
         if (flags & ContentMetaTypeToContentFlag(e.meta_type)) {
@@ -0,0 +1,139 @@
+#include "transfer_tune.hpp"
+#include "utils/ini_store.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace sphaira::thread::tune {
+namespace {
+
+constexpr const char* TUNE_PATH = "/switch/sphaira/cache/transfer_tune.ini";
+constexpr const char* INI_SECTION = "tune";
+
+// a value of 0 keeps the user's setting.
+struct Profile {
+    u64 slot_size;
+    u32 slot_count;
+    u32 reader_count;
+};
+
+// the first profile is the user's settings, the rest trade buffer size for
+// queue depth / readers, as small buffers suit slow random access (network)
+// and large buffers suit fast sequential storage (sd, usb).
+constexpr Profile PROFILES[] = {
+    { .slot_size = 0, .slot_count = 0, .reader_count = 0 },
+    { .slot_size = 1024 * 1024 * 1, .slot_count = 4, .reader_count = 4 },
+    { .slot_size = 1024 * 1024 * 2, .slot_count = 3, .reader_count = 3 },
+    { .slot_size = 1024 * 1024 * 4, .slot_count = 4, .reader_count = 2 },
+    { .slot_size = 1024 * 1024 * 8, .slot_count = 2, .reader_count = 2 },
+};
+
+// transfers smaller than this are mostly open / setup time, so say little
+// about the settings.
+constexpr s64 MIN_RECORD_SIZE = 1024 * 1024 * 32;
+// 1 in this many transfers tries a different profile.
+constexpr u64 EXPLORE_CHANCE = 8;
+// weight given to the latest speed.
+constexpr double SPEED_EMA_ALPHA = 0.25;
+
+auto GetStore() -> utils::ini::Store& {
+    static utils::ini::Store store{TUNE_PATH};
+    return store;
+}
+
+auto GetKey(const std::string& route, u32 profile) -> std::string {
+    return route + "_" + std::to_string(profile);
+}
+
+// ini keys can't contain every char, so only keep the safe ones.
+auto Sanitise(std::string str) -> std::string {
+    for (auto& c : str) {
+        if (!std::isalnum((unsigned char)c)) {
+            c = '_';
+        }
+    }
+    return str;
+}
+
+} // namespace
+
+auto GetKind(const fs::Fs* fs) -> std::string {
+    if (fs->IsNative()) {
+        return fs->IsSd() ? "sd" : "native";
+    }
+
+    // stdio roots are the mount, ie, "ums0:/".
+    const std::string root{fs->Root()};
+    return Sanitise(root.substr(0, root.find(':')));
+}
+
+auto MakeRoute(const fs::Fs* src, const fs::Fs* dst) -> std::string {
+    return GetKind(src) + "__" + GetKind(dst);
+}
+
+auto Pick(const std::string& route, PipelineConfig& config) -> u32 {
+    auto& store = GetStore();
+
+    u32 best{};
+    long best_speed{};
+    u32 unmeasured[std::size(PROFILES)]{};
+    u32 unmeasured_count{};
+
+    for (u32 i = 0; i < std::size(PROFILES); i++) {
+        const auto speed = store.GetLong(INI_SECTION, GetKey(route, i), 0);
+        if (!speed) {
+            unmeasured[unmeasured_count++] = i;
+        } else if (speed > best_speed) {
+            best = i;
+            best_speed = speed;
+        }
+    }
+
+    u32 index = best;
+    if (!(randomGet64() % EXPLORE_CHANCE)) {
+        // profiles that haven't been tried yet go first.
+        if (unmeasured_count) {
+            index = unmeasured[randomGet64() % unmeasured_count];
+        } else {
+            index = (best + 1 + randomGet64() % (std::size(PROFILES) - 1)) % std::size(PROFILES);
+        }
+    }
+
+    const auto& profile = PROFILES[index];
+    if (!config.slot_size) {
+        config.slot_size = profile.slot_size;
+    }
+    if (!config.slot_count) {
+        config.slot_count = profile.slot_count;
+    }
+    if (!config.reader_count) {
+        config.reader_count = profile.reader_count;
+    }
+
+    log_write("[TUNE] route: %s profile: %u best: %u (%ld KiB/s)\n", route.c_str(), index, best, best_speed);
+    return index;
+}
+
+void Record(const std::string& route, u32 profile, s64 size, u64 elapsed_ns) {
+    if (size < MIN_RECORD_SIZE || !elapsed_ns || profile >= std::size(PROFILES)) {
+        return;
+    }
+
+    auto& store = GetStore();
+    const auto key = GetKey(route, profile);
+    const auto sample = size / 1024.0 / (elapsed_ns / 1e+9);
+    const auto old = store.GetLong(INI_SECTION, key, 0);
+    const auto speed = old ? old + (sample - old) * SPEED_EMA_ALPHA : sample;
+
+    log_write("[TUNE] route: %s profile: %u speed: %.0f KiB/s avg: %.0f KiB/s\n", route.c_str(), profile, sample, speed);
+    store.SetLong(INI_SECTION, key, std::max<long>(1, speed));
+
+    // transfers run off the ui thread, so it's fine to write here.
+    if (R_FAILED(store.Flush())) {
+        log_write("[TUNE] failed to save\n");
+    }
+}
+
+} // namespace sphaira::thread::tune
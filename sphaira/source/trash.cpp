@@ -0,0 +1,226 @@
+#include "trash.hpp"
+#include "tree_walk.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "i18n.hpp"
+#include "defines.hpp"
+#include "utils/thread.hpp"
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <ranges>
+
+namespace sphaira::trash {
+namespace {
+
+constexpr const char* TRASH_NAME = ".sphaira_trash";
+// how often the number of files left is shown whilst deleting.
+constexpr u64 NOTIFY_INTERVAL = 1e+10; // 10s
+
+struct Job {
+    std::shared_ptr<fs::Fs> fs;
+    fs::FsPath path;
+};
+
+struct ThreadData {
+    Thread thread{};
+    Mutex mutex{};
+    CondVar cond{};
+    // trash dirs waiting to be emptied, protected by mutex.
+    std::deque<Job> jobs{};
+    std::atomic_bool stop{};
+};
+
+std::unique_ptr<ThreadData> g_data{};
+
+void Queue(ThreadData* data, const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path) {
+    SCOPED_MUTEX(&data->mutex);
+
+    // the whole trash dir is emptied, so it only needs to be queued once.
+    const auto it = std::ranges::find_if(data->jobs, [&](const auto& e) {
+        return e.path == path;
+    });
+
+    if (it == data->jobs.end()) {
+        data->jobs.emplace_back(fs, path);
+    }
+
+    condvarWakeAll(&data->cond);
+}
+
+Result EmptyTrash(ThreadData* data, const Job& job) {
+    auto fs = job.fs.get();
+    if (!fs->DirExists(job.path)) {
+        R_SUCCEED();
+    }
+
+    // a single reader, as this runs whilst the user is doing other things.
+    walk::Config config{};
+    config.worker_count = 1;
+    config.stop = &data->stop;
+
+    walk::Collections collections;
+    R_TRY(walk::Walk(fs, job.path, "", collections, config));
+
+    u64 total{};
+    for (const auto& c : collections) {
+        total += c.files.size();
+    }
+
+    log_write("[TRASH] deleting %lu files in %s\n", total, job.path.s);
+    App::Notify(i18n::Reorder("Deleting in background ", std::to_string(total) + " files"));
+
+    u64 deleted{};
+    auto last_notify = armGetSystemTick();
+    for (const auto& c : collections) {
+        for (const auto& e : c.files) {
+            if (data->stop) {
+                R_SUCCEED();
+            }
+
+            R_TRY(fs->DeleteFile(fs::AppendPath(c.path, e.name)));
+            deleted++;
+
+            if (armTicksToNs(armGetSystemTick() - last_notify) >= NOTIFY_INTERVAL) {
+                last_notify = armGetSystemTick();
+                App::Notify(i18n::Reorder("Deleting in background ", std::to_string(total - deleted) + " files left"));
+            }
+        }
+    }
+
+    // sub dirs come after their parent, so delete in reverse.
+    for (const auto& c : std::views::reverse(collections)) {
+        for (const auto& e : c.dirs) {
+            if (data->stop) {
+                R_SUCCEED();
+            }
+
+            R_TRY(fs->DeleteDirectory(fs::AppendPath(c.path, e.name)));
+        }
+    }
+
+    // this fails if something was pushed whilst deleting, that'll be queued
+    // already so it's left for the next job.
+    fs->DeleteDirectory(job.path);
+
+    log_write("[TRASH] emptied %s\n", job.path.s);
+    App::Notify(i18n::Reorder("Deleted in background ", std::to_string(total) + " files"));
+    R_SUCCEED();
+}
+
+void thread_func(void* arg) {
+    auto data = static_cast<ThreadData*>(arg);
+
+    while (!data->stop) {
+        Job job;
+        {
+            SCOPED_MUTEX(&data->mutex);
+            while (data->jobs.empty() && !data->stop) {
+                condvarWait(&data->cond, &data->mutex);
+            }
+
+            if (data->stop) {
+                break;
+            }
+
+            job = std::move(data->jobs.front());
+            data->jobs.pop_front();
+        }
+
+        // on failure the rest is left for the next time, ie, the usb drive
+        // was removed.
+        if (const auto rc = EmptyTrash(data, job); R_FAILED(rc)) {
+            log_write("[TRASH] failed to empty %s: 0x%X\n", job.path.s, rc);
+            App::Notify("Failed to delete in background"_i18n);
+        }
+    }
+}
+
+} // namespace
+
+void Init() {
+    if (g_data) {
+        return;
+    }
+
+    auto data = std::make_unique<ThreadData>();
+    mutexInit(&data->mutex);
+    condvarInit(&data->cond);
+
+    if (R_FAILED(utils::CreateThread(&data->thread, thread_func, data.get(), utils::ThreadRole::Background, 1024 * 64))) {
+        log_write("[TRASH] failed to create thread\n");
+        return;
+    }
+
+    if (R_FAILED(threadStart(&data->thread))) {
+        log_write("[TRASH] failed to start thread\n");
+        threadClose(&data->thread);
+        return;
+    }
+
+    g_data = std::move(data);
+
+    // finish off anything that was left from the last boot.
+    auto sd = std::make_shared<fs::FsNativeSd>();
+    const auto path = GetTrashPath(sd.get());
+    if (sd->DirExists(path)) {
+        Queue(g_data.get(), sd, path);
+    }
+}
+
+void ExitSignal() {
+    if (g_data) {
+        SCOPED_MUTEX(&g_data->mutex);
+        g_data->stop = true;
+        condvarWakeAll(&g_data->cond);
+    }
+}
+
+void Exit() {
+    if (!g_data) {
+        return;
+    }
+
+    ExitSignal();
+    threadWaitForExit(&g_data->thread);
+    threadClose(&g_data->thread);
+    g_data.reset();
+}
+
+Result Push(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path, bool is_dir) {
+    R_UNLESS(g_data, Result_TrashNotActive);
+
+    const auto trash_path = GetTrashPath(fs.get());
+    R_UNLESS(!std::string_view{path}.starts_with(std::string_view{trash_path}), Result_TrashInvalidPath);
+
+    const auto name = std::strrchr(path, '/');
+    R_UNLESS(name && name[1], Result_TrashInvalidPath);
+
+    // prefixed with the tick so that deleting the same name twice doesn't clash.
+    fs::FsPath trash_name;
+    std::snprintf(trash_name, sizeof(trash_name), "%016lX_%s", armGetSystemTick(), name + 1);
+    const auto dst_path = fs::AppendPath(trash_path, trash_name);
+
+    if (!fs->DirExists(trash_path)) {
+        R_TRY(fs->CreateDirectory(trash_path));
+    }
+
+    if (is_dir) {
+        R_TRY(fs->RenameDirectory(path, dst_path));
+    } else {
+        R_TRY(fs->RenameFile(path, dst_path));
+    }
+
+    log_write("[TRASH] moved %s to %s\n", path.s, dst_path.s);
+    Queue(g_data.get(), fs, trash_path);
+    R_SUCCEED();
+}
+
+auto GetTrashPath(const fs::Fs* fs) -> fs::FsPath {
+    return fs::AppendPath(fs->Root(), TRASH_NAME);
+}
+
+} // namespace sphaira::trash
@@ -0,0 +1,216 @@
+#include "tree_walk.hpp"
+#include "app.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+#include "utils/thread.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace sphaira::walk {
+namespace {
+
+constexpr u32 MAX_WORKERS = 4;
+
+struct ThreadData {
+    ThreadData(fs::Fs* _fs, Collections& _out, const Config& _config)
+    : fs{_fs}
+    , out{_out}
+    , config{_config} {
+        mutexInit(std::addressof(mutex));
+        condvarInit(std::addressof(cond));
+    }
+
+    auto IsStopped() const -> bool {
+        return R_FAILED(result.load()) || (config.stop && config.stop->load());
+    }
+
+    void SetResult(Result rc) {
+        if (R_FAILED(rc)) {
+            result = rc;
+        }
+    }
+
+    Result ReadDir(Collection& c);
+    Result workerFuncInternal();
+
+    fs::Fs* const fs;
+    Collections& out;
+    const Config& config;
+
+    Mutex mutex{};
+    // signalled when a dir has been read, as it may have added more dirs.
+    CondVar cond{};
+    // index of the next dir in out to read, protected by mutex.
+    size_t next_index{};
+    // number of dirs being read, protected by mutex.
+    u32 busy{};
+    std::atomic<Result> result{};
+};
+
+Result ThreadData::ReadDir(Collection& c) {
+    // the read buffer is reused for both reads, only the packed list is kept.
+    std::vector<FsDirectoryEntry> buf;
+    const auto fetch = [this, &c, &buf](Entries& out, u32 flags) -> Result {
+        fs::Dir d;
+        R_TRY(fs->OpenDirectory(c.path, flags, &d));
+        R_TRY(d.ReadAll(buf));
+        out.Assign(buf);
+        R_SUCCEED();
+    };
+
+    u32 flags = FsDirOpenMode_ReadFiles;
+    if (!config.inc_size) {
+        flags |= FsDirOpenMode_NoFileSize;
+    }
+
+    R_TRY(fetch(c.files, flags));
+    R_TRY(fetch(c.dirs, FsDirOpenMode_ReadDirs));
+    log_debug(LogCategory_Fs, "got collection: %s parent_name: %s files: %zu dirs: %zu\n", c.path.s, c.parent_name.s, c.files.size(), c.dirs.size());
+    R_SUCCEED();
+}
+
+Result ThreadData::workerFuncInternal() {
+    for (;;) {
+        Collection c;
+        size_t index;
+
+        {
+            SCOPED_MUTEX(std::addressof(mutex));
+            while (next_index >= out.size()) {
+                // nothing left to read and nothing being read that could add more.
+                if (!busy || IsStopped()) {
+                    R_SUCCEED();
+                }
+
+                // timeout so that the stop flag is checked.
+                condvarWaitTimeout(std::addressof(cond), std::addressof(mutex), 1e+8); // 100ms
+            }
+
+            if (IsStopped()) {
+                R_SUCCEED();
+            }
+
+            index = next_index++;
+            c.path = out[index].path;
+            c.parent_name = out[index].parent_name;
+            busy++;
+        }
+
+        const auto rc = ReadDir(c);
+
+        SCOPED_MUTEX(std::addressof(mutex));
+        busy--;
+        condvarWakeAll(std::addressof(cond));
+
+        // set with the lock held so that the other workers don't see the
+        // walk as finished before the error.
+        if (R_FAILED(rc)) {
+            SetResult(rc);
+            R_THROW(rc);
+        }
+
+        for (const auto& p : c.dirs) {
+            auto& e = out.emplace_back();
+            e.path = fs::AppendPath(c.path, p.name);
+            e.parent_name = fs::AppendPath(c.parent_name, p.name);
+        }
+
+        out[index] = std::move(c);
+    }
+}
+
+void workerFunc(void* d) {
+    auto t = static_cast<ThreadData*>(d);
+    t->SetResult(t->workerFuncInternal());
+}
+
+} // namespace
+
+void Entries::Add(const FsDirectoryEntry& e) {
+    const auto len = std::strlen(e.name);
+    m_entries.emplace_back((u32)m_names.size(), (u32)e.type, e.file_size);
+    m_names.insert(m_names.end(), e.name, e.name + len + 1);
+}
+
+void Entries::Assign(std::span<const FsDirectoryEntry> entries) {
+    m_entries.clear();
+    m_names.clear();
+
+    size_t names_size{};
+    for (const auto& e : entries) {
+        names_size += std::strlen(e.name) + 1;
+    }
+
+    m_entries.reserve(entries.size());
+    m_names.reserve(names_size);
+    for (const auto& e : entries) {
+        Add(e);
+    }
+}
+
+void Entries::Reverse() {
+    // only the order of the entries changes, the names stay where they are.
+    std::ranges::reverse(m_entries);
+}
+
+auto GetWorkerCount(fs::Fs* fs) -> u32 {
+    // file based emummc can't handle lots of parallel io.
+    if (fs->IsNative()) {
+        return App::IsFileBaseEmummc() ? 1 : 2;
+    }
+
+    // most of the time spent on non native fs is waiting on the round trip.
+    return MAX_WORKERS;
+}
+
+Result Walk(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, Collections& out, const Config& config) {
+    // out is used as the queue, so walk into a new list and append at the end.
+    Collections collections;
+    auto& root = collections.emplace_back();
+    root.path = path;
+    root.parent_name = parent_name;
+
+    ThreadData t_data{fs, collections, config};
+    const auto worker_count = std::clamp<u32>(config.worker_count ? config.worker_count : GetWorkerCount(fs), 1, MAX_WORKERS);
+
+    // the calling thread is also a worker.
+    Thread t_workers[MAX_WORKERS - 1]{};
+    u32 t_worker_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadClose(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < worker_count - 1; i++) {
+        R_TRY(utils::CreateThread(&t_workers[i], workerFunc, std::addressof(t_data)));
+        t_worker_count++;
+    }
+
+    ON_SCOPE_EXIT(
+        // ensure the workers exit if we return early.
+        t_data.SetResult(0x1);
+        {
+            SCOPED_MUTEX(std::addressof(t_data.mutex));
+            condvarWakeAll(std::addressof(t_data.cond));
+        }
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadWaitForExit(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < t_worker_count; i++) {
+        R_TRY(threadStart(&t_workers[i]));
+    }
+
+    t_data.SetResult(t_data.workerFuncInternal());
+    R_TRY(t_data.result.load());
+    R_UNLESS(!config.stop || !config.stop->load(), Result_FsLoadingCancelled);
+
+    out.insert(out.end(), std::make_move_iterator(collections.begin()), std::make_move_iterator(collections.end()));
+    R_SUCCEED();
+}
+
+} // namespace sphaira::walk
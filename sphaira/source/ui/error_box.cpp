@@ -171,6 +171,31 @@ auto GetCodeMessage(Result rc) -> const char* {
         case Result_NszFailedCompressStream2: return "SphairaError_NszFailedCompressStream2";
         case Result_NszTooManyBlocks: return "SphairaError_NszTooManyBlocks";
         case Result_NszMissingBlocks: return "SphairaError_NszMissingBlocks";
+        case Result_MmzStreamBadHeader: return "SphairaError_MmzStreamBadHeader";
+        case Result_MmzStreamUnsupported: return "SphairaError_MmzStreamUnsupported";
+        case Result_MmzStreamBadCrc: return "SphairaError_MmzStreamBadCrc";
+        case Result_MmzStreamInflate: return "SphairaError_MmzStreamInflate";
+        case Result_MmzStreamTruncated: return "SphairaError_MmzStreamTruncated";
+        case Result_MmzBadEndRecord: return "SphairaError_MmzBadEndRecord";
+        case Result_MmzBadFileHeader: return "SphairaError_MmzBadFileHeader";
+        case Result_AppstoreFailedParseRepo: return "SphairaError_AppstoreFailedParseRepo";
+        case Result_AppstoreBadIndex: return "SphairaError_AppstoreBadIndex";
+        case Result_GameContentHashMismatch: return "SphairaError_GameContentHashMismatch";
+        case Result_SaveManifestInvalid: return "SphairaError_SaveManifestInvalid";
+        case Result_SaveChunkMissing: return "SphairaError_SaveChunkMissing";
+        case Result_SaveChunkHashMismatch: return "SphairaError_SaveChunkHashMismatch";
+        case Result_UsbShortTransfer: return "SphairaError_UsbShortTransfer";
+        case Result_UsbBadZstdChunk: return "SphairaError_UsbBadZstdChunk";
+        case Result_UsbBenchNotSupported: return "SphairaError_UsbBenchNotSupported";
+        case Result_TrashNotActive: return "SphairaError_TrashNotActive";
+        case Result_TrashInvalidPath: return "SphairaError_TrashInvalidPath";
+        case Result_DevoptabServerCopyNotSupported: return "SphairaError_DevoptabServerCopyNotSupported";
+        case Result_DevoptabServerCopyFailed: return "SphairaError_DevoptabServerCopyFailed";
+        case Result_CopyVerifyFailed: return "SphairaError_CopyVerifyFailed";
+        case Result_YatiDeltaFragmentNotSupported: return "SphairaError_YatiDeltaFragmentNotSupported";
+        case Result_BenchCryptoMismatch: return "SphairaError_BenchCryptoMismatch";
+        case Result_BenchPathIndexMismatch: return "SphairaError_BenchPathIndexMismatch";
+        case Result_BenchNoFileSelected: return "SphairaError_BenchNoFileSelected";
     }
 
     return "";
@@ -0,0 +1,119 @@
+#include "ui/jobs_box.hpp"
+#include "ui/option_box.hpp"
+#include "ui/nvg_util.hpp"
+#include "utils/utils.hpp"
+#include "app.hpp"
+#include "i18n.hpp"
+#include <algorithm>
+
+namespace sphaira::ui {
+
+JobsBox::JobsBox() {
+    m_pos.w = SCREEN_WIDTH;
+    m_pos.h = 80.f + 140.f + 370.f;
+    m_pos.y = SCREEN_HEIGHT - m_pos.h;
+    m_line_top = m_pos.y + 70.f;
+    m_line_bottom = SCREEN_HEIGHT - 73.f;
+
+    Vec4 v{m_block};
+    v.y = m_line_top + 1.f + 42.f;
+    const Vec4 pos{0, m_line_top, SCREEN_WIDTH, m_line_bottom - m_line_top};
+    m_list = std::make_unique<List>(1, 6, pos, v);
+    m_list->SetScrollBarPos(1250, m_line_top + 20, m_line_bottom - m_line_top - 40);
+
+    m_info = jobs::GetInfo();
+    UpdateActions();
+}
+
+auto JobsBox::Update(Controller* controller, TouchInfo* touch) -> void {
+    // jobs finish whilst the box is open.
+    m_info = jobs::GetInfo();
+    m_index = std::clamp<s64>(m_index, 0, std::max<s64>(0, m_info.size() - 1));
+    UpdateActions();
+
+    // the progress is updated from other threads, so keep drawing whilst open.
+    App::Invalidate();
+    Widget::Update(controller, touch);
+    m_list->OnUpdate(controller, touch, m_index, m_info.size(), [this](bool touch, auto i) {
+        m_index = i;
+    });
+}
+
+auto JobsBox::Draw(NVGcontext* vg, Theme* theme) -> void {
+    gfx::dimBackground(vg);
+    gfx::drawRect(vg, m_pos, theme->GetColour(ThemeEntryID_POPUP));
+    gfx::drawText(vg, m_pos + m_title_pos, 24.f, theme->GetColour(ThemeEntryID_TEXT), "Background jobs"_i18n.c_str());
+    gfx::drawRect(vg, 30.f, m_line_top, m_line_width, 1.f, theme->GetColour(ThemeEntryID_LINE));
+    gfx::drawRect(vg, 30.f, m_line_bottom, m_line_width, 1.f, theme->GetColour(ThemeEntryID_LINE));
+
+    if (m_info.empty()) {
+        gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, (m_line_top + m_line_bottom) / 2.f, 24.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "No jobs running"_i18n.c_str());
+        Widget::Draw(vg, theme);
+        return;
+    }
+
+    gfx::drawTextArgs(vg, 80, 675, 18.f, NVG_ALIGN_LEFT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT), "%zu / %zu", m_index + 1, m_info.size());
+
+    m_list->Draw(vg, theme, m_info.size(), [this](auto* vg, auto* theme, auto& v, auto i) {
+        const auto& [x, y, w, h] = v;
+        const auto& e = m_info[i];
+
+        if (m_index == i) {
+            gfx::drawRectOutline(vg, theme, 4.f, v);
+        } else if (i != m_info.size() - 1) {
+            gfx::drawRect(vg, x, y + h, w, 1.f, theme->GetColour(ThemeEntryID_LINE_SEPARATOR));
+        }
+
+        std::string status;
+        if (e.queued) {
+            status = "Queued"_i18n;
+        } else if (e.paused) {
+            status = "Paused"_i18n;
+        } else if (e.size) {
+            const u32 percentage = ((double)e.offset / (double)e.size) * 100.0;
+            status = std::to_string(percentage) + "% (" + utils::formatSizeNetwork(e.speed) + ")";
+        } else {
+            status = utils::formatSizeNetwork(e.speed);
+        }
+
+        const auto text_x = x + m_text_xoffset;
+        nvgSave(vg);
+        nvgIntersectScissor(vg, x, y, w - 280.f, h);
+        gfx::drawTextArgs(vg, text_x, y + (h / 2.f) - 10.f, 20.f, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT), "%s", e.title.c_str());
+        gfx::drawTextArgs(vg, text_x, y + (h / 2.f) + 14.f, 16.f, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", e.transfer.c_str());
+        nvgRestore(vg);
+
+        gfx::drawTextArgs(vg, x + w - m_text_xoffset, y + (h / 2.f), 20.f, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_SELECTED), "%s", status.c_str());
+    });
+
+    Widget::Draw(vg, theme);
+}
+
+void JobsBox::UpdateActions() {
+    RemoveActions();
+
+    SetAction(Button::B, Action{"Back"_i18n, [this](){
+        SetPop();
+    }});
+
+    if (m_info.empty()) {
+        return;
+    }
+
+    const auto& e = m_info[m_index];
+    const auto id = e.id;
+
+    SetAction(Button::A, Action{e.paused ? "Resume"_i18n : "Pause"_i18n, [id, paused = e.paused](){
+        jobs::SetPaused(id, !paused);
+    }});
+
+    SetAction(Button::X, Action{"Cancel"_i18n, [id](){
+        App::Push<OptionBox>("Are you sure you wish to cancel?"_i18n, "No"_i18n, "Yes"_i18n, 1, [id](auto op_index){
+            if (op_index && *op_index) {
+                jobs::Cancel(id);
+            }
+        });
+    }});
+}
+
+} // namespace sphaira::ui
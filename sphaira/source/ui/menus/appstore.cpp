@@ -21,6 +21,7 @@
 #include "minizip_helper.hpp"
 
 #include "utils/utils.hpp"
+#include "utils/md5.hpp"
 
 #include <minIni.h>
 #include <string>
@@ -31,12 +32,15 @@
 #include <algorithm>
 #include <ranges>
 #include <utility>
+#include <optional>
+#include <unordered_map>
 
 namespace sphaira::ui::menu::appstore {
 namespace {
 
 constexpr fs::FsPath REPO_PATH{"/switch/sphaira/cache/appstore/repo.json"};
 constexpr fs::FsPath CACHE_PATH{"/switch/sphaira/cache/appstore"};
+constexpr fs::FsPath STAGE_PATH{"/switch/sphaira/cache/appstore/stage"};
 constexpr auto URL_BASE = "https://switch.cdn.fortheusers.org";
 constexpr auto URL_JSON = "https://switch.cdn.fortheusers.org/repo.json";
 constexpr auto URL_POST_FEEDBACK = "http://switchbru.com/appstore/feedback";
@@ -127,7 +131,7 @@ auto BuildScreensCachePath(const Entry& e, u8 num) -> fs::FsPath {
 
 // use appstore path in order to maintain compat with appstore
 auto BuildPackageCachePath(const Entry& e) -> fs::FsPath {
-    return "/switch/appstore/.get/packages/" + e.name;
+    return "/switch/appstore/.get/packages/" + std::string{e.name};
 }
 
 auto BuildInfoCachePath(const Entry& e) -> fs::FsPath {
@@ -142,7 +146,28 @@ auto BuildFeedbackCachePath(const Entry& e) -> fs::FsPath {
     return BuildPackageCachePath(e) + "/feedback.json";
 }
 
-void from_json(yyjson_val* json, Entry& e) {
+// entry as it's stored in repo.json, only used when building the index.
+struct JsonEntry {
+    std::string category{};
+    std::string binary{};
+    std::string updated{};
+    std::string name{};
+    std::string license{};
+    std::string title{};
+    std::string url{};
+    std::string description{};
+    std::string author{};
+    std::string changelog{};
+    u64 screens{};
+    u64 extracted{};
+    std::string version{};
+    u64 filesize{};
+    std::string details{};
+    u64 app_dls{};
+    std::string md5{};
+};
+
+void from_json(yyjson_val* json, JsonEntry& e) {
     JSON_OBJ_ITR(
         JSON_SET_STR(category);
         JSON_SET_STR(binary);
@@ -164,7 +189,7 @@ void from_json(yyjson_val* json, Entry& e) {
     );
 }
 
-void from_json(const fs::FsPath& path, std::vector<appstore::Entry>& e) {
+void from_json(const fs::FsPath& path, std::vector<JsonEntry>& e) {
     yyjson_read_err err;
     JSON_INIT_VEC_FILE(path, nullptr, &err);
     JSON_OBJ_ITR(
@@ -172,6 +197,284 @@ void from_json(const fs::FsPath& path, std::vector<appstore::Entry>& e) {
     );
 }
 
+// repo.json converted to a binary index, so that it doesn't need to be
+// parsed every time the menu is opened. it's only rebuilt when the etag changes.
+// layout: header, records[count], perms[SortType_MAX][OrderType_MAX][count], tokens[token_count], pool[pool_size]
+constexpr fs::FsPath INDEX_PATH{"/switch/sphaira/cache/appstore/repo_index.bin"};
+constexpr u32 INDEX_MAGIC = 0x58444E49; // INDX
+constexpr u32 INDEX_VERSION = 2;
+
+// search weight of a word found in each field.
+constexpr u32 SEARCH_WEIGHT_DESCRIPTION = 1;
+constexpr u32 SEARCH_WEIGHT_AUTHOR = 2;
+constexpr u32 SEARCH_WEIGHT_TITLE = 4;
+
+enum IndexStr {
+    IndexStr_Category,
+    IndexStr_Binary,
+    IndexStr_Updated,
+    IndexStr_Name,
+    IndexStr_License,
+    IndexStr_Title,
+    IndexStr_Url,
+    IndexStr_Description,
+    IndexStr_Author,
+    IndexStr_Changelog,
+    IndexStr_Version,
+    IndexStr_Details,
+    IndexStr_Md5,
+    IndexStr_MAX,
+};
+
+struct IndexHeader {
+    u32 magic;
+    u32 version;
+    u32 count;
+    u32 pool_size;
+    u32 token_count;
+    char etag[128];
+};
+
+struct IndexRecord {
+    // offset / length into the string pool.
+    u32 str_off[IndexStr_MAX];
+    u32 str_len[IndexStr_MAX];
+    u64 screens;
+    u64 extracted;
+    u64 filesize;
+    u64 app_dls;
+    u32 updated_num;
+    u32 reserved;
+};
+
+// a lowercase word from the title, author or description of an entry.
+// sorted by the word, so that finding the words starting with a search term
+// is a binary search.
+struct IndexToken {
+    u32 str_off;
+    u32 str_len;
+    u32 entry;
+    u32 weight;
+};
+
+auto GetTokenStr(const char* pool, const IndexToken& t) -> std::string_view {
+    return {pool + t.str_off, t.str_len};
+}
+
+// calls func with each lowercase word in the string.
+// non-ascii chars are kept as is, so that utf8 words stay whole.
+template<typename F>
+void ForEachWord(std::string_view str, F&& func) {
+    std::string word;
+    for (const auto c : str) {
+        const auto uc = (unsigned char)c;
+        if (uc >= 0x80 || std::isalnum(uc)) {
+            word.push_back(std::tolower(uc));
+        } else if (!word.empty()) {
+            func(word);
+            word.clear();
+        }
+    }
+
+    if (!word.empty()) {
+        func(word);
+    }
+}
+
+auto GetIndexPermsSize(u32 count) -> u64 {
+    return (u64)count * SortType_MAX * OrderType_MAX * sizeof(u32);
+}
+
+auto GetEtag(const curl::ApiResult& result) -> std::string {
+    const auto it = result.header.Find("etag");
+    if (it == result.header.m_map.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+// parses repo.json and writes the index.
+Result BuildIndex(const fs::FsPath& json_path, const std::string& etag) {
+    TimeStamp ts;
+
+    std::vector<JsonEntry> entries;
+    from_json(json_path, entries);
+    R_UNLESS(!entries.empty(), Result_AppstoreFailedParseRepo);
+
+    const u32 count = entries.size();
+    std::vector<IndexRecord> records(count);
+    std::vector<char> pool;
+    std::vector<IndexToken> tokens;
+    // strings such as the category, author and search words are shared between entries.
+    std::unordered_map<std::string, u32> pool_map;
+
+    const auto add_pool = [&](const std::string& str) -> u32 {
+        if (const auto it = pool_map.find(str); it != pool_map.end()) {
+            return it->second;
+        }
+
+        const u32 off = pool.size();
+        pool.insert(pool.end(), str.cbegin(), str.cend());
+        pool.emplace_back('\0');
+        pool_map.emplace(str, off);
+        return off;
+    };
+
+    const auto add_str = [&](IndexRecord& r, IndexStr type, const std::string& str) {
+        r.str_len[type] = str.length();
+        r.str_off[type] = add_pool(str);
+    };
+
+    for (u32 i = 0; i < count; i++) {
+        const auto& e = entries[i];
+        auto& r = records[i];
+
+        add_str(r, IndexStr_Category, e.category);
+        add_str(r, IndexStr_Binary, e.binary);
+        add_str(r, IndexStr_Updated, e.updated);
+        add_str(r, IndexStr_Name, e.name);
+        add_str(r, IndexStr_License, e.license);
+        add_str(r, IndexStr_Title, e.title);
+        add_str(r, IndexStr_Url, e.url);
+        add_str(r, IndexStr_Description, e.description);
+        add_str(r, IndexStr_Author, e.author);
+        add_str(r, IndexStr_Changelog, e.changelog);
+        add_str(r, IndexStr_Version, e.version);
+        add_str(r, IndexStr_Details, e.details);
+        add_str(r, IndexStr_Md5, e.md5);
+        r.screens = e.screens;
+        r.extracted = e.extracted;
+        r.filesize = e.filesize;
+        r.app_dls = e.app_dls;
+
+        // fwiw, this is how N stores update info
+        if (e.updated.length() >= 6) {
+            r.updated_num = std::atoi(e.updated.c_str()); // day
+            r.updated_num += std::atoi(e.updated.c_str() + 3) * 100; // month
+            r.updated_num += std::atoi(e.updated.c_str() + 6) * 100 * 100; // year
+        }
+
+        // a word is only added once per entry, using the best weight.
+        std::unordered_map<std::string, u32> words;
+        const auto add_words = [&words](std::string_view str, u32 weight) {
+            ForEachWord(str, [&](const std::string& word) {
+                auto& w = words[word];
+                w = std::max(w, weight);
+            });
+        };
+
+        add_words(e.title, SEARCH_WEIGHT_TITLE);
+        add_words(e.author, SEARCH_WEIGHT_AUTHOR);
+        add_words(e.description, SEARCH_WEIGHT_DESCRIPTION);
+
+        for (const auto& [word, weight] : words) {
+            auto& t = tokens.emplace_back();
+            t.str_off = add_pool(word);
+            t.str_len = word.length();
+            t.entry = i;
+            t.weight = weight;
+        }
+    }
+
+    std::ranges::sort(tokens, [&pool](const IndexToken& lhs, const IndexToken& rhs) {
+        const auto lhs_str = GetTokenStr(pool.data(), lhs);
+        const auto rhs_str = GetTokenStr(pool.data(), rhs);
+        if (lhs_str == rhs_str) {
+            return lhs.entry < rhs.entry;
+        }
+        return lhs_str < rhs_str;
+    });
+
+    // presort each mode, ignoring the install status as that's checked on load.
+    std::vector<u32> perms[SortType_MAX][OrderType_MAX];
+    for (u32 sort = 0; sort < SortType_MAX; sort++) {
+        for (u32 order = 0; order < OrderType_MAX; order++) {
+            // returns true if lhs should be before rhs
+            const auto sorter = [&](u32 _lhs, u32 _rhs) -> bool {
+                const auto& lhs = entries[_lhs];
+                const auto& rhs = entries[_rhs];
+
+                switch (sort) {
+                    case SortType_Updated: {
+                        const auto lhs_num = records[_lhs].updated_num;
+                        const auto rhs_num = records[_rhs].updated_num;
+                        if (lhs_num == rhs_num) {
+                            return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
+                        } else if (order == OrderType_Descending) {
+                            return lhs_num > rhs_num;
+                        } else {
+                            return lhs_num < rhs_num;
+                        }
+                    } break;
+                    case SortType_Downloads: {
+                        if (lhs.app_dls == rhs.app_dls) {
+                            return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
+                        } else if (order == OrderType_Descending) {
+                            return lhs.app_dls > rhs.app_dls;
+                        } else {
+                            return lhs.app_dls < rhs.app_dls;
+                        }
+                    } break;
+                    case SortType_Size: {
+                        if (lhs.extracted == rhs.extracted) {
+                            return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
+                        } else if (order == OrderType_Descending) {
+                            return lhs.extracted > rhs.extracted;
+                        } else {
+                            return lhs.extracted < rhs.extracted;
+                        }
+                    } break;
+                    case SortType_Alphabetical: {
+                        if (order == OrderType_Descending) {
+                            return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
+                        } else {
+                            return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) > 0;
+                        }
+                    } break;
+                }
+
+                std::unreachable();
+            };
+
+            auto& perm = perms[sort][order];
+            perm.resize(count);
+            for (u32 i = 0; i < count; i++) {
+                perm[i] = i;
+            }
+            std::ranges::sort(perm, sorter);
+        }
+    }
+
+    IndexHeader header{};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.count = count;
+    header.pool_size = pool.size();
+    header.token_count = tokens.size();
+    std::strncpy(header.etag, etag.c_str(), sizeof(header.etag) - 1);
+
+    std::vector<u8> out;
+    out.reserve(sizeof(header) + count * sizeof(IndexRecord) + GetIndexPermsSize(count) + tokens.size() * sizeof(IndexToken) + pool.size());
+    const auto append = [&out](const void* data, u64 size) {
+        out.insert(out.end(), (const u8*)data, (const u8*)data + size);
+    };
+
+    append(&header, sizeof(header));
+    append(records.data(), records.size() * sizeof(IndexRecord));
+    for (const auto& sort : perms) {
+        for (const auto& perm : sort) {
+            append(perm.data(), perm.size() * sizeof(u32));
+        }
+    }
+    append(tokens.data(), tokens.size() * sizeof(IndexToken));
+    append(pool.data(), pool.size());
+
+    R_TRY(fs::FsNativeSd().write_entire_file(INDEX_PATH, out));
+
+    log_write("[APPSTORE] built index, entries: %u tokens: %zu pool: %zu time taken: %.2fs\n", count, tokens.size(), pool.size(), ts.GetSecondsD());
+    R_SUCCEED();
+}
+
 auto ParseManifest(std::span<const char> view) -> ManifestEntries {
     ManifestEntries entries;
     // auto view = std::string_view{manifest_data.data(), manifest_data.size()};
@@ -253,6 +556,47 @@ auto EntryLoadImageFile(const fs::FsPath& path, LazyImage& image) -> bool {
     }
 }
 
+// same as above, but the file is read and decoded off the main thread.
+// returns Progress until finished, call each frame whilst the entry is visible.
+// the thumbnail is keyed on the hash of the file, as it's replaced when the icon is updated.
+auto EntryLoadImageFileAsync(const fs::FsPath& path, LazyImage& image, s64 key, int thumb_size) -> ImageDownloadState {
+    // dropped whilst it was scrolled away.
+    if (image.decode && image.decode->IsCancelled()) {
+        image.decode.reset();
+    }
+
+    if (!image.decode) {
+        image.decode = image::Push([path]() {
+            std::vector<u8> buf;
+            if (R_FAILED(fs::FsNativeSd().read_entire_file(path, buf))) {
+                log_write("failed to load image from file: %s\n", path.s);
+            }
+            return buf;
+        }, ImageFlag_None, key, image::Thumb{0, thumb_size});
+    }
+
+    if (!image.decode->IsDone()) {
+        image.decode->SetKey(key);
+        return ImageDownloadState::Progress;
+    }
+
+    ON_SCOPE_EXIT(image.decode.reset());
+    const auto nvg_image = image.decode->TakeImage();
+    if (!nvg_image) {
+        return ImageDownloadState::Failed;
+    }
+
+    if (image.image) {
+        gfx::deleteImage(App::GetVg(), image.image);
+    }
+
+    image.image = nvg_image;
+    image.w = image.decode->GetWidth();
+    image.h = image.decode->GetHeight();
+    std::memcpy(image.first_pixel, image.decode->GetFirstPixel(), sizeof(image.first_pixel));
+    return ImageDownloadState::Done;
+}
+
 void DrawIcon(NVGcontext* vg, const LazyImage& l, const LazyImage& d, float x, float y, float w, float h, bool rounded = true, float scale = 1.0) {
     const auto& i = l.image ? l : d;
 
@@ -333,7 +677,7 @@ auto UninstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
 
     if (manifest.empty()) {
         if (!entry.binary.empty()) {
-            R_TRY(fs.DeleteFile(entry.binary));
+            R_TRY(fs.DeleteFile(entry.binary.c_str()));
         }
     } else {
         for (auto& e : manifest) {
@@ -364,13 +708,432 @@ auto UninstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
     R_SUCCEED();
 }
 
+// removes the files from the old manifest that are no longer in the new one.
+void RemoveOldManifestEntries(fs::Fs& fs, const ManifestEntries& old_manifest, const ManifestEntries& new_manifest) {
+    for (auto& old_entry : old_manifest) {
+        bool found = false;
+        for (auto& new_entry : new_manifest) {
+            if (!strcasecmp(old_entry.path, new_entry.path)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            const auto safe_buf = fs::AppendPath("/", old_entry.path);
+            // std::strcat(safe_buf, old_entry.path);
+            if (R_FAILED(fs.DeleteFile(safe_buf))) {
+                log_write("failed to delete: %s\n", safe_buf.s);
+            } else {
+                log_write("deleted file: %s\n", safe_buf.s);
+                svcSleepThread(1e+5);
+            }
+        }
+    }
+}
+
+using StagedEntries = std::vector<std::pair<fs::FsPath, fs::FsPath>>;
+
+// parses the staged manifest and moves the staged entries into place,
+// then removes the files no longer in the manifest.
+auto CommitStaged(ProgressBox* pbox, fs::Fs& fs, const Entry& entry, const StagedEntries& staged) -> Result {
+    const auto find_staged = [&](const char* name) -> const fs::FsPath* {
+        const auto it = std::ranges::find_if(staged, [name](auto& e) {
+            return !strcasecmp(name, e.first);
+        });
+
+        if (it == staged.end()) {
+            return nullptr;
+        }
+
+        return &it->second;
+    };
+
+    const auto commit = [&](const fs::FsPath& src, const fs::FsPath& dst) -> Result {
+        fs.CreateDirectoryRecursivelyWithPath(dst);
+        fs.DeleteFile(dst);
+        return fs.RenameFile(src, dst);
+    };
+
+    const auto manifest_path = find_staged("manifest.install");
+    if (!manifest_path) {
+        log_write("failed to find manifest.install\n");
+        R_THROW(Result_UnzLocateFile);
+    }
+
+    std::vector<u8> manifest_data;
+    R_TRY(fs.read_entire_file(*manifest_path, manifest_data));
+
+    const auto new_manifest = ParseManifest(std::span{(const char*)manifest_data.data(), manifest_data.size()});
+    if (new_manifest.empty()) {
+        log_write("manifest is empty!\n");
+        R_THROW(Result_AppstoreFailedParseManifest);
+    }
+
+    const auto old_manifest = LoadAndParseManifest(entry);
+
+    if (const auto info_path = find_staged("info.json")) {
+        R_TRY(commit(*info_path, BuildInfoCachePath(entry)));
+    } else {
+        log_write("failed to find info.json\n");
+        R_THROW(Result_UnzLocateFile);
+    }
+    R_TRY(commit(*manifest_path, BuildManifestCachePath(entry)));
+
+    for (const auto& e : new_manifest) {
+        // partial updates only stage the entries that changed.
+        const auto path = find_staged(e.path);
+        if (!path) {
+            continue;
+        }
+
+        switch (e.command) {
+            case 'E': // both are the same?
+            case 'U':
+                break;
+
+            case 'G': // checks if file exists, if not, extract
+                if (fs.FileExists(fs::AppendPath("/", e.path))) {
+                    continue;
+                }
+                break;
+
+            default:
+                log_write("bad command: %c\n", e.command);
+                continue;
+        }
+
+        pbox->NewTransfer(e.path);
+        R_TRY(commit(*path, fs::AppendPath("/", e.path)));
+    }
+
+    // finally finally, remove files no longer in the manifest
+    RemoveOldManifestEntries(fs, old_manifest, new_manifest);
+    R_SUCCEED();
+}
+
+// this is called by ProgressBox on a seperate thread
+// the zip is extracted whilst it downloads, rather than writing it to the sd
+// card and then reading it back.
+// it has 3 main steps
+// 1. download the zip, extracting each entry to a staging folder and md5 the zip
+// 2. md5 check the zip
+// 3. parse manifest and move everything from the staging folder to normal location
+auto InstallAppStream(ProgressBox* pbox, const Entry& entry) -> Result {
+    fs::FsNativeSd fs;
+    R_TRY(fs.GetFsOpenResult());
+
+    fs.DeleteDirectoryRecursively(STAGE_PATH);
+    R_TRY(fs.CreateDirectoryRecursively(STAGE_PATH));
+    ON_SCOPE_EXIT(fs.DeleteDirectoryRecursively(STAGE_PATH));
+
+    // name in zip and the path it was staged to.
+    StagedEntries staged;
+
+    mz::StreamUnzip unzip{&fs, [&](const fs::FsPath& name, s64 size) -> fs::FsPath {
+        const auto path = fs::AppendPath(STAGE_PATH, std::to_string(staged.size()));
+        staged.emplace_back(name, path);
+        return path;
+    }};
+
+    utils::Md5 md5;
+    Result stream_rc{};
+
+    // 1. download and extract the zip
+    if (!pbox->ShouldExit()) {
+        pbox->NewTransfer(i18n::Reorder("Downloading ", entry.title));
+        log_write("starting stream download\n");
+
+        const auto result = curl::Api().ToMemory(
+            curl::Url{BuildZipUrl(entry)},
+            curl::OnProgress{pbox->OnDownloadProgressCallback()},
+            curl::OnData{[&](const void* data, size_t size) -> bool {
+                md5.Update(data, size);
+                stream_rc = unzip.Push(data, size);
+                return R_SUCCEEDED(stream_rc);
+            }}
+        );
+
+        // the stream error takes priority as it's why the download stopped.
+        R_TRY(stream_rc);
+        R_UNLESS(result.success, Result_AppstoreFailedZipDownload);
+        R_TRY(unzip.Finish());
+    }
+
+    // 2. md5 check the zip, nothing has been installed yet.
+    if (!pbox->ShouldExit()) {
+        u8 hash[utils::Md5::HASH_SIZE];
+        md5.GetHash(hash);
+
+        char hash_out[utils::Md5::HASH_SIZE * 2 + 1];
+        for (u32 i = 0; i < utils::Md5::HASH_SIZE; i++) {
+            std::snprintf(hash_out + i * 2, 3, "%02x", hash[i]);
+        }
+
+        if (strncasecmp(hash_out, entry.md5.data(), entry.md5.length())) {
+            log_write("bad md5: %.*s vs %.*s\n", 32, hash_out, 32, entry.md5.c_str());
+            R_THROW(Result_AppstoreFailedMd5);
+        }
+    }
+
+    R_TRY(pbox->ShouldExitResult());
+
+    // 3. parse the manifest and move everything into place.
+    TimeStamp ts;
+    R_TRY(CommitStaged(pbox, fs, entry, staged));
+    log_write("\n\t[APPSTORE] finished stream install, time taken: %.2fs %zums\n\n", ts.GetSecondsD(), ts.GetMs());
+    log_write("finished install :)\n");
+    R_SUCCEED();
+}
+
+// builds the range header, a negative offset fetches the last size bytes.
+auto BuildRangeHeader(s64 off, s64 size) -> curl::Header {
+    char range[64];
+    if (off < 0) {
+        std::snprintf(range, sizeof(range), "bytes=-%lld", (long long)size);
+    } else {
+        std::snprintf(range, sizeof(range), "bytes=%lld-%lld", (long long)off, (long long)(off + size - 1));
+    }
+
+    return curl::Header{{"Range", range}};
+}
+
+// returns the size of the file from "content-range: bytes 0-99/1000".
+// fails if the server ignored the range and sent the whole file.
+auto GetRangeTotal(const curl::ApiResult& result, s64& total) -> bool {
+    if (result.code != 206) {
+        return false;
+    }
+
+    const auto it = result.header.Find("content-range");
+    if (it == result.header.m_map.end()) {
+        return false;
+    }
+
+    const auto slash = it->second.find('/');
+    if (slash == std::string::npos) {
+        return false;
+    }
+
+    total = std::strtoll(it->second.c_str() + slash + 1, nullptr, 10);
+    return total > 0;
+}
+
+// returns true if the installed file matches the entry in the zip.
+auto IsFileUnchanged(ProgressBox* pbox, fs::Fs& fs, const fs::FsPath& path, const mz::CentralEntry& e) -> bool {
+    {
+        fs::File f;
+        s64 size;
+        if (R_FAILED(fs.OpenFile(path, FsOpenMode_Read, &f)) || R_FAILED(f.GetSize(&size)) || size != e.uncompressed_size) {
+            return false;
+        }
+    }
+
+    std::string hash_out;
+    if (R_FAILED(hash::Hash(pbox, hash::Type::Crc32, &fs, path, hash_out))) {
+        return false;
+    }
+
+    return std::strtoul(hash_out.c_str(), nullptr, 16) == e.crc32;
+}
+
+// this is called by ProgressBox on a seperate thread
+// updates an installed entry by only downloading the files that changed.
+// the central directory is fetched using http ranges, and the crc / size of
+// each entry is compared against the installed file.
+// it has 3 main steps
+// 1. fetch the end record and central directory
+// 2. fetch the manifest and each changed entry, extracting them to a staging folder
+// 3. parse manifest and move everything from the staging folder to normal location
+// the zip md5 can't be checked as only part of it is downloaded, instead the
+// crc of each entry is checked as it's extracted.
+auto InstallAppPartial(ProgressBox* pbox, const Entry& entry) -> Result {
+    // the end record is 22 bytes, followed by an upto 64KiB comment.
+    constexpr s64 TAIL_SIZE = 1024 * 64 + 22;
+    // past this, it's faster to download the zip in a single request.
+    constexpr auto MAX_CHANGED_RATIO = 0.5;
+
+    fs::FsNativeSd fs;
+    R_TRY(fs.GetFsOpenResult());
+
+    const auto url = BuildZipUrl(entry);
+
+    // 1. fetch the end record and central directory.
+    pbox->NewTransfer("Checking for changes"_i18n);
+    const auto tail = curl::Api().ToMemory(
+        curl::Url{url},
+        BuildRangeHeader(-1, TAIL_SIZE)
+    );
+    R_UNLESS(tail.success, Result_AppstoreFailedZipDownload);
+
+    s64 zip_size;
+    R_UNLESS(GetRangeTotal(tail, zip_size), Result_MmzStreamUnsupported);
+    const auto tail_off = zip_size - (s64)tail.data.size();
+
+    s64 cd_off, cd_size;
+    u32 cd_count;
+    R_TRY(mz::FindCentralDirectory(tail.data, cd_off, cd_size, cd_count));
+    R_UNLESS(cd_off + cd_size <= zip_size, Result_MmzBadEndRecord);
+
+    mz::CentralEntries central;
+    if (cd_off >= tail_off) {
+        R_TRY(mz::ParseCentralDirectory(std::span{tail.data}.subspan(cd_off - tail_off), cd_count, central));
+    } else {
+        const auto result = curl::Api().ToMemory(
+            curl::Url{url},
+            BuildRangeHeader(cd_off, cd_size)
+        );
+        R_UNLESS(result.success && result.code == 206, Result_AppstoreFailedZipDownload);
+        R_TRY(mz::ParseCentralDirectory(result.data, cd_count, central));
+    }
+
+    // each local entry runs upto the next one, or the central directory.
+    std::ranges::sort(central, {}, &mz::CentralEntry::local_hdr_off);
+    const auto get_extent = [&](u32 i) -> std::pair<s64, s64> {
+        const auto end = i + 1 < central.size() ? central[i + 1].local_hdr_off : cd_off;
+        return {central[i].local_hdr_off, end - central[i].local_hdr_off};
+    };
+
+    const auto find_central = [&](const char* name) -> std::optional<u32> {
+        for (u32 i = 0; i < central.size(); i++) {
+            if (!strcasecmp(name, central[i].name)) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    };
+
+    fs.DeleteDirectoryRecursively(STAGE_PATH);
+    R_TRY(fs.CreateDirectoryRecursively(STAGE_PATH));
+    ON_SCOPE_EXIT(fs.DeleteDirectoryRecursively(STAGE_PATH));
+
+    // name in zip and the path it was staged to.
+    StagedEntries staged;
+
+    // index into central of the entries to fetch, sorted by offset.
+    const auto fetch = [&](std::span<const u32> indices, s64 total) -> Result {
+        s64 done{};
+        for (u32 i = 0; i < indices.size();) {
+            // merge entries that are next to each other into a single range.
+            auto [off, len] = get_extent(indices[i]);
+            u32 count = 1;
+            while (i + count < indices.size() && indices[i + count] == indices[i] + count) {
+                len += get_extent(indices[i + count]).second;
+                count++;
+            }
+
+            pbox->NewTransfer(central[indices[i]].name);
+
+            mz::StreamUnzip unzip{&fs, [&](const fs::FsPath& name, s64 size) -> fs::FsPath {
+                const auto path = fs::AppendPath(STAGE_PATH, std::to_string(staged.size()));
+                staged.emplace_back(name, path);
+                return path;
+            }};
+
+            Result stream_rc{};
+            const auto result = curl::Api().ToMemory(
+                curl::Url{url},
+                BuildRangeHeader(off, len),
+                curl::OnProgress{[&](s64 dltotal, s64 dlnow, s64 ultotal, s64 ulnow) -> bool {
+                    pbox->UpdateTransfer(done + dlnow, total);
+                    return !pbox->ShouldExit();
+                }},
+                curl::OnData{[&](const void* data, size_t size) -> bool {
+                    stream_rc = unzip.Push(data, size);
+                    return R_SUCCEEDED(stream_rc);
+                }}
+            );
+
+            R_TRY(stream_rc);
+            R_TRY(pbox->ShouldExitResult());
+            R_UNLESS(result.success && result.code == 206, Result_AppstoreFailedZipDownload);
+            R_TRY(unzip.Finish());
+
+            done += len;
+            i += count;
+        }
+
+        R_SUCCEED();
+    };
+
+    // 2. fetch the manifest and info, then every entry that changed.
+    std::vector<u32> wanted;
+    for (const auto name : {"info.json", "manifest.install"}) {
+        const auto i = find_central(name);
+        if (!i) {
+            log_write("failed to find %s\n", name);
+            R_THROW(Result_UnzLocateFile);
+        }
+        wanted.emplace_back(*i);
+    }
+    std::ranges::sort(wanted);
+    R_TRY(fetch(wanted, get_extent(wanted[0]).second + get_extent(wanted[1]).second));
+
+    const auto manifest_path = std::ranges::find_if(staged, [](auto& e) {
+        return !strcasecmp("manifest.install", e.first);
+    });
+    R_UNLESS(manifest_path != staged.end(), Result_UnzLocateFile);
+
+    std::vector<u8> manifest_data;
+    R_TRY(fs.read_entire_file(manifest_path->second, manifest_data));
+    const auto new_manifest = ParseManifest(std::span{(const char*)manifest_data.data(), manifest_data.size()});
+    R_UNLESS(!new_manifest.empty(), Result_AppstoreFailedParseManifest);
+
+    pbox->NewTransfer("Checking for changes"_i18n);
+    wanted.clear();
+    s64 changed_size{};
+    for (const auto& e : new_manifest) {
+        R_TRY(pbox->ShouldExitResult());
+
+        const auto i = find_central(e.path);
+        if (!i) {
+            continue;
+        }
+
+        const auto path = fs::AppendPath("/", e.path);
+        switch (e.command) {
+            case 'E': // both are the same?
+            case 'U':
+                if (IsFileUnchanged(pbox, fs, path, central[*i])) {
+                    continue;
+                }
+                break;
+
+            case 'G': // checks if file exists, if not, extract
+                if (fs.FileExists(path)) {
+                    continue;
+                }
+                break;
+
+            default:
+                continue;
+        }
+
+        wanted.emplace_back(*i);
+        changed_size += get_extent(*i).second;
+    }
+
+    log_write("[APPSTORE] partial update: %zu changed, %lld of %lld bytes\n", wanted.size(), (long long)changed_size, (long long)zip_size);
+    R_UNLESS(changed_size <= zip_size * MAX_CHANGED_RATIO, Result_MmzStreamUnsupported);
+
+    std::ranges::sort(wanted);
+    TimeStamp ts;
+    R_TRY(fetch(wanted, changed_size));
+
+    // 3. parse the manifest and move everything into place.
+    R_TRY(CommitStaged(pbox, fs, entry, staged));
+    log_write("\n\t[APPSTORE] finished partial install, time taken: %.2fs %zums\n\n", ts.GetSecondsD(), ts.GetMs());
+    log_write("finished install :)\n");
+    R_SUCCEED();
+}
+
 // this is called by ProgressBox on a seperate thread
 // it has 4 main steps
 // 1. download the zip
 // 2. md5 check the zip
 // 3. parse manifest and unzip everything to placeholder
 // 4. move everything from placeholder to normal location
-auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
+auto InstallAppFromZip(ProgressBox* pbox, const Entry& entry) -> Result {
     static const fs::FsPath zip_out{"/switch/sphaira/cache/appstore/temp.zip"};
     std::vector<u8> buf(1024 * 512); // 512KiB
 
@@ -395,6 +1158,7 @@ auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
 
         if (file_download) {
             api.SetOption(curl::Path{zip_out});
+            api.SetOption(curl::Flags{curl::Flag_Segmented});
             api_result = curl::ToFile(api);
         } else {
             api_result = curl::ToMemory(api);
@@ -506,7 +1270,7 @@ auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
         R_TRY(unzip_to("manifest.install", BuildManifestCachePath(entry)));
         #endif
 
-        R_TRY(thread::TransferUnzipAll(pbox, zfile, &fs, "/", [&](const fs::FsPath& name, fs::FsPath& path) -> bool {
+        const auto filter = [&](const fs::FsPath& name, fs::FsPath& path) -> bool {
             const auto it = std::ranges::find_if(new_manifest, [&name](auto& e){
                 return !strcasecmp(name, e.path);
             });
@@ -529,37 +1293,47 @@ auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
                     log_write("bad command: %c\n", it->command);
                     return false;
             }
-        }));
+        };
+
+        // zips downloaded to a file can be extracted in parallel as each worker can reopen it.
+        if (file_download) {
+            R_TRY(thread::TransferUnzipAll(pbox, zip_out, &fs, "/", filter));
+        } else {
+            R_TRY(thread::TransferUnzipAll(pbox, zfile, &fs, "/", filter));
+        }
 
         log_write("\n\t[APPSTORE] finished extract new, time taken: %.2fs %zums\n\n", ts.GetSecondsD(), ts.GetMs());
 
         // finally finally, remove files no longer in the manifest
-        for (auto& old_entry : old_manifest) {
-            bool found = false;
-            for (auto& new_entry : new_manifest) {
-                if (!strcasecmp(old_entry.path, new_entry.path)) {
-                    found = true;
-                    break;
-                }
-            }
-
-            if (!found) {
-                const auto safe_buf = fs::AppendPath("/", old_entry.path);
-                // std::strcat(safe_buf, old_entry.path);
-                if (R_FAILED(fs.DeleteFile(safe_buf))) {
-                    log_write("failed to delete: %s\n", safe_buf.s);
-                } else {
-                    log_write("deleted file: %s\n", safe_buf.s);
-                    svcSleepThread(1e+5);
-                }
-            }
-        }
+        RemoveOldManifestEntries(fs, old_manifest, new_manifest);
     }
 
     log_write("finished install :)\n");
     R_SUCCEED();
 }
 
+auto InstallApp(ProgressBox* pbox, const Entry& entry) -> Result {
+    // installed entries only download what changed, nothing is installed
+    // until everything has been fetched, so any failure can fallback.
+    if (!LoadAndParseManifest(entry).empty()) {
+        const auto rc = InstallAppPartial(pbox, entry);
+        if (R_SUCCEEDED(rc) || pbox->ShouldExit()) {
+            return rc;
+        }
+        log_write("partial update failed: 0x%X, falling back to full download\n", rc);
+    }
+
+    // zips that can't be streamed, ie, stored entries with a data descriptor,
+    // are downloaded and extracted as before.
+    const auto rc = InstallAppStream(pbox, entry);
+    if (rc == Result_MmzStreamUnsupported) {
+        log_write("zip can't be streamed, falling back to download\n");
+        return InstallAppFromZip(pbox, entry);
+    }
+
+    return rc;
+}
+
 // case-insensitive version of str.find()
 auto FindCaseInsensitive(std::string_view base, std::string_view term) -> bool {
     const auto it = std::search(base.cbegin(), base.cend(), term.cbegin(), term.cend(), [](char a, char b){
@@ -599,9 +1373,9 @@ EntryMenu::EntryMenu(Entry& entry, const LazyImage& default_icon, Menu& menu)
 
             options->Add<SidebarEntryCallback>("Leave Feedback"_i18n, [this](){
                 std::string out;
-                std::string header = "Leave feedback for " + m_entry.title;
+                std::string header = "Leave feedback for " + std::string{m_entry.title};
                 if (R_SUCCEEDED(swkbd::ShowText(out, header.c_str())) && !out.empty()) {
-                    const auto post = "name=" "switch_user" "&package=" + m_entry.name + "&message=" + out;
+                    const auto post = "name=" "switch_user" "&package=" + std::string{m_entry.name} + "&message=" + out;
                     const auto file = BuildFeedbackCachePath(m_entry);
 
                     curl::Api().ToAsync(
@@ -660,7 +1434,7 @@ EntryMenu::EntryMenu(Entry& entry, const LazyImage& default_icon, Menu& menu)
         }})
     );
 
-    SetTitleSubHeading("by " + m_entry.author);
+    SetTitleSubHeading("by " + std::string{m_entry.author});
 
     m_details = std::make_unique<ScrollableText>(m_entry.details, 0, 374, 250, 768, 18);
     m_changelog = std::make_unique<ScrollableText>(m_entry.changelog, 0, 374, 250, 768, 18);
@@ -988,8 +1762,19 @@ Menu::Menu(u32 flags) : grid::Menu{"AppStore"_i18n, flags} {
         curl::OnComplete{[this](auto& result){
             if (result.success) {
                 m_repo_download_state = ImageDownloadState::Done;
-                if (HasFocus()) {
+
+                // the index that's already loaded is still valid.
+                const auto etag = GetEtag(result);
+                if (!m_entries.empty() && !etag.empty() && etag == m_index_etag) {
+                    return;
+                }
+
+                if (R_FAILED(BuildIndex(REPO_PATH, etag))) {
+                    log_write("failed to build appstore index\n");
+                } else if (HasFocus()) {
                     ScanHomebrew();
+                } else {
+                    m_index_changed = true;
                 }
             } else {
                 m_repo_download_state = ImageDownloadState::Failed;
@@ -1029,22 +1814,27 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
-
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_list->Draw(vg, theme, m_entries_current.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         const auto index = m_entries_current[pos];
         auto& e = m_entries[index];
         auto& image = e.image;
 
+        // icons closest to the selected entry are loaded / downloaded first.
+        const auto request_key = std::abs(pos - m_index);
+
+        // evicted from the icon atlas, so load it from the cache again.
+        if (image.image && gfx::isImageEvicted(image.image)) {
+            image.image = 0;
+            image.tried_cache = false;
+        }
+
         // try and load cached image.
-        if (image_load_count < image_load_max && !image.image && !image.tried_cache) {
-            image.tried_cache = true;
-            image.cached = EntryLoadImageFile(BuildIconCachePath(e), image);
-            if (image.cached) {
-                image_load_count++;
+        if (!image.image && !image.tried_cache) {
+            const auto state = EntryLoadImageFileAsync(BuildIconCachePath(e), image, request_key, GetThumbSize(m_layout.Get()));
+            if (state != ImageDownloadState::Progress) {
+                image.tried_cache = true;
+                image.cached = state == ImageDownloadState::Done;
             }
         }
 
@@ -1055,11 +1845,13 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
                     const auto path = BuildIconCachePath(e);
                     const auto url = BuildIconUrl(e);
                     image.state = ImageDownloadState::Progress;
+                    image.request = curl::CreateRequest(request_key);
                     curl::Api().ToFileAsync(
                         curl::Url{url},
                         curl::Path{path},
                         curl::Flags{curl::Flag_Cache},
                         curl::StopToken{this->GetToken()},
+                        curl::RequestHandle{image.request},
                         curl::OnComplete{[this, &image](auto& result) {
                             if (result.success) {
                                 image.state = ImageDownloadState::Done;
@@ -1075,15 +1867,22 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
                     });
                 }   break;
                 case ImageDownloadState::Progress: {
-
+                    // keeps the request from going stale whilst it's visible.
+                    if (image.request) {
+                        image.request->SetKey(request_key);
+                    }
                 }   break;
                 case ImageDownloadState::Done: {
-                    if (image_load_count < image_load_max) {
+                    if (image.image) {
                         image.cached = false;
-                        if (!EntryLoadImageFile(BuildIconCachePath(e), e.image)) {
-                            image.state = ImageDownloadState::Failed;
-                        } else {
-                            image_load_count++;
+                    } else if (image.tried_cache) {
+                        // otherwise, wait for the cached decode to finish.
+                        const auto state = EntryLoadImageFileAsync(BuildIconCachePath(e), image, request_key, GetThumbSize(m_layout.Get()));
+                        if (state != ImageDownloadState::Progress) {
+                            image.cached = false;
+                            if (state == ImageDownloadState::Failed) {
+                                image.state = ImageDownloadState::Failed;
+                            }
                         }
                     }
                 }   break;
@@ -1130,13 +1929,11 @@ void Menu::OnFocusGained() {
         EntryLoadImageData(INSTALLED_IMAGE_DATA, m_installed);
     }
 
-    if (m_entries.empty()) {
-        // log_write("got focus with empty size: size: %zu count: %zu\n", repo_json.size(), m_entries.size());
-
-        if (m_repo_download_state == ImageDownloadState::Done) {
-            // log_write("is done: size: %zu count: %zu\n", repo_json.size(), m_entries.size());
-            ScanHomebrew();
-        }
+    // the index from the last time is loaded straight away, rather than
+    // waiting for repo.json to be checked.
+    if (m_entries.empty() || m_index_changed) {
+        m_index_changed = false;
+        ScanHomebrew();
     } else {
         if (m_dirty) {
             m_dirty = false;
@@ -1171,11 +1968,101 @@ void Menu::SetIndex(s64 index) {
     this->SetSubHeading(std::to_string(m_index + 1) + " / " + std::to_string(m_entries_current.size()));
 }
 
+Result Menu::LoadIndex() {
+    std::vector<u8> data;
+    R_TRY(fs::FsNativeSd().read_entire_file(INDEX_PATH, data));
+
+    IndexHeader header;
+    R_UNLESS(data.size() >= sizeof(header), Result_AppstoreBadIndex);
+    std::memcpy(&header, data.data(), sizeof(header));
+    R_UNLESS(header.magic == INDEX_MAGIC, Result_AppstoreBadIndex);
+    R_UNLESS(header.version == INDEX_VERSION, Result_AppstoreBadIndex);
+
+    const u64 records_off = sizeof(header);
+    const u64 perms_off = records_off + (u64)header.count * sizeof(IndexRecord);
+    const u64 tokens_off = perms_off + GetIndexPermsSize(header.count);
+    const u64 pool_off = tokens_off + (u64)header.token_count * sizeof(IndexToken);
+    R_UNLESS(pool_off + header.pool_size == data.size(), Result_AppstoreBadIndex);
+    R_UNLESS(header.pool_size && !data.back(), Result_AppstoreBadIndex);
+
+    const auto pool = (const char*)data.data() + pool_off;
+    std::vector<Entry> entries(header.count);
+
+    for (u32 i = 0; i < header.count; i++) {
+        IndexRecord r;
+        std::memcpy(&r, data.data() + records_off + i * sizeof(r), sizeof(r));
+
+        for (u32 j = 0; j < IndexStr_MAX; j++) {
+            R_UNLESS((u64)r.str_off[j] + r.str_len[j] < header.pool_size, Result_AppstoreBadIndex);
+        }
+
+        const auto get_str = [&](IndexStr type) {
+            return PoolString{pool + r.str_off[type], r.str_len[type]};
+        };
+
+        auto& e = entries[i];
+        e.category = get_str(IndexStr_Category);
+        e.binary = get_str(IndexStr_Binary);
+        e.updated = get_str(IndexStr_Updated);
+        e.name = get_str(IndexStr_Name);
+        e.license = get_str(IndexStr_License);
+        e.title = get_str(IndexStr_Title);
+        e.url = get_str(IndexStr_Url);
+        e.description = get_str(IndexStr_Description);
+        e.author = get_str(IndexStr_Author);
+        e.changelog = get_str(IndexStr_Changelog);
+        e.version = get_str(IndexStr_Version);
+        e.details = get_str(IndexStr_Details);
+        e.md5 = get_str(IndexStr_Md5);
+        e.screens = r.screens;
+        e.extracted = r.extracted;
+        e.filesize = r.filesize;
+        e.app_dls = r.app_dls;
+        e.updated_num = r.updated_num;
+    }
+
+    // the sort rank is the inverse of the presorted permutation.
+    auto perm = (const u32*)(data.data() + perms_off);
+    for (auto& sort : m_sort_rank) {
+        for (auto& rank : sort) {
+            rank.resize(header.count);
+            for (u32 i = 0; i < header.count; i++) {
+                R_UNLESS(perm[i] < header.count, Result_AppstoreBadIndex);
+                rank[perm[i]] = i;
+            }
+            perm += header.count;
+        }
+    }
+
+    const auto tokens = (const IndexToken*)(data.data() + tokens_off);
+    for (u32 i = 0; i < header.token_count; i++) {
+        const auto& t = tokens[i];
+        R_UNLESS((u64)t.str_off + t.str_len < header.pool_size && t.entry < header.count, Result_AppstoreBadIndex);
+    }
+
+    header.etag[sizeof(header.etag) - 1] = '\0';
+    m_index_etag = header.etag;
+    m_entries = std::move(entries);
+    // the buffer is moved, so the pointers stay valid.
+    m_search_tokens = tokens;
+    m_search_token_count = header.token_count;
+    m_search_pool = pool;
+    m_index_data = std::move(data);
+    R_SUCCEED();
+}
+
 void Menu::ScanHomebrew() {
     App::SetBoostMode(true);
     ON_SCOPE_EXIT(App::SetBoostMode(false));
 
-    from_json(REPO_PATH, m_entries);
+    if (R_FAILED(LoadIndex())) {
+        // the index may be from an older version, or missing, so rebuild it
+        // from repo.json if that has been downloaded.
+        if (m_repo_download_state != ImageDownloadState::Done || R_FAILED(BuildIndex(REPO_PATH, {})) || R_FAILED(LoadIndex())) {
+            log_write("failed to load appstore index\n");
+            return;
+        }
+    }
 
     fs::FsNativeSd fs;
     if (R_FAILED(fs.GetFsOpenResult())) {
@@ -1185,6 +2072,7 @@ void Menu::ScanHomebrew() {
 
     // pre-allocate the max size, can shrink later if needed
     for (auto& index : m_entries_index) {
+        index.clear();
         index.reserve(m_entries.size());
     }
 
@@ -1209,11 +2097,6 @@ void Menu::ScanHomebrew() {
             m_entries_index[Filter_Misc].push_back(i);
         }
 
-        // fwiw, this is how N stores update info
-        e.updated_num = std::atoi(e.updated.c_str()); // day
-        e.updated_num += std::atoi(e.updated.c_str() + 3) * 100; // month
-        e.updated_num += std::atoi(e.updated.c_str() + 6) * 100 * 100; // year
-
         e.status = EntryStatus::Get;
         // if binary is present, check for it, if not avalible, report as not installed
         // if there is not a binary path, then we have to trust the info.json
@@ -1222,7 +2105,7 @@ void Menu::ScanHomebrew() {
         if (e.binary.empty() || e.binary == "none") {
             ReadFromInfoJson(e);
         } else {
-            if (fs.FileExists(e.binary)) {
+            if (fs.FileExists(e.binary.c_str())) {
                 // first check the info.json
                 ReadFromInfoJson(e);
                 // if we get here, this means that we have the file, but not the .info file
@@ -1234,7 +2117,7 @@ void Menu::ScanHomebrew() {
                     // ignore hbmenu if it was replaced with sphaira.
                     if (e.name == "hbmenu") {
                         NacpStruct nacp;
-                        if (R_SUCCEEDED(nro_get_nacp(e.binary, nacp))) {
+                        if (R_SUCCEEDED(nro_get_nacp(e.binary.c_str(), nacp))) {
                             filtered = std::strcmp(nacp.lang[0].name, "nx-hbmenu");
                         }
                     }
@@ -1275,11 +2158,16 @@ void Menu::Sort() {
     const auto filter = m_filter.Get();
 
     // returns true if lhs should be before rhs
-    const auto sorter = [this, sort, order](EntryMini _lhs, EntryMini _rhs) -> bool {
+    const auto sorter = [this, &rank = m_sort_rank[sort][order]](EntryMini _lhs, EntryMini _rhs) -> bool {
         const auto& lhs = m_entries[_lhs];
         const auto& rhs = m_entries[_rhs];
 
-        // fallback to name compare if the updated num is the same
+        // search results are ranked by how well they match first.
+        if (m_is_search && !m_is_author && m_search_score[_lhs] != m_search_score[_rhs]) {
+            return m_search_score[_lhs] > m_search_score[_rhs];
+        }
+
+        // fallback to the presorted index if the status is the same
         if (lhs.status == EntryStatus::Update && !(rhs.status == EntryStatus::Update)) {
             return true;
         } else if (!(lhs.status == EntryStatus::Update) && rhs.status == EntryStatus::Update) {
@@ -1293,48 +2181,10 @@ void Menu::Sort() {
         } else if (!(lhs.status == EntryStatus::Local) && rhs.status == EntryStatus::Local) {
             return false;
         } else {
-            switch (sort) {
-                case SortType_Updated: {
-                    if (lhs.updated_num == rhs.updated_num) {
-                        return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
-                    } else if (order == OrderType_Descending) {
-                        return lhs.updated_num > rhs.updated_num;
-                    } else {
-                        return lhs.updated_num < rhs.updated_num;
-                    }
-                } break;
-                case SortType_Downloads: {
-                    if (lhs.app_dls == rhs.app_dls) {
-                        return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
-                    } else if (order == OrderType_Descending) {
-                        return lhs.app_dls > rhs.app_dls;
-                    } else {
-                        return lhs.app_dls < rhs.app_dls;
-                    }
-                } break;
-                case SortType_Size: {
-                    if (lhs.extracted == rhs.extracted) {
-                        return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
-                    } else if (order == OrderType_Descending) {
-                        return lhs.extracted > rhs.extracted;
-                    } else {
-                        return lhs.extracted < rhs.extracted;
-                    }
-                } break;
-                case SortType_Alphabetical: {
-                    if (order == OrderType_Descending) {
-                        return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) < 0;
-                    } else {
-                        return strcasecmp(lhs.name.c_str(), rhs.name.c_str()) > 0;
-                    }
-                } break;
-            }
-
-            std::unreachable();
+            return rank[_lhs] < rank[_rhs];
         }
     };
 
-
     char subheader[128]{};
     std::snprintf(subheader, sizeof(subheader), "Filter: %s | Sort: %s | Order: %s"_i18n.c_str(), i18n::get(FILTER_STR[filter]).c_str(), i18n::get(SORT_STR[sort]).c_str(), i18n::get(ORDER_STR[order]).c_str());
     SetTitleSubHeading(subheader);
@@ -1382,17 +2232,50 @@ void Menu::SetSearch(const std::string& term) {
         m_entry_search_jump_back = m_index;
     }
 
+    TimeStamp ts;
     m_search_term = term;
     m_entries_index_search.clear();
-    const auto query = m_search_term;
+    m_search_score.assign(m_entries.size(), 0);
+
+    const std::span tokens{(const IndexToken*)m_search_tokens, m_search_token_count};
+    // number of words in the term matched by each entry, every word has to match.
+    std::vector<u32> matched(m_entries.size());
+    std::vector<u32> best(m_entries.size());
+    u32 word_count{};
+
+    ForEachWord(m_search_term, [&](const std::string& word) {
+        std::ranges::fill(best, 0);
+
+        const auto proj = [this](const IndexToken& t) { return GetTokenStr(m_search_pool, t); };
+        for (auto it = std::ranges::lower_bound(tokens, std::string_view{word}, {}, proj); it != tokens.end(); it++) {
+            const auto str = proj(*it);
+            if (!str.starts_with(word)) {
+                break;
+            }
+
+            // whole words rank above a prefix.
+            const auto score = str.length() == word.length() ? it->weight * 2 : it->weight;
+            best[it->entry] = std::max(best[it->entry], score);
+        }
+
+        for (u64 i = 0; i < m_entries.size(); i++) {
+            if (best[i] && matched[i] == word_count) {
+                matched[i]++;
+                m_search_score[i] += best[i];
+            }
+        }
+
+        word_count++;
+    });
 
     for (u64 i = 0; i < m_entries.size(); i++) {
-        const auto& e = m_entries[i];
-        if (FindCaseInsensitive(e.title, query) || FindCaseInsensitive(e.author, query) || FindCaseInsensitive(e.description, query)) {
+        if (word_count && matched[i] == word_count) {
             m_entries_index_search.emplace_back(i);
         }
     }
 
+    log_write("[APPSTORE] search: %s results: %zu time taken: %zu us\n", m_search_term.c_str(), m_entries_index_search.size(), ts.GetNs() / 1000);
+
     m_is_search = true;
     m_entries_current = m_entries_index_search;
     SetIndex(0);
@@ -1424,11 +2307,23 @@ void Menu::SetAuthor() {
 void Menu::OnLayoutChange() {
     m_index = 0;
     grid::Menu::OnLayoutChange(m_list, m_layout.Get());
+
+    // reload the icons from the cache at the thumbnail size of the new layout.
+    auto vg = App::GetVg();
+    for (auto& e : m_entries) {
+        auto& image = e.image;
+        if (image.image) {
+            gfx::deleteImage(vg, image.image);
+            image.image = 0;
+        }
+        image.decode.reset();
+        image.tried_cache = false;
+    }
 }
 
 LazyImage::~LazyImage() {
     if (image) {
-        nvgDeleteImage(App::GetVg(), image);
+        gfx::deleteImage(App::GetVg(), image);
     }
 }
 
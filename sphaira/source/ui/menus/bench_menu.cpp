@@ -0,0 +1,834 @@
+#include "ui/menus/bench_menu.hpp"
+#include "ui/menus/file_picker.hpp"
+#include "ui/nvg_util.hpp"
+#include "ui/error_box.hpp"
+
+#include "app.hpp"
+#include "fs.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include "i18n.hpp"
+#include "location.hpp"
+#include "threaded_file_transfer.hpp"
+#include "yati/nx/crypto.hpp"
+#include "utils/zstd_pool.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/devoptab_common.hpp"
+#include "utils/thread.hpp"
+#include "utils/md5.hpp"
+#include "utils/path_index.hpp"
+#include "yati/yati.hpp"
+
+#include <yyjson.h>
+#include <zstd.h>
+#include <mbedtls/md5.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+namespace sphaira::ui::menu::bench {
+namespace {
+
+constexpr auto BENCH_PATH = "/switch/sphaira/bench";
+constexpr auto TEST_FILE_NAME = "sphaira_bench.tmp";
+
+// number of samples per test, the min / median / max are taken from these.
+constexpr u32 ITERATIONS = 5;
+
+// storage tests.
+constexpr s64 SEQ_SIZE = 1024 * 1024 * 64;
+constexpr s64 SEQ_CHUNK_SIZE = 1024 * 1024 * 4;
+constexpr s64 RAND_SIZE = 1024 * 4;
+constexpr u32 RAND_COUNT = 1024 * 2;
+
+// compute tests run over the same buffer this many times.
+constexpr s64 COMPUTE_SIZE = 1024 * 1024 * 4;
+constexpr u32 COMPUTE_LOOPS = 8;
+
+// data sent through thread::Transfer(), nothing is read or written so
+// the speed is the overhead of the pipeline.
+constexpr s64 TRANSFER_SIZE = 1024 * 1024 * 512;
+
+// data moved between two threads in curl sized writes, as done when
+// streaming to / from a network mount.
+constexpr s64 QUEUE_SIZE = 1024 * 1024 * 256;
+constexpr s64 QUEUE_CHUNK_SIZE = CURL_MAX_WRITE_SIZE;
+
+// number of paths in the read only mount tests, each is looked up once.
+constexpr u32 PATH_COUNT = 1024 * 4;
+
+// number of times every translation is looked up.
+constexpr u32 I18N_ITERATIONS = 100;
+
+struct Storage {
+    std::shared_ptr<fs::Fs> fs;
+    fs::FsPath path;
+};
+
+auto GetSpeed(s64 size, u64 start_tick) -> double {
+    const auto seconds = armTicksToNs(armGetSystemTick() - start_tick) / 1e+9;
+    return seconds ? size / seconds / 1024.0 / 1024.0 : 0.0;
+}
+
+// millions of operations per second.
+auto GetRate(u64 count, u64 start_tick) -> double {
+    const auto seconds = armTicksToNs(armGetSystemTick() - start_tick) / 1e+9;
+    return seconds ? count / seconds / 1e+6 : 0.0;
+}
+
+// loosely compressible, so that zstd has something to do.
+auto MakeTestData(s64 size) -> std::vector<u8> {
+    std::vector<u8> data(size);
+    u32 seed = 0x12345678;
+    for (s64 i = 0; i < size; i++) {
+        if (!(i % 64)) {
+            seed = seed * 1664525 + 1013904223;
+        }
+        data[i] = (seed >> 24) ^ (i & 0x7);
+    }
+    return data;
+}
+
+auto CalculateStats(std::vector<double> samples) -> Stats {
+    Stats stats{};
+    stats.samples = samples;
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::ranges::sort(samples);
+    const auto mid = samples.size() / 2;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+    return stats;
+}
+
+Result SeqWrite(ProgressBox* pbox, const Storage& storage, double& speed) {
+    const auto data = MakeTestData(SEQ_CHUNK_SIZE);
+
+    storage.fs->DeleteFile(storage.path);
+    R_TRY(storage.fs->CreateFile(storage.path, SEQ_SIZE, 0));
+
+    fs::File f;
+    R_TRY(storage.fs->OpenFile(storage.path, FsOpenMode_Write, &f));
+
+    const auto start = armGetSystemTick();
+    for (s64 off = 0; off < SEQ_SIZE; off += SEQ_CHUNK_SIZE) {
+        R_TRY(pbox->ShouldExitResult());
+        const auto option = off + SEQ_CHUNK_SIZE >= SEQ_SIZE ? FsWriteOption_Flush : FsWriteOption_None;
+        R_TRY(f.Write(off, data.data(), data.size(), option));
+        pbox->UpdateTransfer(off + SEQ_CHUNK_SIZE, SEQ_SIZE);
+    }
+
+    speed = GetSpeed(SEQ_SIZE, start);
+    R_SUCCEED();
+}
+
+// the read tests need the file to have been written first.
+Result PrepareFile(ProgressBox* pbox, const Storage& storage) {
+    fs::File f;
+    s64 size{};
+    if (R_SUCCEEDED(storage.fs->OpenFile(storage.path, FsOpenMode_Read, &f)) && R_SUCCEEDED(f.GetSize(&size)) && size == SEQ_SIZE) {
+        R_SUCCEED();
+    }
+    f.Close();
+
+    double speed;
+    return SeqWrite(pbox, storage, speed);
+}
+
+Result SeqRead(ProgressBox* pbox, const Storage& storage, double& speed) {
+    R_TRY(PrepareFile(pbox, storage));
+
+    fs::File f;
+    R_TRY(storage.fs->OpenFile(storage.path, FsOpenMode_Read, &f));
+    std::vector<u8> data(SEQ_CHUNK_SIZE);
+
+    const auto start = armGetSystemTick();
+    for (s64 off = 0; off < SEQ_SIZE; off += SEQ_CHUNK_SIZE) {
+        R_TRY(pbox->ShouldExitResult());
+        u64 bytes_read;
+        R_TRY(f.Read(off, data.data(), data.size(), 0, &bytes_read));
+        pbox->UpdateTransfer(off + SEQ_CHUNK_SIZE, SEQ_SIZE);
+    }
+
+    speed = GetSpeed(SEQ_SIZE, start);
+    R_SUCCEED();
+}
+
+Result RandomIo(ProgressBox* pbox, const Storage& storage, bool write, double& speed) {
+    R_TRY(PrepareFile(pbox, storage));
+
+    fs::File f;
+    R_TRY(storage.fs->OpenFile(storage.path, write ? FsOpenMode_Write : FsOpenMode_Read, &f));
+    auto data = MakeTestData(RAND_SIZE);
+
+    // same offsets every run, so that runs can be compared.
+    u32 seed = 0xDEADBEEF;
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < RAND_COUNT; i++) {
+        R_TRY(pbox->ShouldExitResult());
+        seed = seed * 1664525 + 1013904223;
+        const auto off = (s64)(seed % (SEQ_SIZE / RAND_SIZE)) * RAND_SIZE;
+
+        if (write) {
+            const auto option = i + 1 == RAND_COUNT ? FsWriteOption_Flush : FsWriteOption_None;
+            R_TRY(f.Write(off, data.data(), data.size(), option));
+        } else {
+            u64 bytes_read;
+            R_TRY(f.Read(off, data.data(), data.size(), 0, &bytes_read));
+        }
+
+        if (!(i % 64)) {
+            pbox->UpdateTransfer(i, RAND_COUNT);
+        }
+    }
+
+    speed = GetSpeed(RAND_SIZE * RAND_COUNT, start);
+    R_SUCCEED();
+}
+
+// runs func over the test data COMPUTE_LOOPS times.
+Result RunCompute(ProgressBox* pbox, double& speed, const std::function<void(const std::vector<u8>& data)>& func) {
+    const auto data = MakeTestData(COMPUTE_SIZE);
+
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < COMPUTE_LOOPS; i++) {
+        R_TRY(pbox->ShouldExitResult());
+        func(data);
+        pbox->UpdateTransfer(i + 1, COMPUTE_LOOPS);
+    }
+
+    speed = GetSpeed(COMPUTE_SIZE * COMPUTE_LOOPS, start);
+    R_SUCCEED();
+}
+
+Result ZstdDecompress(ProgressBox* pbox, double& speed) {
+    const auto data = MakeTestData(COMPUTE_SIZE);
+    std::vector<u8> compressed(ZSTD_compressBound(data.size()));
+    const auto compressed_size = ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 3);
+    R_UNLESS(!ZSTD_isError(compressed_size), Result_BenchZstdError);
+
+    utils::zstd::DCtx dctx{utils::zstd::AcquireDCtx()};
+    R_UNLESS(dctx, Result_BenchZstdError);
+    std::vector<u8> out(data.size());
+
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < COMPUTE_LOOPS; i++) {
+        R_TRY(pbox->ShouldExitResult());
+        const auto res = ZSTD_decompressDCtx(dctx.get(), out.data(), out.size(), compressed.data(), compressed_size);
+        R_UNLESS(res == out.size(), Result_BenchZstdError);
+        pbox->UpdateTransfer(i + 1, COMPUTE_LOOPS);
+    }
+
+    speed = GetSpeed(COMPUTE_SIZE * COMPUTE_LOOPS, start);
+    R_SUCCEED();
+}
+
+// checks that the output of the aes kernels matches libnx before timing them.
+Result CheckAesCtr(const std::vector<u8>& data) {
+    u8 key[0x10]{}, ctr[0x10]{};
+    std::vector<u8> out(data.size()), out_nx(data.size());
+
+    Aes128CtrContext nx_ctx;
+    aes128CtrContextCreate(&nx_ctx, key, ctr);
+    aes128CtrCrypt(&nx_ctx, out_nx.data(), data.data(), data.size());
+    crypto::Aes128Ctr{key, ctr}.Crypt(out.data(), data.data(), data.size());
+
+    R_UNLESS(out == out_nx, Result_BenchCryptoMismatch);
+    R_SUCCEED();
+}
+
+Result CheckAesXts(const std::vector<u8>& data) {
+    u8 key[0x20]{};
+    std::vector<u8> out(data.size()), out_nx(data.size());
+
+    for (const auto is_encryptor : { true, false }) {
+        Aes128XtsContext nx_ctx;
+        aes128XtsContextCreate(&nx_ctx, key, key + 0x10, is_encryptor);
+        u64 sector{};
+        for (u64 pos = 0; pos < data.size(); pos += 0x200) {
+            aes128XtsContextResetSector(&nx_ctx, sector++, true);
+            if (is_encryptor) {
+                aes128XtsEncrypt(&nx_ctx, out_nx.data() + pos, data.data() + pos, 0x200);
+            } else {
+                aes128XtsDecrypt(&nx_ctx, out_nx.data() + pos, data.data() + pos, 0x200);
+            }
+        }
+        crypto::Aes128Xts{key, is_encryptor}.Run(out.data(), data.data(), 0, 0x200, data.size());
+
+        R_UNLESS(out == out_nx, Result_BenchCryptoMismatch);
+    }
+
+    R_SUCCEED();
+}
+
+// the queue PushPullThreadData used before the spsc ring, a vector behind a
+// mutex where each read erases from the front, kept as a baseline.
+struct MutexQueue {
+    static constexpr size_t MAX_BUFFER_SIZE = 1024 * 64;
+
+    MutexQueue() {
+        mutexInit(&mutex);
+        condvarInit(&can_push);
+        condvarInit(&can_pull);
+        buffer.reserve(MAX_BUFFER_SIZE);
+    }
+
+    void Push(const char* data, size_t size) {
+        SCOPED_MUTEX(&mutex);
+        ON_SCOPE_EXIT(condvarWakeOne(&can_pull));
+
+        size_t bytes_written = 0;
+        while (bytes_written < size && !finished) {
+            const size_t space_left = MAX_BUFFER_SIZE - buffer.size();
+            if (space_left == 0) {
+                condvarWakeOne(&can_pull);
+                condvarWait(&can_push, &mutex);
+                continue;
+            }
+
+            const auto wsize = std::min(size - bytes_written, space_left);
+            buffer.insert(buffer.end(), data + bytes_written, data + bytes_written + wsize);
+            bytes_written += wsize;
+        }
+    }
+
+    void Pull(char* data, size_t size) {
+        SCOPED_MUTEX(&mutex);
+        ON_SCOPE_EXIT(condvarWakeOne(&can_push));
+
+        size_t bytes_read = 0;
+        while (bytes_read < size && !finished) {
+            if (buffer.empty()) {
+                condvarWakeOne(&can_push);
+                condvarWait(&can_pull, &mutex);
+                continue;
+            }
+
+            const auto rsize = std::min(size - bytes_read, buffer.size());
+            std::memcpy(data + bytes_read, buffer.data(), rsize);
+            buffer.erase(buffer.begin(), buffer.begin() + rsize);
+            bytes_read += rsize;
+        }
+    }
+
+    void Cancel() {
+        SCOPED_MUTEX(&mutex);
+        finished = true;
+        condvarWakeOne(&can_pull);
+        condvarWakeOne(&can_push);
+    }
+
+    Mutex mutex{};
+    CondVar can_push{};
+    CondVar can_pull{};
+    std::vector<u8> buffer{};
+    bool finished{};
+};
+
+// the queue used by the curl mounts, without curl.
+struct SpscQueue {
+    void Push(const char* data, size_t size) {
+        queue.PushData(data, size);
+    }
+
+    void Pull(char* data, size_t size) {
+        queue.PullData(data, size);
+    }
+
+    void Cancel() {
+        queue.Cancel();
+    }
+
+    devoptab::common::PushPullThreadData queue{nullptr};
+};
+
+// pushes QUEUE_SIZE from a thread whilst pulling it on this one.
+template<typename T>
+Result RunQueue(ProgressBox* pbox, double& speed) {
+    T queue{};
+    std::vector<char> in(QUEUE_CHUNK_SIZE, 'a'), out(QUEUE_CHUNK_SIZE);
+
+    const auto start = armGetSystemTick();
+    utils::Async producer{[&queue, &in](){
+        for (s64 off = 0; off < QUEUE_SIZE; off += QUEUE_CHUNK_SIZE) {
+            queue.Push(in.data(), in.size());
+        }
+    }};
+    // unblocks the producer if cancelled, before it's joined.
+    ON_SCOPE_EXIT(queue.Cancel());
+
+    for (s64 off = 0; off < QUEUE_SIZE; off += QUEUE_CHUNK_SIZE) {
+        R_TRY(pbox->ShouldExitResult());
+        queue.Pull(out.data(), out.size());
+        if (!(off % (QUEUE_CHUNK_SIZE * 64))) {
+            pbox->UpdateTransfer(off, QUEUE_SIZE);
+        }
+    }
+
+    speed = GetSpeed(QUEUE_SIZE, start);
+    R_SUCCEED();
+}
+
+auto MakeTestPaths() -> std::vector<std::string> {
+    std::vector<std::string> paths;
+    for (u32 i = 0; i < PATH_COUNT; i++) {
+        paths.emplace_back("/dir" + std::to_string(i % 64) + "/sub" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".bin");
+    }
+    return paths;
+}
+
+Result PathIndexLookup(ProgressBox* pbox, double& speed) {
+    const auto paths = MakeTestPaths();
+    utils::PathIndex index;
+    index.Reserve(paths.size());
+    for (u32 i = 0; i < paths.size(); i++) {
+        index.Add(paths[i], i);
+    }
+
+    u32 found{};
+    const auto start = armGetSystemTick();
+    for (const auto& path : paths) {
+        u32 value;
+        found += index.Find(path, value);
+    }
+
+    speed = GetRate(paths.size(), start);
+    R_UNLESS(found == paths.size(), Result_BenchPathIndexMismatch);
+    R_SUCCEED();
+}
+
+// how the zip / nsp / xci mounts found a path before the index.
+Result PathLinearLookup(ProgressBox* pbox, double& speed) {
+    const auto paths = MakeTestPaths();
+
+    u32 found{};
+    const auto start = armGetSystemTick();
+    for (const auto& path : paths) {
+        R_TRY(pbox->ShouldExitResult());
+        found += std::ranges::find(paths, path) != paths.end();
+    }
+
+    speed = GetRate(paths.size(), start);
+    R_UNLESS(found == paths.size(), Result_BenchPathIndexMismatch);
+    R_SUCCEED();
+}
+
+Result I18nLookup(ProgressBox* pbox, bool copy, double& speed) {
+    const auto start = armGetSystemTick();
+    const auto lookups = i18n::Benchmark(I18N_ITERATIONS, copy);
+    speed = GetRate(lookups, start);
+    R_SUCCEED();
+}
+
+Result TransferOverhead(ProgressBox* pbox, double& speed) {
+    const auto start = armGetSystemTick();
+    R_TRY(thread::Transfer(pbox, TRANSFER_SIZE,
+        [](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+            *bytes_read = size;
+            R_SUCCEED();
+        },
+        [](const void* data, s64 off, s64 size) -> Result {
+            R_SUCCEED();
+        }
+    ));
+
+    speed = GetSpeed(TRANSFER_SIZE, start);
+    R_SUCCEED();
+}
+
+// installs the picked file with nothing written to storage, so the speed is that
+// of the read / decrypt / decompress / hash stages of an install.
+// the speed is of the file size, ie, the compressed size for nsz.
+Result InstallDryRun(ProgressBox* pbox, const PickedFile& file, double& speed) {
+    R_UNLESS(file.fs, Result_BenchNoFileSelected);
+
+    FsTimeStampRaw ts;
+    s64 size;
+    R_TRY(file.fs->FileGetSizeAndTimestamp(file.path, &ts, &size));
+
+    yati::ConfigOverride config{};
+    config.dry_run = true;
+
+    const auto start = armGetSystemTick();
+    R_TRY(yati::InstallFromFile(pbox, file.fs.get(), file.path, config));
+
+    speed = GetSpeed(size, start);
+    R_SUCCEED();
+}
+
+void AddStorageEntries(std::vector<Entry>& entries, const std::string& name, const Storage& storage) {
+    const auto cleanup = [storage]() {
+        storage.fs->DeleteFile(storage.path);
+    };
+
+    entries.emplace_back(name + " seq write", [storage](auto pbox, auto& speed) {
+        return SeqWrite(pbox, storage, speed);
+    }, cleanup);
+
+    entries.emplace_back(name + " seq read", [storage](auto pbox, auto& speed) {
+        return SeqRead(pbox, storage, speed);
+    }, cleanup);
+
+    entries.emplace_back(name + " 4K random write", [storage](auto pbox, auto& speed) {
+        return RandomIo(pbox, storage, true, speed);
+    }, cleanup);
+
+    entries.emplace_back(name + " 4K random read", [storage](auto pbox, auto& speed) {
+        return RandomIo(pbox, storage, false, speed);
+    }, cleanup);
+}
+
+auto BuildEntries(const std::shared_ptr<PickedFile>& picked_file) -> std::vector<Entry> {
+    std::vector<Entry> entries;
+
+    const auto sd = std::make_shared<fs::FsNativeSd>();
+    AddStorageEntries(entries, "SD", { sd, fs::AppendPath(BENCH_PATH, TEST_FILE_NAME) });
+
+    const auto nand = std::make_shared<fs::FsNativeBis>(FsBisPartitionId_User, "");
+    if (R_SUCCEEDED(nand->GetFsOpenResult())) {
+        AddStorageEntries(entries, "NAND", { nand, fs::AppendPath("/", TEST_FILE_NAME) });
+    }
+
+    // hdd and network mounts.
+    for (const auto& e : location::GetStdio(true)) {
+        fs::FsPath path;
+        std::snprintf(path, sizeof(path), "%s/%s", e.mount.c_str(), TEST_FILE_NAME);
+        AddStorageEntries(entries, e.name, { std::make_shared<fs::FsStdio>(), path });
+    }
+
+    entries.emplace_back("zstd decompress", ZstdDecompress);
+
+    entries.emplace_back("AES-CTR", [](auto pbox, auto& speed) {
+        R_TRY(CheckAesCtr(MakeTestData(COMPUTE_SIZE)));
+
+        u8 key[0x10]{}, ctr[0x10]{};
+        std::vector<u8> out(COMPUTE_SIZE);
+        return RunCompute(pbox, speed, [&](auto& data) {
+            crypto::Aes128Ctr{key, ctr}.Crypt(out.data(), data.data(), data.size());
+        });
+    });
+
+    // libnx is the baseline for the kernels above.
+    entries.emplace_back("AES-CTR (libnx)", [](auto pbox, auto& speed) {
+        u8 key[0x10]{}, ctr[0x10]{};
+        std::vector<u8> out(COMPUTE_SIZE);
+        return RunCompute(pbox, speed, [&](auto& data) {
+            Aes128CtrContext ctx;
+            aes128CtrContextCreate(&ctx, key, ctr);
+            aes128CtrCrypt(&ctx, out.data(), data.data(), data.size());
+        });
+    });
+
+    entries.emplace_back("AES-XTS", [](auto pbox, auto& speed) {
+        R_TRY(CheckAesXts(MakeTestData(COMPUTE_SIZE)));
+
+        u8 key[0x20]{};
+        std::vector<u8> out(COMPUTE_SIZE);
+        return RunCompute(pbox, speed, [&](auto& data) {
+            crypto::Aes128Xts{key, false}.Run(out.data(), data.data(), 0, 0x200, data.size());
+        });
+    });
+
+    entries.emplace_back("AES-XTS (libnx)", [](auto pbox, auto& speed) {
+        u8 key[0x20]{};
+        std::vector<u8> out(COMPUTE_SIZE);
+        return RunCompute(pbox, speed, [&](auto& data) {
+            Aes128XtsContext ctx;
+            aes128XtsContextCreate(&ctx, key, key + 0x10, false);
+            u64 sector{};
+            for (u64 pos = 0; pos < data.size(); pos += 0x200) {
+                aes128XtsContextResetSector(&ctx, sector++, true);
+                aes128XtsDecrypt(&ctx, out.data() + pos, data.data() + pos, 0x200);
+            }
+        });
+    });
+
+    entries.emplace_back("SHA256", [](auto pbox, auto& speed) {
+        u8 hash[SHA256_HASH_SIZE];
+        return RunCompute(pbox, speed, [&](auto& data) {
+            sha256CalculateHash(hash, data.data(), data.size());
+        });
+    });
+
+    entries.emplace_back("MD5", [](auto pbox, auto& speed) {
+        u8 hash[utils::Md5::HASH_SIZE];
+        return RunCompute(pbox, speed, [&](auto& data) {
+            utils::Md5 ctx;
+            ctx.Update(data.data(), data.size());
+            ctx.GetHash(hash);
+        });
+    });
+
+    // mbedtls is what hasher used before utils::Md5.
+    entries.emplace_back("MD5 (mbedtls)", [](auto pbox, auto& speed) {
+        u8 hash[utils::Md5::HASH_SIZE];
+        return RunCompute(pbox, speed, [&](auto& data) {
+            mbedtls_md5_ret(data.data(), data.size(), hash);
+        });
+    });
+
+    entries.emplace_back("CRC32", [](auto pbox, auto& speed) {
+        return RunCompute(pbox, speed, [](auto& data) {
+            crc32Calculate(data.data(), data.size());
+        });
+    });
+
+    entries.emplace_back("Transfer overhead", TransferOverhead);
+
+    entries.emplace_back("Install (dry run)", [picked_file](auto pbox, auto& speed) {
+        return InstallDryRun(pbox, *picked_file, speed);
+    }, nullptr, "MiB/s", std::vector<std::string>{"nsp", "nsz"});
+
+    entries.emplace_back("Curl queue (spsc ring)", RunQueue<SpscQueue>);
+    entries.emplace_back("Curl queue (mutex)", RunQueue<MutexQueue>);
+
+    entries.emplace_back("Path index lookup", PathIndexLookup, nullptr, "M/s");
+    entries.emplace_back("Path linear lookup", PathLinearLookup, nullptr, "M/s");
+
+    // reports 0 if no translations are loaded, ie, english.
+    entries.emplace_back("i18n lookup", [](auto pbox, auto& speed) {
+        return I18nLookup(pbox, false, speed);
+    }, nullptr, "M/s");
+
+    entries.emplace_back("i18n lookup + copy", [](auto pbox, auto& speed) {
+        return I18nLookup(pbox, true, speed);
+    }, nullptr, "M/s");
+
+    return entries;
+}
+
+Result SaveResults(std::span<const Entry> entries) {
+    auto doc = yyjson_mut_doc_new(nullptr);
+    R_UNLESS(doc, Result_BenchFailedWriteJson);
+    ON_SCOPE_EXIT(yyjson_mut_doc_free(doc));
+
+    const auto now = std::time(nullptr);
+    const auto tm = std::localtime(&now);
+
+    auto root = yyjson_mut_obj(doc);
+    yyjson_mut_doc_set_root(doc, root);
+    yyjson_mut_obj_add_str(doc, root, "version", APP_DISPLAY_VERSION);
+    yyjson_mut_obj_add_uint(doc, root, "timestamp", now);
+    yyjson_mut_obj_add_bool(doc, root, "applet", App::IsApplet());
+    yyjson_mut_obj_add_uint(doc, root, "heap_size", utils::budget::GetHeapSize());
+    yyjson_mut_obj_add_uint(doc, root, "firmware", hosversionGet());
+
+    auto results = yyjson_mut_arr(doc);
+    for (const auto& e : entries) {
+        if (!e.has_result) {
+            continue;
+        }
+
+        auto obj = yyjson_mut_arr_add_obj(doc, results);
+        yyjson_mut_obj_add_strcpy(doc, obj, "name", e.name.c_str());
+        yyjson_mut_obj_add_strcpy(doc, obj, "unit", e.unit.c_str());
+        yyjson_mut_obj_add_uint(doc, obj, "result", e.rc);
+        yyjson_mut_obj_add_real(doc, obj, "min", e.stats.min);
+        yyjson_mut_obj_add_real(doc, obj, "median", e.stats.median);
+        yyjson_mut_obj_add_real(doc, obj, "max", e.stats.max);
+
+        auto samples = yyjson_mut_arr(doc);
+        for (const auto sample : e.stats.samples) {
+            yyjson_mut_arr_add_real(doc, samples, sample);
+        }
+        yyjson_mut_obj_add_val(doc, obj, "samples", samples);
+    }
+    yyjson_mut_obj_add_val(doc, root, "results", results);
+
+    size_t len;
+    auto json = yyjson_mut_write(doc, YYJSON_WRITE_PRETTY, &len);
+    R_UNLESS(json, Result_BenchFailedWriteJson);
+    ON_SCOPE_EXIT(std::free(json));
+
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/%04d%02d%02d_%02d%02d%02d.json", BENCH_PATH,
+        tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursively(BENCH_PATH);
+    R_TRY(fs.write_entire_file(path, {(const u8*)json, len}));
+
+    log_write("[BENCH] saved results: %s\n", path.s);
+    R_SUCCEED();
+}
+
+} // namespace
+
+Menu::Menu(u32 flags) : MenuBase{"Benchmarks"_i18n, flags} {
+    fs::FsNativeSd().CreateDirectoryRecursively(BENCH_PATH);
+    m_entries = BuildEntries(m_picked_file);
+
+    this->SetActions(
+        std::make_pair(Button::A, Action{"Run"_i18n, [this](){
+            if (m_entries.empty()) {
+                return;
+            }
+
+            if (!m_entries[m_index].pick_filter.empty()) {
+                PickFile(m_index);
+            } else {
+                Run({(u32)m_index});
+            }
+        }}),
+
+        std::make_pair(Button::X, Action{"Run all"_i18n, [this](){
+            std::vector<u32> indices;
+            for (u32 i = 0; i < m_entries.size(); i++) {
+                // tests that need a file are skipped until one has been picked.
+                if (m_entries[i].pick_filter.empty() || m_picked_file->fs) {
+                    indices.emplace_back(i);
+                }
+            }
+            Run(indices);
+        }}),
+
+        std::make_pair(Button::B, Action{"Back"_i18n, [this](){
+            SetPop();
+        }})
+    );
+
+    const Vec4 v{75, GetY() + 1.f + 42.f, 1220.f-45.f*2, 60};
+    m_list = std::make_unique<List>(1, 8, m_pos, v);
+    SetIndex(0);
+}
+
+Menu::~Menu() {
+}
+
+void Menu::Update(Controller* controller, TouchInfo* touch) {
+    MenuBase::Update(controller, touch);
+    m_list->OnUpdate(controller, touch, m_index, m_entries.size(), [this](bool touch, auto i) {
+        if (touch && m_index == i) {
+            FireAction(Button::A);
+        } else {
+            App::PlaySoundEffect(SoundEffect::Focus);
+            SetIndex(i);
+        }
+    });
+}
+
+void Menu::Draw(NVGcontext* vg, Theme* theme) {
+    MenuBase::Draw(vg, theme);
+
+    constexpr float text_xoffset{15.f};
+
+    m_list->Draw(vg, theme, m_entries.size(), [this](auto* vg, auto* theme, auto& v, auto i) {
+        const auto& [x, y, w, h] = v;
+        const auto& e = m_entries[i];
+
+        auto text_id = ThemeEntryID_TEXT;
+        if (m_index == i) {
+            text_id = ThemeEntryID_TEXT_SELECTED;
+            gfx::drawRectOutline(vg, theme, 4.f, v);
+        } else {
+            if (i != m_entries.size() - 1) {
+                gfx::drawRect(vg, x, y + h, w, 1.f, theme->GetColour(ThemeEntryID_LINE_SEPARATOR));
+            }
+        }
+
+        gfx::drawTextArgs(vg, x + text_xoffset, y + (h / 2.f), 20.f, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(text_id), "%s", e.name.c_str());
+
+        if (!e.has_result) {
+            return;
+        }
+
+        const auto info = theme->GetColour(ThemeEntryID_TEXT_INFO);
+        if (R_FAILED(e.rc)) {
+            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f), 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE, info, "failed: 0x%X", e.rc);
+        } else {
+            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f), 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_MIDDLE, info, "%.2f %s (%.2f - %.2f)", e.stats.median, e.unit.c_str(), e.stats.min, e.stats.max);
+        }
+    });
+}
+
+void Menu::OnFocusGained() {
+    MenuBase::OnFocusGained();
+
+    if (m_pending_run) {
+        const auto index = *m_pending_run;
+        m_pending_run.reset();
+        Run({index});
+    }
+}
+
+void Menu::SetIndex(s64 index) {
+    m_index = index;
+    if (!m_index) {
+        m_list->SetYoff(0);
+    }
+
+    UpdateSubheading();
+}
+
+void Menu::Run(std::vector<u32> indices) {
+    struct RunResult {
+        u32 index;
+        Result rc;
+        Stats stats;
+    };
+
+    // results are set on the main thread once done, as the list is drawn whilst running.
+    auto results = std::make_shared<std::vector<RunResult>>();
+
+    App::Push<ProgressBox>(0, "Running"_i18n, "Benchmarks"_i18n, [this, indices, results](auto pbox) -> Result {
+        for (const auto index : indices) {
+            const auto& e = m_entries[index];
+            pbox->SetTitle(e.name);
+
+            std::vector<double> samples;
+            Result rc{};
+            for (u32 i = 0; i < ITERATIONS && R_SUCCEEDED(rc); i++) {
+                pbox->NewTransfer(e.name + " (" + std::to_string(i + 1) + " / " + std::to_string(ITERATIONS) + ")");
+                double speed{};
+                if (R_SUCCEEDED(rc = e.func(pbox, speed))) {
+                    samples.emplace_back(speed);
+                }
+            }
+
+            if (e.cleanup) {
+                e.cleanup();
+            }
+
+            R_TRY(pbox->ShouldExitResult());
+            log_write("[BENCH] %s: rc: 0x%X samples: %zu\n", e.name.c_str(), rc, samples.size());
+            results->emplace_back(index, rc, CalculateStats(std::move(samples)));
+        }
+
+        R_SUCCEED();
+    }, [this, results](Result rc){
+        for (auto& result : *results) {
+            auto& e = m_entries[result.index];
+            e.rc = result.rc;
+            e.stats = std::move(result.stats);
+            e.has_result = true;
+        }
+
+        if (!results->empty()) {
+            if (R_FAILED(SaveResults(m_entries))) {
+                App::Notify("Failed to save results"_i18n);
+            }
+        }
+
+        App::PushErrorBox(rc, "Benchmark failed"_i18n);
+    });
+}
+
+void Menu::PickFile(u32 index) {
+    App::Push<filebrowser::picker::Menu>([this, index](const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path) {
+        log_write("[BENCH] picked: %s\n", path.s);
+        m_picked_file->fs = fs;
+        m_picked_file->path = path;
+        m_pending_run = index;
+        return true;
+    }, m_entries[index].pick_filter);
+}
+
+void Menu::UpdateSubheading() {
+    const auto index = m_entries.empty() ? 0 : m_index + 1;
+    this->SetSubHeading(std::to_string(index) + " / " + std::to_string(m_entries.size()));
+}
+
+} // namespace sphaira::ui::menu::bench
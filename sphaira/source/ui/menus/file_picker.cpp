@@ -4,6 +4,10 @@
 namespace sphaira::ui::menu::filebrowser::picker {
 
 Menu::Menu(const Callback& cb, const std::vector<std::string>& filter, const fs::FsPath& path)
+: Menu{[cb](const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& path) { return cb(path); }, filter, path} {
+}
+
+Menu::Menu(const FsCallback& cb, const std::vector<std::string>& filter, const fs::FsPath& path)
 : Base{MenuFlag_None, FsOption_Picker}
 , m_callback{cb} {
     SetFilter(filter);
@@ -16,7 +20,7 @@ void Menu::OnClick(FsView* view, const FsEntry& fs_entry, const FileEntry& entry
     } else {
         for (auto& e : m_filter) {
             if (IsExtension(e, entry.GetExtension())) {
-                if (m_callback(path)) {
+                if (m_callback(view->m_fs, path)) {
                     SetPop();
                 }
                 break;
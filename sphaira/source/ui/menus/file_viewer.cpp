@@ -1,11 +1,122 @@
 #include "ui/menus/file_viewer.hpp"
+#include "ui/nvg_util.hpp"
+#include "utils/devoptab_common.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/thread.hpp"
+#include "yati/source/file.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
 #include "i18n.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace sphaira::ui::menu::fileview {
 namespace {
 
+// a checkpoint is stored every this many lines, so a 1 million line file
+// only needs ~4000 offsets.
+constexpr s64 CHECKPOINT_LINES = 256;
+// lines longer than this are split, so that finding a line never needs to
+// read more than CHECKPOINT_LINES * MAX_LINE_LENGTH bytes.
+constexpr s64 MAX_LINE_LENGTH = 1024;
+constexpr s64 INDEX_CHUNK_SIZE = 1024 * 512;
+constexpr s64 WINDOW_CHUNK_SIZE = 1024 * 16;
+
+constexpr float TEXT_X = 140;
+constexpr float TEXT_Y = 110;
+constexpr float LINE_HEIGHT = 24;
+constexpr float FONT_SIZE = 18;
+constexpr s64 VISIBLE_LINES = 22;
+
+// splits data into lines, used by both the index and the viewer so that
+// they agree on where each line starts.
+struct LineSplitter {
+    // returns true if a line ended within data, consumed is set to the
+    // number of bytes used, including the newline.
+    auto Feed(const u8* data, s64 size, s64& consumed) -> bool {
+        const auto max = std::min(size, MAX_LINE_LENGTH - m_length);
+        if (const auto nl = static_cast<const u8*>(std::memchr(data, '\n', max))) {
+            consumed = nl - data + 1;
+            m_length = 0;
+            return true;
+        }
+
+        consumed = max;
+        m_length += max;
+        if (m_length == MAX_LINE_LENGTH) {
+            m_length = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    // set if there's a line that hasn't ended yet.
+    auto HasPartial() const -> bool {
+        return m_length;
+    }
+
+private:
+    s64 m_length{};
+};
+
+void index_thread_func(void* arg) {
+    auto data = static_cast<LineIndex*>(arg);
+
+    yati::source::File file{data->fs, data->path};
+    utils::pool::Vector<u8> buf(INDEX_CHUNK_SIZE);
+    LineSplitter splitter;
+    std::vector<s64> checkpoints;
+    s64 line_count{};
+    s64 off{};
+
+    while (!data->stop && off < data->file_size) {
+        u64 bytes_read;
+        if (R_FAILED(file.Read(buf.data(), off, std::min<s64>(buf.size(), data->file_size - off), &bytes_read)) || !bytes_read) {
+            log_write("[FILEVIEW] failed to read whilst indexing at: %zd\n", off);
+            break;
+        }
+
+        for (s64 i = 0; i < (s64)bytes_read;) {
+            s64 consumed;
+            const auto ended = splitter.Feed(buf.data() + i, bytes_read - i, consumed);
+            i += consumed;
+
+            if (ended && ++line_count % CHECKPOINT_LINES == 0) {
+                checkpoints.emplace_back(off + i);
+            }
+        }
+
+        off += bytes_read;
+
+        SCOPED_MUTEX(&data->mutex);
+        data->checkpoints.insert(data->checkpoints.end(), checkpoints.begin(), checkpoints.end());
+        data->line_count = line_count;
+        checkpoints.clear();
+    }
+
+    // the last line doesn't end with a newline.
+    if (off == data->file_size && splitter.HasPartial()) {
+        SCOPED_MUTEX(&data->mutex);
+        data->line_count = ++line_count;
+    }
+
+    log_write("[FILEVIEW] indexed %zd lines, %zu checkpoints\n", line_count, data->checkpoints.size());
+    data->done = true;
+}
+
 } // namespace
 
+LineIndex::~LineIndex() {
+    if (started) {
+        stop = true;
+        threadWaitForExit(&thread);
+        threadClose(&thread);
+    }
+}
+
 Menu::Menu(fs::Fs* fs, const fs::FsPath& path)
 : MenuBase{path, MenuFlag_None}
 , m_fs{fs}
@@ -14,33 +125,167 @@ Menu::Menu(fs::Fs* fs, const fs::FsPath& path)
         SetPop();
     }});
 
-    std::string buf;
-    if (R_SUCCEEDED(m_fs->OpenFile(m_path, FsOpenMode_Read, &m_file))) {
-        m_file.GetSize(&m_file_size);
-        buf.resize(m_file_size + 1);
+    auto file = std::make_shared<yati::source::File>(m_fs, m_path);
+    if (R_FAILED(file->GetOpenResult()) || R_FAILED(file->GetSize(&m_file_size))) {
+        log_write("[FILEVIEW] failed to open: %s\n", m_path.s);
+        return;
+    }
+
+    m_source = std::make_shared<devoptab::common::BufferedData>(file, m_file_size);
+
+    auto index = std::make_unique<LineIndex>();
+    index->fs = m_fs;
+    index->path = m_path;
+    index->file_size = m_file_size;
+    index->checkpoints.emplace_back(0);
+    mutexInit(&index->mutex);
 
-        u64 read_bytes;
-        m_file.Read(m_file_offset, buf.data(), buf.size(), 0, &read_bytes);
-        buf[m_file_size] = '\0';
+    if (R_FAILED(utils::CreateThread(&index->thread, index_thread_func, index.get(), 1024 * 32))) {
+        log_write("[FILEVIEW] failed to create index thread\n");
+        return;
     }
 
-    m_scroll_text = std::make_unique<ScrollableText>(buf, 0, 120, 500, 1150-110, 18);
+    if (R_FAILED(threadStart(&index->thread))) {
+        threadClose(&index->thread);
+        log_write("[FILEVIEW] failed to start index thread\n");
+        return;
+    }
+
+    index->started = true;
+    m_line_index = std::move(index);
 }
 
 void Menu::Update(Controller* controller, TouchInfo* touch) {
     MenuBase::Update(controller, touch);
 
-    m_scroll_text->Update(controller, touch);
+    if (controller->GotDown(Button::DOWN)) {
+        SetLine(m_line + 1);
+    } else if (controller->GotDown(Button::UP)) {
+        SetLine(m_line - 1);
+    } else if (controller->GotDown(Button::RIGHT)) {
+        SetLine(m_line + VISIBLE_LINES);
+    } else if (controller->GotDown(Button::LEFT)) {
+        SetLine(m_line - VISIBLE_LINES);
+    } else if (controller->GotDown(Button::R2)) {
+        SetLine(GetLineCount());
+    } else if (controller->GotDown(Button::L2)) {
+        SetLine(0);
+    }
+
+    if (m_lines_start != m_line && m_source) {
+        if (R_FAILED(LoadWindow())) {
+            log_write("[FILEVIEW] failed to read line: %zd\n", m_line);
+        }
+    }
+
+    const auto count = GetLineCount();
+    auto sub_heading = std::to_string(std::min(m_line + 1, count)) + " / " + std::to_string(count);
+    if (m_line_index && !m_line_index->done) {
+        sub_heading += " " + "(indexing...)"_i18n;
+    }
+    SetSubHeading(sub_heading);
 }
 
 void Menu::Draw(NVGcontext* vg, Theme* theme) {
     MenuBase::Draw(vg, theme);
 
-    m_scroll_text->Draw(vg, theme);
+    nvgSave(vg);
+    nvgIntersectScissor(vg, 30, TEXT_Y, 1220 - 30, VISIBLE_LINES * LINE_HEIGHT);
+
+    for (size_t i = 0; i < m_lines.size(); i++) {
+        const auto y = TEXT_Y + i * LINE_HEIGHT;
+        gfx::drawTextArgs(vg, TEXT_X - 20, y, FONT_SIZE, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%zd", m_lines_start + i + 1);
+        gfx::drawText(vg, TEXT_X, y, FONT_SIZE, theme->GetColour(ThemeEntryID_TEXT), m_lines[i].c_str());
+    }
+
+    nvgRestore(vg);
+
+    gfx::drawScrollbar2(vg, theme, 1220 + 10, TEXT_Y, VISIBLE_LINES * LINE_HEIGHT, m_line, GetLineCount(), 1, VISIBLE_LINES);
 }
 
 void Menu::OnFocusGained() {
     MenuBase::OnFocusGained();
 }
 
+auto Menu::GetLineCount() -> s64 {
+    if (!m_line_index) {
+        return 0;
+    }
+
+    SCOPED_MUTEX(&m_line_index->mutex);
+    return m_line_index->line_count;
+}
+
+void Menu::SetLine(s64 line) {
+    const auto count = GetLineCount();
+    line = std::clamp<s64>(line, 0, std::max<s64>(0, count - VISIBLE_LINES));
+
+    if (m_line != line) {
+        m_line = line;
+        App::PlaySoundEffect(SoundEffect::Scroll);
+    }
+}
+
+Result Menu::LoadWindow() {
+    s64 off;
+    s64 skip;
+    {
+        SCOPED_MUTEX(&m_line_index->mutex);
+        const auto checkpoint = std::min<s64>(m_line / CHECKPOINT_LINES, m_line_index->checkpoints.size() - 1);
+        off = m_line_index->checkpoints[checkpoint];
+        skip = m_line - checkpoint * CHECKPOINT_LINES;
+    }
+
+    m_lines.clear();
+    m_lines_start = m_line;
+
+    std::vector<u8> buf(WINDOW_CHUNK_SIZE);
+    LineSplitter splitter;
+    std::string line;
+
+    while (off < m_file_size && (s64)m_lines.size() < VISIBLE_LINES) {
+        u64 bytes_read;
+        R_TRY(m_source->Read(buf.data(), off, std::min<s64>(buf.size(), m_file_size - off), &bytes_read));
+        if (!bytes_read) {
+            break;
+        }
+
+        for (s64 i = 0; i < (s64)bytes_read && (s64)m_lines.size() < VISIBLE_LINES;) {
+            s64 consumed;
+            const auto ended = splitter.Feed(buf.data() + i, bytes_read - i, consumed);
+
+            if (!skip) {
+                for (s64 j = 0; j < consumed; j++) {
+                    const auto c = buf[i + j];
+                    if (c == '\t') {
+                        line += "    ";
+                    } else if (c >= 0x20 && c != 0x7F) {
+                        line += (char)c;
+                    }
+                }
+            }
+
+            i += consumed;
+
+            if (ended) {
+                if (skip) {
+                    skip--;
+                } else {
+                    m_lines.emplace_back(std::move(line));
+                    line.clear();
+                }
+            }
+        }
+
+        off += bytes_read;
+    }
+
+    // last line of the file.
+    if (!skip && !line.empty() && (s64)m_lines.size() < VISIBLE_LINES) {
+        m_lines.emplace_back(std::move(line));
+    }
+
+    R_SUCCEED();
+}
+
 } // namespace sphaira::ui::menu::fileview
@@ -9,6 +9,7 @@
 #include "ui/progress_box.hpp"
 #include "ui/error_box.hpp"
 #include "ui/music_player.hpp"
+#include "ui/jobs_box.hpp"
 
 #include "utils/utils.hpp"
 #include "utils/devoptab.hpp"
@@ -27,6 +28,12 @@
 #include "hasher.hpp"
 #include "location.hpp"
 #include "threaded_file_transfer.hpp"
+#include "file_copy.hpp"
+#include "file_sync.hpp"
+#include "search_index.hpp"
+#include "trash.hpp"
+#include "jobs.hpp"
+#include "verify.hpp"
 #include "minizip_helper.hpp"
 
 #include "yati/yati.hpp"
@@ -36,8 +43,11 @@
 #include <minizip/zip.h>
 #include <minizip/unzip.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include <cstring>
+#include <cctype>
 #include <cassert>
+#include <algorithm>
 #include <string>
 #include <string_view>
 #include <ctime>
@@ -76,6 +86,339 @@ private:
 
 std::atomic_bool g_change_signalled{};
 
+// number of entries read before the view is first shown, dirs with more
+// entries than this have the rest read in the background.
+constexpr u32 SCAN_BATCH_SIZE = 1024;
+
+constexpr u32 LISTING_CACHE_MAX = 16;
+// total entries across all cached listings.
+constexpr u32 LISTING_CACHE_MAX_ENTRIES = 1024 * 64;
+// how long a listing is used for if the fs doesn't report the dir timestamp.
+constexpr u64 LISTING_CACHE_TTL_NS = 30e+9;
+
+// dirs smaller than this are quick enough to sort that they aren't cached.
+constexpr u32 SORT_CACHE_MIN = 2048;
+constexpr u32 SORT_CACHE_MAX = 8;
+// dirs larger than this are sorted in chunks across the cores then merged.
+constexpr u32 PARALLEL_SORT_MIN = 1024 * 16;
+constexpr u32 PARALLEL_SORT_CHUNKS = 4;
+
+// everything the comparator needs, in a single struct so that sorting
+// doesn't need to go back to the list for each compare.
+struct SortKey {
+    // first 8 chars of the name, lower cased and packed big endian so that
+    // comparing the ints matches strcasecmp() for the prefix.
+    u64 prefix;
+    s64 size;
+    u32 index;
+    // hidden / folders first grouping, lower goes first.
+    u8 rank;
+};
+
+auto fold_name_prefix(const char* name) -> u64 {
+    u64 prefix{};
+    bool end{};
+
+    for (u32 i = 0; i < sizeof(prefix); i++) {
+        u8 c{};
+        if (!end) {
+            c = std::tolower((u8)name[i]);
+            end = !c;
+        }
+        prefix = (prefix << 8) | c;
+    }
+
+    return prefix;
+}
+
+struct SortCompare {
+    auto CompareName(const SortKey& lhs, const SortKey& rhs) const -> int {
+        if (lhs.prefix != rhs.prefix) {
+            return lhs.prefix < rhs.prefix ? -1 : 1;
+        }
+        return strcasecmp(entries.GetName(lhs.index), entries.GetName(rhs.index));
+    }
+
+    // returns true if lhs should be before rhs
+    auto operator()(const SortKey& lhs, const SortKey& rhs) const -> bool {
+        if (lhs.rank != rhs.rank) {
+            return lhs.rank < rhs.rank;
+        }
+
+        switch (sort) {
+            case SortType_Size: {
+                if (lhs.size == rhs.size) {
+                    return CompareName(lhs, rhs) < 0;
+                } else if (order == OrderType_Descending) {
+                    return lhs.size > rhs.size;
+                } else {
+                    return lhs.size < rhs.size;
+                }
+            } break;
+            case SortType_Alphabetical: {
+                if (order == OrderType_Descending) {
+                    return CompareName(lhs, rhs) < 0;
+                } else {
+                    return CompareName(lhs, rhs) > 0;
+                }
+            } break;
+        }
+
+        std::unreachable();
+    }
+
+    const FileList& entries;
+    const long sort;
+    const long order;
+};
+
+struct SortChunk {
+    const SortCompare* compare;
+    std::span<SortKey> keys;
+};
+
+void sort_thread_func(void* arg) {
+    auto chunk = static_cast<SortChunk*>(arg);
+    std::sort(chunk->keys.begin(), chunk->keys.end(), *chunk->compare);
+}
+
+// sorts each chunk on its own core, then merges them.
+// falls back to sorting on this thread if the threads can't be created.
+void parallel_sort(std::span<SortKey> keys, const SortCompare& compare) {
+    SortChunk chunks[PARALLEL_SORT_CHUNKS];
+    Thread threads[PARALLEL_SORT_CHUNKS]{};
+    u32 thread_count{};
+
+    const auto chunk_size = keys.size() / PARALLEL_SORT_CHUNKS;
+    for (u32 i = 0; i < PARALLEL_SORT_CHUNKS; i++) {
+        const auto off = i * chunk_size;
+        const auto size = i == PARALLEL_SORT_CHUNKS - 1 ? keys.size() - off : chunk_size;
+        chunks[i] = {&compare, keys.subspan(off, size)};
+    }
+
+    // the first chunk is sorted on this thread.
+    for (u32 i = 1; i < PARALLEL_SORT_CHUNKS; i++) {
+        if (R_FAILED(utils::CreateThread(&threads[i], sort_thread_func, &chunks[i]))) {
+            break;
+        }
+
+        if (R_FAILED(threadStart(&threads[i]))) {
+            threadClose(&threads[i]);
+            break;
+        }
+
+        thread_count++;
+    }
+
+    sort_thread_func(&chunks[0]);
+
+    for (u32 i = 1; i < PARALLEL_SORT_CHUNKS; i++) {
+        if (i <= thread_count) {
+            threadWaitForExit(&threads[i]);
+            threadClose(&threads[i]);
+        } else {
+            sort_thread_func(&chunks[i]);
+        }
+    }
+
+    // merge the chunks back together, in pairs.
+    for (u32 width = 1; width < PARALLEL_SORT_CHUNKS; width *= 2) {
+        for (u32 i = 0; i + width < PARALLEL_SORT_CHUNKS; i += width * 2) {
+            const auto begin = chunks[i].keys.begin();
+            const auto middle = chunks[i + width].keys.begin();
+            const auto end_index = std::min(i + width * 2, PARALLEL_SORT_CHUNKS) - 1;
+            const auto end = chunks[end_index].keys.end();
+            std::inplace_merge(begin, middle, end, compare);
+        }
+    }
+}
+
+void scan_thread_func(void* arg) {
+    auto data = static_cast<ScanData*>(arg);
+    std::vector<FsDirectoryEntry> batch(SCAN_BATCH_SIZE);
+
+    Result rc{};
+    while (!data->stop) {
+        s64 total;
+        if (R_FAILED(rc = data->dir.Read(&total, batch.size(), batch.data()))) {
+            break;
+        }
+
+        if (total) {
+            SCOPED_MUTEX(&data->mutex);
+            data->pending.insert(data->pending.end(), batch.begin(), batch.begin() + total);
+        }
+
+        if (total < (s64)batch.size()) {
+            break;
+        }
+    }
+
+    data->rc = rc;
+    data->done = true;
+}
+
+void dir_size_thread_func(void* arg) {
+    auto data = static_cast<DirSizeData*>(arg);
+
+    walk::Config config{};
+    config.inc_size = true;
+    config.stop = &data->stop;
+
+    FsDirCollections collections;
+    const auto rc = walk::Walk(data->fs.get(), data->path, "", collections, config);
+    if (R_SUCCEEDED(rc)) {
+        for (const auto& c : collections) {
+            for (const auto& e : c.files) {
+                data->size += e.file_size;
+            }
+            data->file_count += c.files.size();
+            data->dir_count += c.dirs.size();
+        }
+    }
+
+    data->rc = rc;
+    data->done = true;
+}
+
+// update the delete progress at most this often.
+constexpr u64 DELETE_PROGRESS_INTERVAL = 1e+8; // 100ms
+constexpr u32 DELETE_WORKER_MAX = 4;
+
+void delete_thread_func(void* arg) {
+    auto data = static_cast<DeleteData*>(arg);
+
+    while (!data->stop && R_SUCCEEDED(data->result.load())) {
+        const auto index = data->next_index++;
+        if (index >= data->files.size()) {
+            break;
+        }
+
+        const auto [i, j] = data->files[index];
+        const auto& c = data->collections[i];
+        const auto full_path = FsView::GetNewPath(c.path, c.files[j].name);
+
+        log_write("deleting file: %s\n", full_path.s);
+        if (const auto rc = data->fs->DeleteFile(full_path); R_FAILED(rc)) {
+            data->result = rc;
+            break;
+        }
+
+        data->done_count++;
+        if (data->throttle) {
+            svcSleepThread(1e+5);
+        }
+    }
+}
+
+// parsed assoc ini files for a dir, kept between menus so that they're only
+// parsed again if the files change.
+struct AssocCache {
+    fs::FsPath path{};
+    u64 stamp{};
+    // before checking if the file for each entry exists.
+    std::vector<FileAssocEntry> entries{};
+};
+
+std::vector<AssocCache> g_assoc_cache{};
+
+auto HashAssocExtension(std::string_view ext) -> u32 {
+    u32 hash = 2166136261U;
+    for (const auto c : ext) {
+        hash = (hash ^ (u8)std::tolower((u8)c)) * 16777619U;
+    }
+    return hash;
+}
+
+// hash of the name, size and modified time of every file in the dir.
+auto GetAssocStamp(const fs::FsPath& path) -> u64 {
+    u64 hash = 14695981039346656037ULL;
+    const auto add = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ static_cast<const u8*>(data)[i]) * 1099511628211ULL;
+        }
+    };
+
+    auto dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+    ON_SCOPE_EXIT(closedir(dir));
+
+    while (auto d = readdir(dir)) {
+        if (d->d_name[0] == '.' || d->d_type != DT_REG) {
+            continue;
+        }
+
+        struct stat st{};
+        stat(FsView::GetNewPath(path, d->d_name), &st);
+        add(d->d_name, std::strlen(d->d_name));
+        add(&st.st_size, sizeof(st.st_size));
+        add(&st.st_mtime, sizeof(st.st_mtime));
+    }
+
+    return hash;
+}
+
+void ParseAssocEntriesPath(const fs::FsPath& path, std::vector<FileAssocEntry>& out) {
+    auto dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+    ON_SCOPE_EXIT(closedir(dir));
+
+    while (auto d = readdir(dir)) {
+        if (d->d_name[0] == '.') {
+            continue;
+        }
+
+        if (d->d_type != DT_REG) {
+            continue;
+        }
+
+        const auto ext = std::strrchr(d->d_name, '.');
+        if (!ext || strcasecmp(ext, ".ini")) {
+            continue;
+        }
+
+        const auto full_path = FsView::GetNewPath(path, d->d_name);
+        FileAssocEntry assoc{};
+
+        ini_browse([](const mTCHAR *Section, const mTCHAR *Key, const mTCHAR *Value, void *UserData) {
+            auto assoc = static_cast<FileAssocEntry*>(UserData);
+            if (!std::strcmp(Key, "path")) {
+                assoc->path = Value;
+            } else if (!std::strcmp(Key, "supported_extensions")) {
+                for (const auto& p : std::views::split(std::string_view{Value}, '|')) {
+                    if (p.empty()) {
+                        continue;
+                    }
+                    assoc->ext.emplace_back(p.data(), p.size());
+                }
+            } else if (!std::strcmp(Key, "database")) {
+                for (const auto& p : std::views::split(std::string_view{Value}, '|')) {
+                    if (p.empty()) {
+                        continue;
+                    }
+                    assoc->database.emplace_back(p.data(), p.size());
+                }
+            } else if (!std::strcmp(Key, "use_base_name")) {
+                if (!std::strcmp(Value, "true") || !std::strcmp(Value, "1")) {
+                    assoc->use_base_name = true;
+                }
+            }
+            return 1;
+        }, &assoc, full_path);
+
+        if (assoc.ext.empty()) {
+            continue;
+        }
+
+        assoc.name.assign(d->d_name, ext - d->d_name);
+        out.emplace_back(assoc);
+    }
+}
+
 constexpr FsEntry FS_ENTRY_DEFAULT{
     "microSD card", "/", FsType::Sd, FsEntryFlag_Assoc | FsEntryFlag_IsSd,
 };
@@ -96,18 +439,22 @@ constexpr std::string_view VIDEO_EXTENSIONS[] = {
 constexpr std::string_view IMAGE_EXTENSIONS[] = {
     "png", "jpg", "jpeg", "bmp", "gif",
 };
+// ns0 / xc0 are the first part of a split file.
 constexpr std::string_view INSTALL_EXTENSIONS[] = {
-    "nsp", "xci", "nsz", "xcz",
+    "nsp", "xci", "nsz", "xcz", "ns0", "xc0",
 };
 constexpr std::string_view NSP_EXTENSIONS[] = {
-    "nsp", "nsz",
+    "nsp", "nsz", "ns0",
 };
 constexpr std::string_view XCI_EXTENSIONS[] = {
-    "xci", "xcz",
+    "xci", "xcz", "xc0",
 };
 constexpr std::string_view NCA_EXTENSIONS[] = {
     "nca", "ncz",
 };
+constexpr std::string_view NRO_EXTENSIONS[] = {
+    "nro",
+};
 // these are files that are already compressed or encrypted and should
 // be stored raw in a zip file.
 constexpr std::string_view COMPRESSED_EXTENSIONS[] = {
@@ -398,6 +745,25 @@ auto ForwarderForm::LoadNroMeta() -> Result {
     R_SUCCEED();
 }
 
+// jobs are limited by the device that they write to.
+auto GetJobDevice(const FsEntry& e) -> jobs::Device {
+    switch (e.type) {
+        case FsType::Sd:
+        case FsType::ImageSd:
+            return jobs::Device_Sd;
+        case FsType::ImageNand:
+            return jobs::Device_Nand;
+        case FsType::Stdio:
+            // usb drives are mounted as ums0:, everything else is a network mount.
+            if (std::string_view{e.root}.starts_with("ums")) {
+                return jobs::Device_Usb;
+            }
+            return jobs::Device_Network;
+        default:
+            return jobs::Device_Other;
+    }
+}
+
 } // namespace
 
 // case insensitive check
@@ -434,23 +800,10 @@ FsView::FsView(Base* menu, const std::shared_ptr<fs::Fs>& fs, const fs::FsPath&
                 const auto set = m_selected_count != m_entries_current.size();
 
                 for (u32 i = 0; i < m_entries_current.size(); i++) {
-                    auto& e = GetEntry(i);
-                    if (e.selected != set) {
-                        e.selected = set;
-                        if (set) {
-                            m_selected_count++;
-                        } else {
-                            m_selected_count--;
-                        }
-                    }
+                    SetEntrySelected(i, set);
                 }
             } else {
-                GetEntry().selected ^= 1;
-                if (GetEntry().selected) {
-                    m_selected_count++;
-                } else {
-                    m_selected_count--;
-                }
+                SetEntrySelected(m_index, !IsEntrySelected(m_index));
             }
         }}),
         std::make_pair(Button::A, Action{"Open"_i18n, [this](){
@@ -499,7 +852,7 @@ FsView::FsView(Base* menu, const std::shared_ptr<fs::Fs>& fs, const fs::FsPath&
     log_write("getting path\n");
     auto buf = path;
     if (path.empty() && entry.IsSd()) {
-        ini_gets("paths", "last_path", entry.root, buf, sizeof(buf), App::CONFIG_PATH);
+        buf = App::GetConfigStore().GetString("paths", "last_path", entry.root.s);
     }
 
     // in case the above fails.
@@ -520,15 +873,37 @@ FsView::FsView(Base* menu, ViewSide side) : FsView{menu, menu->CreateFs(FS_ENTRY
 
 }
 
+ScanData::~ScanData() {
+    if (started) {
+        stop = true;
+        threadWaitForExit(&thread);
+        threadClose(&thread);
+    }
+}
+
+DirSizeData::~DirSizeData() {
+    if (started) {
+        stop = true;
+        threadWaitForExit(&thread);
+        threadClose(&thread);
+    }
+}
+
 FsView::~FsView() {
+    StopScan();
+
     // don't store mount points for non-sd card paths.
     if (IsSd() && !m_entries_current.empty()) {
-        ini_puts("paths", "last_path", m_path, App::CONFIG_PATH);
-        ini_puts("paths", "last_file", GetEntry().name, App::CONFIG_PATH);
+        auto& config = App::GetConfigStore();
+        config.Set("paths", "last_path", m_path.s);
+        config.Set("paths", "last_file", GetEntryName());
     }
 }
 
 void FsView::Update(Controller* controller, TouchInfo* touch) {
+    UpdateScan();
+    UpdateDirSizes();
+
     m_list->OnUpdate(controller, touch, m_index, m_entries_current.size(), [this, controller](bool touch, auto i) {
         if (touch && m_index == i) {
             FireAction(Button::A);
@@ -544,14 +919,7 @@ void FsView::Update(Controller* controller, TouchInfo* touch) {
 
                 while (old_index != new_index) {
                     old_index += inc;
-
-                    auto& e = GetEntry(old_index);
-                    e.selected ^= 1;
-                    if (e.selected) {
-                        m_selected_count++;
-                    } else {
-                        m_selected_count--;
-                    }
+                    SetEntrySelected(old_index, !IsEntrySelected(old_index));
                 }
             }
         }
@@ -571,7 +939,8 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
 
     m_list->Draw(vg, theme, m_entries_current.size(), [this, text_col, &got_dir_count](auto* vg, auto* theme, auto& v, auto i) {
         const auto& [x, y, w, h] = v;
-        auto& e = GetEntry(i);
+        const auto index = GetEntryIndex(i);
+        const auto name = m_entries.GetName(index);
 
         auto text_id = ThemeEntryID_TEXT;
         const auto selected = m_index == i;
@@ -584,11 +953,11 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
             }
         }
 
-        if (e.IsDir()) {
+        if (m_entries.IsDir(index)) {
             DrawElement(x + text_xoffset, y + 5, 50, 50, ThemeEntryID_ICON_FOLDER);
         } else {
             auto icon = ThemeEntryID_ICON_FILE;
-            const auto ext = e.GetExtension();
+            const auto ext = m_entries.GetExtension(index);
             if (IsExtension(ext, AUDIO_EXTENSIONS)) {
                 icon = ThemeEntryID_ICON_AUDIO;
             } else if (IsExtension(ext, VIDEO_EXTENSIONS)) {
@@ -607,19 +976,30 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
             DrawElement(x + text_xoffset, y + 5, 50, 50, icon);
         }
 
-        if (e.IsSelected()) {
+        if (m_entries.IsSelected(index)) {
             gfx::drawText(vg, x + text_xoffset + 50 / 2, y + (h / 2.f) - (24.f / 2), 24.f, "\uE14B", nullptr, NVG_ALIGN_CENTER | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_SELECTED));
         }
 
-        m_scroll_name.Draw(vg, selected, x + text_xoffset+65, y + (h / 2.f), w-(75+text_xoffset+65+50), 20, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(text_id), e.name);
+        m_scroll_name.Draw(vg, selected, x + text_xoffset+65, y + (h / 2.f), w-(75+text_xoffset+65+50), 20, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, theme->GetColour(text_id), name);
+
+        if (m_entries.IsDir(index) && !m_fs_entry.IsNoStatDir()) {
+            auto& e = m_entries.GetInfo(index);
+            if (e.dir_count == -1 && e.done_stat) {
+                return;
+            }
 
-        if (e.IsDir() && !m_fs_entry.IsNoStatDir() && (e.dir_count != -1 || !e.done_stat)) {
             // NOTE: this takes longer than 16ms when opening a new folder due to it
             // checking all 9 folders at once.
             if (!got_dir_count && !e.done_stat && e.file_count == -1 && e.dir_count == -1) {
                 got_dir_count = true;
                 e.done_stat = true;
-                m_fs->DirGetEntryCount(GetNewPath(e), &e.file_count, &e.dir_count);
+                m_fs->DirGetEntryCount(GetNewPath(m_path, name), &e.file_count, &e.dir_count);
+            }
+
+            if (const auto dir_size = FindDirSize(GetNewPath(m_path, name))) {
+                gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) - 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", utils::formatSizeStorage(dir_size->size).c_str());
+                gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) + 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%zd files"_i18n.c_str(), dir_size->file_count);
+                return;
             }
 
             if (e.file_count != -1) {
@@ -628,14 +1008,20 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
             if (e.dir_count != -1) {
                 gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) + 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%zd dirs"_i18n.c_str(), e.dir_count);
             }
-        } else if (e.IsFile() && !m_fs_entry.IsNoStatFile() && (e.file_size != -1 || !e.time_stamp.is_valid)) {
+        } else if (m_entries.IsFile(index) && !m_fs_entry.IsNoStatFile()) {
+            auto& e = m_entries.GetInfo(index);
+            auto& file_size = m_entries.GetFileSizeRef(index);
+            if (file_size == -1 && e.time_stamp.is_valid) {
+                return;
+            }
+
             if (!e.time_stamp.is_valid && !e.done_stat) {
                 e.done_stat = true;
-                const auto path = GetNewPath(e);
+                const auto path = GetNewPath(m_path, name);
                 if (m_fs->IsNative()) {
                     m_fs->GetFileTimeStampRaw(path, &e.time_stamp);
                 } else {
-                    m_fs->FileGetSizeAndTimestamp(path, &e.time_stamp, &e.file_size);
+                    m_fs->FileGetSizeAndTimestamp(path, &e.time_stamp, &file_size);
                 }
             }
 
@@ -644,24 +1030,25 @@ void FsView::Draw(NVGcontext* vg, Theme* theme) {
             localtime_r(&t, &tm);
 
             gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) + 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT_INFO), "%02u/%02u/%u", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
-            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) - 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", utils::formatSizeStorage(e.file_size).c_str());
+            gfx::drawTextArgs(vg, x + w - text_xoffset, y + (h / 2.f) - 3, 16.f, NVG_ALIGN_RIGHT | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "%s", utils::formatSizeStorage(file_size).c_str());
         }
     });
 }
 
 void FsView::OnFocusGained() {
     Widget::OnFocusGained();
-    if (m_entries.empty()) {
+    if (m_entries.IsEmpty()) {
         if (m_path.empty()) {
             Scan(m_fs->Root());
         } else {
             Scan(m_path);
         }
 
-        if (!m_entries.empty()) {
+        if (!m_entries.IsEmpty()) {
             LastFile last_file{};
-            if (ini_gets("paths", "last_file", "", last_file.name, sizeof(last_file.name), App::CONFIG_PATH)) {
-                SetIndexFromLastFile(last_file);
+            last_file.name = App::GetConfigStore().GetString("paths", "last_file", "");
+            if (!last_file.name.empty()) {
+                SetIndexFromLastFileAfterScan(last_file);
             }
         }
     }
@@ -783,7 +1170,7 @@ void FsView::OnClick() {
                     items.emplace_back(p.name);
                 }
 
-                const auto title = "Launch option for: "_i18n + GetEntry().name;
+                const auto title = "Launch option for: "_i18n + GetEntryName();
                 App::Push<PopupList>(
                     title, items, [this, assoc_list](auto op_index){
                         if (op_index) {
@@ -802,21 +1189,98 @@ void FsView::OnClick() {
     }
 }
 
+void FileList::Clear() {
+    m_hash = HASH_INIT;
+    m_names.clear();
+    m_name_off.clear();
+    m_file_size.clear();
+    m_type.clear();
+    m_selected.clear();
+    m_info.Release();
+
+    // release the memory from the previous dir, otherwise a large dir
+    // would keep it allocated.
+    m_names.shrink_to_fit();
+    m_name_off.shrink_to_fit();
+    m_file_size.shrink_to_fit();
+    m_type.shrink_to_fit();
+    m_selected.shrink_to_fit();
+}
+
+void FileList::Reserve(u32 count) {
+    m_name_off.reserve(count);
+    m_file_size.reserve(count);
+    m_type.reserve(count);
+    m_selected.reserve(count);
+}
+
+void FileList::Add(const FsDirectoryEntry& e) {
+    const auto len = strnlen(e.name, sizeof(e.name) - 1);
+
+    for (size_t i = 0; i < len; i++) {
+        m_hash = (m_hash ^ (u8)e.name[i]) * FNV_PRIME;
+    }
+    m_hash = (m_hash ^ e.type) * FNV_PRIME;
+    m_hash = (m_hash ^ (u64)e.file_size) * FNV_PRIME;
+
+    m_name_off.emplace_back(m_names.size());
+    m_names.insert(m_names.end(), e.name, e.name + len);
+    m_names.emplace_back('\0');
+    m_file_size.emplace_back(e.file_size);
+    m_type.emplace_back(e.type);
+    m_selected.emplace_back(false);
+}
+
+auto FileList::Get(u32 i) const -> FileEntry {
+    FileEntry e{};
+    std::strcpy(e.name, GetName(i));
+    e.type = GetType(i);
+    e.file_size = GetFileSize(i);
+    e.selected = IsSelected(i);
+
+    if (auto info = FindInfo(i)) {
+        e.internal_name = info->internal_name;
+        e.internal_extension = info->internal_extension;
+        e.file_count = info->file_count;
+        e.dir_count = info->dir_count;
+        e.time_stamp = info->time_stamp;
+        e.checked_internal_extension = info->checked_internal_extension;
+        e.done_stat = info->done_stat;
+    }
+
+    return e;
+}
+
+void FsView::SetEntrySelected(u32 index, bool selected) {
+    const auto i = GetEntryIndex(index);
+    if (m_entries.IsSelected(i) == selected) {
+        return;
+    }
+
+    m_entries.SetSelected(i, selected);
+    if (selected) {
+        m_selected_count++;
+    } else {
+        m_selected_count--;
+    }
+}
+
 void FsView::SetIndex(s64 index) {
     m_index = index;
     if (!m_index) {
         m_list->SetYoff();
     }
 
-    if (IsSd() && !m_entries_current.empty() && !GetEntry().checked_internal_extension && IsSamePath(GetEntry().GetExtension(), "zip")) {
-        GetEntry().checked_internal_extension = true;
+    if (IsSd() && !m_entries_current.empty() && IsSamePath(m_entries.GetExtension(GetEntryIndex(m_index)), "zip") && !m_entries.GetInfo(GetEntryIndex(m_index)).checked_internal_extension) {
+        auto& info = m_entries.GetInfo(GetEntryIndex(m_index));
+        info.checked_internal_extension = true;
 
         TimeStamp ts;
         fs::FsPath filename_inzip{};
         if (R_SUCCEEDED(mz::PeekFirstFileName(GetFs(), GetNewPathCurrent(), filename_inzip))) {
             if (auto ext = std::strrchr(filename_inzip, '.')) {
-                GetEntry().internal_name = filename_inzip.toString();
-                GetEntry().internal_extension = ext+1;
+                info.internal_name = filename_inzip.toString();
+                info.internal_extension = ext+1;
             }
             log_write("\tzip, time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
         }
@@ -835,7 +1299,7 @@ void FsView::InstallForwarder() {
 
     const auto assoc_list = m_menu->FindFileAssocFor();
     if (assoc_list.empty()) {
-        log_write("failed to find assoc for: %s ext: %s\n", GetEntry().name, GetEntry().GetExtension().c_str());
+        log_write("failed to find assoc for: %s ext: %s\n", GetEntryName(), GetEntry().GetExtension().c_str());
         return;
     }
 
@@ -844,7 +1308,7 @@ void FsView::InstallForwarder() {
         items.emplace_back(p.name);
     }
 
-    const auto title = std::string{"Select launcher for: "_i18n} + GetEntry().name;
+    const auto title = std::string{"Select launcher for: "_i18n} + GetEntryName();
     App::Push<PopupList>(
         title, items, [this, assoc_list](auto op_index){
             if (op_index) {
@@ -857,6 +1321,38 @@ void FsView::InstallForwarder() {
     );
 }
 
+void FsView::InstallForwarders() {
+    const auto targets = GetSelectedEntries();
+
+    App::Push<OptionBox>("Install forwarders for selected files?"_i18n, "No"_i18n, "Yes"_i18n, 0, [this, targets](auto op_index){
+        if (op_index && *op_index) {
+            App::PopToMenu();
+
+            App::Push<ui::ProgressBox>(0, "Installing Forwarder"_i18n, "", [this, targets](auto pbox) -> Result {
+                std::vector<OwoConfig> configs;
+                for (auto& e : targets) {
+                    const auto path = GetNewPath(e);
+
+                    auto& config = configs.emplace_back();
+                    config.nro_path = path.toString();
+                    R_TRY(nro_get_nacp(path, config.nacp));
+                    config.icon = nro_get_icon(path);
+                }
+
+                return App::Install(pbox, configs, [](const OwoConfig& config){
+                    App::Notify(i18n::Reorder("Installed ", config.name.empty() ? config.nacp.lang[0].name : config.name));
+                });
+            }, [](Result rc){
+                App::PushErrorBox(rc, "Failed to install forwarder"_i18n);
+
+                if (R_SUCCEEDED(rc)) {
+                    App::PlaySoundEffect(SoundEffect::Install);
+                }
+            });
+        }
+    });
+}
+
 void FsView::InstallFiles() {
     if (!App::GetInstallEnable()) {
         App::ShowEnableInstallPrompt();
@@ -870,12 +1366,14 @@ void FsView::InstallFiles() {
             App::PopToMenu();
 
             App::Push<ui::ProgressBox>(0, "Installing "_i18n, "", [this, targets](auto pbox) -> Result {
+                std::vector<fs::FsPath> paths;
                 for (auto& e : targets) {
-                    R_TRY(yati::InstallFromFile(pbox, m_fs.get(), GetNewPath(e)));
-                    App::Notify(i18n::Reorder("Installed ", e.GetName()));
+                    paths.emplace_back(GetNewPath(e));
                 }
 
-                R_SUCCEED();
+                return yati::InstallFromFiles(pbox, m_fs.get(), paths, {}, [](const fs::FsPath& path){
+                    App::Notify(i18n::Reorder("Installed ", std::strrchr(path, '/') + 1));
+                });
             }, [this](Result rc){
                 App::PushErrorBox(rc, "File install failed!"_i18n);
             });
@@ -986,13 +1484,7 @@ void FsView::ZipFiles(fs::FsPath zip_out) {
 
             pbox->NewTransfer(file_name_in_zip);
 
-            if (ZIP_OK != zipOpenNewFileInZip(zfile, file_name_in_zip, &zip_info, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION)) {
-                log_write("failed to add zip for %s\n", file_path.s);
-                R_THROW(Result_ZipOpenNewFileInZip);
-            }
-            ON_SCOPE_EXIT(zipCloseFileInZip(zfile));
-
-            return thread::TransferZip(pbox, zfile, m_fs.get(), file_path, nullptr, is_hdd_fs ? thread::Mode::SingleThreaded : thread::Mode::SingleThreadedIfSmaller);
+            return thread::TransferZipEntry(pbox, zfile, m_fs.get(), file_path, file_name_in_zip, &zip_info, Z_DEFAULT_COMPRESSION, is_hdd_fs ? thread::Mode::SingleThreaded : thread::Mode::SingleThreadedIfSmaller);
         };
 
         for (auto& e : targets) {
@@ -1037,13 +1529,23 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
 
     log_write("new scan path: %s\n", new_path.s);
     if (!is_walk_up && !m_path.empty() && !m_entries_current.empty()) {
-        const LastFile f(GetEntry().name, m_index, m_list->GetYoff(), m_entries_current.size());
+        const LastFile f(GetEntryName(), m_index, m_list->GetYoff(), m_entries_current.size());
         m_previous_highlighted_file.emplace_back(f);
     }
 
+    // the dir is opened by the thread's fs, so it has to be stopped first.
+    StopScan();
+
+    // scanning the same dir again is a refresh, ie, after an op has changed
+    // something, so any cached listing may now be out of date.
+    const auto is_refresh = m_path == new_path;
+    if (is_refresh) {
+        m_menu->InvalidateListingCache();
+    }
+
     g_change_signalled = false;
     m_path = new_path;
-    m_entries.clear();
+    m_entries.Clear();
     m_entries_index.clear();
     m_entries_index_hidden.clear();
     m_entries_index_search.clear();
@@ -1053,28 +1555,81 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
     SetIndex(0);
     m_menu->SetTitleSubHeading(m_path);
 
-    fs::Dir d;
-    R_TRY(m_fs->OpenDirectory(new_path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &d));
+    if (is_walk_up && !m_previous_highlighted_file.empty()) {
+        m_scan_last_file = m_previous_highlighted_file.back();
+        m_previous_highlighted_file.pop_back();
+    }
+
+    if (!is_refresh) {
+        if (auto cached = m_menu->FindListing(m_fs_entry, m_fs.get(), new_path)) {
+            log_write("[FS] using cached listing for: %s\n", new_path.s);
+            m_entries = *cached;
+            IndexEntries(0);
+            Sort();
+            SetIndex(0);
+            OnScanDone(false);
+            R_SUCCEED();
+        }
+    }
 
-    // we won't run out of memory here (tm)
-    std::vector<FsDirectoryEntry> dir_entries;
-    R_TRY(d.ReadAll(dir_entries));
+    auto scan = std::make_unique<ScanData>();
+    mutexInit(&scan->mutex);
+    R_TRY(m_fs->OpenDirectory(new_path, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &scan->dir));
 
-    const auto count = dir_entries.size();
-    m_entries.reserve(count);
-    m_entries_index.reserve(count);
-    m_entries_index_hidden.reserve(count);
+    // read the first batch here so that small dirs are handled in one go
+    // and large dirs have something to show on the first frame.
+    std::vector<FsDirectoryEntry> batch(SCAN_BATCH_SIZE);
+    s64 total;
+    R_TRY(scan->dir.Read(&total, batch.size(), batch.data()));
+    AddEntries(std::span{batch.data(), (size_t)total});
+    Sort();
+    SetIndex(0);
 
-    u32 i = 0;
-    for (const auto& e : dir_entries) {
-        bool hidden = false;
-        if ('.' == e.name[0]) {
+    if (total < (s64)batch.size()) {
+        OnScanDone();
+        R_SUCCEED();
+    }
+
+    // rest of the dir is read in the background, see UpdateScan().
+    R_TRY(utils::CreateThread(&scan->thread, scan_thread_func, scan.get(), 1024 * 64));
+    if (const auto rc = threadStart(&scan->thread); R_FAILED(rc)) {
+        threadClose(&scan->thread);
+        R_THROW(rc);
+    }
+    scan->started = true;
+
+    m_scan = std::move(scan);
+    log_write("[FS] scanning %s in the background\n", new_path.s);
+    R_SUCCEED();
+}
+
+void FsView::AddEntries(std::span<const FsDirectoryEntry> entries) {
+    const auto start = m_entries.Size();
+    m_entries.Reserve(start + entries.size());
+
+    for (const auto& e : entries) {
+        m_entries.Add(e);
+    }
+
+    IndexEntries(start);
+}
+
+void FsView::IndexEntries(u32 start) {
+    const auto count = m_entries.Size();
+    m_entries_index.reserve(count);
+    m_entries_index_hidden.reserve(count);
+
+    for (u32 i = start; i < count; i++) {
+        const auto name = m_entries.GetName(i);
+
+        bool hidden = false;
+        if ('.' == name[0]) {
             hidden = true;
         }
         // check if we have a filter.
-        else if (e.type == FsDirEntryType_File && !m_menu->m_filter.empty()) {
+        else if (m_entries.IsFile(i) && !m_menu->m_filter.empty()) {
             hidden = true;
-            if (const auto ext = std::strrchr(e.name, '.')) {
+            if (const auto ext = std::strrchr(name, '.')) {
                 for (const auto& filter : m_menu->m_filter) {
                     if (IsExtension(ext + 1, filter)) {
                         hidden = false;
@@ -1089,12 +1644,129 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
         }
 
         m_entries_index_hidden.emplace_back(i);
-        m_entries.emplace_back(e);
-        i++;
     }
 
-    Sort();
-    SetIndex(0);
+    // the vectors may have been reallocated.
+    // new entries are added to the end until the dir has been fully read,
+    // so that the list doesn't jump around whilst scrolling.
+    if (m_menu->m_show_hidden.Get()) {
+        m_entries_current = m_entries_index_hidden;
+    } else {
+        m_entries_current = m_entries_index;
+    }
+}
+
+void FsView::UpdateScan() {
+    if (!m_scan) {
+        return;
+    }
+
+    std::vector<FsDirectoryEntry> pending;
+    {
+        SCOPED_MUTEX(&m_scan->mutex);
+        std::swap(pending, m_scan->pending);
+    }
+
+    // done is checked after taking the entries, as the thread adds the last
+    // batch before setting done.
+    const auto done = m_scan->done.load();
+
+    if (!pending.empty()) {
+        AddEntries(pending);
+    }
+
+    if (done) {
+        const auto rc = m_scan->rc;
+        if (R_FAILED(rc)) {
+            log_write("[FS] background scan failed: 0x%X\n", rc);
+        }
+
+        m_scan.reset();
+
+        // keep the highlighted entry if nothing else has been requested.
+        if (!m_scan_last_file && !m_entries_current.empty()) {
+            m_scan_last_file = LastFile(GetEntryName(), m_index, m_list->GetYoff(), m_entries_current.size());
+        }
+
+        Sort();
+        OnScanDone(R_SUCCEEDED(rc));
+        log_write("[FS] finished scanning %s, %zu entries\n", m_path.s, m_entries.Size());
+    }
+}
+
+void FsView::StopScan() {
+    m_scan.reset();
+    m_scan_last_file.reset();
+}
+
+void FsView::CalculateDirSize(const fs::FsPath& path) {
+    for (const auto& e : m_dir_size_jobs) {
+        if (e->fs_entry.IsSame(m_fs_entry) && e->path == path) {
+            log_write("[FS] already calculating size of %s\n", path.s);
+            return;
+        }
+    }
+
+    auto data = std::make_unique<DirSizeData>();
+    data->fs = m_fs;
+    data->fs_entry = m_fs_entry;
+    data->path = path;
+
+    if (R_FAILED(utils::CreateThread(&data->thread, dir_size_thread_func, data.get(), 1024 * 64))) {
+        log_write("[FS] failed to create dir size thread\n");
+        return;
+    }
+
+    if (R_FAILED(threadStart(&data->thread))) {
+        threadClose(&data->thread);
+        log_write("[FS] failed to start dir size thread\n");
+        return;
+    }
+
+    data->started = true;
+    m_dir_size_jobs.emplace_back(std::move(data));
+}
+
+void FsView::UpdateDirSizes() {
+    for (auto itr = m_dir_size_jobs.begin(); itr != m_dir_size_jobs.end();) {
+        const auto& data = **itr;
+        if (!data.done) {
+            ++itr;
+            continue;
+        }
+
+        const auto name = std::strrchr(data.path, '/');
+        const auto display_name = name && name[1] ? name + 1 : data.path.s;
+
+        if (R_FAILED(data.rc)) {
+            App::PushErrorBox(data.rc, "Failed to calculate folder size"_i18n);
+        } else {
+            std::erase_if(m_dir_sizes, [&data](const auto& e){
+                return e.fs_entry.IsSame(data.fs_entry) && e.path == data.path;
+            });
+
+            m_dir_sizes.emplace_back(data.fs_entry, data.path, data.size, data.file_count, data.dir_count);
+            App::Notify(std::string{display_name} + ": " + utils::formatSizeStorage(data.size));
+        }
+
+        itr = m_dir_size_jobs.erase(itr);
+    }
+}
+
+auto FsView::FindDirSize(const fs::FsPath& path) const -> const DirSize* {
+    for (const auto& e : m_dir_sizes) {
+        if (e.fs_entry.IsSame(m_fs_entry) && e.path == path) {
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+void FsView::OnScanDone(bool store) {
+    if (store) {
+        m_menu->StoreListing(m_fs_entry, m_fs.get(), m_path, m_entries);
+    }
 
     // quick check to see if this is an update folder
     // todo: only check this on click.
@@ -1103,76 +1775,88 @@ auto FsView::Scan(fs::FsPath new_path, bool is_walk_up) -> Result {
     }
 
     // find previous entry
-    if (is_walk_up && !m_previous_highlighted_file.empty()) {
-        ON_SCOPE_EXIT(m_previous_highlighted_file.pop_back());
-        SetIndexFromLastFile(m_previous_highlighted_file.back());
+    if (m_scan_last_file) {
+        SetIndexFromLastFile(*m_scan_last_file);
+        m_scan_last_file.reset();
     }
-
-    R_SUCCEED();
 }
 
 void FsView::Sort() {
-    // returns true if lhs should be before rhs
     const auto sort = m_menu->m_sort.Get();
     const auto order = m_menu->m_order.Get();
     const auto folders_first = m_menu->m_folders_first.Get();
     const auto hidden_last = m_menu->m_hidden_last.Get();
 
-    const auto sorter = [this, sort, order, folders_first, hidden_last](u32 _lhs, u32 _rhs) -> bool {
-        const auto& lhs = m_entries[_lhs];
-        const auto& rhs = m_entries[_rhs];
+    const auto show_hidden = m_menu->m_show_hidden.Get();
 
-        if (hidden_last) {
-            if (lhs.IsHidden() && !rhs.IsHidden()) {
-                return false;
-            } else if (!lhs.IsHidden() && rhs.IsHidden()) {
-                return true;
-            }
-        }
+    if (show_hidden) {
+        m_entries_current = m_entries_index_hidden;
+    } else {
+        m_entries_current = m_entries_index;
+    }
 
-        if (folders_first) {
-            if (lhs.type == FsDirEntryType_Dir && !(rhs.type == FsDirEntryType_Dir)) { // left is folder
-                return true;
-            } else if (!(lhs.type == FsDirEntryType_Dir) && rhs.type == FsDirEntryType_Dir) { // right is folder
-                return false;
-            }
-        }
+    const auto count = m_entries_current.size();
+    const u32 settings = (sort & 0xF) | (order & 0xF) << 4 | folders_first << 8 | hidden_last << 9 | show_hidden << 10;
+    // sizes for non native fs are filled in as entries are drawn, so the
+    // order may be different the next time the dir is scanned.
+    const auto use_cache = count >= SORT_CACHE_MIN && (sort != SortType_Size || m_fs->IsNative());
 
-        switch (sort) {
-            case SortType_Size: {
-                if (lhs.file_size == rhs.file_size) {
-                    return strncasecmp(lhs.name, rhs.name, sizeof(lhs.name)) < 0;
-                } else if (order == OrderType_Descending) {
-                    return lhs.file_size > rhs.file_size;
-                } else {
-                    return lhs.file_size < rhs.file_size;
-                }
-            } break;
-            case SortType_Alphabetical: {
-                if (order == OrderType_Descending) {
-                    return strncasecmp(lhs.name, rhs.name, sizeof(lhs.name)) < 0;
-                } else {
-                    return strncasecmp(lhs.name, rhs.name, sizeof(lhs.name)) > 0;
-                }
-            } break;
+    if (use_cache) {
+        const auto it = std::ranges::find_if(m_sort_cache, [this, settings, count](const auto& e) {
+            return e.settings == settings && e.hash == m_entries.GetHash() && e.order.size() == count && e.path == m_path;
+        });
+
+        if (it != m_sort_cache.end()) {
+            std::ranges::copy(it->order, m_entries_current.begin());
+            std::rotate(m_sort_cache.begin(), it, it + 1);
+            log_write("[FS] using cached sort for: %s\n", m_path.s);
+            return;
         }
+    }
 
-        std::unreachable();
-    };
+    std::vector<SortKey> keys(count);
+    for (u32 i = 0; i < count; i++) {
+        const auto index = m_entries_current[i];
+        auto& key = keys[i];
+        key.prefix = fold_name_prefix(m_entries.GetName(index));
+        key.size = m_entries.GetFileSize(index);
+        key.index = index;
+        key.rank = 0;
 
-    if (m_menu->m_show_hidden.Get()) {
-        m_entries_current = m_entries_index_hidden;
+        if (hidden_last && m_entries.IsHidden(index)) {
+            key.rank |= 2;
+        }
+        if (folders_first && !m_entries.IsDir(index)) {
+            key.rank |= 1;
+        }
+    }
+
+    const SortCompare compare{m_entries, sort, order};
+    if (count >= PARALLEL_SORT_MIN) {
+        parallel_sort(keys, compare);
     } else {
-        m_entries_current = m_entries_index;
+        std::sort(keys.begin(), keys.end(), compare);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        m_entries_current[i] = keys[i].index;
     }
 
-    std::sort(m_entries_current.begin(), m_entries_current.end(), sorter);
+    if (use_cache) {
+        if (m_sort_cache.size() >= SORT_CACHE_MAX) {
+            m_sort_cache.pop_back();
+        }
+
+        SortCacheEntry entry{m_path, m_entries.GetHash(), settings};
+        entry.order.assign(m_entries_current.begin(), m_entries_current.end());
+        m_sort_cache.emplace(m_sort_cache.begin(), std::move(entry));
+    }
 }
 
 void FsView::SortAndFindLastFile(bool scan) {
     std::optional<LastFile> last_file;
     if (!m_path.empty() && !m_entries_current.empty()) {
-        last_file = LastFile(GetEntry().name, m_index, m_list->GetYoff(), m_entries_current.size());
+        last_file = LastFile(GetEntryName(), m_index, m_list->GetYoff(), m_entries_current.size());
     }
 
     if (scan) {
@@ -1182,7 +1866,19 @@ void FsView::SortAndFindLastFile(bool scan) {
     }
 
     if (last_file.has_value()) {
-        SetIndexFromLastFile(*last_file);
+        if (scan) {
+            SetIndexFromLastFileAfterScan(*last_file);
+        } else {
+            SetIndexFromLastFile(*last_file);
+        }
+    }
+}
+
+void FsView::SetIndexFromLastFileAfterScan(const LastFile& last_file) {
+    if (IsScanning()) {
+        m_scan_last_file = last_file;
+    } else {
+        SetIndexFromLastFile(last_file);
     }
 }
 
@@ -1191,7 +1887,7 @@ void FsView::SetIndexFromLastFile(const LastFile& last_file) {
 
     s64 index = -1;
     for (u64 i = 0; i < m_entries_current.size(); i++) {
-        if (last_file.name == GetEntry(i).name) {
+        if (last_file.name == GetEntryName(i)) {
             index = i;
             break;
         }
@@ -1270,7 +1966,23 @@ void FsView::OnDeleteCallback() {
     }
 }
 
-void FsView::OnPasteCallback() {
+void FsView::OnDeleteBackgroundCallback() {
+    const auto& selected = m_menu->m_selected;
+
+    // each entry is only renamed into the trash, so this is quick enough
+    // to do without a progress box.
+    for (const auto& p : selected.m_files) {
+        const auto full_path = GetNewPath(selected.m_path, p.name);
+        if (const auto rc = trash::Push(selected.m_view->m_fs, full_path, p.IsDir()); R_FAILED(rc)) {
+            App::PushErrorBox(rc, "Failed to move to trash"_i18n);
+            break;
+        }
+    }
+
+    m_menu->RefreshViews();
+}
+
+void FsView::OnPasteCallback(bool background, bool verify) {
     // check if we only have 1 file / folder and is cut (rename)
     if (m_menu->m_selected.SameFs(this) && m_menu->m_selected.m_files.size() == 1 && m_menu->m_selected.m_type == SelectedType::Cut) {
         const auto& entry = m_menu->m_selected.m_files[0];
@@ -1284,26 +1996,31 @@ void FsView::OnPasteCallback() {
 
         m_menu->RefreshViews();
     } else {
-        App::Push<ProgressBox>(0, "Pasting"_i18n, "", [this](auto pbox) -> Result {
-            auto& selected = m_menu->m_selected;
-            auto src_fs = selected.m_view->GetFs();
-            const auto is_same_fs = selected.SameFs(this);
+        // everything is copied out of the menu, so that the paste can keep
+        // running as a job once the menu is closed.
+        const auto& selected = m_menu->m_selected;
+        const auto is_same_fs = m_menu->m_selected.SameFs(this);
+        const auto parallel_read = !is_same_fs && !selected.m_view->GetFsEntry().IsNoRandomReads();
+
+        const auto paste = [selected, src_fs_ref = selected.m_view->m_fs, dst_fs_ref = m_fs, dst_root = m_path, is_same_fs, parallel_read, verify](auto pbox) -> Result {
+            const auto src_fs = src_fs_ref.get();
+            const auto dst_fs = dst_fs_ref.get();
 
-            if (selected.SameFs(this) && selected.m_type == SelectedType::Cut) {
+            if (is_same_fs && selected.m_type == SelectedType::Cut) {
                 for (const auto& p : selected.m_files) {
                     pbox->Yield();
                     R_TRY(pbox->ShouldExitResult());
 
                     const auto src_path = GetNewPath(selected.m_path, p.name);
-                    const auto dst_path = GetNewPath(m_path, p.name);
+                    const auto dst_path = GetNewPath(dst_root, p.name);
 
                     pbox->SetTitle(p.name);
                     pbox->NewTransfer(i18n::Reorder("Pasting ", src_path));
 
                     if (p.IsDir()) {
-                        m_fs->RenameDirectory(src_path, dst_path);
+                        dst_fs->RenameDirectory(src_path, dst_path);
                     } else {
-                        m_fs->RenameFile(src_path, dst_path);
+                        dst_fs->RenameFile(src_path, dst_path);
                     }
                 }
             } else {
@@ -1312,10 +2029,10 @@ void FsView::OnPasteCallback() {
                 const auto on_paste_file = [&](auto& src_path, auto& dst_path) -> Result {
                     if (selected.m_type == SelectedType::Cut) {
                         // update timestamp if possible.
-                        if (!m_fs->IsNative()) {
+                        if (!dst_fs->IsNative()) {
                             FsTimeStampRaw ts;
                             if (R_SUCCEEDED(src_fs->GetFileTimeStampRaw(src_path, &ts))) {
-                                m_fs->SetTimestamp(dst_path, &ts);
+                                dst_fs->SetTimestamp(dst_path, &ts);
                             }
                         }
 
@@ -1338,55 +2055,85 @@ void FsView::OnPasteCallback() {
                     }
                 }
 
+                // create all the folders first, then copy the files in one go.
+                std::vector<copy::Entry> entries;
+
                 for (const auto& p : selected.m_files) {
                     pbox->Yield();
                     R_TRY(pbox->ShouldExitResult());
 
                     const auto src_path = GetNewPath(selected.m_path, p.name);
-                    const auto dst_path = GetNewPath(p);
+                    const auto dst_path = GetNewPath(dst_root, p.name);
 
                     if (p.IsDir()) {
                         pbox->SetTitle(p.name);
                         pbox->NewTransfer(i18n::Reorder("Creating ", dst_path));
-                        m_fs->CreateDirectory(dst_path);
+                        dst_fs->CreateDirectory(dst_path);
                     } else {
-                        pbox->SetTitle(p.name);
-                        pbox->NewTransfer(i18n::Reorder("Copying ", src_path));
-                        R_TRY(pbox->CopyFile(src_fs, m_fs.get(), src_path, dst_path, is_same_fs));
-                        R_TRY(on_paste_file(src_path, dst_path));
+                        entries.emplace_back(src_path, dst_path, p.file_size);
                     }
                 }
 
-                // copy everything in collections
                 for (const auto& c : collections) {
-                    const auto base_dst_path = GetNewPath(m_path, c.parent_name);
+                    const auto base_dst_path = GetNewPath(dst_root, c.parent_name);
 
                     for (const auto& p : c.dirs) {
                         pbox->Yield();
                         R_TRY(pbox->ShouldExitResult());
 
-                        // const auto src_path = GetNewPath(c.path, p.name);
                         const auto dst_path = GetNewPath(base_dst_path, p.name);
 
                         pbox->SetTitle(p.name);
                         pbox->NewTransfer(i18n::Reorder("Creating ", dst_path));
-                        m_fs->CreateDirectory(dst_path);
+                        dst_fs->CreateDirectory(dst_path);
                     }
 
                     for (const auto& p : c.files) {
+                        entries.emplace_back(GetNewPath(c.path, p.name), GetNewPath(base_dst_path, p.name), p.file_size);
+                    }
+                }
+
+                // copies within a network mount are done on the server if it
+                // supports it, so that the data doesn't go through the switch.
+                // none of the mounts can return a checksum, so verified copies
+                // are always streamed.
+                if (is_same_fs && selected.m_type == SelectedType::Copy && !dst_fs->IsNative() && !verify) {
+                    std::vector<copy::Entry> remaining;
+                    bool server_copy = true;
+
+                    for (const auto& e : entries) {
                         pbox->Yield();
                         R_TRY(pbox->ShouldExitResult());
 
-                        const auto src_path = GetNewPath(c.path, p.name);
-                        const auto dst_path = GetNewPath(base_dst_path, p.name);
+                        if (server_copy) {
+                            pbox->NewTransfer(i18n::Reorder("Copying on server ", e.dst));
 
-                        pbox->SetTitle(p.name);
-                        pbox->NewTransfer(i18n::Reorder("Copying ", src_path));
-                        R_TRY(pbox->CopyFile(src_fs, m_fs.get(), src_path, dst_path, is_same_fs));
-                        R_TRY(on_paste_file(src_path, dst_path));
+                            const auto rc = devoptab::ServerCopyFile(e.src, e.dst);
+                            if (R_SUCCEEDED(rc)) {
+                                continue;
+                            }
+
+                            // stop trying once the mount says it can't.
+                            log_write("[FS] server copy failed: 0x%X, falling back\n", rc);
+                            server_copy = rc != Result_DevoptabServerCopyNotSupported;
+                        }
+
+                        remaining.emplace_back(e);
                     }
+
+                    entries = std::move(remaining);
                 }
 
+                const copy::Config config{
+                    .single_threaded = is_same_fs,
+                    .parallel_read = parallel_read,
+                    .verify = verify,
+                };
+
+                R_TRY(copy::CopyFiles(pbox, src_fs, dst_fs, entries, config, [&](const copy::Entry& e) -> Result {
+                    return on_paste_file(e.src, e.dst);
+                }));
+
                 // moving accross fs is not possible, thus files have to be copied.
                 // this leaves the files on the src_fs.
                 // the files are deleted one by one after a successfull copy (see above)
@@ -1399,7 +2146,16 @@ void FsView::OnPasteCallback() {
             }
 
             R_SUCCEED();
-        }, [this](Result rc){
+        };
+
+        if (background) {
+            // the menu may be gone by the time it finishes, so it's not refreshed.
+            jobs::Push(GetJobDevice(m_fs_entry), "Pasting"_i18n, i18n::Reorder("Pasting ", m_path.toString()), paste);
+            m_menu->ResetSelection();
+            return;
+        }
+
+        App::Push<ProgressBox>(0, "Pasting"_i18n, "", paste, [this](Result rc){
             App::PushErrorBox(rc, "Failed to, TODO: add message here"_i18n);
 
             m_menu->RefreshViews();
@@ -1408,6 +2164,84 @@ void FsView::OnPasteCallback() {
     }
 }
 
+void FsView::OnSyncCallback() {
+    const auto& selected = m_menu->m_selected;
+    const auto is_same_fs = m_menu->m_selected.SameFs(this);
+    const auto parallel_read = !is_same_fs && !selected.m_view->GetFsEntry().IsNoRandomReads();
+    const auto src_fs = selected.m_view->m_fs;
+    const auto dst_fs = m_fs;
+    const auto plan = std::make_shared<sync::Plan>();
+
+    // mounts that can't stat files are compared by size only.
+    sync::Config config{};
+    config.compare_timestamp = !selected.m_view->GetFsEntry().IsNoStatFile() && !m_fs_entry.IsNoStatFile();
+
+    const copy::Config copy_config{
+        .single_threaded = is_same_fs,
+        .parallel_read = parallel_read,
+    };
+
+    const auto apply = [this, plan, src_fs, dst_fs, copy_config](bool delete_extra) {
+        App::Push<ProgressBox>(0, "Syncing"_i18n, "", [plan, src_fs, dst_fs, copy_config, delete_extra](auto pbox) -> Result {
+            return sync::ApplyPlan(pbox, src_fs.get(), dst_fs.get(), *plan, delete_extra, copy_config);
+        }, [this](Result rc){
+            App::PushErrorBox(rc, "Failed to sync"_i18n);
+
+            m_menu->RefreshViews();
+            log_write("did sync\n");
+        });
+    };
+
+    App::Push<ProgressBox>(0, "Scanning"_i18n, "", [selected, plan, src_fs, dst_fs, dst_root = m_path, config](auto pbox) -> Result {
+        for (const auto& p : selected.m_files) {
+            pbox->Yield();
+            R_TRY(pbox->ShouldExitResult());
+
+            const auto src_path = GetNewPath(selected.m_path, p.name);
+            const auto dst_path = GetNewPath(dst_root, p.name);
+            pbox->SetTitle(p.name);
+
+            if (p.IsDir()) {
+                R_TRY(sync::BuildPlan(pbox, src_fs.get(), dst_fs.get(), src_path, dst_path, *plan, config));
+            } else {
+                R_TRY(sync::BuildPlanFile(src_fs.get(), dst_fs.get(), src_path, dst_path, *plan, config));
+            }
+        }
+
+        R_SUCCEED();
+    }, [plan, apply](Result rc){
+        if (R_FAILED(rc)) {
+            if (rc != Result_TransferCancelled) {
+                App::PushErrorBox(rc, "Failed to scan"_i18n);
+            }
+            return;
+        }
+
+        const auto extra_count = plan->extra_files.size() + plan->extra_dirs.size();
+        if (plan->files.empty() && plan->dirs.empty() && !extra_count) {
+            App::Notify("Already in sync"_i18n);
+            return;
+        }
+
+        // nothing is changed until an option is picked.
+        char summary[256];
+        std::snprintf(summary, sizeof(summary), "New: %zu Changed: %zu Unchanged: %zu Extra: %zu (%s)"_i18n.c_str(),
+            plan->new_count, plan->changed_count, plan->unchanged_count, extra_count, utils::formatSizeStorage(plan->copy_size).c_str());
+
+        PopupList::Items items;
+        items.emplace_back("Copy new and changed files"_i18n);
+        if (extra_count) {
+            items.emplace_back("Copy and delete extra files"_i18n);
+        }
+
+        App::Push<PopupList>(summary, items, [apply](auto op_index){
+            if (op_index) {
+                apply(*op_index == 1);
+            }
+        });
+    });
+}
+
 void FsView::OnRenameCallback() {
 
 }
@@ -1438,14 +2272,14 @@ auto FsView::CheckIfUpdateFolder() -> Result {
     }
 
     // check that we have enough ncas and not too many
-    R_UNLESS(m_entries.size() > 150 && m_entries.size() < 300, Result_FileBrowserDirNotDaybreak);
+    R_UNLESS(m_entries.Size() > 150 && m_entries.Size() < 300, Result_FileBrowserDirNotDaybreak);
 
     // check that all entries end in .nca
-    for (auto& e : m_entries) {
+    for (u32 i = 0; i < m_entries.Size(); i++) {
         // check that we are at the bottom level
-        R_UNLESS(e.type == FsDirEntryType_File, Result_FileBrowserDirNotDaybreak);
+        R_UNLESS(m_entries.IsFile(i), Result_FileBrowserDirNotDaybreak);
 
-        const auto ext = std::strrchr(e.name, '.');
+        const auto ext = std::strrchr(m_entries.GetName(i), '.');
         R_UNLESS(ext && IsSamePath(ext, ".nca"), Result_FileBrowserDirNotDaybreak);
     }
 
@@ -1456,10 +2290,13 @@ auto FsView::get_collection(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath
     out.path = path;
     out.parent_name = parent_name;
 
-    const auto fetch = [fs, &path](std::vector<FsDirectoryEntry>& out, u32 flags) -> Result {
+    std::vector<FsDirectoryEntry> buf;
+    const auto fetch = [fs, &path, &buf](walk::Entries& out, u32 flags) -> Result {
         fs::Dir d;
         R_TRY(fs->OpenDirectory(path, flags, &d));
-        return d.ReadAll(out);
+        R_TRY(d.ReadAll(buf));
+        out.Assign(buf);
+        R_SUCCEED();
     };
 
     if (inc_file) {
@@ -1478,22 +2315,10 @@ auto FsView::get_collection(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath
 }
 
 auto FsView::get_collections(fs::Fs* fs, const fs::FsPath& path, const fs::FsPath& parent_name, FsDirCollections& out, bool inc_size) -> Result {
-    // get a list of all the files / dirs
-    FsDirCollection collection;
-    R_TRY(get_collection(fs, path, parent_name, collection, true, true, inc_size));
-    log_write("got collection: %s parent_name: %s files: %zu dirs: %zu\n", path.s, parent_name.s, collection.files.size(), collection.dirs.size());
-    out.emplace_back(collection);
-
-    // for (size_t i = 0; i < collection.dirs.size(); i++) {
-    for (const auto&p : collection.dirs) {
-        // use heap as to not explode the stack
-        const auto new_path = std::make_unique<fs::FsPath>(FsView::GetNewPath(path, p.name));
-        const auto new_parent_name = std::make_unique<fs::FsPath>(FsView::GetNewPath(parent_name, p.name));
-        log_write("trying to get nested collection: %s parent_name: %s\n", new_path->s, new_parent_name->s);
-        R_TRY(get_collections(fs, *new_path, *new_parent_name, out, inc_size));
-    }
-
-    R_SUCCEED();
+    // get a list of all the files / dirs, several dirs are read at once.
+    walk::Config config{};
+    config.inc_size = inc_size;
+    return walk::Walk(fs, path, parent_name, out, config);
 }
 
 auto FsView::get_collection(const fs::FsPath& path, const fs::FsPath& parent_name, FsDirCollection& out, bool inc_file, bool inc_dir, bool inc_size) -> Result {
@@ -1505,34 +2330,97 @@ auto FsView::get_collections(const fs::FsPath& path, const fs::FsPath& parent_na
 }
 
 Result FsView::DeleteAllCollections(ProgressBox* pbox, fs::Fs* fs, const FsDirCollections& collections, u32 mode) {
-    // delete everything in collections, reversed
-    for (const auto& c : std::views::reverse(collections)) {
-        const auto delete_func = [&](auto& array) -> Result {
-            for (const auto& p : array) {
-                pbox->Yield();
+    // files are deleted first by a pool of workers, then the dirs can be
+    // deleted in reverse so that sub dirs are removed before their parent.
+    if (mode & FsDirOpenMode_ReadFiles) {
+        R_TRY(DeleteAllFiles(pbox, fs, collections));
+    }
+
+    if (mode & FsDirOpenMode_ReadDirs) {
+        u64 last_update{};
+        for (const auto& c : std::views::reverse(collections)) {
+            for (const auto& p : c.dirs) {
                 R_TRY(pbox->ShouldExitResult());
 
                 const auto full_path = FsView::GetNewPath(c.path, p.name);
-                pbox->SetTitle(p.name);
-                pbox->NewTransfer(i18n::Reorder("Deleting ", full_path.toString()));
-                if ((mode & FsDirOpenMode_ReadDirs) && p.type == FsDirEntryType_Dir) {
-                    log_write("deleting dir: %s\n", full_path.s);
-                    R_TRY(fs->DeleteDirectory(full_path));
-                    svcSleepThread(1e+5);
-                } else if ((mode & FsDirOpenMode_ReadFiles) && p.type == FsDirEntryType_File) {
-                    log_write("deleting file: %s\n", full_path.s);
-                    R_TRY(fs->DeleteFile(full_path));
-                    svcSleepThread(1e+5);
+                log_write("deleting dir: %s\n", full_path.s);
+                R_TRY(fs->DeleteDirectory(full_path));
+
+                // only update the progress every so often, as drawing is
+                // slower than deleting an empty dir.
+                if (armTicksToNs(armGetSystemTick() - last_update) >= DELETE_PROGRESS_INTERVAL) {
+                    last_update = armGetSystemTick();
+                    pbox->SetTitle(p.name);
+                    pbox->NewTransfer(i18n::Reorder("Deleting ", full_path.toString()));
+                    pbox->Yield();
                 }
             }
+        }
+    }
 
-            R_SUCCEED();
-        };
+    R_SUCCEED();
+}
+
+Result FsView::DeleteAllFiles(ProgressBox* pbox, fs::Fs* fs, const FsDirCollections& collections) {
+    DeleteData t_data{fs, collections};
+    for (u32 i = 0; i < collections.size(); i++) {
+        for (u32 j = 0; j < collections[i].files.size(); j++) {
+            if (collections[i].files[j].type == FsDirEntryType_File) {
+                t_data.files.emplace_back(i, j);
+            }
+        }
+    }
+
+    if (t_data.files.empty()) {
+        R_SUCCEED();
+    }
+
+    // file based emummc can't handle lots of parallel io, so slow it down.
+    t_data.throttle = App::IsFileBaseEmummc() && fs->IsNative();
+    const auto worker_count = std::min<u32>(walk::GetWorkerCount(fs), t_data.files.size());
 
-        R_TRY(delete_func(c.files));
-        R_TRY(delete_func(c.dirs));
+    Thread t_workers[DELETE_WORKER_MAX]{};
+    u32 t_worker_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadClose(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < std::min(worker_count, DELETE_WORKER_MAX); i++) {
+        R_TRY(utils::CreateThread(&t_workers[i], delete_thread_func, std::addressof(t_data)));
+        t_worker_count++;
+    }
+
+    ON_SCOPE_EXIT(
+        // ensure the workers exit if we return early.
+        t_data.stop = true;
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadWaitForExit(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < t_worker_count; i++) {
+        R_TRY(threadStart(&t_workers[i]));
     }
 
+    pbox->SetTitle("Deleting files"_i18n);
+    for (;;) {
+        R_TRY(pbox->ShouldExitResult());
+        R_TRY(t_data.result.load());
+
+        const auto done = t_data.done_count.load();
+        pbox->NewTransfer(i18n::Reorder("Deleting ", std::to_string(done) + " / " + std::to_string(t_data.files.size())));
+        pbox->UpdateTransfer(done, t_data.files.size());
+
+        if (done >= t_data.files.size()) {
+            break;
+        }
+
+        svcSleepThread(DELETE_PROGRESS_INTERVAL);
+    }
+
+    log_write("[FS] deleted %zu files with %u workers\n", t_data.files.size(), t_worker_count);
     R_SUCCEED();
 }
 
@@ -1565,9 +2453,12 @@ void FsView::SetFs(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& new_path
         return;
     }
 
+    StopScan();
+    m_sort_cache.clear();
+
     // m_fs.reset();
     m_path = new_path;
-    m_entries.clear();
+    m_entries.Clear();
     m_entries_index.clear();
     m_entries_index_hidden.clear();
     m_entries_index_search.clear();
@@ -1588,24 +2479,73 @@ void FsView::SetFs(const std::shared_ptr<fs::Fs>& fs, const fs::FsPath& new_path
 }
 
 void FsView::DisplayHash(hash::Type type) {
+    DisplayHash(std::span{&type, 1});
+}
+
+void FsView::DisplayHash(std::span<const hash::Type> types) {
     // hack because we cannot share output between threaded calls...
-    static std::string hash_out;
+    static std::vector<std::string> hash_out;
     hash_out.clear();
 
-    App::Push<ProgressBox>(0, "Hashing"_i18n, GetEntry().name, [this, type](auto pbox) -> Result {
+    const std::vector<hash::Type> hash_types{types.begin(), types.end()};
+
+    App::Push<ProgressBox>(0, "Hashing"_i18n, GetEntryName(), [this, hash_types](auto pbox) -> Result {
         const auto full_path = GetNewPathCurrent();
         pbox->NewTransfer(full_path);
-        R_TRY(hash::Hash(pbox, type, m_fs.get(), full_path, hash_out));
+        R_TRY(hash::Hash(pbox, hash_types, m_fs.get(), full_path, hash_out));
 
         R_SUCCEED();
-    }, [this, type](Result rc){
+    }, [this, hash_types](Result rc){
         App::PushErrorBox(rc, "Failed to hash file..."_i18n);
 
         if (R_SUCCEEDED(rc)) {
-            char buf[0x100];
-            // std::snprintf(buf, sizeof(buf), "%s\n%s\n%s", hash::GetTypeStr(type), hash_out.c_str(), GetEntry().GetName());
-            std::snprintf(buf, sizeof(buf), "%s\n%s", hash::GetTypeStr(type), hash_out.c_str());
-            App::Push<OptionBox>(buf, "OK"_i18n);
+            std::string str;
+            for (size_t i = 0; i < hash_types.size() && i < hash_out.size(); i++) {
+                if (!str.empty()) {
+                    str += '\n';
+                }
+
+                // only show the type on its own line if there's a single hash.
+                if (hash_types.size() == 1) {
+                    str += std::string{hash::GetTypeStr(hash_types[i])} + "\n" + hash_out[i];
+                } else {
+                    str += std::string{hash::GetTypeStr(hash_types[i])} + ": " + hash_out[i];
+                }
+            }
+
+            App::Push<OptionBox>(str, "OK"_i18n);
+        }
+    });
+}
+
+void FsView::DisplayVerify(const fs::FsPath& manifest_path) {
+    // hack because we cannot share output between threaded calls...
+    static verify::Report report;
+    report = {};
+
+    App::PopToMenu();
+    App::Push<ProgressBox>(0, "Verifying"_i18n, manifest_path, [this, manifest_path](auto pbox) -> Result {
+        std::vector<verify::Entry> entries;
+        R_TRY(verify::LoadManifest(m_fs.get(), manifest_path, entries));
+        return verify::Verify(pbox, m_fs.get(), manifest_path, entries, report);
+    }, [manifest_path](Result rc){
+        App::PushErrorBox(rc, "Failed to verify files..."_i18n);
+
+        if (R_SUCCEEDED(rc)) {
+            const auto seconds = report.elapsed_ns / 1e+9;
+            const auto speed = seconds ? report.bytes / seconds : 0.0;
+
+            char buf[0x200];
+            std::snprintf(buf, sizeof(buf), "OK: %u Mismatch: %u Missing: %u Error: %u\n%s/s"_i18n.c_str(), report.ok, report.mismatch, report.missing, report.error, utils::formatSizeStorage(speed).c_str());
+
+            std::string str{buf};
+            // only show the first few, the rest are in the results file.
+            for (size_t i = 0; i < report.failures.size() && i < 4; i++) {
+                str += "\n" + std::string{report.failures[i].path.s};
+            }
+            str += "\n" + verify::GetResultsPath(manifest_path).toString();
+
+            App::Push<OptionBox>(str, "OK"_i18n);
         }
     });
 }
@@ -1680,6 +2620,10 @@ void FsView::DisplayOptions() {
         });
     });
 
+    options->Add<SidebarEntryCallback>("Search"_i18n, [this](){
+        DisplaySearch();
+    });
+
     if (m_entries_current.size()) {
         if (!m_fs_entry.IsReadOnly()) {
             options->Add<SidebarEntryCallback>("Cut"_i18n, [this](){
@@ -1705,6 +2649,35 @@ void FsView::DisplayOptions() {
         });
     }
 
+    if (!m_menu->m_selected.Empty() && !m_fs_entry.IsReadOnly() && (m_menu->m_selected.Type() == SelectedType::Cut || m_menu->m_selected.Type() == SelectedType::Copy)) {
+        options->Add<SidebarEntryCallback>("Paste in background"_i18n, [this](){
+            App::PopToMenu();
+            OnPasteCallback(true);
+        });
+
+        // a rename doesn't copy anything, so there's nothing to verify.
+        if (!(m_menu->m_selected.SameFs(this) && m_menu->m_selected.Type() == SelectedType::Cut)) {
+            options->Add<SidebarEntryCallback>("Paste and verify"_i18n, [this](){
+                App::PopToMenu();
+                OnPasteCallback(false, true);
+            });
+        }
+    }
+
+    // sync only makes sense for copies into another folder.
+    if (!m_menu->m_selected.Empty() && !m_fs_entry.IsReadOnly() && m_menu->m_selected.Type() == SelectedType::Copy && !(m_menu->m_selected.SameFs(this) && m_menu->m_selected.m_path == m_path)) {
+        options->Add<SidebarEntryCallback>("Sync"_i18n, [this](){
+            App::PopToMenu();
+            OnSyncCallback();
+        });
+    }
+
+    if (jobs::GetCount()) {
+        options->Add<SidebarEntryCallback>("Background jobs"_i18n, [](){
+            App::Push<JobsBox>();
+        });
+    }
+
     // can't rename more than 1 file
     if (m_entries_current.size() && !m_selected_count && !m_fs_entry.IsReadOnly()) {
         options->Add<SidebarEntryCallback>("Rename"_i18n, [this](){
@@ -1750,6 +2723,39 @@ void FsView::DisplayOptions() {
             );
             log_write("pushed delete\n");
         });
+
+        options->Add<SidebarEntryCallback>("Delete in background"_i18n, [this](){
+            m_menu->AddSelectedEntries(SelectedType::Delete);
+
+            App::Push<OptionBox>(
+                "Delete Selected files in the background?"_i18n, "No"_i18n, "Yes"_i18n, 0, [this](auto op_index){
+                    if (op_index && *op_index) {
+                        App::PopToMenu();
+                        OnDeleteBackgroundCallback();
+                    }
+                }
+            );
+        });
+    }
+
+    if (m_entries_current.size() && !m_fs_entry.IsNoStatDir()) {
+        const auto entries = GetSelectedEntries();
+        const auto has_dir = std::ranges::any_of(entries, [](const auto& e){
+            return e.IsDir();
+        });
+
+        if (has_dir) {
+            options->Add<SidebarEntryCallback>("Calculate folder size"_i18n, [this](){
+                for (const auto& e : GetSelectedEntries()) {
+                    if (e.IsDir()) {
+                        CalculateDirSize(GetNewPath(m_path, e.name));
+                    }
+                }
+
+                App::PopToMenu();
+                App::Notify("Calculating folder size..."_i18n);
+            });
+        }
     }
 
     // returns true if all entries match the ext array.
@@ -1782,6 +2788,13 @@ void FsView::DisplayOptions() {
                 entry->Depends(App::GetInstallEnable, i18n::get(App::INSTALL_DEPENDS_STR), App::ShowEnableInstallPrompt);
             }
         }
+
+        if (IsSd() && m_entries_current.size() && m_selected_count > 1 && check_all_ext(NRO_EXTENSIONS)) {
+            auto entry = options->Add<SidebarEntryCallback>("Install Forwarders"_i18n, [this](){
+                InstallForwarders();
+            });
+            entry->Depends(App::GetInstallEnable, i18n::get(App::INSTALL_DEPENDS_STR), App::ShowEnableInstallPrompt);
+        }
     }
 
     if (m_entries_current.size()) {
@@ -1836,10 +2849,88 @@ void FsView::DisplayOptions() {
     });
 }
 
+void FsView::DisplaySearch() {
+    std::string out;
+    const auto header = "Search for file"_i18n;
+    if (R_FAILED(swkbd::ShowText(out, header.c_str(), "Enter part of the file name"_i18n.c_str())) || out.empty()) {
+        return;
+    }
+
+    std::vector<search::Match> matches;
+    search::Find(out, 200, matches);
+
+    if (matches.empty()) {
+        const auto stats = search::GetStats();
+        if (stats.indexing) {
+            App::Notify("No results, the search index is still being built"_i18n);
+        } else {
+            App::Notify("No results found"_i18n);
+        }
+        return;
+    }
+
+    PopupList::Items items;
+    for (const auto& e : matches) {
+        items.emplace_back(e.path);
+    }
+
+    App::Push<PopupList>(
+        "Results for: "_i18n + out, items, [this, matches](auto op_index){
+            if (op_index) {
+                OpenPath(matches[*op_index].path);
+            }
+        }
+    );
+}
+
+// switches to the fs that the path is on and highlights the file.
+void FsView::OpenPath(const fs::FsPath& path) {
+    std::optional<FsEntry> entry;
+    if (path.starts_with("/")) {
+        entry = FS_ENTRY_DEFAULT;
+    } else {
+        for (const auto& e : location::GetStdio(false)) {
+            if (path.starts_with(e.mount)) {
+                entry = FsEntry(e.name, e.mount, FsType::Stdio, e.flags);
+                break;
+            }
+        }
+    }
+
+    if (!entry) {
+        log_write("[SEARCH] no mount found for: %s\n", path.s);
+        return;
+    }
+
+    const auto name = std::strrchr(path, '/');
+    if (!name) {
+        return;
+    }
+
+    fs::FsPath parent{std::string_view{path.s, name}};
+    if (parent.empty() || parent.ends_with(":")) {
+        parent += "/";
+    }
+
+    App::PopToMenu();
+    if (!m_fs_entry.IsSame(*entry)) {
+        SetFs(m_menu->CreateFs(*entry), parent, *entry);
+    } else {
+        Scan(parent);
+    }
+
+    SetIndexFromLastFileAfterScan(LastFile{name + 1});
+}
+
 void FsView::DisplayAdvancedOptions() {
     auto options = std::make_unique<Sidebar>("Advanced Options"_i18n, Sidebar::Side::RIGHT);
     ON_SCOPE_EXIT(App::Push(std::move(options)));
 
+    options->Add<SidebarEntryCallback>("Rebuild search index"_i18n, [](){
+        search::Rescan();
+        App::Notify("Rebuilding search index"_i18n);
+    });
+
     if (!m_fs_entry.IsReadOnly()) {
         options->Add<SidebarEntryCallback>("Create File"_i18n, [this](){
             std::string out;
@@ -1917,12 +3008,40 @@ void FsView::DisplayAdvancedOptions() {
             options->Add<SidebarEntryCallback>("SHA256"_i18n, [this](){
                 DisplayHash(hash::Type::Sha256);
             });
+            options->Add<SidebarEntryCallback>("All"_i18n, [this](){
+                // all of these are calculated from a single read of the file.
+                static constexpr hash::Type types[]{
+                    hash::Type::Crc32, hash::Type::Md5, hash::Type::Sha1, hash::Type::Sha256,
+                };
+                DisplayHash(types);
+            });
             options->Add<SidebarEntryCallback>("/dev/null (Speed Test)"_i18n, [this](){
                 DisplayHash(hash::Type::Null);
             });
         });
     }
 
+    if (m_entries_current.size() && !m_selected_count && GetEntry().IsFile() && verify::IsManifest(GetEntryName())) {
+        options->Add<SidebarEntryCallback>("Verify files in manifest"_i18n, [this](){
+            const auto manifest_path = GetNewPathCurrent();
+            if (!fs::FsNativeSd().FileExists(verify::GetResultsPath(manifest_path))) {
+                DisplayVerify(manifest_path);
+                return;
+            }
+
+            App::Push<OptionBox>(
+                "Resume the previous verify?"_i18n, "Restart"_i18n, "Resume"_i18n, 1, [this, manifest_path](auto op_index){
+                    if (op_index) {
+                        if (!*op_index) {
+                            fs::FsNativeSd().DeleteFile(verify::GetResultsPath(manifest_path));
+                        }
+                        DisplayVerify(manifest_path);
+                    }
+                }
+            );
+        });
+    }
+
     options->Add<SidebarEntryBool>("Ignore read only"_i18n, m_menu->m_ignore_read_only.Get(), [this](bool& v_out){
         m_menu->m_ignore_read_only.Set(v_out);
         m_fs->SetIgnoreReadOnly(v_out);
@@ -1955,8 +3074,70 @@ Base::Base(const std::shared_ptr<fs::Fs>& fs, const FsEntry& fs_entry, const fs:
     Init(fs, fs_entry, path, is_custom);
 }
 
+auto Base::FindListing(const FsEntry& fs_entry, fs::Fs* fs, const fs::FsPath& path) -> const FileList* {
+    const auto it = std::ranges::find_if(m_listing_cache, [&fs_entry, &path](const auto& e) {
+        return e.fs_entry.IsSame(fs_entry) && e.path == path;
+    });
+
+    if (it == m_listing_cache.end()) {
+        return nullptr;
+    }
+
+    bool valid;
+    FsTimeStampRaw ts{};
+    if (it->time_stamp.is_valid && R_SUCCEEDED(fs->GetFileTimeStampRaw(path, &ts)) && ts.is_valid) {
+        valid = ts.modified == it->time_stamp.modified;
+    } else {
+        valid = armTicksToNs(armGetSystemTick() - it->tick) < LISTING_CACHE_TTL_NS;
+    }
+
+    if (!valid) {
+        log_write("[FS] cached listing is stale: %s\n", path.s);
+        m_listing_cache.erase(it);
+        return nullptr;
+    }
+
+    std::rotate(m_listing_cache.begin(), it, it + 1);
+    return &m_listing_cache.front().entries;
+}
+
+void Base::StoreListing(const FsEntry& fs_entry, fs::Fs* fs, const fs::FsPath& path, const FileList& entries) {
+    // native fs are fast enough to not need caching.
+    if (fs->IsNative() || entries.IsEmpty()) {
+        return;
+    }
+
+    std::erase_if(m_listing_cache, [&fs_entry, &path](const auto& e) {
+        return e.fs_entry.IsSame(fs_entry) && e.path == path;
+    });
+
+    ListingCacheEntry entry{fs_entry, path};
+    if (R_FAILED(fs->GetFileTimeStampRaw(path, &entry.time_stamp)) || !entry.time_stamp.modified) {
+        entry.time_stamp.is_valid = false;
+    }
+    entry.tick = armGetSystemTick();
+    entry.entries = entries;
+    entry.entries.ClearSelection();
+
+    m_listing_cache.emplace(m_listing_cache.begin(), std::move(entry));
+
+    u64 total{};
+    for (u32 i = 0; i < m_listing_cache.size(); i++) {
+        total += m_listing_cache[i].entries.Size();
+        if (i >= LISTING_CACHE_MAX || (i && total > LISTING_CACHE_MAX_ENTRIES)) {
+            m_listing_cache.resize(i);
+            break;
+        }
+    }
+}
+
+void Base::InvalidateListingCache() {
+    m_listing_cache.clear();
+}
+
 void Base::Update(Controller* controller, TouchInfo* touch) {
     if (g_change_signalled.exchange(false)) {
+        InvalidateListingCache();
 
         if (IsSplitScreen()) {
             view_left->SortAndFindLastFile(true);
@@ -2033,99 +3214,76 @@ auto Base::FindFileAssocFor() -> std::vector<FileAssocEntry> {
         return {};
     }
 
-    std::vector<FileAssocEntry> out_entries;
-    if (!db_indexs.empty()) {
-        // if database isn't empty, then we are in a valid folder
-        // search for an entry that matches the db and ext
-        for (const auto& assoc : m_assoc_entries) {
-            for (const auto& assoc_db : assoc.database) {
-                // if (assoc_db == PATHS[db_idx].folder || assoc_db == PATHS[db_idx].database) {
-                for (auto db_idx : db_indexs) {
-                    if (PATHS[db_idx].IsDatabase(assoc_db)) {
-                        if (assoc.IsExtension(extension, internal_extension)) {
-                            out_entries.emplace_back(assoc);
-                            goto jump;
-                        }
-                    }
-                }
-            }
-            jump:
-        }
-    } else {
-        // otherwise, if not in a valid folder, find an entry that doesn't
-        // use a database, ie, not a emulator.
-        // this is because media players and hbmenu can launch from anywhere
-        // and the extension is enough info to know what type of file it is.
-        // whereas with roms, a .iso can be used for multiple systems, so it needs
-        // to be in the correct folder, ie psx, to know what system that .iso is for.
-        for (const auto& assoc : m_assoc_entries) {
-            if (assoc.database.empty()) {
-                if (assoc.IsExtension(extension, internal_extension)) {
-                    log_write("found ext: %s\n", assoc.path.s);
-                    out_entries.emplace_back(assoc);
-                }
-            }
-        }
+    u64 db_mask{};
+    for (auto db_idx : db_indexs) {
+        db_mask |= 1ULL << db_idx;
     }
 
-    return out_entries;
-}
+    // entries that support either extension, kept in load order.
+    std::vector<u32> indexs;
+    for (const auto& ext : { std::string_view{extension}, std::string_view{internal_extension} }) {
+        if (ext.empty()) {
+            continue;
+        }
 
-void Base::LoadAssocEntriesPath(const fs::FsPath& path) {
-    auto dir = opendir(path);
-    if (!dir) {
-        return;
+        if (const auto it = m_assoc_table.find(HashAssocExtension(ext)); it != m_assoc_table.end()) {
+            indexs.insert(indexs.end(), it->second.begin(), it->second.end());
+        }
     }
-    ON_SCOPE_EXIT(closedir(dir));
 
-    while (auto d = readdir(dir)) {
-        if (d->d_name[0] == '.') {
-            continue;
-        }
+    std::ranges::sort(indexs);
+    const auto [first, last] = std::ranges::unique(indexs);
+    indexs.erase(first, last);
 
-        if (d->d_type != DT_REG) {
+    std::vector<FileAssocEntry> out_entries;
+    for (const auto i : indexs) {
+        const auto& assoc = m_assoc_entries[i];
+
+        // the table is hashed, so check that the extension really matches.
+        if (!assoc.IsExtension(extension, internal_extension)) {
             continue;
         }
 
-        const auto ext = std::strrchr(d->d_name, '.');
-        if (!ext || strcasecmp(ext, ".ini")) {
-            continue;
+        if (!db_indexs.empty()) {
+            // if database isn't empty, then we are in a valid folder
+            // search for an entry that matches the db and ext
+            if (assoc.db_mask & db_mask) {
+                out_entries.emplace_back(assoc);
+            }
+        } else if (assoc.database.empty()) {
+            // otherwise, if not in a valid folder, find an entry that doesn't
+            // use a database, ie, not a emulator.
+            // this is because media players and hbmenu can launch from anywhere
+            // and the extension is enough info to know what type of file it is.
+            // whereas with roms, a .iso can be used for multiple systems, so it needs
+            // to be in the correct folder, ie psx, to know what system that .iso is for.
+            log_write("found ext: %s\n", assoc.path.s);
+            out_entries.emplace_back(assoc);
         }
+    }
 
-        const auto full_path = GetNewPath(path, d->d_name);
-        FileAssocEntry assoc{};
+    return out_entries;
+}
 
-        ini_browse([](const mTCHAR *Section, const mTCHAR *Key, const mTCHAR *Value, void *UserData) {
-            auto assoc = static_cast<FileAssocEntry*>(UserData);
-            if (!std::strcmp(Key, "path")) {
-                assoc->path = Value;
-            } else if (!std::strcmp(Key, "supported_extensions")) {
-                for (const auto& p : std::views::split(std::string_view{Value}, '|')) {
-                    if (p.empty()) {
-                        continue;
-                    }
-                    assoc->ext.emplace_back(p.data(), p.size());
-                }
-            } else if (!std::strcmp(Key, "database")) {
-                for (const auto& p : std::views::split(std::string_view{Value}, '|')) {
-                    if (p.empty()) {
-                        continue;
-                    }
-                    assoc->database.emplace_back(p.data(), p.size());
-                }
-            } else if (!std::strcmp(Key, "use_base_name")) {
-                if (!std::strcmp(Value, "true") || !std::strcmp(Value, "1")) {
-                    assoc->use_base_name = true;
-                }
-            }
-            return 1;
-        }, &assoc, full_path);
+void Base::LoadAssocEntriesPath(const fs::FsPath& path) {
+    const auto stamp = GetAssocStamp(path);
+    auto cache = std::ranges::find_if(g_assoc_cache, [&path](const auto& e){
+        return e.path == path;
+    });
 
-        if (assoc.ext.empty()) {
-            continue;
+    // only parse the ini files again if any of them have changed.
+    if (cache == g_assoc_cache.end() || cache->stamp != stamp) {
+        if (cache == g_assoc_cache.end()) {
+            cache = g_assoc_cache.emplace(g_assoc_cache.end(), path);
         }
 
-        assoc.name.assign(d->d_name, ext - d->d_name);
+        cache->stamp = stamp;
+        cache->entries.clear();
+        ParseAssocEntriesPath(path, cache->entries);
+        log_write("[ASSOC] parsed %zu entries from %s\n", cache->entries.size(), path.s);
+    }
+
+    for (auto assoc : cache->entries) {
 
         // if path isn't empty, check if the file exists
         bool file_exists{};
@@ -2182,7 +3340,35 @@ void Base::LoadAssocEntries() {
         }
         // then load custom entries
         LoadAssocEntriesPath("/config/sphaira/assoc/");
+        BuildAssocTable();
+    }
+}
+
+void Base::BuildAssocTable() {
+    static_assert(std::size(PATHS) <= 64, "db_mask needs to be larger");
+
+    m_assoc_table.clear();
+    for (u32 i = 0; i < m_assoc_entries.size(); i++) {
+        auto& assoc = m_assoc_entries[i];
+
+        assoc.db_mask = 0;
+        for (const auto& assoc_db : assoc.database) {
+            for (u32 db_idx = 0; db_idx < std::size(PATHS); db_idx++) {
+                if (PATHS[db_idx].IsDatabase(assoc_db)) {
+                    assoc.db_mask |= 1ULL << db_idx;
+                }
+            }
+        }
+
+        for (const auto& ext : assoc.ext) {
+            auto& list = m_assoc_table[HashAssocExtension(ext)];
+            if (list.empty() || list.back() != i) {
+                list.emplace_back(i);
+            }
+        }
     }
+
+    log_write("[ASSOC] built table with %zu entries and %zu extensions\n", m_assoc_entries.size(), m_assoc_table.size());
 }
 
 void Base::UpdateSubheading() {
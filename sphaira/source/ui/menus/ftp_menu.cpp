@@ -6,6 +6,8 @@
 #include "i18n.hpp"
 #include "ftpsrv_helper.hpp"
 
+#include <algorithm>
+
 namespace sphaira::ui::menu::ftp {
 
 Menu::Menu(u32 flags) : stream::Menu{"FTP Install"_i18n, flags} {
@@ -96,6 +98,13 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         }
     }
 
+    for (const auto& e : ftpsrv::GetSessionStats()) {
+        const auto speed = e.bytes / 1024.0 / 1024.0 / std::max(e.elapsed_ns / 1e+9, 1e-3);
+        const auto name = e.path.substr(e.path.find_last_of('/') + 1);
+        const auto key = e.upload ? "Upload:"_i18n : "Download:"_i18n;
+        draw(key, " %s %.2f MiB/s%s", name.c_str(), speed, e.active ? "" : " (done)");
+    }
+
     #undef draw
 }
 
@@ -5,6 +5,7 @@
 #include "defines.hpp"
 #include "i18n.hpp"
 #include "image.hpp"
+#include "image_decode.hpp"
 #include "swkbd.hpp"
 
 #include "utils/utils.hpp"
@@ -38,6 +39,9 @@ namespace {
 
 std::atomic_bool g_change_signalled{};
 
+// records listed per frame once the first page is shown.
+constexpr s32 RECORD_PAGE_COUNT = 1000;
+
 struct NspSource final : dump::BaseSource {
     NspSource(const std::vector<NspEntry>& entries) : m_entries{entries} {
         m_is_file_based_emummc = App::IsFileBaseEmummc();
@@ -195,8 +199,9 @@ void LoadControlEntry(Entry& e, bool force_image_load = false) {
 }
 
 void FreeEntry(NVGcontext* vg, Entry& e) {
-    nvgDeleteImage(vg, e.image);
+    gfx::deleteImage(vg, e.image);
     e.image = 0;
+    e.image_request.reset();
 }
 
 void LaunchEntry(const Entry& e) {
@@ -231,6 +236,139 @@ Result CreateSave(u64 app_id, AccountUid uid) {
     R_SUCCEED();
 }
 
+struct VerifyContent {
+    // points to global service, do not close manually!
+    NcmContentStorage* cs{};
+    NcmContentId content_id{};
+    s64 size{};
+    std::string name{};
+};
+
+// hashes content on several threads, each thread takes the next content in
+// the list so that large and small files are spread across the workers.
+// reads still go through the same ncm session, but the hash of one content
+// overlaps the read of another, so it runs at storage speed.
+struct VerifyPool {
+    static constexpr u32 WORKER_COUNT = 3;
+    static constexpr s64 CHUNK_SIZE = 1024 * 1024;
+
+    VerifyPool(ProgressBox* pbox, const std::vector<VerifyContent>& contents) : m_pbox{pbox}, m_contents{contents} {
+        mutexInit(&m_mutex);
+
+        for (const auto& e : m_contents) {
+            m_total += e.size;
+        }
+    }
+
+    Result Run() {
+        Thread threads[WORKER_COUNT]{};
+        u32 thread_count{};
+
+        ON_SCOPE_EXIT(
+            for (u32 i = 0; i < thread_count; i++) {
+                threadWaitForExit(&threads[i]);
+                threadClose(&threads[i]);
+            }
+        );
+
+        for (u32 i = 0; i < WORKER_COUNT; i++) {
+            if (R_FAILED(utils::CreateThread(&threads[i], ThreadFunc, this))) {
+                break;
+            }
+
+            if (R_FAILED(threadStart(&threads[i]))) {
+                threadClose(&threads[i]);
+                break;
+            }
+
+            thread_count++;
+        }
+
+        // fallback to hashing on this thread.
+        if (!thread_count) {
+            ThreadFunc(this);
+        }
+
+        return m_pbox->ShouldExitResult();
+    }
+
+    auto GetBadCount() const -> u32 {
+        return m_bad_count;
+    }
+
+private:
+    static void ThreadFunc(void* arg) {
+        auto pool = static_cast<VerifyPool*>(arg);
+        std::vector<u8> buf(CHUNK_SIZE);
+
+        while (!pool->m_pbox->ShouldExit()) {
+            const VerifyContent* e{};
+            {
+                SCOPED_MUTEX(&pool->m_mutex);
+                if (pool->m_next >= std::size(pool->m_contents)) {
+                    break;
+                }
+                e = &pool->m_contents[pool->m_next++];
+            }
+
+            pool->Verify(*e, buf);
+        }
+    }
+
+    void Verify(const VerifyContent& e, std::vector<u8>& buf) {
+        Sha256Context sha256;
+        sha256ContextCreate(&sha256);
+
+        Result rc{};
+        s64 off{};
+        while (off < e.size) {
+            if (m_pbox->ShouldExit()) {
+                return;
+            }
+
+            const auto size = std::min<s64>(e.size - off, buf.size());
+            if (R_FAILED(rc = ncmContentStorageReadContentIdFile(e.cs, buf.data(), size, &e.content_id, off))) {
+                break;
+            }
+
+            sha256ContextUpdate(&sha256, buf.data(), size);
+            off += size;
+
+            SCOPED_MUTEX(&m_mutex);
+            m_offset += size;
+            m_pbox->UpdateTransfer(m_offset, m_total);
+        }
+
+        u8 hash[SHA256_HASH_SIZE];
+        sha256ContextGetHash(&sha256, hash);
+
+        // same check as yati, the content id is the first half of the sha256.
+        if (R_SUCCEEDED(rc) && !std::memcmp(&e.content_id, hash, sizeof(e.content_id))) {
+            return;
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        // account for what wasn't read so the progress still ends at 100%.
+        m_offset += e.size - off;
+        m_bad_count++;
+
+        if (R_FAILED(rc)) {
+            log_write("[VERIFY] failed to read: %s %s 0x%X\n", e.name.c_str(), utils::hexIdToStr(e.content_id).str, rc);
+        } else {
+            log_write("[VERIFY] hash mismatch: %s %s\n", e.name.c_str(), utils::hexIdToStr(e.content_id).str);
+        }
+    }
+
+private:
+    ProgressBox* const m_pbox;
+    const std::vector<VerifyContent>& m_contents;
+    Mutex m_mutex{};
+    u32 m_next{};
+    s64 m_offset{};
+    s64 m_total{};
+    u32 m_bad_count{};
+};
+
 } // namespace
 
 Result NspEntry::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
@@ -443,6 +581,10 @@ Menu::Menu(u32 flags) : grid::Menu{"Games"_i18n, flags} {
                     );
                 });
 
+                options->Add<SidebarEntryCallback>("Verify installed content"_i18n, [this](){
+                    VerifyGames();
+                }, true, "Hashes all installed content of the selected games and compares it against its content id."_i18n);
+
                 options->Add<SidebarEntryCallback>("Delete title cache"_i18n, [this](){
                     App::Push<OptionBox>(
                         "Are you sure you want to delete the title cache?"_i18n,
@@ -494,6 +636,15 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
         SortAndFindLastFile(true);
     }
 
+    if (m_scanning) {
+        m_scanning = ScanNextPage(RECORD_PAGE_COUNT);
+        // updates the entry count.
+        if (!m_entries.empty()) {
+            SetIndex(m_index);
+        }
+        App::Invalidate();
+    }
+
     MenuBase::Update(controller, touch);
     m_list->OnUpdate(controller, touch, m_index, m_entries.size(), [this](bool touch, auto i) {
         if (touch && m_index == i) {
@@ -513,31 +664,39 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
-
-    m_list->Draw(vg, theme, m_entries.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_list->Draw(vg, theme, m_entries.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         auto& e = m_entries[pos];
 
+        // entries closest to the selected entry are loaded first.
         if (e.status == title::NacpLoadStatus::None) {
-            title::PushAsync(e.app_id);
+            title::PushAsync(e.app_id, std::abs(pos - m_index));
             e.status = title::NacpLoadStatus::Progress;
         } else if (e.status == title::NacpLoadStatus::Progress) {
             LoadResultIntoEntry(e, title::GetAsync(e.app_id));
-        }
-
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.app_id))) {
-                image_load_count++;
+            if (e.status == title::NacpLoadStatus::Progress) {
+                title::PushAsync(e.app_id, std::abs(pos - m_index));
             }
         }
 
         char title_id[33];
         std::snprintf(title_id, sizeof(title_id), "%016lX", e.app_id);
 
+        // lazy load image, icons closest to the selected entry are decoded first.
+        // the thumbnail is keyed on the app id and when its record last changed,
+        // so the cached thumbnail is used without decoding the icon.
+        const image::Thumb thumb{image::MakeThumbId(title_id, e.last_updated), GetThumbSize(m_layout.Get())};
+        image::LoadAsync(e.image_request, e.image, std::abs(pos - m_index), ImageFlag_JPEG, thumb, [&e]() -> image::Loader {
+            const auto result = title::GetAsync(e.app_id);
+            if (!result || result->icon.empty()) {
+                return {};
+            }
+
+            return [icon = result->icon]() mutable {
+                return std::move(icon);
+            };
+        });
+
         const auto selected = pos == m_index;
         DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), title_id);
 
@@ -568,49 +727,72 @@ void Menu::SetIndex(s64 index) {
 }
 
 void Menu::ScanHomebrew() {
-    constexpr auto ENTRY_CHUNK_COUNT = 1000;
-    const auto hide_forwarders = m_hide_forwarders.Get();
+    // enough to fill the first screen of the largest layout.
+    constexpr auto FIRST_PAGE_COUNT = 64;
     TimeStamp ts;
 
-    App::SetBoostMode(true);
-    ON_SCOPE_EXIT(App::SetBoostMode(false));
-
     FreeEntries();
-    m_entries.reserve(ENTRY_CHUNK_COUNT);
     g_change_signalled = false;
+    m_record_offset = 0;
+    m_is_reversed = false;
+    m_dirty = false;
 
-    std::vector<NsApplicationRecord> record_list(ENTRY_CHUNK_COUNT);
-    s32 offset{};
-    while (true) {
-        s32 record_count{};
-        if (R_FAILED(nsListApplicationRecord(record_list.data(), record_list.size(), offset, &record_count))) {
-            log_write("failed to list application records at offset: %d\n", offset);
-        }
+    // the rest of the records are listed in Update().
+    m_scanning = ScanNextPage(FIRST_PAGE_COUNT);
+    log_write("games first page: %zu time_taken: %.2f seconds %zu ms %zu ns\n", m_entries.size(), ts.GetSecondsD(), ts.GetMs(), ts.GetNs());
+    this->Sort();
+    SetIndex(0);
+    ClearSelection();
+}
 
-        // finished parsing all entries.
-        if (!record_count) {
-            break;
-        }
+bool Menu::ScanNextPage(s32 count) {
+    const auto hide_forwarders = m_hide_forwarders.Get();
 
-        for (s32 i = 0; i < record_count; i++) {
-            const auto& e = record_list[i];
+    std::vector<NsApplicationRecord> record_list(count);
+    s32 record_count{};
+    if (R_FAILED(nsListApplicationRecord(record_list.data(), record_list.size(), m_record_offset, &record_count))) {
+        log_write("failed to list application records at offset: %d\n", m_record_offset);
+    }
 
-            if (hide_forwarders && (e.application_id & 0x0500000000000000) == 0x0500000000000000) {
-                continue;
-            }
+    // finished parsing all entries.
+    if (!record_count) {
+        log_write("games found: %zu\n", m_entries.size());
+        return false;
+    }
+
+    title::UpdateRecords(std::span(record_list.data(), record_count));
 
-            m_entries.emplace_back(e.application_id, e.last_event);
+    std::vector<Entry> entries;
+    entries.reserve(record_count);
+    for (s32 i = 0; i < record_count; i++) {
+        const auto& e = record_list[i];
+
+        if (hide_forwarders && (e.application_id & 0x0500000000000000) == 0x0500000000000000) {
+            continue;
         }
 
-        offset += record_count;
+        entries.emplace_back(e.application_id, e.last_event, e.last_updated);
     }
 
-    m_is_reversed = false;
-    m_dirty = false;
-    log_write("games found: %zu time_taken: %.2f seconds %zu ms %zu ns\n", m_entries.size(), ts.GetSecondsD(), ts.GetMs(), ts.GetNs());
-    this->Sort();
-    SetIndex(0);
-    ClearSelection();
+    m_record_offset += record_count;
+
+    // records are listed newest first, see Sort().
+    m_entries.insert(m_entries.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+
+    return record_count == count;
+}
+
+void Menu::FinishScan() {
+    if (!m_scanning) {
+        return;
+    }
+
+    App::SetBoostMode(true);
+    ON_SCOPE_EXIT(App::SetBoostMode(false));
+
+    while (m_scanning) {
+        m_scanning = ScanNextPage(RECORD_PAGE_COUNT);
+    }
 }
 
 void Menu::Sort() {
@@ -618,6 +800,10 @@ void Menu::Sort() {
     const auto order = m_order.Get();
 
     if (order == OrderType_Ascending) {
+        // the oldest records are listed last, so they're all needed before
+        // the list can be reversed.
+        FinishScan();
+
         if (!m_is_reversed) {
             std::ranges::reverse(m_entries);
             m_is_reversed = true;
@@ -631,9 +817,11 @@ void Menu::Sort() {
 }
 
 void Menu::SortAndFindLastFile(bool scan) {
-    const auto app_id = m_entries[m_index].app_id;
+    const auto app_id = m_entries.empty() ? 0 : m_entries[m_index].app_id;
     if (scan) {
         ScanHomebrew();
+        // the entry may be in any page, so list the rest now.
+        FinishScan();
     } else {
         Sort();
     }
@@ -673,12 +861,21 @@ void Menu::FreeEntries() {
 void Menu::OnLayoutChange() {
     m_index = 0;
     grid::Menu::OnLayoutChange(m_list, m_layout.Get());
+
+    // reload the icons at the thumbnail size of the new layout.
+    auto vg = App::GetVg();
+    for (auto& e : m_entries) {
+        FreeEntry(vg, e);
+    }
 }
 
 void Menu::DeleteGames() {
     App::Push<ProgressBox>(0, "Deleting"_i18n, "", [this](auto pbox) -> Result {
         auto targets = GetSelectedEntries();
 
+        // deleting a title also removes its tickets.
+        ON_SCOPE_EXIT(es::InvalidateTicketCache());
+
         for (s64 i = 0; i < std::size(targets); i++) {
             auto& e = targets[i];
 
@@ -701,6 +898,68 @@ void Menu::DeleteGames() {
     });
 }
 
+void Menu::VerifyGames() {
+    auto bad_count = std::make_shared<u32>();
+
+    App::Push<ProgressBox>(0, "Verifying"_i18n, "", [this, bad_count](auto pbox) -> Result {
+        auto targets = GetSelectedEntries();
+
+        std::vector<VerifyContent> contents;
+        for (s64 i = 0; i < std::size(targets); i++) {
+            auto& e = targets[i];
+
+            LoadControlEntry(e);
+            pbox->SetTitle(e.GetName());
+            pbox->UpdateTransfer(i + 1, std::size(targets));
+            R_TRY(pbox->ShouldExitResult());
+
+            title::MetaEntries meta_entries;
+            R_TRY(GetMetaEntries(e, meta_entries));
+
+            for (const auto& status : meta_entries) {
+                NcmMetaData meta;
+                R_TRY(GetNcmMetaFromMetaStatus(status, meta));
+
+                std::vector<NcmContentInfo> infos;
+                R_TRY(ncm::GetContentInfos(meta.db, &meta.key, infos));
+
+                for (const auto& info : infos) {
+                    bool has;
+                    if (R_FAILED(ncmContentStorageHas(meta.cs, &has, &info.content_id)) || !has) {
+                        log_write("[VERIFY] missing: %s %s\n", e.GetName(), utils::hexIdToStr(info.content_id).str);
+                        (*bad_count)++;
+                        continue;
+                    }
+
+                    contents.emplace_back(meta.cs, info.content_id, ncmContentInfoSizeToU64(&info), e.GetName());
+                }
+            }
+        }
+
+        pbox->SetTitle("Verifying"_i18n);
+        pbox->NewTransfer("Hashing installed content"_i18n);
+
+        VerifyPool pool{pbox, contents};
+        R_TRY(pool.Run());
+
+        *bad_count += pool.GetBadCount();
+        R_UNLESS(!*bad_count, Result_GameContentHashMismatch);
+        R_SUCCEED();
+    }, [this, bad_count](Result rc){
+        ClearSelection();
+
+        if (*bad_count) {
+            App::PushErrorBox(rc, std::to_string(*bad_count) + " " + "corrupted or missing content found, see log for details"_i18n);
+        } else {
+            App::PushErrorBox(rc, "Verify failed!"_i18n);
+        }
+
+        if (R_SUCCEEDED(rc)) {
+            App::Notify("All installed content is valid!"_i18n);
+        }
+    });
+}
+
 void Menu::ExportOptions(bool to_nsz) {
     auto options = std::make_unique<Sidebar>("Select content to export"_i18n, Sidebar::Side::RIGHT);
     ON_SCOPE_EXIT(App::Push(std::move(options)));
@@ -9,10 +9,14 @@
 #include "yati/yati.hpp"
 #include "yati/nx/nca.hpp"
 #include "yati/container/xci.hpp"
+#include "yati/container/nsp.hpp"
+#include "yati/nx/ncm.hpp"
 
 #include "utils/utils.hpp"
 #include "utils/nsz_dumper.hpp"
 #include "utils/devoptab.hpp"
+#include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include "app.hpp"
 #include "defines.hpp"
@@ -23,9 +27,11 @@
 #include "image.hpp"
 #include "title_info.hpp"
 #include "threaded_file_transfer.hpp"
+#include "hasher.hpp"
 
 #include <cstring>
 #include <algorithm>
+#include <strings.h>
 
 // from Gamecard-Installer-NX
 extern "C" {
@@ -55,6 +61,21 @@ constexpr u32 XCI_MAGIC = std::byteswap(0x48454144);
 constexpr u32 REMOUNT_ATTEMPT_MAX = 8; // same as nxdumptool.
 constexpr const char* DUMP_GAMECARD_BASE_PATH = "/dumps/Gamecard";
 constexpr const char* DUMP_XCZ_BASE_PATH = "/dumps/XCZ";
+constexpr const char* DUMP_NSP_BASE_PATH = "/dumps/NSP";
+constexpr const char* DUMP_NSZ_BASE_PATH = "/dumps/NSZ";
+constexpr const char* INI_SECTION_GC = "gc";
+// read sizes tried by the benchmark, the fastest is saved for the card type.
+constexpr s64 BENCHMARK_READ_SIZES[]{
+    1024 * 256, 1024 * 512, 1024 * 1024 * 1, 1024 * 1024 * 2, 1024 * 1024 * 4, 1024 * 1024 * 8,
+};
+// amount read by each benchmark pass.
+constexpr s64 BENCHMARK_SIZE = 1024 * 1024 * 32;
+// optional No-Intro style dat, xci dumps are checked against it.
+constexpr fs::FsPath XCI_DATABASE_PATH{"/config/sphaira/xci.dat"};
+// calculated inline when dumping an xci.
+constexpr hash::Type XCI_HASH_TYPES[]{
+    hash::Type::Crc32, hash::Type::Sha1, hash::Type::Sha256,
+};
 
 enum DumpFileType {
     DumpFileType_XCI,
@@ -96,6 +117,26 @@ auto GetXciSizeFromRomSize(u8 rom_size) -> s64 {
     return 0;
 }
 
+// default read size for each card type, larger cards are faster to read in
+// larger requests, smaller cards gain nothing past a few MiB.
+auto GetReadSizeFromRomSize(u8 rom_size) -> s64 {
+    switch (rom_size) {
+        case 0xFA: return 1024 * 1024 * 2;
+        case 0xF8: return 1024 * 1024 * 2;
+        case 0xF0: return 1024 * 1024 * 4;
+        case 0xE0: return 1024 * 1024 * 4;
+        case 0xE1: return 1024 * 1024 * 8;
+        case 0xE2: return 1024 * 1024 * 8;
+    }
+    return 1024 * 1024 * 4;
+}
+
+auto GetReadSizeKey(u8 rom_size) -> std::string {
+    char key[32];
+    std::snprintf(key, sizeof(key), "read_size_%02X", rom_size);
+    return key;
+}
+
 struct DebugEventInfo {
     u32 event_type;
     u32 flags;
@@ -221,6 +262,277 @@ auto BuildGcPath(const char* name, const FsGameCardHandle* handle, FsGameCardPar
     return path;
 }
 
+// returns the value of key="value" within the tag, or empty if not found.
+auto GetXmlAttribute(std::string_view tag, std::string_view key) -> std::string_view {
+    for (size_t pos = 0; (pos = tag.find(key, pos)) != tag.npos; pos += key.size()) {
+        // has to be the whole attribute name, so that "sha1" doesn't match "sha1x".
+        if (!pos || tag[pos - 1] != ' ' || tag.substr(pos + key.size(), 2) != "=\"") {
+            continue;
+        }
+
+        const auto start = pos + key.size() + 2;
+        const auto end = tag.find('"', start);
+        if (end == tag.npos) {
+            break;
+        }
+
+        return tag.substr(start, end - start);
+    }
+
+    return {};
+}
+
+auto IsHashEqual(std::string_view a, std::string_view b) -> bool {
+    return !a.empty() && a.size() == b.size() && !strncasecmp(a.data(), b.data(), a.size());
+}
+
+// searches the dat for a rom with the same size and hash, the strongest hash
+// that the dat has for the rom is used.
+// hashes is in the same order as XCI_HASH_TYPES.
+auto FindInXciDatabase(std::string_view dat, s64 size, const std::vector<std::string>& hashes, std::string& out) -> bool {
+    const auto size_str = std::to_string(size);
+    std::string_view game_tag;
+
+    for (size_t pos = 0; (pos = dat.find('<', pos)) != dat.npos; pos++) {
+        const auto end = dat.find('>', pos);
+        if (end == dat.npos) {
+            break;
+        }
+
+        const auto tag = dat.substr(pos, end - pos);
+        if (tag.starts_with("<game ") || tag.starts_with("<machine ")) {
+            game_tag = tag;
+            continue;
+        }
+
+        if (!tag.starts_with("<rom ")) {
+            continue;
+        }
+
+        if (GetXmlAttribute(tag, "size") != size_str) {
+            continue;
+        }
+
+        bool matched;
+        if (const auto sha256 = GetXmlAttribute(tag, "sha256"); !sha256.empty()) {
+            matched = IsHashEqual(sha256, hashes[2]);
+        } else if (const auto sha1 = GetXmlAttribute(tag, "sha1"); !sha1.empty()) {
+            matched = IsHashEqual(sha1, hashes[1]);
+        } else {
+            matched = IsHashEqual(GetXmlAttribute(tag, "crc"), hashes[0]);
+        }
+
+        if (matched) {
+            auto name = GetXmlAttribute(game_tag, "name");
+            if (name.empty()) {
+                name = GetXmlAttribute(tag, "name");
+            }
+            out = name;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// reads the gamecard in large aligned blocks on its own thread.
+// while one block is being consumed, the next block is already being read, so
+// the gamecard is always busy and reads of any size / alignment become a memcpy.
+// this must be the only user of the gamecard storage while it's alive.
+struct GcReader final {
+    GcReader(Menu* menu, s64 size, s64 block_size) : m_menu{menu}, m_size{size}, m_block_size{block_size} {
+        mutexInit(&m_mutex);
+        condvarInit(&m_can_read);
+        condvarInit(&m_can_fill);
+
+        for (auto& e : m_blocks) {
+            e.data.resize(m_block_size);
+        }
+
+        if (R_FAILED(utils::CreateThread(&m_thread, ThreadFunc, this))) {
+            log_write("[GC] failed to create reader thread\n");
+            return;
+        }
+
+        if (R_FAILED(threadStart(&m_thread))) {
+            log_write("[GC] failed to start reader thread\n");
+            threadClose(&m_thread);
+            return;
+        }
+
+        m_running = true;
+    }
+
+    ~GcReader() {
+        if (m_running) {
+            {
+                SCOPED_MUTEX(&m_mutex);
+                m_quit = true;
+                condvarWakeAll(&m_can_fill);
+            }
+
+            threadWaitForExit(&m_thread);
+            threadClose(&m_thread);
+        }
+    }
+
+    Result Read(void* _buf, s64 off, s64 size) {
+        // fallback to reading on demand.
+        if (!m_running) {
+            return m_menu->GcStorageRead(_buf, off, size);
+        }
+
+        auto buf = static_cast<u8*>(_buf);
+        size = std::min(size, m_size - off);
+
+        while (size > 0) {
+            const auto block_off = off - off % m_block_size;
+            Block* block{};
+
+            {
+                SCOPED_MUTEX(&m_mutex);
+
+                while (!(block = Find(block_off))) {
+                    if (!Request(block_off, nullptr)) {
+                        condvarWait(&m_can_read, &m_mutex);
+                    }
+                }
+
+                // queue up the next block so that it's read while this one is used.
+                const auto next_off = block_off + m_block_size;
+                if (next_off < m_size && !Find(next_off)) {
+                    Request(next_off, block);
+                }
+
+                while (block->state == State::Pending) {
+                    condvarWait(&m_can_read, &m_mutex);
+                }
+
+                if (R_FAILED(block->rc)) {
+                    const auto rc = block->rc;
+                    block->state = State::Empty;
+                    return rc;
+                }
+            }
+
+            // only this thread replaces ready blocks, so it's safe to copy unlocked.
+            const auto block_pos = off - block->off;
+            const auto csize = std::min(size, block->size - block_pos);
+            std::memcpy(buf, block->data.data() + block_pos, csize);
+
+            off += csize;
+            size -= csize;
+            buf += csize;
+        }
+
+        R_SUCCEED();
+    }
+
+private:
+    enum class State {
+        Empty,
+        Pending,
+        Ready,
+    };
+
+    struct Block {
+        utils::pool::Vector<u8> data{};
+        s64 off{};
+        s64 size{};
+        u64 seq{};
+        Result rc{};
+        State state{State::Empty};
+    };
+
+    auto Find(s64 off) -> Block* {
+        for (auto& e : m_blocks) {
+            if (e.state != State::Empty && e.off == off) {
+                return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    // returns false if there's no block free to read into.
+    bool Request(s64 off, const Block* keep) {
+        Block* block{};
+        for (auto& e : m_blocks) {
+            if (&e == keep || e.state == State::Pending) {
+                continue;
+            }
+
+            if (!block || e.state == State::Empty) {
+                block = &e;
+            }
+        }
+
+        if (!block) {
+            return false;
+        }
+
+        block->off = off;
+        block->size = std::min(m_block_size, m_size - off);
+        block->seq = m_seq++;
+        block->rc = 0;
+        block->state = State::Pending;
+        condvarWakeOne(&m_can_fill);
+        return true;
+    }
+
+    static void ThreadFunc(void* arg) {
+        auto reader = static_cast<GcReader*>(arg);
+
+        for (;;) {
+            Block* block{};
+            {
+                SCOPED_MUTEX(&reader->m_mutex);
+
+                for (;;) {
+                    if (reader->m_quit) {
+                        return;
+                    }
+
+                    // blocks are read in the order they were requested.
+                    for (auto& e : reader->m_blocks) {
+                        if (e.state == State::Pending && (!block || e.seq < block->seq)) {
+                            block = &e;
+                        }
+                    }
+
+                    if (block) {
+                        break;
+                    }
+
+                    condvarWait(&reader->m_can_fill, &reader->m_mutex);
+                }
+            }
+
+            // the block can't be changed while pending, so it's read unlocked.
+            const auto rc = reader->m_menu->GcStorageRead(block->data.data(), block->off, block->size);
+
+            SCOPED_MUTEX(&reader->m_mutex);
+            block->rc = rc;
+            block->state = State::Ready;
+            condvarWakeAll(&reader->m_can_read);
+        }
+    }
+
+private:
+    Menu* const m_menu;
+    const s64 m_size;
+    const s64 m_block_size;
+
+    Mutex m_mutex{};
+    CondVar m_can_read{};
+    CondVar m_can_fill{};
+    Block m_blocks[2]{};
+    u64 m_seq{};
+
+    Thread m_thread{};
+    bool m_running{};
+    bool m_quit{};
+};
+
 struct XciSource final : dump::BaseSource {
     // application name.
     std::string application_name{};
@@ -233,6 +545,12 @@ struct XciSource final : dump::BaseSource {
     s64 xci_size{};
     Menu* menu{};
     int icon{};
+    // created on the first read of the xci.
+    std::unique_ptr<GcReader> reader{};
+    // set to hash the xci as it's read, the result is in hash_report.
+    std::unique_ptr<hash::MultiHasher> hasher{};
+    s64 hash_offset{};
+    std::string hash_report{};
 
     Result Read(const std::string& path, void* buf, s64 off, s64 size, u64* bytes_read) override {
         if (off == xci_size) {
@@ -244,7 +562,16 @@ struct XciSource final : dump::BaseSource {
         if (path.ends_with(GetDumpTypeStr(DumpFileType_XCI)) || path.ends_with(GetDumpTypeStr(DumpFileType_XCZ))) {
             size = ClipSize(off, size, xci_size);
             *bytes_read = size;
-            return menu->GcStorageRead(buf, off, size);
+
+            if (!reader) {
+                reader = std::make_unique<GcReader>(menu, xci_size, menu->GcGetReadSize());
+            }
+            R_TRY(reader->Read(buf, off, size));
+
+            if (hasher) {
+                UpdateHash(buf, off, size);
+            }
+            R_SUCCEED();
         } else {
             std::span<const u8> span;
             if (path.ends_with(GetDumpTypeStr(DumpFileType_Set))) {
@@ -291,6 +618,39 @@ struct XciSource final : dump::BaseSource {
     }
 
 private:
+    void UpdateHash(const void* buf, s64 off, s64 size) {
+        // the hash is only valid if the xci is read once in order.
+        if (off != hash_offset) {
+            log_write("[GC] non sequential read, disabling hash: %zd expected: %zd\n", off, hash_offset);
+            hasher.reset();
+            return;
+        }
+
+        hasher->Update(buf, size);
+        hash_offset += size;
+
+        if (hash_offset == xci_size) {
+            std::vector<std::string> hashes;
+            hasher->Get(hashes);
+            hasher.reset();
+
+            for (u32 i = 0; i < std::size(XCI_HASH_TYPES); i++) {
+                hash_report += hash::GetTypeStr(XCI_HASH_TYPES[i]) + std::string{": "} + hashes[i] + "\n";
+                log_write("[GC] %s: %s\n", hash::GetTypeStr(XCI_HASH_TYPES[i]), hashes[i].c_str());
+            }
+            hash_report += '\n';
+
+            std::vector<u8> dat;
+            if (R_FAILED(fs::FsNativeSd().read_entire_file(XCI_DATABASE_PATH, dat))) {
+                hash_report += "No database found at "_i18n + XCI_DATABASE_PATH.s;
+            } else if (std::string name; FindInXciDatabase({(const char*)dat.data(), dat.size()}, xci_size, hashes, name)) {
+                hash_report += "Verified: "_i18n + name;
+            } else {
+                hash_report += "Not found in database!"_i18n;
+            }
+        }
+    }
+
     static auto InRange(s64 off, s64 offset, s64 size) -> bool {
         return off < offset + size && off >= offset;
     }
@@ -505,7 +865,7 @@ GcSource::GcSource(const ApplicationEntry& entry, fs::FsNativeGameCard* fs)
 
     const auto add_entries = [&](const auto& entries) {
         for (auto& e : entries) {
-            add_collections(e);
+            add_collections(e.collections);
         }
     };
 
@@ -562,12 +922,215 @@ Result GcSource::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
     return m_file.Read(off - m_offset, buf, size, 0, bytes_read);
 }
 
+struct GcNspEntry {
+    // application name.
+    std::string application_name{};
+    // name of the nsp (name [id][v0][BASE].nsp).
+    fs::FsPath path{};
+    // offsets are relative to the end of nsp_data, names are the files on the card.
+    yati::container::Collections collections{};
+    // raw nsp data (header, file table and string table).
+    std::vector<u8> nsp_data{};
+    // size of the entire nsp.
+    s64 nsp_size{};
+};
+
+// presents each title on the gamecard as an nsp, the nsp header is built
+// and the files are read straight from the secure partition.
+// only the files listed in the cnmt are read, so the rest of the card is skipped.
+struct GcNspSource final : dump::BaseSource {
+    GcNspSource(const std::vector<GcNspEntry>& entries, fs::FsNativeGameCard* fs, int icon)
+    : m_entries{entries}, m_fs{fs}, m_icon{icon} {
+        mutexInit(&m_mutex);
+    }
+
+    Result Read(const std::string& path, void* buf, s64 off, s64 size, u64* bytes_read) override {
+        auto it = Find(path);
+        R_UNLESS(it, Result_GcBadReadForDump);
+
+        if (off == it->nsp_size) {
+            *bytes_read = 0;
+            R_SUCCEED();
+        }
+
+        if (off < it->nsp_data.size()) {
+            *bytes_read = size = std::min<s64>(size, it->nsp_data.size() - off);
+            std::memcpy(buf, it->nsp_data.data() + off, size);
+            R_SUCCEED();
+        }
+
+        // adjust offset.
+        off -= it->nsp_data.size();
+
+        for (const auto& collection : it->collections) {
+            if (off < collection.offset + collection.size && off >= collection.offset) {
+                off -= collection.offset;
+                size = std::min(size, collection.size - off);
+
+                // the file is kept open as reads are sequential.
+                SCOPED_MUTEX(&m_mutex);
+                if (m_file_name != collection.name) {
+                    m_file.Close();
+                    m_file_name.clear();
+                    R_TRY(m_fs->OpenFile(fs::AppendPath("/", collection.name), FsOpenMode_Read, &m_file));
+                    m_file_name = collection.name;
+                }
+
+                return m_file.Read(off, buf, size, 0, bytes_read);
+            }
+        }
+
+        R_THROW(Result_GcBadReadForDump);
+    }
+
+    auto GetName(const std::string& path) const -> std::string override {
+        if (auto it = Find(path)) {
+            return it->application_name;
+        }
+        return {};
+    }
+
+    auto GetSize(const std::string& path) const -> s64 override {
+        if (auto it = Find(path)) {
+            return it->nsp_size;
+        }
+        return 0;
+    }
+
+    auto GetIcon(const std::string& path) const -> int override {
+        return m_icon ? m_icon : App::GetDefaultImage();
+    }
+
+    auto Find(const std::string& path) const -> const GcNspEntry* {
+        const auto it = std::ranges::find_if(m_entries, [&path](auto& e){
+            return path.find(e.path.s) != path.npos;
+        });
+
+        return it == m_entries.end() ? nullptr : &*it;
+    }
+
+private:
+    const std::vector<GcNspEntry> m_entries;
+    fs::FsNativeGameCard* const m_fs;
+    const int m_icon;
+
+    Mutex m_mutex{};
+    fs::File m_file{};
+    std::string m_file_name{};
+};
+
+// reads a single nca within an nsp of GcNspSource.
+struct GcNspNcaSource final : yati::source::Base {
+    GcNspNcaSource(GcNspSource* source, const fs::FsPath& path, s64 offset)
+    : m_source{source}, m_path{path}, m_offset{offset} {
+    }
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        return m_source->Read(m_path.s, buf, m_offset + off, size, bytes_read);
+    }
+
+private:
+    GcNspSource* const m_source;
+    const fs::FsPath m_path;
+    const s64 m_offset;
+};
+
+auto BuildNspPath(const ApplicationEntry& e, const GcCollections& collections, bool to_nsz) -> fs::FsPath {
+    fs::FsPath name_buf = e.lang_entry.name;
+    title::utilsReplaceIllegalCharacters(name_buf, true);
+
+    const auto ext = to_nsz ? "nsz" : "nsp";
+    const auto type = ncm::GetMetaTypeShortStr(collections.meta_type);
+
+    fs::FsPath path;
+    if (App::GetApp()->m_dump_app_folder.Get()) {
+        std::snprintf(path, sizeof(path), "%s/%s [%016lX][v%u][%s].%s", name_buf.s, name_buf.s, collections.title_id, collections.title_version, type, ext);
+    } else {
+        std::snprintf(path, sizeof(path), "%s [%016lX][v%u][%s].%s", name_buf.s, collections.title_id, collections.title_version, type, ext);
+    }
+
+    return path;
+}
+
+void BuildNspEntries(const ApplicationEntry& e, const std::vector<GcCollections>& entries, bool to_nsz, std::vector<GcNspEntry>& out) {
+    for (const auto& collections : entries) {
+        auto& nsp = out.emplace_back();
+        nsp.application_name = e.lang_entry.name;
+        nsp.path = BuildNspPath(e, collections, to_nsz);
+
+        s64 offset{};
+        const auto add = [&](const yati::container::CollectionEntry& collection) {
+            nsp.collections.emplace_back(collection.name, offset, collection.size);
+            offset += collection.size;
+        };
+
+        // cnmt goes at the end of the list, following StandardNSP spec.
+        for (const auto& collection : collections.collections) {
+            if (collection.type != NcmContentType_Meta) {
+                add(collection);
+            }
+        }
+
+        for (const auto& collection : collections.collections) {
+            if (collection.type == NcmContentType_Meta) {
+                add(collection);
+            }
+        }
+
+        // tickets aren't linked to the titles on the card, so each nsp gets all
+        // of them, same as installing.
+        for (const auto& collection : e.tickets) {
+            add(collection);
+        }
+
+        nsp.nsp_data = yati::container::Nsp::Build(nsp.collections, nsp.nsp_size);
+    }
+}
+
+#ifdef ENABLE_NSZ
+Result NszExportNsp(ProgressBox* pbox, const keys::Keys& keys, dump::BaseSource* _source, dump::WriteSource* writer, const fs::FsPath& path) {
+    auto source = (GcNspSource*)_source;
+
+    const auto entry = source->Find(path.s);
+    R_UNLESS(entry, Result_GcBadReadForDump);
+
+    const auto nca_creator = [source, entry](const nca::Header& header, const keys::KeyEntry& title_key, const utils::nsz::Collection& collection) {
+        // the collection is still the input collection when this is called.
+        return std::make_unique<nca::NcaReader>(
+            header, &title_key, collection.size,
+            std::make_shared<GcNspNcaSource>(source, entry->path, entry->nsp_data.size() + collection.offset)
+        );
+    };
+
+    auto collections = entry->collections;
+    s64 read_offset = entry->nsp_data.size();
+    s64 write_offset = entry->nsp_data.size();
+
+    R_TRY(utils::nsz::NszExport(pbox, nca_creator, read_offset, write_offset, collections, keys, source, writer, path));
+
+    // zero base the offsets.
+    for (auto& collection : collections) {
+        collection.offset -= entry->nsp_data.size();
+    }
+
+    // build new nsp collection with the updated offsets and sizes.
+    s64 nsp_size = 0;
+    const auto nsp_data = yati::container::Nsp::Build(collections, nsp_size);
+    R_TRY(writer->Write(nsp_data.data(), 0, nsp_data.size()));
+
+    // update with actual size.
+    R_TRY(writer->SetSize(nsp_size));
+
+    R_SUCCEED();
+}
+#endif // ENABLE_NSZ
+
 } // namespace
 
 auto ApplicationEntry::GetSize(const std::vector<GcCollections>& entries) const -> s64 {
     s64 size{};
     for (auto& e : entries) {
-        for (auto& collection : e) {
+        for (auto& collection : e.collections) {
             size += collection.size;
         }
     }
@@ -647,6 +1210,24 @@ Menu::Menu(u32 flags) : MenuBase{"GameCard"_i18n, flags} {
             options->Add<SidebarEntryCallback>("Export options"_i18n, [this](){
                 App::DisplayDumpOptions(false);
             });
+
+            auto export_nsp = options->Add<SidebarEntryCallback>("Export NSP"_i18n, [this](){
+                const auto rc = DumpNsp(false);
+                App::PushErrorBox(rc, "Export failed!"_i18n);
+            }, true, "Exports each title on the gamecard as an NSP, only the used parts of the card are read."_i18n);
+            export_nsp->Depends(m_mounted, "GameCard is not mounted"_i18n);
+
+#ifdef ENABLE_NSZ
+            auto export_nsz = options->Add<SidebarEntryCallback>("Export NSZ"_i18n, [this](){
+                const auto rc = DumpNsp(true);
+                App::PushErrorBox(rc, "Export failed!"_i18n);
+            }, true, "Exports each title on the gamecard as an NSZ (compressed NSP)."_i18n);
+            export_nsz->Depends(m_mounted, "GameCard is not mounted"_i18n);
+#endif // ENABLE_NSZ
+
+            options->Add<SidebarEntryCallback>("Read benchmark"_i18n, [this](){
+                GcBenchmark();
+            }, true, "Measures the read speed of the inserted gamecard and saves the fastest read size for the card type."_i18n);
         }})
     );
 
@@ -810,8 +1391,11 @@ Result Menu::GcMount() {
 
         // always add tickets, yati will ignore them if not needed.
         GcCollections collections;
+        collections.title_id = header.title_id;
+        collections.title_version = header.title_version;
+        collections.meta_type = header.meta_type;
         // add cnmt file.
-        collections.emplace_back(e.name, e.file_size, NcmContentType_Meta, 0);
+        collections.collections.emplace_back(e.name, e.file_size, NcmContentType_Meta, 0);
 
         for (const auto& packed_info : infos) {
             const auto& info = packed_info.info;
@@ -828,7 +1412,7 @@ Result Menu::GcMount() {
             });
 
             R_UNLESS(it != buf.cend(), Result_YatiNcaNotFound);
-            collections.emplace_back(it->name, it->file_size, info.content_type, info.id_offset);
+            collections.collections.emplace_back(it->name, it->file_size, info.content_type, info.id_offset);
         }
 
         const auto app_id = ncm::GetAppId(header);
@@ -921,6 +1505,7 @@ Result Menu::GcMountStorage() {
     R_UNLESS(magic == XCI_MAGIC, Result_GcBadXciMagic);
 
     // calculate the reported size, error if not found.
+    m_rom_size = rom_size;
     m_storage_full_size = GetXciSizeFromRomSize(rom_size);
     log_write("[GC] m_storage_full_size: %zd rom_size: 0x%X\n", m_storage_full_size, rom_size);
     R_UNLESS(m_storage_full_size > 0, Result_GcBadXciRomSize);
@@ -1029,6 +1614,98 @@ Result Menu::GcStorageRead(void* _buf, s64 off, s64 size) {
     R_SUCCEED();
 }
 
+auto Menu::GcGetReadSize() const -> s64 {
+    const auto def = GetReadSizeFromRomSize(m_rom_size);
+    const auto size = App::GetConfigStore().GetLong(INI_SECTION_GC, GetReadSizeKey(m_rom_size), def);
+
+    // reads are kept aligned to the sector size.
+    if (size < 0x200 || size % 0x200) {
+        return def;
+    }
+    return size;
+}
+
+void Menu::GcBenchmark() {
+    if (!m_mounted || m_entries.empty()) {
+        return;
+    }
+
+    if (auto rc = GcMountStorage(); R_FAILED(rc)) {
+        App::PushErrorBox(rc, "Failed to mount GameCard storage"_i18n);
+        return;
+    }
+
+    auto report = std::make_shared<std::string>();
+
+    App::Push<ProgressBox>(m_icon, "Benchmark"_i18n, m_entries[m_entry_index].lang_entry.name, [this, report](auto pbox) -> Result {
+        App::SetBoostMode(true);
+        ON_SCOPE_EXIT(App::SetBoostMode(false));
+
+        const auto bench_size = std::min<s64>(BENCHMARK_SIZE, m_storage_trimmed_size & ~0x1FF);
+        const auto total = bench_size * (std::size(BENCHMARK_READ_SIZES) + 1);
+        s64 done{};
+
+        const auto format_speed = [](s64 size, u64 ns) {
+            return utils::formatSizeStorage(ns ? u64(size * 1e+9 / ns) : 0) + "/s";
+        };
+
+        s64 best_size{};
+        u64 best_ns{};
+        std::vector<u8> buf(BENCHMARK_READ_SIZES[std::size(BENCHMARK_READ_SIZES) - 1]);
+
+        // raw reads, waiting on each one.
+        for (const auto read_size : BENCHMARK_READ_SIZES) {
+            pbox->NewTransfer(utils::formatSizeStorage(read_size));
+
+            const auto start = armGetSystemTick();
+            for (s64 off = 0; off < bench_size; off += read_size) {
+                R_TRY(pbox->ShouldExitResult());
+
+                const auto size = std::min(read_size, bench_size - off);
+                R_TRY(GcStorageRead(buf.data(), off, size));
+                pbox->UpdateTransfer(done += size, total);
+            }
+            const auto ns = armTicksToNs(armGetSystemTick() - start);
+
+            log_write("[GC] benchmark read size: %zd time: %zums\n", read_size, ns / 1000000);
+            *report += utils::formatSizeStorage(read_size) + ": " + format_speed(bench_size, ns) + "\n";
+
+            if (!best_ns || ns < best_ns) {
+                best_ns = ns;
+                best_size = read_size;
+            }
+        }
+
+        // double buffered at the fastest size, consumed in small reads like a dump.
+        {
+            pbox->NewTransfer("Double buffered"_i18n);
+
+            GcReader reader{this, bench_size, best_size};
+            const auto start = armGetSystemTick();
+            for (s64 off = 0; off < bench_size; off += 1024 * 512) {
+                R_TRY(pbox->ShouldExitResult());
+
+                const auto size = std::min<s64>(1024 * 512, bench_size - off);
+                R_TRY(reader.Read(buf.data(), off, size));
+                pbox->UpdateTransfer(done += size, total);
+            }
+            const auto ns = armTicksToNs(armGetSystemTick() - start);
+
+            *report += "Double buffered"_i18n + " (" + utils::formatSizeStorage(best_size) + "): " + format_speed(bench_size, ns);
+        }
+
+        App::GetConfigStore().SetLong(INI_SECTION_GC, GetReadSizeKey(m_rom_size), best_size);
+        log_write("[GC] benchmark best read size: %zd rom_size: 0x%X\n", best_size, m_rom_size);
+        R_SUCCEED();
+    }, [this, report](Result rc){
+        App::PushErrorBox(rc, "Benchmark failed!"_i18n);
+
+        if (R_SUCCEEDED(rc)) {
+            App::Push<OptionBox>(*report, "OK"_i18n);
+        }
+    });
+}
+
 Result Menu::GcPoll(bool* inserted) {
     R_TRY(fsDeviceOperatorIsGameCardInserted(&m_dev_op, inserted));
 
@@ -1140,6 +1817,39 @@ Result Menu::DumpXcz(u32 flags) {
 }
 #endif // ENABLE_NSZ
 
+Result Menu::DumpNsp(bool to_nsz) {
+    R_UNLESS(m_mounted && !m_entries.empty(), Result_GcEmptyGamecard);
+    const auto& e = m_entries[m_entry_index];
+
+    std::vector<GcNspEntry> entries;
+    BuildNspEntries(e, e.application, to_nsz, entries);
+    BuildNspEntries(e, e.patch, to_nsz, entries);
+    BuildNspEntries(e, e.add_on, to_nsz, entries);
+    BuildNspEntries(e, e.data_patch, to_nsz, entries);
+
+    std::vector<fs::FsPath> paths;
+    for (const auto& nsp : entries) {
+        paths.emplace_back(fs::AppendPath(to_nsz ? DUMP_NSZ_BASE_PATH : DUMP_NSP_BASE_PATH, nsp.path));
+    }
+
+    auto source = std::make_shared<GcNspSource>(entries, m_fs.get(), m_icon);
+
+    if (to_nsz) {
+#ifdef ENABLE_NSZ
+        keys::Keys keys;
+        R_TRY(keys::parse_keys(keys, true));
+
+        dump::Dump(source, paths, [keys](ProgressBox* pbox, dump::BaseSource* source, dump::WriteSource* writer, const fs::FsPath& path) {
+            return NszExportNsp(pbox, keys, source, writer, path);
+        });
+#endif // ENABLE_NSZ
+    } else {
+        dump::Dump(source, paths);
+    }
+
+    R_SUCCEED();
+}
+
 Result Menu::DumpGames(u32 flags) {
     // first, try and mount the storage.
     // this will fill out the xci header, verify and get sizes.
@@ -1201,7 +1911,15 @@ Result Menu::DumpGames(u32 flags) {
         }
 
 
-        dump::Dump(source, paths, nullptr, location_flags);
+        if (flags & DumpFileFlag_XCI) {
+            source->hasher = std::make_unique<hash::MultiHasher>(XCI_HASH_TYPES, source->xci_size);
+        }
+
+        dump::Dump(source, paths, [source](Result rc){
+            if (R_SUCCEEDED(rc) && !source->hash_report.empty()) {
+                App::Push<OptionBox>(source->hash_report, "OK"_i18n);
+            }
+        }, location_flags);
         R_SUCCEED();
     };
 
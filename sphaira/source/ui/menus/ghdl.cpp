@@ -17,11 +17,13 @@
 #include "i18n.hpp"
 #include "yyjson_helper.hpp"
 #include "threaded_file_transfer.hpp"
+#include "utils/thread.hpp"
 
 #include <minIni.h>
 #include <dirent.h>
 #include <cstring>
 #include <string>
+#include <atomic>
 
 namespace sphaira::ui::menu::gh {
 namespace {
@@ -97,29 +99,28 @@ void from_json(const fs::FsPath& path, std::vector<GhApiEntry>& e) {
     }
 }
 
-auto DownloadApp(ProgressBox* pbox, const GhApiAsset& gh_asset, const AssetEntry* entry) -> Result {
-    static const fs::FsPath temp_file{"/switch/sphaira/cache/github/ghdl.temp"};
-
-    fs::FsNativeSd fs;
-    R_TRY(fs.GetFsOpenResult());
-    ON_SCOPE_EXIT(fs.DeleteFile(temp_file));
+auto BuildTempPath(u32 index) -> fs::FsPath {
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/ghdl_%u.temp", CACHE_PATH, index);
+    return path;
+}
 
+auto DownloadAsset(const GhApiAsset& gh_asset, const fs::FsPath& temp_file, curl::OnProgress&& on_progress) -> Result {
     R_UNLESS(!gh_asset.browser_download_url.empty(), Result_GhdlEmptyAsset);
+    log_write("starting download: %s\n", gh_asset.browser_download_url.c_str());
 
-    // 2. download the asset
-    if (!pbox->ShouldExit()) {
-        pbox->NewTransfer(i18n::Reorder("Downloading ", gh_asset.name));
-        log_write("starting download: %s\n", gh_asset.browser_download_url.c_str());
-
-        const auto result = curl::Api().ToFile(
-            curl::Url{gh_asset.browser_download_url},
-            curl::Path{temp_file},
-            curl::OnProgress{pbox->OnDownloadProgressCallback()}
-        );
+    const auto result = curl::Api().ToFile(
+        curl::Url{gh_asset.browser_download_url},
+        curl::Path{temp_file},
+        curl::OnProgress{std::move(on_progress)},
+        curl::Flags{curl::Flag_Segmented}
+    );
 
-        R_UNLESS(result.success, Result_GhdlFailedToDownloadAsset);
-    }
+    R_UNLESS(result.success, Result_GhdlFailedToDownloadAsset);
+    R_SUCCEED();
+}
 
+auto InstallAsset(ProgressBox* pbox, fs::Fs* fs, const GhApiAsset& gh_asset, const AssetEntry* entry, const fs::FsPath& temp_file) -> Result {
     fs::FsPath root_path{"/"};
     if (entry && !entry->path.empty()) {
         root_path = entry->path;
@@ -128,17 +129,107 @@ auto DownloadApp(ProgressBox* pbox, const GhApiAsset& gh_asset, const AssetEntry
     // 3. extract the zip / file
     if (gh_asset.content_type.find("zip") != gh_asset.content_type.npos) {
         log_write("found zip\n");
-        R_TRY(thread::TransferUnzipAll(pbox, temp_file, &fs, root_path));
+        R_TRY(thread::TransferUnzipAll(pbox, temp_file, fs, root_path));
     } else {
-        fs.CreateDirectoryRecursivelyWithPath(root_path);
-        fs.DeleteFile(root_path);
-        R_TRY(fs.RenameFile(temp_file, root_path));
+        fs->CreateDirectoryRecursivelyWithPath(root_path);
+        fs->DeleteFile(root_path);
+        R_TRY(fs->RenameFile(temp_file, root_path));
     }
 
     log_write("success\n");
     R_SUCCEED();
 }
 
+auto DownloadApp(ProgressBox* pbox, const GhApiAsset& gh_asset, const AssetEntry* entry) -> Result {
+    const auto temp_file = BuildTempPath(0);
+
+    fs::FsNativeSd fs;
+    R_TRY(fs.GetFsOpenResult());
+    ON_SCOPE_EXIT(fs.DeleteFile(temp_file));
+
+    // 2. download the asset
+    if (!pbox->ShouldExit()) {
+        pbox->NewTransfer(i18n::Reorder("Downloading ", gh_asset.name));
+        R_TRY(DownloadAsset(gh_asset, temp_file, pbox->OnDownloadProgressCallback()));
+    }
+
+    return InstallAsset(pbox, &fs, gh_asset, entry, temp_file);
+}
+
+// the assets are downloaded one after another on a thread, each asset is
+// extracted on this thread once downloaded, whilst the next one downloads.
+auto DownloadApps(ProgressBox* pbox, const std::vector<GhApiAsset>& assets, const std::vector<const AssetEntry*>& entries) -> Result {
+    fs::FsNativeSd fs;
+    R_TRY(fs.GetFsOpenResult());
+
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < assets.size(); i++) {
+            fs.DeleteFile(BuildTempPath(i));
+        }
+    );
+
+    struct State {
+        Mutex mutex{};
+        CondVar can_install{};
+        std::vector<Result> results{};
+        // number of assets that have finished downloading.
+        u32 done{};
+        std::atomic<s64> dltotal{};
+        std::atomic<s64> dlnow{};
+        std::atomic_bool stop{};
+    } state{};
+
+    mutexInit(&state.mutex);
+    condvarInit(&state.can_install);
+    state.results.resize(assets.size());
+
+    utils::Async downloader{[&](){
+        for (u32 i = 0; i < assets.size(); i++) {
+            state.dltotal = state.dlnow = 0;
+
+            Result rc = Result_TransferCancelled;
+            if (!state.stop) {
+                rc = DownloadAsset(assets[i], BuildTempPath(i), [&](s64 dltotal, s64 dlnow, s64 ultotal, s64 ulnow){
+                    state.dltotal = dltotal;
+                    state.dlnow = dlnow;
+                    return !state.stop && !pbox->ShouldExit();
+                });
+            }
+
+            SCOPED_MUTEX(&state.mutex);
+            state.results[i] = rc;
+            state.done = i + 1;
+            condvarWakeOne(&state.can_install);
+        }
+    }};
+
+    // stop the downloader if we fail part way, the thread is joined after this.
+    ON_SCOPE_EXIT(state.stop = true);
+
+    for (u32 i = 0; i < assets.size(); i++) {
+        pbox->NewTransfer(i18n::Reorder("Downloading ", assets[i].name));
+
+        Result rc;
+        while (true) {
+            SCOPED_MUTEX(&state.mutex);
+            if (state.done > i) {
+                rc = state.results[i];
+                break;
+            }
+
+            // update the progress whilst waiting for the download.
+            pbox->UpdateTransfer(state.dlnow, state.dltotal);
+            condvarWaitTimeout(&state.can_install, &state.mutex, 1e+8);
+        }
+
+        R_TRY(rc);
+        R_TRY(pbox->ShouldExitResult());
+        R_TRY(InstallAsset(pbox, &fs, assets[i], i < entries.size() ? entries[i] : nullptr, BuildTempPath(i)));
+    }
+
+    R_SUCCEED();
+}
+
 auto DownloadReleaseJsonJson(ProgressBox* pbox, const std::string& url, std::vector<GhApiEntry>& out) -> Result {
     // 1. download the json
     if (!pbox->ShouldExit()) {
@@ -165,6 +256,48 @@ auto DownloadReleaseJsonJson(ProgressBox* pbox, const std::string& url, std::vec
     R_SUCCEED();
 }
 
+void DownloadAllAssets(const Entry& entry, const std::vector<GhApiAsset>& assets, const std::vector<const AssetEntry*>& asset_ptr) {
+    std::string pre_install_message = entry.pre_install_message;
+    std::string post_install_message = entry.post_install_message;
+    for (const auto ptr : asset_ptr) {
+        if (!ptr->pre_install_message.empty()) {
+            pre_install_message += (pre_install_message.empty() ? "" : "\n") + ptr->pre_install_message;
+        }
+        if (!ptr->post_install_message.empty()) {
+            post_install_message += (post_install_message.empty() ? "" : "\n") + ptr->post_install_message;
+        }
+    }
+
+    const auto func = [entry, assets, asset_ptr, post_install_message](){
+        App::Push<ProgressBox>(0, "Downloading "_i18n, entry.repo, [assets, asset_ptr](auto pbox) -> Result {
+            return DownloadApps(pbox, assets, asset_ptr);
+        }, [entry, post_install_message](Result rc){
+            homebrew::SignalChange();
+            App::PushErrorBox(rc, "Failed to download app!"_i18n);
+
+            if (R_SUCCEEDED(rc)) {
+                App::Notify(i18n::Reorder("Downloaded ", entry.repo));
+                if (!post_install_message.empty()) {
+                    App::Push<OptionBox>(post_install_message, "OK"_i18n);
+                }
+            }
+        });
+    };
+
+    if (!pre_install_message.empty()) {
+        App::Push<OptionBox>(
+            pre_install_message,
+            "Back"_i18n, "Download"_i18n, 1, [func](auto op_index){
+                if (op_index && *op_index) {
+                    func();
+                }
+            }
+        );
+    } else {
+        func();
+    }
+}
+
 } // namespace
 
 Menu::Menu(u32 flags) : MenuBase{"GitHub"_i18n, flags} {
@@ -403,12 +536,23 @@ void DownloadEntries(const Entry& entry) {
                 }
             }
 
-            App::Push<PopupList>("Select asset to download for "_i18n + entry.repo, asset_items, [entry, api_assets, asset_ptr](auto op_index){
+            // when the entry lists the assets it needs, they can all be installed at once.
+            const auto can_download_all = using_name && api_assets.size() > 1;
+            if (can_download_all) {
+                asset_items.emplace(asset_items.begin(), "Download all"_i18n);
+            }
+
+            App::Push<PopupList>("Select asset to download for "_i18n + entry.repo, asset_items, [entry, api_assets, asset_ptr, can_download_all](auto op_index){
                 if (!op_index) {
                     return;
                 }
 
-                const auto index = *op_index;
+                if (can_download_all && !*op_index) {
+                    DownloadAllAssets(entry, api_assets, asset_ptr);
+                    return;
+                }
+
+                const auto index = *op_index - can_download_all;
                 const auto& asset_entry = api_assets[index];
                 const AssetEntry* ptr{};
                 auto pre_install_message = entry.pre_install_message;
@@ -66,6 +66,16 @@ Vec4 Menu::DrawEntry(NVGcontext* vg, Theme* theme, bool draw_image, int layout,
     return image_v;
 }
 
+auto Menu::GetThumbSize(int layout) -> int {
+    switch (layout) {
+        case LayoutType_List: return 256;
+        case LayoutType_Grid: return 174;
+        case LayoutType_GridDetail: return 115;
+    }
+
+    return 0;
+}
+
 void Menu::OnLayoutChange(std::unique_ptr<List>& list, int layout) {
     m_scroll_name.Reset();
     m_scroll_author.Reset();
@@ -37,8 +37,9 @@ auto GenerateStarPath(const fs::FsPath& nro_path) -> fs::FsPath {
 }
 
 void FreeEntry(NVGcontext* vg, NroEntry& e) {
-    nvgDeleteImage(vg, e.image);
+    gfx::deleteImage(vg, e.image);
     e.image = 0;
+    e.image_request.reset();
 }
 
 } // namespace
@@ -105,37 +106,17 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
 void Menu::Draw(NVGcontext* vg, Theme* theme) {
     MenuBase::Draw(vg, theme);
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
-
-    m_list->Draw(vg, theme, m_entries_current.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    s64 first = -1, last = -1;
+    m_list->Draw(vg, theme, m_entries_current.size(), [this, &first, &last](auto* vg, auto* theme, auto v, auto pos) {
         const auto index = m_entries_current[pos];
         auto& e = m_entries[index];
 
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (!e.image && e.icon_size && e.icon_offset) {
-                // NOTE: it seems that images can be any size. SuperTux uses a 1024x1024
-                // ~300Kb image, which takes a few frames to completely load.
-                // really, switch-tools should handle this by resizing the image before
-                // adding it to the nro, as well as validate its a valid jpeg.
-                const auto icon = nro_get_icon(e.path, e.icon_size, e.icon_offset);
-                TimeStamp ts;
-                if (!icon.empty()) {
-                    const auto image = ImageLoadFromMemory(icon, ImageFlag_JPEG);
-                    if (!image.data.empty()) {
-                        e.image = nvgCreateImageRGBA(vg, image.w, image.h, 0, image.data.data());
-                        log_write("\t[image load] time taken: %.2fs %zums\n", ts.GetSecondsD(), ts.GetMs());
-                        image_load_count++;
-                    } else {
-                        // prevent loading of this icon again as it's already failed.
-                        e.icon_offset = e.icon_size = 0;
-                    }
-                }
-            }
+        if (first < 0) {
+            first = pos;
         }
+        last = pos;
 
+        LoadIcon(e, pos);
 
         bool has_star = false;
         if (IsStarEnabled()) {
@@ -155,6 +136,42 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         const auto selected = pos == m_index;
         DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, name.c_str(), e.GetAuthor(), e.GetDisplayVersion());
     });
+
+    // also load the rows just outside the list, so that they're usually ready
+    // by the time they scroll into view.
+    // these are further from the selected entry, so visible icons are still
+    // decoded first.
+    if (first >= 0) {
+        const auto prefetch = m_list->GetRow() * ICON_PREFETCH_ROWS;
+        const s64 count = m_entries_current.size();
+        for (auto pos = std::max<s64>(0, first - prefetch); pos < first; pos++) {
+            LoadIcon(m_entries[m_entries_current[pos]], pos);
+        }
+        for (auto pos = last + 1; pos < std::min(count, last + 1 + prefetch); pos++) {
+            LoadIcon(m_entries[m_entries_current[pos]], pos);
+        }
+    }
+}
+
+void Menu::LoadIcon(NroEntry& e, s64 pos) {
+    // lazy load image, icons closest to the selected entry are decoded first.
+    // NOTE: it seems that images can be any size. SuperTux uses a 1024x1024
+    // ~300Kb image, which takes a while to decode.
+    // really, switch-tools should handle this by resizing the image before
+    // adding it to the nro, as well as validate its a valid jpeg.
+    // the thumbnail is keyed on the path and timestamp, so a cached icon
+    // doesn't need to read the nro.
+    // otherwise the icon offset is from the scan, so it's a single read.
+    const image::Thumb thumb{image::MakeThumbId(e.path.s, e.timestamp.modified ^ e.size), GetThumbSize(m_layout.Get())};
+    image::LoadAsync(e.image_request, e.image, std::abs(pos - m_index), ImageFlag_JPEG, thumb, [&e]() -> image::Loader {
+        if (!e.icon_size || !e.icon_offset) {
+            return {};
+        }
+
+        return [path = e.path, size = e.icon_size, offset = e.icon_offset]() {
+            return nro_get_icon(path, size, offset);
+        };
+    });
 }
 
 void Menu::OnFocusGained() {
@@ -218,9 +235,7 @@ void Menu::ScanHomebrew() {
         std::string last_section{};
     } ini_user{ m_entries };
 
-    ini_browse([](const mTCHAR *Section, const mTCHAR *Key, const mTCHAR *Value, void *UserData) -> int {
-        auto user = static_cast<IniUser*>(UserData);
-
+    App::GetPlaylogStore().Browse([user = &ini_user](const char* Section, const char* Key, const char* Value) {
         if (user->last_section != Section) {
             user->last_section = Section;
             user->ini = nullptr;
@@ -242,8 +257,8 @@ void Menu::ScanHomebrew() {
         }
 
         // log_write("found: %s %s %s\n", Section, Key, Value);
-        return 1;
-    }, &ini_user, App::PLAYLOG_PATH);
+        return true;
+    });
 
     // pre-allocate the max size.
     for (auto& index : m_entries_index) {
@@ -414,6 +429,12 @@ void Menu::FreeEntries() {
 void Menu::OnLayoutChange() {
     m_index = 0;
     grid::Menu::OnLayoutChange(m_list, m_layout.Get());
+
+    // reload the icons at the thumbnail size of the new layout.
+    auto vg = App::GetVg();
+    for (auto& e : m_entries) {
+        FreeEntry(vg, e);
+    }
 }
 
 Result Menu::InstallHomebrew(const fs::FsPath& path, const std::vector<u8>& icon) {
@@ -489,7 +510,7 @@ void Menu::DisplayOptions() {
         #endif
 
         options->Add<SidebarEntryBool>("Hide"_i18n, GetEntry().hbini.hidden, [this](bool& v_out){
-            ini_putl(GetEntry().path, "hidden", v_out, App::PLAYLOG_PATH);
+            App::GetPlaylogStore().SetLong(GetEntry().path.s, "hidden", v_out);
             ScanHomebrew();
             App::PopToMenu();
         },  "Hides the selected homebrew.\n\n"
@@ -4,13 +4,24 @@
 #include "app.hpp"
 #include "i18n.hpp"
 #include "image.hpp"
+#include "utils/mem_track.hpp"
+
+#include <cstring>
+#include <algorithm>
 
 namespace sphaira::ui::menu::imageview {
 namespace {
 
+// size of each tile texture.
+constexpr u32 TILE_SIZE = 512;
+// number of tile textures kept around, 1MiB each.
+constexpr u32 MAX_TILES = 24;
+
 } // namespace
 
 Menu::Menu(fs::Fs* fs, const fs::FsPath& path) : m_path{path} {
+    SCOPED_MEM_TAG(utils::mem::Tag_Image);
+
     SetAction(Button::B, Action{[this](){
         SetPop();
     }});
@@ -29,20 +40,17 @@ Menu::Menu(fs::Fs* fs, const fs::FsPath& path) : m_path{path} {
         flags = ImageFlag_JPEG;
     }
 
-    const auto result = ImageLoadFromMemory(m_image_buf, flags);
+    auto result = ImageLoadFromMemory(m_image_buf, flags);
     if (result.data.empty()) {
         SetPop();
         return;
     }
 
-    m_image = nvgCreateImageRGBA(App::GetVg(), result.w, result.h, 0, result.data.data());
-    if (m_image <= 0) {
-        SetPop();
-        return;
-    }
-
     m_image_width = result.w;
     m_image_height = result.h;
+    // the encoded file is no longer needed.
+    m_image_buf = {};
+    m_levels.emplace_back(std::move(result.data), result.w, result.h);
 
     // scale to fit.
     const auto ws = SCREEN_WIDTH / m_image_width;
@@ -53,7 +61,10 @@ Menu::Menu(fs::Fs* fs, const fs::FsPath& path) : m_path{path} {
 }
 
 Menu::~Menu() {
-    nvgDeleteImage(App::GetVg(), m_image);
+    for (const auto& tile : m_tiles) {
+        nvgDeleteImage(App::GetVg(), tile.image);
+        utils::mem::Remove(utils::mem::Tag_Image, tile.size);
+    }
 }
 
 void Menu::Update(Controller* controller, TouchInfo* touch) {
@@ -95,12 +106,123 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
 
 void Menu::Draw(NVGcontext* vg, Theme* theme) {
     gfx::drawRect(vg, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, nvgRGB(0, 0, 0));
-    gfx::drawImage(vg, m_xoff + GetX(), m_yoff + GetY(), GetW(), GetH(), m_image);
+
+    // draw the smallest level that isn't upscaled, and only the tiles on screen.
+    m_frame++;
+    const auto level_index = GetLevelIndex();
+    if (const auto level = GetLevel(level_index)) {
+        // size of a level pixel on screen.
+        const auto scale = m_zoom * (1 << level_index);
+        const auto tile_size = TILE_SIZE * scale;
+        const auto ox = m_xoff + GetX();
+        const auto oy = m_yoff + GetY();
+
+        const auto cols = (level->w + TILE_SIZE - 1) / TILE_SIZE;
+        const auto rows = (level->h + TILE_SIZE - 1) / TILE_SIZE;
+        const auto x_start = std::max<int>(0, (0 - ox) / tile_size);
+        const auto y_start = std::max<int>(0, (0 - oy) / tile_size);
+        const auto x_end = std::min<int>(cols, (SCREEN_WIDTH - ox) / tile_size + 1);
+        const auto y_end = std::min<int>(rows, (SCREEN_HEIGHT - oy) / tile_size + 1);
+
+        for (int y = y_start; y < y_end; y++) {
+            for (int x = x_start; x < x_end; x++) {
+                const auto image = GetTile(level_index, x, y);
+                if (image <= 0) {
+                    continue;
+                }
+
+                const auto w = std::min<int>(TILE_SIZE, level->w - x * TILE_SIZE) * scale;
+                const auto h = std::min<int>(TILE_SIZE, level->h - y * TILE_SIZE) * scale;
+                gfx::drawImage(vg, ox + x * tile_size, oy + y * tile_size, w, h, image);
+            }
+        }
+    }
+
+    EvictTiles();
 
     // todo: when pan/zoom, show image info to the screen.
     // todo: maybe show image info by default and option to hide it.
 }
 
+auto Menu::GetLevelIndex() const -> u32 {
+    u32 index = 0;
+    auto w = (int)m_image_width;
+    auto h = (int)m_image_height;
+
+    // stop before the level would be drawn larger than it is.
+    while (m_zoom * (2 << index) <= 1.0f && (w > 1 || h > 1)) {
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+        index++;
+    }
+
+    return index;
+}
+
+auto Menu::GetLevel(u32 index) -> const Level* {
+    if (m_levels.empty()) {
+        return nullptr;
+    }
+
+    SCOPED_MEM_TAG(utils::mem::Tag_Image);
+    while (m_levels.size() <= index) {
+        const auto& last = m_levels.back();
+        const auto w = std::max(1, last.w / 2);
+        const auto h = std::max(1, last.h / 2);
+
+        auto result = ImageResize(last.data, last.w, last.h, w, h);
+        if (result.data.empty()) {
+            return &m_levels.back();
+        }
+
+        m_levels.emplace_back(std::move(result.data), w, h);
+    }
+
+    return &m_levels[index];
+}
+
+auto Menu::GetTile(u32 level, u32 x, u32 y) -> int {
+    for (auto& tile : m_tiles) {
+        if (tile.level == level && tile.x == x && tile.y == y) {
+            tile.last_used = m_frame;
+            return tile.image;
+        }
+    }
+
+    const auto& e = m_levels[level];
+    const auto w = std::min<int>(TILE_SIZE, e.w - x * TILE_SIZE);
+    const auto h = std::min<int>(TILE_SIZE, e.h - y * TILE_SIZE);
+    const auto pitch = e.w * 4;
+
+    // copy the rows of the tile out of the level.
+    std::vector<u8> data(w * h * 4);
+    const auto src = e.data.data() + (y * TILE_SIZE) * pitch + (x * TILE_SIZE) * 4;
+    for (int i = 0; i < h; i++) {
+        std::memcpy(data.data() + i * w * 4, src + i * pitch, w * 4);
+    }
+
+    const auto image = nvgCreateImageRGBA(App::GetVg(), w, h, 0, data.data());
+    if (image > 0) {
+        m_tiles.emplace_back(image, level, x, y, m_frame, w * h * 4);
+        utils::mem::Add(utils::mem::Tag_Image, w * h * 4);
+    }
+    return image;
+}
+
+void Menu::EvictTiles() {
+    // tiles drawn this frame are never evicted.
+    while (m_tiles.size() > MAX_TILES) {
+        const auto it = std::ranges::min_element(m_tiles, {}, &Tile::last_used);
+        if (it->last_used == m_frame) {
+            break;
+        }
+
+        nvgDeleteImage(App::GetVg(), it->image);
+        utils::mem::Remove(utils::mem::Tag_Image, it->size);
+        m_tiles.erase(it);
+    }
+}
+
 void Menu::UpdateSize() {
     m_zoom = std::clamp(m_zoom, 0.1f, 4.0f);
 
@@ -16,16 +16,16 @@ enum class InstallState {
     Finished,
 };
 
-constexpr u64 MAX_BUFFER_SIZE = 1024ULL*1024ULL*1ULL;
+// timeout for blocking waits, so that a stop request is noticed.
+constexpr u64 WAIT_TIMEOUT = 1e+8; // 100ms
 std::atomic<InstallState> INSTALL_STATE{InstallState::None};
 
 } // namespace
 
-Stream::Stream(const fs::FsPath& path, std::stop_token token) {
+Stream::Stream(const fs::FsPath& path, std::stop_token token) : m_ring{RING_SIZE} {
     m_path = path;
     m_token = token;
     m_active = true;
-    m_buffer.reserve(MAX_BUFFER_SIZE);
 
     mutexInit(&m_mutex);
     condvarInit(&m_can_read);
@@ -42,27 +42,37 @@ Result Stream::ReadChunk(void* _buf, s64 size, u64* bytes_read) {
     );
 
     while (!m_token.stop_requested()) {
-        SCOPED_MUTEX(&m_mutex);
-        if (m_active && m_buffer.empty()) {
-            R_TRY(condvarWait(std::addressof(m_can_read), std::addressof(m_mutex)));
+        const auto rsize = m_ring.Read(buf, size);
+        if (rsize) {
+            size -= rsize;
+            buf += rsize;
+            *bytes_read += rsize;
+            m_read += rsize;
+            WakePush();
+
+            if (!size) {
+                R_SUCCEED();
+            }
+            continue;
         }
 
-        if ((!m_active && m_buffer.empty()) || m_token.stop_requested()) {
-            break;
+        // data may have been pushed just before being disabled, so check again.
+        if (!m_active) {
+            if (m_ring.IsEmpty()) {
+                break;
+            }
+            continue;
         }
 
-        const auto rsize = std::min<s64>(size, m_buffer.size());
-        std::memcpy(buf, m_buffer.data(), rsize);
-        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + rsize);
-        condvarWakeOne(&m_can_write);
-
-        size -= rsize;
-        buf += rsize;
-        *bytes_read += rsize;
-
-        if (!size) {
-            R_SUCCEED();
+        SCOPED_MUTEX(&m_mutex);
+        m_pull_waiting = true;
+        if (m_ring.IsEmpty() && m_active) {
+            const auto start = armGetSystemTick();
+            condvarWaitTimeout(&m_can_read, &m_mutex, WAIT_TIMEOUT);
+            m_stats.read.blocked_ns += armTicksToNs(armGetSystemTick() - start);
+            m_stats.read.waits++;
         }
+        m_pull_waiting = false;
     }
 
     log_write("[Stream::ReadChunk] failed to read\n");
@@ -86,34 +96,61 @@ bool Stream::Push(const void* _buf, s64 size) {
             return true;
         }
 
-        SCOPED_MUTEX(&m_mutex);
-        if (m_active && m_buffer.size() >= MAX_BUFFER_SIZE) {
-            R_TRY(condvarWait(std::addressof(m_can_write), std::addressof(m_mutex)));
-        }
-
         if (!m_active) {
             log_write("[Stream::Push] file not active\n");
             break;
         }
 
-        const auto wsize = std::min<s64>(size, MAX_BUFFER_SIZE - m_buffer.size());
-        const auto offset = m_buffer.size();
-        m_buffer.resize(offset + wsize);
+        const auto wsize = m_ring.Write(buf, size);
+        if (wsize) {
+            size -= wsize;
+            buf += wsize;
+            m_pushed += wsize;
+            WakePull();
 
-        std::memcpy(m_buffer.data() + offset, buf, wsize);
-        condvarWakeOne(&m_can_read);
+            if (!size) {
+                return true;
+            }
+            continue;
+        }
 
-        size -= wsize;
-        buf += wsize;
-        if (!size) {
-            return true;
+        SCOPED_MUTEX(&m_mutex);
+        m_push_waiting = true;
+        if (!m_ring.Space() && m_active) {
+            const auto start = armGetSystemTick();
+            condvarWaitTimeout(&m_can_write, &m_mutex, WAIT_TIMEOUT);
+            m_stats.push.blocked_ns += armTicksToNs(armGetSystemTick() - start);
+            m_stats.push.waits++;
         }
+        m_push_waiting = false;
     }
 
     log_write("[Stream::Push] failed to push\n");
     return false;
 }
 
+auto Stream::GetStats() -> StreamStats {
+    SCOPED_MUTEX(&m_mutex);
+    auto stats = m_stats;
+    stats.push.bytes = m_pushed;
+    stats.read.bytes = m_read;
+    return stats;
+}
+
+void Stream::WakePull() {
+    if (m_pull_waiting) {
+        SCOPED_MUTEX(&m_mutex);
+        condvarWakeOne(&m_can_read);
+    }
+}
+
+void Stream::WakePush() {
+    if (m_push_waiting) {
+        SCOPED_MUTEX(&m_mutex);
+        condvarWakeOne(&m_can_write);
+    }
+}
+
 void Stream::Disable() {
     log_write("[Stream::Disable] disabling file\n");
 
@@ -134,6 +171,7 @@ Menu::Menu(const std::string& title, u32 flags) : MenuBase{title, flags} {
 
     App::SetAutoSleepDisabled(true);
     mutexInit(&m_mutex);
+    condvarInit(&m_state_changed);
 
     INSTALL_STATE = InstallState::None;
 }
@@ -157,9 +195,21 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
     if (m_state == State::Connected) {
         m_state = State::Progress;
         App::Push<ui::ProgressBox>(0, "Installing "_i18n, m_source->GetPath(), [this](auto pbox) -> Result {
-            INSTALL_STATE = InstallState::Progress;
+            const auto set_install_state = [this](InstallState state) {
+                INSTALL_STATE = state;
+                SCOPED_MUTEX(&m_mutex);
+                condvarWakeAll(&m_state_changed);
+            };
+
+            set_install_state(InstallState::Progress);
             const auto rc = yati::InstallFromSource(pbox, m_source.get(), m_source->GetPath());
-            INSTALL_STATE = InstallState::Finished;
+            set_install_state(InstallState::Finished);
+
+            // format: MiB blocked (waits)
+            const auto stats = m_source->GetStats();
+            log_write("[Stream] push: %.2f MiB %.3fs (%u) read: %.2f MiB %.3fs (%u)\n",
+                stats.push.bytes / 1024.0 / 1024.0, stats.push.blocked_ns / 1e+9, stats.push.waits,
+                stats.read.bytes / 1024.0 / 1024.0, stats.read.blocked_ns / 1e+9, stats.read.waits);
 
             if (R_FAILED(rc)) {
                 m_source->Disable();
@@ -179,6 +229,8 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
                 m_state = State::Failed;
                 OnDisableInstallMode();
             }
+
+            condvarWakeAll(&m_state_changed);
         });
     }
 }
@@ -207,47 +259,20 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
 bool Menu::OnInstallStart(const char* path) {
     log_write("[Menu::OnInstallStart] inside\n");
 
-    for (;;) {
-        {
-            SCOPED_MUTEX(&m_mutex);
-
-            if (m_state != State::Progress) {
-                break;
-            }
+    SCOPED_MUTEX(&m_mutex);
 
-            if (GetToken().stop_requested()) {
-                return false;
-            }
+    // wait for the previous install to finish, its source is disabled once
+    // the file has been closed or the install failed.
+    while (m_state == State::Progress || (m_source && (m_source->m_active || INSTALL_STATE == InstallState::Progress))) {
+        if (GetToken().stop_requested()) {
+            return false;
         }
 
-        svcSleepThread(1e+6);
+        condvarWaitTimeout(&m_state_changed, &m_mutex, WAIT_TIMEOUT);
     }
 
     log_write("[Menu::OnInstallStart] got state: %u\n", (u8)m_state);
 
-    if (m_source) {
-        log_write("[Menu::OnInstallStart] we have source\n");
-        for (;;) {
-            {
-                SCOPED_MUTEX(&m_source->m_mutex);
-
-                if (!m_source->m_active && INSTALL_STATE != InstallState::Progress) {
-                    break;
-                }
-
-                if (GetToken().stop_requested()) {
-                    return false;
-                }
-            }
-
-            svcSleepThread(1e+6);
-        }
-
-        log_write("[Menu::OnInstallStart] stopped polling source\n");
-    }
-
-    SCOPED_MUTEX(&m_mutex);
-
     m_source = std::make_unique<Stream>(path, GetToken());
     INSTALL_STATE = InstallState::None;
     m_state = State::Connected;
@@ -267,8 +292,9 @@ void Menu::OnInstallClose() {
     m_source->Disable();
 
     // wait until the install has finished before returning.
-    while (INSTALL_STATE == InstallState::Progress) {
-        svcSleepThread(1e+7);
+    SCOPED_MUTEX(&m_mutex);
+    while (INSTALL_STATE == InstallState::Progress && !GetToken().stop_requested()) {
+        condvarWaitTimeout(&m_state_changed, &m_mutex, WAIT_TIMEOUT);
     }
 }
 
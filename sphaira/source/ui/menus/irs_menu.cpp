@@ -9,6 +9,10 @@
 #include <cstring>
 #include <array>
 
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
 namespace sphaira::ui::menu::irs {
 namespace {
 
@@ -362,11 +366,23 @@ void Menu::ResetImage() {
         nvgDeleteImage(App::GetVg(), m_image);
         m_image = 0;
     }
+    m_image_width = 0;
+    m_image_height = 0;
 }
 
 void Menu::UpdateImage() {
+    // the image only needs creating again if the format changed.
+    if (m_image && m_image_width == m_irs_width && m_image_height == m_irs_height) {
+        nvgUpdateImage(App::GetVg(), m_image, (const unsigned char*)m_rgba.data());
+        return;
+    }
+
     ResetImage();
     m_image = nvgCreateImageRGBA(App::GetVg(), m_irs_width, m_irs_height, NVG_IMAGE_NEAREST, (const unsigned char*)m_rgba.data());
+    if (m_image) {
+        m_image_width = m_irs_width;
+        m_image_height = m_irs_height;
+    }
 }
 
 void Menu::LoadDefaultConfig() {
@@ -500,33 +516,43 @@ void Menu::UpdateConfig(const IrsImageTransferProcessorExConfig* config) {
 }
 
 void Menu::updateColourArray() {
-    const auto ir_width = m_irs_width;
-    const auto ir_height = m_irs_height;
-    const auto colour = m_colour;
-
-    for (u32 y = 0; y < ir_height; y++) {
-        for (u32 x = 0; x < ir_width; x++) {
-            const u32 pos = y * ir_width + x;
-            const u32 pos2 = y * ir_width + x;
-
-            switch (colour) {
-                case Colour_Grey:
-                    m_rgba[pos] = RGBA8_MAXALPHA(m_irs_buffer[pos2], m_irs_buffer[pos2], m_irs_buffer[pos2]);
-                    break;
-                case Colour_Ironbow:
-                    m_rgba[pos] = iron_palette[m_irs_buffer[pos2]];
-                    break;
-                case Colour_Green:
-                    m_rgba[pos] = RGBA8_MAXALPHA(0, m_irs_buffer[pos2], 0);
-                    break;
-                case Colour_Red:
-                    m_rgba[pos] = RGBA8_MAXALPHA(m_irs_buffer[pos2], 0, 0);
-                    break;
-                case Colour_Blue:
-                    m_rgba[pos] = RGBA8_MAXALPHA(0, 0, m_irs_buffer[pos2]);
-                    break;
-            }
+    const auto count = m_irs_width * m_irs_height;
+    const auto src = m_irs_buffer.data();
+    const auto dst = m_rgba.data();
+
+    // the palette is a lookup per pixel, so it's not vectorised.
+    if (m_colour == Colour_Ironbow) {
+        for (u32 i = 0; i < count; i++) {
+            dst[i] = iron_palette[src[i]];
         }
+        UpdateImage();
+        return;
+    }
+
+    // which of the rgb channels the intensity is written to.
+    const bool r = m_colour == Colour_Grey || m_colour == Colour_Red;
+    const bool g = m_colour == Colour_Grey || m_colour == Colour_Green;
+    const bool b = m_colour == Colour_Grey || m_colour == Colour_Blue;
+
+    u32 i = 0;
+#if defined(__ARM_NEON)
+    // 16 pixels at a time, stored interleaved as rgba.
+    const auto zero = vdupq_n_u8(0);
+    const auto alpha = vdupq_n_u8(0xFF);
+    for (; i + 16 <= count; i += 16) {
+        const auto v = vld1q_u8(src + i);
+        uint8x16x4_t out;
+        out.val[0] = r ? v : zero;
+        out.val[1] = g ? v : zero;
+        out.val[2] = b ? v : zero;
+        out.val[3] = alpha;
+        vst4q_u8((u8*)(dst + i), out);
+    }
+#endif
+
+    for (; i < count; i++) {
+        const auto v = src[i];
+        dst[i] = RGBA8_MAXALPHA(r ? v : 0, g ? v : 0, b ? v : 0);
     }
 
     UpdateImage();
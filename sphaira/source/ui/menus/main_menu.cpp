@@ -18,6 +18,7 @@
 #include "ui/menus/game_menu.hpp"
 #include "ui/menus/save_menu.hpp"
 #include "ui/menus/appstore.hpp"
+#include "ui/menus/bench_menu.hpp"
 
 #include "app.hpp"
 #include "log.hpp"
@@ -25,6 +26,8 @@
 #include "defines.hpp"
 #include "i18n.hpp"
 #include "threaded_file_transfer.hpp"
+#include "swkbd.hpp"
+#include "yati/yati.hpp"
 
 #include <cstring>
 #include <yyjson.h>
@@ -35,6 +38,7 @@ namespace {
 
 constexpr const char* GITHUB_URL{"https://api.github.com/repos/ITotalJustice/sphaira/releases/latest"};
 constexpr fs::FsPath CACHE_PATH{"/switch/sphaira/cache/sphaira_latest.json"};
+constexpr const char* APPSTORE_URL{"https://switch.cdn.fortheusers.org/repo.json"};
 
 // paths where sphaira can be installed, used when updating
 constexpr const fs::FsPath SPHAIRA_PATHS[]{
@@ -49,61 +53,65 @@ auto MiscMenuFuncGenerator(u32 flags) {
 }
 
 const MiscMenuEntry MISC_MENU_ENTRIES[] = {
-    { .name = "Homebrew", .title = "Homebrew", .func = MiscMenuFuncGenerator<ui::menu::homebrew::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "Homebrew", .title = "Homebrew", .short_title = "Apps", .func = MiscMenuFuncGenerator<ui::menu::homebrew::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "The homebrew menu.\n\n"
         "Allows you to launch, delete and mount homebrew!"},
 
-    { .name = "Appstore", .title = "Appstore", .func = MiscMenuFuncGenerator<ui::menu::appstore::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "Appstore", .title = "Appstore", .short_title = "Store", .func = MiscMenuFuncGenerator<ui::menu::appstore::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "Download and update apps.\n\n"
         "Internet connection required." },
 
-    { .name = "Games", .title = "Games", .func = MiscMenuFuncGenerator<ui::menu::game::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "Games", .title = "Games", .short_title = "Games", .func = MiscMenuFuncGenerator<ui::menu::game::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "View all installed games. "
         "In this menu you can launch, backup, create savedata and much more." },
 
-    { .name = "FileBrowser", .title = "FileBrowser", .func = MiscMenuFuncGenerator<ui::menu::filebrowser::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "FileBrowser", .title = "FileBrowser", .short_title = "Files", .func = MiscMenuFuncGenerator<ui::menu::filebrowser::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "Browse files on you SD Card. "
         "You can move, copy, delete, extract zip, create zip, upload and much more.\n\n"
         "A connected USB/HDD can be opened by mounting it in the advanced options." },
 
-    { .name = "Saves", .title = "Saves", .func = MiscMenuFuncGenerator<ui::menu::save::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "Saves", .title = "Saves", .short_title = "Saves", .func = MiscMenuFuncGenerator<ui::menu::save::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "View save data for each user. "
         "You can backup and restore saves.\n\n"
         "Experimental support for backing up system saves is possible." },
 
 #if 0
-    { .name = "Themezer", .title = "Themezer", .func = MiscMenuFuncGenerator<ui::menu::themezer::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "Themezer", .title = "Themezer", .short_title = "Themezer", .func = MiscMenuFuncGenerator<ui::menu::themezer::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "Download themes from themezer.net. "
         "Themes are downloaded to /themes/sphaira\n"
         "To install the themes, NXThemesInstaller needs to be installed (can be downloaded via the AppStore)." },
 #endif
 
-    { .name = "GitHub", .title = "GitHub", .func = MiscMenuFuncGenerator<ui::menu::gh::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "GitHub", .title = "GitHub", .short_title = "GitHub", .func = MiscMenuFuncGenerator<ui::menu::gh::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "Download releases directly from GitHub. "
         "Custom entries can be added to /config/sphaira/github" },
 
 #ifdef ENABLE_FTPSRV
-    { .name = "FTP", .title = "FTP Install", .func = MiscMenuFuncGenerator<ui::menu::ftp::Menu>, .flag = MiscMenuFlag_Install, .info =
+    { .name = "FTP", .title = "FTP Install", .short_title = "FTP", .func = MiscMenuFuncGenerator<ui::menu::ftp::Menu>, .flag = MiscMenuFlag_Install, .info =
         "Install apps via FTP." },
 #endif // ENABLE_FTPSRV
 
 #ifdef ENABLE_LIBHAZE
-    { .name = "MTP", .title = "MTP Install", .func = MiscMenuFuncGenerator<ui::menu::mtp::Menu>, .flag = MiscMenuFlag_Install, .info =
+    { .name = "MTP", .title = "MTP Install", .short_title = "MTP", .func = MiscMenuFuncGenerator<ui::menu::mtp::Menu>, .flag = MiscMenuFlag_Install, .info =
         "Install apps via MTP." },
 #endif // ENABLE_LIBHAZE
 
-    { .name = "USB", .title = "USB Install", .func = MiscMenuFuncGenerator<ui::menu::usb::Menu>, .flag = MiscMenuFlag_Install, .info =
+    { .name = "USB", .title = "USB Install", .short_title = "USB", .func = MiscMenuFuncGenerator<ui::menu::usb::Menu>, .flag = MiscMenuFlag_Install, .info =
         "Install apps via USB.\n\n"
         "A USB client is required on PC." },
 
-    { .name = "GameCard", .title = "GameCard", .func = MiscMenuFuncGenerator<ui::menu::gc::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "GameCard", .title = "GameCard", .short_title = "GC", .func = MiscMenuFuncGenerator<ui::menu::gc::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "View info on the inserted Game Card (GC). "
         "You can backup and install the inserted GC. "
         "To swap GC's, simply remove the old GC and insert the new one. "
         "You do not need to exit the menu." },
 
-    { .name = "IRS", .title = "IRS (Infrared Joycon Camera)", .func = MiscMenuFuncGenerator<ui::menu::irs::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+    { .name = "IRS", .title = "IRS (Infrared Joycon Camera)", .short_title = "IRS", .func = MiscMenuFuncGenerator<ui::menu::irs::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
         "InfraRed Sensor (IRS) is the small camera found on right JoyCon." },
+
+    { .name = "Benchmarks", .title = "Benchmarks", .short_title = "Benchmarks", .func = MiscMenuFuncGenerator<ui::menu::bench::Menu>, .flag = MiscMenuFlag_Shortcut, .info =
+        "Measures storage, network, decompression, crypto and hashing speeds. "
+        "Results are saved to /switch/sphaira/bench/" },
 };
 
 auto InstallUpdate(ProgressBox* pbox, const std::string url, const std::string version) -> Result {
@@ -120,7 +128,8 @@ auto InstallUpdate(ProgressBox* pbox, const std::string url, const std::string v
         const auto result = curl::Api().ToFile(
             curl::Url{url},
             curl::Path{zip_out},
-            curl::OnProgress{pbox->OnDownloadProgressCallback()}
+            curl::OnProgress{pbox->OnDownloadProgressCallback()},
+            curl::Flags{curl::Flag_Segmented}
         );
 
         R_UNLESS(result.success, Result_MainFailedToDownloadUpdate);
@@ -167,67 +176,65 @@ auto InstallUpdate(ProgressBox* pbox, const std::string url, const std::string v
     R_SUCCEED();
 }
 
-auto CreateCenterMenu(std::string& name_out) -> std::unique_ptr<MenuBase> {
-    const auto name = App::GetApp()->m_center_menu.Get();
-
+auto FindMenuEntry(std::string_view name) -> const MiscMenuEntry* {
     for (auto& e : GetMenuMenuEntries()) {
         if (e.name == name) {
-            name_out = name;
-            return e.func(MenuFlag_Tab);
+            return &e;
         }
     }
 
-    name_out = "Homebrew";
-    return std::make_unique<ui::menu::homebrew::Menu>(MenuFlag_Tab);
+    return nullptr;
+}
+
+auto GetCenterMenu() -> const MiscMenuEntry* {
+    if (auto e = FindMenuEntry(App::GetApp()->m_center_menu.Get())) {
+        return e;
+    }
+
+    return FindMenuEntry("Homebrew");
 }
 
-auto CreateLeftSideMenu(std::string_view center_name, std::string& name_out) -> std::unique_ptr<MenuBase> {
+auto GetLeftSideMenu(std::string_view center_name) -> const MiscMenuEntry* {
     const auto name = App::GetApp()->m_left_menu.Get();
 
     // handle if the user tries to mount the same menu twice.
     if (name == center_name) {
         // check if we can mount the default.
         if (center_name != "FileBrowser") {
-            return std::make_unique<ui::menu::filebrowser::Menu>(MenuFlag_Tab);
+            return FindMenuEntry("FileBrowser");
         } else {
             // otherwise, fallback to center default.
-            return std::make_unique<ui::menu::homebrew::Menu>(MenuFlag_Tab);
+            return FindMenuEntry("Homebrew");
         }
     }
 
-    for (auto& e : GetMenuMenuEntries()) {
-        if (e.name == name) {
-            name_out = name;
-            return e.func(MenuFlag_Tab);
-        }
+    if (auto e = FindMenuEntry(name)) {
+        return e;
     }
 
-    name_out = "FileBrowser";
-    return std::make_unique<ui::menu::filebrowser::Menu>(MenuFlag_Tab);
+    return FindMenuEntry("FileBrowser");
 }
 
 // todo: handle center / left menu being the same.
-auto CreateRightSideMenu(std::string_view left_name) -> std::unique_ptr<MenuBase> {
+auto GetRightSideMenu(std::string_view left_name) -> const MiscMenuEntry* {
     const auto name = App::GetApp()->m_right_menu.Get();
 
     // handle if the user tries to mount the same menu twice.
     if (name == left_name) {
         // check if we can mount the default.
-        if (left_name != "AppStore") {
-            return std::make_unique<ui::menu::appstore::Menu>(MenuFlag_Tab);
+        if (left_name != "Appstore") {
+            return FindMenuEntry("Appstore");
         } else {
             // otherwise, fallback to left side default.
-            return std::make_unique<ui::menu::filebrowser::Menu>(MenuFlag_Tab);
+            return FindMenuEntry("FileBrowser");
         }
     }
 
-    for (auto& e : GetMenuMenuEntries()) {
-        if (e.name == name) {
-            return e.func(MenuFlag_Tab);
-        }
+    if (auto e = FindMenuEntry(name)) {
+        return e;
     }
 
-    return std::make_unique<ui::menu::appstore::Menu>(MenuFlag_Tab);
+    return FindMenuEntry("Appstore");
 }
 
 } // namespace
@@ -368,6 +375,25 @@ MainMenu::MainMenu() {
                     });
                 }
 
+                auto install_url = options->Add<SidebarEntryCallback>("Install from URL"_i18n, [](){
+                    std::string out;
+                    if (R_FAILED(swkbd::ShowText(out, "Install from URL"_i18n.c_str(), "Enter the url of the file to install"_i18n.c_str(), "https://")) || out.empty()) {
+                        return;
+                    }
+
+                    App::PopToMenu();
+                    App::Push<ProgressBox>(0, "Installing "_i18n, out, [out](auto pbox) -> Result {
+                        return yati::InstallFromUrl(pbox, out);
+                    }, [out](Result rc){
+                        App::PushErrorBox(rc, "File install failed!"_i18n);
+
+                        if (R_SUCCEEDED(rc)) {
+                            App::Notify(i18n::Reorder("Installed ", out));
+                        }
+                    });
+                }, "Installs a nsp, nsz, xci or xcz straight from a http(s) url, without downloading it to the SD card first."_i18n);
+                install_url->Depends(App::GetInstallEnable, i18n::get(App::INSTALL_DEPENDS_STR), App::ShowEnableInstallPrompt);
+
                 options->Add<SidebarEntryCallback>("FTP"_i18n, [](){ App::DisplayFtpOptions(); },
                     i18n::get("ftp_settings_info",
                         "Enable / modify the FTP server settings such as port, user/pass and the folders that are shown.\n\n"
@@ -415,20 +441,27 @@ MainMenu::MainMenu() {
         }}
     ));
 
-    std::string center_name;
-    m_centre_menu = CreateCenterMenu(center_name);
+    // only the visible tab is created here, the side tabs are created the
+    // first time they're switched to, as most menus start loading on create.
+    const auto center_entry = GetCenterMenu();
+    m_centre_menu = center_entry->func(MenuFlag_Tab);
     m_current_menu = m_centre_menu.get();
 
-    std::string left_side_name;
-    m_left_menu = CreateLeftSideMenu(center_name, left_side_name);
-
-    m_right_menu = CreateRightSideMenu(left_side_name);
+    m_left_menu.entry = GetLeftSideMenu(center_entry->name);
+    m_right_menu.entry = GetRightSideMenu(m_left_menu.entry->name);
 
     AddOnLRPress();
 
     for (auto [button, action] : m_actions) {
         m_current_menu->SetAction(button, action);
     }
+
+    // the update check above already connects to github.
+    for (const auto e : { center_entry, m_left_menu.entry, m_right_menu.entry }) {
+        if (!std::strcmp(e->name, "Appstore")) {
+            curl::PrewarmAsync(APPSTORE_URL);
+        }
+    }
 }
 
 MainMenu::~MainMenu() {
@@ -453,10 +486,10 @@ void MainMenu::OnFocusLost() {
     m_current_menu->OnFocusLost();
 }
 
-void MainMenu::OnLRPress(MenuBase* menu, Button b) {
+void MainMenu::OnLRPress(TabMenu& menu, Button b) {
     m_current_menu->OnFocusLost();
     if (m_current_menu == m_centre_menu.get()) {
-        m_current_menu = menu;
+        m_current_menu = menu.Get();
         RemoveAction(b);
     } else {
         m_current_menu = m_centre_menu.get();
@@ -471,19 +504,26 @@ void MainMenu::OnLRPress(MenuBase* menu, Button b) {
 }
 
 void MainMenu::AddOnLRPress() {
-    if (m_current_menu != m_left_menu.get()) {
-        const auto label = m_current_menu == m_centre_menu.get() ? m_left_menu->GetShortTitle() : m_centre_menu->GetShortTitle();
+    if (m_current_menu != m_left_menu.menu.get()) {
+        const auto label = m_current_menu == m_centre_menu.get() ? m_left_menu.entry->short_title : m_centre_menu->GetShortTitle();
         SetAction(Button::L, Action{i18n::get(label), [this]{
-            OnLRPress(m_left_menu.get(), Button::L);
+            OnLRPress(m_left_menu, Button::L);
         }});
     }
 
-    if (m_current_menu != m_right_menu.get()) {
-        const auto label = m_current_menu == m_centre_menu.get() ? m_right_menu->GetShortTitle() : m_centre_menu->GetShortTitle();
+    if (m_current_menu != m_right_menu.menu.get()) {
+        const auto label = m_current_menu == m_centre_menu.get() ? m_right_menu.entry->short_title : m_centre_menu->GetShortTitle();
         SetAction(Button::R, Action{i18n::get(label), [this]{
-            OnLRPress(m_right_menu.get(), Button::R);
+            OnLRPress(m_right_menu, Button::R);
         }});
     }
 }
 
+auto MainMenu::TabMenu::Get() -> MenuBase* {
+    if (!menu) {
+        menu = entry->func(MenuFlag_Tab);
+    }
+    return menu.get();
+}
+
 } // namespace sphaira::ui::menu::main
@@ -6,12 +6,16 @@
 #include "i18n.hpp"
 #include "location.hpp"
 #include "image.hpp"
+#include "image_decode.hpp"
 #include "threaded_file_transfer.hpp"
 #include "minizip_helper.hpp"
 #include "dumper.hpp"
 #include "swkbd.hpp"
 
 #include "utils/devoptab.hpp"
+#include "utils/thread.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/utils.hpp"
 
 #include "ui/menus/save_menu.hpp"
 #include "ui/menus/filebrowser.hpp"
@@ -41,6 +45,9 @@ constexpr u32 NX_SAVE_META_MAGIC = 0x4A4B5356; // JKSV
 constexpr u32 NX_SAVE_META_VERSION = 1;
 constexpr const char* NX_SAVE_META_NAME = ".nx_save_meta.bin";
 
+// number of saves read per frame.
+constexpr s64 ENTRY_BATCH_COUNT = 64;
+
 std::atomic_bool g_change_signalled{};
 
 struct DumpSource final : dump::BaseSource {
@@ -67,11 +74,14 @@ struct DumpSource final : dump::BaseSource {
     }
 
     auto GetEntry(const std::string& path) const -> Entry& {
+        return m_entries[GetIndex(path)];
+    }
+
+    auto GetIndex(const std::string& path) const -> s64 {
         const auto itr = std::ranges::find_if(m_paths, [&path](auto& e){
             return path == e;
         });
-        const auto index = std::distance(m_paths.begin(), itr);
-        return m_entries[index];
+        return std::distance(m_paths.begin(), itr);
     }
 
 private:
@@ -95,6 +105,254 @@ struct NXSaveMeta {
 };
 static_assert(sizeof(NXSaveMeta) == 128);
 
+// incremental backups split each file into fixed size chunks, which are stored
+// once in a store shared by every save, named by their sha256.
+// each backup is then a manifest listing the chunks of every file, so only
+// chunks that changed since any previous backup are written.
+constexpr u32 SAVE_MANIFEST_MAGIC = 0x4D535053; // SPSM
+constexpr u32 SAVE_MANIFEST_VERSION = 1;
+constexpr const char* SAVE_MANIFEST_EXT = ".manifest";
+constexpr const char* SAVE_STORE_PATH = "/dumps/Save Store";
+constexpr s64 SAVE_CHUNK_SIZE = 1024 * 1024;
+// upper limit of the chunk size read from a manifest.
+constexpr s64 SAVE_CHUNK_SIZE_MAX = 1024 * 1024 * 16;
+
+struct SaveManifestHeader {
+    u32 magic{}; // SAVE_MANIFEST_MAGIC
+    u32 version{}; // SAVE_MANIFEST_VERSION
+    u32 chunk_size{};
+    u32 file_count{};
+    NXSaveMeta meta{};
+};
+
+// followed by the path (not null terminated) and then chunk_count sha256 hashes.
+struct SaveManifestFile {
+    s64 size{};
+    u32 path_len{};
+    u32 chunk_count{};
+};
+
+struct SaveManifestEntry {
+    fs::FsPath path{};
+    s64 size{};
+    const u8* hashes{};
+    u32 chunk_count{};
+};
+
+auto IsSaveManifest(std::string_view path) -> bool {
+    return path.ends_with(SAVE_MANIFEST_EXT);
+}
+
+auto BuildChunkPath(const fs::FsPath& store, const u8* hash) -> fs::FsPath {
+    char hex[SHA256_HASH_SIZE * 2 + 1];
+    for (u32 i = 0; i < SHA256_HASH_SIZE; i++) {
+        std::snprintf(hex + i * 2, 3, "%02x", hash[i]);
+    }
+
+    // split by the first byte so that no folder ends up with too many files.
+    fs::FsPath path;
+    std::snprintf(path, sizeof(path), "%s/%.2s/%s", store.s, hex, hex);
+    return path;
+}
+
+// opens the fs for a sd card or stdio location, mount is prepended to all paths.
+Result OpenLocationFs(const dump::DumpLocation& location, std::unique_ptr<fs::Fs>& fs, fs::FsPath& mount) {
+    if (location.entry.type == dump::DumpLocationType_Stdio) {
+        mount = fs::AppendPath(location.stdio[location.entry.index].mount, location.stdio[location.entry.index].dump_path);
+        fs = std::make_unique<fs::FsStdio>(true, location.stdio[location.entry.index].mount);
+    } else if (location.entry.type == dump::DumpLocationType_SdCard) {
+        mount = {};
+        fs = std::make_unique<fs::FsNativeSd>();
+    } else {
+        R_THROW(MAKERESULT(Module_Libnx, LibnxError_BadInput));
+    }
+
+    R_SUCCEED();
+}
+
+// parses and validates the whole manifest, entries point into data.
+Result ParseSaveManifest(std::span<const u8> data, SaveManifestHeader& header, std::vector<SaveManifestEntry>& entries) {
+    R_UNLESS(data.size() >= sizeof(header), Result_SaveManifestInvalid);
+    std::memcpy(&header, data.data(), sizeof(header));
+    R_UNLESS(header.magic == SAVE_MANIFEST_MAGIC, Result_SaveManifestInvalid);
+    R_UNLESS(header.version == SAVE_MANIFEST_VERSION, Result_SaveManifestInvalid);
+    R_UNLESS(header.chunk_size && header.chunk_size <= SAVE_CHUNK_SIZE_MAX, Result_SaveManifestInvalid);
+
+    u64 off = sizeof(header);
+    for (u32 i = 0; i < header.file_count; i++) {
+        SaveManifestFile file;
+        R_UNLESS(data.size() - off >= sizeof(file), Result_SaveManifestInvalid);
+        std::memcpy(&file, data.data() + off, sizeof(file));
+        off += sizeof(file);
+
+        R_UNLESS(file.size >= 0, Result_SaveManifestInvalid);
+        R_UNLESS(file.path_len && file.path_len < sizeof(fs::FsPath), Result_SaveManifestInvalid);
+        R_UNLESS(file.chunk_count == (file.size + header.chunk_size - 1) / header.chunk_size, Result_SaveManifestInvalid);
+        R_UNLESS(data.size() - off >= file.path_len + u64(file.chunk_count) * SHA256_HASH_SIZE, Result_SaveManifestInvalid);
+
+        auto& e = entries.emplace_back();
+        std::memcpy(e.path.s, data.data() + off, file.path_len);
+        off += file.path_len;
+
+        e.size = file.size;
+        e.chunk_count = file.chunk_count;
+        e.hashes = data.data() + off;
+        off += u64(file.chunk_count) * SHA256_HASH_SIZE;
+    }
+
+    R_SUCCEED();
+}
+
+// a save that has been mounted and listed, ready to be backed up.
+struct PreparedSave {
+    Result rc{};
+    FsSaveDataExtraData extra{};
+    std::unique_ptr<fs::FsNativeSave> save_fs{};
+    filebrowser::FsDirCollections collections{};
+};
+
+Result PrepareSave(const Entry& e, PreparedSave& out) {
+    const auto save_data_space_id = (FsSaveDataSpaceId)e.save_data_space_id;
+
+    // try and get the journal and data size.
+    R_TRY(fsReadSaveDataFileSystemExtraDataBySaveDataSpaceId(&out.extra, sizeof(out.extra), save_data_space_id, e.save_data_id));
+
+    FsSaveDataAttribute attr{};
+    attr.application_id = e.application_id;
+    attr.uid = e.uid;
+    attr.system_save_data_id = e.system_save_data_id;
+    attr.save_data_type = e.save_data_type;
+    attr.save_data_rank = e.save_data_rank;
+    attr.save_data_index = e.save_data_index;
+
+    // try and open the save file system
+    out.save_fs = std::make_unique<fs::FsNativeSave>((FsSaveDataType)e.save_data_type, save_data_space_id, &attr, true);
+    R_TRY(out.save_fs->GetFsOpenResult());
+
+    // get a list of collections.
+    return filebrowser::FsView::get_collections(out.save_fs.get(), "/", "", out.collections);
+}
+
+// mounts and lists the next saves on a thread while the current one is zipped,
+// so that mounting isn't on the critical path of every save.
+struct SavePrefetcher final {
+    // max number of saves mounted ahead of the one that was last requested.
+    static constexpr s64 MAX_AHEAD = 2;
+
+    SavePrefetcher(std::span<const std::reference_wrapper<Entry>> entries) : m_entries{entries}, m_saves(entries.size()) {
+        mutexInit(&m_mutex);
+        condvarInit(&m_can_get);
+        condvarInit(&m_can_prepare);
+
+        // nothing to overlap with a single save.
+        if (m_entries.size() <= 1) {
+            return;
+        }
+
+        if (R_FAILED(utils::CreateThread(&m_thread, ThreadFunc, this))) {
+            log_write("[SAVE] failed to create prefetch thread\n");
+            return;
+        }
+
+        if (R_FAILED(threadStart(&m_thread))) {
+            log_write("[SAVE] failed to start prefetch thread\n");
+            threadClose(&m_thread);
+            return;
+        }
+
+        m_running = true;
+    }
+
+    ~SavePrefetcher() {
+        if (m_running) {
+            {
+                SCOPED_MUTEX(&m_mutex);
+                m_quit = true;
+                condvarWakeAll(&m_can_prepare);
+            }
+
+            threadWaitForExit(&m_thread);
+            threadClose(&m_thread);
+        }
+    }
+
+    // blocks until the save is ready, ownership is moved to out.
+    Result Get(s64 index, PreparedSave& out) {
+        // fallback to mounting on demand.
+        if (!m_running) {
+            return PrepareSave(m_entries[index], out);
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        m_wanted = index;
+        condvarWakeAll(&m_can_prepare);
+
+        while (m_next <= index) {
+            condvarWait(&m_can_get, &m_mutex);
+        }
+
+        out = std::move(m_saves[index]);
+        return out.rc;
+    }
+
+private:
+    static void ThreadFunc(void* arg) {
+        static_cast<SavePrefetcher*>(arg)->Loop();
+    }
+
+    void Loop() {
+        const auto count = (s64)m_entries.size();
+
+        for (;;) {
+            s64 index;
+            {
+                SCOPED_MUTEX(&m_mutex);
+                while (!m_quit && m_next < count && m_next > m_wanted + MAX_AHEAD) {
+                    condvarWait(&m_can_prepare, &m_mutex);
+                }
+
+                if (m_quit || m_next >= count) {
+                    return;
+                }
+
+                index = m_next;
+            }
+
+            // mounting is done unlocked, the slot isn't touched by Get() until m_next moves past it.
+            PreparedSave save{};
+            save.rc = PrepareSave(m_entries[index], save);
+
+            SCOPED_MUTEX(&m_mutex);
+            m_saves[index] = std::move(save);
+            m_next++;
+            condvarWakeAll(&m_can_get);
+        }
+    }
+
+private:
+    std::span<const std::reference_wrapper<Entry>> m_entries;
+    std::vector<PreparedSave> m_saves;
+    Mutex m_mutex{};
+    CondVar m_can_get{};
+    CondVar m_can_prepare{};
+    Thread m_thread{};
+    s64 m_next{};
+    s64 m_wanted{};
+    bool m_running{};
+    bool m_quit{};
+};
+
+void SetProgressEntry(ProgressBox* pbox, const Entry& e) {
+    pbox->SetTitle(e.GetName());
+    if (e.image) {
+        pbox->SetImage(e.image);
+    } else if (auto data = title::Get(e.application_id); data && !data->icon.empty()) {
+        pbox->SetImageDataConst(data->icon);
+    } else {
+        pbox->SetImage(0);
+    }
+}
+
 void GetFsSaveAttr(const AccountProfileBase& acc, u8 data_type, FsSaveDataSpaceId& space_id, FsSaveDataFilter& filter) {
     std::memset(&filter, 0, sizeof(filter));
 
@@ -125,6 +383,31 @@ void GetFsSaveAttr(const AccountProfileBase& acc, u8 data_type, FsSaveDataSpaceI
     }
 }
 
+auto GetSaveAttr(const FsSaveDataInfo& e) -> FsSaveDataAttribute {
+    FsSaveDataAttribute attr{};
+    attr.application_id = e.application_id;
+    attr.uid = e.uid;
+    attr.system_save_data_id = e.system_save_data_id;
+    attr.save_data_type = e.save_data_type;
+    attr.save_data_rank = e.save_data_rank;
+    attr.save_data_index = e.save_data_index;
+    return attr;
+}
+
+// returns the space used by the files in the save, or the size of the save
+// if it can't be mounted, ie, it's in use by the running game.
+auto GetUsedSize(const FsSaveDataInfo& e) -> s64 {
+    const auto attr = GetSaveAttr(e);
+    fs::FsNativeSave save_fs{(FsSaveDataType)e.save_data_type, (FsSaveDataSpaceId)e.save_data_space_id, &attr, true};
+
+    s64 total, free;
+    if (R_SUCCEEDED(save_fs.GetFsOpenResult()) && R_SUCCEEDED(save_fs.GetTotalSpace("/", &total)) && R_SUCCEEDED(save_fs.GetFreeSpace("/", &free))) {
+        return total - free;
+    }
+
+    return e.size;
+}
+
 auto GetSaveFolder(u8 data_type) -> fs::FsPath {
     switch (data_type) {
         case FsSaveDataType_System:     return "Save System";
@@ -313,12 +596,22 @@ auto BuildSaveBasePath(const Entry& e, bool force_id_path = false) -> fs::FsPath
 }
 
 void FreeEntry(NVGcontext* vg, Entry& e) {
-    nvgDeleteImage(vg, e.image);
+    gfx::deleteImage(vg, e.image);
     e.image = 0;
+    e.image_request.reset();
 }
 
 } // namespace
 
+// results of the size tasks, shared with the task pool so that the tasks can
+// outlive the menu.
+struct SizeQueue {
+    Mutex mutex{};
+    std::vector<std::pair<u64, s64>> done{};
+    // set once the results are no longer wanted.
+    std::atomic_bool exit{};
+};
+
 void SignalChange() {
     g_change_signalled = true;
 }
@@ -394,6 +687,11 @@ Menu::Menu(u32 flags) : grid::Menu{"Saves"_i18n, flags} {
 Menu::~Menu() {
     title::Exit();
 
+    CloseReader();
+    if (m_size_queue) {
+        m_size_queue->exit = true;
+    }
+
     FreeEntries();
     ns::Exit();
 }
@@ -408,6 +706,9 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
         SortAndFindLastFile(true);
     }
 
+    ReadBatch();
+    UpdateSizes();
+
     MenuBase::Update(controller, touch);
     m_list->OnUpdate(controller, touch, m_index, m_entries.size(), [this](bool touch, auto i) {
         if (touch && m_index == i) {
@@ -427,37 +728,49 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
         return;
     }
 
-    // max images per frame, in order to not hit io / gpu too hard.
-    const int image_load_max = 2;
-    int image_load_count = 0;
-
-    m_list->Draw(vg, theme, m_entries.size(), [this, &image_load_count](auto* vg, auto* theme, auto v, auto pos) {
+    m_list->Draw(vg, theme, m_entries.size(), [this](auto* vg, auto* theme, auto v, auto pos) {
         const auto& [x, y, w, h] = v;
         auto& e = m_entries[pos];
 
+        // entries closest to the selected entry are loaded first.
         if (e.status == title::NacpLoadStatus::None) {
             if (m_data_type != FsSaveDataType_System && m_data_type != FsSaveDataType_SystemBcat) {
-                title::PushAsync(e.application_id);
+                title::PushAsync(e.application_id, std::abs(pos - m_index));
                 e.status = title::NacpLoadStatus::Progress;
             } else {
                 FakeNacpEntryForSystem(e);
             }
         } else if (e.status == title::NacpLoadStatus::Progress) {
             LoadResultIntoEntry(e, title::GetAsync(e.application_id));
+            if (e.status == title::NacpLoadStatus::Progress) {
+                title::PushAsync(e.application_id, std::abs(pos - m_index));
+            }
         }
 
-        // lazy load image
-        if (image_load_count < image_load_max) {
-            if (LoadControlImage(e, title::GetAsync(e.application_id))) {
-                image_load_count++;
+        // lazy load image, icons closest to the selected entry are decoded first.
+        // the thumbnail is keyed on the hash of the icon.
+        const image::Thumb thumb{0, GetThumbSize(m_layout.Get())};
+        image::LoadAsync(e.image_request, e.image, std::abs(pos - m_index), ImageFlag_JPEG, thumb, [&e]() -> image::Loader {
+            const auto result = title::GetAsync(e.application_id);
+            if (!result || result->icon.empty()) {
+                return {};
             }
+
+            return [icon = result->icon]() mutable {
+                return std::move(icon);
+            };
+        });
+
+        std::string size_str;
+        if (m_sort.Get() == SortType_Size) {
+            size_str = e.used_size >= 0 ? utils::formatSizeStorage(e.used_size) : "...";
         }
 
         const auto selected = pos == m_index;
         if (m_data_type != FsSaveDataType_System && m_data_type != FsSaveDataType_SystemBcat) {
-            DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), "");
+            DrawEntry(vg, theme, m_layout.Get(), v, selected, e.image, e.GetName(), e.GetAuthor(), size_str.c_str());
         } else {
-            const auto image_vec = DrawEntryNoImage(vg, theme, m_layout.Get(), v, selected, e.GetName(), e.GetAuthor(), "");
+            const auto image_vec = DrawEntryNoImage(vg, theme, m_layout.Get(), v, selected, e.GetName(), e.GetAuthor(), size_str.c_str());
             gfx::drawRect(vg, v, theme->GetColour(ThemeEntryID_GRID), 5);
             gfx::drawTextArgs(vg, image_vec.x + image_vec.w / 2, image_vec.y + image_vec.w / 2, 20, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(selected ? ThemeEntryID_TEXT_SELECTED : ThemeEntryID_TEXT), GetSystemSaveName(e.system_save_data_id));
         }
@@ -505,16 +818,20 @@ void Menu::SetIndex(s64 index) {
 }
 
 void Menu::ScanHomebrew() {
-    constexpr auto ENTRY_CHUNK_COUNT = 1000;
-    TimeStamp ts;
-
     g_change_signalled = false;
+    CloseReader();
     FreeEntries();
     ClearSelection();
-    m_entries.reserve(ENTRY_CHUNK_COUNT);
-    m_is_reversed = false;
+    m_index = 0;
     m_dirty = false;
 
+    // results for the old list are dropped.
+    if (m_size_queue) {
+        m_size_queue->exit = true;
+    }
+    m_size_queue = std::make_shared<SizeQueue>();
+    m_size_pending = 0;
+
     if (m_accounts.empty()) {
         return;
     }
@@ -523,55 +840,143 @@ void Menu::ScanHomebrew() {
     FsSaveDataFilter filter;
     GetFsSaveAttr(m_accounts[m_account_index], m_data_type, space_id, filter);
 
-    FsSaveDataInfoReader reader;
-    if (R_FAILED(fsOpenSaveDataInfoReaderWithFilter(&reader, space_id, &filter))) {
+    m_scan_ts = {};
+    if (R_FAILED(fsOpenSaveDataInfoReaderWithFilter(&m_reader, space_id, &filter))) {
         log_write("[SAVE] failed to open reader\n");
+    } else {
+        m_reader_open = true;
     }
-    ON_SCOPE_EXIT(fsSaveDataInfoReaderClose(&reader));
 
-    std::vector<FsSaveDataInfo> info_list(ENTRY_CHUNK_COUNT);
-    while (true) {
-        s64 record_count{};
-        if (R_FAILED(fsSaveDataInfoReaderRead(&reader, info_list.data(), info_list.size(), &record_count))) {
-            log_write("failed fsSaveDataInfoReaderRead()\n");
-            break;
+    // the rest are read in Update().
+    ReadBatch();
+    this->Sort();
+    SetIndex(0);
+}
+
+void Menu::ReadBatch() {
+    if (!m_reader_open) {
+        return;
+    }
+
+    std::vector<FsSaveDataInfo> info_list(ENTRY_BATCH_COUNT);
+    s64 record_count{};
+    if (R_FAILED(fsSaveDataInfoReaderRead(&m_reader, info_list.data(), info_list.size(), &record_count))) {
+        log_write("failed fsSaveDataInfoReaderRead()\n");
+        record_count = 0;
+    }
+
+    for (s32 i = 0; i < record_count; i++) {
+        auto& e = m_entries.emplace_back(info_list[i]);
+        e.read_index = m_entries.size() - 1;
+    }
+
+    // finished parsing all entries.
+    if (!record_count) {
+        CloseReader();
+        log_write("games found: %zu time_taken: %.2f seconds %zu ms %zu ns\n", m_entries.size(), m_scan_ts.GetSecondsD(), m_scan_ts.GetMs(), m_scan_ts.GetNs());
+
+        // entries are appended in the order of the reader, so only sort if
+        // that isn't the order wanted.
+        if (!m_entries.empty() && (m_sort.Get() != SortType_Updated || m_order.Get() != OrderType_Descending)) {
+            SortAndFindLastFile(false);
+            return;
         }
+    }
 
-        // finished parsing all entries.
-        if (!record_count) {
-            break;
+    QueueSizes();
+    SetIndex(m_index);
+}
+
+void Menu::CloseReader() {
+    if (m_reader_open) {
+        fsSaveDataInfoReaderClose(&m_reader);
+        m_reader_open = false;
+    }
+}
+
+void Menu::QueueSizes() {
+    if (m_sort.Get() != SortType_Size || !m_size_queue) {
+        return;
+    }
+
+    for (auto& e : m_entries) {
+        if (e.used_size >= 0 || e.size_pending) {
+            continue;
         }
 
-        for (s32 i = 0; i < record_count; i++) {
-            m_entries.emplace_back(info_list[i]);
+        e.size_pending = true;
+        m_size_pending++;
+
+        utils::task::Push([queue = m_size_queue, info = static_cast<const FsSaveDataInfo&>(e)]() {
+            if (queue->exit) {
+                return;
+            }
+
+            const auto size = GetUsedSize(info);
+            SCOPED_MUTEX(&queue->mutex);
+            queue->done.emplace_back(info.save_data_id, size);
+        }, utils::task::Priority::Low);
+    }
+}
+
+void Menu::UpdateSizes() {
+    if (!m_size_pending) {
+        return;
+    }
+
+    std::vector<std::pair<u64, s64>> done;
+    {
+        SCOPED_MUTEX(&m_size_queue->mutex);
+        std::swap(done, m_size_queue->done);
+    }
+
+    for (const auto& [save_data_id, size] : done) {
+        const auto it = std::ranges::find_if(m_entries, [save_data_id](auto& e) {
+            return e.size_pending && e.save_data_id == save_data_id;
+        });
+
+        if (it != m_entries.end()) {
+            it->used_size = size;
+            it->size_pending = false;
+            m_size_pending--;
         }
     }
 
-    log_write("games found: %zu time_taken: %.2f seconds %zu ms %zu ns\n", m_entries.size(), ts.GetSecondsD(), ts.GetMs(), ts.GetNs());
-    this->Sort();
-    SetIndex(0);
-    ClearSelection();
+    // sort once every size is known, rather than moving entries as they arrive.
+    if (!done.empty() && !m_size_pending && !m_reader_open && m_sort.Get() == SortType_Size) {
+        SortAndFindLastFile(false);
+    }
 }
 
 void Menu::Sort() {
-    // const auto sort = m_sort.Get();
+    const auto sort = m_sort.Get();
     const auto order = m_order.Get();
 
-    if (order == OrderType_Ascending) {
-        if (!m_is_reversed) {
-            std::ranges::reverse(m_entries);
-            m_is_reversed = true;
+    std::ranges::sort(m_entries, [sort, order](const Entry& lhs, const Entry& rhs) {
+        if (sort == SortType_Size && lhs.used_size != rhs.used_size) {
+            // unknown sizes go last.
+            if (lhs.used_size < 0 || rhs.used_size < 0) {
+                return lhs.used_size >= 0;
+            }
+
+            if (order == OrderType_Descending) {
+                return lhs.used_size > rhs.used_size;
+            } else {
+                return lhs.used_size < rhs.used_size;
+            }
         }
-    } else {
-        if (m_is_reversed) {
-            std::ranges::reverse(m_entries);
-            m_is_reversed = false;
+
+        // the reader returns the most recently updated first.
+        if (order == OrderType_Descending) {
+            return lhs.read_index < rhs.read_index;
+        } else {
+            return lhs.read_index > rhs.read_index;
         }
-    }
+    });
 }
 
 void Menu::SortAndFindLastFile(bool scan) {
-    const auto app_id = m_entries[m_index].application_id;
+    const auto app_id = m_entries.empty() ? 0 : m_entries[m_index].application_id;
     if (scan) {
         ScanHomebrew();
     } else {
@@ -613,6 +1018,12 @@ void Menu::FreeEntries() {
 void Menu::OnLayoutChange() {
     m_index = 0;
     grid::Menu::OnLayoutChange(m_list, m_layout.Get());
+
+    // reload the icons at the thumbnail size of the new layout.
+    auto vg = App::GetVg();
+    for (auto& e : m_entries) {
+        FreeEntry(vg, e);
+    }
 }
 
 void Menu::DisplayOptions() {
@@ -639,6 +1050,7 @@ void Menu::DisplayOptions() {
 
         SidebarEntryArray::Items sort_items;
         sort_items.push_back("Updated"_i18n);
+        sort_items.push_back("Size"_i18n);
 
         SidebarEntryArray::Items order_items;
         order_items.push_back("Descending"_i18n);
@@ -651,6 +1063,7 @@ void Menu::DisplayOptions() {
 
         options->Add<SidebarEntryArray>("Sort"_i18n, sort_items, [this](s64& index_out){
             m_sort.Set(index_out);
+            QueueSizes();
             SortAndFindLastFile(false);
         }, m_sort.Get());
 
@@ -744,11 +1157,29 @@ void Menu::DisplayOptions() {
                 "Disabling will result in a much faster backup, at the cost of the file size."
             )
         );
+
+        options->Add<SidebarEntryBool>("Incremental backup"_i18n, m_incremental_save_backup.Get(), [this](bool& v_out){
+            m_incremental_save_backup.Set(v_out);
+        },  i18n::get("save_backup_incremental_info",
+                "If enabled, backups are split into chunks which are stored once in \"/dumps/Save Store\", "
+                "and each backup is a small manifest of those chunks.\n\n"
+                "Only chunks that changed since a previous backup are written, making repeated backups "
+                "much faster and smaller.\n\n"
+                "NOTE: Incremental backups can only be stored on the SD card or a stdio location, "
+                "and the store must be kept alongside the manifests."
+            )
+        );
     });
 }
 
 void Menu::BackupSaves(std::vector<std::reference_wrapper<Entry>>& entries, u32 flags) {
-    dump::DumpGetLocation("Select backup location"_i18n, dump::DumpLocationFlag_SdCard|dump::DumpLocationFlag_Stdio|dump::DumpLocationFlag_Usb, [this, entries, flags](const dump::DumpLocation& location){
+    // the chunk store needs a location that can be browsed, so usb is only for zips.
+    auto location_flags = dump::DumpLocationFlag_SdCard|dump::DumpLocationFlag_Stdio;
+    if (!m_incremental_save_backup.Get()) {
+        location_flags |= dump::DumpLocationFlag_Usb;
+    }
+
+    dump::DumpGetLocation("Select backup location"_i18n, location_flags, [this, entries, flags](const dump::DumpLocation& location){
         App::Push<ProgressBox>(0, "Backup"_i18n, "", [this, entries, location, flags](auto pbox) -> Result {
             return BackupSaveInternal(pbox, location, entries, flags);
         }, [](Result rc){
@@ -766,13 +1197,8 @@ void Menu::RestoreSave() {
         std::unique_ptr<fs::Fs> fs{};
         fs::FsPath mount{};
 
-        if (location.entry.type == dump::DumpLocationType_Stdio) {
-            mount = fs::AppendPath(location.stdio[location.entry.index].mount, location.stdio[location.entry.index].dump_path);
-            fs = std::make_unique<fs::FsStdio>(true, location.stdio[location.entry.index].mount);
-        } else if (location.entry.type == dump::DumpLocationType_SdCard) {
-            fs = std::make_unique<fs::FsNativeSd>();
-        } else {
-            App::PushErrorBox(MAKERESULT(Module_Libnx, LibnxError_BadInput), "Invalid location type!"_i18n);
+        if (const auto rc = OpenLocationFs(location, fs, mount); R_FAILED(rc)) {
+            App::PushErrorBox(rc, "Invalid location type!"_i18n);
             return;
         }
 
@@ -783,7 +1209,7 @@ void Menu::RestoreSave() {
             filebrowser::FsView::get_collection(fs.get(), save_path, "", collections[i], true, false, false);
             // reverse as they will be sorted in oldest -> newest.
             // todo: better impl when both id and normal app folders are used.
-            std::ranges::reverse(collections[i].files);
+            collections[i].files.Reverse();
         }
 
         std::vector<fs::FsPath> paths;
@@ -791,7 +1217,7 @@ void Menu::RestoreSave() {
         for (const auto& collection : collections) {
             for (const auto&p : collection.files) {
                 const auto view = std::string_view{p.name};
-                if (view.starts_with("BCAT") || !view.ends_with(".zip")) {
+                if (view.starts_with("BCAT") || (!view.ends_with(".zip") && !IsSaveManifest(view))) {
                     continue;
                 }
 
@@ -832,6 +1258,9 @@ void Menu::RestoreSave() {
                                 }
 
                                 pbox->SetActionName("Restore"_i18n);
+                                if (IsSaveManifest(file_path.s)) {
+                                    return RestoreSaveIncrementalInternal(pbox, m_entries[m_index], location, file_path);
+                                }
                                 return RestoreSaveInternal(pbox, m_entries[m_index], file_path);
                             }, [this](Result rc){
                                 App::PushErrorBox(rc, "Restore failed!"_i18n);
@@ -852,6 +1281,7 @@ auto Menu::BuildSavePath(const Entry& e, u32 flags) const -> fs::FsPath {
     const auto t = std::time(NULL);
     const auto tm = std::localtime(&t);
     const auto base = BuildSaveBasePath(e);
+    const auto ext = (flags & BackupFlag_Incremental) ? SAVE_MANIFEST_EXT : ".zip";
 
     char time[64];
     std::snprintf(time, sizeof(time), "%u.%02u.%02u @ %02u.%02u.%02u", tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
@@ -868,9 +1298,9 @@ auto Menu::BuildSavePath(const Entry& e, u32 flags) const -> fs::FsPath {
         }
 
         title::utilsReplaceIllegalCharacters(name_buf, true);
-        std::snprintf(name, sizeof(name), "%s - %s.zip", name_buf.s, time);
+        std::snprintf(name, sizeof(name), "%s - %s%s", name_buf.s, time, ext);
     } else {
-        std::snprintf(name, sizeof(name), "%s.zip", time);
+        std::snprintf(name, sizeof(name), "%s%s", time, ext);
     }
 
     if (flags & BackupFlag_SetName) {
@@ -889,14 +1319,7 @@ auto Menu::BuildSavePath(const Entry& e, u32 flags) const -> fs::FsPath {
 }
 
 Result Menu::RestoreSaveInternal(ProgressBox* pbox, const Entry& e, const fs::FsPath& path) {
-    pbox->SetTitle(e.GetName());
-    if (e.image) {
-        pbox->SetImage(e.image);
-    } else if (auto data = title::Get(e.application_id); data && !data->icon.empty()) {
-        pbox->SetImageDataConst(data->icon);
-    } else {
-        pbox->SetImage(0);
-    }
+    SetProgressEntry(pbox, e);
 
     const auto save_data_space_id = (FsSaveDataSpaceId)e.save_data_space_id;
 
@@ -983,6 +1406,10 @@ Result Menu::RestoreSaveInternal(ProgressBox* pbox, const Entry& e, const fs::Fs
     fs::FsNativeSave save_fs{(FsSaveDataType)e.save_data_type, save_data_space_id, &attr, false};
     R_TRY(save_fs.GetFsOpenResult());
 
+    // commit once per half of the journal rather than after every file.
+    const auto journal_size = meta.has_value() ? meta->journal_size : extra.journal_size;
+    save_fs.BeginCommitBatch(journal_size / 2);
+
     // delete all files in save.
     filebrowser::FsDirCollections collections;
     R_TRY(filebrowser::FsView::get_collections(&save_fs, "/", "", collections));
@@ -1002,11 +1429,263 @@ Result Menu::RestoreSaveInternal(ProgressBox* pbox, const Entry& e, const fs::Fs
         return true;
     }));
 
+    R_TRY(save_fs.EndCommitBatch());
     log_write("finished save backup\n");
     R_SUCCEED();
 }
 
+Result Menu::RestoreSaveIncrementalInternal(ProgressBox* pbox, const Entry& e, const dump::DumpLocation& location, const fs::FsPath& path) {
+    SetProgressEntry(pbox, e);
+
+    std::unique_ptr<fs::Fs> fs{};
+    fs::FsPath mount{};
+    R_TRY(OpenLocationFs(location, fs, mount));
+    const auto store = fs::AppendPath(mount, SAVE_STORE_PATH);
+
+    log_write("restoring incremental save: %s\n", path.s);
+    std::vector<u8> manifest;
+    R_TRY(fs->read_entire_file(path, manifest));
+
+    SaveManifestHeader header;
+    std::vector<SaveManifestEntry> files;
+    R_TRY(ParseSaveManifest(manifest, header, files));
+
+    // check that every chunk exists before the current save is deleted.
+    for (const auto& file : files) {
+        R_TRY(pbox->ShouldExitResult());
+
+        for (u32 i = 0; i < file.chunk_count; i++) {
+            const auto chunk_path = BuildChunkPath(store, file.hashes + i * SHA256_HASH_SIZE);
+            if (!fs->FileExists(chunk_path)) {
+                log_write("missing chunk: %s\n", chunk_path.s);
+                R_THROW(Result_SaveChunkMissing);
+            }
+        }
+    }
+
+    const auto save_data_space_id = (FsSaveDataSpaceId)e.save_data_space_id;
+    R_TRY(fsExtendSaveDataFileSystem(save_data_space_id, e.save_data_id, header.meta.data_size, header.meta.journal_size));
+
+    FsSaveDataAttribute attr{};
+    attr.application_id = e.application_id;
+    attr.uid = e.uid;
+    attr.system_save_data_id = e.system_save_data_id;
+    attr.save_data_type = e.save_data_type;
+    attr.save_data_rank = e.save_data_rank;
+    attr.save_data_index = e.save_data_index;
+
+    // try and open the save file system.
+    fs::FsNativeSave save_fs{(FsSaveDataType)e.save_data_type, save_data_space_id, &attr, false};
+    R_TRY(save_fs.GetFsOpenResult());
+
+    // commit once per half of the journal rather than after every file.
+    save_fs.BeginCommitBatch(header.meta.journal_size / 2);
+
+    // delete all files in save.
+    filebrowser::FsDirCollections collections;
+    R_TRY(filebrowser::FsView::get_collections(&save_fs, "/", "", collections));
+    R_TRY(filebrowser::FsView::DeleteAllCollections(pbox, &save_fs, collections));
+
+    std::vector<u8> chunk;
+    for (const auto& file : files) {
+        R_TRY(pbox->ShouldExitResult());
+        pbox->NewTransfer(file.path);
+        log_write("restoring: %s\n", file.path.s);
+
+        const auto file_path = fs::AppendPath("/", file.path);
+        Result rc;
+        if (R_FAILED(rc = save_fs.CreateDirectoryRecursivelyWithPath(file_path)) && rc != FsError_PathAlreadyExists) {
+            log_write("failed to create folder: %s 0x%04X\n", file_path.s, rc);
+            R_THROW(rc);
+        }
+
+        R_TRY(save_fs.CreateFile(file_path, file.size, 0));
+
+        fs::File f;
+        R_TRY(save_fs.OpenFile(file_path, FsOpenMode_Write, &f));
+
+        for (u32 i = 0; i < file.chunk_count; i++) {
+            R_TRY(pbox->ShouldExitResult());
+
+            const auto hash = file.hashes + i * SHA256_HASH_SIZE;
+            const auto off = s64(i) * header.chunk_size;
+            const auto size = std::min<s64>(header.chunk_size, file.size - off);
+            R_TRY(fs->read_entire_file(BuildChunkPath(store, hash), chunk));
+
+            // the store may be on a removable device, so check every chunk.
+            u8 chunk_hash[SHA256_HASH_SIZE];
+            sha256CalculateHash(chunk_hash, chunk.data(), chunk.size());
+            R_UNLESS(s64(chunk.size()) == size, Result_SaveChunkHashMismatch);
+            R_UNLESS(!std::memcmp(chunk_hash, hash, sizeof(chunk_hash)), Result_SaveChunkHashMismatch);
+
+            R_TRY(f.Write(off, chunk.data(), chunk.size(), FsWriteOption_None));
+            pbox->UpdateTransfer(off + size, file.size);
+        }
+    }
+
+    R_TRY(save_fs.EndCommitBatch());
+    log_write("finished incremental save restore\n");
+    R_SUCCEED();
+}
+
+Result Menu::BackupSaveIncrementalInternal(ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& mount, const Entry& e, const fs::FsPath& path) {
+    SetProgressEntry(pbox, e);
+
+    const auto save_data_space_id = (FsSaveDataSpaceId)e.save_data_space_id;
+    const auto store = fs::AppendPath(mount, SAVE_STORE_PATH);
+
+    // try and get the journal and data size.
+    FsSaveDataExtraData extra{};
+    R_TRY(fsReadSaveDataFileSystemExtraDataBySaveDataSpaceId(&extra, sizeof(extra), save_data_space_id, e.save_data_id));
+
+    FsSaveDataAttribute attr{};
+    attr.application_id = e.application_id;
+    attr.uid = e.uid;
+    attr.system_save_data_id = e.system_save_data_id;
+    attr.save_data_type = e.save_data_type;
+    attr.save_data_rank = e.save_data_rank;
+    attr.save_data_index = e.save_data_index;
+
+    // try and open the save file system
+    fs::FsNativeSave save_fs{(FsSaveDataType)e.save_data_type, save_data_space_id, &attr, true};
+    R_TRY(save_fs.GetFsOpenResult());
+
+    // get a list of collections.
+    filebrowser::FsDirCollections collections;
+    R_TRY(filebrowser::FsView::get_collections(&save_fs, "/", "", collections));
+
+    // the save file may be empty, this isn't an error, but we exit early.
+    R_UNLESS(!collections.empty(), 0x0);
+
+    SaveManifestHeader header{
+        .magic = SAVE_MANIFEST_MAGIC,
+        .version = SAVE_MANIFEST_VERSION,
+        .chunk_size = SAVE_CHUNK_SIZE,
+        .meta = {
+            .magic = NX_SAVE_META_MAGIC,
+            .version = NX_SAVE_META_VERSION,
+            .attr = extra.attr,
+            .owner_id = extra.owner_id,
+            .timestamp = extra.timestamp,
+            .flags = extra.flags,
+            .unk_x54 = extra.unk_x54,
+            .data_size = extra.data_size,
+            .journal_size = extra.journal_size,
+            .commit_id = extra.commit_id,
+            .raw_size = e.size,
+        },
+    };
+
+    // header is written once the file count is known.
+    std::vector<u8> manifest(sizeof(header));
+    std::vector<u8> chunk(SAVE_CHUNK_SIZE);
+    s64 chunks_written{}, chunks_reused{};
+
+    for (const auto& collection : collections) {
+        for (const auto& file : collection.files) {
+            R_TRY(pbox->ShouldExitResult());
+
+            const auto file_path = fs::AppendPath(collection.path, file.name);
+            const char* file_name = file_path.s;
+
+            // strip root path (/ or ums0:), same as the zip.
+            if (!std::strncmp(file_name, save_fs.Root(), std::strlen(save_fs.Root()))) {
+                file_name += std::strlen(save_fs.Root());
+            }
+
+            while (file_name[0] == '/') {
+                file_name++;
+            }
+
+            fs::File f;
+            R_TRY(save_fs.OpenFile(file_path, FsOpenMode_Read, &f));
+
+            s64 file_size;
+            R_TRY(f.GetSize(&file_size));
+
+            pbox->NewTransfer(file_name);
+
+            const SaveManifestFile manifest_file{
+                .size = file_size,
+                .path_len = (u32)std::strlen(file_name),
+                .chunk_count = (u32)((file_size + SAVE_CHUNK_SIZE - 1) / SAVE_CHUNK_SIZE),
+            };
+
+            manifest.insert(manifest.end(), (const u8*)&manifest_file, (const u8*)&manifest_file + sizeof(manifest_file));
+            manifest.insert(manifest.end(), file_name, file_name + manifest_file.path_len);
+
+            for (s64 off = 0; off < file_size;) {
+                R_TRY(pbox->ShouldExitResult());
+
+                // fill the entire chunk, so that boundaries always line up.
+                const auto size = std::min<s64>(SAVE_CHUNK_SIZE, file_size - off);
+                for (s64 chunk_off = 0; chunk_off < size;) {
+                    u64 bytes_read;
+                    R_TRY(f.Read(off + chunk_off, chunk.data() + chunk_off, size - chunk_off, FsReadOption_None, &bytes_read));
+                    R_UNLESS(bytes_read, Result_FsEmpty);
+                    chunk_off += bytes_read;
+                }
+
+                u8 hash[SHA256_HASH_SIZE];
+                sha256CalculateHash(hash, chunk.data(), size);
+                manifest.insert(manifest.end(), hash, hash + sizeof(hash));
+
+                const auto chunk_path = BuildChunkPath(store, hash);
+                if (fs->FileExists(chunk_path)) {
+                    chunks_reused++;
+                } else {
+                    // write to a temp file first, so that an interrupted backup never
+                    // leaves behind a partial chunk under its hash.
+                    fs::FsPath temp_path;
+                    std::snprintf(temp_path, sizeof(temp_path), "%s.tmp", chunk_path.s);
+
+                    fs->CreateDirectoryRecursivelyWithPath(chunk_path);
+                    fs->DeleteFile(temp_path);
+                    R_TRY(fs->write_entire_file(temp_path, {chunk.data(), (size_t)size}));
+                    R_TRY(fs->RenameFile(temp_path, chunk_path));
+                    chunks_written++;
+                }
+
+                off += size;
+                pbox->UpdateTransfer(off, file_size);
+            }
+
+            header.file_count++;
+        }
+    }
+
+    std::memcpy(manifest.data(), &header, sizeof(header));
+
+    // the manifest is written last, so it only ever lists chunks that exist.
+    pbox->NewTransfer("Writing manifest"_i18n);
+    Result rc;
+    if (R_FAILED(rc = fs->CreateDirectoryRecursivelyWithPath(path)) && rc != FsError_PathAlreadyExists) {
+        log_write("failed to create folder: %s 0x%04X\n", path.s, rc);
+        R_THROW(rc);
+    }
+    R_TRY(fs->write_entire_file(path, manifest));
+
+    log_write("incremental backup: %s chunks written: %ld reused: %ld\n", path.s, chunks_written, chunks_reused);
+    R_SUCCEED();
+}
+
 Result Menu::BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& location, std::span<const std::reference_wrapper<Entry>> entries, u32 flags) {
+    if (m_incremental_save_backup.Get()) {
+        std::unique_ptr<fs::Fs> fs{};
+        fs::FsPath mount{};
+
+        // fallback to a zip if the location can't hold the chunk store.
+        if (R_SUCCEEDED(OpenLocationFs(location, fs, mount))) {
+            for (auto& e : entries) {
+                LoadControlEntry(e);
+                const auto path = fs::AppendPath(mount, BuildSavePath(e, flags | BackupFlag_Incremental));
+                R_TRY(BackupSaveIncrementalInternal(pbox, fs.get(), mount, e, path));
+            }
+
+            R_SUCCEED();
+        }
+    }
+
     std::vector<fs::FsPath> paths;
     for (auto& e : entries) {
         // ensure that we have title name and icon loaded.
@@ -1016,41 +1695,21 @@ Result Menu::BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& loc
 
     const auto compressed = m_compress_save_backup.Get();
     auto source = std::make_shared<DumpSource>(entries, paths);
+    SavePrefetcher prefetcher{entries};
 
     return dump::Dump(pbox, source, location, paths, [&](ui::ProgressBox* pbox, dump::BaseSource* _source, dump::WriteSource* writer, const fs::FsPath& path) -> Result {
         const auto source = (DumpSource*)_source;
         const auto& e = source->GetEntry(path);
 
-        pbox->SetTitle(e.GetName());
-        if (e.image) {
-            pbox->SetImage(e.image);
-        } else if (auto data = title::Get(e.application_id); data && !data->icon.empty()) {
-            pbox->SetImageDataConst(data->icon);
-        } else {
-            pbox->SetImage(0);
-        }
+        SetProgressEntry(pbox, e);
 
-        const auto save_data_space_id = (FsSaveDataSpaceId)e.save_data_space_id;
+        // the save is normally already mounted by the prefetcher.
+        PreparedSave save{};
+        R_TRY(prefetcher.Get(source->GetIndex(path), save));
 
-        // try and get the journal and data size.
-        FsSaveDataExtraData extra{};
-        R_TRY(fsReadSaveDataFileSystemExtraDataBySaveDataSpaceId(&extra, sizeof(extra), save_data_space_id, e.save_data_id));
-
-        FsSaveDataAttribute attr{};
-        attr.application_id = e.application_id;
-        attr.uid = e.uid;
-        attr.system_save_data_id = e.system_save_data_id;
-        attr.save_data_type = e.save_data_type;
-        attr.save_data_rank = e.save_data_rank;
-        attr.save_data_index = e.save_data_index;
-
-        // try and open the save file system
-        fs::FsNativeSave save_fs{(FsSaveDataType)e.save_data_type, save_data_space_id, &attr, true};
-        R_TRY(save_fs.GetFsOpenResult());
-
-        // get a list of collections.
-        filebrowser::FsDirCollections collections;
-        R_TRY(filebrowser::FsView::get_collections(&save_fs, "/", "", collections));
+        const auto& extra = save.extra;
+        const auto& collections = save.collections;
+        auto& save_fs = *save.save_fs;
 
         // the save file may be empty, this isn't an error, but we exit early.
         R_UNLESS(!collections.empty(), 0x0);
@@ -1107,38 +1766,29 @@ Result Menu::BackupSaveInternal(ProgressBox* pbox, const dump::DumpLocation& loc
                 R_UNLESS(ZIP_OK == zipWriteInFileInZip(zfile, &meta, sizeof(meta)), Result_ZipWriteInFileInZip);
             }
 
-            const auto zip_add = [&](const fs::FsPath& file_path) -> Result {
-                const char* file_name_in_zip = file_path.s;
-
-                // strip root path (/ or ums0:)
-                if (!std::strncmp(file_name_in_zip, save_fs.Root(), std::strlen(save_fs.Root()))) {
-                    file_name_in_zip += std::strlen(save_fs.Root());
-                }
-
-                // root paths are banned in zips, they will warn when extracting otherwise.
-                while (file_name_in_zip[0] == '/') {
-                    file_name_in_zip++;
-                }
-
-                pbox->NewTransfer(file_name_in_zip);
-
-                const auto level = compressed ? Z_DEFAULT_COMPRESSION : Z_NO_COMPRESSION;
-                if (ZIP_OK != zipOpenNewFileInZip(zfile, file_name_in_zip, &zip_info_default, NULL, 0, NULL, 0, NULL, Z_DEFLATED, level)) {
-                    log_write("failed to add zip for %s\n", file_path.s);
-                    R_THROW(Result_ZipOpenNewFileInZip);
-                }
-                ON_SCOPE_EXIT(zipCloseFileInZip(zfile));
-
-                return thread::TransferZip(pbox, zfile, &save_fs, file_path);
-            };
-
-            // loop through every save file and store to zip.
+            std::vector<thread::ZipEntry> zip_entries;
             for (const auto& collection : collections) {
                 for (const auto& file : collection.files) {
                     const auto file_path = fs::AppendPath(collection.path, file.name);
-                    R_TRY(zip_add(file_path));
+                    const char* file_name_in_zip = file_path.s;
+
+                    // strip root path (/ or ums0:)
+                    if (!std::strncmp(file_name_in_zip, save_fs.Root(), std::strlen(save_fs.Root()))) {
+                        file_name_in_zip += std::strlen(save_fs.Root());
+                    }
+
+                    // root paths are banned in zips, they will warn when extracting otherwise.
+                    while (file_name_in_zip[0] == '/') {
+                        file_name_in_zip++;
+                    }
+
+                    zip_entries.emplace_back(file_path, file_name_in_zip);
                 }
             }
+
+            // store every save file in the zip, small files are compressed in parallel.
+            const auto level = compressed ? Z_DEFAULT_COMPRESSION : Z_NO_COMPRESSION;
+            R_TRY(thread::TransferZipEntries(pbox, zfile, &save_fs, zip_entries, &zip_info_default, level));
         }
 
         // if we dumped the save to ram, flush the data to file.
@@ -5,10 +5,13 @@
 #include "log.hpp"
 #include "ui/nvg_util.hpp"
 #include "i18n.hpp"
+#include "ui/sidebar.hpp"
+#include "usb/base.hpp"
 
 #include "utils/thread.hpp"
 
 #include <cstring>
+#include <algorithm>
 
 namespace sphaira::ui::menu::usb {
 namespace {
@@ -17,6 +20,66 @@ constexpr u64 CONNECTION_TIMEOUT = 3e+9;
 constexpr u64 TRANSFER_TIMEOUT = 3e+9;
 constexpr u64 FINISHED_TIMEOUT = 3e+9; // 3 seconds.
 
+constexpr u32 BENCH_SIZES[]{
+    1024 * 64,
+    1024 * 256,
+    1024 * 1024 * 1,
+    1024 * 1024 * 4,
+    1024 * 1024 * 16,
+};
+
+constexpr u32 BENCH_QUEUE_DEPTHS[]{ 1, 2, 4, 8 };
+
+// amount of data transferred per run, the large sizes do a few more so there's
+// enough samples for the percentiles.
+constexpr u64 BENCH_TOTAL_SIZE = 1024 * 1024 * 64;
+constexpr u32 BENCH_COUNT_MIN = 8;
+
+struct BenchRun {
+    u32 mode;
+    u32 size;
+    u32 queue_depth;
+};
+
+auto GetBenchSizeStr(u32 size) -> std::string {
+    char buf[32];
+    if (size >= 1024 * 1024) {
+        std::snprintf(buf, sizeof(buf), "%u MiB", size / 1024 / 1024);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%u KiB", size / 1024);
+    }
+    return buf;
+}
+
+auto GetBenchRunStr(const BenchRun& run) -> std::string {
+    const auto mode = run.mode == sphaira::usb::api::BENCH_DOWNLOAD ? "Download"_i18n : "Upload"_i18n;
+    return mode + " " + GetBenchSizeStr(run.size) + " QD" + std::to_string(run.queue_depth);
+}
+
+// nearest rank, latencies must be sorted.
+auto GetPercentile(const std::vector<u64>& latencies, u32 percentile) -> double {
+    if (latencies.empty()) {
+        return 0;
+    }
+
+    const auto rank = std::max<size_t>(1, (latencies.size() * percentile + 99) / 100);
+    return latencies[rank - 1] / 1e+6;
+}
+
+auto FormatBenchResult(const BenchRun& run, sphaira::usb::install::BenchResult& result) -> std::string {
+    std::ranges::sort(result.latency_ns);
+    const auto bytes = (double)run.size * result.latency_ns.size();
+    const auto mb_per_sec = result.total_ns ? bytes * 1e+3 / result.total_ns : 0;
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%s: %.1f MB/s | p50 %.2f ms | p90 %.2f ms | p99 %.2f ms",
+        GetBenchRunStr(run).c_str(), mb_per_sec,
+        GetPercentile(result.latency_ns, 50), GetPercentile(result.latency_ns, 90), GetPercentile(result.latency_ns, 99));
+
+    return buf;
+}
+
+
 void thread_func(void* user) {
     auto app = static_cast<Menu*>(user);
     app->ThreadFunction();
@@ -91,6 +154,13 @@ void Menu::Update(Controller* controller, TouchInfo* touch) {
         SetSubHeading(buf);
     }
 
+    if (m_state == State::Connected_Bench && !m_bench_ready) {
+        m_bench_ready = true;
+        SetAction(Button::Y, Action{"Benchmark"_i18n, [this](){
+            DisplayBenchOptions();
+        }});
+    }
+
     if (m_state == State::Connected_StartingTransfer) {
         log_write("set to progress\n");
         m_state = State::Progress;
@@ -157,6 +227,10 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "Connected, starting transfer..."_i18n.c_str());
             break;
 
+        case State::Connected_Bench:
+            gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "Connected, press Y to start the benchmark..."_i18n.c_str());
+            break;
+
         case State::Progress:
             gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "Transferring data..."_i18n.c_str());
             break;
@@ -169,6 +243,116 @@ void Menu::Draw(NVGcontext* vg, Theme* theme) {
             gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, SCREEN_HEIGHT / 2.f, 36.f, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE, theme->GetColour(ThemeEntryID_TEXT_INFO), "Failed to init usb, press B to exit..."_i18n.c_str());
             break;
     }
+
+    // results from the last benchmark.
+    float y = SCREEN_HEIGHT / 2.f + 50.f;
+    for (const auto& e : m_bench_results) {
+        gfx::drawTextArgs(vg, SCREEN_WIDTH / 2.f, y, 20.f, NVG_ALIGN_CENTER | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT), e.c_str());
+        y += 26.f;
+    }
+}
+
+void Menu::DisplayBenchOptions() {
+    auto options = std::make_unique<Sidebar>("Benchmark"_i18n, Sidebar::Side::RIGHT);
+    ON_SCOPE_EXIT(App::Push(std::move(options)));
+
+    SidebarEntryArray::Items mode_items;
+    mode_items.emplace_back("All"_i18n);
+    mode_items.emplace_back("Download"_i18n);
+    mode_items.emplace_back("Upload"_i18n);
+
+    SidebarEntryArray::Items size_items;
+    size_items.emplace_back("All"_i18n);
+    for (const auto size : BENCH_SIZES) {
+        size_items.emplace_back(GetBenchSizeStr(size));
+    }
+
+    SidebarEntryArray::Items depth_items;
+    depth_items.emplace_back("All"_i18n);
+    for (const auto depth : BENCH_QUEUE_DEPTHS) {
+        depth_items.emplace_back(std::to_string(depth));
+    }
+
+    options->Add<SidebarEntryArray>("Direction"_i18n, mode_items, [this](s64& index_out){
+        m_bench_mode_index = index_out;
+    }, m_bench_mode_index);
+
+    options->Add<SidebarEntryArray>("Chunk size"_i18n, size_items, [this](s64& index_out){
+        m_bench_size_index = index_out;
+    }, m_bench_size_index);
+
+    options->Add<SidebarEntryArray>("Queue depth"_i18n, depth_items, [this](s64& index_out){
+        m_bench_depth_index = index_out;
+    }, m_bench_depth_index);
+
+    options->Add<SidebarEntryCallback>("Start"_i18n, [this](){
+        StartBench();
+    }, true, "Transfers data to and from the PC without using storage.\n\n"
+       "A deeper queue only changes chunks that are split into several transfers."_i18n);
+}
+
+void Menu::StartBench() {
+    std::vector<BenchRun> runs;
+    for (const u32 mode : { sphaira::usb::api::BENCH_DOWNLOAD, sphaira::usb::api::BENCH_UPLOAD }) {
+        if (m_bench_mode_index && m_bench_mode_index - 1 != (s64)mode) {
+            continue;
+        }
+
+        for (u32 i = 0; i < std::size(BENCH_SIZES); i++) {
+            if (m_bench_size_index && m_bench_size_index - 1 != (s64)i) {
+                continue;
+            }
+
+            for (u32 j = 0; j < std::size(BENCH_QUEUE_DEPTHS); j++) {
+                const auto size = BENCH_SIZES[i];
+                const auto depth = BENCH_QUEUE_DEPTHS[j];
+
+                if (m_bench_depth_index) {
+                    if (m_bench_depth_index - 1 != (s64)j) {
+                        continue;
+                    }
+                } else if (depth > 1 && size <= sphaira::usb::Base::GetStreamSlotSize(depth)) {
+                    // same as a depth of 1, so skip it when running all of them.
+                    continue;
+                }
+
+                runs.emplace_back(mode, size, depth);
+            }
+        }
+    }
+
+    auto results = std::make_shared<std::vector<std::string>>();
+
+    App::Push<ui::ProgressBox>(0, "Benchmark"_i18n, "", [this, runs, results](auto pbox) -> Result {
+        pbox->AddCancelEvent(m_usb_source->GetCancelEvent());
+        ON_SCOPE_EXIT(pbox->RemoveCancelEvent(m_usb_source->GetCancelEvent()));
+
+        for (u32 i = 0; i < std::size(runs); i++) {
+            R_TRY(pbox->ShouldExitResult());
+
+            const auto& run = runs[i];
+            const auto count = std::max<u32>(BENCH_TOTAL_SIZE / run.size, BENCH_COUNT_MIN);
+            pbox->NewTransfer(GetBenchRunStr(run));
+            pbox->UpdateTransfer(i, std::size(runs));
+
+            sphaira::usb::install::BenchResult result;
+            R_TRY(m_usb_source->Bench(run.mode, run.size, count, run.queue_depth, result));
+
+            const auto str = FormatBenchResult(run, result);
+            log_write("[USB] bench: %s\n", str.c_str());
+            results->emplace_back(str);
+        }
+
+        R_SUCCEED();
+    }, [this, results](Result rc){
+        App::PushErrorBox(rc, "USB benchmark failed!"_i18n);
+        m_bench_results = std::move(*results);
+
+        // a failed run leaves the host mid transfer.
+        if (R_FAILED(rc)) {
+            m_state = State::Failed;
+        }
+    });
 }
 
 void Menu::ThreadFunction() {
@@ -193,7 +377,11 @@ void Menu::ThreadFunction() {
             std::vector<std::string> names;
             if (R_SUCCEEDED(m_usb_source->WaitForConnection(CONNECTION_TIMEOUT, names))) {
                 m_names = names;
-                m_state = State::Connected_StartingTransfer;
+                if (m_names.empty() && m_usb_source->IsBench()) {
+                    m_state = State::Connected_Bench;
+                } else {
+                    m_state = State::Connected_StartingTransfer;
+                }
                 break;
             }
         }
@@ -113,6 +113,13 @@ auto NotifMananger::Clear() -> void {
     m_entries_right.clear();
 }
 
+auto NotifMananger::IsEmpty() -> bool {
+    mutexLock(&m_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+    return m_entries_left.empty() && m_entries_right.empty();
+}
+
 auto NotifMananger::GetEntries(NotifEntry::Side side) -> Entries& {
     if (side == NotifEntry::Side::LEFT) {
         return m_entries_left;
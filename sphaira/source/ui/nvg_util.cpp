@@ -7,10 +7,166 @@
 #include <utility>
 #include <algorithm>
 #include <cmath>
+#include <optional>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <string_view>
 
 namespace sphaira::ui::gfx {
 namespace {
 
+constexpr int ATLAS_SIZE = 1024;
+constexpr u32 ATLAS_PAGE_MAX = 4;
+// icons are surrounded by a copy of their edge pixels, so that filtering
+// doesn't bleed in the neighbouring icons.
+constexpr int ATLAS_PAD = 1;
+// nvg image ids are small, so this range is free to use for atlas icons.
+constexpr int ATLAS_ID_BIT = 1 << 30;
+
+struct AtlasSlot {
+    int id{};
+    int w{};
+    int h{};
+    u64 last_frame{};
+};
+
+struct AtlasPage {
+    auto GetSlotPos(u32 index) const -> Vec2 {
+        const auto stride = size + ATLAS_PAD * 2;
+        return Vec2(index % per_row * stride + ATLAS_PAD, index / per_row * stride + ATLAS_PAD);
+    }
+
+    int image{};
+    int size{};
+    int per_row{};
+    u32 used{};
+    bool dirty{};
+    std::vector<AtlasSlot> slots{};
+    // copy of the texture, as nvg only uploads whole images.
+    std::vector<u8> pixels{};
+};
+
+struct AtlasRef {
+    AtlasPage* page;
+    u32 index;
+};
+
+std::vector<std::unique_ptr<AtlasPage>> g_atlas_pages;
+std::unordered_map<int, AtlasRef> g_atlas_ids;
+int g_atlas_next_id{};
+u64 g_atlas_frame{};
+
+auto CreateAtlasPage(NVGcontext* vg, int size) -> AtlasPage* {
+    auto page = std::make_unique<AtlasPage>();
+    page->size = size;
+    page->per_row = ATLAS_SIZE / (size + ATLAS_PAD * 2);
+    page->slots.resize(page->per_row * page->per_row);
+    page->pixels.resize(ATLAS_SIZE * ATLAS_SIZE * 4);
+    page->image = nvgCreateImageRGBA(vg, ATLAS_SIZE, ATLAS_SIZE, 0, page->pixels.data());
+    if (!page->image) {
+        return nullptr;
+    }
+
+    log_write("[ATLAS] created page for size: %d slots: %zu\n", size, page->slots.size());
+    return g_atlas_pages.emplace_back(std::move(page)).get();
+}
+
+auto FindAtlasSlot(NVGcontext* vg, int size, AtlasRef& out) -> bool {
+    for (auto& page : g_atlas_pages) {
+        if (page->size != size || page->used == page->slots.size()) {
+            continue;
+        }
+
+        for (u32 i = 0; i < page->slots.size(); i++) {
+            if (!page->slots[i].id) {
+                out = {page.get(), i};
+                return true;
+            }
+        }
+    }
+
+    if (g_atlas_pages.size() < ATLAS_PAGE_MAX) {
+        if (auto page = CreateAtlasPage(vg, size)) {
+            out = {page, 0};
+            return true;
+        }
+    }
+
+    // evict the least recently drawn icon, icons drawn in the last frame are
+    // likely still on screen so they're kept.
+    std::optional<AtlasRef> lru{};
+    for (auto& page : g_atlas_pages) {
+        if (page->size != size) {
+            continue;
+        }
+
+        for (u32 i = 0; i < page->slots.size(); i++) {
+            const auto& slot = page->slots[i];
+            if (slot.last_frame < g_atlas_frame && (!lru || slot.last_frame < lru->page->slots[lru->index].last_frame)) {
+                lru = AtlasRef{page.get(), i};
+            }
+        }
+    }
+
+    if (!lru) {
+        return false;
+    }
+
+    auto& slot = lru->page->slots[lru->index];
+    g_atlas_ids.erase(slot.id);
+    slot = {};
+    lru->page->used--;
+    out = *lru;
+    return true;
+}
+
+void WriteAtlasSlot(AtlasPage& page, u32 index, int w, int h, const u8* data) {
+    const auto pos = page.GetSlotPos(index);
+    const auto pitch = ATLAS_SIZE * 4;
+
+    // copies the rows with the padding, the edge rows and columns are repeated.
+    for (int y = -ATLAS_PAD; y < h + ATLAS_PAD; y++) {
+        const auto src = data + std::clamp(y, 0, h - 1) * w * 4;
+        auto dst = page.pixels.data() + ((int)pos.y + y) * pitch + (int)pos.x * 4;
+        std::memcpy(dst, src, w * 4);
+
+        for (int x = 1; x <= ATLAS_PAD; x++) {
+            std::memcpy(dst - x * 4, src, 4);
+            std::memcpy(dst + (w - 1 + x) * 4, src + (w - 1) * 4, 4);
+        }
+    }
+
+    page.dirty = true;
+}
+
+void FreeAtlasPage(NVGcontext* vg, AtlasPage* page) {
+    nvgDeleteImage(vg, page->image);
+    std::erase_if(g_atlas_pages, [page](auto& e) {
+        return e.get() == page;
+    });
+}
+
+void drawAtlasImage(NVGcontext* vg, const Vec4& v, int texture, float rounded, float alpha) {
+    const auto it = g_atlas_ids.find(texture);
+    if (it == g_atlas_ids.end()) {
+        return;
+    }
+
+    const auto& [page, index] = it->second;
+    auto& slot = page->slots[index];
+    slot.last_frame = g_atlas_frame;
+
+    // scale the whole page so that the slot lands on v.
+    const auto pos = page->GetSlotPos(index);
+    const auto sx = v.w / slot.w;
+    const auto sy = v.h / slot.h;
+    const auto paint = nvgImagePattern(vg, v.x - pos.x * sx, v.y - pos.y * sy, ATLAS_SIZE * sx, ATLAS_SIZE * sy, 0, page->image, alpha);
+    drawRect(vg, v, paint, rounded);
+}
+
 constexpr auto ALIGN_HOR = NVG_ALIGN_LEFT|NVG_ALIGN_CENTER|NVG_ALIGN_RIGHT;
 constexpr auto ALIGN_VER = NVG_ALIGN_TOP|NVG_ALIGN_MIDDLE|NVG_ALIGN_BOTTOM|NVG_ALIGN_BASELINE;
 
@@ -35,6 +191,47 @@ constexpr std::array buttons = {
     std::pair{Button::R3, "\uE105"},
 };
 
+// sizes that most of the ui is drawn with.
+constexpr float PREWARM_FONT_SIZES[] = { 16, 18, 20, 22, 24, 26, 28, 36 };
+// the cache is cleared once full, it only needs to hold what's on screen.
+constexpr u32 TEXT_CACHE_MAX = 2048;
+
+struct TextEntry {
+    std::string str;
+    float bounds[4];
+    float advance;
+};
+
+std::unordered_map<u64, TextEntry> g_text_cache;
+
+auto TextKey(float size, int align, float line_height, float break_w, const char* str) -> u64 {
+    u64 hash = std::hash<std::string_view>{}(str);
+    for (const auto v : { size, (float)align, line_height, break_w }) {
+        u32 bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        hash ^= bits + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+auto FindText(u64 key, const char* str) -> const TextEntry* {
+    const auto it = g_text_cache.find(key);
+    if (it == g_text_cache.end() || it->second.str != str) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+auto AddText(u64 key, const char* str) -> TextEntry& {
+    if (g_text_cache.size() >= TEXT_CACHE_MAX) {
+        g_text_cache.clear();
+    }
+
+    auto& e = g_text_cache[key];
+    e.str = str;
+    return e;
+}
+
 // software based clipping, saves a few cpu cycles.
 bool ClipRect(float x, float y) {
     return x >= SCREEN_WIDTH || y >= SCREEN_HEIGHT;
@@ -210,7 +407,78 @@ void drawTextArgs(NVGcontext* vg, float x, float y, float size, int align, const
     drawText(vg, x, y, size, buffer, nullptr, align, c);
 }
 
+auto createAtlasImage(NVGcontext* vg, int size, int w, int h, const u8* data) -> int {
+    AtlasRef ref;
+    if (size <= 0 || w <= 0 || h <= 0 || w > size || h > size || !FindAtlasSlot(vg, size, ref)) {
+        return nvgCreateImageRGBA(vg, w, h, 0, data);
+    }
+
+    g_atlas_next_id = (g_atlas_next_id + 1) & (ATLAS_ID_BIT - 1);
+    const auto id = ATLAS_ID_BIT | g_atlas_next_id;
+
+    auto& slot = ref.page->slots[ref.index];
+    slot.id = id;
+    slot.w = w;
+    slot.h = h;
+    slot.last_frame = g_atlas_frame;
+    ref.page->used++;
+    WriteAtlasSlot(*ref.page, ref.index, w, h, data);
+
+    g_atlas_ids.emplace(id, ref);
+    return id;
+}
+
+void deleteImage(NVGcontext* vg, int image) {
+    if (!(image & ATLAS_ID_BIT)) {
+        if (image) {
+            nvgDeleteImage(vg, image);
+        }
+        return;
+    }
+
+    const auto it = g_atlas_ids.find(image);
+    if (it == g_atlas_ids.end()) {
+        return;
+    }
+
+    auto [page, index] = it->second;
+    g_atlas_ids.erase(it);
+    page->slots[index] = {};
+    if (!--page->used) {
+        FreeAtlasPage(vg, page);
+    }
+}
+
+auto isImageEvicted(int image) -> bool {
+    return (image & ATLAS_ID_BIT) && !g_atlas_ids.contains(image);
+}
+
+void flushAtlas(NVGcontext* vg) {
+    for (auto& page : g_atlas_pages) {
+        if (page->dirty) {
+            nvgUpdateImage(vg, page->image, page->pixels.data());
+            page->dirty = false;
+        }
+    }
+
+    g_atlas_frame++;
+}
+
+void exitAtlas(NVGcontext* vg) {
+    for (auto& page : g_atlas_pages) {
+        nvgDeleteImage(vg, page->image);
+    }
+
+    g_atlas_pages.clear();
+    g_atlas_ids.clear();
+}
+
 void drawImage(NVGcontext* vg, const Vec4& v, int texture, float rounded, float alpha) {
+    if (texture & ATLAS_ID_BIT) {
+        drawAtlasImage(vg, v, texture, rounded, alpha);
+        return;
+    }
+
     const auto paint = nvgImagePattern(vg, v.x, v.y, v.w, v.h, 0, texture, alpha);
     drawRect(vg, v, paint, rounded);
 }
@@ -244,6 +512,64 @@ void textBoundsArgs(NVGcontext* vg, float x, float y, float *bounds, const char*
     textBounds(vg, x, y, bounds, buf);
 }
 
+auto textBoundsCached(NVGcontext* vg, float size, int align, const char* str, float* bounds) -> float {
+    nvgFontSize(vg, size);
+    nvgTextAlign(vg, align);
+
+    const auto key = TextKey(size, align, 0, 0, str);
+    if (auto e = FindText(key, str)) {
+        std::memcpy(bounds, e->bounds, sizeof(e->bounds));
+        return e->advance;
+    }
+
+    auto& e = AddText(key, str);
+    e.advance = nvgTextBounds(vg, 0, 0, str, nullptr, e.bounds);
+    std::memcpy(bounds, e.bounds, sizeof(e.bounds));
+    return e.advance;
+}
+
+void textBoxBoundsCached(NVGcontext* vg, float size, int align, float line_height, float break_w, const char* str, float* bounds) {
+    nvgFontSize(vg, size);
+    nvgTextAlign(vg, align);
+    nvgTextLineHeight(vg, line_height);
+
+    const auto key = TextKey(size, align, line_height, break_w, str);
+    if (auto e = FindText(key, str)) {
+        std::memcpy(bounds, e->bounds, sizeof(e->bounds));
+        return;
+    }
+
+    auto& e = AddText(key, str);
+    nvgTextBoxBounds(vg, 0, 0, break_w, str, nullptr, e.bounds);
+    std::memcpy(bounds, e.bounds, sizeof(e.bounds));
+}
+
+void prewarmGlyphs(NVGcontext* vg) {
+    static bool done{};
+    if (done) {
+        return;
+    }
+    done = true;
+
+    // nvgTextBounds() doesn't rasterise, so the glyphs have to be drawn.
+    std::string str;
+    for (char c = ' '; c <= '~'; c++) {
+        str += c;
+    }
+    for (auto& [key, val] : buttons) {
+        str += val;
+    }
+
+    nvgSave(vg);
+    nvgGlobalAlpha(vg, 0);
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    for (const auto size : PREWARM_FONT_SIZES) {
+        nvgFontSize(vg, size);
+        nvgText(vg, 0, 0, str.c_str(), nullptr);
+    }
+    nvgRestore(vg);
+}
+
 // NEW-----------
 
 void dimBackground(NVGcontext* vg) {
@@ -351,10 +677,8 @@ void drawAppLable(NVGcontext* vg, const Theme* theme, ScrollingText& st, float x
     const float text_pad = 25.f;
     const float font_size = 22.f;
 
-    nvgTextAlign(vg, NVG_ALIGN_LEFT);
-    nvgFontSize(vg, font_size);
     float bounds[4]{};
-    nvgTextBounds(vg, 0, 0, name, NULL, bounds);
+    textBoundsCached(vg, font_size, NVG_ALIGN_LEFT, name, bounds);
 
     const float trinaglex = x + (w / 2.f) - 9.f;
     const float trinagley = y - 14.f;
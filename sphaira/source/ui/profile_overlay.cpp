@@ -0,0 +1,125 @@
+#include "ui/profile_overlay.hpp"
+#include "ui/nvg_util.hpp"
+#include "utils/profile.hpp"
+#include "utils/mem_track.hpp"
+#include "download.hpp"
+#include "image_decode.hpp"
+
+#include <algorithm>
+
+namespace sphaira::ui::profile {
+namespace {
+
+using namespace utils::profile;
+
+constexpr float BOX_X = 20;
+constexpr float BOX_Y = 20;
+constexpr float BOX_W = 460;
+constexpr float PAD = 10;
+constexpr float FONT_SIZE = 16;
+constexpr float LINE_H = 20;
+constexpr float GRAPH_H = 60;
+// the graph is scaled so that this is the top of it.
+constexpr double GRAPH_MAX_MS = 1000.0 / 20.0;
+constexpr double TARGET_MS = 1000.0 / 60.0;
+// number of finished transfers shown.
+constexpr u32 METRICS_LINES = 4;
+
+constexpr const char* PHASE_NAMES[] = {
+    "events", "poll", "update", "draw",
+};
+static_assert(std::size(PHASE_NAMES) == Phase_MAX);
+
+auto ToMs(u64 ns) -> double {
+    return ns / 1e+6;
+}
+
+} // namespace
+
+void Draw(NVGcontext* vg, Theme* theme) {
+    Snapshot snapshot;
+    GetSnapshot(snapshot);
+
+    std::vector<curl::Metrics> metrics;
+    curl::GetMetrics(metrics);
+    if (metrics.size() > METRICS_LINES) {
+        metrics.resize(METRICS_LINES);
+    }
+
+    const auto text_col = nvgRGB(255, 255, 255);
+    const auto info_col = nvgRGB(180, 180, 180);
+    // title, graph, 2 lines of phases, the menus, 4 lines of counters, the transfers and the memory tags.
+    const auto mem_lines = utils::mem::IsEnabled ? utils::mem::Tag_MAX : 0;
+    const auto box_h = PAD * 2 + LINE_H + 4 + GRAPH_H + 6 + LINE_H * (2 + snapshot.menus.size() + 4 + metrics.size() * 2 + mem_lines);
+    gfx::drawRect(vg, BOX_X, BOX_Y, BOX_W, box_h, nvgRGBA(0, 0, 0, 200), 5);
+
+    u64 total{}, peak{};
+    for (auto ns : snapshot.frame_ns) {
+        total += ns;
+        peak = std::max(peak, ns);
+    }
+    const auto avg = total / FRAME_HISTORY;
+
+    const auto x = BOX_X + PAD;
+    auto y = BOX_Y + PAD;
+    const auto align = NVG_ALIGN_LEFT | NVG_ALIGN_TOP;
+    gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, text_col, "frame avg: %.2fms peak: %.2fms (%.1f fps)", ToMs(avg), ToMs(peak), avg ? 1e+9 / avg : 0.0);
+    y += LINE_H + 4;
+
+    // frame time histogram, frames over the target are drawn in red.
+    const auto graph_w = BOX_W - PAD * 2;
+    const auto bar_w = graph_w / FRAME_HISTORY;
+    gfx::drawRect(vg, x, y, graph_w, GRAPH_H, nvgRGBA(255, 255, 255, 20));
+    for (u32 i = 0; i < FRAME_HISTORY; i++) {
+        const auto ms = ToMs(snapshot.frame_ns[i]);
+        const auto h = std::min<float>(GRAPH_H, GRAPH_H * ms / GRAPH_MAX_MS);
+        const auto col = ms > TARGET_MS * 1.1 ? nvgRGB(220, 60, 60) : nvgRGB(60, 200, 90);
+        gfx::drawRect(vg, x + i * bar_w, y + GRAPH_H - h, bar_w, h, col);
+    }
+    const auto target_y = y + GRAPH_H - GRAPH_H * TARGET_MS / GRAPH_MAX_MS;
+    gfx::drawRect(vg, x, target_y, graph_w, 1, nvgRGBA(255, 255, 255, 120));
+    y += GRAPH_H + 6;
+
+    for (u32 i = 0; i < Phase_MAX; i++) {
+        gfx::drawTextArgs(vg, x + (i % 2) * (graph_w / 2), y, FONT_SIZE, align, info_col, "%s: %.2fms", PHASE_NAMES[i], ToMs(snapshot.phase_ns[i]));
+        if (i % 2) {
+            y += LINE_H;
+        }
+    }
+
+    for (const auto& e : snapshot.menus) {
+        gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "draw %s: %.2fms", e.name.c_str(), ToMs(e.ns));
+        y += LINE_H;
+    }
+
+    const auto dl = curl::GetStats();
+    gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "downloads active: %u queued: %u peak: %u dropped: %lu", dl.active, dl.queued, dl.queued_peak, dl.dropped);
+    y += LINE_H;
+
+    const auto decode = image::GetStats();
+    gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "image decode queued: %u waiting upload: %u", decode.queued, decode.decoded);
+    y += LINE_H;
+
+    gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "transfer: %.2f MiB/s", snapshot.transfer_speed / 1024.0 / 1024.0);
+    y += LINE_H;
+
+    gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "time to first frame: %.2fms", ToMs(snapshot.startup_ns));
+
+    for (const auto& e : metrics) {
+        y += LINE_H;
+        gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, e.success ? info_col : nvgRGB(220, 60, 60), "%s %ld http/%u%s %.1f KiB", e.host.c_str(), e.code, e.http_version, e.reused ? " reused" : "", e.bytes / 1024.0);
+        y += LINE_H;
+        gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "  queue: %.0f dns: %.0f tcp: %.0f tls: %.0f ttfb: %.0f total: %.0fms", ToMs(e.queue_ns), ToMs(e.dns_ns), ToMs(e.connect_ns), ToMs(e.tls_ns), ToMs(e.ttfb_ns), ToMs(e.total_ns));
+    }
+
+    if constexpr (utils::mem::IsEnabled) {
+        for (u32 i = 0; i < utils::mem::Tag_MAX; i++) {
+            y += LINE_H;
+            const auto tag = (utils::mem::Tag)i;
+            const auto stats = utils::mem::GetStats(tag);
+            gfx::drawTextArgs(vg, x, y, FONT_SIZE, align, info_col, "mem %s: %.2f MiB peak: %.2f MiB", utils::mem::GetName(tag), stats.current / 1024.0 / 1024.0, stats.peak / 1024.0 / 1024.0);
+        }
+    }
+}
+
+} // namespace sphaira::ui::profile
@@ -5,10 +5,13 @@
 #include "defines.hpp"
 #include "log.hpp"
 #include "threaded_file_transfer.hpp"
+#include "hasher.hpp"
+#include "transfer_tune.hpp"
 #include "i18n.hpp"
 
 #include "utils/utils.hpp"
 #include "utils/thread.hpp"
+#include "utils/profile.hpp"
 
 #include <cstring>
 #include <cmath>
@@ -16,6 +19,18 @@
 namespace sphaira::ui {
 namespace {
 
+// weight given to the latest sample when smoothing the speed.
+constexpr double SPEED_EMA_ALPHA = 0.3;
+// how often a paused worker checks if it was resumed or cancelled.
+constexpr u64 PAUSE_POLL_NS = 1e+8; // 100ms
+
+auto SmoothSpeed(s64 old_speed, s64 sample) -> s64 {
+    if (!old_speed) {
+        return sample;
+    }
+    return old_speed + (sample - old_speed) * SPEED_EMA_ALPHA;
+}
+
 void threadFunc(void* arg) {
     auto d = static_cast<ProgressBox::ThreadData*>(arg);
     d->result = d->callback(d->pbox);
@@ -26,14 +41,18 @@ void threadFunc(void* arg) {
 
 ProgressBox::ProgressBox(int image, const std::string& action, const std::string& title, const ProgressBoxCallback& callback, const ProgressBoxDoneCallback& done)
 : m_done{done}
-, m_action{action}
-, m_title{title}
 , m_image{image} {
     App::SetAutoSleepDisabled(true);
+    // plain copies / installs don't create a compute thread, so boost for
+    // the whole box, compute threads add their own ref on top.
     if (App::GetApp()->m_progress_boost_mode.Get()) {
+        m_boost = true;
         App::SetBoostMode(true);
     }
 
+    SetActionName(action);
+    SetTitle(title);
+
     SetAction(Button::B, Action{"Back"_i18n, [this](){
         App::Push<OptionBox>("Are you sure you wish to cancel?"_i18n, "No"_i18n, "Yes"_i18n, 1, [this](auto op_index){
             if (op_index && *op_index) {
@@ -77,11 +96,15 @@ ProgressBox::~ProgressBox() {
         m_done(m_thread_data.result);
     }
 
-    App::SetBoostMode(false);
+    if (m_boost) {
+        App::SetBoostMode(false);
+    }
     App::SetAutoSleepDisabled(false);
 }
 
 auto ProgressBox::Update(Controller* controller, TouchInfo* touch) -> void {
+    // the progress is updated from another thread, so keep drawing whilst open.
+    App::Invalidate();
     Widget::Update(controller, touch);
 
     if (ShouldExit()) {
@@ -90,31 +113,57 @@ auto ProgressBox::Update(Controller* controller, TouchInfo* touch) -> void {
 }
 
 auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
-    mutexLock(&m_mutex);
     std::vector<u8> image_data{};
-    std::swap(m_image_data, image_data);
+    auto image = m_image;
+
+    // images are rare, so skip them for a frame rather than wait on a writer.
+    if (mutexTryLock(&m_mutex)) {
+        std::swap(m_image_data, image_data);
+        if (m_is_image_pending) {
+            FreeImage();
+            image = m_image = m_image_pending;
+            m_image_pending = 0;
+            m_is_image_pending = false;
+        }
+        mutexUnlock(&m_mutex);
+    }
+
+    m_action.Get(m_ui_action_seq, m_ui_action);
+    m_title.Get(m_ui_title_seq, m_ui_title);
+    m_transfer.Get(m_ui_transfer_seq, m_ui_transfer);
+
+    const auto gen = m_transfer_gen.load(std::memory_order_acquire);
+    if (m_ui_transfer_gen != gen) {
+        m_ui_transfer_gen = gen;
+        m_last_offset = 0;
+        m_speed = 0;
+        std::memset(m_stage_last_offset, 0, sizeof(m_stage_last_offset));
+        std::memset(m_stage_speed, 0, sizeof(m_stage_speed));
+        m_timestamp.Update();
+    }
+
+    const auto size = m_size.load(std::memory_order_relaxed);
+    const auto offset = m_offset.load(std::memory_order_relaxed);
+
     if (m_timestamp.GetSeconds()) {
         m_timestamp.Update();
-        m_speed = m_offset - m_last_offset;
-        m_last_offset = m_offset;
+        m_speed = SmoothSpeed(m_speed, offset - m_last_offset);
+        m_last_offset = offset;
+
+        for (size_t i = 0; i < std::size(m_stage_offset); i++) {
+            const auto stage_offset = m_stage_offset[i].load(std::memory_order_relaxed);
+            m_stage_speed[i] = SmoothSpeed(m_stage_speed[i], stage_offset - m_stage_last_offset[i]);
+            m_stage_last_offset[i] = stage_offset;
+        }
     }
 
-    const auto action = m_action;
-    const auto title = m_title;
-    const auto transfer = m_transfer;
-    const auto size = m_size;
-    const auto offset = m_offset;
+    const auto& action = m_ui_action;
+    const auto& title = m_ui_title;
+    const auto& transfer = m_ui_transfer;
     const auto speed = m_speed;
     const auto last_offset = m_last_offset;
-    auto image = m_image;
-
-    if (m_is_image_pending) {
-        FreeImage();
-        image = m_image = m_image_pending;
-        m_image_pending = 0;
-        m_is_image_pending = false;
-    }
-    mutexUnlock(&m_mutex);
+    const auto has_stage = m_has_stage.load(std::memory_order_relaxed) && App::GetTransferShowStageSpeed();
+    const auto& stage_speed = m_stage_speed;
 
     if (!image_data.empty()) {
         FreeImage();
@@ -154,7 +203,7 @@ auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
         gfx::drawSpinner(vg, theme, prog_bar.x - pad - rad, prog_bar.y + prog_bar.h / 2, rad, armTicksToNs(armGetSystemTick()) / 1e+9);
 
         const auto left = size - last_offset;
-        const auto left_seconds = left / speed;
+        const auto left_seconds = speed > 0 ? left / speed : 0;
         const auto hours = left_seconds / (60 * 60);
         const auto minutes = left_seconds % (60 * 60) / 60;
         const auto seconds = left_seconds % 60;
@@ -169,6 +218,13 @@ auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
         }
 
         gfx::drawTextArgs(vg, center_x, prog_bar.y + prog_bar.h + 30, 18, NVG_ALIGN_CENTER | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT), "%s (%s)", time_str, utils::formatSizeNetwork(speed).c_str());
+
+        if (has_stage) {
+            gfx::drawTextArgs(vg, center_x, prog_bar.y - 30, 16, NVG_ALIGN_CENTER | NVG_ALIGN_BOTTOM, theme->GetColour(ThemeEntryID_TEXT_INFO), "R: %s D: %s W: %s",
+                utils::formatSizeNetwork(stage_speed[0]).c_str(),
+                utils::formatSizeNetwork(stage_speed[1]).c_str(),
+                utils::formatSizeNetwork(stage_speed[2]).c_str());
+        }
     }
 
     gfx::drawTextArgs(vg, center_x, m_pos.y + 40, 24, NVG_ALIGN_CENTER | NVG_ALIGN_TOP, theme->GetColour(ThemeEntryID_TEXT), action.c_str());
@@ -192,41 +248,87 @@ auto ProgressBox::Draw(NVGcontext* vg, Theme* theme) -> void {
     nvgRestore(vg);
 }
 
+void ProgressBox::SharedString::Set(const std::string& str) {
+    const auto seq = m_seq.load(std::memory_order_relaxed);
+    // odd whilst the buffer is being written.
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto len = std::min(str.length(), sizeof(m_buf) - 1);
+    std::memcpy(m_buf, str.data(), len);
+    m_buf[len] = '\0';
+
+    m_seq.store(seq + 2, std::memory_order_release);
+}
+
+bool ProgressBox::SharedString::Get(u32& seq, std::string& out) const {
+    const auto start = m_seq.load(std::memory_order_acquire);
+    if (start == seq || (start & 1)) {
+        return false;
+    }
+
+    char buf[sizeof(m_buf)];
+    std::memcpy(buf, m_buf, sizeof(buf));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // raced with a writer, try again next frame.
+    if (m_seq.load(std::memory_order_relaxed) != start) {
+        return false;
+    }
+
+    buf[sizeof(buf) - 1] = '\0';
+    out = buf;
+    seq = start;
+    return true;
+}
+
 auto ProgressBox::SetActionName(const std::string& action)  -> ProgressBox& {
     SCOPED_MUTEX(&m_mutex);
-    m_action = action;
+    m_action.Set(action);
     return *this;
 }
 
 auto ProgressBox::SetTitle(const std::string& title)  -> ProgressBox& {
     SCOPED_MUTEX(&m_mutex);
-    m_title = title;
+    m_title.Set(title);
     return *this;
 }
 
 auto ProgressBox::NewTransfer(const std::string& transfer)  -> ProgressBox& {
+    SetTransferName(transfer);
+    return ResetTranfser();
+}
+
+auto ProgressBox::SetTransferName(const std::string& transfer) -> ProgressBox& {
     SCOPED_MUTEX(&m_mutex);
-    m_transfer = transfer;
-    m_size = 0;
-    m_offset = 0;
-    m_last_offset = 0;
-    m_timestamp.Update();
+    m_transfer.Set(transfer);
     return *this;
 }
 
 auto ProgressBox::ResetTranfser() -> ProgressBox& {
-    SCOPED_MUTEX(&m_mutex);
-    m_size = 0;
-    m_offset = 0;
-    m_last_offset = 0;
-    m_timestamp.Update();
+    m_size.store(0, std::memory_order_relaxed);
+    m_offset.store(0, std::memory_order_relaxed);
+    for (auto& e : m_stage_offset) {
+        e.store(0, std::memory_order_relaxed);
+    }
+    m_has_stage.store(false, std::memory_order_relaxed);
+    m_transfer_gen.fetch_add(1, std::memory_order_release);
     return *this;
 }
 
 auto ProgressBox::UpdateTransfer(s64 offset, s64 size)  -> ProgressBox& {
-    SCOPED_MUTEX(&m_mutex);
-    m_size = size;
-    m_offset = offset;
+    WaitWhilePaused();
+    const auto old_offset = m_offset.exchange(offset, std::memory_order_relaxed);
+    utils::profile::AddTransferBytes(offset - old_offset);
+    m_size.store(size, std::memory_order_relaxed);
+    return *this;
+}
+
+auto ProgressBox::UpdateStageTransfer(s64 read, s64 decompress, s64 write) -> ProgressBox& {
+    m_stage_offset[0].store(read, std::memory_order_relaxed);
+    m_stage_offset[1].store(decompress, std::memory_order_relaxed);
+    m_stage_offset[2].store(write, std::memory_order_relaxed);
+    m_has_stage.store(true, std::memory_order_relaxed);
     return *this;
 }
 
@@ -272,6 +374,27 @@ auto ProgressBox::ShouldExitResult() -> Result {
     R_SUCCEED();
 }
 
+void ProgressBox::SetPaused(bool paused) {
+    m_paused = paused;
+}
+
+auto ProgressBox::IsPaused() const -> bool {
+    return m_paused;
+}
+
+auto ProgressBox::GetTitle(u32& seq, std::string& out) const -> bool {
+    return m_title.Get(seq, out);
+}
+
+auto ProgressBox::GetTransferName(u32& seq, std::string& out) const -> bool {
+    return m_transfer.Get(seq, out);
+}
+
+void ProgressBox::GetTransfer(s64& offset, s64& size) const {
+    offset = m_offset.load(std::memory_order_relaxed);
+    size = m_size.load(std::memory_order_relaxed);
+}
+
 void ProgressBox::AddCancelEvent(UEvent* event) {
     if (!event) {
         return;
@@ -292,7 +415,7 @@ void ProgressBox::RemoveCancelEvent(const UEvent* event) {
     m_cancel_events.erase(std::remove(m_cancel_events.begin(), m_cancel_events.end(), event), m_cancel_events.end());
 }
 
-auto ProgressBox::CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src_path, const fs::FsPath& dst_path, bool single_threaded) -> Result {
+auto ProgressBox::CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src_path, const fs::FsPath& dst_path, bool single_threaded, bool parallel_read, bool verify) -> Result {
     const auto is_file_based_emummc = App::IsFileBaseEmummc();
     const auto is_both_native = fs_src->IsNative() && fs_dst->IsNative();
 
@@ -311,26 +434,108 @@ auto ProgressBox::CopyFile(fs::Fs* fs_src, fs::Fs* fs_dst, const fs::FsPath& src
     R_TRY(fs_dst->OpenFile(dst_path, FsOpenMode_Write, &dst_file));
     R_TRY(dst_file.SetSize(src_size));
 
-    R_TRY(thread::Transfer(this, src_size,
-        [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
-            const auto rc = src_file.Read(off, data, size, 0, bytes_read);
+    // native files can be read from multiple threads using the same handle, so always
+    // keep multiple reads in flight, unless the file based emummc needs throttling.
+    if (fs_src->IsNative() && !(is_both_native && is_file_based_emummc)) {
+        parallel_read = true;
+    }
+
+    auto mode = thread::Mode::MultiThreaded;
+    if (single_threaded) {
+        mode = thread::Mode::SingleThreaded;
+    } else if (parallel_read) {
+        mode = thread::Mode::ParallelRead;
+    }
 
-            if (is_both_native && is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
+    // stdio files share the file position, so each read thread needs its own handle.
+    const auto use_file_pool = mode == thread::Mode::ParallelRead && !fs_src->IsNative();
+    std::vector<std::unique_ptr<fs::File>> file_pool{};
+    Mutex file_pool_mutex{};
+
+    const auto read_from_pool = [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+        std::unique_ptr<fs::File> file{};
+        {
+            SCOPED_MUTEX(&file_pool_mutex);
+            if (!file_pool.empty()) {
+                file = std::move(file_pool.back());
+                file_pool.pop_back();
             }
+        }
+
+        if (!file) {
+            file = std::make_unique<fs::File>();
+            R_TRY(fs_src->OpenFile(src_path, FsOpenMode_Read, file.get()));
+        }
 
-            return rc;
-        },
-        [&](const void* data, s64 off, s64 size) -> Result {
-            const auto rc = dst_file.Write(off, data, size, 0);
+        ON_SCOPE_EXIT(
+            SCOPED_MUTEX(&file_pool_mutex);
+            file_pool.emplace_back(std::move(file));
+        );
 
-            if (is_both_native && is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
-            }
+        return file->Read(off, data, size, 0, bytes_read);
+    };
+
+    const auto read_func = [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+        if (use_file_pool) {
+            return read_from_pool(data, off, size, bytes_read);
+        }
 
-            return rc;
-        }, single_threaded ? thread::Mode::SingleThreaded : thread::Mode::MultiThreaded
-    ));
+        const auto start = armGetSystemTick();
+        const auto rc = src_file.Read(off, data, size, 0, bytes_read);
+
+        if (is_both_native && is_file_based_emummc) {
+            thread::EmummcThrottle(start);
+        }
+
+        return rc;
+    };
+
+    const auto write_func = [&](const void* data, s64 off, s64 size) -> Result {
+        const auto start = armGetSystemTick();
+        const auto rc = dst_file.Write(off, data, size, 0);
+
+        if (is_both_native && is_file_based_emummc) {
+            thread::EmummcThrottle(start);
+        }
+
+        return rc;
+    };
+
+    thread::PipelineConfig config{};
+    config.tune_route = thread::tune::MakeRoute(fs_src, fs_dst);
+
+    std::unique_ptr<hash::HashSource> src_hash{};
+    if (verify) {
+        // the stages are called in order, so the src can be hashed from the
+        // data that is already in memory, rather than reading it a second time.
+        // this runs on the decompress thread, so the hash doesn't hold up the write.
+        src_hash = hash::Create(hash::Type::Sha256);
+        const auto hash_stage = thread::PeekStage{[hash = src_hash.get(), src_size](const void* data, s64 size) {
+            hash->Update(data, size, src_size);
+        }};
+
+        R_TRY(thread::Transfer(this, src_size, read_func, thread::Pipeline{hash_stage}, write_func, config, mode));
+    } else {
+        // plain copies skip the decompress thread.
+        R_TRY(thread::Transfer(this, src_size, read_func, nullptr, write_func, config, mode));
+    }
+
+    if (verify) {
+        // close first so that everything is flushed before reading it back.
+        src_file.Close();
+        R_TRY(dst_file.Close());
+
+        std::string src_str, dst_str;
+        src_hash->Get(src_str);
+
+        NewTransfer(i18n::Reorder("Verifying ", dst_path));
+        R_TRY(hash::Hash(this, hash::Type::Sha256, fs_dst, dst_path, dst_str));
+
+        if (src_str != dst_str) {
+            log_write("[COPY] verify failed: %s src: %s dst: %s\n", dst_path.s, src_str.c_str(), dst_str.c_str());
+            R_THROW(Result_CopyVerifyFailed);
+        }
+    }
 
     R_SUCCEED();
 }
@@ -346,9 +551,16 @@ auto ProgressBox::CopyFile(const fs::FsPath& src_path, const fs::FsPath& dst_pat
 }
 
 void ProgressBox::Yield() {
+    WaitWhilePaused();
     svcSleepThread(YieldType_WithoutCoreMigration);
 }
 
+void ProgressBox::WaitWhilePaused() {
+    while (m_paused && !ShouldExit()) {
+        svcSleepThread(PAUSE_POLL_NS);
+    }
+}
+
 void ProgressBox::FreeImage() {
     if (m_image && m_own_image) {
         nvgDeleteImage(App::GetVg(), m_image);
@@ -37,15 +37,13 @@ void ScrollingText::Draw(NVGcontext* vg, bool focus, float x, float y, float w,
 
     float bounds[4];
     auto value_str = text_entry;
-    nvgFontSize(vg, size);
-    nvgTextAlign(vg, align);
-    nvgTextBounds(vg, 0, 0, value_str.c_str(), nullptr, bounds);
+    gfx::textBoundsCached(vg, size, align, value_str.c_str(), bounds);
 
     if (focus) {
         const auto scroll_amount = GetTextScrollSpeed();
         if (bounds[2] > w) {
             value_str += "        ";
-            nvgTextBounds(vg, 0, 0, value_str.c_str(), nullptr, bounds);
+            gfx::textBoundsCached(vg, size, align, value_str.c_str(), bounds);
 
             if (!m_text_xoff) {
                 m_tick++;
@@ -55,10 +55,7 @@ void SidebarEntryBase::Draw(NVGcontext* vg, Theme* theme, const Vec4& root_pos,
             const auto end_w = info_box.w - info_pad * 2;
 
             float bounds[4];
-            nvgFontSize(vg, info_font_size);
-            nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-            nvgTextLineHeight(vg, 1.7);
-            nvgTextBoxBounds(vg, 0, 0, end_w, info.c_str(), nullptr, bounds);
+            gfx::textBoxBoundsCached(vg, info_font_size, NVG_ALIGN_LEFT | NVG_ALIGN_TOP, 1.7, end_w, info.c_str(), bounds);
             info_box.h = pad_after_title + info_pad * 2 + bounds[3] - bounds[1];
 
             gfx::drawRect(vg, info_box, theme->GetColour(ThemeEntryID_SIDEBAR), 5);
@@ -86,13 +83,11 @@ void SidebarEntryBase::DrawEntry(NVGcontext* vg, Theme* theme, const std::string
 
     // scrolling text
     float bounds[4];
-    nvgFontSize(vg, 20);
-    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
-    nvgTextBounds(vg, 0, 0, left.c_str(), nullptr, bounds);
+    gfx::textBoundsCached(vg, 20, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, left.c_str(), bounds);
     const float start_x = bounds[2] + 50;
     const float max_off = m_pos.w - start_x - 15.f;
 
-    nvgTextBounds(vg, 0, 0, right.c_str(), nullptr, bounds);
+    gfx::textBoundsCached(vg, 20, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE, right.c_str(), bounds);
 
     const Vec2 key_text_pos{m_pos.x + 15.f, m_pos.y + (m_pos.h / 2.f)};
     gfx::drawText(vg, key_text_pos, 20.f, theme->GetColour(colour_id), left.c_str(), NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
@@ -22,6 +22,8 @@
 #include "app.hpp"
 #include <ranges>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 namespace sphaira::usb {
 namespace {
@@ -30,8 +32,24 @@ constexpr u64 TRANSFER_ALIGN = 0x1000;
 constexpr u64 TRANSFER_MAX = 1024*1024*16;
 static_assert(!(TRANSFER_MAX % TRANSFER_ALIGN));
 
+// each transfer kept in flight by TransferStream() uses a slice of the aligned
+// buffer, so a deeper queue doesn't use any more memory.
+// the slice must be a multiple of the max packet size, so only the last transfer can be short.
+static_assert(!((TRANSFER_MAX / Base::STREAM_QUEUE_DEPTH_MAX) % TRANSFER_ALIGN));
+
+// the buffer can be used for dma directly if it's page aligned, such as buffers
+// from the pool. the size must be aligned too, so that no cache line of the
+// buffer is shared with other data while the transfer is in flight.
+auto CanTransferDirect(const void* data, u32 size) -> bool {
+    return !((u64)data & (TRANSFER_ALIGN - 1)) && !(size & (TRANSFER_ALIGN - 1));
+}
+
 } // namespace
 
+auto Base::GetStreamSlotSize(u32 queue_depth) -> u32 {
+    return (TRANSFER_MAX / queue_depth) & ~(TRANSFER_ALIGN - 1);
+}
+
 Base::Base(u64 transfer_timeout) {
     App::SetAutoSleepDisabled(true);
 
@@ -61,23 +79,20 @@ Result Base::TransferPacketImpl(bool read, void *page, u32 remaining, u32 size,
     return GetTransferResult(ep, xfer_id, nullptr, out_size_transferred);
 }
 
-// while it may seem like a bad idea to transfer data to a buffer and copy it
-// in practice, this has no impact on performance.
-// the switch is *massively* bottlenecked by slow io (nand and sd).
-// so making usb transfers zero-copy provides no benefit other than increased
-// code complexity and the increase of future bugs if/when sphaira is forked
-// an changes are made.
-// yati already goes to great lengths to be zero-copy during installing
-// by swapping buffers and inflating in-place.
+// unaligned data is copied through an aligned buffer, aligned data (such as
+// the pool buffers used by yati and the dumper) is transferred in place,
+// which saves a full memory pass per byte.
 Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
     auto buf = static_cast<u8*>(data);
-    auto transfer_buf = *m_aligned;
 
-    R_UNLESS(!((u64)transfer_buf & 0xFFF), Result_UsbBadBufferAlign);
+    R_UNLESS(!((u64)*m_aligned & 0xFFF), Result_UsbBadBufferAlign);
     R_UNLESS(size <= TRANSFER_MAX, Result_UsbBadTransferSize);
 
     while (size) {
-        if (!read) {
+        const auto direct = CanTransferDirect(buf, size);
+        const auto transfer_buf = direct ? buf : *m_aligned;
+
+        if (!read && !direct) {
             std::memcpy(transfer_buf, buf, size);
         }
 
@@ -86,7 +101,7 @@ Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
         R_UNLESS(out_size_transferred > 0, Result_UsbEmptyTransferSize);
         R_UNLESS(out_size_transferred <= size, Result_UsbOverflowTransferSize);
 
-        if (read) {
+        if (read && !direct) {
             std::memcpy(buf, transfer_buf, out_size_transferred);
         }
 
@@ -97,4 +112,111 @@ Result Base::TransferAll(bool read, void *data, u32 size, u64 timeout) {
     R_SUCCEED();
 }
 
+Result Base::TransferStream(bool read, void *data, u32 size, u64 timeout, u32 queue_depth) {
+    R_UNLESS(queue_depth && queue_depth <= STREAM_QUEUE_DEPTH_MAX, Result_UsbBadTransferSize);
+    const auto slot_size = GetStreamSlotSize(queue_depth);
+
+    // nothing to overlap.
+    if (size <= slot_size) {
+        return TransferAll(read, data, size, timeout);
+    }
+
+    auto buf = static_cast<u8*>(data);
+    auto transfer_buf = *m_aligned;
+
+    R_UNLESS(!((u64)transfer_buf & 0xFFF), Result_UsbBadBufferAlign);
+    R_UNLESS(size <= TRANSFER_MAX, Result_UsbBadTransferSize);
+
+    /* If we're not configured yet, wait to become configured first. */
+    R_TRY(IsUsbConnected(timeout));
+
+    struct Pending {
+        u32 xfer_id;
+        u8* slot;
+        u32 size;
+        bool direct;
+    };
+
+    const auto ep = read ? UsbSessionEndpoint_Out : UsbSessionEndpoint_In;
+    Pending pending[STREAM_QUEUE_DEPTH_MAX];
+    std::vector<TransferReport> reports;
+    u32 head{}, count{}, next_slot{};
+    // bytes posted and bytes completed, these only differ by what's in flight.
+    u32 posted{}, done{};
+
+    while (done < size) {
+        // keep the queue full, the slots rotate so a slot is only reused once its transfer completed.
+        while (count < queue_depth && posted < size) {
+            auto& e = pending[(head + count) % queue_depth];
+            e.size = std::min<u32>(slot_size, size - posted);
+            e.direct = CanTransferDirect(buf + posted, e.size);
+
+            if (e.direct) {
+                e.slot = buf + posted;
+            } else {
+                e.slot = transfer_buf + next_slot * slot_size;
+                if (!read) {
+                    std::memcpy(e.slot, buf + posted, e.size);
+                }
+            }
+
+            // the slot is skipped when direct, so the rotation stays in step with the queue.
+            next_slot = (next_slot + 1) % queue_depth;
+
+            R_TRY(TransferAsync(ep, e.slot, size - posted, e.size, &e.xfer_id));
+            posted += e.size;
+            count++;
+        }
+
+        // transfers complete in order, so only the oldest needs to be waited on.
+        const auto& e = pending[head];
+        u32 transferred_size{};
+        for (;;) {
+            R_TRY(GetTransferReports(ep, reports));
+
+            const auto it = std::ranges::find_if(reports, [&e](auto& r){
+                return r.xfer_id == e.xfer_id;
+            });
+
+            if (it != reports.end()) {
+                const auto report = *it;
+                reports.erase(it);
+                R_TRY(report.rc);
+
+                transferred_size = report.transferred_size;
+                R_UNLESS(transferred_size > 0, Result_UsbEmptyTransferSize);
+                R_UNLESS(transferred_size <= e.size, Result_UsbOverflowTransferSize);
+                // a short transfer is only fine if nothing was posted after it,
+                // otherwise the data in the later transfers is in the wrong place.
+                R_UNLESS(transferred_size == e.size || count == 1, Result_UsbShortTransfer);
+                break;
+            }
+
+            // drop reports for transfers that aren't in flight anymore.
+            std::erase_if(reports, [&](auto& r){
+                for (u32 i = 0; i < count; i++) {
+                    if (pending[(head + i) % queue_depth].xfer_id == r.xfer_id) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+
+            R_TRY(WaitTransferCompletion(ep, timeout));
+        }
+
+        if (read && !e.direct) {
+            std::memcpy(buf + done, e.slot, transferred_size);
+        }
+
+        // the rest of a short transfer is posted again.
+        done += transferred_size;
+        posted -= e.size - transferred_size;
+        head = (head + 1) % queue_depth;
+        count--;
+    }
+
+    R_SUCCEED();
+}
+
 } // namespace sphaira::usb
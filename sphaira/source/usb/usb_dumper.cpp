@@ -28,36 +28,97 @@ Result Usb::IsUsbConnected(u64 timeout) {
     return m_usb->IsUsbConnected(timeout);
 }
 
-Result Usb::WaitForConnection(std::string_view path, u64 timeout) {
+Result Usb::WaitForConnection(std::string_view path, u64 timeout, bool session) {
     m_was_connected = false;
 
     // ensure that we are connected.
     R_TRY(m_open_result);
     R_TRY(m_usb->IsUsbConnected(timeout));
 
-    const auto send_header = SendPacket::Build(CMD_EXPORT, path.length());
-    R_TRY(SendAndVerify(&send_header, sizeof(send_header), timeout));
+    const auto want_caps = CAP_STREAM | (session ? CAP_SESSION : CAP_NONE);
+    const auto send_header = SendPacket::Build(CMD_EXPORT, path.length(), want_caps);
+    ResultPacket recv_header;
+    R_TRY(SendAndVerify(&send_header, sizeof(send_header), timeout, &recv_header));
+
+    // an old host doesn't set arg4.
+    m_caps = recv_header.arg4 & want_caps;
     R_TRY(SendAndVerify(path.data(), path.length(), timeout));
 
+    m_file_id = 0;
+    m_file_off = 0;
     m_was_connected = true;
     R_SUCCEED();
 }
 
+Result Usb::OpenFile(std::string_view path) {
+    R_UNLESS(IsSession(), Result_UsbBadTransferSize);
+
+    auto send_header = SendPacket::Build(CMD_EXPORT_OPEN, ++m_file_id, path.length());
+    R_TRY(m_usb->TransferAll(false, &send_header, sizeof(send_header)));
+
+    // casts away const, but it does not modify the buffer!
+    R_TRY(m_usb->TransferAll(false, const_cast<char*>(path.data()), path.length()));
+
+    m_file_off = 0;
+    R_SUCCEED();
+}
+
 Result Usb::CloseFile() {
+    // the host closes the file whilst the next one is sent.
+    if (IsSession()) {
+        auto send_header = SendPacket::Build(CMD_EXPORT_CLOSE, m_file_id);
+        return m_usb->TransferAll(false, &send_header, sizeof(send_header));
+    }
+
     const auto send_header = SendDataPacket::Build(0, 0, 0);
 
     return SendAndVerify(&send_header, sizeof(send_header));
 }
 
+Result Usb::EndSession() {
+    if (!IsSession() || !m_was_connected) {
+        R_SUCCEED();
+    }
+
+    // the host replies with RESULT_ERROR if any file failed.
+    const auto send_header = SendPacket::Build(CMD_QUIT);
+    m_was_connected = false;
+    return SendAndVerify(&send_header, sizeof(send_header));
+}
+
 void Usb::SignalCancel() {
     m_usb->Cancel();
 }
 
 Result Usb::Write(const void* buf, u64 off, u32 size) {
-    const auto send_header = SendDataPacket::Build(off, size, crc32cCalculate(buf, size));
+    // the host appends to the file, so it has to be written in order.
+    if (IsSession()) {
+        R_UNLESS(off == m_file_off, Result_UsbBadTransferSize);
+
+        auto send_header = SendPacket::Build(CMD_EXPORT_DATA, m_file_id, size, crc32cCalculate(buf, size));
+        R_TRY(m_usb->TransferAll(false, &send_header, sizeof(send_header)));
+
+        // casts away const, but it does not modify the buffer!
+        R_TRY(m_usb->TransferStream(false, const_cast<void*>(buf), size));
+        m_file_off += size;
+        R_SUCCEED();
+    }
+
+    auto send_header = SendDataPacket::Build(off, size, crc32cCalculate(buf, size));
+
+    // the data follows the header without waiting for a result.
+    if (m_caps & CAP_STREAM) {
+        R_TRY(m_usb->TransferAll(false, &send_header, sizeof(send_header)));
+    } else {
+        R_TRY(SendAndVerify(&send_header, sizeof(send_header)));
+    }
+
+    // casts away const, but it does not modify the buffer!
+    R_TRY(m_usb->TransferStream(false, const_cast<void*>(buf), size));
 
-    R_TRY(SendAndVerify(&send_header, sizeof(send_header)));
-    return SendAndVerify(buf, size);
+    ResultPacket recv_header;
+    R_TRY(m_usb->TransferAll(true, &recv_header, sizeof(recv_header)));
+    return recv_header.Verify();
 }
 
 // casts away const, but it does not modify the buffer!
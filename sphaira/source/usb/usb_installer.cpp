@@ -2,14 +2,19 @@
 #include "usb/usb_api.hpp"
 #include "defines.hpp"
 #include "log.hpp"
+#include "utils/zstd_pool.hpp"
 
 #include <ranges>
+#include <algorithm>
 
 namespace sphaira::usb::install {
 namespace {
 
 using namespace usb::api;
 
+// max number of chunks the host is asked to stream per request.
+constexpr u32 STREAM_CHUNK_COUNT = 8;
+
 } // namespace
 
 Usb::Usb(u64 transfer_timeout) {
@@ -35,10 +40,14 @@ Result Usb::WaitForConnection(u64 timeout, std::vector<std::string>& out_names)
     R_TRY(m_open_result);
     R_TRY(m_usb->IsUsbConnected(timeout));
 
-    const auto send_header = SendPacket::Build(RESULT_OK);
+    const auto send_header = SendPacket::Build(RESULT_OK, CAP_STREAM | CAP_ZSTD | CAP_BENCH);
     ResultPacket recv_header;
     R_TRY(SendAndVerify(&send_header, sizeof(send_header), timeout, &recv_header))
 
+    // an old host doesn't set arg4.
+    m_caps = recv_header.arg4 & (CAP_STREAM | CAP_ZSTD | CAP_BENCH);
+    log_write("[USB] caps: 0x%X\n", m_caps);
+
     std::vector<char> names(recv_header.arg3);
     R_TRY(m_usb->TransferAll(true, names.data(), names.size(), timeout));
 
@@ -67,15 +76,50 @@ Result Usb::OpenFile(u32 index, s64& file_size) {
 
     m_flags = flags;
     file_size = ((u64)file_size_msb << 32) | file_size_lsb;
+    m_file_size = file_size;
+    m_stream_pending = 0;
     R_SUCCEED();
 }
 
 Result Usb::CloseFile() {
+    R_TRY(DrainStream());
+
     const auto send_header = SendDataPacket::Build(0, 0, 0);
 
     return SendAndVerify(&send_header, sizeof(send_header));
 }
 
+Result Usb::Bench(u32 mode, u32 size, u32 count, u32 queue_depth, BenchResult& out) {
+    R_UNLESS(m_caps & CAP_BENCH, Result_UsbBenchNotSupported);
+    R_UNLESS(mode == BENCH_DOWNLOAD || mode == BENCH_UPLOAD, Result_UsbBenchNotSupported);
+
+    // same buffers that installs read into, so the transfers are done in place.
+    utils::pool::Vector<u8> buf(size);
+
+    const auto send_header = SendPacket::BuildBench(mode, size, count);
+    R_TRY(SendAndVerify(&send_header, sizeof(send_header)));
+
+    out.latency_ns.clear();
+    out.latency_ns.reserve(count);
+    const auto start = armGetSystemTick();
+
+    for (u32 i = 0; i < count; i++) {
+        const auto transfer_start = armGetSystemTick();
+        R_TRY(m_usb->TransferStream(mode == BENCH_DOWNLOAD, buf.data(), buf.size(), m_usb->GetTransferTimeout(), queue_depth));
+        out.latency_ns.emplace_back(armTicksToNs(armGetSystemTick() - transfer_start));
+    }
+
+    // the last upload may still be on its way, so wait until the host has it.
+    if (mode == BENCH_UPLOAD) {
+        ResultPacket recv_header;
+        R_TRY(m_usb->TransferAll(true, &recv_header, sizeof(recv_header)));
+        R_TRY(recv_header.Verify());
+    }
+
+    out.total_ns = armTicksToNs(armGetSystemTick() - start);
+    R_SUCCEED();
+}
+
 void Usb::SignalCancel() {
     m_usb->Cancel();
 }
@@ -85,13 +129,17 @@ u32 Usb::GetFlags() const {
 }
 
 Result Usb::Read(void* buf, u64 off, u32 size, u64* bytes_read) {
+    if (m_caps & CAP_STREAM) {
+        return ReadStream(buf, off, size, bytes_read);
+    }
+
     const auto send_header = SendDataPacket::Build(off, size, 0);
     ResultPacket recv_header;
     R_TRY(SendAndVerify(&send_header, sizeof(send_header), &recv_header))
 
     // adjust the size and read the data.
     size = recv_header.arg3;
-    R_TRY(m_usb->TransferAll(true, buf, size));
+    R_TRY(m_usb->TransferStream(true, buf, size));
 
     // verify crc32c.
     R_UNLESS(crc32cCalculate(buf, size) == recv_header.arg4, 3);
@@ -100,6 +148,85 @@ Result Usb::Read(void* buf, u64 off, u32 size, u64* bytes_read) {
     R_SUCCEED();
 }
 
+Result Usb::ReadStream(void* buf, u64 off, u32 size, u64* bytes_read) {
+    // the chunks already sent only help if this read carries on from the last one.
+    if (m_stream_pending && (off != m_stream_off || size != m_stream_size)) {
+        R_TRY(DrainStream());
+    }
+
+    if (!m_stream_pending) {
+        // both sides know the file size, so the host stops at the same chunk.
+        const auto remaining = std::max<s64>(0, m_file_size - (s64)off);
+        const auto count = std::clamp<s64>((remaining + size - 1) / size, 1, STREAM_CHUNK_COUNT);
+
+        // no result is sent back, the first chunk header follows instead.
+        auto send_header = SendDataPacket::BuildStream(off, size, count);
+        R_TRY(m_usb->TransferAll(false, &send_header, sizeof(send_header)));
+
+        m_stream_off = off;
+        m_stream_size = size;
+        m_stream_pending = count;
+    }
+
+    R_TRY(ReceiveChunk(buf, size, bytes_read));
+    m_stream_off += size;
+    R_SUCCEED();
+}
+
+Result Usb::ReceiveChunk(void* buf, u32 size, u64* bytes_read) {
+    R_UNLESS(m_stream_pending, Result_UsbBadTransferSize);
+    m_stream_pending--;
+
+    ResultPacket recv_header;
+    R_TRY(m_usb->TransferAll(true, &recv_header, sizeof(recv_header)));
+    R_TRY(recv_header.Verify());
+
+    const auto wire_size = recv_header.arg3;
+    const auto decompressed_size = recv_header.GetDecompressedSize();
+
+    if (decompressed_size) {
+        R_UNLESS(m_caps & CAP_ZSTD, Result_UsbBadZstdChunk);
+        R_UNLESS(decompressed_size <= size && wire_size <= size, Result_UsbBadTransferSize);
+
+        m_chunk_buf.resize(wire_size);
+        R_TRY(m_usb->TransferStream(true, m_chunk_buf.data(), wire_size));
+
+        utils::zstd::DCtx dctx{utils::zstd::AcquireDCtx()};
+        R_UNLESS(dctx, Result_UsbBadZstdChunk);
+
+        const auto res = ZSTD_decompressDCtx(dctx.get(), buf, decompressed_size, m_chunk_buf.data(), wire_size);
+        if (ZSTD_isError(res) || res != decompressed_size) {
+            log_write("[USB] ZSTD_decompressDCtx() size: %u res: %zd msg: %s\n", wire_size, res, ZSTD_getErrorName(res));
+            R_THROW(Result_UsbBadZstdChunk);
+        }
+
+        *bytes_read = decompressed_size;
+    } else {
+        R_UNLESS(wire_size <= size, Result_UsbBadTransferSize);
+        R_TRY(m_usb->TransferStream(true, buf, wire_size));
+        *bytes_read = wire_size;
+    }
+
+    // verify crc32c of the decompressed data.
+    R_UNLESS(crc32cCalculate(buf, *bytes_read) == recv_header.arg4, 3);
+    R_SUCCEED();
+}
+
+Result Usb::DrainStream() {
+    if (!m_stream_pending) {
+        R_SUCCEED();
+    }
+
+    log_write("[USB] draining %u chunks from: %zu\n", m_stream_pending, m_stream_off);
+    utils::pool::Vector<u8> discard(m_stream_size);
+    while (m_stream_pending) {
+        u64 bytes_read;
+        R_TRY(ReceiveChunk(discard.data(), discard.size(), &bytes_read));
+    }
+
+    R_SUCCEED();
+}
+
 // casts away const, but it does not modify the buffer!
 Result Usb::SendAndVerify(const void* data, u32 size, u64 timeout, ResultPacket* out) {
     R_TRY(m_usb->TransferAll(false, const_cast<void*>(data), size, timeout));
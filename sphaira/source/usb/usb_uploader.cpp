@@ -2,6 +2,9 @@
 #include "usb/usb_api.hpp"
 #include "log.hpp"
 #include "defines.hpp"
+#include "utils/thread.hpp"
+
+#include <algorithm>
 
 namespace sphaira::usb::upload {
 namespace {
@@ -38,9 +41,23 @@ using namespace usb::api;
 Usb::Usb(u64 transfer_timeout) {
     m_usb = std::make_unique<usb::UsbHs>(INDEX, FILTER, transfer_timeout);
     m_usb->Init();
+
+    mutexInit(&m_prefetch.mutex);
+    condvarInit(&m_prefetch.can_read);
+    condvarInit(&m_prefetch.can_take);
 }
 
 Usb::~Usb() {
+    if (m_prefetch.running) {
+        {
+            SCOPED_MUTEX(&m_prefetch.mutex);
+            m_prefetch.exit = true;
+            condvarWakeOne(&m_prefetch.can_read);
+        }
+
+        threadWaitForExit(&m_prefetch.thread);
+        threadClose(&m_prefetch.thread);
+    }
 }
 
 Result Usb::WaitForConnection(u64 timeout, std::span<const std::string> names) {
@@ -79,6 +96,10 @@ Result Usb::PollCommands() {
         u16 flags;
         R_TRY(Open(send_header.arg3, file_size, flags));
 
+        // anything prefetched was for the previous file.
+        m_file_size = file_size;
+        m_prefetch.valid = false;
+
         const auto size_lsb = file_size & 0xFFFFFFFF;
         const auto size_msb = ((file_size >> 32) & 0xFFFF) | (flags << 16);
         return SendResult(RESULT_OK, size_msb, size_lsb);
@@ -102,28 +123,123 @@ Result Usb::file_transfer_loop() {
         return Result_UsbUploadExit;
     }
 
-    // read file and calculate the hash.
-    u64 bytes_read;
-    m_buf.resize(send_header.GetSize());
-    log_write("reading buffer: %zu\n", m_buf.size());
+    const auto offset = send_header.GetOffset();
+    const auto size = send_header.GetSize();
+
+    // read file and calculate the hash, unless it was already prefetched.
+    u32 crc32;
+    if (!TakePrefetch(offset, size, crc32)) {
+        u64 bytes_read;
+        m_buf.resize(size);
+        log_write("reading buffer: %zu\n", m_buf.size());
+
+        R_TRY(Read(m_buf.data(), offset, m_buf.size(), &bytes_read));
+        crc32 = crc32Calculate(m_buf.data(), m_buf.size());
+        log_write("read the buffer: %zu\n", bytes_read);
+    }
 
-    R_TRY(Read(m_buf.data(), send_header.GetOffset(), m_buf.size(), &bytes_read));
-    const auto crc32 = crc32Calculate(m_buf.data(), m_buf.size());
+    // the prefetch only runs whilst this chunk is sent, so that Read() is
+    // never called once this returns.
+    const auto next_offset = offset + m_buf.size();
+    if (next_offset < m_file_size) {
+        const auto next_size = std::min<s64>(m_buf.size(), m_file_size - next_offset);
+        if (R_FAILED(StartPrefetch(next_offset, next_size))) {
+            log_write("[USB] failed to start prefetch\n");
+        }
+    }
+    ON_SCOPE_EXIT(WaitForPrefetch());
 
-    log_write("read the buffer: %zu\n", bytes_read);
     // respond back with the length of the data and the crc32.
     R_TRY(SendResult(RESULT_OK, m_buf.size(), crc32));
 
     log_write("sent result with crc\n");
 
     // send the data.
-    R_TRY(m_usb->TransferAll(false, m_buf.data(), m_buf.size()));
+    R_TRY(m_usb->TransferStream(false, m_buf.data(), m_buf.size()));
 
     log_write("sent the data\n");
 
     R_SUCCEED();
 }
 
+Result Usb::StartPrefetch(u64 off, u32 size) {
+    if (!m_prefetch.running) {
+        R_TRY(utils::CreateThread(&m_prefetch.thread, prefetch_thread_func, this, utils::ThreadRole::Io));
+        if (const auto rc = threadStart(&m_prefetch.thread); R_FAILED(rc)) {
+            threadClose(&m_prefetch.thread);
+            R_THROW(rc);
+        }
+
+        m_prefetch.running = true;
+    }
+
+    SCOPED_MUTEX(&m_prefetch.mutex);
+    m_prefetch.off = off;
+    m_prefetch.size = size;
+    m_prefetch.valid = false;
+    m_prefetch.pending = true;
+    condvarWakeOne(&m_prefetch.can_read);
+    R_SUCCEED();
+}
+
+bool Usb::TakePrefetch(u64 off, u32 size, u32& crc32) {
+    WaitForPrefetch();
+
+    SCOPED_MUTEX(&m_prefetch.mutex);
+    if (!m_prefetch.valid) {
+        return false;
+    }
+
+    // out of order or failed reads are read again, so the error comes from
+    // the read that was actually requested.
+    m_prefetch.valid = false;
+    if (R_FAILED(m_prefetch.rc) || m_prefetch.off != off || m_prefetch.size != size) {
+        log_write("[USB] prefetch miss: off: %zu size: %u\n", off, size);
+        return false;
+    }
+
+    std::swap(m_buf, m_prefetch.buf);
+    crc32 = m_prefetch.crc32;
+    return true;
+}
+
+void Usb::WaitForPrefetch() {
+    SCOPED_MUTEX(&m_prefetch.mutex);
+    while (m_prefetch.pending) {
+        condvarWait(&m_prefetch.can_take, &m_prefetch.mutex);
+    }
+}
+
+void Usb::prefetch_thread_func(void* arg) {
+    auto t = static_cast<Usb*>(arg);
+    auto& p = t->m_prefetch;
+
+    SCOPED_MUTEX(&p.mutex);
+    while (true) {
+        while (!p.pending && !p.exit) {
+            condvarWait(&p.can_read, &p.mutex);
+        }
+
+        if (!p.pending) {
+            break;
+        }
+
+        // the buffer isn't touched by anyone else until the read is complete.
+        mutexUnlock(&p.mutex);
+        u64 bytes_read;
+        p.buf.resize(p.size);
+        p.rc = t->Read(p.buf.data(), p.off, p.buf.size(), &bytes_read);
+        if (R_SUCCEEDED(p.rc)) {
+            p.crc32 = crc32Calculate(p.buf.data(), p.buf.size());
+        }
+        mutexLock(&p.mutex);
+
+        p.valid = true;
+        p.pending = false;
+        condvarWakeOne(&p.can_take);
+    }
+}
+
 Result Usb::SendResult(u32 result, u32 arg3, u32 arg4) {
     auto recv_header = api::ResultPacket::Build(result, arg3, arg4);
     return m_usb->TransferAll(false, &recv_header, sizeof(recv_header));
@@ -3,6 +3,7 @@
 #include "defines.hpp"
 #include <ranges>
 #include <cstring>
+#include <algorithm>
 
 auto GetUsbDsStateStr(UsbState state) -> const char* {
     switch (state) {
@@ -328,4 +329,27 @@ Result UsbDs::GetTransferResult(UsbSessionEndpoint ep, u32 urb_id, u32 *out_requ
     R_SUCCEED();
 }
 
+Result UsbDs::GetTransferReports(UsbSessionEndpoint ep, std::vector<TransferReport>& out) {
+    UsbDsReportData report_data;
+
+    R_TRY(eventClear(GetCompletionEvent(ep)));
+    R_TRY(usbDsEndpoint_GetReportData(m_endpoints[ep], std::addressof(report_data)));
+
+    const auto count = std::min<u32>(report_data.report_count, std::size(report_data.report));
+    for (u32 i = 0; i < count; i++) {
+        const auto& e = report_data.report[i];
+
+        // 3 = complete, 4 = failed / cancelled, anything else is still pending.
+        if (e.urb_status != 0x3 && e.urb_status != 0x4) {
+            continue;
+        }
+
+        u32 transferred_size{};
+        const auto rc = usbDsParseReportData(std::addressof(report_data), e.id, nullptr, &transferred_size);
+        out.emplace_back(e.id, transferred_size, rc);
+    }
+
+    R_SUCCEED();
+}
+
 } // namespace sphaira::usb
@@ -3,6 +3,7 @@
 #include "defines.hpp"
 #include <ranges>
 #include <cstring>
+#include <algorithm>
 
 namespace sphaira::usb {
 namespace {
@@ -199,4 +200,20 @@ Result UsbHs::GetTransferResult(UsbSessionEndpoint ep, u32 xfer_id, u32 *out_req
     R_SUCCEED();
 }
 
+Result UsbHs::GetTransferReports(UsbSessionEndpoint ep, std::vector<TransferReport>& out) {
+    u32 count;
+    UsbHsXferReport report_data[8];
+
+    // reports are removed once read, so every one is returned.
+    R_TRY(eventClear(GetCompletionEvent(ep)));
+    R_TRY(usbHsEpGetXferReport(&m_endpoints[ep], report_data, std::size(report_data), std::addressof(count)));
+
+    count = std::min<u32>(count, std::size(report_data));
+    for (u32 i = 0; i < count; i++) {
+        out.emplace_back(report_data[i].xferId, report_data[i].transferredSize, report_data[i].res);
+    }
+
+    R_SUCCEED();
+}
+
 } // namespace sphaira::usb
@@ -2,6 +2,7 @@
 #include "defines.hpp"
 
 #include "utils/thread.hpp"
+#include "utils/devoptab.hpp"
 
 #include <switch.h>
 #include <usbdvd.h>
@@ -13,6 +14,15 @@ namespace {
 Thread g_thread;
 Mutex g_mutex;
 std::unique_ptr<CUSBDVD> g_dvd;
+// read cache mounted over the usbdvd mount point, empty if not mounted.
+fs::FsPath g_cache_mount;
+
+void UnmountCache() {
+    if (g_cache_mount[0]) {
+        devoptab::UmountNeworkDevice(g_cache_mount);
+        g_cache_mount = {};
+    }
+}
 
 void thread_func(void* arg) {
     SCOPED_MUTEX(&g_mutex);
@@ -40,6 +50,7 @@ void UnmountAll() {
     SCOPED_MUTEX(&g_mutex);
     threadWaitForExit(&g_thread);
     threadClose(&g_thread);
+    UnmountCache();
     g_dvd.reset();
 }
 
@@ -56,14 +67,20 @@ bool GetMountPoint(location::StdioEntry& out) {
 
     // check we have a valid cd mounted.
     if (!fs.mounted) {
+        UnmountCache();
         return false;
     }
 
+    // reads go through the cache mount, falls back to the raw mount if it fails.
+    if (!g_cache_mount[0] && R_FAILED(devoptab::MountUsbDvd(fs.mountpoint, g_cache_mount))) {
+        g_cache_mount = {};
+    }
+
     // todo: make the display name better (show size etc).
     char display_name[0x100];
     std::snprintf(display_name, sizeof(display_name), "%s - %s", ctx.disc_type, ctx.fs.disc_fstype);
 
-    out.mount = fs.mountpoint;
+    out.mount = g_cache_mount[0] ? g_cache_mount.s : fs.mountpoint;
     out.name = display_name;
     out.flags = location::FsEntryFlag::FsEntryFlag_ReadOnly;
 
@@ -1,7 +1,9 @@
 #include "utils/audio.hpp"
 #include "utils/profile.hpp"
 #include "utils/thread.hpp"
+#include "utils/task_pool.hpp"
 #include "utils/devoptab_common.hpp"
+#include "utils/spsc_ring.hpp"
 #include "yati/source/file.hpp"
 
 #include "app.hpp"
@@ -73,6 +75,7 @@
 #pragma GCC diagnostic pop
 
 #include <pulsar.h>
+#include <cstdlib>
 
 namespace sphaira::audio {
 namespace {
@@ -89,15 +92,32 @@ static inline float audrvVoiceGetPitch(AudioDriver* d, int id)
 }
 
 struct File {
+    virtual ~File() = default;
+
+    // a new file of the same type, unopened.
+    virtual auto CreateNew() const -> std::unique_ptr<File> {
+        return std::make_unique<File>();
+    }
+
+    // reads return 0 once set, used to stop a background scan early.
+    void SetCancel(const std::atomic_bool* cancel) {
+        m_cancel = cancel;
+    }
+
     Result Open(fs::Fs* fs, const fs::FsPath& path) {
         auto source = std::make_shared<yati::source::File>(fs, path);
         R_TRY(source->GetSize(&m_size));
 
-        m_buffered = std::make_unique<devoptab::common::BufferedData>(source, m_size, 1024*16);
+        // audio is read sequentially, so fetch ahead of the decoder.
+        m_buffered = std::make_unique<devoptab::common::ReadAheadBufferedData>(source, m_size, 1024*16, 1024*256);
         R_SUCCEED();
     }
 
     virtual size_t ReadFile(void* buf, size_t read_size) {
+        if (m_cancel && *m_cancel) {
+            return 0;
+        }
+
         u64 bytes_read = 0;
         this->m_buffered->Read(buf, m_offset, read_size, &bytes_read);
         this->m_offset += bytes_read;
@@ -128,7 +148,8 @@ struct File {
     }
 
 private:
-    std::unique_ptr<devoptab::common::BufferedData> m_buffered{};
+    std::unique_ptr<devoptab::common::ReadAheadBufferedData> m_buffered{};
+    const std::atomic_bool* m_cancel{};
     s64 m_offset{};
     s64 m_size{};
 };
@@ -136,6 +157,10 @@ private:
 #ifdef ENABLE_AUDIO_MP3
 // gta vice "encrypted" mp3's using xor 0x22, very cool.
 struct GTAViceCityFile final : File {
+    auto CreateNew() const -> std::unique_ptr<File> override {
+        return std::make_unique<GTAViceCityFile>();
+    }
+
     size_t ReadFile(void* _buf, size_t read_size) override {
         auto buf = (u8*)_buf;
         const auto bytes_read = File::ReadFile(buf, read_size);
@@ -256,10 +281,44 @@ protected:
     PLSR_PlayerSoundId m_id{};
 };
 
+int GetFreeVoiceId(const PLSR_Player* player) {
+    for(int id = player->config.startVoiceId; id <= player->config.endVoiceId; id++) {
+        if(!player->driver.in_voices[id].is_used) {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+bool InitVoice(AudioDriver* drv, int voice_id, int channel_count, int sample_rate) {
+    if (!audrvVoiceInit(drv, voice_id, channel_count, PcmFormat_Int16, sample_rate)) {
+        return false;
+    }
+
+    audrvVoiceSetDestinationMix(drv, voice_id, AUDREN_FINAL_MIX_ID);
+
+    if (channel_count == 1) {
+        audrvVoiceSetMixFactor(drv, voice_id, 1.0f, 0, 0);
+        audrvVoiceSetMixFactor(drv, voice_id, 1.0f, 0, 1);
+    } else {
+        audrvVoiceSetMixFactor(drv, voice_id, 1.0f, 0, 0);
+        audrvVoiceSetMixFactor(drv, voice_id, 0.0f, 0, 1);
+        audrvVoiceSetMixFactor(drv, voice_id, 0.0f, 1, 0);
+        audrvVoiceSetMixFactor(drv, voice_id, 1.0f, 1, 1);
+    }
+
+    return true;
+}
+
+// decoding is done on its own thread into a pcm ring, the audio thread only
+// moves decoded pcm into the wavebufs, so a stalled read doesn't stall playback.
 struct CustomBase : Base {
     using Decode = std::function<int(int samples, s16* out)>;
 
     virtual ~CustomBase() {
+        StopDecoder();
+
         if (m_drv) {
             if (m_voice_id >= 0) {
                 audrvVoiceDrop(m_drv, m_voice_id);
@@ -274,7 +333,24 @@ struct CustomBase : Base {
         }
     }
 
+    // only called on the decoder thread, or with it locked.
     virtual u64 Tell() = 0;
+    virtual bool SeekDecoder(u64 target) = 0;
+    // called on the decoder thread with it locked, before each decode.
+    virtual void UpdateDecoder() {}
+
+    Result Seek(u64 target) override {
+        SCOPED_MUTEX(&m_decode_mutex);
+        UpdateDecoder();
+        R_UNLESS(SeekDecoder(target), 0x1);
+
+        // the song is locked so the audio thread isn't reading the ring either.
+        m_ring->Consume(m_ring->Size());
+        m_play_pos = target;
+        m_decode_eof = false;
+        ueventSignal(&m_space_event);
+        R_SUCCEED();
+    }
 
     // taken from sys-tune.
     Result Create(int channel_count, int sample_rate, const Decode& decode) {
@@ -295,22 +371,10 @@ struct CustomBase : Base {
         log_write("got pool id: %d\n", m_memory_pool_id);
         R_UNLESS(audrvMemPoolAttach(m_drv, m_memory_pool_id), 0x1);
 
-        m_voice_id = _getFreeVoiceId(player);
+        m_voice_id = GetFreeVoiceId(player);
         log_write("got voice id: %d\n", m_voice_id);
         R_UNLESS(m_voice_id >= 0, 0x1);
-
-        R_UNLESS(audrvVoiceInit(m_drv, m_voice_id, channel_count, PcmFormat_Int16, sample_rate), 0x1);
-        audrvVoiceSetDestinationMix(m_drv, m_voice_id, AUDREN_FINAL_MIX_ID);
-
-        if (channel_count == 1) {
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 1.0f, 0, 0);
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 1.0f, 0, 1);
-        } else {
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 1.0f, 0, 0);
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 0.0f, 0, 1);
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 0.0f, 1, 0);
-            audrvVoiceSetMixFactor(m_drv, m_voice_id, 1.0f, 1, 1);
-        }
+        R_UNLESS(InitVoice(m_drv, m_voice_id, channel_count, sample_rate), 0x1);
 
         audrvVoiceStart(m_drv, m_voice_id);
         m_sample_count = AudioSampleSize / BufferCount / sizeof(s16);
@@ -326,6 +390,12 @@ struct CustomBase : Base {
 
         m_decode = decode;
         m_channel_count = channel_count;
+
+        m_ring = std::make_unique<utils::SpscRing>(sample_rate * channel_count * sizeof(s16) * DecodeAheadSeconds);
+        m_decode_buf.resize(m_sample_count * channel_count);
+        ueventCreate(&m_space_event, true);
+        m_decoder = std::make_unique<utils::Async>([this](){ DecodeLoop(); });
+
         R_SUCCEED();
     }
 
@@ -349,9 +419,15 @@ struct CustomBase : Base {
 
             if (refillBuf) {
                 s16 *data = *m_aligned + refillBuf->start_sample_offset * m_channel_count;
+                const auto frame_size = m_channel_count * sizeof(s16);
 
-                const int nSamples = m_decode(m_sample_count, data);
+                // loaded before reading, so that pcm pushed just before eof isn't missed.
+                const bool eof = m_decode_eof;
+                const int nSamples = m_ring->Read(data, m_sample_count * frame_size) / frame_size;
                 if (nSamples > 0) {
+                    ueventSignal(&m_space_event);
+                    m_play_pos += nSamples;
+
                     armDCacheFlush(data, nSamples * m_channel_count * sizeof(u16));
                     refillBuf->end_sample_offset = refillBuf->start_sample_offset + nSamples;
 
@@ -362,24 +438,59 @@ struct CustomBase : Base {
 
                     // update again as we pushed a new buffer.
                     R_TRY(audrvUpdate(m_drv));
-                } else {
-                    if (Tell() < m_info.sample_count) {
+                } else if (eof) {
+                    if (m_decoded_to < m_info.sample_count) {
                         state = State::Error;
                     } else if (IsAllBuffersEmpty()) {
                         state = State::Finished;
                     }
                 }
+                // otherwise the decoder is behind, the queued buffers keep playing.
             }
         }
 
         // audrvVoiceGetPlayedSampleCount doesn't handle seek and has no way of adjusting :/
         // out.played = audrvVoiceGetPlayedSampleCount(m_drv, m_voice_id);
-        out.played = Tell();
+        out.played = m_play_pos;
 
         R_SUCCEED();
     }
 
+protected:
+    // must be called by the derived destructor, before the decoder is freed.
+    void StopDecoder() {
+        if (m_decoder) {
+            m_decode_exit = true;
+            ueventSignal(&m_space_event);
+            m_decoder.reset();
+        }
+    }
+
 private:
+    void DecodeLoop() {
+        const auto chunk_size = m_decode_buf.size() * sizeof(s16);
+
+        while (!m_decode_exit) {
+            if (m_decode_eof || m_ring->Space() < chunk_size) {
+                waitSingle(waiterForUEvent(&m_space_event), 1e+8);
+                continue;
+            }
+
+            SCOPED_MUTEX(&m_decode_mutex);
+            UpdateDecoder();
+
+            const auto frames = m_decode(m_sample_count, m_decode_buf.data());
+            if (frames <= 0) {
+                m_decoded_to = Tell();
+                m_decode_eof = true;
+                continue;
+            }
+
+            // only the decoder writes, so there's always space for the chunk.
+            m_ring->Write(m_decode_buf.data(), frames * m_channel_count * sizeof(s16));
+        }
+    }
+
     bool IsAllBuffersEmpty() const {
         for (auto &buffer : m_buffers) {
             if (buffer.state != AudioDriverWaveBufState_Free && buffer.state != AudioDriverWaveBufState_Done) {
@@ -390,18 +501,10 @@ private:
         return true;
     }
 
-    static int _getFreeVoiceId(const PLSR_Player* player) {
-        for(int id = player->config.startVoiceId; id <= player->config.endVoiceId; id++) {
-            if(!player->driver.in_voices[id].is_used) {
-                return id;
-            }
-        }
-
-        return -1;
-    }
-
 private:
     static constexpr const int BufferCount = 2;
+    // pcm is decoded this far ahead of playback.
+    static constexpr const int DecodeAheadSeconds = 4;
 
     AudioDriver* m_drv{};
     std::unique_ptr<s16*> m_aligned{};
@@ -411,6 +514,19 @@ private:
     int m_voice_id{-1};
     int m_sample_count{};
     int m_channel_count{};
+
+    std::unique_ptr<utils::SpscRing> m_ring{};
+    std::vector<s16> m_decode_buf{};
+    std::unique_ptr<utils::Async> m_decoder{};
+    // held by the decoder whilst decoding, so that a seek waits for it.
+    Mutex m_decode_mutex{};
+    // signalled when the ring has space, or on seek / exit.
+    UEvent m_space_event{};
+    std::atomic<u64> m_decoded_to{};
+    std::atomic_bool m_decode_eof{};
+    std::atomic_bool m_decode_exit{};
+    // frames passed to the voice.
+    u64 m_play_pos{};
 };
 
 struct PlsrBFSTM final : PlsrBase {
@@ -466,6 +582,7 @@ struct PlsrBFWAV final : PlsrBase {
 #ifdef ENABLE_AUDIO_WAV
 struct DrWAV final : CustomBase {
     ~DrWAV() {
+        StopDecoder();
         drwav_uninit(&m_wav);
     }
 
@@ -488,7 +605,7 @@ struct DrWAV final : CustomBase {
         });
     }
 
-    Result Seek(u64 target) override {
+    bool SeekDecoder(u64 target) override {
         return drwav_seek_to_pcm_frame(&m_wav, target);
     }
 
@@ -547,6 +664,9 @@ struct DrMP3 final : CustomBase {
     }
 
     ~DrMP3() {
+        m_index_exit = true;
+        m_index.reset();
+        StopDecoder();
         drmp3_uninit(&m_mp3);
     }
 
@@ -560,34 +680,35 @@ struct DrMP3 final : CustomBase {
         const auto pcm_frame_count = drmp3_get_pcm_frame_count(&m_mp3);
         R_UNLESS(pcm_frame_count, 0x1);
 
-        // wayyyy too slow to be useable for anything >= 3min.
-        // todo: ask if dr_mp3 could generate the seek table at runtime instead
-        // ie, pass in an empty table and have it fill it out as the song plays
-        // drmp3_uint32 num_seek_points = pcm_frame_count;
-        // m_seek_points.resize(num_seek_points);
-
-        // if (!drmp3_calculate_seek_points(&m_mp3, &num_seek_points, m_seek_points.data())) {
-        //     R_THROW(0x1);
-        // }
-
-        // m_seek_points.resize(num_seek_points);
-        // if (!drmp3_bind_seek_table(&m_mp3, num_seek_points, m_seek_points.data())) {
-        //     R_THROW(0x1);
-        // }
-
         m_info.sample_count = pcm_frame_count;
         m_info.sample_rate = m_mp3.sampleRate;
         m_info.channels = m_mp3.channels;
 
-        return Create(m_mp3.channels, m_mp3.sampleRate, [this](int sample_count, s16 *data) -> int {
+        R_TRY(Create(m_mp3.channels, m_mp3.sampleRate, [this](int sample_count, s16 *data) -> int {
             return drmp3_read_pcm_frames_s16(&m_mp3, sample_count, data);
-        });
+        }));
+
+        // without a seek table, dr_mp3 seeks by decoding from the start of the file.
+        // building one is another scan of the file, so it's done on a second
+        // decoder in a background task and bound once done.
+        m_index = std::make_unique<utils::task::Group>();
+        m_index->Push([this, fs, path](){ BuildSeekTable(fs, path); }, utils::task::Priority::Low);
+        R_SUCCEED();
     }
 
-    Result Seek(u64 target) override {
+    bool SeekDecoder(u64 target) override {
         return drmp3_seek_to_pcm_frame(&m_mp3, target);
     }
 
+    void UpdateDecoder() override {
+        if (m_seek_points_ready && !m_seek_table_bound) {
+            m_seek_table_bound = true;
+            if (!drmp3_bind_seek_table(&m_mp3, m_seek_points.size(), m_seek_points.data())) {
+                log_write("[DRMP3] failed to bind seek table\n");
+            }
+        }
+    }
+
     u64 Tell() override {
         return m_mp3.currentPCMFrame;
     }
@@ -597,6 +718,49 @@ struct DrMP3 final : CustomBase {
     }
 
 private:
+    void BuildSeekTable(fs::Fs* fs, const fs::FsPath& path) {
+        auto file = m_file->CreateNew();
+        file->SetCancel(&m_index_exit);
+        if (R_FAILED(file->Open(fs, path))) {
+            return;
+        }
+
+        drmp3 mp3;
+        if (!drmp3_init(&mp3, OnIndexRead, OnIndexSeek, OnIndexTell, nullptr, file.get(), nullptr)) {
+            return;
+        }
+        ON_SCOPE_EXIT(drmp3_uninit(&mp3));
+
+        // a point every second, a seek decodes forward from the nearest point.
+        drmp3_uint32 count = std::max<u64>(1, m_info.sample_count / m_info.sample_rate);
+        std::vector<drmp3_seek_point> points(count);
+        if (!drmp3_calculate_seek_points(&mp3, &count, points.data()) || m_index_exit) {
+            log_write("[DRMP3] failed to build seek table\n");
+            return;
+        }
+
+        points.resize(count);
+        m_seek_points = std::move(points);
+        m_seek_points_ready = true;
+        log_write("[DRMP3] built seek table, points: %u\n", count);
+    }
+
+    static size_t OnIndexRead(void *pUserData, void *pBufferOut, size_t bytesToRead) {
+        auto file = static_cast<File*>(pUserData);
+        return file->ReadFile(pBufferOut, bytesToRead);
+    }
+
+    static drmp3_bool32 OnIndexSeek(void *pUserData, int offset, drmp3_seek_origin origin) {
+        auto file = static_cast<File*>(pUserData);
+        return file->SeekFile(offset, origin);
+    }
+
+    static drmp3_bool32 OnIndexTell(void *pUserData, drmp3_int64* pCursor) {
+        auto file = static_cast<File*>(pUserData);
+        *pCursor = file->TellFile();
+        return true;
+    }
+
     static size_t OnRead(void *pUserData, void *pBufferOut, size_t bytesToRead) {
         auto data = static_cast<DrMP3*>(pUserData);
         return data->m_file->ReadFile(pBufferOut, bytesToRead);
@@ -672,15 +836,19 @@ public:
 
 private:
     drmp3 m_mp3{};
-    #if 0
+    std::unique_ptr<utils::task::Group> m_index{};
+    // only written by the index thread until ready is set.
     std::vector<drmp3_seek_point> m_seek_points{};
-    #endif
+    std::atomic_bool m_seek_points_ready{};
+    std::atomic_bool m_index_exit{};
+    bool m_seek_table_bound{};
 };
 #endif // ENABLE_AUDIO_MP3
 
 #ifdef ENABLE_AUDIO_FLAC
 struct DrFLAC final : CustomBase {
     ~DrFLAC() {
+        StopDecoder();
         drflac_close(m_flac);
     }
 
@@ -698,7 +866,7 @@ struct DrFLAC final : CustomBase {
         });
     }
 
-    Result Seek(u64 target) override {
+    bool SeekDecoder(u64 target) override {
         return drflac_seek_to_pcm_frame(m_flac, target);
     }
 
@@ -816,6 +984,7 @@ private:
 
 struct stbOGG final : CustomBase {
     ~stbOGG() {
+        StopDecoder();
         stb_vorbis_close(m_ogg);
     }
 
@@ -846,7 +1015,7 @@ struct stbOGG final : CustomBase {
         });
     }
 
-    Result Seek(u64 target) override {
+    bool SeekDecoder(u64 target) override {
         return stb_vorbis_seek(m_ogg, target);
     }
 
@@ -897,13 +1066,88 @@ struct SongEntry {
     }
 };
 
+// effects longer than this are not loaded.
+constexpr u64 MAX_SOUND_BANK_ENTRY_SIZE = 1024 * 1024;
+
+struct SoundBankEntry {
+    AudioDriverWaveBuf wavebuf;
+    int voice_id;
+    int channels;
+    int sample_rate;
+};
+
+// theme sound effects, decoded into a single mempool when the theme is loaded,
+// so that playing one doesn't decode or allocate.
+// each entry keeps its voice until the bank is closed.
+struct SoundBank {
+    AudioDriver* drv;
+    s16* arena;
+    int memory_pool_id;
+    SoundBankEntry entries[std::to_underlying(SoundEffect::MAX)];
+};
+
 Mutex g_mutex{};
 SongEntry g_songs[MAX_SONGS]{};
 PLSR_PlayerSoundId g_sound_ids[std::to_underlying(SoundEffect::MAX)]{};
+SoundBank g_sound_bank{};
 Thread g_thread{};
 UEvent g_cancel_uevent{};
 std::atomic_bool g_is_init{};
 
+// must be called with g_mutex locked.
+void CloseSoundBankInternal() {
+    auto& bank = g_sound_bank;
+    if (!bank.arena) {
+        return;
+    }
+
+    for (auto& e : bank.entries) {
+        if (e.voice_id >= 0) {
+            audrvVoiceDrop(bank.drv, e.voice_id);
+        }
+    }
+
+    audrvUpdate(bank.drv);
+    audrvMemPoolDetach(bank.drv, bank.memory_pool_id);
+
+    // force remove.
+    bank.drv->in_mempools[bank.memory_pool_id].state = AudioRendererMemPoolState_Invalid;
+    audrvMemPoolRemove(bank.drv, bank.memory_pool_id);
+
+    std::free(bank.arena);
+    bank = {};
+}
+
+#ifdef ENABLE_AUDIO_WAV
+struct DecodedSound {
+    std::vector<s16> pcm;
+    int channels;
+    int sample_rate;
+};
+
+Result DecodeSound(fs::Fs* fs, const fs::FsPath& path, DecodedSound& out) {
+    std::vector<u8> buf;
+    R_TRY(fs->read_entire_file(path, buf));
+
+    drwav wav;
+    R_UNLESS(drwav_init_memory(&wav, buf.data(), buf.size(), nullptr), 0x5);
+    ON_SCOPE_EXIT(drwav_uninit(&wav));
+
+    drwav_uint64 length_pcm;
+    R_UNLESS(DRWAV_SUCCESS == drwav_get_length_in_pcm_frames(&wav, &length_pcm), 0x6);
+    R_UNLESS(length_pcm && length_pcm * wav.channels * sizeof(s16) <= MAX_SOUND_BANK_ENTRY_SIZE, 0x6);
+
+    out.pcm.resize(length_pcm * wav.channels);
+    const auto frames = drwav_read_pcm_frames_s16(&wav, length_pcm, out.pcm.data());
+    R_UNLESS(frames, 0x6);
+
+    out.pcm.resize(frames * wav.channels);
+    out.channels = wav.channels;
+    out.sample_rate = wav.sampleRate;
+    R_SUCCEED();
+}
+#endif // ENABLE_AUDIO_WAV
+
 void thread_func(void* arg) {
     auto player = plsrPlayerGetInstance();
     if (!player) {
@@ -1009,7 +1253,7 @@ Result Init() {
     }
 
     ueventCreate(&g_cancel_uevent, false);
-    R_TRY(utils::CreateThread(&g_thread, thread_func, nullptr, 1024*128, 0x20));
+    R_TRY(utils::CreateThread(&g_thread, thread_func, nullptr, utils::ThreadRole::Audio));
     R_TRY(threadStart(&g_thread));
 
     g_is_init = true;
@@ -1033,6 +1277,8 @@ void Exit() {
 
     SCOPED_MUTEX(&g_mutex);
 
+    CloseSoundBankInternal();
+
     for (auto& id : g_sound_ids) {
         plsrPlayerFree(id);
     }
@@ -1055,6 +1301,19 @@ Result PlaySoundEffect(SoundEffect effect) {
     R_UNLESS(g_is_init, 0x1);
 
     SCOPED_MUTEX(&g_mutex);
+
+    // theme sound effects replace the qlaunch one.
+    if (auto& e = g_sound_bank.entries[std::to_underlying(effect)]; g_sound_bank.arena && e.voice_id >= 0) {
+        auto drv = g_sound_bank.drv;
+
+        // dropping the voice frees the wavebuf, so it can be queued again.
+        audrvVoiceDrop(drv, e.voice_id);
+        R_UNLESS(InitVoice(drv, e.voice_id, e.channels, e.sample_rate), 0x1);
+        R_UNLESS(audrvVoiceAddWaveBuf(drv, e.voice_id, &e.wavebuf), 0x1);
+        audrvVoiceStart(drv, e.voice_id);
+        R_SUCCEED();
+    }
+
     const auto id = g_sound_ids[std::to_underlying(effect)];
 
     if (plsrPlayerIsPlaying(id)) {
@@ -1065,6 +1324,97 @@ Result PlaySoundEffect(SoundEffect effect) {
     return plsrPlayerPlay(id);
 }
 
+Result LoadSoundBank(fs::Fs* fs, std::span<const fs::FsPath> paths) {
+    R_UNLESS(g_is_init, 0x1);
+
+    SCOPED_MUTEX(&g_mutex);
+    CloseSoundBankInternal();
+
+#ifdef ENABLE_AUDIO_WAV
+    auto player = plsrPlayerGetInstance();
+    R_UNLESS(player, 0x1);
+
+    // decode everything first, so that the arena is sized once.
+    DecodedSound sounds[std::to_underlying(SoundEffect::MAX)]{};
+    u64 arena_size = 0;
+    for (size_t i = 0; i < std::size(sounds) && i < paths.size(); i++) {
+        if (paths[i].empty()) {
+            continue;
+        }
+
+        if (R_FAILED(DecodeSound(fs, paths[i], sounds[i]))) {
+            log_write("[AUDIO] failed to load sound effect: %s\n", paths[i].s);
+            continue;
+        }
+
+        arena_size += (sounds[i].pcm.size() * sizeof(s16) + 0x3F) & ~0x3F;
+    }
+
+    if (!arena_size) {
+        R_SUCCEED();
+    }
+
+    auto& bank = g_sound_bank;
+    arena_size = (arena_size + 0xFFF) & ~0xFFF;
+    bank.arena = static_cast<s16*>(std::aligned_alloc(AUDREN_MEMPOOL_ALIGNMENT, arena_size));
+    R_UNLESS(bank.arena, 0x1);
+
+    bank.drv = &player->driver;
+    bank.memory_pool_id = audrvMemPoolAdd(bank.drv, bank.arena, arena_size);
+    for (auto& e : bank.entries) {
+        e.voice_id = -1;
+    }
+
+    if (!audrvMemPoolAttach(bank.drv, bank.memory_pool_id)) {
+        CloseSoundBankInternal();
+        R_THROW(0x1);
+    }
+
+    u64 offset = 0;
+    for (size_t i = 0; i < std::size(sounds); i++) {
+        const auto& sound = sounds[i];
+        if (sound.pcm.empty()) {
+            continue;
+        }
+
+        auto& e = bank.entries[i];
+        e.voice_id = GetFreeVoiceId(player);
+        if (e.voice_id < 0 || !InitVoice(bank.drv, e.voice_id, sound.channels, sound.sample_rate)) {
+            log_write("[AUDIO] no voice for sound effect: %s\n", paths[i].s);
+            e.voice_id = -1;
+            continue;
+        }
+
+        const auto size = sound.pcm.size() * sizeof(s16);
+        auto data = bank.arena + offset / sizeof(s16);
+        std::memcpy(data, sound.pcm.data(), size);
+        armDCacheFlush(data, size);
+
+        e.channels = sound.channels;
+        e.sample_rate = sound.sample_rate;
+        e.wavebuf.data_pcm16 = data;
+        e.wavebuf.size = size;
+        e.wavebuf.start_sample_offset = 0;
+        e.wavebuf.end_sample_offset = sound.pcm.size() / sound.channels;
+        offset += (size + 0x3F) & ~0x3F;
+    }
+
+    log_write("[AUDIO] loaded sound bank, size: %zu\n", (size_t)arena_size);
+    R_SUCCEED();
+#else
+    R_THROW(0x1);
+#endif // ENABLE_AUDIO_WAV
+}
+
+void CloseSoundBank() {
+    if (!g_is_init) {
+        return;
+    }
+
+    SCOPED_MUTEX(&g_mutex);
+    CloseSoundBankInternal();
+}
+
 Result OpenSong(fs::Fs* fs, const fs::FsPath& path, u32 flags, SongID* id) {
     R_UNLESS(g_is_init, 0x1);
 
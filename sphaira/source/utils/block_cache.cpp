@@ -0,0 +1,221 @@
+#include "utils/block_cache.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <list>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <iterator>
+
+namespace sphaira::utils::block_cache {
+namespace {
+
+constexpr u64 DEFAULT_BUDGET = 1024ULL * 1024 * 16;
+// each source keeps at least budget / (sources * RESERVE_DIVISOR) cached
+// so that a busy source can't evict everything of the other sources.
+constexpr u64 RESERVE_DIVISOR = 4;
+// max number of blocks checked when looking for a block to evict.
+constexpr u32 EVICT_SCAN_MAX = 64;
+
+struct Key {
+    u32 id;
+    u64 block_size;
+    u64 off;
+
+    bool operator==(const Key&) const = default;
+};
+
+struct KeyHash {
+    auto operator()(const Key& key) const -> std::size_t {
+        return std::hash<u64>{}(key.off ^ key.block_size ^ (u64(key.id) << 48));
+    }
+};
+
+struct Block {
+    Key key;
+    std::vector<u8> data;
+};
+
+// front is the most recently used.
+using BlockList = std::list<Block>;
+
+struct Source {
+    std::string name;
+    u64 used;
+    u64 hits;
+    u64 misses;
+};
+
+Mutex g_mutex{};
+BlockList g_lru{};
+std::unordered_map<Key, BlockList::iterator, KeyHash> g_index{};
+std::unordered_map<u32, Source> g_sources{};
+u32 g_next_id{};
+Stats g_stats{ .budget = DEFAULT_BUDGET };
+
+// must be called with the lock held.
+void EraseBlock(BlockList::iterator it) {
+    const auto size = it->data.size();
+    if (auto src = g_sources.find(it->key.id); src != g_sources.end()) {
+        src->second.used -= size;
+    }
+
+    g_stats.used -= size;
+    g_index.erase(it->key);
+    g_lru.erase(it);
+}
+
+// evicts the oldest blocks until under the budget, skipping blocks of sources
+// that are at their reserve, unless it's the source that needs the space.
+// must be called with the lock held.
+void EvictToBudget(u64 budget, u32 requester) {
+    const auto reserve = g_sources.empty() ? 0 : budget / (g_sources.size() * RESERVE_DIVISOR);
+
+    while (g_stats.used > budget && !g_lru.empty()) {
+        auto victim = std::prev(g_lru.end());
+        auto it = victim;
+
+        for (u32 i = 0; i < EVICT_SCAN_MAX; i++) {
+            const auto src = g_sources.find(it->key.id);
+            if (it->key.id == requester || src == g_sources.end() || src->second.used > reserve) {
+                victim = it;
+                break;
+            }
+
+            if (it == g_lru.begin()) {
+                break;
+            }
+            --it;
+        }
+
+        EraseBlock(victim);
+    }
+}
+
+void LogSource(const Source& src) {
+    log_write("[CACHE] %s used: %.2f MiB hits: %zu misses: %zu\n",
+        src.name.c_str(), src.used / 1024.0 / 1024.0, src.hits, src.misses);
+}
+
+} // namespace
+
+auto Register(const char* name) -> u32 {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    const auto id = ++g_next_id;
+    g_sources[id] = Source{ .name = name ? name : "" };
+    return id;
+}
+
+void Unregister(u32 id) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    const auto src = g_sources.find(id);
+    if (src == g_sources.end()) {
+        return;
+    }
+
+    LogSource(src->second);
+
+    for (auto it = g_lru.begin(); it != g_lru.end();) {
+        const auto next = std::next(it);
+        if (it->key.id == id) {
+            EraseBlock(it);
+        }
+        it = next;
+    }
+
+    g_sources.erase(src);
+}
+
+bool Read(u32 id, u64 block_off, u64 block_size, void* buf, u64 off, u64 size, u64* bytes_read) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    auto& src = g_sources[id];
+    const auto it = g_index.find(Key{id, block_size, block_off});
+    if (it == g_index.end() || off >= it->second->data.size()) {
+        src.misses++;
+        g_stats.misses++;
+        return false;
+    }
+
+    // move to the front of the lru.
+    g_lru.splice(g_lru.begin(), g_lru, it->second);
+
+    const auto& data = it->second->data;
+    *bytes_read = std::min<u64>(size, data.size() - off);
+    std::memcpy(buf, data.data() + off, *bytes_read);
+
+    src.hits++;
+    g_stats.hits++;
+    return true;
+}
+
+void Insert(u32 id, u64 block_off, u64 block_size, std::vector<u8>&& data) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    const Key key{id, block_size, block_off};
+    if (const auto it = g_index.find(key); it != g_index.end()) {
+        EraseBlock(it->second);
+    }
+
+    const auto size = data.size();
+    g_lru.emplace_front(Block{key, std::move(data)});
+    g_index[key] = g_lru.begin();
+
+    g_sources[id].used += size;
+    g_stats.used += size;
+    EvictToBudget(g_stats.budget, id);
+}
+
+void SetBudget(u64 budget) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    g_stats.budget = budget;
+    EvictToBudget(budget, 0);
+}
+
+auto GetStats() -> Stats {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    return g_stats;
+}
+
+auto GetStats(u32 id) -> Stats {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    Stats stats{ .budget = g_stats.budget };
+    if (const auto src = g_sources.find(id); src != g_sources.end()) {
+        stats.used = src->second.used;
+        stats.hits = src->second.hits;
+        stats.misses = src->second.misses;
+    }
+
+    return stats;
+}
+
+void LogStats(const char* tag) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    log_write("[CACHE] %s used: %.2f MiB budget: %.2f MiB hits: %zu misses: %zu sources: %zu\n",
+        tag,
+        g_stats.used / 1024.0 / 1024.0,
+        g_stats.budget / 1024.0 / 1024.0,
+        g_stats.hits, g_stats.misses, g_sources.size());
+
+    for (const auto& [id, src] : g_sources) {
+        LogSource(src);
+    }
+}
+
+} // namespace sphaira::utils::block_cache
@@ -0,0 +1,168 @@
+#include "utils/buffer_pool.hpp"
+#include "utils/mem_track.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+namespace sphaira::utils::pool {
+namespace {
+
+constexpr u64 MIN_CLASS_SIZE = 1024ULL * 64;
+constexpr u64 MAX_CLASS_SIZE = 1024ULL * 1024 * 16;
+constexpr u64 DEFAULT_BUDGET = 1024ULL * 1024 * 32;
+// page aligned so that ipc buffers can be mapped without an extra copy.
+constexpr u64 BLOCK_ALIGN = 0x1000;
+
+constexpr auto CLASS_COUNT = std::countr_zero(MAX_CLASS_SIZE) - std::countr_zero(MIN_CLASS_SIZE) + 1;
+
+Mutex g_mutex{};
+std::vector<void*> g_free_list[CLASS_COUNT]{};
+Stats g_stats{ .budget = DEFAULT_BUDGET };
+
+// returns the class index for the size, or -1 if it's too big to be pooled.
+auto GetClassIndex(std::size_t size) -> int {
+    const auto class_size = std::bit_ceil(std::max<u64>(size, MIN_CLASS_SIZE));
+    if (class_size > MAX_CLASS_SIZE) {
+        return -1;
+    }
+
+    return std::countr_zero(class_size) - std::countr_zero(MIN_CLASS_SIZE);
+}
+
+auto GetClassSize(int index) -> u64 {
+    return MIN_CLASS_SIZE << index;
+}
+
+// frees cached blocks, starting with the largest, until under the budget.
+// must be called with the lock held.
+void TrimToBudget(u64 budget) {
+    for (int i = CLASS_COUNT - 1; i >= 0 && g_stats.cached > budget; i--) {
+        auto& list = g_free_list[i];
+        while (!list.empty() && g_stats.cached > budget) {
+            std::free(list.back());
+            list.pop_back();
+            g_stats.cached -= GetClassSize(i);
+            mem::Remove(mem::Tag_Transfer, GetClassSize(i));
+        }
+    }
+}
+
+} // namespace
+
+void* Allocate(std::size_t size) {
+    const auto index = GetClassIndex(size);
+    if (index < 0) {
+        const auto aligned_size = (size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+        auto ptr = std::aligned_alloc(BLOCK_ALIGN, aligned_size);
+        if (ptr) {
+            mem::Add(mem::Tag_Transfer, aligned_size);
+        }
+        return ptr;
+    }
+
+    const auto class_size = GetClassSize(index);
+
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    void* ptr{};
+    auto& list = g_free_list[index];
+    if (!list.empty()) {
+        ptr = list.back();
+        list.pop_back();
+        g_stats.cached -= class_size;
+        g_stats.hits++;
+    } else {
+        ptr = std::aligned_alloc(BLOCK_ALIGN, class_size);
+        if (!ptr) {
+            // release everything cached and try again.
+            TrimToBudget(0);
+            ptr = std::aligned_alloc(BLOCK_ALIGN, class_size);
+        }
+        g_stats.misses++;
+
+        if (ptr) {
+            mem::Add(mem::Tag_Transfer, class_size);
+        }
+    }
+
+    if (ptr) {
+        g_stats.leased += class_size;
+        g_stats.high_water = std::max(g_stats.high_water, g_stats.leased);
+    }
+
+    return ptr;
+}
+
+void Free(void* ptr, std::size_t size) {
+    if (!ptr) {
+        return;
+    }
+
+    const auto index = GetClassIndex(size);
+    if (index < 0) {
+        std::free(ptr);
+        mem::Remove(mem::Tag_Transfer, (size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1));
+        return;
+    }
+
+    const auto class_size = GetClassSize(index);
+
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    g_stats.leased -= class_size;
+
+    if (g_stats.cached + class_size > g_stats.budget) {
+        std::free(ptr);
+        mem::Remove(mem::Tag_Transfer, class_size);
+    } else {
+        g_free_list[index].emplace_back(ptr);
+        g_stats.cached += class_size;
+    }
+}
+
+void SetBudget(u64 budget) {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    g_stats.budget = budget;
+    TrimToBudget(budget);
+}
+
+void Trim() {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    TrimToBudget(0);
+}
+
+auto GetStats() -> Stats {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    return g_stats;
+}
+
+void ResetHighWater() {
+    mutexLock(&g_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&g_mutex));
+
+    g_stats.high_water = g_stats.leased;
+}
+
+void LogStats(const char* tag) {
+    const auto stats = GetStats();
+    log_write("[POOL] %s leased: %.2f MiB cached: %.2f MiB high: %.2f MiB budget: %.2f MiB hits: %zu misses: %zu\n",
+        tag,
+        stats.leased / 1024.0 / 1024.0,
+        stats.cached / 1024.0 / 1024.0,
+        stats.high_water / 1024.0 / 1024.0,
+        stats.budget / 1024.0 / 1024.0,
+        stats.hits, stats.misses);
+}
+
+} // namespace sphaira::utils::pool
@@ -1,5 +1,10 @@
 #include "utils/devoptab_common.hpp"
+#include "utils/block_cache.hpp"
 #include "utils/thread.hpp"
+#include "utils/utils.hpp"
+#include "utils/trace.hpp"
+#include "utils/mem_track.hpp"
+#include "utils/task_pool.hpp"
 
 #include "defines.hpp"
 #include "log.hpp"
@@ -7,6 +12,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <deque>
 #include <fcntl.h>
 #include <minIni.h>
 #include <curl/curl.h>
@@ -21,6 +27,42 @@ namespace {
 
 RwLock g_rwlock{};
 
+// default for network mounts, can be changed with cache_ttl in the mount ini.
+constexpr long DEFAULT_CACHE_TTL = 5;
+// the caches are cleared if they grow past this.
+constexpr size_t CACHE_MAX_STATS = 1024 * 4;
+constexpr size_t CACHE_MAX_DIRS = 64;
+// max number of idle curl handles kept per mount.
+constexpr size_t CURL_MAX_POOLED_HANDLES = 8;
+// configured mounts are connected in parallel on these threads.
+constexpr u32 CONNECT_WORKER_COUNT = 3;
+
+auto GetParentPath(const std::string& path) -> std::string {
+    const auto pos = path.find_last_of('/');
+    if (pos == std::string::npos || !pos) {
+        return "/";
+    }
+
+    return path.substr(0, pos);
+}
+
+auto JoinPath(const std::string& dir, const std::string& name) -> std::string {
+    if (dir.ends_with('/')) {
+        return dir + name;
+    }
+
+    return dir + "/" + name;
+}
+
+// erases all keys within the dir.
+template<typename T>
+void EraseChildren(std::map<std::string, T>& map, const std::string& path) {
+    const auto prefix = path.ends_with('/') ? path : path + "/";
+    for (auto it = map.lower_bound(prefix); it != map.end() && it->first.starts_with(prefix);) {
+        it = map.erase(it);
+    }
+}
+
 // curl_url_strerror doesn't exist in the switch version of libcurl as its so old.
 // todo: update libcurl and send patches to dkp.
 const char* curl_url_strerror_wrap(CURLUcode code) {
@@ -54,16 +96,32 @@ struct Device {
 
     MountConfig config{};
     Mutex mutex{};
+    // set whilst queued to connect, the mount isn't listed until it's done.
+    std::atomic_bool connecting{};
 };
 
 struct File {
     Device* device;
     void* fd;
+    // set if the file was opened for writing, used to invalidate the metadata cache on close.
+    char* path;
+};
+
+// used for dirs when the metadata cache is enabled.
+struct DirListing {
+    MetadataCache::DirEntries entries{};
+    std::string path{};
+    size_t index{};
+    // set if the entries came from the cache, otherwise they're being collected.
+    bool cached{};
+    // set once the collected entries have been added to the cache.
+    bool done{};
 };
 
 struct Dir {
     Device* device;
     void* fd;
+    DirListing* listing;
 };
 
 int set_errno(struct _reent *r, int err) {
@@ -72,6 +130,7 @@ int set_errno(struct _reent *r, int err) {
 }
 
 int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int flags, int mode) {
+    TRACE_SCOPE("devoptab::open");
     auto device = static_cast<Device*>(r->deviceData);
     auto file = static_cast<File*>(fileStruct);
     std::memset(file, 0, sizeof(*file));
@@ -96,6 +155,12 @@ int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int fla
         return set_errno(r, ENOMEM);
     }
 
+    auto& cache = device->mount_device->metadata_cache;
+    const auto is_write = flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND);
+    if (cache.IsEnabled() && is_write) {
+        cache.Invalidate(path);
+    }
+
     const auto ret = device->mount_device->devoptab_open(file->fd, path, flags, mode);
     if (ret) {
         free(file->fd);
@@ -103,25 +168,43 @@ int devoptab_open(struct _reent *r, void *fileStruct, const char *_path, int fla
         return set_errno(r, -ret);
     }
 
+    if (cache.IsEnabled() && is_write) {
+        file->path = strdup(path);
+    }
+
     file->device = device;
     return r->_errno = 0;
 }
 
 int devoptab_close(struct _reent *r, void *fd) {
+    TRACE_SCOPE("devoptab::close");
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&file->device->mutex);
 
+    // errors from buffered writes may only show up on close.
+    int ret = 0;
     if (file->fd) {
-        file->device->mount_device->devoptab_close(file->fd);
+        ret = file->device->mount_device->devoptab_close(file->fd);
         free(file->fd);
     }
 
+    // the size / timestamp will have changed.
+    if (file->path) {
+        file->device->mount_device->metadata_cache.Invalidate(file->path);
+        free(file->path);
+    }
+
     std::memset(file, 0, sizeof(*file));
+    if (ret) {
+        return set_errno(r, -ret);
+    }
+
     return r->_errno = 0;
 }
 
 ssize_t devoptab_read(struct _reent *r, void *fd, char *ptr, size_t len) {
+    TRACE_SCOPE("devoptab::read");
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&file->device->mutex);
@@ -135,6 +218,7 @@ ssize_t devoptab_read(struct _reent *r, void *fd, char *ptr, size_t len) {
 }
 
 ssize_t devoptab_write(struct _reent *r, void *fd, const char *ptr, size_t len) {
+    TRACE_SCOPE("devoptab::write");
     auto file = static_cast<File*>(fd);
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&file->device->mutex);
@@ -194,6 +278,7 @@ int devoptab_unlink(struct _reent *r, const char *_path) {
         return set_errno(r, EIO);
     }
 
+    device->mount_device->metadata_cache.Invalidate(path);
     const auto ret = device->mount_device->devoptab_unlink(path);
     if (ret) {
         return set_errno(r, -ret);
@@ -225,6 +310,8 @@ int devoptab_rename(struct _reent *r, const char *_oldName, const char *_newName
         return set_errno(r, EIO);
     }
 
+    device->mount_device->metadata_cache.Invalidate(oldName);
+    device->mount_device->metadata_cache.Invalidate(newName);
     const auto ret = device->mount_device->devoptab_rename(oldName, newName);
     if (ret) {
         return set_errno(r, -ret);
@@ -251,6 +338,7 @@ int devoptab_mkdir(struct _reent *r, const char *_path, int mode) {
         return set_errno(r, EIO);
     }
 
+    device->mount_device->metadata_cache.Invalidate(path);
     const auto ret = device->mount_device->devoptab_mkdir(path, mode);
     if (ret) {
         return set_errno(r, -ret);
@@ -277,6 +365,7 @@ int devoptab_rmdir(struct _reent *r, const char *_path) {
         return set_errno(r, EIO);
     }
 
+    device->mount_device->metadata_cache.Invalidate(path);
     const auto ret = device->mount_device->devoptab_rmdir(path);
     if (ret) {
         return set_errno(r, -ret);
@@ -292,7 +381,7 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&device->mutex);
 
-    log_write("[DEVOPTAB] diropen %s\n", _path);
+    log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen %s\n", _path);
 
     if (!device->mount_device) {
         log_write("[DEVOPTAB] diropen no mount device\n");
@@ -306,14 +395,30 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
         return nullptr;
     }
 
-    log_write("[DEVOPTAB] diropen fixed path %s\n", path);
+    log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen fixed path %s\n", path);
 
     if (!device->mount_device->Mount()) {
         set_errno(r, EIO);
         return nullptr;
     }
 
-    log_write("[DEVOPTAB] diropen mounted\n");
+    log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen mounted\n");
+
+    auto& cache = device->mount_device->metadata_cache;
+    if (cache.IsEnabled()) {
+        auto listing = std::make_unique<DirListing>();
+        if (cache.GetDir(path, listing->entries)) {
+            log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen using cached listing\n");
+            listing->cached = true;
+            dir->listing = listing.release();
+            dir->device = device;
+            return dirState;
+        }
+
+        // collect the entries as they're read.
+        listing->path = path;
+        dir->listing = listing.release();
+    }
 
     dir->fd = calloc(1, device->dir_size);
     if (!dir->fd) {
@@ -321,17 +426,19 @@ DIR_ITER* devoptab_diropen(struct _reent *r, DIR_ITER *dirState, const char *_pa
         return nullptr;
     }
 
-    log_write("[DEVOPTAB] diropen allocated dir\n");
+    log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen allocated dir\n");
 
     const auto ret = device->mount_device->devoptab_diropen(dir->fd, path);
     if (ret) {
         free(dir->fd);
         dir->fd = nullptr;
+        delete dir->listing;
+        dir->listing = nullptr;
         set_errno(r, -ret);
         return nullptr;
     }
 
-    log_write("[DEVOPTAB] diropen opened dir\n");
+    log_debug(LogCategory_Devoptab, "[DEVOPTAB] diropen opened dir\n");
 
     dir->device = device;
     return dirState;
@@ -342,6 +449,16 @@ int devoptab_dirreset(struct _reent *r, DIR_ITER *dirState) {
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&dir->device->mutex);
 
+    if (auto listing = dir->listing) {
+        listing->index = 0;
+        if (listing->cached) {
+            return r->_errno = 0;
+        }
+
+        listing->entries.clear();
+        listing->done = false;
+    }
+
     const auto ret = dir->device->mount_device->devoptab_dirreset(dir->fd);
     if (ret) {
         return set_errno(r, -ret);
@@ -351,12 +468,36 @@ int devoptab_dirreset(struct _reent *r, DIR_ITER *dirState) {
 }
 
 int devoptab_dirnext(struct _reent *r, DIR_ITER *dirState, char *filename, struct stat *filestat) {
+    TRACE_SCOPE("devoptab::dirnext");
     auto dir = static_cast<Dir*>(dirState->dirStruct);
     std::memset(filestat, 0, sizeof(*filestat));
     SCOPED_RWLOCK(&g_rwlock, false);
     SCOPED_MUTEX(&dir->device->mutex);
 
+    auto listing = dir->listing;
+    if (listing && listing->cached) {
+        if (listing->index >= listing->entries.size()) {
+            return set_errno(r, ENOENT);
+        }
+
+        const auto& entry = listing->entries[listing->index++];
+        std::strcpy(filename, entry.name.c_str());
+        *filestat = entry.st;
+        return r->_errno = 0;
+    }
+
     const auto ret = dir->device->mount_device->devoptab_dirnext(dir->fd, filename, filestat);
+
+    if (listing && !listing->done) {
+        if (!ret) {
+            listing->entries.emplace_back(MetadataCache::DirEntry{filename, *filestat});
+        } else if (ret == -ENOENT) {
+            // reached the end, so the listing is complete.
+            dir->device->mount_device->metadata_cache.SetDir(listing->path, std::move(listing->entries));
+            listing->done = true;
+        }
+    }
+
     if (ret) {
         return set_errno(r, -ret);
     }
@@ -374,11 +515,13 @@ int devoptab_dirclose(struct _reent *r, DIR_ITER *dirState) {
         free(dir->fd);
     }
 
+    delete dir->listing;
     std::memset(dir, 0, sizeof(*dir));
     return r->_errno = 0;
 }
 
 int devoptab_lstat(struct _reent *r, const char *_path, struct stat *st) {
+    TRACE_SCOPE("devoptab::lstat");
     auto device = static_cast<Device*>(r->deviceData);
     std::memset(st, 0, sizeof(*st));
     SCOPED_RWLOCK(&g_rwlock, false);
@@ -401,7 +544,15 @@ int devoptab_lstat(struct _reent *r, const char *_path, struct stat *st) {
         return set_errno(r, EIO);
     }
 
-    const auto ret = device->mount_device->devoptab_lstat(path, st);
+    auto& cache = device->mount_device->metadata_cache;
+    int ret;
+    if (!cache.IsEnabled() || !cache.GetStat(path, st, ret)) {
+        ret = device->mount_device->devoptab_lstat(path, st);
+        if (cache.IsEnabled()) {
+            cache.SetStat(path, st, ret);
+        }
+    }
+
     if (ret) {
         return set_errno(r, -ret);
     }
@@ -495,6 +646,7 @@ int devoptab_utimes(struct _reent *r, const char *_path, const struct timeval ti
         return set_errno(r, EIO);
     }
 
+    device->mount_device->metadata_cache.Invalidate(path);
     const auto ret = device->mount_device->devoptab_utimes(path, times);
     if (ret) {
         return set_errno(r, -ret);
@@ -536,14 +688,212 @@ struct Entry {
     s32 ref_count{};
 
     ~Entry() {
+        fs::SetStdioBufferSize(name, 0);
         RemoveDevice(mount);
     }
 };
 
 std::array<std::unique_ptr<Entry>, 16> g_entries;
 
+// connects mounts in the background, so that an unreachable host doesn't
+// block whoever mounted it, or the other mounts.
+// mounts are queued by name as they can be unmounted whilst queued.
+struct ConnectQueue {
+    void Push(const fs::FsPath& mount) {
+        SCOPED_MUTEX(&m_mutex);
+
+        if (!m_thread_count) {
+            condvarInit(&m_can_pop);
+            m_quit = false;
+
+            for (u32 i = 0; i < CONNECT_WORKER_COUNT; i++) {
+                if (R_FAILED(utils::CreateThread(&m_threads[i], ThreadFunc, this))) {
+                    break;
+                }
+
+                if (R_FAILED(threadStart(&m_threads[i]))) {
+                    threadClose(&m_threads[i]);
+                    break;
+                }
+
+                m_thread_count++;
+            }
+        }
+
+        m_entries.emplace_back(mount);
+        condvarWakeOne(&m_can_pop);
+    }
+
+    // drops anything queued, must not be called with g_rwlock held.
+    void Close() {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_quit = true;
+            m_entries.clear();
+            condvarWakeAll(&m_can_pop);
+        }
+
+        for (u32 i = 0; i < m_thread_count; i++) {
+            threadWaitForExit(&m_threads[i]);
+            threadClose(&m_threads[i]);
+        }
+        m_thread_count = 0;
+    }
+
+private:
+    auto Pop(fs::FsPath& out) -> bool {
+        SCOPED_MUTEX(&m_mutex);
+
+        while (!m_quit && m_entries.empty()) {
+            condvarWait(&m_can_pop, &m_mutex);
+        }
+
+        if (m_quit) {
+            return false;
+        }
+
+        out = m_entries.front();
+        m_entries.pop_front();
+        return true;
+    }
+
+    static void ThreadFunc(void* p);
+
+    std::deque<fs::FsPath> m_entries{};
+    Thread m_threads[CONNECT_WORKER_COUNT]{};
+    u32 m_thread_count{};
+    Mutex m_mutex{};
+    CondVar m_can_pop{};
+    bool m_quit{};
+};
+
+void ConnectQueue::ThreadFunc(void* p) {
+    auto queue = static_cast<ConnectQueue*>(p);
+
+    fs::FsPath mount;
+    while (queue->Pop(mount)) {
+        SCOPED_RWLOCK(&g_rwlock, false);
+
+        auto it = std::ranges::find_if(g_entries, [&](const auto& e){
+            return e && e->mount == mount;
+        });
+
+        if (it == g_entries.end()) {
+            continue;
+        }
+
+        auto& device = (*it)->device;
+        SCOPED_MUTEX(&device.mutex);
+
+        TRACE_SCOPE("devoptab::connect");
+        if (!device.mount_device->Mount()) {
+            log_write("[DEVOPTAB] Failed to connect %s, will retry on access\n", mount.s);
+        } else {
+            log_write("[DEVOPTAB] Connected %s\n", mount.s);
+        }
+
+        device.connecting = false;
+    }
+}
+
+ConnectQueue g_connect_queue;
+
 } // namespace
 
+MetadataCache::MetadataCache(long ttl_seconds)
+: m_ttl_ns{ttl_seconds > 0 ? u64(ttl_seconds) * 1000000000ULL : 0} {
+}
+
+auto MetadataCache::IsExpired(u64 tick) const -> bool {
+    return armTicksToNs(armGetSystemTick() - tick) >= m_ttl_ns;
+}
+
+bool MetadataCache::GetStat(const std::string& path, struct stat* st, int& ret) {
+    const auto it = m_stats.find(path);
+    if (it == m_stats.end()) {
+        return false;
+    }
+
+    if (IsExpired(it->second.tick)) {
+        m_stats.erase(it);
+        return false;
+    }
+
+    *st = it->second.st;
+    ret = it->second.ret;
+    return true;
+}
+
+void MetadataCache::SetStat(const std::string& path, const struct stat* st, int ret) {
+    // only cache results that won't change without a local write.
+    if (!IsEnabled() || (ret && ret != -ENOENT)) {
+        return;
+    }
+
+    if (m_stats.size() >= CACHE_MAX_STATS) {
+        m_stats.clear();
+    }
+
+    m_stats[path] = StatEntry{*st, ret, armGetSystemTick()};
+}
+
+bool MetadataCache::GetDir(const std::string& path, DirEntries& out) {
+    const auto it = m_dirs.find(path);
+    if (it == m_dirs.end()) {
+        return false;
+    }
+
+    if (IsExpired(it->second.tick)) {
+        m_dirs.erase(it);
+        return false;
+    }
+
+    out = it->second.entries;
+    return true;
+}
+
+void MetadataCache::SetDir(const std::string& path, DirEntries&& entries) {
+    if (!IsEnabled()) {
+        return;
+    }
+
+    if (m_dirs.size() >= CACHE_MAX_DIRS) {
+        m_dirs.clear();
+    }
+
+    if (m_stats.size() + entries.size() >= CACHE_MAX_STATS) {
+        m_stats.clear();
+    }
+
+    // the listing also answers lstat for each entry, skipping entries
+    // that the backend returned without a type (no_stat_file / no_stat_dir).
+    const auto tick = armGetSystemTick();
+    for (const auto& e : entries) {
+        if (e.st.st_mode) {
+            m_stats[JoinPath(path, e.name)] = StatEntry{e.st, 0, tick};
+        }
+    }
+
+    m_dirs[path] = DirListing{std::move(entries), tick};
+}
+
+void MetadataCache::Invalidate(const std::string& path) {
+    if (!IsEnabled()) {
+        return;
+    }
+
+    m_stats.erase(path);
+    m_dirs.erase(path);
+    m_dirs.erase(GetParentPath(path));
+    EraseChildren(m_stats, path);
+    EraseChildren(m_dirs, path);
+}
+
+void MetadataCache::Clear() {
+    m_stats.clear();
+    m_dirs.clear();
+}
+
 // todo: change above function to handle bytes read instead.
 Result BufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes_read) {
     auto dst = static_cast<u8*>(_buffer);
@@ -608,8 +958,31 @@ Result BufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes
     R_SUCCEED();
 }
 
-Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes_read) {
-    // log_write("[FATFS] read offset: %zu size: %zu\n", file_off, read_size);
+ReadAheadBufferedData::ReadAheadBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, u64 _alloc, u64 _max)
+: BufferedDataBase{_source, _size}
+, m_alloc{_alloc}
+, m_window_max{std::max(_alloc, _max)}
+, m_window{_alloc} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_fetch);
+    condvarInit(&m_can_read);
+    m_data.resize(m_alloc);
+}
+
+ReadAheadBufferedData::~ReadAheadBufferedData() {
+    if (m_thread_created) {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_exit = true;
+            condvarWakeAll(&m_can_fetch);
+        }
+
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
+    }
+}
+
+Result ReadAheadBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes_read) {
     auto dst = static_cast<u8*>(_buffer);
     size_t amount = 0;
     *bytes_read = 0;
@@ -617,75 +990,78 @@ Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* by
     R_UNLESS(file_off < capacity, FsError_UnsupportedOperateRangeForFileStorage);
     read_size = std::min<s64>(read_size, capacity - file_off);
 
-    // fatfs reads in max 16k chunks.
-    // knowing this, it's possible to detect large file reads by simply checking if
-    // the read size is 16k (or more, maybe in the further).
-    // however this would destroy random access performance, such as fetching 512 bytes.
-    // the fix was to have 2 LRU caches, one for large data and the other for small (anything below 16k).
-    // the results in file reads 32MB -> 184MB and directory listing is instant.
-    const auto large_read = read_size >= 1024 * 16;
-    auto& lru = large_read ? lru_cache[1] : lru_cache[0];
-
-    for (auto list = lru.begin(); list; list = list->next) {
-        const auto& m_buffered = list->data;
-        if (m_buffered->size) {
-            // check if we can read this data into the beginning of dst.
-            if (file_off < m_buffered->off + m_buffered->size && file_off >= m_buffered->off) {
-                const auto off = file_off - m_buffered->off;
-                const auto size = std::min<s64>(read_size, m_buffered->size - off);
-                if (size) {
-                    // log_write("[FAT] cache HIT at: %zu\n", file_off);
-                    std::memcpy(dst, m_buffered->data + off, size);
-
-                    read_size -= size;
-                    file_off += size;
-                    amount += size;
-                    dst += size;
-
-                    lru.Update(list);
-                    break;
-                }
-            }
-        }
-    }
+    while (read_size) {
+        // check if we can read this data into the beginning of dst.
+        if (m_size && file_off < m_off + m_size && file_off >= m_off) {
+            const auto off = file_off - m_off;
+            const auto size = std::min<s64>(read_size, m_size - off);
+            std::memcpy(dst, m_data.data() + off, size);
 
-    if (read_size) {
-        // log_write("[FAT] cache miss at: %zu %zu\n", file_off, read_size);
+            read_size -= size;
+            file_off += size;
+            amount += size;
+            dst += size;
+            continue;
+        }
 
-        auto alloc_size = large_read ? CACHE_LARGE_ALLOC_SIZE : std::max<u64>(read_size, 512 * 24);
-        alloc_size = std::min<s64>(alloc_size, capacity - file_off);
-        u64 bytes_read;
+        const auto sequential = m_size && file_off == m_off + m_size;
 
-        auto m_buffered = lru.GetNextFree();
-        m_buffered->Allocate(alloc_size);
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
 
-        // if the dst is big enough, read data in place.
-        if (read_size > alloc_size) {
-            R_TRY(source->Read(dst, file_off, read_size, &bytes_read));
-            // R_TRY(fsStorageRead(storage, file_off, dst, read_size));
-            read_size -= bytes_read;
-            file_off += bytes_read;
-            amount += bytes_read;
-            dst += bytes_read;
+        // the source can only be used by one thread at a time.
+        while (m_fetch_busy) {
+            condvarWait(&m_can_read, &m_mutex);
+        }
 
-            // save the last chunk of data to the m_buffered io.
-            const auto max_advance = std::min<u64>(amount, alloc_size);
-            m_buffered->off = file_off - max_advance;
-            m_buffered->size = max_advance;
-            std::memcpy(m_buffered->data, dst - max_advance, max_advance);
+        if (m_fetch_size && m_fetch_off == file_off && R_SUCCEEDED(m_fetch_rc)) {
+            // use the data fetched in the background.
+            std::swap(m_data, m_fetch_data);
+            m_off = m_fetch_off;
+            m_size = m_fetch_size;
+            m_fetch_size = 0;
+            m_window = std::min(m_window * 2, m_window_max);
         } else {
-            R_TRY(source->Read(m_buffered->data, file_off, alloc_size, &bytes_read));
-            // R_TRY(fsStorageRead(storage, file_off, m_buffered->data, alloc_size));
-			const auto max_advance = std::min<u64>(read_size, bytes_read);
-            std::memcpy(dst, m_buffered->data, max_advance);
+            // random access, discard the read ahead.
+            m_fetch_size = 0;
+            if (!sequential) {
+                m_window = m_alloc;
+            }
 
-            m_buffered->off = file_off;
-            m_buffered->size = bytes_read;
+            const auto alloc_size = std::min<s64>(m_window, capacity - file_off);
+            m_off = 0;
+            m_size = 0;
+            u64 bytes_read;
+
+            // if the dst is big enough, read data in place.
+            if (read_size > alloc_size) {
+                R_TRY(source->Read(dst, file_off, read_size, &bytes_read));
+                R_UNLESS(bytes_read, FsError_UnsupportedOperateRangeForFileStorage);
+
+                read_size -= bytes_read;
+                file_off += bytes_read;
+                amount += bytes_read;
+                dst += bytes_read;
+
+                // save the last chunk of data.
+                const auto max_advance = std::min<u64>(bytes_read, alloc_size);
+                m_data.resize(max_advance);
+                m_off = file_off - max_advance;
+                m_size = max_advance;
+                std::memcpy(m_data.data(), dst - max_advance, max_advance);
+            } else {
+                m_data.resize(alloc_size);
+                R_TRY(source->Read(m_data.data(), file_off, alloc_size, &bytes_read));
+                R_UNLESS(bytes_read, FsError_UnsupportedOperateRangeForFileStorage);
 
-            read_size -= max_advance;
-            file_off += max_advance;
-            amount += max_advance;
-            dst += max_advance;
+                m_off = file_off;
+                m_size = bytes_read;
+            }
+        }
+
+        // fetch the next chunk whilst this one is being read.
+        if (sequential && m_size && m_off + m_size < capacity) {
+            StartFetch(m_off + m_size);
         }
     }
 
@@ -693,48 +1069,202 @@ Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* by
     R_SUCCEED();
 }
 
-bool fix_path(const char* str, char* out, bool strip_leading_slash) {
-    str = std::strchr(str, ':');
-    if (!str) {
-        return false;
+void ReadAheadBufferedData::StartFetch(u64 off) {
+    if (!m_thread_created) {
+        // only create the thread once it is needed, as reads may never be sequential.
+        if (R_FAILED(utils::CreateThread(&m_thread, FetchThreadFunc, this))) {
+            return;
+        }
+
+        if (R_FAILED(threadStart(&m_thread))) {
+            threadClose(&m_thread);
+            return;
+        }
+
+        m_thread_created = true;
     }
 
-    // skip over ':'
-    str++;
-    size_t len = 0;
+    m_fetch_off = off;
+    m_fetch_size = 0;
+    m_fetch_data.resize(std::min<u64>(m_window, capacity - off));
+    m_fetch_busy = true;
+    condvarWakeOne(&m_can_fetch);
+}
 
-    // todo: hanle utf8 paths.
-    for (size_t i = 0; str[i]; i++) {
-        // skip multiple slashes.
-        if (i && str[i] == '/' && str[i - 1] == '/') {
-            continue;
+void ReadAheadBufferedData::FetchThread() {
+    mutexLock(&m_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+    for (;;) {
+        while (!m_exit && !m_fetch_busy) {
+            condvarWait(&m_can_fetch, &m_mutex);
         }
 
-        if (!i) {
-            // skip leading slash.
-            if (strip_leading_slash && str[i] == '/') {
-                continue;
-            }
+        if (m_exit) {
+            break;
+        }
+
+        u64 bytes_read{};
+        mutexUnlock(&m_mutex);
+        const auto rc = source->Read(m_fetch_data.data(), m_fetch_off, m_fetch_data.size(), &bytes_read);
+        mutexLock(&m_mutex);
+
+        m_fetch_rc = rc;
+        m_fetch_size = R_SUCCEEDED(rc) ? bytes_read : 0;
+        m_fetch_busy = false;
+        condvarWakeAll(&m_can_read);
+    }
+}
+
+void ReadAheadBufferedData::FetchThreadFunc(void* arg) {
+    static_cast<ReadAheadBufferedData*>(arg)->FetchThread();
+}
+
+LruBufferedData::LruBufferedData(const std::shared_ptr<yati::source::Base>& _source, u64 _size, const char* name)
+: BufferedDataBase{_source, _size}
+, m_cache_id{utils::block_cache::Register(name)} {
+}
+
+LruBufferedData::~LruBufferedData() {
+    utils::block_cache::Unregister(m_cache_id);
+}
+
+Result LruBufferedData::Read(void *_buffer, s64 file_off, s64 read_size, u64* bytes_read) {
+    // log_write("[FATFS] read offset: %zu size: %zu\n", file_off, read_size);
+    auto dst = static_cast<u8*>(_buffer);
+    size_t amount = 0;
+    *bytes_read = 0;
+
+    R_UNLESS(file_off < capacity, FsError_UnsupportedOperateRangeForFileStorage);
+    read_size = std::min<s64>(read_size, capacity - file_off);
 
-            // add leading slash.
-            if (!strip_leading_slash && str[i] != '/') {
-                out[len++] = '/';
+    // fatfs reads in max 16k chunks.
+    // knowing this, it's possible to detect large file reads by simply checking if
+    // the read size is 16k (or more, maybe in the further).
+    // however this would destroy random access performance, such as fetching 512 bytes.
+    // the fix was to use 2 block sizes, small for anything below 16k and large for the rest.
+    // the results in file reads 32MB -> 184MB and directory listing is instant.
+    const auto large_read = read_size >= CACHE_LARGE_SIZE;
+    const auto block_size = large_read ? CACHE_LARGE_ALLOC_SIZE : CACHE_LARGE_SIZE;
+
+    while (read_size) {
+        const auto block_off = utils::AlignDown<u64>(file_off, block_size);
+        const auto off = file_off - block_off;
+        u64 size;
+
+        if (!utils::block_cache::Read(m_cache_id, block_off, block_size, dst, off, read_size, &size)) {
+            // log_write("[FAT] cache miss at: %zu %zu\n", file_off, read_size);
+            u64 bytes_read;
+
+            // if the dst covers whole blocks, read data in place.
+            if (!off && read_size > block_size) {
+                const auto rsize = utils::AlignDown<u64>(read_size, block_size);
+                R_TRY(source->Read(dst, file_off, rsize, &bytes_read));
+                R_UNLESS(bytes_read == rsize, FsError_UnsupportedOperateRangeForFileStorage);
+
+                // save the last block as the next read may be within it.
+                SCOPED_MEM_TAG(utils::mem::Tag_Cache);
+                const auto last_off = rsize - block_size;
+                utils::block_cache::Insert(m_cache_id, file_off + last_off, block_size, std::vector<u8>(dst + last_off, dst + rsize));
+                size = rsize;
+            } else {
+                SCOPED_MEM_TAG(utils::mem::Tag_Cache);
+                std::vector<u8> data(std::min<u64>(block_size, capacity - block_off));
+                R_TRY(source->Read(data.data(), block_off, data.size(), &bytes_read));
+                R_UNLESS(bytes_read > off, FsError_UnsupportedOperateRangeForFileStorage);
+
+                data.resize(bytes_read);
+                size = std::min<u64>(read_size, bytes_read - off);
+                std::memcpy(dst, data.data() + off, size);
+                utils::block_cache::Insert(m_cache_id, block_off, block_size, std::move(data));
             }
         }
 
-        // save single char.
-        out[len++] = str[i];
+        read_size -= size;
+        file_off += size;
+        amount += size;
+        dst += size;
     }
 
-    // skip trailing slash.
-    if (len > 1 && out[len - 1] == '/') {
-        out[len - 1] = '\0';
+    *bytes_read = amount;
+    R_SUCCEED();
+}
+
+struct PrefetchCachedData::State {
+    State(const std::shared_ptr<yati::source::Base>& source, u64 size, const char* name)
+    : cache{source, size, name}, size{size} {
+        mutexInit(&mutex);
     }
 
-    // null the end.
-    out[len] = '\0';
+    // held for all reads, as the source may not be thread safe.
+    Mutex mutex{};
+    LruBufferedData cache;
+    const u64 size;
+    // only a single prefetch is in flight at a time.
+    std::atomic_bool busy{};
+    std::vector<u8> scratch{};
+};
 
-    return true;
+PrefetchCachedData::PrefetchCachedData(const std::shared_ptr<yati::source::Base>& source, u64 size, const char* name, u32 prefetch_blocks)
+: m_state{std::make_shared<State>(source, size, name)}
+, m_prefetch_blocks{std::max(prefetch_blocks, 1U)} {
+}
+
+Result PrefetchCachedData::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
+    {
+        SCOPED_MUTEX(&m_state->mutex);
+        R_TRY(m_state->cache.Read(buf, off, size, bytes_read));
+    }
+
+    const auto end = off + *bytes_read;
+    const auto sequential = off == m_last_end;
+    m_last_end = end;
+
+    // small reads are likely to be table lookups, so only prefetch for file data.
+    if (sequential && size >= (s64)CACHE_LARGE_SIZE) {
+        Prefetch(end);
+    }
+
+    R_SUCCEED();
+}
+
+void PrefetchCachedData::Prefetch(u64 end) {
+    const auto next = utils::AlignUp<u64>(end, CACHE_LARGE_ALLOC_SIZE);
+    const auto last = std::min<u64>(m_state->size, next + m_prefetch_blocks * CACHE_LARGE_ALLOC_SIZE);
+
+    // skip the blocks that have already been prefetched for this run.
+    auto start = next;
+    if (m_prefetch_end > next && m_prefetch_end <= last) {
+        start = m_prefetch_end;
+    }
+
+    if (start >= last || m_state->busy.exchange(true)) {
+        return;
+    }
+
+    m_prefetch_end = last;
+
+    // the state is kept alive by the task, in case it's unmounted before the task runs.
+    utils::task::Push([state = m_state, start, last]() {
+        ON_SCOPE_EXIT(state->busy = false);
+
+        for (auto off = start; off < last; off += CACHE_LARGE_ALLOC_SIZE) {
+            // skip if the device is reading, the task may also have been picked
+            // up by a thread waiting on a group whilst holding the lock.
+            if (!mutexTryLock(&state->mutex)) {
+                return;
+            }
+            ON_SCOPE_EXIT(mutexUnlock(&state->mutex));
+
+            // reading the whole block inserts it into the cache.
+            u64 bytes_read;
+            state->scratch.resize(std::min<u64>(CACHE_LARGE_ALLOC_SIZE, state->size - off));
+            if (R_FAILED(state->cache.Read(state->scratch.data(), off, state->scratch.size(), &bytes_read))) {
+                log_write("[DEVOPTAB] failed to prefetch at: %zu\n", (size_t)off);
+                return;
+            }
+        }
+    }, utils::task::Priority::Low);
 }
 
 void update_devoptab_for_read_only(devoptab_t* devoptab, bool read_only) {
@@ -763,6 +1293,7 @@ void LoadConfigsFromIni(const fs::FsPath& path, MountConfigs& out_configs) {
         // add new entry if use section changed.
         if (e->empty() || std::strcmp(Section, e->back().name.c_str())) {
             e->emplace_back(Section);
+            e->back().cache_ttl = DEFAULT_CACHE_TTL;
         }
 
         if (!std::strcmp(Key, "url")) {
@@ -782,6 +1313,8 @@ void LoadConfigsFromIni(const fs::FsPath& path, MountConfigs& out_configs) {
             }
         } else if (!std::strcmp(Key, "timeout")) {
             e->back().timeout = ini_parse_getl(Value, e->back().timeout);
+        } else if (!std::strcmp(Key, "connect_timeout")) {
+            e->back().connect_timeout = std::max<long>(0, ini_parse_getl(Value, e->back().connect_timeout));
         } else if (!std::strcmp(Key, "read_only")) {
             e->back().read_only = ini_parse_getbool(Value, e->back().read_only);
         } else if (!std::strcmp(Key, "no_stat_file")) {
@@ -792,6 +1325,12 @@ void LoadConfigsFromIni(const fs::FsPath& path, MountConfigs& out_configs) {
             e->back().fs_hidden = ini_parse_getbool(Value, e->back().fs_hidden);
         } else if (!std::strcmp(Key, "dump_hidden")) {
             e->back().dump_hidden = ini_parse_getbool(Value, e->back().dump_hidden);
+        } else if (!std::strcmp(Key, "buffer_size")) {
+            e->back().buffer_size = std::max<long>(0, ini_parse_getl(Value, e->back().buffer_size));
+        } else if (!std::strcmp(Key, "stdio_buffer_size")) {
+            e->back().stdio_buffer_size = std::max<long>(0, ini_parse_getl(Value, e->back().stdio_buffer_size));
+        } else if (!std::strcmp(Key, "cache_ttl")) {
+            e->back().cache_ttl = std::max<long>(0, ini_parse_getl(Value, e->back().cache_ttl));
         } else {
             log_write("[DEVOPTAB] INI: extra key %s=%s\n", Key, Value);
             e->back().extra.emplace(Key, Value);
@@ -858,6 +1397,7 @@ bool MountNetworkDevice2(std::unique_ptr<MountDevice>&& device, const MountConfi
     }
 
     log_write("[DEVOPTAB] DEVICE SUCCESS %s %s\n", name, mount_name);
+    fs::SetStdioBufferSize(entry->name, entry->device.mount_device->GetStdioBufferSize());
 
     entry->ref_count++;
     *itr = std::move(entry);
@@ -944,12 +1484,23 @@ Result MountNetworkDevice(const CreateDeviceCallback& create_device, size_t file
             log_write("[DEVOPTAB] Failed to mount %s\n", config.name.c_str());
             continue;
         }
+
+        auto it = std::ranges::find_if(g_entries, [&](const auto& e){
+            return e && e->mount == _mount;
+        });
+
+        if (it != g_entries.end()) {
+            (*it)->device.connecting = true;
+            g_connect_queue.Push(_mount);
+        }
     }
 
     R_SUCCEED();
 }
 
-PushPullThreadData::PushPullThreadData(CURL* _curl) : curl{_curl} {
+PushPullThreadData::PushPullThreadData(CURL* _curl, size_t buffer_size)
+: curl{_curl}
+, ring{std::max(buffer_size, MIN_BUFFER_SIZE)} {
     mutexInit(&mutex);
     condvarInit(&can_push);
     condvarInit(&can_pull);
@@ -965,7 +1516,10 @@ PushPullThreadData::~PushPullThreadData() {
         log_write("[PUSH:PULL] Thread exited\n");
     }
 
-    threadClose(&thread);
+    // the thread is never created if the data is only used as a queue.
+    if (thread.handle) {
+        threadClose(&thread);
+    }
 }
 
 Result PushPullThreadData::CreateAndStart() {
@@ -990,22 +1544,43 @@ void PushPullThreadData::Cancel() {
 }
 
 bool PushPullThreadData::IsRunning() {
-    SCOPED_MUTEX(&mutex);
     return !finished && !error;
 }
 
+bool PushPullThreadData::Finish() {
+    Cancel();
+
+    if (started) {
+        threadWaitForExit(&thread);
+    }
+
+    return !error && code < 400;
+}
+
+void PushPullThreadData::WakePull() {
+    // only take the lock if the other side is blocked.
+    if (pull_waiting) {
+        SCOPED_MUTEX(&mutex);
+        condvarWakeOne(&can_pull);
+    }
+}
+
+void PushPullThreadData::WakePush() {
+    if (push_waiting) {
+        SCOPED_MUTEX(&mutex);
+        condvarWakeOne(&can_push);
+    }
+}
+
 size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
     if (!data || !total_size) {
         return 0;
     }
 
-    SCOPED_MUTEX(&mutex);
-    ON_SCOPE_EXIT(condvarWakeOne(&can_push));
-
     if (curl) {
         // this should be handled in the progress function.
         // however i handle it here as well just in case.
-        if (buffer.empty()) {
+        if (ring.IsEmpty()) {
             if (finished) {
                 log_write("[PUSH:PULL] PullData: finished and no data\n");
                 return 0;
@@ -1015,28 +1590,35 @@ size_t PushPullThreadData::PullData(char* data, size_t total_size, bool curl) {
         }
 
         // read what we can.
-        const auto rsize = std::min(total_size, buffer.size());
-        std::memcpy(data, buffer.data(), rsize);
-        buffer.erase(buffer.begin(), buffer.begin() + rsize);
+        const auto rsize = ring.Read(data, total_size);
+        WakePush();
         return rsize;
     } else {
         // if we are not in a curl callback, then we can block until we have data.
         size_t bytes_read = 0;
         while (bytes_read < total_size && !error) {
-            if (buffer.empty()) {
-                if (finished) {
+            const auto rsize = ring.Read(data + bytes_read, total_size - bytes_read);
+            if (rsize) {
+                bytes_read += rsize;
+                WakePush();
+                continue;
+            }
+
+            // data may have been pushed just before finishing, so check again.
+            if (finished) {
+                if (ring.IsEmpty()) {
                     break;
                 }
-
-                condvarWakeOne(&can_push);
-                condvarWait(&can_pull, &mutex);
                 continue;
             }
 
-            const auto rsize = std::min(total_size - bytes_read, buffer.size());
-            std::memcpy(data + bytes_read, buffer.data(), rsize);
-            buffer.erase(buffer.begin(), buffer.begin() + rsize);
-            bytes_read += rsize;
+            mutexLock(&mutex);
+            pull_waiting = true;
+            if (ring.IsEmpty() && !finished && !error) {
+                condvarWaitTimeout(&can_pull, &mutex, 1e+8); // 100ms
+            }
+            pull_waiting = false;
+            mutexUnlock(&mutex);
         }
 
         return bytes_read;
@@ -1048,35 +1630,36 @@ size_t PushPullThreadData::PushData(const char* data, size_t total_size, bool cu
         return 0;
     }
 
-    SCOPED_MUTEX(&mutex);
-    ON_SCOPE_EXIT(condvarWakeOne(&can_pull));
-
     if (curl) {
         // this should be handled in the progress function.
         // however i handle it here as well just in case.
-        if (buffer.size() + total_size > MAX_BUFFER_SIZE) {
+        if (ring.Space() < total_size) {
             return CURL_WRITEFUNC_PAUSE;
         }
 
         // blocking / pausing is handled in the progress function.
         // do NOT block here as curl does not like it and it will deadlock.
-        // the mutex block above is fine as it only blocks to perform a memcpy.
-        buffer.insert(buffer.end(), data, data + total_size);
+        ring.Write(data, total_size);
+        WakePull();
         return total_size;
     } else {
         // if we are not in a curl callback, then we can block until we have space.
         size_t bytes_written = 0;
         while (bytes_written < total_size && !error && !finished) {
-            const size_t space_left = MAX_BUFFER_SIZE - buffer.size();
-            if (space_left == 0) {
-                condvarWakeOne(&can_pull);
-                condvarWait(&can_push, &mutex);
+            const auto wsize = ring.Write(data + bytes_written, total_size - bytes_written);
+            if (wsize) {
+                bytes_written += wsize;
+                WakePull();
                 continue;
             }
 
-            const auto wsize = std::min(total_size - bytes_written, space_left);
-            buffer.insert(buffer.end(), data + bytes_written, data + bytes_written + wsize);
-            bytes_written += wsize;
+            mutexLock(&mutex);
+            push_waiting = true;
+            if (!ring.Space() && !finished && !error) {
+                condvarWaitTimeout(&can_push, &mutex, 1e+8); // 100ms
+            }
+            push_waiting = false;
+            mutexUnlock(&mutex);
         }
 
         return bytes_written;
@@ -1106,8 +1689,6 @@ size_t PushPullThreadData::progress_callback(void *clientp, curl_off_t dltotal,
     bool should_pause;
 
     {
-        SCOPED_MUTEX(&data->mutex);
-
         // abort early if there was an error.
         if (data->error) {
             log_write("[PUSH:PULL] progress_callback: aborting transfer, error set\n");
@@ -1130,12 +1711,12 @@ size_t PushPullThreadData::progress_callback(void *clientp, curl_off_t dltotal,
                 return 1;
             }
 
-            // pause if the buffer is full, otherwise continue.
-            should_pause = data->buffer.size() >= MAX_BUFFER_SIZE;
+            // pause if there isn't space for a full write, otherwise continue.
+            should_pause = data->ring.Space() < CURL_MAX_WRITE_SIZE;
         } else {
             // pause if we have no data to send, otherwise continue.
             // do not pause if finished as curl may have internal data pending to send.
-            should_pause = !data->finished && data->buffer.empty();
+            should_pause = !data->finished && data->ring.IsEmpty();
         }
     }
 
@@ -1182,8 +1763,8 @@ MountCurlDevice::~MountCurlDevice() {
         curl_easy_cleanup(curl);
     }
 
-    if (transfer_curl) {
-        curl_easy_cleanup(transfer_curl);
+    for (auto handle : m_handle_pool) {
+        curl_easy_cleanup(handle);
     }
 
     if (m_curl_share) {
@@ -1205,14 +1786,6 @@ bool MountCurlDevice::Mount() {
         }
     }
 
-    if (!transfer_curl) {
-        transfer_curl = curl_easy_init();
-        if (!transfer_curl) {
-            log_write("[CURL] transfer curl_easy_init() failed\n");
-            return false;
-        }
-    }
-
     // setup url, only the path is updated at runtime.
     if (!curlu) {
         curlu = curl_url();
@@ -1273,7 +1846,7 @@ bool MountCurlDevice::Mount() {
         }
     }
 
-    // create share handle, used to share info between curl and transfer_curl.
+    // create share handle, used to share info between curl and the leased handles.
     if (!m_curl_share) {
         m_curl_share = curl_share_init();
         if (!m_curl_share) {
@@ -1320,7 +1893,7 @@ bool MountCurlDevice::Mount() {
 }
 
 PushThreadData* MountCurlDevice::CreatePushData(CURL* curl, const std::string& url, size_t offset) {
-    auto data = new PushThreadData{curl};
+    auto data = new PushThreadData{curl, config.buffer_size ? size_t(config.buffer_size) : PushThreadData::DEFAULT_BUFFER_SIZE};
     if (!data) {
         log_write("[PUSH:PULL] Failed to allocate PushThreadData\n");
         return nullptr;
@@ -1347,7 +1920,7 @@ PushThreadData* MountCurlDevice::CreatePushData(CURL* curl, const std::string& u
 }
 
 PullThreadData* MountCurlDevice::CreatePullData(CURL* curl, const std::string& url, bool append) {
-    auto data = new PullThreadData{curl};
+    auto data = new PullThreadData{curl, config.buffer_size ? size_t(config.buffer_size) : PullThreadData::DEFAULT_BUFFER_SIZE};
     if (!data) {
         log_write("[PUSH:PULL] Failed to allocate PullThreadData\n");
         return nullptr;
@@ -1372,6 +1945,33 @@ PullThreadData* MountCurlDevice::CreatePullData(CURL* curl, const std::string& u
     return data;
 }
 
+CURL* MountCurlDevice::acquire_handle() {
+    if (!m_handle_pool.empty()) {
+        auto handle = m_handle_pool.back();
+        m_handle_pool.pop_back();
+        return handle;
+    }
+
+    auto handle = curl_easy_init();
+    if (!handle) {
+        log_write("[CURL] curl_easy_init() failed\n");
+    }
+
+    return handle;
+}
+
+void MountCurlDevice::release_handle(CURL* handle) {
+    if (!handle) {
+        return;
+    }
+
+    if (m_handle_pool.size() >= CURL_MAX_POOLED_HANDLES) {
+        curl_easy_cleanup(handle);
+    } else {
+        m_handle_pool.emplace_back(handle);
+    }
+}
+
 void MountCurlDevice::curl_set_common_options(CURL* curl, const std::string& url) {
     // NOTE: port, user and pass are set in the curl_url.
     curl_easy_reset(curl);
@@ -1386,12 +1986,14 @@ void MountCurlDevice::curl_set_common_options(CURL* curl, const std::string& url
     curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, 1024L * 64L);
     curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
+    // curl waits upto 300s by default.
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, config.GetConnectTimeout());
+
     if (config.timeout > 0) {
         // cancel if speed is less than 1 bytes/sec for timeout seconds.
         curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
         // todo: change config to accept seconds rather than ms.
         curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, config.timeout / 1000L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, config.timeout);
     }
 
     if (m_curl_share) {
@@ -1435,76 +2037,8 @@ size_t MountCurlDevice::read_data_callback(char *ptr, size_t size, size_t nmemb,
     return rsize;
 }
 
-// libcurl doesn't handle html encodings, so we have to do it manually.
-std::string MountCurlDevice::html_decode(const std::string_view& str) {
-    struct Entry {
-        std::string_view key;
-        char value;
-    };
-
-    static constexpr Entry map[]{
-        { "&amp;", '&' },
-        { "&lt;", '<' },
-        { "&gt;", '>' },
-        { "&quot;", '"' },
-        { "&apos;", '\'' },
-        { "&nbsp;", ' ' },
-        { "&#38;", '&' },
-        { "&#60;", '<' },
-        { "&#62;", '>' },
-        { "&#34;", '"' },
-        { "&#39;", '\'' },
-        { "&#160;", ' ' },
-        { "&#35;", '#' },
-        { "&#37;", '%' },
-        { "&#43;", '+' },
-        { "&#61;", '=' },
-        { "&#64;", '@' },
-        { "&#91;", '[' },
-        { "&#93;", ']' },
-        { "&#123;", '{' },
-        { "&#125;", '}' },
-        { "&#126;", '~' },
-    };
-
-    std::string output{};
-    output.reserve(str.size());
-
-    for (size_t i = 0; i < str.size(); i++) {
-        if (str[i] == '&') {
-            bool found = false;
-            for (const auto& e : map) {
-                if (!str.compare(i, e.key.length(), e.key)) {
-                    output += e.value;
-                    i += e.key.length() - 1; // skip ahead.
-                    found = true;
-                    break;
-                }
-            }
-
-            if (!found) {
-                output += '&';
-            }
-        } else {
-            output += str[i];
-        }
-    }
-
-    return output;
-}
-
-std::string MountCurlDevice::url_decode(const std::string& str) {
-    auto unescaped = curl_unescape(str.c_str(), str.length());
-    if (!unescaped) {
-        return str;
-    }
-    ON_SCOPE_EXIT(curl_free(unescaped));
-
-    return html_decode(unescaped);
-}
-
 std::string MountCurlDevice::build_url(const std::string& _path, bool is_dir) {
-    log_write("[CURL] building url for path: %s\n", _path.c_str());
+    log_debug(LogCategory_Net, "[CURL] building url for path: %s\n", _path.c_str());
     auto path = _path;
     if (is_dir && !path.ends_with('/')) {
         path += '/'; // append trailing slash for folder.
@@ -1549,7 +2083,7 @@ Result GetNetworkDevices(location::StdioEntries& out) {
     out.clear();
 
     for (const auto& entry : g_entries) {
-        if (entry) {
+        if (entry && !entry->device.connecting) {
             const auto& config = entry->device.config;
 
             u32 flags = 0;
@@ -1562,6 +2096,9 @@ Result GetNetworkDevices(location::StdioEntries& out) {
             if (config.no_stat_dir) {
                 flags |= location::FsEntryFlag::FsEntryFlag_NoStatDir;
             }
+            if (!entry->device.mount_device->IsRandomAccessSafe()) {
+                flags |= location::FsEntryFlag::FsEntryFlag_NoRandomReads;
+            }
 
             out.emplace_back(entry->mount, entry->name, flags, config.dump_path, config.fs_hidden, config.dump_hidden);
         }
@@ -1571,6 +2108,8 @@ Result GetNetworkDevices(location::StdioEntries& out) {
 }
 
 void UmountAllNeworkDevices() {
+    // the workers take the lock, so they're stopped first.
+    g_connect_queue.Close();
     SCOPED_RWLOCK(&g_rwlock, true);
 
     for (auto& entry : g_entries) {
@@ -1598,6 +2137,38 @@ void UmountNeworkDevice(const fs::FsPath& mount) {
     }
 }
 
+Result ServerCopyFile(const fs::FsPath& src, const fs::FsPath& dst) {
+    SCOPED_RWLOCK(&g_rwlock, false);
+
+    const auto it = std::ranges::find_if(g_entries, [&](const auto& e){
+        return e && std::string_view{src}.starts_with(e->mount.s) && std::string_view{dst}.starts_with(e->mount.s);
+    });
+
+    R_UNLESS(it != g_entries.end(), Result_DevoptabServerCopyNotSupported);
+    auto& device = (*it)->device;
+    R_UNLESS(!device.connecting, Result_DevoptabServerCopyNotSupported);
+
+    SCOPED_MUTEX(&device.mutex);
+    R_UNLESS(!device.config.read_only, Result_FsReadOnly);
+
+    char src_path[PATH_MAX]{};
+    char dst_path[PATH_MAX]{};
+    R_UNLESS(device.mount_device->fix_path(src, src_path), Result_DevoptabServerCopyFailed);
+    R_UNLESS(device.mount_device->fix_path(dst, dst_path), Result_DevoptabServerCopyFailed);
+    R_UNLESS(device.mount_device->Mount(), Result_DevoptabServerCopyFailed);
+
+    device.mount_device->metadata_cache.Invalidate(dst_path);
+    const auto ret = device.mount_device->devoptab_copy(src_path, dst_path);
+    R_UNLESS(ret != -ENOTSUP, Result_DevoptabServerCopyNotSupported);
+
+    if (ret) {
+        log_write("[DEVOPTAB] server copy failed: %s to %s errno: %s\n", src.s, dst.s, std::strerror(-ret));
+        R_THROW(Result_DevoptabServerCopyFailed);
+    }
+
+    R_SUCCEED();
+}
+
 void FixDkpBug() {
     const int max = 35;
 
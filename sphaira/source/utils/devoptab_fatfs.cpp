@@ -1,5 +1,6 @@
 #include "utils/devoptab_common.hpp"
 #include "utils/profile.hpp"
+#include "utils/utils.hpp"
 
 #include "log.hpp"
 #include "defines.hpp"
@@ -10,6 +11,7 @@
 #include <vector>
 #include <memory>
 #include <cstring>
+#include <algorithm>
 #include <sys/stat.h>
 #include <ff.h>
 
@@ -45,6 +47,9 @@ static_assert(std::size(BIS_MOUNT_ENTRIES) == FF_VOLUMES);
 
 FatStorageEntry g_fat_storage[FF_VOLUMES];
 
+// initial size of the cluster link map, grown if the file is very fragmented.
+constexpr UINT LINK_MAP_INITIAL_SIZE = 64;
+
 // todo: replace with off+size and have the data be in another struct
 // in order to be more lcache efficient.
 struct FsStorageSource final : yati::source::Base {
@@ -135,6 +140,110 @@ FIL* get_current_file(File* file) {
     return NULL;
 }
 
+// builds the cluster link map (list of contiguous cluster runs) for the file.
+// this walks the fat once on open, after which seeking no longer follows
+// the chain and reads can find contiguous runs without touching the fat.
+// on failure the file is left using the normal chain walk.
+void create_link_map(FIL* fil) {
+    auto size = LINK_MAP_INITIAL_SIZE;
+
+    for (;;) {
+        auto tbl = (DWORD*)std::malloc(size * sizeof(DWORD));
+        if (!tbl) {
+            return;
+        }
+
+        tbl[0] = size;
+        fil->cltbl = tbl;
+
+        const auto res = f_lseek(fil, CREATE_LINKMAP);
+        if (res == FR_OK) {
+            return;
+        }
+
+        // on FR_NOT_ENOUGH_CORE, the first entry is the required size.
+        const auto required = tbl[0];
+        fil->cltbl = nullptr;
+        std::free(tbl);
+
+        if (res != FR_NOT_ENOUGH_CORE || required <= size) {
+            log_write("[FATFS] failed to create link map: %d\n", res);
+            return;
+        }
+
+        size = required;
+    }
+}
+
+void free_link_map(FIL* fil) {
+    std::free(fil->cltbl);
+    fil->cltbl = nullptr;
+}
+
+// f_read() splits reads at every cluster boundary, which for small clusters
+// results in many small disk reads, even if the file is contiguous.
+// this reads the whole contiguous run the read falls in with a single read.
+// returns 0 if the read should be handled by f_read() instead.
+ssize_t read_contiguous(FIL* fil, void* ptr, size_t len) {
+    if (!fil->cltbl || fil->fptr % FF_MAX_SS) {
+        return 0;
+    }
+
+    const auto fs = fil->obj.fs;
+    const u64 cluster_size = (u64)fs->csize * FF_MAX_SS;
+    const auto fptr = (u64)fil->fptr;
+    const auto cluster_off = fptr % cluster_size;
+
+    // only whole sectors can be read in place.
+    auto size = std::min<u64>(len, f_size(fil) - fptr);
+    size = utils::AlignDown<u64>(size, FF_MAX_SS);
+
+    // f_read() already handles reads within a single cluster.
+    if (size <= cluster_size - cluster_off) {
+        return 0;
+    }
+
+    // find the run that the offset is in.
+    auto cl = (DWORD)(fptr / cluster_size);
+    auto tbl = fil->cltbl + 1;
+    DWORD ncl;
+    for (;;) {
+        ncl = *tbl++;
+        if (!ncl) {
+            return 0;
+        }
+
+        if (cl < ncl) {
+            break;
+        }
+
+        cl -= ncl;
+        tbl++;
+    }
+
+    const auto clst = *tbl + cl;
+    if (clst < 2 || clst >= fs->n_fatent) {
+        return 0;
+    }
+
+    size = std::min<u64>(size, (ncl - cl) * cluster_size - cluster_off);
+    if (size <= cluster_size - cluster_off) {
+        return 0;
+    }
+
+    const auto sector = fs->database + (LBA_t)fs->csize * (clst - 2) + cluster_off / FF_MAX_SS;
+    if (R_FAILED(g_fat_storage[fs->pdrv].buffered->Read2(ptr, sector * FF_MAX_SS, size))) {
+        return -EIO;
+    }
+
+    // this uses the link map, so it doesn't walk the chain or read the disk.
+    if (FR_OK != f_lseek(fil, fptr + size)) {
+        return -EIO;
+    }
+
+    return size;
+}
+
 // adjusts current file pos and sets the rest of files to 0.
 void set_current_file_pos(File* file) {
     s64 off = file->off;
@@ -224,7 +333,7 @@ bool Device::Mount() {
             return false;
         }
 
-        fat.buffered = std::make_unique<common::LruBufferedData>(source, size);
+        fat.buffered = std::make_unique<common::LruBufferedData>(source, size, BIS_MOUNT_ENTRIES[m_type].mount_name);
         if (!fat.buffered) {
             log_write("[FATFS] Failed to create LruBufferedData\n");
             return false;
@@ -254,6 +363,7 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
         file->file_count = 1;
         std::memcpy(file->files, &fil, sizeof(*file->files));
+        create_link_map(&file->files[0]);
         // todo: check what error code is returned here.
     } else {
         FILINFO info{};
@@ -280,6 +390,7 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
             }
 
             std::memcpy(&file->files[i], &fil, sizeof(fil));
+            create_link_map(&file->files[i]);
             file->file_count++;
         }
     }
@@ -297,6 +408,7 @@ int Device::devoptab_close(void *fd) {
 
     for (u32 i = 0; i < file->file_count; i++) {
         f_close(&file->files[i]);
+        free_link_map(&file->files[i]);
     }
 
     std::free(file->files);
@@ -315,7 +427,12 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
             return -EIO;
         }
 
-        if (FR_OK != f_read(fil, ptr, len, &bytes_read)) {
+        const auto rc = read_contiguous(fil, ptr, len);
+        if (rc < 0) {
+            return rc;
+        } else if (rc) {
+            bytes_read = rc;
+        } else if (FR_OK != f_read(fil, ptr, len, &bytes_read)) {
             return -EIO;
         }
 
@@ -363,7 +480,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 int Device::devoptab_diropen(void* fd, const char *path) {
     auto dir = static_cast<Dir*>(fd);
 
-    log_write("[FATFS] diropen: %s\n", path);
+    log_debug(LogCategory_Devoptab, "[FATFS] diropen: %s\n", path);
     if (FR_OK != f_opendir(&dir->dir, path)) {
         log_write("[FATFS] f_opendir(%s) failed\n", path);
         return -ENOENT;
@@ -21,7 +21,7 @@ namespace {
 
 struct DirEntry {
     std::string name{};
-    bool is_dir{};
+    struct stat st{};
 };
 using DirEntries = std::vector<DirEntry>;
 
@@ -73,6 +73,7 @@ private:
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
     size_t off;
     size_t last_off;
@@ -225,14 +226,13 @@ void Device::ftp_parse_mlsd(std::string_view chunk, DirEntries& out) {
             continue;
         }
 
+        // the full facts are parsed so that the listing can also answer lstat.
         DirEntry entry{};
-        struct stat st{};
-        if (!ftp_parse_mlst_line(line_str, &st, &entry.name, true)) {
+        if (!ftp_parse_mlst_line(line_str, &entry.st, &entry.name, false)) {
             log_write("[FTP] Failed to parse MLSD line: %.*s\n", (int)line.size(), line.data());
             continue;
         }
 
-        entry.is_dir = S_ISDIR(st.st_mode);
         out.emplace_back(entry);
     }
 }
@@ -452,7 +452,13 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
     if ((flags & O_ACCMODE) == O_RDONLY || (flags & O_APPEND)) {
         // ensure the file exists and get its size.
-        const auto ret = ftp_stat(path, &st, false);
+        // reads can use the cached listing, appends need the real size.
+        int ret;
+        if ((flags & O_APPEND) || !metadata_cache.GetStat(path, &st, ret)) {
+            ret = ftp_stat(path, &st, false);
+            metadata_cache.SetStat(path, &st, ret);
+        }
+
         if (ret < 0) {
             return ret;
         }
@@ -463,6 +469,12 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         }
     }
 
+    // each open file gets its own handle so that transfers don't block each other.
+    file->curl = acquire_handle();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
     file->entry = new FileEntry{path, st};
     file->write_mode = (flags & (O_WRONLY | O_RDWR));
     file->append_mode = (flags & O_APPEND);
@@ -478,9 +490,19 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
+    // uploads are only complete once curl has sent everything, so report
+    // the error here rather than losing it.
+    int ret = 0;
+    if (file->write_mode && file->push_pull_thread_data && !file->push_pull_thread_data->Finish()) {
+        log_write("[FTP] Upload failed for file: %s code: %ld\n", file->entry->path.c_str(), file->push_pull_thread_data->code);
+        ret = -EIO;
+    }
+
+    // stops the transfer before the handle is reused.
     delete file->push_pull_thread_data;
+    release_handle(file->curl);
     delete file->entry;
-    return 0;
+    return ret;
 }
 
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
@@ -505,7 +527,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[FTP] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[FTP] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -533,7 +555,7 @@ ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[FTP] Creating upload thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePullData(this->transfer_curl, build_url(file->entry->path, false), file->append_mode);
+        file->push_pull_thread_data = CreatePullData(file->curl, build_url(file->entry->path, false), file->append_mode);
         if (!file->push_pull_thread_data) {
             log_write("[FTP] Failed to create upload thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -645,14 +667,8 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
         return -ENOENT;
     }
 
-    auto& entry = (*dir->entries)[dir->index];
-    if (entry.is_dir) {
-        filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else {
-        filestat->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-    }
-
-    filestat->st_nlink = 1;
+    const auto& entry = (*dir->entries)[dir->index];
+    std::memcpy(filestat, &entry.st, sizeof(*filestat));
     std::strcpy(filename, entry.name.c_str());
 
     dir->index++;
@@ -11,10 +11,14 @@
 #include "yati/nx/es.hpp"
 #include "yati/nx/ns.hpp"
 
+#include "utils/thread.hpp"
+
 #include <cstring>
 #include <array>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include <unordered_map>
 
 namespace sphaira::devoptab {
 namespace {
@@ -29,6 +33,8 @@ struct ContentEntry {
 struct Entry final : game::Entry {
     std::string name{};
     std::vector<ContentEntry> contents{};
+    // set once the index thread has built every nsp for this entry.
+    bool indexed{};
 };
 
 struct File {
@@ -98,10 +104,25 @@ private:
     game::NspEntry* FindNspFromEntry(Entry& entry, u64 id) const;
     Entry* FindEntry(u64 app_id);
     Result LoadMetaEntries(Entry& entry) const;
+    Result BuildNsp(const Entry& entry, ContentEntry& content) const;
+    void LoadName(Entry& entry) const;
+
+    // builds the name, contents and nsp layout of every entry in the background
+    // so that listing the mount doesn't do ns / ncm / es ipc for each title.
+    // anything that is requested before the thread gets to it is built on demand.
+    static void IndexThreadFunc(void* arg);
+    void IndexEntries();
 
 private:
     std::vector<Entry> m_entries{};
+    // app_id -> index into m_entries.
+    std::unordered_map<u64, u32> m_entry_map{};
     keys::Keys m_keys{};
+    // protects m_entries between the devoptab calls and the index thread.
+    Mutex m_mutex{};
+    Thread m_index_thread{};
+    std::atomic_bool m_index_exit{};
+    bool m_index_running{};
     bool m_title_init{};
     bool m_es_init{};
     bool m_ns_init{};
@@ -110,6 +131,12 @@ private:
 };
 
 Device::~Device() {
+    if (m_index_running) {
+        m_index_exit = true;
+        threadWaitForExit(&m_index_thread);
+        threadClose(&m_index_thread);
+    }
+
     if (m_title_init) {
         title::Exit();
     }
@@ -139,6 +166,53 @@ Result Device::LoadMetaEntries(Entry& entry) const {
     R_SUCCEED();
 }
 
+Result Device::BuildNsp(const Entry& entry, ContentEntry& content) const {
+    // check if we have already built the nsp.
+    if (content.nsp) {
+        R_SUCCEED();
+    }
+
+    game::ContentInfoEntry info;
+    R_TRY(game::BuildContentEntry(content.status, info));
+
+    auto nsp = std::make_unique<game::NspEntry>();
+    R_TRY(game::BuildNspEntry(entry, info, m_keys, *nsp));
+
+    // update path to strip the folder, if it has one.
+    const auto slash = std::strchr(nsp->path, '/');
+    if (slash) {
+        std::memmove(nsp->path, slash + 1, std::strlen(slash));
+    }
+
+    content.nsp = std::move(nsp);
+    R_SUCCEED();
+}
+
+void Device::LoadName(Entry& entry) const {
+    if (entry.status != title::NacpLoadStatus::None) {
+        return;
+    }
+
+    // this will never be null as it blocks until a valid entry is loaded.
+    auto result = title::Get(entry.app_id);
+    entry.lang = result->lang;
+    entry.status = result->status;
+
+    char name[NAME_MAX]{};
+    if (result->status == title::NacpLoadStatus::Loaded) {
+        fs::FsPath name_buf = result->lang.name;
+        title::utilsReplaceIllegalCharacters(name_buf, true);
+
+        const int name_max = sizeof(name) - 33;
+        std::snprintf(name, sizeof(name), "%.*s [%016lX]", name_max, name_buf.s, entry.app_id);
+    } else {
+        std::snprintf(name, sizeof(name), "[%016lX]", entry.app_id);
+        log_write("[GAME] failed to get title info for %s\n", name);
+    }
+
+    entry.name = name;
+}
+
 game::NspEntry* Device::FindNspFromEntry(Entry& entry, u64 id) const {
     // load all meta entries if not yet loaded.
     if (R_FAILED(LoadMetaEntries(entry))) {
@@ -149,26 +223,13 @@ game::NspEntry* Device::FindNspFromEntry(Entry& entry, u64 id) const {
     // try and find the matching nsp entry.
     for (auto& content : entry.contents) {
         if (content.status.application_id == id) {
-            // build nsp entry if not yet built.
-            if (!content.nsp) {
-                game::ContentInfoEntry info;
-                if (R_FAILED(game::BuildContentEntry(content.status, info))) {
-                    log_write("[GAME] failed to build content info for app id: %016lx\n", entry.app_id);
-                    return nullptr;
-                }
+            // the name is part of the nsp path.
+            LoadName(entry);
 
-                content.nsp = std::make_unique<game::NspEntry>();
-                if (R_FAILED(game::BuildNspEntry(entry, info, m_keys, *content.nsp))) {
-                    log_write("[GAME] failed to build nsp entry for app id: %016lx\n", entry.app_id);
-                    content.nsp.reset();
-                    return nullptr;
-                }
-
-                // update path to strip the folder, if it has one.
-                const auto slash = std::strchr(content.nsp->path, '/');
-                if (slash) {
-                    std::memmove(content.nsp->path, slash + 1, std::strlen(slash));
-                }
+            // build nsp entry if not yet built.
+            if (R_FAILED(BuildNsp(entry, content))) {
+                log_write("[GAME] failed to build nsp entry for app id: %016lx\n", entry.app_id);
+                return nullptr;
             }
 
             return content.nsp.get();
@@ -180,12 +241,11 @@ game::NspEntry* Device::FindNspFromEntry(Entry& entry, u64 id) const {
 }
 
 Entry* Device::FindEntry(u64 app_id) {
-    for (auto& entry : m_entries) {
-        if (entry.app_id == app_id) {
-            // the error doesn't matter here, the fs will just report an empty dir.
-            LoadMetaEntries(entry);
-            return &entry;
-        }
+    if (const auto it = m_entry_map.find(app_id); it != m_entry_map.end()) {
+        auto& entry = m_entries[it->second];
+        // the error doesn't matter here, the fs will just report an empty dir.
+        LoadMetaEntries(entry);
+        return &entry;
     }
 
     log_write("[GAME] failed to find entry for app id: %016lx\n", app_id);
@@ -225,6 +285,7 @@ bool Device::Mount() {
 
     if (!m_keys_init) {
         keys::parse_keys(m_keys, true);
+        m_keys_init = true;
     }
 
     if (m_entries.empty()) {
@@ -243,11 +304,13 @@ bool Device::Mount() {
                 break;
             }
 
+            title::UpdateRecords(std::span(record_list.data(), record_count));
             title::PushAsync(std::span(record_list.data(), record_count));
 
             for (s32 i = 0; i < record_count; i++) {
                 const auto& e = record_list[i];
-                m_entries.emplace_back(game::Entry{e.application_id, e.last_event});
+                m_entry_map.emplace(e.application_id, m_entries.size());
+                m_entries.emplace_back(game::Entry{e.application_id, e.last_event, e.last_updated});
             }
 
             offset += record_count;
@@ -256,11 +319,91 @@ bool Device::Mount() {
 
     log_write("[GAME] mounted with %zu entries\n", m_entries.size());
     m_mounted = true;
+
+    // m_entries isn't resized after this point, so the thread can keep indexes into it.
+    if (!m_index_running && !m_entries.empty()) {
+        if (R_SUCCEEDED(utils::CreateThread(&m_index_thread, IndexThreadFunc, this, utils::ThreadRole::Background))) {
+            if (R_SUCCEEDED(threadStart(&m_index_thread))) {
+                m_index_running = true;
+            } else {
+                threadClose(&m_index_thread);
+            }
+        }
+    }
+
     return true;
 }
 
+void Device::IndexThreadFunc(void* arg) {
+    static_cast<Device*>(arg)->IndexEntries();
+}
+
+void Device::IndexEntries() {
+    const auto start = armGetSystemTick();
+
+    for (u32 i = 0; i < m_entries.size() && !m_index_exit; i++) {
+        // build into a local entry so that the lock isn't held during the ipc.
+        Entry local{};
+        {
+            SCOPED_MUTEX(&m_mutex);
+            if (m_entries[i].indexed) {
+                continue;
+            }
+            local.app_id = m_entries[i].app_id;
+        }
+
+        LoadName(local);
+        if (R_FAILED(LoadMetaEntries(local))) {
+            log_write("[GAME] index: failed to load meta entries for app id: %016lx\n", local.app_id);
+        }
+
+        for (auto& content : local.contents) {
+            if (m_index_exit) {
+                return;
+            }
+
+            if (R_FAILED(BuildNsp(local, content))) {
+                log_write("[GAME] index: failed to build nsp for content id: %016lx\n", content.status.application_id);
+            }
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        auto& entry = m_entries[i];
+
+        if (entry.status == title::NacpLoadStatus::None) {
+            entry.lang = local.lang;
+            entry.status = local.status;
+            entry.name = std::move(local.name);
+        }
+
+        if (entry.contents.empty()) {
+            entry.contents = std::move(local.contents);
+        } else {
+            // some of the entry was built on demand whilst we were indexing.
+            // keep what's there as open files may point to it, and fill in the rest.
+            for (auto& content : entry.contents) {
+                if (content.nsp) {
+                    continue;
+                }
+
+                for (auto& built : local.contents) {
+                    if (built.status.application_id == content.status.application_id) {
+                        content.nsp = std::move(built.nsp);
+                        break;
+                    }
+                }
+            }
+        }
+
+        entry.indexed = true;
+    }
+
+    log_write("[GAME] indexed %zu entries in %.2fs\n", m_entries.size(), armTicksToNs(armGetSystemTick() - start) / 1e9);
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
+    SCOPED_MUTEX(&m_mutex);
 
     u64 app_id{}, id{};
     ParseIds(path, app_id, id);
@@ -338,6 +481,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 
 int Device::devoptab_diropen(void* fd, const char *path) {
     auto dir = static_cast<Dir*>(fd);
+    SCOPED_MUTEX(&m_mutex);
 
     if (!std::strcmp(path, "/")) {
         return 0;
@@ -370,6 +514,7 @@ int Device::devoptab_dirreset(void* fd) {
 
 int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
     auto dir = static_cast<Dir*>(fd);
+    SCOPED_MUTEX(&m_mutex);
 
     if (!dir->entry) {
         if (dir->index >= m_entries.size()) {
@@ -378,26 +523,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
         }
 
         auto& entry = m_entries[dir->index];
-        if (entry.status == title::NacpLoadStatus::None) {
-            // this will never be null as it blocks until a valid entry is loaded.
-            auto result = title::Get(entry.app_id);
-            entry.lang = result->lang;
-            entry.status = result->status;
-
-            char name[NAME_MAX]{};
-            if (result->status == title::NacpLoadStatus::Loaded) {
-                fs::FsPath name_buf = result->lang.name;
-                title::utilsReplaceIllegalCharacters(name_buf, true);
-
-                const int name_max = sizeof(name) - 33;
-                std::snprintf(name, sizeof(name), "%.*s [%016lX]", name_max, name_buf.s, entry.app_id);
-            } else {
-                std::snprintf(name, sizeof(name), "[%016lX]", entry.app_id);
-                log_write("[GAME] failed to get title info for %s\n", name);
-            }
-
-            entry.name = name;
-        }
+        LoadName(entry);
 
         filestat->st_nlink = 1;
         filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
@@ -440,6 +566,7 @@ int Device::devoptab_dirclose(void* fd) {
 
 int Device::devoptab_lstat(const char *path, struct stat *st) {
     st->st_nlink = 1;
+    SCOPED_MUTEX(&m_mutex);
 
     if (!std::strcmp(path, "/")) {
         st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
@@ -1,5 +1,5 @@
 #include "utils/devoptab_common.hpp"
-#include "utils/profile.hpp"
+#include "utils/buffer_pool.hpp"
 
 #include "location.hpp"
 #include "log.hpp"
@@ -14,34 +14,94 @@
 #include <memory>
 #include <cstring>
 #include <optional>
+#include <deque>
+#include <algorithm>
+#include <string_view>
+#include <strings.h>
 #include <sys/stat.h>
 
 namespace sphaira::devoptab {
 namespace {
 
+// files are fetched in chunks of this size when the server supports ranges.
+constexpr size_t RANGE_CHUNK_SIZE = 1024 * 1024;
+// default / max number of range requests kept in flight per file.
+// can be set with range_connections in the mount ini, 0 disables ranges.
+constexpr u32 DEFAULT_RANGE_CONNECTIONS = 4;
+constexpr u32 MAX_RANGE_CONNECTIONS = 8;
+
 struct DirEntry {
-    // deprecated because the names can be truncated and really set to anything.
-    std::string name_deprecated{};
     // url decoded href.
     std::string href{};
     bool is_dir{};
 };
 using DirEntries = std::vector<DirEntry>;
 
+// extracts the links from an autoindex page as it's downloaded, so the page
+// is never held in memory and the first entries can be returned before the
+// rest of the page has arrived.
+struct ListingParser {
+    void Feed(std::string_view data, DirEntries& out);
+
+private:
+    // text that couldn't be parsed yet, ie, half of an anchor.
+    std::string m_pending{};
+    // reused for decoding each link.
+    std::string m_href{};
+    std::string m_name{};
+    bool m_in_body{};
+    bool m_done{};
+};
+
+// a listing being downloaded, the transfer is driven from diropen / dirnext.
+struct DirListing {
+    CURLM* multi{};
+    CURL* curl{};
+    ListingParser parser{};
+    DirEntries entries{};
+    // set once the transfer has finished.
+    bool done{};
+    // set if the transfer failed, as a negative errno.
+    int error{};
+};
+
 struct FileEntry {
     std::string path{};
     struct stat st{};
+    // set if the server sent "Accept-Ranges: bytes".
+    bool accept_ranges{};
+};
+
+struct RangeChunk {
+    CURL* curl{};
+    utils::pool::Vector<u8> data{};
+    u64 off{};
+    u64 size{};
+    bool done{};
+    bool failed{};
+    // set if the server replied with the whole file, rather than the range.
+    bool unsupported{};
+};
+
+// queue of in order range requests, driven by a multi handle.
+struct RangeReader {
+    CURLM* multi{};
+    std::deque<std::unique_ptr<RangeChunk>> chunks{};
+    // offset of the next chunk to request.
+    u64 next_off{};
 };
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
+    RangeReader* range_reader;
     size_t off;
     size_t last_off;
 };
 
 struct Dir {
-    DirEntries* entries;
+    DirListing* listing;
     size_t index;
 };
 
@@ -61,36 +121,31 @@ private:
     int devoptab_dirclose(void* fd) override;
     int devoptab_lstat(const char *path, struct stat *st) override;
 
-    int http_dirlist(const std::string& path, DirEntries& out);
-    int http_stat(const std::string& path, struct stat* st, bool is_dir);
+    static size_t dirlist_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+    int dirlist_start(const std::string& path, DirListing* listing);
+    int dirlist_poll(DirListing* listing);
+    void dirlist_close(DirListing* listing);
+    int http_stat(const std::string& path, struct stat* st, bool is_dir, bool* accept_ranges = nullptr);
+
+    static size_t range_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
+    bool range_start_chunk(File* file);
+    void range_stop_chunk(RangeReader* reader, RangeChunk* chunk);
+    void range_reset(RangeReader* reader, u64 off);
+    void range_close(File* file);
+    int range_poll(RangeReader* reader);
+    ssize_t range_read(File* file, char *ptr, size_t len);
 
 private:
+    u32 range_connections{DEFAULT_RANGE_CONNECTIONS};
     bool mounted{};
 };
 
-int Device::http_dirlist(const std::string& path, DirEntries& out) {
-    const auto url = build_url(path, true);
-    std::vector<char> chunk;
-
-    log_write("[HTTP] Listing URL: %s path: %s\n", url.c_str(), path.c_str());
-
-    curl_set_common_options(this->curl, url);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-    curl_easy_setopt(this->curl, CURLOPT_WRITEDATA, (void *)&chunk);
-
-    const auto res = curl_easy_perform(this->curl);
-    if (res != CURLE_OK) {
-        log_write("[HTTP] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        return -EIO;
-    }
-
-    long response_code = 0;
-    curl_easy_getinfo(this->curl, CURLINFO_RESPONSE_CODE, &response_code);
-
+// returns 0 if the response code is a success.
+int response_code_to_errno(long response_code) {
     switch (response_code) {
         case 200: // OK
         case 206: // Partial Content
-            break;
+            return 0;
         case 301: // Moved Permanently
         case 302: // Found
         case 303: // See Other
@@ -105,97 +160,272 @@ int Device::http_dirlist(const std::string& path, DirEntries& out) {
         default:
             return -EIO;
     }
+}
 
-    log_write("[HTTP] Received %zu bytes for directory listing\n", chunk.size());
+auto hex_value(char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
 
-    SCOPED_TIMESTAMP("http_dirlist parse");
+// url and html decodes str into out in a single pass.
+// out is reused between calls, so this doesn't allocate once it's grown.
+void decode_link(std::string_view str, std::string& out) {
+    struct Entry {
+        std::string_view key;
+        char value;
+    };
+
+    // same as MountCurlDevice::html_decode().
+    static constexpr Entry map[]{
+        { "&amp;", '&' },
+        { "&lt;", '<' },
+        { "&gt;", '>' },
+        { "&quot;", '"' },
+        { "&apos;", '\'' },
+        { "&nbsp;", ' ' },
+        { "&#38;", '&' },
+        { "&#60;", '<' },
+        { "&#62;", '>' },
+        { "&#34;", '"' },
+        { "&#39;", '\'' },
+        { "&#160;", ' ' },
+        { "&#35;", '#' },
+        { "&#37;", '%' },
+        { "&#43;", '+' },
+        { "&#61;", '=' },
+        { "&#64;", '@' },
+        { "&#91;", '[' },
+        { "&#93;", ']' },
+        { "&#123;", '{' },
+        { "&#125;", '}' },
+        { "&#126;", '~' },
+    };
+
+    out.clear();
+
+    for (size_t i = 0; i < str.size(); i++) {
+        const auto c = str[i];
+
+        if (c == '%' && i + 2 < str.size() && hex_value(str[i + 1]) >= 0 && hex_value(str[i + 2]) >= 0) {
+            out += (char)(hex_value(str[i + 1]) << 4 | hex_value(str[i + 2]));
+            i += 2;
+        } else if (c == '&') {
+            const auto it = std::ranges::find_if(map, [&](const auto& e) {
+                return str.substr(i).starts_with(e.key);
+            });
+
+            if (it != std::end(map)) {
+                out += it->value;
+                i += it->key.length() - 1;
+            } else {
+                out += c;
+            }
+        } else {
+            out += c;
+        }
+    }
+}
+
+// very fast/basic html parsing, only the anchors inside of the body are read.
+// todo: if i ever add an xml parser to sphaira, use that instead.
+void ListingParser::Feed(std::string_view data, DirEntries& out) {
+    static constexpr std::string_view body_tag_start = "<body";
+    static constexpr std::string_view body_tag_end = "</body>";
+    static constexpr std::string_view href_tag_start = "<a href=\"";
+    static constexpr std::string_view href_tag_end = "\">";
+    static constexpr std::string_view anchor_tag_end = "</a>";
+    // enough to find a tag that was split between two reads.
+    static constexpr auto tag_keep = std::max(href_tag_start.length(), body_tag_end.length()) - 1;
+
+    if (m_done) {
+        return;
+    }
 
-    // very fast/basic html parsing.
-    // takes 17ms to parse 3MB html with 7641 entries.
-    // todo: if i ever add an xml parser to sphaira, use that instead.
-    // todo: for the above, benchmark the parser to ensure its faster than the my code.
-    std::string_view chunk_view{chunk.data(), chunk.size()};
+    m_pending.append(data);
+    std::string_view view{m_pending};
+    size_t pos = 0;
+
+    // the page isn't valid html without a body, so nothing is listed.
+    if (!m_in_body) {
+        const auto body_pos = view.find(body_tag_start);
+        if (body_pos == std::string_view::npos) {
+            // keep enough for the tag to be found once the rest arrives.
+            m_pending.erase(0, m_pending.size() - std::min(m_pending.size(), body_tag_start.length() - 1));
+            return;
+        }
+
+        m_in_body = true;
+        pos = body_pos + body_tag_start.length();
+    }
 
-    const auto body_start = chunk_view.find("<body");
-    const auto body_end = chunk_view.rfind("</body>");
-    const auto table_start = chunk_view.find("<table");
-    const auto table_end = chunk_view.rfind("</table>");
+    for (;;) {
+        const auto href_pos = view.find(href_tag_start, pos);
+        const auto body_end = view.find(body_tag_end, pos);
+
+        if (body_end != std::string_view::npos && (href_pos == std::string_view::npos || body_end < href_pos)) {
+            m_done = true;
+            m_pending.clear();
+            return;
+        }
+
+        if (href_pos == std::string_view::npos) {
+            pos = std::max(pos, view.size() - std::min(view.size(), tag_keep));
+            break;
+        }
+
+        const auto href_begin = href_pos + href_tag_start.length();
+        const auto href_end = view.find(href_tag_end, href_begin);
+        const auto name_begin = href_end + href_tag_end.length();
+        const auto name_end = href_end == std::string_view::npos ? href_end : view.find(anchor_tag_end, name_begin);
+
+        // the rest of the anchor hasn't arrived yet.
+        if (name_end == std::string_view::npos) {
+            pos = href_pos;
+            break;
+        }
+
+        pos = name_end + anchor_tag_end.length();
+
+        const auto href_name_end = view.find('"', href_begin);
+        if (href_name_end > href_end) {
+            continue; // invalid href.
+        }
 
-    std::string_view table_view{};
+        decode_link(view.substr(href_begin, href_name_end - href_begin), m_href);
+        decode_link(view.substr(name_begin, name_end - name_begin), m_name);
 
-    // try and find the body, if this doesn't exist, fallback it's not a valid html page.
-    if (body_start != std::string_view::npos && body_end != std::string_view::npos && body_end > body_start) {
-        table_view = chunk_view.substr(body_start, body_end - body_start);
+        // skip empty names/links, root dir entry and links that are not actual files/dirs (e.g. sorting/filter controls).
+        if (m_name.empty() || m_href.empty() || m_name == "/" || m_href.starts_with('?') || m_href.starts_with('#')) {
+            continue;
+        }
+
+        // skip parent directory entry, external links and absolute links.
+        // the page is no longer limited to the table, so absolute links are
+        // skipped as that's how nav bars / breadcrumbs link to other dirs.
+        if (m_href == ".." || m_name == ".." || m_href.starts_with("../") || m_name.starts_with("../") || m_href.starts_with('/') || m_href.find("://") != std::string::npos) {
+            continue;
+        }
+
+        const auto is_dir = m_href.ends_with('/');
+        if (is_dir) {
+            m_href.pop_back(); // remove the trailing '/'
+        }
+
+        out.emplace_back(m_href, is_dir);
     }
 
-    // try and find the table, massively speeds up parsing if it exists.
-    // todo: this may cause issues with some web servers that don't use a table for listings.
-    // todo: if table fails to fine anything, fallback to body_view.
-    if (table_start != std::string_view::npos && table_end != std::string_view::npos && table_end > table_start) {
-        table_view = chunk_view.substr(table_start, table_end - table_start);
+    m_pending.erase(0, pos);
+}
+
+size_t Device::dirlist_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto listing = static_cast<DirListing*>(userdata);
+    const auto realsize = size * nmemb;
+
+    // don't parse error pages.
+    long response_code = 0;
+    curl_easy_getinfo(listing->curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (const auto ret = response_code_to_errno(response_code)) {
+        listing->error = ret;
+        return 0;
     }
 
-    if (!table_view.empty()) {
-        const std::string_view href_tag_start = "<a href=\"";
-        const std::string_view href_tag_end = "\">";
-        const std::string_view anchor_tag_end = "</a>";
+    listing->parser.Feed({ptr, realsize}, listing->entries);
+    return realsize;
+}
 
-        size_t pos = 0;
-        out.reserve(10000);
+int Device::dirlist_start(const std::string& path, DirListing* listing) {
+    const auto url = build_url(path, true);
+    log_write("[HTTP] Listing URL: %s path: %s\n", url.c_str(), path.c_str());
 
-        for (;;) {
-            const auto href_pos = table_view.find(href_tag_start, pos);
-            if (href_pos == std::string_view::npos) {
-                break; // no more href.
-            }
-            pos = href_pos + href_tag_start.length();
+    listing->multi = curl_multi_init();
+    if (!listing->multi) {
+        log_write("[HTTP] curl_multi_init() failed\n");
+        return -EIO;
+    }
 
-            const auto href_begin = pos;
-            const auto href_end = table_view.find(href_tag_end, href_begin);
-            if (href_end == std::string_view::npos) {
-                break; // no more href.
-            }
+    listing->curl = acquire_handle();
+    if (!listing->curl) {
+        return -EIO;
+    }
 
-            const auto href_name_end = table_view.find('"', href_begin);
-            if (href_name_end == std::string_view::npos || href_name_end < href_begin || href_name_end > href_end) {
-                break; // invalid href.
-            }
+    curl_set_common_options(listing->curl, url);
+    curl_easy_setopt(listing->curl, CURLOPT_WRITEFUNCTION, dirlist_write_callback);
+    curl_easy_setopt(listing->curl, CURLOPT_WRITEDATA, (void *)listing);
 
-            const auto name_begin = href_end + href_tag_end.length();
-            const auto name_end = table_view.find(anchor_tag_end, name_begin);
-            if (name_end == std::string_view::npos) {
-                break; // no more names.
-            }
+    const auto res = curl_multi_add_handle(listing->multi, listing->curl);
+    if (res != CURLM_OK) {
+        log_write("[HTTP] curl_multi_add_handle() failed: %s\n", curl_multi_strerror(res));
+        return -EIO;
+    }
+
+    return 0;
+}
 
-            pos = name_end + anchor_tag_end.length();
-            auto href = url_decode(std::string{table_view.substr(href_begin, href_name_end - href_begin)});
-            auto name = url_decode(std::string{table_view.substr(name_begin, name_end - name_begin)});
+// pumps the transfer until more entries have been parsed or it finishes.
+int Device::dirlist_poll(DirListing* listing) {
+    const auto count = listing->entries.size();
 
-            // skip empty names/links, root dir entry and links that are not actual files/dirs (e.g. sorting/filter controls).
-            if (name.empty() || href.empty() || name == "/" || href.starts_with('?') || href.starts_with('#')) {
+    while (!listing->done && listing->entries.size() == count) {
+        int running{};
+        auto res = curl_multi_perform(listing->multi, &running);
+        if (res != CURLM_OK) {
+            log_write("[HTTP] curl_multi_perform() failed: %s\n", curl_multi_strerror(res));
+            return -EIO;
+        }
+
+        int msgs_left{};
+        while (auto msg = curl_multi_info_read(listing->multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE) {
                 continue;
             }
 
-            // skip parent directory entry and external links.
-            if (href == ".." || name == ".." || href.starts_with("../") || name.starts_with("../") || href.find("://") != std::string::npos) {
-                continue;
+            listing->done = true;
+
+            long response_code = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+
+            if (!listing->error) {
+                listing->error = response_code_to_errno(response_code);
             }
 
-            const auto is_dir = href.ends_with('/');
-            if (is_dir) {
-                href.pop_back(); // remove the trailing '/'
+            if (!listing->error && msg->data.result != CURLE_OK) {
+                log_write("[HTTP] listing failed: %s\n", curl_easy_strerror(msg->data.result));
+                listing->error = -EIO;
             }
 
-            out.emplace_back(name, href, is_dir);
+            log_write("[HTTP] Parsed %zu entries from directory listing\n", listing->entries.size());
+        }
+
+        if (!listing->done && listing->entries.size() == count) {
+            res = curl_multi_poll(listing->multi, nullptr, 0, 100, nullptr);
+            if (res != CURLM_OK) {
+                log_write("[HTTP] curl_multi_poll() failed: %s\n", curl_multi_strerror(res));
+                return -EIO;
+            }
         }
     }
 
-    log_write("[HTTP] Parsed %zu entries from directory listing\n", out.size());
+    return listing->error;
+}
 
-    return 0;
+void Device::dirlist_close(DirListing* listing) {
+    if (listing->curl) {
+        if (listing->multi) {
+            curl_multi_remove_handle(listing->multi, listing->curl);
+        }
+        release_handle(listing->curl);
+    }
+
+    if (listing->multi) {
+        curl_multi_cleanup(listing->multi);
+    }
+
+    delete listing;
 }
 
-int Device::http_stat(const std::string& path, struct stat* st, bool is_dir) {
+int Device::http_stat(const std::string& path, struct stat* st, bool is_dir, bool* accept_ranges) {
     std::memset(st, 0, sizeof(*st));
     const auto url = build_url(path, is_dir);
 
@@ -224,23 +454,13 @@ int Device::http_stat(const std::string& path, struct stat* st, bool is_dir) {
     const char* effective_url{};
     curl_easy_getinfo(this->curl, CURLINFO_EFFECTIVE_URL, &effective_url);
 
-    switch (response_code) {
-        case 200: // OK
-        case 206: // Partial Content
-            break;
-        case 301: // Moved Permanently
-        case 302: // Found
-        case 303: // See Other
-        case 307: // Temporary Redirect
-        case 308: // Permanent Redirect
-            return -EIO;
-        case 401: // Unauthorized
-        case 403: // Forbidden
-            return -EACCES;
-        case 404: // Not Found
-            return -ENOENT;
-        default:
-            return -EIO;
+    if (accept_ranges) {
+        curl_header* header{};
+        *accept_ranges = curl_easy_header(this->curl, "Accept-Ranges", 0, CURLH_HEADER, -1, &header) == CURLHE_OK && !strcasecmp(header->value, "bytes");
+    }
+
+    if (const auto ret = response_code_to_errno(response_code)) {
+        return ret;
     }
 
     if (effective_url) {
@@ -277,8 +497,16 @@ bool Device::Mount() {
         return false;
     }
 
-    // todo: query server with OPTIONS to see if it supports range requests.
-    // todo: see ftp for example.
+    // range support is checked per file in open, as it can differ per path.
+    const auto range_connections = this->config.extra.find("range_connections");
+    if (range_connections != this->config.extra.end()) {
+        const auto range_connections_val = ini_parse_getl(range_connections->second.c_str(), -1);
+        if (range_connections_val < 0) {
+            log_write("[HTTP] Invalid range_connections value: %s\n", range_connections->second.c_str());
+        } else {
+            this->range_connections = std::min<u32>(range_connections_val, MAX_RANGE_CONNECTIONS);
+        }
+    }
 
     return mounted = true;
 }
@@ -287,7 +515,8 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
     auto file = static_cast<File*>(fileStruct);
 
     struct stat st;
-    const auto ret = http_stat(path, &st, false);
+    bool accept_ranges{};
+    const auto ret = http_stat(path, &st, false, &accept_ranges);
     if (ret < 0) {
         log_write("[HTTP] http_stat() failed for file: %s errno: %s\n", path, std::strerror(-ret));
         return ret;
@@ -298,18 +527,206 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
         return -EISDIR;
     }
 
-    file->entry = new FileEntry{path, st};
+    // small files fit in a single chunk, so there's nothing to gain.
+    accept_ranges &= this->range_connections && st.st_size > (off_t)RANGE_CHUNK_SIZE;
+
+    file->curl = acquire_handle();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
+    file->entry = new FileEntry{path, st, accept_ranges};
     return 0;
 }
 
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
+    range_close(file);
+    // stops the transfer before the handle is reused.
     delete file->push_pull_thread_data;
+    release_handle(file->curl);
     delete file->entry;
     return 0;
 }
 
+size_t Device::range_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto chunk = static_cast<RangeChunk*>(userdata);
+    const auto realsize = size * nmemb;
+
+    // the server ignored the range and is sending the whole file.
+    if (chunk->data.size() + realsize > chunk->size) {
+        chunk->unsupported = true;
+        return 0;
+    }
+
+    chunk->data.insert(chunk->data.end(), ptr, ptr + realsize);
+    return realsize;
+}
+
+bool Device::range_start_chunk(File* file) {
+    auto reader = file->range_reader;
+
+    auto chunk = std::make_unique<RangeChunk>();
+    chunk->off = reader->next_off;
+    chunk->size = std::min<u64>(RANGE_CHUNK_SIZE, file->entry->st.st_size - chunk->off);
+    chunk->data.reserve(chunk->size);
+
+    chunk->curl = acquire_handle();
+    if (!chunk->curl) {
+        return false;
+    }
+
+    char range[64];
+    std::snprintf(range, sizeof(range), "%llu-%llu", (unsigned long long)chunk->off, (unsigned long long)(chunk->off + chunk->size - 1));
+
+    curl_set_common_options(chunk->curl, build_url(file->entry->path, false));
+    curl_easy_setopt(chunk->curl, CURLOPT_RANGE, range);
+    curl_easy_setopt(chunk->curl, CURLOPT_WRITEFUNCTION, range_write_callback);
+    curl_easy_setopt(chunk->curl, CURLOPT_WRITEDATA, (void *)chunk.get());
+    curl_easy_setopt(chunk->curl, CURLOPT_PRIVATE, (void *)chunk.get());
+
+    const auto res = curl_multi_add_handle(reader->multi, chunk->curl);
+    if (res != CURLM_OK) {
+        log_write("[HTTP] curl_multi_add_handle() failed: %s\n", curl_multi_strerror(res));
+        release_handle(chunk->curl);
+        return false;
+    }
+
+    reader->next_off += chunk->size;
+    reader->chunks.emplace_back(std::move(chunk));
+    return true;
+}
+
+void Device::range_stop_chunk(RangeReader* reader, RangeChunk* chunk) {
+    curl_multi_remove_handle(reader->multi, chunk->curl);
+    release_handle(chunk->curl);
+}
+
+void Device::range_reset(RangeReader* reader, u64 off) {
+    for (auto& chunk : reader->chunks) {
+        range_stop_chunk(reader, chunk.get());
+    }
+
+    reader->chunks.clear();
+    reader->next_off = off;
+}
+
+void Device::range_close(File* file) {
+    if (auto reader = file->range_reader) {
+        range_reset(reader, 0);
+        curl_multi_cleanup(reader->multi);
+        delete reader;
+        file->range_reader = nullptr;
+    }
+}
+
+int Device::range_poll(RangeReader* reader) {
+    int running{};
+    auto res = curl_multi_perform(reader->multi, &running);
+    if (res != CURLM_OK) {
+        log_write("[HTTP] curl_multi_perform() failed: %s\n", curl_multi_strerror(res));
+        return -EIO;
+    }
+
+    bool any_done{};
+    int msgs_left{};
+    while (auto msg = curl_multi_info_read(reader->multi, &msgs_left)) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        RangeChunk* chunk{};
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&chunk);
+
+        long response_code = 0;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+
+        chunk->done = true;
+        chunk->unsupported |= response_code == 200;
+        chunk->failed = msg->data.result != CURLE_OK || response_code != 206 || chunk->data.size() != chunk->size;
+        if (chunk->failed) {
+            log_write("[HTTP] range request failed: %s code: %ld size: %zu\n", curl_easy_strerror(msg->data.result), response_code, chunk->data.size());
+        }
+
+        any_done = true;
+    }
+
+    if (!any_done) {
+        res = curl_multi_poll(reader->multi, nullptr, 0, 100, nullptr);
+        if (res != CURLM_OK) {
+            log_write("[HTTP] curl_multi_poll() failed: %s\n", curl_multi_strerror(res));
+            return -EIO;
+        }
+    }
+
+    return 0;
+}
+
+// keeps up to range_connections chunks in flight ahead of the read offset.
+// returns -EOPNOTSUPP if the server does not actually support ranges.
+ssize_t Device::range_read(File* file, char *ptr, size_t len) {
+    if (!file->range_reader) {
+        auto multi = curl_multi_init();
+        if (!multi) {
+            log_write("[HTTP] curl_multi_init() failed\n");
+            return -EIO;
+        }
+
+        file->range_reader = new RangeReader{multi};
+        file->range_reader->next_off = file->off;
+    }
+
+    auto reader = file->range_reader;
+
+    // seeking outside of the queued chunks restarts the ranges at the new offset.
+    if (file->off >= reader->next_off || (!reader->chunks.empty() && file->off < reader->chunks.front()->off)) {
+        if (!reader->chunks.empty()) {
+            log_write("[HTTP] Range offset changed to %zu, restarting ranges\n", file->off);
+        }
+        range_reset(reader, file->off);
+    }
+
+    size_t bytes_read = 0;
+    while (bytes_read < len) {
+        const auto off = file->off + bytes_read;
+
+        // drop chunks that have been skipped over.
+        while (!reader->chunks.empty() && reader->chunks.front()->off + reader->chunks.front()->size <= off) {
+            range_stop_chunk(reader, reader->chunks.front().get());
+            reader->chunks.pop_front();
+        }
+
+        while (reader->chunks.size() < this->range_connections && reader->next_off < (u64)file->entry->st.st_size) {
+            if (!range_start_chunk(file)) {
+                return bytes_read ? (ssize_t)bytes_read : -EIO;
+            }
+        }
+
+        auto& chunk = reader->chunks.front();
+        if (!chunk->done) {
+            if (const auto ret = range_poll(reader); ret < 0) {
+                return bytes_read ? (ssize_t)bytes_read : ret;
+            }
+            continue;
+        }
+
+        if (chunk->failed) {
+            if (chunk->unsupported && !bytes_read) {
+                return -EOPNOTSUPP;
+            }
+            return bytes_read ? (ssize_t)bytes_read : -EIO;
+        }
+
+        const auto chunk_off = off - chunk->off;
+        const auto size = std::min<size_t>(len - bytes_read, chunk->size - chunk_off);
+        std::memcpy(ptr + bytes_read, chunk->data.data() + chunk_off, size);
+        bytes_read += size;
+    }
+
+    return bytes_read;
+}
+
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
     len = std::min(len, file->entry->st.st_size - file->off);
@@ -318,6 +735,21 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
         return 0;
     }
 
+    if (file->entry->accept_ranges) {
+        const auto ret = range_read(file, ptr, len);
+        if (ret != -EOPNOTSUPP) {
+            if (ret > 0) {
+                file->off += ret;
+                file->last_off = file->off;
+            }
+            return ret;
+        }
+
+        log_write("[HTTP] Server ignored range request, falling back to streaming: %s\n", file->entry->path.c_str());
+        file->entry->accept_ranges = false;
+        range_close(file);
+    }
+
     if (file->off != file->last_off) {
         log_write("[HTTP] File offset changed from %zu to %zu, resetting download thread\n", file->last_off, file->off);
         file->last_off = file->off;
@@ -327,7 +759,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[HTTP] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[HTTP] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -363,17 +795,23 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 int Device::devoptab_diropen(void* fd, const char *path) {
     auto dir = static_cast<Dir*>(fd);
 
-    log_write("[HTTP] Opening directory: %s\n", path);
-    auto entries = new DirEntries();
-    const auto ret = http_dirlist(path, *entries);
+    log_debug(LogCategory_Devoptab, "[HTTP] Opening directory: %s\n", path);
+    auto listing = new DirListing();
+
+    // only wait for the first entries, the rest are read in dirnext.
+    auto ret = dirlist_start(path, listing);
+    if (!ret) {
+        ret = dirlist_poll(listing);
+    }
+
     if (ret < 0) {
-        log_write("[HTTP] http_dirlist() failed for directory: %s errno: %s\n", path, std::strerror(-ret));
-        delete entries;
+        log_write("[HTTP] dirlist failed for directory: %s errno: %s\n", path, std::strerror(-ret));
+        dirlist_close(listing);
         return ret;
     }
 
-    log_write("[HTTP] Opened directory: %s with %zu entries\n", path, entries->size());
-    dir->entries = entries;
+    log_write("[HTTP] Opened directory: %s with %zu entries so far\n", path, listing->entries.size());
+    dir->listing = listing;
     return 0;
 }
 
@@ -386,12 +824,19 @@ int Device::devoptab_dirreset(void* fd) {
 
 int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
     auto dir = static_cast<Dir*>(fd);
+    auto listing = dir->listing;
+
+    if (dir->index >= listing->entries.size()) {
+        if (const auto ret = dirlist_poll(listing); ret < 0) {
+            return ret;
+        }
 
-    if (dir->index >= dir->entries->size()) {
-        return -ENOENT;
+        if (dir->index >= listing->entries.size()) {
+            return -ENOENT;
+        }
     }
 
-    auto& entry = (*dir->entries)[dir->index];
+    auto& entry = listing->entries[dir->index];
     if (entry.is_dir) {
         filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
     } else {
@@ -400,7 +845,6 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
 
     // <a href="Compass_2.0.7.1-Release_ScVi3.0.1-Standalone-21-2-0-7-1-1729820977.zip">Compass_2.0.7.1-Release_ScVi3.0.1-Standalone-21..&gt;</a>
     filestat->st_nlink = 1;
-    // std::strcpy(filename, entry.name.c_str());
     std::strcpy(filename, entry.href.c_str());
 
     dir->index++;
@@ -410,7 +854,7 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
 int Device::devoptab_dirclose(void* fd) {
     auto dir = static_cast<Dir*>(fd);
 
-    delete dir->entries;
+    dirlist_close(dir->listing);
     return 0;
 }
 
@@ -328,7 +328,7 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
     return 0;
 }
 
-Result MountNcaInternal(fs::Fs* fs, const std::shared_ptr<yati::source::Base>& source, s64 size, const fs::FsPath& path, fs::FsPath& out_path) {
+Result MountNcaInternal(fs::Fs* fs, const std::shared_ptr<yati::source::Base>& source, s64 size, const FsTimeStampRaw& ts, const fs::FsPath& path, fs::FsPath& out_path) {
     // todo: rather than manually fetching tickets, use spl to
     // decrypt the nca for use (somehow, look how ams does it?).
     keys::Keys keys;
@@ -341,43 +341,46 @@ Result MountNcaInternal(fs::Fs* fs, const std::shared_ptr<yati::source::Base>& s
     std::unique_ptr<yati::source::Base> nca_reader{};
     log_write("[NCA] got header, type: %s\n", nca::GetContentTypeStr(header.content_type));
 
-    // check if this is a ncz.
-    ncz::Header ncz_header{};
-    if (size >= NCZ_NORMAL_SIZE) {
-        R_TRY(source->Read2(&ncz_header, NCZ_NORMAL_SIZE, sizeof(ncz_header)));
-    }
-
-    if (size >= NCZ_NORMAL_SIZE && ncz_header.magic == NCZ_SECTION_MAGIC) {
-        // read all the sections.
-        s64 ncz_offset = NCZ_SECTION_OFFSET;
-        ncz::Sections ncz_sections(ncz_header.total_sections);
-        R_TRY(source->Read2(ncz_sections.data(), ncz_offset, ncz_sections.size() * sizeof(ncz::Section)));
+    // check if this is a ncz, using the cached index if it's up to date.
+    ncz::Index ncz_index{};
+    bool is_ncz = !path.empty() && ncz::LoadIndexCache(path, size, ts, ncz_index);
 
-        ncz_offset += ncz_sections.size() * sizeof(ncz::Section);
-        ncz::BlockHeader ncz_block_header{};
-        R_TRY(source->Read2(&ncz_block_header, ncz_offset, sizeof(ncz_block_header)));
+    if (!is_ncz && size >= NCZ_NORMAL_SIZE) {
+        ncz::Header ncz_header{};
+        R_TRY(source->Read2(&ncz_header, NCZ_NORMAL_SIZE, sizeof(ncz_header)));
 
-        // ensure this is a block compressed nsz, otherwise bail out
-        // because random access is not supported with solid compression.
-        R_TRY(ncz_block_header.IsValid());
+        if (ncz_header.magic == NCZ_SECTION_MAGIC) {
+            R_TRY(ncz::ReadIndex(source.get(), ncz_header, ncz_index));
+            is_ncz = true;
 
-        ncz_offset += sizeof(ncz_block_header);
-        ncz::Blocks ncz_blocks(ncz_block_header.total_blocks);
-        R_TRY(source->Read2(ncz_blocks.data(), ncz_offset, ncz_blocks.size() * sizeof(ncz::Block)));
+            // solid ncz only have the section table, so aren't worth caching.
+            if (!path.empty() && !ncz_index.solid) {
+                if (R_FAILED(ncz::SaveIndexCache(path, size, ts, ncz_index))) {
+                    log_write("[NCA] failed to save ncz index cache\n");
+                }
+            }
+        }
+    }
 
-        ncz_offset += ncz_blocks.size() * sizeof(ncz::Block);
+    if (is_ncz && ncz_index.solid) {
+        log_write("[NCA] solid ncz, random reads will be slow\n");
+        nca_reader = std::make_unique<ncz::NczSolidReader>(
+            ncz_index.sections, ncz_index.block_offset, size, source
+        );
+    } else if (is_ncz) {
         nca_reader = std::make_unique<ncz::NczBlockReader>(
-            ncz_header, ncz_sections, ncz_block_header, ncz_blocks, ncz_offset, source
+            ncz_index.header, ncz_index.sections, ncz_index.block_header, ncz_index.blocks, ncz_index.block_offset, source
         );
     } else {
         keys::KeyEntry title_key;
         R_TRY(nca::GetDecryptedTitleKey(fs, path, header, keys, title_key));
 
         // create nca reader which will handle decryption for us.
-        // create a LRU buffer cache as the source in order to reduce small reads.
-        nca_reader = std::make_unique<nca::NcaReader>(
-            header, &title_key, size,
-            std::make_shared<common::LruBufferedData>(source, size)
+        // the cache sits on top of the reader so that it holds decrypted data.
+        // this means cache hits don't pay for the aes-ctr again.
+        nca_reader = std::make_unique<common::PrefetchCachedData>(
+            std::make_shared<nca::NcaReader>(header, &title_key, size, source),
+            size, "nca"
         );
     }
 
@@ -487,7 +490,11 @@ Result MountNca(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
     auto source = std::make_shared<yati::source::File>(fs, path);
     R_TRY(source->GetSize(&size));
 
-    return MountNcaInternal(fs, source, size, path, out_path);
+    // only used to check if the ncz index cache is up to date.
+    FsTimeStampRaw ts{};
+    fs->GetFileTimeStampRaw(path, &ts);
+
+    return MountNcaInternal(fs, source, size, ts, path, out_path);
 }
 
 Result MountNcaNcm(NcmContentStorage* cs, const NcmContentId* id, fs::FsPath& out_path) {
@@ -495,7 +502,7 @@ Result MountNcaNcm(NcmContentStorage* cs, const NcmContentId* id, fs::FsPath& ou
     auto source = std::make_shared<ncm::NcmSource>(cs, id);
     R_TRY(source->GetSize(&size));
 
-    return MountNcaInternal(nullptr, source, size, {}, out_path);
+    return MountNcaInternal(nullptr, source, size, {}, {}, out_path);
 }
 
 } // namespace sphaira::devoptab
@@ -4,15 +4,27 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <cstring>
 #include <string>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 #include <libnfs.h>
 #include <minIni.h>
 
 namespace sphaira::devoptab {
 namespace {
 
+// default / max number of read / write requests kept in flight.
+constexpr u32 DEFAULT_QUEUE_DEPTH = 4;
+constexpr u32 MAX_QUEUE_DEPTH = 16;
+// io is split into at least this size, so that small io is not turned into
+// lots of tiny requests.
+constexpr size_t MIN_IO_CHUNK = 1024 * 64;
+// matches the timeout used by the libnfs sync api.
+constexpr int POLL_TIMEOUT_MS = 1000;
+
 struct Device final : common::MountDevice {
     using MountDevice::MountDevice;
     ~Device();
@@ -39,11 +51,32 @@ private:
     int devoptab_fsync(void *fd) override;
     int devoptab_utimes(const char *path, const struct timeval times[2]) override;
 
+private:
+    ssize_t io_pipelined(nfsfh* fd, u64 offset, u8* ptr, size_t len, bool is_write);
+    ssize_t io(nfsfh* fd, u8* ptr, size_t len, bool is_write);
+
 private:
     nfs_context* nfs{};
+    u32 queue_depth{DEFAULT_QUEUE_DEPTH};
     bool mounted{};
 };
 
+// a single async read / write request, owned by io_pipelined().
+struct IoRequest {
+    size_t offset;
+    size_t size;
+    int status;
+    bool done;
+    // set once the reply has been accounted for.
+    bool handled;
+};
+
+void io_cb(int status, nfs_context* nfs, void* data, void* private_data) {
+    auto req = static_cast<IoRequest*>(private_data);
+    req->status = status;
+    req->done = true;
+}
+
 struct File {
     nfsfh* fd;
 };
@@ -136,10 +169,157 @@ bool Device::Mount() {
         return false;
     }
 
-    log_write("[NFS] Mounted %s\n", this->config.url.c_str());
+    // the server reports its max sizes on mount, these can only be lowered.
+    const auto readmax = this->config.extra.find("readmax");
+    if (readmax != this->config.extra.end()) {
+        const auto readmax_val = ini_parse_getl(readmax->second.c_str(), -1);
+        if (readmax_val <= 0) {
+            log_write("[NFS] Invalid readmax value: %s\n", readmax->second.c_str());
+        } else {
+            nfs_set_readmax(nfs, std::min<size_t>(readmax_val, nfs_get_readmax(nfs)));
+        }
+    }
+
+    const auto writemax = this->config.extra.find("writemax");
+    if (writemax != this->config.extra.end()) {
+        const auto writemax_val = ini_parse_getl(writemax->second.c_str(), -1);
+        if (writemax_val <= 0) {
+            log_write("[NFS] Invalid writemax value: %s\n", writemax->second.c_str());
+        } else {
+            nfs_set_writemax(nfs, std::min<size_t>(writemax_val, nfs_get_writemax(nfs)));
+        }
+    }
+
+    const auto queue_depth = this->config.extra.find("queue_depth");
+    if (queue_depth != this->config.extra.end()) {
+        const auto queue_depth_val = ini_parse_getl(queue_depth->second.c_str(), -1);
+        if (queue_depth_val <= 0) {
+            log_write("[NFS] Invalid queue_depth value: %s\n", queue_depth->second.c_str());
+        } else {
+            this->queue_depth = std::min<u32>(queue_depth_val, MAX_QUEUE_DEPTH);
+        }
+    }
+
+    log_write("[NFS] Mounted %s readmax: %zu writemax: %zu queue_depth: %u\n", this->config.url.c_str(), (size_t)nfs_get_readmax(nfs), (size_t)nfs_get_writemax(nfs), this->queue_depth);
     return mounted = true;
 }
 
+// keeps up to queue_depth requests in flight, rather than waiting for each
+// reply before sending the next request.
+// returns the number of contiguous bytes transferred from the start of ptr.
+ssize_t Device::io_pipelined(nfsfh* fd, u64 offset, u8* ptr, size_t len, bool is_write) {
+    const size_t max_size = is_write ? nfs_get_writemax(nfs) : nfs_get_readmax(nfs);
+    const auto chunk_size = std::clamp<size_t>(len / this->queue_depth, std::min(MIN_IO_CHUNK, max_size), max_size);
+    const auto count = (len + chunk_size - 1) / chunk_size;
+
+    std::vector<IoRequest> requests(count);
+    size_t next{};
+    size_t pending{};
+    bool eof{};
+    int error{};
+
+    for (;;) {
+        // top up the queue, unless a previous request was short / failed.
+        while (!eof && !error && next < count && pending < this->queue_depth) {
+            auto& req = requests[next];
+            req.offset = next * chunk_size;
+            req.size = std::min<size_t>(len - req.offset, chunk_size);
+
+            int ret;
+            if (is_write) {
+                ret = nfs_pwrite_async(nfs, fd, ptr + req.offset, req.size, offset + req.offset, io_cb, &req);
+            } else {
+                ret = nfs_pread_async(nfs, fd, ptr + req.offset, req.size, offset + req.offset, io_cb, &req);
+            }
+
+            if (ret < 0) {
+                log_write("[NFS] nfs_p%s_async() failed: %s errno: %s\n", is_write ? "write" : "read", nfs_get_error(nfs), std::strerror(-ret));
+                error = ret;
+                break;
+            }
+
+            next++;
+            pending++;
+        }
+
+        if (!pending) {
+            break;
+        }
+
+        pollfd pfd{};
+        pfd.fd = nfs_get_fd(nfs);
+        pfd.events = nfs_which_events(nfs);
+
+        if (poll(&pfd, 1, POLL_TIMEOUT_MS) < 0) {
+            log_write("[NFS] poll() failed: %s\n", std::strerror(errno));
+            return -EIO;
+        }
+
+        if (nfs_service(nfs, pfd.revents) < 0) {
+            log_write("[NFS] nfs_service() failed: %s\n", nfs_get_error(nfs));
+            return -EIO;
+        }
+
+        for (size_t i = 0; i < next; i++) {
+            auto& req = requests[i];
+            if (!req.done || req.handled) {
+                continue;
+            }
+
+            req.handled = true;
+            if (req.status < 0) {
+                log_write("[NFS] nfs_p%s_async() reply failed: %s errno: %s\n", is_write ? "write" : "read", nfs_get_error(nfs), std::strerror(-req.status));
+                error = req.status;
+            } else if (static_cast<size_t>(req.status) < req.size) {
+                eof = true;
+            }
+
+            pending--;
+        }
+    }
+
+    // sum up the contiguous data, stopping at the first short request.
+    size_t transferred{};
+    for (size_t i = 0; i < next; i++) {
+        const auto& req = requests[i];
+        if (!req.done || req.status < 0) {
+            break;
+        }
+
+        transferred += req.status;
+        if (static_cast<size_t>(req.status) < req.size) {
+            break;
+        }
+    }
+
+    if (!transferred && error) {
+        return error;
+    }
+
+    return transferred;
+}
+
+ssize_t Device::io(nfsfh* fd, u8* ptr, size_t len, bool is_write) {
+    // pread / pwrite do not update the file offset, so it's done manually.
+    u64 offset = 0;
+    auto ret = nfs_lseek(nfs, fd, 0, SEEK_CUR, &offset);
+    if (ret < 0) {
+        log_write("[NFS] nfs_lseek() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
+        return ret;
+    }
+
+    const auto transferred = io_pipelined(fd, offset, ptr, len, is_write);
+    if (transferred > 0) {
+        ret = nfs_lseek(nfs, fd, offset + transferred, SEEK_SET, nullptr);
+        if (ret < 0) {
+            log_write("[NFS] nfs_lseek() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
+            return ret;
+        }
+    }
+
+    return transferred;
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
@@ -155,74 +335,45 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
-    nfs_close(nfs, file->fd);
-    return 0;
-}
-
-ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
-    auto file = static_cast<File*>(fd);
-
-    // todo: uncomment this when it's fixed upstream.
-    #if 0
-    const auto ret = nfs_read(nfs, file->fd, ptr, len);
+    const auto ret = nfs_close(nfs, file->fd);
     if (ret < 0) {
-        log_write("[NFS] nfs_read() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
+        log_write("[NFS] nfs_close() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
         return ret;
     }
 
-    return ret;
-
-    #else
-    // work around for bug upsteam.
-    const auto max_read = nfs_get_readmax(nfs);
-    size_t bytes_read = 0;
+    return 0;
+}
 
-    while (bytes_read < len) {
-        const auto to_read = std::min<size_t>(len - bytes_read, max_read);
-        const auto ret = nfs_read(nfs, file->fd, ptr, to_read);
+ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
+    auto file = static_cast<File*>(fd);
 
+    // small reads are a single request, so skip the queue.
+    // note: nfs_read() of more than readmax is broken upstream, hence the min.
+    if (len <= std::min<size_t>(MIN_IO_CHUNK, nfs_get_readmax(nfs))) {
+        const auto ret = nfs_read(nfs, file->fd, ptr, len);
         if (ret < 0) {
             log_write("[NFS] nfs_read() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
-            return ret;
         }
 
-        ptr += ret;
-        bytes_read += ret;
-
-        if (ret < to_read) {
-            break;
-        }
+        return ret;
     }
 
-    return bytes_read;
-    #endif
+    return io(file->fd, (u8*)ptr, len, false);
 }
 
 ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
-    // unlike read, writing the max size seems to work fine.
-    const auto max_write = nfs_get_writemax(nfs);
-    size_t written = 0;
-
-    while (written < len) {
-        const auto to_write = std::min<size_t>(len - written, max_write);
-        const auto ret = nfs_write(nfs, file->fd, ptr, to_write);
-
+    if (len <= std::min<size_t>(MIN_IO_CHUNK, nfs_get_writemax(nfs))) {
+        const auto ret = nfs_write(nfs, file->fd, ptr, len);
         if (ret < 0) {
             log_write("[NFS] nfs_write() failed: %s errno: %s\n", nfs_get_error(nfs), std::strerror(-ret));
-            return ret;
         }
 
-        ptr += ret;
-        written += ret;
-
-        if (ret < to_write) {
-            break;
-        }
+        return ret;
     }
 
-    return written;
+    return io(file->fd, (u8*)ptr, len, true);
 }
 
 ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
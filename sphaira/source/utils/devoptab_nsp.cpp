@@ -1,12 +1,13 @@
 
 #include "utils/devoptab.hpp"
 #include "utils/devoptab_common.hpp"
+#include "utils/path_index.hpp"
 #include "defines.hpp"
 #include "log.hpp"
 
 #include "yati/container/nsp.hpp"
 #include "yati/container/xci.hpp"
-#include "yati/source/file.hpp"
+#include "yati/source/split.hpp"
 
 #include <cstring>
 #include <cerrno>
@@ -33,7 +34,10 @@ struct Device final : common::MountDevice {
     : MountDevice{_config}
     , source{std::forward<decltype(_source)>(_source)}
     , collections{_collections} {
-
+        path_index.Reserve(this->collections.size());
+        for (u32 i = 0; i < this->collections.size(); i++) {
+            path_index.Add("/" + this->collections[i].name, i);
+        }
     }
 
 private:
@@ -52,16 +56,17 @@ private:
 private:
     std::unique_ptr<common::LruBufferedData> source;
     const Collections collections;
+    // maps "/name" to the collection index.
+    utils::PathIndex path_index{};
 };
 
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
-    for (const auto& collection : this->collections) {
-        if (path == "/" + collection.name) {
-            file->collection = &collection;
-            return 0;
-        }
+    u32 index;
+    if (path_index.Find(path, index)) {
+        file->collection = &this->collections[index];
+        return 0;
     }
 
     log_write("[NSP] failed to open file %s\n", path);
@@ -159,16 +164,13 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
     if (!std::strcmp(path, "/")) {
         st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
     } else {
-        const auto it = std::ranges::find_if(this->collections, [path](auto& e){
-            return path == "/" + e.name;
-        });
-
-        if (it == this->collections.end()) {
+        u32 index;
+        if (!path_index.Find(path, index)) {
             return -ENOENT;
         }
 
         st->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-        st->st_size = it->size;
+        st->st_size = this->collections[index].size;
     }
 
     return 0;
@@ -177,11 +179,10 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
 } // namespace
 
 Result MountNsp(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
-    auto source = std::make_shared<yati::source::File>(fs, path);
-
+    std::shared_ptr<yati::source::Base> source;
     s64 size;
-    R_TRY(source->GetSize(&size));
-    auto buffered = std::make_unique<common::LruBufferedData>(source, size);
+    R_TRY(yati::source::OpenFile(fs, path, source, &size));
+    auto buffered = std::make_unique<common::LruBufferedData>(source, size, "nsp");
 
     yati::container::Nsp nsp{buffered.get()};
     yati::container::Collections collections;
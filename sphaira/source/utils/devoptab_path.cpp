@@ -0,0 +1,121 @@
+#include "utils/devoptab_path.hpp"
+#include "defines.hpp"
+
+#include <cstring>
+#include <curl/curl.h>
+
+namespace sphaira::devoptab::common {
+
+bool fix_path(const char* str, char* out, bool strip_leading_slash) {
+    str = std::strchr(str, ':');
+    if (!str) {
+        return false;
+    }
+
+    // skip over ':'
+    str++;
+    size_t len = 0;
+
+    // todo: hanle utf8 paths.
+    for (size_t i = 0; str[i]; i++) {
+        // skip multiple slashes.
+        if (i && str[i] == '/' && str[i - 1] == '/') {
+            continue;
+        }
+
+        if (!i) {
+            // skip leading slash.
+            if (strip_leading_slash && str[i] == '/') {
+                continue;
+            }
+
+            // add leading slash.
+            if (!strip_leading_slash && str[i] != '/') {
+                out[len++] = '/';
+            }
+        }
+
+        // save single char.
+        out[len++] = str[i];
+    }
+
+    // skip trailing slash.
+    if (len > 1 && out[len - 1] == '/') {
+        out[len - 1] = '\0';
+    }
+
+    // null the end.
+    out[len] = '\0';
+
+    return true;
+}
+
+// libcurl doesn't handle html encodings, so we have to do it manually.
+std::string html_decode(const std::string_view& str) {
+    struct Entry {
+        std::string_view key;
+        char value;
+    };
+
+    static constexpr Entry map[]{
+        { "&amp;", '&' },
+        { "&lt;", '<' },
+        { "&gt;", '>' },
+        { "&quot;", '"' },
+        { "&apos;", '\'' },
+        { "&nbsp;", ' ' },
+        { "&#38;", '&' },
+        { "&#60;", '<' },
+        { "&#62;", '>' },
+        { "&#34;", '"' },
+        { "&#39;", '\'' },
+        { "&#160;", ' ' },
+        { "&#35;", '#' },
+        { "&#37;", '%' },
+        { "&#43;", '+' },
+        { "&#61;", '=' },
+        { "&#64;", '@' },
+        { "&#91;", '[' },
+        { "&#93;", ']' },
+        { "&#123;", '{' },
+        { "&#125;", '}' },
+        { "&#126;", '~' },
+    };
+
+    std::string output{};
+    output.reserve(str.size());
+
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '&') {
+            bool found = false;
+            for (const auto& e : map) {
+                if (!str.compare(i, e.key.length(), e.key)) {
+                    output += e.value;
+                    i += e.key.length() - 1; // skip ahead.
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found) {
+                output += '&';
+            }
+        } else {
+            output += str[i];
+        }
+    }
+
+    return output;
+}
+
+std::string url_decode(const std::string& str) {
+    auto unescaped = curl_unescape(str.c_str(), str.length());
+    if (!unescaped) {
+        return str;
+    }
+    ON_SCOPE_EXIT(curl_free(unescaped));
+
+    return html_decode(unescaped);
+}
+
+} // namespace sphaira::devoptab::common
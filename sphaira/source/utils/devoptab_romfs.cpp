@@ -4,6 +4,8 @@
 
 #include <cstring>
 #include <algorithm>
+#include <string>
+#include <vector>
 #include <sys/stat.h>
 #include <sys/syslimits.h>
 
@@ -93,33 +95,128 @@ auto find_romfs_file(const romfs_dir* parent, const RomfsCollection& romfs, std:
     return nullptr;
 }
 
-} // namespace
+auto normalise_path(std::string_view path) -> std::string_view {
+    while (path.starts_with('/')) {
+        path = path.substr(1);
+    }
 
-bool find_file(const RomfsCollection& romfs, std::string_view path, FileEntry& out) {
-    const auto parent = find_romfs_relative_dir(romfs, path);
-    if (!parent) {
-        return false;
+    while (path.ends_with('/')) {
+        path = path.substr(0, path.length() - 1);
     }
 
-    out.romfs = find_romfs_file(parent, romfs, path);
-    if (!out.romfs) {
+    return path;
+}
+
+auto join_path(const std::string& parent, const u8* name, u32 name_len) -> std::string {
+    auto path = parent;
+    if (!path.empty()) {
+        path += '/';
+    }
+
+    path.append((const char*)name, name_len);
+    return path;
+}
+
+// walks the dir / file tables once, so that lookups don't need to walk the
+// tree comparing each name in the path.
+// offsets are bounds checked and the walk is capped, in case the tables are bad.
+bool build_index(RomfsCollection& romfs) {
+    const auto& dirs = romfs.dir_table;
+    const auto& files = romfs.file_table;
+    if (dirs.size() < sizeof(romfs_dir)) {
         return false;
     }
 
+    const auto is_valid_dir = [&dirs](u32 off) {
+        return off <= dirs.size() - sizeof(romfs_dir) && ((const romfs_dir*)(dirs.data() + off))->nameLen <= dirs.size() - off - sizeof(romfs_dir);
+    };
+
+    const auto is_valid_file = [&files](u32 off) {
+        return files.size() >= sizeof(romfs_file) && off <= files.size() - sizeof(romfs_file) && ((const romfs_file*)(files.data() + off))->nameLen <= files.size() - off - sizeof(romfs_file);
+    };
+
+    // dirs are counted twice, once when found and once when walked.
+    auto max_entries = dirs.size() / sizeof(romfs_dir) * 2 + files.size() / sizeof(romfs_file);
+    std::vector<std::pair<u32, std::string>> pending{{0, ""}};
+
+    while (!pending.empty()) {
+        auto [dir_off, path] = std::move(pending.back());
+        pending.pop_back();
+
+        if (!max_entries--) {
+            return false;
+        }
+
+        romfs.dir_index.Add(path, dir_off);
+        const auto dir = (const romfs_dir*)(dirs.data() + dir_off);
+
+        for (auto off = dir->childFile; off != ~0U; off = ((const romfs_file*)(files.data() + off))->sibling) {
+            if (!is_valid_file(off) || !max_entries--) {
+                return false;
+            }
+
+            const auto file = (const romfs_file*)(files.data() + off);
+            romfs.file_index.Add(join_path(path, file->name, file->nameLen), off);
+        }
+
+        for (auto off = dir->childDir; off != ~0U; off = ((const romfs_dir*)(dirs.data() + off))->sibling) {
+            if (!is_valid_dir(off) || !max_entries--) {
+                return false;
+            }
+
+            const auto child = (const romfs_dir*)(dirs.data() + off);
+            pending.emplace_back(off, join_path(path, child->name, child->nameLen));
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool find_file(const RomfsCollection& romfs, std::string_view path, FileEntry& out) {
+    if (!romfs.file_index.IsEmpty() || !romfs.dir_index.IsEmpty()) {
+        u32 off;
+        if (!romfs.file_index.Find(normalise_path(path), off)) {
+            return false;
+        }
+
+        out.romfs = (const romfs_file*)(romfs.file_table.data() + off);
+    } else {
+        const auto parent = find_romfs_relative_dir(romfs, path);
+        if (!parent) {
+            return false;
+        }
+
+        out.romfs = find_romfs_file(parent, romfs, path);
+        if (!out.romfs) {
+            return false;
+        }
+    }
+
     out.offset = romfs.offset + romfs.header.fileDataOff + out.romfs->dataOff;
     out.size = out.romfs->dataSize;
     return true;
 }
 
 bool find_dir(const RomfsCollection& romfs, std::string_view path, DirEntry& out) {
-    const auto parent = find_romfs_relative_dir(romfs, path);
-    if (!parent) {
-        return false;
-    }
+    if (!romfs.dir_index.IsEmpty()) {
+        u32 off;
+        if (!romfs.dir_index.Find(normalise_path(path), off)) {
+            return false;
+        }
 
-    out.romfs_root = find_romfs_dir(parent, romfs, path);
-    if (!out.romfs_root) {
-        return false;
+        out.romfs_root = (const romfs_dir*)(romfs.dir_table.data() + off);
+    } else {
+        const auto parent = find_romfs_relative_dir(romfs, path);
+        if (!parent) {
+            return false;
+        }
+
+        out.romfs_root = find_romfs_dir(parent, romfs, path);
+        if (!out.romfs_root) {
+            return false;
+        }
     }
 
     out.romfs_collection = &romfs;
@@ -186,6 +283,15 @@ Result LoadRomfsCollection(yati::source::Base* source, u64 offset, RomfsCollecti
 
     log_write("read romfs file\n");
 
+    // fallback to walking the tables if the index can't be built.
+    if (!build_index(out)) {
+        log_write("[RomFS] failed to build path index, using slow lookup\n");
+        out.dir_index.Clear();
+        out.file_index.Clear();
+    } else {
+        log_write("[RomFS] indexed %u dirs %u files\n", out.dir_index.Size(), out.file_index.Size());
+    }
+
     R_SUCCEED();
 }
 
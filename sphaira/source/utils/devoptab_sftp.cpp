@@ -11,6 +11,7 @@
 // buffering is now enabled only when requested.
 #include "utils/devoptab_common.hpp"
 #include "utils/profile.hpp"
+#include "utils/buffer_pool.hpp"
 #include "defines.hpp"
 #include "log.hpp"
 
@@ -19,17 +20,68 @@
 #include <cstring>
 #include <string>
 #include <cstring>
+#include <algorithm>
 
+#include <minIni.h>
 #include <libssh2.h>
 #include <libssh2_sftp.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
 
 namespace sphaira::devoptab {
 namespace {
 
+// size of each read passed to libssh2, which splits it into ~30KiB requests
+// and keeps them all in flight, so this is effectively the pipeline depth.
+// reads smaller than this are served from a read-ahead buffer of this size.
+constexpr size_t DEFAULT_READ_SIZE = 1024 * 1024;
+constexpr size_t MIN_READ_SIZE = 1024 * 32;
+constexpr size_t MAX_READ_SIZE = 1024 * 1024 * 8;
+
+// connect() blocks for the os timeout if the host is unreachable, so the
+// socket is connected non-blocking and polled for upto timeout_ms.
+int connect_timeout(int fd, const sockaddr* addr, socklen_t addr_len, long timeout_ms) {
+    const auto flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return connect(fd, addr, addr_len);
+    }
+    ON_SCOPE_EXIT(fcntl(fd, F_SETFL, flags));
+
+    if (!connect(fd, addr, addr_len)) {
+        return 0;
+    }
+
+    if (errno != EINPROGRESS) {
+        return -1;
+    }
+
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+
+    const auto ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0) {
+        errno = ret ? errno : ETIMEDOUT;
+        return -1;
+    }
+
+    int error{};
+    socklen_t len = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+        return -1;
+    }
+
+    if (error) {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
 struct Device final : common::MountDevice {
     using MountDevice::MountDevice;
     ~Device();
@@ -55,6 +107,9 @@ private:
     int devoptab_statvfs(const char *path, struct statvfs *buf) override;
     int devoptab_fsync(void *fd) override;
 
+private:
+    ssize_t read_full(LIBSSH2_SFTP_HANDLE* fd, char *ptr, size_t len);
+
 private:
     LIBSSH2_SESSION* m_session{};
     LIBSSH2_SFTP* m_sftp_session{};
@@ -62,11 +117,21 @@ private:
     bool m_is_ssh2_init{}; // set if libssh2_init() was successful.
     bool m_is_handshake_done{}; // set if handshake was successful.
     bool m_is_auth_done{}; // set if auth was successful.
+    size_t m_read_size{DEFAULT_READ_SIZE};
     bool mounted{};
 };
 
 struct File {
     LIBSSH2_SFTP_HANDLE* fd{};
+    // read-ahead buffer, allocated on the first small read.
+    u8* buf{};
+    size_t buf_off{};
+    size_t buf_size{};
+
+    // data that has been read from the server but not yet returned.
+    auto Buffered() const -> size_t {
+        return buf_size - buf_off;
+    }
 };
 
 struct Dir {
@@ -209,7 +274,7 @@ bool Device::Mount() {
                 continue;
             }
 
-            ret = connect(m_socket, addr->ai_addr, addr->ai_addrlen);
+            ret = connect_timeout(m_socket, addr->ai_addr, addr->ai_addrlen, this->config.GetConnectTimeout());
             if (ret < 0) {
                 log_write("[SFTP] connect() failed: %s\n", std::strerror(errno));
                 close(m_socket);
@@ -302,6 +367,17 @@ bool Device::Mount() {
         }
     }
 
+    const auto read_size = this->config.extra.find("read_size");
+    if (read_size != this->config.extra.end()) {
+        const auto read_size_val = ini_parse_getl(read_size->second.c_str(), -1);
+        if (read_size_val <= 0) {
+            log_write("[SFTP] Invalid read_size value: %s\n", read_size->second.c_str());
+        } else {
+            m_read_size = std::clamp<size_t>(read_size_val, MIN_READ_SIZE, MAX_READ_SIZE);
+            log_write("[SFTP] Setting read_size: %zu\n", m_read_size);
+        }
+    }
+
     log_write("[SFTP] Mounted %s\n", this->config.url.c_str());
     return mounted = true;
 }
@@ -322,9 +398,38 @@ int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
     libssh2_sftp_close(file->fd);
+    if (file->buf) {
+        utils::pool::Free(file->buf, m_read_size);
+    }
     return 0;
 }
 
+// libssh2 returns as soon as any data arrives, so keep reading until full.
+// the remaining size is passed each time so that the pipeline stays full.
+ssize_t Device::read_full(LIBSSH2_SFTP_HANDLE* fd, char *ptr, size_t len) {
+    size_t bytes_read = 0;
+
+    while (bytes_read < len) {
+        const auto ret = libssh2_sftp_read(fd, ptr + bytes_read, len - bytes_read);
+        if (ret < 0) {
+            log_write("[SFTP] libssh2_sftp_read() failed: %ld\n", libssh2_sftp_last_error(m_sftp_session));
+            if (!bytes_read) {
+                return -EIO;
+            }
+            break;
+        }
+
+        // eof.
+        if (!ret) {
+            break;
+        }
+
+        bytes_read += ret;
+    }
+
+    return bytes_read;
+}
+
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
@@ -335,18 +440,60 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     SCOPED_TIMESTAMP(name);
     #endif
 
-    const auto ret = libssh2_sftp_read(file->fd, ptr, len);
+    size_t bytes_read = 0;
+
+    // drain the read-ahead buffer first.
+    if (file->Buffered()) {
+        const auto size = std::min(len, file->Buffered());
+        std::memcpy(ptr, file->buf + file->buf_off, size);
+        file->buf_off += size;
+        bytes_read += size;
+    }
+
+    if (bytes_read == len) {
+        return bytes_read;
+    }
+
+    // large reads go straight into the output, as they fill the pipeline anyway.
+    if (len - bytes_read >= m_read_size) {
+        const auto ret = read_full(file->fd, ptr + bytes_read, len - bytes_read);
+        if (ret < 0 && !bytes_read) {
+            return ret;
+        }
+
+        return bytes_read + std::max<ssize_t>(ret, 0);
+    }
+
+    if (!file->buf) {
+        file->buf = static_cast<u8*>(utils::pool::Allocate(m_read_size));
+        if (!file->buf) {
+            return bytes_read ? (ssize_t)bytes_read : -ENOMEM;
+        }
+    }
+
+    const auto ret = read_full(file->fd, (char*)file->buf, m_read_size);
     if (ret < 0) {
-        log_write("[SFTP] libssh2_sftp_read() failed: %ld\n", libssh2_sftp_last_error(m_sftp_session));
-        return -EIO;
+        return bytes_read ? (ssize_t)bytes_read : ret;
     }
 
-    return ret;
+    file->buf_off = 0;
+    file->buf_size = ret;
+
+    const auto size = std::min(len - bytes_read, file->Buffered());
+    std::memcpy(ptr + bytes_read, file->buf, size);
+    file->buf_off += size;
+    return bytes_read + size;
 }
 
 ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
+    // the handle is ahead of the caller due to read-ahead, so rewind it.
+    if (file->Buffered()) {
+        libssh2_sftp_seek64(file->fd, libssh2_sftp_tell64(file->fd) - file->Buffered());
+    }
+    file->buf_off = file->buf_size = 0;
+
     const auto ret = libssh2_sftp_write(file->fd, ptr, len);
     if (ret < 0) {
         log_write("[SFTP] libssh2_sftp_write() failed: %ld\n", libssh2_sftp_last_error(m_sftp_session));
@@ -358,7 +505,9 @@ ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
 
 ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
     auto file = static_cast<File*>(fd);
-    const auto current_pos = libssh2_sftp_tell64(file->fd);
+    // the handle is ahead of the caller due to read-ahead.
+    const auto handle_pos = libssh2_sftp_tell64(file->fd);
+    const auto current_pos = handle_pos - file->Buffered();
 
     if (dir == SEEK_CUR) {
         pos += current_pos;
@@ -377,6 +526,14 @@ ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
         return pos;
     }
 
+    // seeking within the read-ahead buffer keeps the pipeline intact.
+    const auto buf_start = handle_pos - file->buf_size;
+    if (file->buf_size && pos >= (off_t)buf_start && pos < (off_t)handle_pos) {
+        file->buf_off = pos - buf_start;
+        return pos;
+    }
+
+    file->buf_off = file->buf_size = 0;
     log_write("[SFTP] Seeking to %ld dir: %d old: %llu\n", pos, dir, current_pos);
     libssh2_sftp_seek64(file->fd, pos);
     return libssh2_sftp_tell64(file->fd);
@@ -4,9 +4,12 @@
 
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <cstring>
+#include <cstdlib>
 #include <string>
-#include <cstring>
+#include <vector>
+#include <algorithm>
 #include <smb2/smb2.h>
 #include <smb2/libsmb2.h>
 #include <minIni.h>
@@ -14,6 +17,16 @@
 namespace sphaira::devoptab {
 namespace {
 
+// default / max number of read / write requests kept in flight.
+constexpr u32 DEFAULT_READ_DEPTH = 4;
+constexpr u32 DEFAULT_WRITE_DEPTH = 4;
+constexpr u32 MAX_IO_DEPTH = 16;
+// io is split into at least this size, so that small reads / writes are not
+// turned into lots of tiny requests.
+constexpr size_t MIN_IO_CHUNK = 1024 * 64;
+// same timeout that libsmb2 uses for its sync api.
+constexpr int POLL_TIMEOUT_MS = 1000;
+
 struct Device final : common::MountDevice {
     using MountDevice::MountDevice;
     ~Device();
@@ -43,11 +56,34 @@ private:
     int devoptab_statvfs(const char *path, struct statvfs *buf) override;
     int devoptab_fsync(void *fd) override;
 
+private:
+    ssize_t io_pipelined(smb2fh* fd, u64 offset, u8* ptr, size_t len, bool is_write);
+    // pipelined read / write from the current file offset.
+    ssize_t io(smb2fh* fd, u8* ptr, size_t len, bool is_write);
+
 private:
     smb2_context* smb2{};
+    u32 read_depth{DEFAULT_READ_DEPTH};
+    u32 write_depth{DEFAULT_WRITE_DEPTH};
     bool mounted{};
 };
 
+// a single async read / write request, owned by io_pipelined().
+struct IoRequest {
+    size_t offset;
+    size_t size;
+    int status;
+    bool done;
+    // set once the reply has been accounted for.
+    bool handled;
+};
+
+void io_cb(smb2_context* smb2, int status, void* command_data, void* cb_data) {
+    auto req = static_cast<IoRequest*>(cb_data);
+    req->status = status;
+    req->done = true;
+}
+
 struct File {
     smb2fh* fd;
 };
@@ -121,6 +157,16 @@ bool Device::Mount() {
         if (config.timeout > 0) {
             smb2_set_timeout(this->smb2, this->config.timeout);
         }
+
+        const auto read_depth = this->config.extra.find("read_depth");
+        if (read_depth != this->config.extra.end()) {
+            this->read_depth = std::clamp<u32>(std::atoi(read_depth->second.c_str()), 1, MAX_IO_DEPTH);
+        }
+
+        const auto write_depth = this->config.extra.find("write_depth");
+        if (write_depth != this->config.extra.end()) {
+            this->write_depth = std::clamp<u32>(std::atoi(write_depth->second.c_str()), 1, MAX_IO_DEPTH);
+        }
     }
 
     // due to a bug in old sphira, i incorrectly prepended the url with smb:// rather than smb2://
@@ -142,10 +188,129 @@ bool Device::Mount() {
         return false;
     }
 
+    log_write("[SMB2] max read: %u max write: %u read depth: %u write depth: %u\n", smb2_get_max_read_size(this->smb2), smb2_get_max_write_size(this->smb2), this->read_depth, this->write_depth);
     this->mounted = true;
     return true;
 }
 
+// keeps up to read_depth / write_depth requests in flight, rather than
+// waiting for each reply before sending the next request.
+// returns the number of contiguous bytes transferred from the start of ptr.
+ssize_t Device::io_pipelined(smb2fh* fd, u64 offset, u8* ptr, size_t len, bool is_write) {
+    const size_t max_size = is_write ? smb2_get_max_write_size(this->smb2) : smb2_get_max_read_size(this->smb2);
+    const auto depth = is_write ? this->write_depth : this->read_depth;
+    const auto chunk_size = std::clamp<size_t>(len / depth, std::min(MIN_IO_CHUNK, max_size), max_size);
+    const auto count = (len + chunk_size - 1) / chunk_size;
+
+    std::vector<IoRequest> requests(count);
+    size_t next{};
+    size_t pending{};
+    bool eof{};
+    int error{};
+
+    for (;;) {
+        // top up the pipeline, unless a previous request was short / failed.
+        while (!eof && !error && next < count && pending < depth) {
+            auto& req = requests[next];
+            req.offset = next * chunk_size;
+            req.size = std::min<size_t>(len - req.offset, chunk_size);
+
+            int ret;
+            if (is_write) {
+                ret = smb2_pwrite_async(this->smb2, fd, ptr + req.offset, req.size, offset + req.offset, io_cb, &req);
+            } else {
+                ret = smb2_pread_async(this->smb2, fd, ptr + req.offset, req.size, offset + req.offset, io_cb, &req);
+            }
+
+            if (ret < 0) {
+                log_write("[SMB2] smb2_p%s_async() failed: %s errno: %s\n", is_write ? "write" : "read", smb2_get_error(this->smb2), std::strerror(-ret));
+                error = ret;
+                break;
+            }
+
+            next++;
+            pending++;
+        }
+
+        if (!pending) {
+            break;
+        }
+
+        pollfd pfd{};
+        pfd.fd = smb2_get_fd(this->smb2);
+        pfd.events = smb2_which_events(this->smb2);
+
+        if (poll(&pfd, 1, POLL_TIMEOUT_MS) < 0) {
+            log_write("[SMB2] poll() failed: %s\n", std::strerror(errno));
+            return -EIO;
+        }
+
+        if (smb2_service(this->smb2, pfd.revents) < 0) {
+            log_write("[SMB2] smb2_service() failed: %s\n", smb2_get_error(this->smb2));
+            return -EIO;
+        }
+
+        for (size_t i = 0; i < next; i++) {
+            auto& req = requests[i];
+            if (!req.done || req.handled) {
+                continue;
+            }
+
+            req.handled = true;
+
+            if (req.status < 0) {
+                log_write("[SMB2] smb2_p%s_async() reply failed: %s errno: %s\n", is_write ? "write" : "read", smb2_get_error(this->smb2), std::strerror(-req.status));
+                error = req.status;
+            } else if (static_cast<size_t>(req.status) < req.size) {
+                eof = true;
+            }
+
+            pending--;
+        }
+    }
+
+    // sum up the contiguous data, stopping at the first short request.
+    size_t transferred{};
+    for (size_t i = 0; i < next; i++) {
+        const auto& req = requests[i];
+        if (!req.done || req.status < 0) {
+            break;
+        }
+
+        transferred += req.status;
+        if (static_cast<size_t>(req.status) < req.size) {
+            break;
+        }
+    }
+
+    if (!transferred && error) {
+        return error;
+    }
+
+    return transferred;
+}
+
+ssize_t Device::io(smb2fh* fd, u8* ptr, size_t len, bool is_write) {
+    // pread / pwrite do not update the file offset, so it's done manually.
+    u64 offset = 0;
+    auto ret = smb2_lseek(this->smb2, fd, 0, SEEK_CUR, &offset);
+    if (ret < 0) {
+        log_write("[SMB2] smb2_lseek() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
+        return ret;
+    }
+
+    const auto transferred = io_pipelined(fd, offset, ptr, len, is_write);
+    if (transferred > 0) {
+        ret = smb2_lseek(this->smb2, fd, offset + transferred, SEEK_SET, nullptr);
+        if (ret < 0) {
+            log_write("[SMB2] smb2_lseek() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
+            return ret;
+        }
+    }
+
+    return transferred;
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
@@ -161,60 +326,45 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
-    smb2_close(this->smb2, file->fd);
+    // pending writes are flushed by the close, so report if they failed.
+    const auto ret = smb2_close(this->smb2, file->fd);
+    if (ret < 0) {
+        log_write("[SMB2] smb2_close() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
+        return ret;
+    }
+
     return 0;
 }
 
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
-    const auto max_read = smb2_get_max_read_size(this->smb2);
-    size_t bytes_read = 0;
-
-    while (bytes_read < len) {
-        const auto to_read = std::min<size_t>(len - bytes_read, max_read);
-        const auto ret = smb2_read(this->smb2, file->fd, (u8*)ptr, to_read);
-
+    // small reads are a single request, so skip the pipeline.
+    if (len <= MIN_IO_CHUNK) {
+        const auto ret = smb2_read(this->smb2, file->fd, (u8*)ptr, len);
         if (ret < 0) {
             log_write("[SMB2] smb2_read() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
-            return ret;
         }
 
-        ptr += ret;
-        bytes_read += ret;
-
-        if (ret < to_read) {
-            break;
-        }
+        return ret;
     }
 
-    return bytes_read;
+    return io(file->fd, (u8*)ptr, len, false);
 }
 
 ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
     auto file = static_cast<File*>(fd);
 
-    const auto max_write = smb2_get_max_write_size(this->smb2);
-    size_t written = 0;
-
-    while (written < len) {
-        const auto to_write = std::min<size_t>(len - written, max_write);
-        const auto ret = smb2_write(this->smb2, file->fd, (const u8*)ptr, to_write);
-
+    if (len <= MIN_IO_CHUNK) {
+        const auto ret = smb2_write(this->smb2, file->fd, (const u8*)ptr, len);
         if (ret < 0) {
             log_write("[SMB2] smb2_write() failed: %s errno: %s\n", smb2_get_error(this->smb2), std::strerror(-ret));
-            return ret;
         }
 
-        ptr += ret;
-        written += ret;
-
-        if (ret < to_write) {
-            break;
-        }
+        return ret;
     }
 
-    return written;
+    return io(file->fd, (u8*)ptr, len, true);
 }
 
 ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
@@ -0,0 +1,235 @@
+#include "utils/devoptab.hpp"
+#include "utils/devoptab_common.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include "yati/source/file.hpp"
+
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <dirent.h>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+namespace sphaira::devoptab {
+namespace {
+
+// seeks on optical drives take 100ms+ and small reads are slow, so file reads
+// go through the block cache and read ahead 2MiB once they're sequential.
+// 512k blocks are also a multiple of the 2048 byte sector size.
+constexpr u32 PREFETCH_BLOCKS = 4;
+
+struct File {
+    common::PrefetchCachedData* cache;
+    s64 off;
+    s64 size;
+};
+
+struct Dir {
+    DIR* dir;
+};
+
+// forwards everything to the usbdvd mount, but file reads are cached.
+struct Device final : common::MountDevice {
+    Device(const common::MountConfig& _config)
+    : common::MountDevice{_config}
+    , m_root{config.url} {
+        // the mount point may or may not have the trailing slash.
+        while (m_root.ends_with('/')) {
+            m_root.pop_back();
+        }
+    }
+
+private:
+    bool fix_path(const char* str, char* out, bool strip_leading_slash = false) override {
+        char temp[PATH_MAX]{};
+        if (!common::fix_path(str, temp, true)) {
+            return false;
+        }
+
+        std::snprintf(out, PATH_MAX, "%s/%s", m_root.c_str(), temp);
+        return true;
+    }
+
+    bool Mount() override {
+        return !m_root.empty();
+    }
+
+    int devoptab_open(void *fileStruct, const char *path, int flags, int mode) override;
+    int devoptab_close(void *fd) override;
+    ssize_t devoptab_read(void *fd, char *ptr, size_t len) override;
+    ssize_t devoptab_seek(void *fd, off_t pos, int dir) override;
+    int devoptab_fstat(void *fd, struct stat *st) override;
+    int devoptab_diropen(void* fd, const char *path) override;
+    int devoptab_dirreset(void* fd) override;
+    int devoptab_dirnext(void* fd, char *filename, struct stat *filestat) override;
+    int devoptab_dirclose(void* fd) override;
+    int devoptab_lstat(const char *path, struct stat *st) override;
+    int devoptab_statvfs(const char *path, struct statvfs *buf) override;
+
+private:
+    std::string m_root;
+    fs::FsStdio m_fs{};
+};
+
+int return_errno(int err = EIO) {
+    return errno ? -errno : -err;
+}
+
+int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
+    auto file = static_cast<File*>(fileStruct);
+
+    auto source = std::make_shared<yati::source::File>(&m_fs, path);
+    if (R_FAILED(source->GetOpenResult())) {
+        log_write("[USBDVD] failed to open: %s\n", path);
+        return -ENOENT;
+    }
+
+    s64 size;
+    if (R_FAILED(source->GetSize(&size))) {
+        log_write("[USBDVD] failed to get size: %s\n", path);
+        return -EIO;
+    }
+
+    file->cache = new common::PrefetchCachedData(source, size, "usbdvd", PREFETCH_BLOCKS);
+    file->size = size;
+    return 0;
+}
+
+int Device::devoptab_close(void *fd) {
+    auto file = static_cast<File*>(fd);
+
+    delete file->cache;
+    std::memset(file, 0, sizeof(*file));
+    return 0;
+}
+
+ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
+    auto file = static_cast<File*>(fd);
+
+    len = std::min<s64>(len, file->size - file->off);
+    if (!len) {
+        return 0;
+    }
+
+    u64 bytes_read;
+    if (R_FAILED(file->cache->Read(ptr, file->off, len, &bytes_read))) {
+        log_write("[USBDVD] failed to read at off: %zu len: %zu\n", (size_t)file->off, len);
+        return -EIO;
+    }
+
+    file->off += bytes_read;
+    return bytes_read;
+}
+
+ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
+    auto file = static_cast<File*>(fd);
+
+    if (dir == SEEK_CUR) {
+        pos += file->off;
+    } else if (dir == SEEK_END) {
+        pos = file->size;
+    }
+
+    return file->off = std::clamp<s64>(pos, 0, file->size);
+}
+
+int Device::devoptab_fstat(void *fd, struct stat *st) {
+    auto file = static_cast<File*>(fd);
+
+    st->st_nlink = 1;
+    st->st_size = file->size;
+    st->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+    return 0;
+}
+
+int Device::devoptab_diropen(void* fd, const char *path) {
+    auto dir = static_cast<Dir*>(fd);
+
+    auto ret = opendir(path);
+    if (!ret) {
+        return return_errno();
+    }
+
+    dir->dir = ret;
+    return 0;
+}
+
+int Device::devoptab_dirreset(void* fd) {
+    auto dir = static_cast<Dir*>(fd);
+
+    rewinddir(dir->dir);
+    return 0;
+}
+
+int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
+    auto dir = static_cast<Dir*>(fd);
+
+    const auto entry = readdir(dir->dir);
+    if (!entry) {
+        return return_errno(ENOENT);
+    }
+
+    filestat->st_ino = entry->d_ino;
+    filestat->st_mode = entry->d_type << 12; // DT_* to S_IF*
+    filestat->st_nlink = 1; // unknown
+
+    std::strncpy(filename, entry->d_name, NAME_MAX);
+    filename[NAME_MAX - 1] = '\0';
+
+    return 0;
+}
+
+int Device::devoptab_dirclose(void* fd) {
+    auto dir = static_cast<Dir*>(fd);
+
+    closedir(dir->dir);
+    return 0;
+}
+
+int Device::devoptab_lstat(const char *path, struct stat *st) {
+    const auto ret = lstat(path, st);
+    if (ret < 0) {
+        return return_errno();
+    }
+
+    return 0;
+}
+
+int Device::devoptab_statvfs(const char *path, struct statvfs *buf) {
+    const auto ret = statvfs(path, buf);
+    if (ret < 0) {
+        return return_errno();
+    }
+
+    return 0;
+}
+
+} // namespace
+
+Result MountUsbDvd(const fs::FsPath& root, fs::FsPath& out_path) {
+    common::MountConfig config{};
+    config.url = root;
+    config.read_only = true;
+    config.no_stat_file = false;
+    config.no_stat_dir = false;
+    // listed by usbdvd::GetMountPoint() instead.
+    config.fs_hidden = true;
+    config.dump_hidden = true;
+
+    if (!common::MountNetworkDevice2(
+        std::make_unique<Device>(config),
+        config,
+        sizeof(File), sizeof(Dir),
+        "usbdvd_cache", "usbdvd_cache:/"
+    )) {
+        log_write("[USBDVD] Failed to mount cache for %s\n", root.s);
+        R_THROW(0x1);
+    }
+
+    out_path = "usbdvd_cache:/";
+    R_SUCCEED();
+}
+
+} // namespace sphaira::devoptab
@@ -25,7 +25,7 @@ private:
         }
 
         std::snprintf(out, PATH_MAX, "%s/%s", m_root.c_str(), temp);
-        log_write("[VFS] fixed path: %s -> %s\n", str, out);
+        log_debug(LogCategory_Devoptab, "[VFS] fixed path: %s -> %s\n", str, out);
         return true;
     }
 
@@ -25,10 +25,12 @@ constexpr const char* XPATH_PROPSTAT_PROP = ".//*[local-name()='propstat']/*[loc
 constexpr const char* XPATH_PROP          = ".//*[local-name()='prop']";
 constexpr const char* XPATH_RESOURCETYPE  = ".//*[local-name()='resourcetype']";
 constexpr const char* XPATH_COLLECTION    = ".//*[local-name()='collection']";
+constexpr const char* XPATH_CONTENTLENGTH = ".//*[local-name()='getcontentlength']";
+constexpr const char* XPATH_LASTMODIFIED  = ".//*[local-name()='getlastmodified']";
 
 struct DirEntry {
     std::string name{};
-    bool is_dir{};
+    struct stat st{};
 };
 using DirEntries = std::vector<DirEntry>;
 
@@ -39,6 +41,7 @@ struct FileEntry {
 
 struct File {
     FileEntry* entry;
+    CURL* curl;
     common::PushPullThreadData* push_pull_thread_data;
     size_t off;
     size_t last_off;
@@ -71,13 +74,16 @@ private:
     int devoptab_lstat(const char *path, struct stat *st) override;
     int devoptab_ftruncate(void *fd, off_t len) override;
     int devoptab_fsync(void *fd) override;
+    int devoptab_copy(const char *src, const char *dst) override;
 
-    std::pair<bool, long> webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data = nullptr);
+    // set no_timeout if the server may take a while to respond, ie, when copying.
+    std::pair<bool, long> webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data = nullptr, bool no_timeout = false);
     int webdav_dirlist(const std::string& path, DirEntries& out);
     int webdav_stat(const std::string& path, struct stat* st, bool is_dir);
     int webdav_remove_file_folder(const std::string& path, bool is_dir);
     int webdav_unlink(const std::string& path);
     int webdav_rename(const std::string& old_path, const std::string& new_path, bool is_dir);
+    int webdav_copy(const std::string& src_path, const std::string& dst_path);
     int webdav_mkdir(const std::string& path);
     int webdav_rmdir(const std::string& path);
 };
@@ -86,7 +92,7 @@ size_t dummy_data_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
     return size * nmemb;
 }
 
-std::pair<bool, long> Device::webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data) {
+std::pair<bool, long> Device::webdav_custom_command(const std::string& path, const std::string& cmd, std::string_view postfields, std::span<const std::string> headers, bool is_dir, std::vector<char>* response_data, bool no_timeout) {
     const auto url = build_url(path, is_dir);
 
     curl_slist* header_list{};
@@ -101,6 +107,10 @@ std::pair<bool, long> Device::webdav_custom_command(const std::string& path, con
     curl_set_common_options(this->curl, url);
     curl_easy_setopt(this->curl, CURLOPT_HTTPHEADER, header_list);
     curl_easy_setopt(this->curl, CURLOPT_CUSTOMREQUEST, cmd.c_str());
+    if (no_timeout) {
+        // nothing is sent until the server is done.
+        curl_easy_setopt(this->curl, CURLOPT_LOW_SPEED_LIMIT, 0L);
+    }
     if (!postfields.empty()) {
         log_write("[WEBDAV] Post fields: %.*s\n", (int)postfields.length(), postfields.data());
         curl_easy_setopt(this->curl, CURLOPT_POSTFIELDS, postfields.data());
@@ -131,8 +141,9 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
         "<?xml version=\"1.0\" encoding=\"utf-8\" ?>"
         "<d:propfind xmlns:d=\"DAV:\">"
             "<d:prop>"
-            // "<d:getcontentlength/>"
             "<d:resourcetype/>"
+            "<d:getcontentlength/>"
+            "<d:getlastmodified/>"
         "</d:prop>"
         "</d:propfind>";
 
@@ -211,6 +222,26 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
             is_dir = true;
         }
 
+        // the size and time are returned for every child, so the listing can
+        // also answer lstat without a HEAD request per file.
+        struct stat st{};
+        if (is_dir) {
+            st.st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
+        } else {
+            st.st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+            if (const auto length_x = prop.select_node(XPATH_CONTENTLENGTH)) {
+                st.st_size = length_x.node().text().as_llong();
+            }
+        }
+
+        if (const auto modified_x = prop.select_node(XPATH_LASTMODIFIED)) {
+            const auto file_time = curl_getdate(modified_x.node().text().as_string(), nullptr);
+            st.st_mtime = file_time > 0 ? file_time : 0;
+            st.st_atime = st.st_mtime;
+            st.st_ctime = st.st_mtime;
+        }
+        st.st_nlink = 1;
+
         auto name = href;
         if (!name.empty() && name.back() == '/') {
             name.pop_back();
@@ -226,7 +257,7 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
             continue;
         }
 
-        out.emplace_back(name, is_dir);
+        out.emplace_back(name, st);
     }
 
     log_write("[WEBDAV] Parsed %zu entries from directory listing\n", out.size());
@@ -234,7 +265,8 @@ int Device::webdav_dirlist(const std::string& path, DirEntries& out) {
     return 0;
 }
 
-// todo: use PROPFIND to get file size and time, although it is slower...
+// NOTE: PROPFIND is slower than HEAD for a single file, so this is only used
+// when the parent listing isn't in the metadata cache.
 int Device::webdav_stat(const std::string& path, struct stat* st, bool is_dir) {
     std::memset(st, 0, sizeof(*st));
     const auto url = build_url(path, is_dir);
@@ -358,6 +390,44 @@ int Device::webdav_rename(const std::string& old_path, const std::string& new_pa
     }
 }
 
+int Device::webdav_copy(const std::string& src_path, const std::string& dst_path) {
+    log_write("[WEBDAV] Copying %s to %s\n", src_path.c_str(), dst_path.c_str());
+
+    const std::string custom_headers[] = {
+        "Destination: " + build_url(dst_path, false),
+        "Overwrite: T",
+        "Depth: 0",
+    };
+
+    const auto [success, response_code] = webdav_custom_command(src_path, "COPY", "", custom_headers, false, nullptr, true);
+
+    if (!success) {
+        return -EIO;
+    }
+
+    switch (response_code) {
+        case 201: // Created
+        case 204: // No Content
+            return 0;
+        case 404: // Not Found
+            return -ENOENT;
+        case 403: // Forbidden
+            return -EACCES;
+        case 409: // Conflict
+            return -ENOENT; // Parent directory of destination does not exist
+        case 412: // Precondition Failed
+            return -EEXIST;
+        case 405: // Method Not Allowed
+        case 501: // Not Implemented
+        case 502: // Bad Gateway, the destination is on another server
+            return -ENOTSUP;
+        case 507: // Insufficient Storage
+            return -ENOSPC;
+        default:
+            return -EIO;
+    }
+}
+
 int Device::webdav_mkdir(const std::string& path) {
     const auto [success, response_code] = webdav_custom_command(path, "MKCOL", "", {}, true);
     if (!success) {
@@ -393,7 +463,13 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
     if ((flags & O_ACCMODE) == O_RDONLY) {
         // ensure the file exists and get its size.
-        const auto ret = webdav_stat(path, &st, false);
+        // this is usually answered by the cached parent listing.
+        int ret;
+        if (!metadata_cache.GetStat(path, &st, ret)) {
+            ret = webdav_stat(path, &st, false);
+            metadata_cache.SetStat(path, &st, ret);
+        }
+
         if (ret < 0) {
             return ret;
         }
@@ -405,6 +481,11 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
     }
 
     log_write("[WEBDAV] Opening file: %s\n", path);
+    file->curl = acquire_handle();
+    if (!file->curl) {
+        return -ENOMEM;
+    }
+
     file->entry = new FileEntry{path, st};
     file->write_mode = (flags & (O_WRONLY | O_RDWR));
 
@@ -415,9 +496,19 @@ int Device::devoptab_close(void *fd) {
     auto file = static_cast<File*>(fd);
 
     log_write("[WEBDAV] Closing file: %s\n", file->entry->path.c_str());
+    // uploads are only complete once curl has sent everything, so report
+    // the error here rather than losing it.
+    int ret = 0;
+    if (file->write_mode && file->push_pull_thread_data && !file->push_pull_thread_data->Finish()) {
+        log_write("[WEBDAV] Upload failed for file: %s code: %ld\n", file->entry->path.c_str(), file->push_pull_thread_data->code);
+        ret = -EIO;
+    }
+
+    // stops the transfer before the handle is reused.
     delete file->push_pull_thread_data;
+    release_handle(file->curl);
     delete file->entry;
-    return 0;
+    return ret;
 }
 
 ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
@@ -442,7 +533,7 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[WEBDAV] Creating download thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePushData(this->transfer_curl, build_url(file->entry->path, false), file->off);
+        file->push_pull_thread_data = CreatePushData(file->curl, build_url(file->entry->path, false), file->off);
         if (!file->push_pull_thread_data) {
             log_write("[WEBDAV] Failed to create download thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -470,7 +561,7 @@ ssize_t Device::devoptab_write(void *fd, const char *ptr, size_t len) {
 
     if (!file->push_pull_thread_data) {
         log_write("[WEBDAV] Creating upload thread data for file: %s\n", file->entry->path.c_str());
-        file->push_pull_thread_data = CreatePullData(this->transfer_curl, build_url(file->entry->path, false));
+        file->push_pull_thread_data = CreatePullData(file->curl, build_url(file->entry->path, false));
         if (!file->push_pull_thread_data) {
             log_write("[WEBDAV] Failed to create upload thread data for file: %s\n", file->entry->path.c_str());
             return -EIO;
@@ -533,6 +624,16 @@ int Device::devoptab_rename(const char *oldName, const char *newName) {
     return 0;
 }
 
+int Device::devoptab_copy(const char *src, const char *dst) {
+    const auto ret = webdav_copy(src, dst);
+    if (ret < 0) {
+        log_write("[WEBDAV] webdav_copy() failed: %s to %s errno: %s\n", src, dst, std::strerror(-ret));
+        return ret;
+    }
+
+    return 0;
+}
+
 int Device::devoptab_mkdir(const char *path, int mode) {
     const auto ret = webdav_mkdir(path);
     if (ret < 0) {
@@ -582,14 +683,8 @@ int Device::devoptab_dirnext(void* fd, char *filename, struct stat *filestat) {
         return -ENOENT;
     }
 
-    auto& entry = (*dir->entries)[dir->index];
-    if (entry.is_dir) {
-        filestat->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else {
-        filestat->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-    }
-
-    filestat->st_nlink = 1;
+    const auto& entry = (*dir->entries)[dir->index];
+    std::memcpy(filestat, &entry.st, sizeof(*filestat));
     std::strcpy(filename, entry.name.c_str());
 
     dir->index++;
@@ -1,11 +1,12 @@
 
 #include "utils/devoptab.hpp"
 #include "utils/devoptab_common.hpp"
+#include "utils/path_index.hpp"
 #include "defines.hpp"
 #include "log.hpp"
 
 #include "yati/container/xci.hpp"
-#include "yati/source/file.hpp"
+#include "yati/source/split.hpp"
 
 #include <cstring>
 #include <cerrno>
@@ -31,7 +32,15 @@ struct Device final : common::MountDevice {
     : MountDevice{_config}
     , source{std::forward<decltype(_source)>(_source)}
     , partitions{_partitions} {
+        for (u32 i = 0; i < this->partitions.size(); i++) {
+            const auto& partition = this->partitions[i];
+            const auto dir_path = "/" + partition.name;
+            dir_index.Add(dir_path, i);
 
+            for (u32 j = 0; j < partition.collections.size(); j++) {
+                file_index.Add(dir_path + "/" + partition.collections[j].name, (i << 16) | j);
+            }
+        }
     }
 
 private:
@@ -47,21 +56,43 @@ private:
     int devoptab_dirclose(void* fd) override;
     int devoptab_lstat(const char *path, struct stat *st) override;
 
+private:
+    auto find_collection(const char* path) const -> const yati::container::CollectionEntry*;
+    auto find_partition(const char* path) const -> const yati::container::Xci::Partition*;
+
 private:
     std::unique_ptr<common::LruBufferedData> source;
     const yati::container::Xci::Partitions partitions;
+    // maps "/partition" to the partition index.
+    utils::PathIndex dir_index{};
+    // maps "/partition/name" to the partition index << 16 | collection index.
+    utils::PathIndex file_index{};
 };
 
+auto Device::find_collection(const char* path) const -> const yati::container::CollectionEntry* {
+    u32 value;
+    if (!file_index.Find(path, value)) {
+        return nullptr;
+    }
+
+    return &this->partitions[value >> 16].collections[value & 0xFFFF];
+}
+
+auto Device::find_partition(const char* path) const -> const yati::container::Xci::Partition* {
+    u32 value;
+    if (!dir_index.Find(path, value)) {
+        return nullptr;
+    }
+
+    return &this->partitions[value];
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
-    for (const auto& partition : this->partitions) {
-        for (const auto& collection : partition.collections) {
-            if (path == "/" + partition.name + "/" + collection.name) {
-                file->collection = &collection;
-                return 0;
-            }
-        }
+    if (const auto collection = find_collection(path)) {
+        file->collection = collection;
+        return 0;
     }
 
     log_write("[XCI] devoptab_open: failed to find path: %s\n", path);
@@ -119,11 +150,9 @@ int Device::devoptab_diropen(void* fd, const char *path) {
     if (!std::strcmp(path, "/")) {
         return 0;
     } else {
-        for (const auto& partition : this->partitions) {
-            if (path == "/" + partition.name) {
-                dir->collections = &partition.collections;
-                return 0;
-            }
+        if (const auto partition = find_partition(path)) {
+            dir->collections = &partition->collections;
+            return 0;
         }
     }
 
@@ -178,19 +207,15 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
     if (!std::strcmp(path, "/")) {
         st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
     } else {
-        for (const auto& partition : this->partitions) {
-            if (path == "/" + partition.name) {
-                st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-                return 0;
-            }
+        if (find_partition(path)) {
+            st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
+            return 0;
+        }
 
-            for (const auto& collection : partition.collections) {
-                if (path == "/" + partition.name + "/" + collection.name) {
-                    st->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
-                    st->st_size = collection.size;
-                    return 0;
-                }
-            }
+        if (const auto collection = find_collection(path)) {
+            st->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+            st->st_size = collection->size;
+            return 0;
         }
     }
 
@@ -198,7 +223,7 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
 }
 
 Result MountXciInternal(const std::shared_ptr<yati::source::Base>& source, s64 size, const fs::FsPath& path, fs::FsPath& out_path) {
-    auto buffered = std::make_unique<common::LruBufferedData>(source, size);
+    auto buffered = std::make_unique<common::LruBufferedData>(source, size, "xci");
     yati::container::Xci xci{buffered.get()};
     yati::container::Xci::Root root;
     R_TRY(xci.GetRoot(root));
@@ -220,9 +245,9 @@ Result MountXciInternal(const std::shared_ptr<yati::source::Base>& source, s64 s
 } // namespace
 
 Result MountXci(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
+    std::shared_ptr<yati::source::Base> source;
     s64 size;
-    auto source = std::make_shared<yati::source::File>(fs, path);
-    R_TRY(source->GetSize(&size));
+    R_TRY(yati::source::OpenFile(fs, path, source, &size));
 
     return MountXciInternal(source, size, path, out_path);
 }
@@ -1,5 +1,8 @@
 #include "utils/devoptab.hpp"
 #include "utils/devoptab_common.hpp"
+#include "utils/block_cache.hpp"
+#include "utils/path_index.hpp"
+#include "utils/zip_directory.hpp"
 #include "defines.hpp"
 #include "log.hpp"
 
@@ -10,15 +13,22 @@
 #include <array>
 #include <memory>
 #include <algorithm>
+#include <unordered_map>
 #include <zlib.h>
 
 namespace sphaira::devoptab {
 namespace {
 
 #define LOCAL_HEADER_SIG 0x4034B50
-#define FILE_HEADER_SIG 0x2014B50
 #define DATA_DESCRIPTOR_SIG 0x8074B50
-#define END_RECORD_SIG 0x6054B50
+
+// a checkpoint is saved every this many bytes of inflated output, so that
+// random reads don't need to inflate from the start of the entry.
+constexpr u64 CHECKPOINT_SPAN = 1024 * 1024;
+// size of the deflate window saved with each checkpoint.
+constexpr u64 WINDOW_SIZE = 1024 * 32;
+// size of the scratch buffer used when inflating up to a seek offset.
+constexpr u64 SKIP_BUFFER_SIZE = 1024 * 64;
 
 enum mmz_Flag {
     mmz_Flag_Encrypted = 1 << 0,
@@ -57,70 +67,36 @@ typedef struct mmz_DataDescriptor {
 } mmz_DataDescriptor;
 #pragma pack(pop)
 
-// 46 bytes (0x2E)
-#pragma pack(push,1)
-typedef struct mmz_FileHeader {
-    uint32_t sig;
-    uint16_t version;
-    uint16_t version_needed;
-    uint16_t flags;
-    uint16_t compression;
-    uint16_t modtime;
-    uint16_t moddate;
-    uint32_t crc32;
-    uint32_t compressed_size;
-    uint32_t uncompressed_size;
-    uint16_t filename_len;
-    uint16_t extrafield_len;
-    uint16_t filecomment_len;
-    uint16_t disk_start; // wat
-    uint16_t internal_attr; // wat
-    uint32_t external_attr; // wat
-    uint32_t local_hdr_off;
-} mmz_FileHeader;
-#pragma pack(pop)
-
-#pragma pack(push,1)
-typedef struct mmz_EndRecord {
-    uint32_t sig;
-    uint16_t disk_number;
-    uint16_t disk_wcd;
-    uint16_t disk_entries;
-    uint16_t total_entries;
-    uint32_t central_directory_size;
-    uint32_t file_hdr_off;
-    uint16_t comment_len;
-} mmz_EndRecord;
-#pragma pack(pop)
-
-struct FileEntry {
-    std::string path;
-    u16 flags;
-    u16 compression_type;
-    u16 modtime;
-    u16 moddate;
-    u32 compressed_size; // may be zero.
-    u32 uncompressed_size; // may be zero.
-    u32 local_file_header_off;
+using utils::zip::FileEntry;
+using utils::zip::DirectoryEntry;
+using utils::zip::FileTableEntries;
+
+// zran style restore point at a deflate block boundary.
+// the window is stored in the block cache, so it may be evicted.
+struct Checkpoint {
+    u64 out_off; // offset in the inflated data.
+    u64 in_off; // offset in the compressed data.
+    u64 window_key; // block cache key of the window.
+    u8 bits; // bits of the previous byte that belong to the next block.
+    u8 prev_byte; // the previous byte, only used if bits is set.
 };
 
-struct DirectoryEntry {
-    std::string path;
-    std::vector<DirectoryEntry> dir_child;
-    std::vector<FileEntry> file_child;
+// checkpoints of a deflated entry, built as the entry is inflated.
+struct ZipIndex {
+    std::vector<Checkpoint> points;
 };
 
-using FileTableEntries = std::vector<FileEntry>;
-
 struct Zfile {
     z_stream z; // zlib stream.
     Bytef* buffer; // buffer that compressed data is read into.
     size_t buffer_size; // size of the above buffer.
     size_t compressed_off; // offset of the compressed file.
+    size_t out_off; // offset of the stream in the inflated data.
 };
 
 struct File {
     const FileEntry* entry;
+    ZipIndex* index; // only used if the file is compressed.
     Zfile zfile; // only used if the file is compressed.
     size_t data_off; // offset of the file data.
     size_t off;
@@ -131,39 +107,17 @@ struct Dir {
     u32 index;
 };
 
-const FileEntry* find_file_entry(const DirectoryEntry& dir, std::string_view path) {
-    if (path.starts_with(dir.path)) {
-        // todo: check if / comes after file name in order to only check dirs.
-        for (const auto& e : dir.file_child) {
-            if (e.path == path) {
-                return &e;
-            }
-        }
+// flattens the tree so that entries can be found by path.
+void build_path_table(const DirectoryEntry& dir, std::vector<const DirectoryEntry*>& dirs, std::vector<const FileEntry*>& files) {
+    dirs.emplace_back(&dir);
 
-        for (const auto& e : dir.dir_child) {
-            if (auto entry = find_file_entry(e, path)) {
-                return entry;
-            }
-        }
+    for (const auto& e : dir.file_child) {
+        files.emplace_back(&e);
     }
 
-    return nullptr;
-}
-
-const DirectoryEntry* find_dir_entry(const DirectoryEntry& dir, std::string_view path) {
-    if (dir.path == path) {
-        return &dir;
+    for (const auto& e : dir.dir_child) {
+        build_path_table(e, dirs, files);
     }
-
-    if (path.starts_with(dir.path)) {
-        for (const auto& e : dir.dir_child) {
-            if (auto entry = find_dir_entry(e, path)) {
-                return entry;
-            }
-        }
-    }
-
-    return nullptr;
 }
 
 void set_stat_file(const FileEntry* entry, struct stat *st) {
@@ -190,8 +144,23 @@ struct Device final : common::MountDevice {
     Device(std::unique_ptr<common::LruBufferedData>&& _source, const DirectoryEntry& _root, const common::MountConfig& _config)
     : MountDevice{_config}
     , source{std::forward<decltype(_source)>(_source)}
-    , root{_root} {
+    , root{_root}
+    , cache_id{utils::block_cache::Register("zip index")} {
+        build_path_table(this->root, dir_table, file_table);
 
+        dir_index.Reserve(dir_table.size());
+        for (u32 i = 0; i < dir_table.size(); i++) {
+            dir_index.Add(dir_table[i]->path, i);
+        }
+
+        file_index.Reserve(file_table.size());
+        for (u32 i = 0; i < file_table.size(); i++) {
+            file_index.Add(file_table[i]->path, i);
+        }
+    }
+
+    ~Device() {
+        utils::block_cache::Unregister(cache_id);
     }
 
 private:
@@ -207,15 +176,212 @@ private:
     int devoptab_dirclose(void* fd) override;
     int devoptab_lstat(const char *path, struct stat *st) override;
 
+    ssize_t zip_inflate(File* file, void* out, size_t len);
+    void zip_add_checkpoint(File* file);
+    bool zip_restore_checkpoint(File* file, const Checkpoint& point);
+    int zip_seek_stream(File* file, u64 off);
+
+    auto find_file_entry(std::string_view path) const -> const FileEntry*;
+    auto find_dir_entry(std::string_view path) const -> const DirectoryEntry*;
+
 private:
     std::unique_ptr<common::LruBufferedData> source;
     const DirectoryEntry root;
+    // flattened tree, indexed by path, both point into root.
+    std::vector<const DirectoryEntry*> dir_table{};
+    std::vector<const FileEntry*> file_table{};
+    utils::PathIndex dir_index{};
+    utils::PathIndex file_index{};
+    // keyed by the local header offset, as it's unique per entry.
+    std::unordered_map<u32, ZipIndex> indexes{};
+    const u32 cache_id;
+    u64 next_window_key{};
 };
 
+auto Device::find_file_entry(std::string_view path) const -> const FileEntry* {
+    u32 index;
+    if (!file_index.Find(path, index)) {
+        return nullptr;
+    }
+
+    return file_table[index];
+}
+
+auto Device::find_dir_entry(std::string_view path) const -> const DirectoryEntry* {
+    u32 index;
+    if (!dir_index.Find(path, index)) {
+        return nullptr;
+    }
+
+    return dir_table[index];
+}
+
+// inflates up to len bytes into out, saving checkpoints along the way.
+ssize_t Device::zip_inflate(File* file, void* out, size_t len) {
+    auto& zfile = file->zfile;
+    zfile.z.next_out = (Bytef*)out;
+    zfile.z.avail_out = len;
+
+    while (zfile.z.avail_out) {
+        // check if we need to fetch more data.
+        if (!zfile.z.next_in || !zfile.z.avail_in) {
+            const auto clen = std::min(zfile.buffer_size, file->entry->compressed_size - zfile.compressed_off);
+            if (!clen) {
+                break;
+            }
+
+            if (R_FAILED(this->source->Read2(zfile.buffer, file->data_off + zfile.compressed_off, clen))) {
+                return -ENOENT;
+            }
+
+            zfile.compressed_off += clen;
+            zfile.z.next_in = zfile.buffer;
+            zfile.z.avail_in = clen;
+        }
+
+        // Z_BLOCK returns at each block boundary, which is where checkpoints can be made.
+        const auto avail_out = zfile.z.avail_out;
+        const auto rc = inflate(&zfile.z, Z_BLOCK);
+        zfile.out_off += avail_out - zfile.z.avail_out;
+
+        if (Z_STREAM_END == rc) {
+            break;
+        } else if (Z_OK != rc) {
+            log_write("[ZLIB] failed to inflate: %d %s\n", rc, zfile.z.msg);
+            return -ENOENT;
+        }
+
+        // end of a block, but not the last block.
+        if ((zfile.z.data_type & 128) && !(zfile.z.data_type & 64)) {
+            zip_add_checkpoint(file);
+        }
+    }
+
+    return len - zfile.z.avail_out;
+}
+
+void Device::zip_add_checkpoint(File* file) {
+    auto& zfile = file->zfile;
+    auto& points = file->index->points;
+
+    // only extend the index, earlier ranges were already covered.
+    const auto last_off = points.empty() ? 0 : points.back().out_off;
+    if (zfile.out_off < last_off + CHECKPOINT_SPAN) {
+        return;
+    }
+
+    // the partial byte must still be in the buffer.
+    const auto bits = zfile.z.data_type & 7;
+    if (bits && zfile.z.next_in == zfile.buffer) {
+        return;
+    }
+
+    std::vector<u8> window(WINDOW_SIZE);
+    uInt window_size = window.size();
+    if (Z_OK != inflateGetDictionary(&zfile.z, window.data(), &window_size)) {
+        return;
+    }
+    window.resize(window_size);
+
+    Checkpoint point{};
+    point.out_off = zfile.out_off;
+    point.in_off = zfile.compressed_off - zfile.z.avail_in;
+    point.window_key = next_window_key++;
+    point.bits = bits;
+    point.prev_byte = bits ? zfile.z.next_in[-1] : 0;
+
+    utils::block_cache::Insert(cache_id, point.window_key * WINDOW_SIZE, WINDOW_SIZE, std::move(window));
+    points.emplace_back(point);
+}
+
+bool Device::zip_restore_checkpoint(File* file, const Checkpoint& point) {
+    std::vector<u8> window(WINDOW_SIZE);
+    u64 window_size;
+    if (!utils::block_cache::Read(cache_id, point.window_key * WINDOW_SIZE, WINDOW_SIZE, window.data(), 0, window.size(), &window_size)) {
+        return false;
+    }
+
+    auto& zfile = file->zfile;
+    if (Z_OK != inflateReset(&zfile.z)) {
+        return false;
+    }
+
+    if (point.bits && Z_OK != inflatePrime(&zfile.z, point.bits, point.prev_byte >> (8 - point.bits))) {
+        return false;
+    }
+
+    if (Z_OK != inflateSetDictionary(&zfile.z, window.data(), window_size)) {
+        return false;
+    }
+
+    zfile.z.next_in = nullptr;
+    zfile.z.avail_in = 0;
+    zfile.compressed_off = point.in_off;
+    zfile.out_off = point.out_off;
+    return true;
+}
+
+// moves the stream to off, from the closest checkpoint if possible.
+int Device::zip_seek_stream(File* file, u64 off) {
+    auto& zfile = file->zfile;
+    const auto& points = file->index->points;
+
+    // find the last checkpoint at or before off that is still cached.
+    auto it = std::upper_bound(points.begin(), points.end(), off, [](u64 value, const Checkpoint& point) {
+        return value < point.out_off;
+    });
+
+    // only restore if it's behind us, or closer than the current position.
+    bool positioned{};
+    while (it != points.begin()) {
+        --it;
+        if (off >= zfile.out_off && it->out_off <= zfile.out_off) {
+            positioned = true;
+            break;
+        }
+
+        if (zip_restore_checkpoint(file, *it)) {
+            positioned = true;
+            break;
+        }
+    }
+
+    // no usable checkpoint, so start over.
+    if (!positioned && off < zfile.out_off) {
+        if (Z_OK != inflateReset(&zfile.z)) {
+            return -ENOENT;
+        }
+
+        zfile.z.next_in = nullptr;
+        zfile.z.avail_in = 0;
+        zfile.compressed_off = 0;
+        zfile.out_off = 0;
+    }
+
+    // inflate up to the offset, which also extends the index.
+    std::vector<u8> skip_buf;
+    while (zfile.out_off < off) {
+        if (skip_buf.empty()) {
+            skip_buf.resize(SKIP_BUFFER_SIZE);
+        }
+
+        const auto ret = zip_inflate(file, skip_buf.data(), std::min<u64>(skip_buf.size(), off - zfile.out_off));
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (!ret) {
+            return -ENOENT;
+        }
+    }
+
+    return 0;
+}
+
 int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mode) {
     auto file = static_cast<File*>(fileStruct);
 
-    const auto entry = find_file_entry(this->root, path);
+    const auto entry = find_file_entry(path);
     if (!entry) {
         return -ENOENT;
     }
@@ -274,6 +440,9 @@ int Device::devoptab_open(void *fileStruct, const char *path, int flags, int mod
 
     file->entry = entry;
     file->data_off = offset;
+    if (entry->compression_type == mmz_Compression_Deflate) {
+        file->index = &this->indexes[entry->local_file_header_off];
+    }
     return 0;
 }
 
@@ -304,34 +473,19 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
             return -ENOENT;
         }
     } else if (file->entry->compression_type == mmz_Compression_Deflate) {
-        auto& zfile = file->zfile;
-        zfile.z.next_out = (Bytef*)ptr;
-        zfile.z.avail_out = len;
-
-        // run until we have inflated enough data.
-        while (zfile.z.avail_out) {
-            // check if we need to fetch more data.
-            if (!zfile.z.next_in || !zfile.z.avail_in) {
-                const auto clen = std::min(zfile.buffer_size, file->entry->compressed_size - zfile.compressed_off);
-                if (R_FAILED(this->source->Read2(zfile.buffer, file->data_off + zfile.compressed_off, clen))) {
-                    return -ENOENT;
-                }
-
-                zfile.compressed_off += clen;
-                zfile.z.next_in = zfile.buffer;
-                zfile.z.avail_in = clen;
+        // the stream is only moved once the data is actually needed.
+        if (file->zfile.out_off != file->off) {
+            if (const auto ret = zip_seek_stream(file, file->off); ret < 0) {
+                return ret;
             }
+        }
 
-            const auto rc = inflate(&zfile.z, Z_SYNC_FLUSH);
-            if (Z_OK != rc) {
-                if (Z_STREAM_END == rc) {
-                    len -= zfile.z.avail_out;
-                } else {
-                    log_write("[ZLIB] failed to inflate: %d %s\n", rc, zfile.z.msg);
-                    return -ENOENT;
-                }
-            }
+        const auto ret = zip_inflate(file, ptr, len);
+        if (ret < 0) {
+            return ret;
         }
+
+        len = ret;
     }
 
     file->off += len;
@@ -341,32 +495,11 @@ ssize_t Device::devoptab_read(void *fd, char *ptr, size_t len) {
 ssize_t Device::devoptab_seek(void *fd, off_t pos, int dir) {
     auto file = static_cast<File*>(fd);
 
-    // seek like normal.
-    if (file->entry->compression_type == mmz_Compression_None) {
-        if (dir == SEEK_CUR) {
-            pos += file->off;
-        } else if (dir == SEEK_END) {
-            pos = file->entry->uncompressed_size;
-        }
-    } else if (file->entry->compression_type == mmz_Compression_Deflate) {
-        // limited seek options.
-        // todo: support seeking to end and then back to orig position.
-        if (dir == SEEK_SET) {
-            if (pos == 0) {
-                inflateReset(&file->zfile.z);
-            } else if (pos != file->off) {
-                // seeking to the end is fine as it may be used to calc size.
-                if (pos != file->entry->uncompressed_size) {
-                    // random access seek is not supported.
-                    pos = file->off;
-                }
-            }
-        } else if (dir == SEEK_CUR) {
-            // random access seek is not supported.
-            pos = file->off;
-        } else if (dir == SEEK_END) {
-            pos = file->entry->uncompressed_size;
-        }
+    // deflated entries are moved to the new offset on the next read.
+    if (dir == SEEK_CUR) {
+        pos += file->off;
+    } else if (dir == SEEK_END) {
+        pos = file->entry->uncompressed_size;
     }
 
     return file->off = std::clamp<u64>(pos, 0, file->entry->uncompressed_size);
@@ -382,7 +515,7 @@ int Device::devoptab_fstat(void *fd, struct stat *st) {
 int Device::devoptab_diropen(void* fd, const char *path) {
     auto dir = static_cast<Dir*>(fd);
 
-    const auto entry = find_dir_entry(this->root, path);
+    const auto entry = find_dir_entry(path);
     if (!entry) {
         return -ENOENT;
     }
@@ -437,9 +570,9 @@ int Device::devoptab_dirclose(void* fd) {
 int Device::devoptab_lstat(const char *path, struct stat *st) {
     st->st_nlink = 1;
 
-    if (find_dir_entry(this->root, path)) {
+    if (find_dir_entry(path)) {
         st->st_mode = S_IFDIR | S_IRUSR | S_IRGRP | S_IROTH;
-    } else if (auto entry = find_file_entry(this->root, path)) {
+    } else if (auto entry = find_file_entry(path)) {
         set_stat_file(entry, st);
     } else {
         log_write("[ZIP] didn't find in lstat\n");
@@ -449,119 +582,6 @@ int Device::devoptab_lstat(const char *path, struct stat *st) {
     return 0;
 }
 
-auto BuildPath(const std::string& path) -> std::string {
-    if (path.starts_with('/')) {
-        return path;
-    }
-    return "/" + path;
-}
-
-void Parse(const FileTableEntries& entries, u32& index, DirectoryEntry& out) {
-    for (; index < entries.size(); index++) {
-        const auto path = BuildPath(entries[index].path);
-
-        // check if this path belongs to this dir.
-        if (!path.starts_with(out.path)) {
-            return;
-        }
-
-        if (path.ends_with('/')) {
-            auto& new_entry = out.dir_child.emplace_back();
-            new_entry.path = path.substr(0, path.length() - 1);
-
-            u32 new_index = index + 1;
-            Parse(entries, new_index, new_entry);
-            index = new_index - 1;
-        } else {
-            // check if this file actually belongs to this folder.
-            const auto idx = path.find_first_of('/', out.path.length() + 1);
-            const auto sub = path.substr(0, idx);
-
-            if (idx != path.npos && out.path != sub) {
-                auto& new_entry = out.dir_child.emplace_back();
-                new_entry.path = sub;
-                Parse(entries, index, new_entry);
-            } else {
-                auto& new_entry = out.file_child.emplace_back(entries[index]);
-                new_entry.path = path;
-            }
-        }
-    }
-}
-
-void Parse(const FileTableEntries& entries, DirectoryEntry& out) {
-    u32 index = 0;
-    out.path = "/"; // add root folder.
-    Parse(entries, index, out);
-}
-
-Result find_central_dir_offset(common::LruBufferedData* source, s64 size, mmz_EndRecord* record) {
-    // check if the record is at the end (no extra header).
-    auto offset = size - sizeof(*record);
-    R_TRY(source->Read2(record, offset, sizeof(*record)));
-
-    if (record->sig == END_RECORD_SIG) {
-        R_SUCCEED();
-    }
-
-    // failed, find the sig by reading the last 64k and loop across it.
-    const auto rsize = std::min<u64>(UINT16_MAX, size);
-    offset = size - rsize;
-    std::vector<u8> data(rsize);
-    R_TRY(source->Read2(data.data(), offset, data.size()));
-
-    // check in reverse order as it's more likely at the end.
-    for (s64 i = data.size() - sizeof(*record); i >= 0; i--) {
-        u32 sig;
-        std::memcpy(&sig, data.data() + i, sizeof(sig));
-        if (sig == END_RECORD_SIG) {
-            std::memcpy(record, data.data() + i, sizeof(*record));
-            R_SUCCEED();
-        }
-    }
-
-    R_THROW(0x1);
-}
-
-Result ParseZip(common::LruBufferedData* source, s64 size, FileTableEntries& out) {
-    mmz_EndRecord end_rec;
-    R_TRY(find_central_dir_offset(source, size, &end_rec));
-
-    out.reserve(end_rec.total_entries);
-    auto file_header_off = end_rec.file_hdr_off;
-
-    for (u16 i = 0; i < end_rec.total_entries; i++) {
-        // read the file header.
-        mmz_FileHeader file_hdr{};
-        R_TRY(source->Read2(&file_hdr, file_header_off, sizeof(file_hdr)));
-
-        if (file_hdr.sig != FILE_HEADER_SIG) {
-            log_write("[ZIP] invalid file record\n");
-            R_THROW(0x1);
-        }
-
-        // save all the data hat we care about.
-        auto& new_entry = out.emplace_back();
-        new_entry.flags = file_hdr.flags;
-        new_entry.compression_type = file_hdr.compression;
-        new_entry.modtime = file_hdr.modtime;
-        new_entry.moddate = file_hdr.moddate;
-        new_entry.compressed_size = file_hdr.compressed_size;
-        new_entry.uncompressed_size = file_hdr.uncompressed_size;
-        new_entry.local_file_header_off = file_hdr.local_hdr_off;
-
-        // read the file name.
-        const auto filename_off = file_header_off + sizeof(file_hdr);
-        new_entry.path.resize(file_hdr.filename_len);
-        R_TRY(source->Read2(new_entry.path.data(), filename_off, new_entry.path.size()));
-
-        // advance the offset.
-        file_header_off += sizeof(file_hdr) + file_hdr.filename_len + file_hdr.extrafield_len + file_hdr.filecomment_len;
-    }
-
-    R_SUCCEED();
-}
-
 } // namespace
 
 Result MountZip(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
@@ -569,14 +589,14 @@ Result MountZip(fs::Fs* fs, const fs::FsPath& path, fs::FsPath& out_path) {
 
     s64 size;
     R_TRY(source->GetSize(&size));
-    auto buffered = std::make_unique<common::LruBufferedData>(source, size);
+    auto buffered = std::make_unique<common::LruBufferedData>(source, size, "zip");
 
     FileTableEntries table_entries;
-    R_TRY(ParseZip(buffered.get(), size, table_entries));
+    R_TRY(utils::zip::ParseCentralDirectory(buffered.get(), size, table_entries));
     log_write("[ZIP] parsed zip\n");
 
     DirectoryEntry root;
-    Parse(table_entries, root);
+    utils::zip::BuildTree(table_entries, root);
 
     if (!common::MountReadOnlyIndexDevice(
         [&buffered, &root](const common::MountConfig& config) {
@@ -0,0 +1,410 @@
+#include "utils/ini_store.hpp"
+#include "fs.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+
+#include <minIni.h>
+#include <algorithm>
+#include <strings.h>
+#include <cstdio>
+
+namespace sphaira::utils::ini {
+namespace {
+
+constexpr std::string_view WHITESPACE{" \t\r\n"};
+
+auto Trim(std::string_view str) -> std::string_view {
+    const auto start = str.find_first_not_of(WHITESPACE);
+    if (start == str.npos) {
+        return {};
+    }
+
+    const auto end = str.find_last_not_of(WHITESPACE);
+    return str.substr(start, end - start + 1);
+}
+
+auto IsEqual(std::string_view a, std::string_view b) -> bool {
+    return a.size() == b.size() && !strncasecmp(a.data(), b.data(), a.size());
+}
+
+// same rules as minIni, a quoted value is kept as is, otherwise anything
+// after a comment is removed.
+auto CleanValue(std::string_view value) -> std::string_view {
+    value = Trim(value);
+    if (value.size() >= 2 && value.front() == '"') {
+        if (const auto end = value.find('"', 1); end != value.npos) {
+            return value.substr(1, end - 1);
+        }
+    }
+
+    if (const auto comment = value.find_first_of(";#"); comment != value.npos) {
+        value = Trim(value.substr(0, comment));
+    }
+
+    return value;
+}
+
+auto NeedsQuotes(std::string_view value) -> bool {
+    if (value.empty()) {
+        return false;
+    }
+
+    return value.find_first_of(";#") != value.npos || value.front() == '"' ||
+        WHITESPACE.find(value.front()) != WHITESPACE.npos ||
+        WHITESPACE.find(value.back()) != WHITESPACE.npos;
+}
+
+// returns the comment at the end of a key line, if any.
+auto GetComment(std::string_view line) -> std::string_view {
+    line = Trim(line);
+    auto value = line.substr(line.find_first_of("=:") + 1);
+    value = Trim(value);
+
+    size_t start{};
+    if (value.size() >= 2 && value.front() == '"') {
+        if (const auto end = value.find('"', 1); end != value.npos) {
+            start = end + 1;
+        }
+    }
+
+    const auto comment = value.find_first_of(";#", start);
+    return comment == value.npos ? std::string_view{} : value.substr(comment);
+}
+
+auto FormatLine(std::string_view name, std::string_view value) -> std::string {
+    std::string out{name};
+    out += '=';
+    if (NeedsQuotes(value)) {
+        out += '"';
+        out += value;
+        out += '"';
+    } else {
+        out += value;
+    }
+    return out;
+}
+
+} // namespace
+
+Store::Store(const char* path) : m_path{path} {
+    mutexInit(&m_mutex);
+    mutexInit(&m_flush_mutex);
+}
+
+bool Store::Get(std::string_view section, std::string_view key, std::string& out) {
+    SCOPED_MUTEX(&m_mutex);
+    LoadInternal();
+
+    if (auto e = FindKey(section, key)) {
+        out = e->value;
+        return true;
+    }
+
+    return false;
+}
+
+auto Store::GetString(std::string_view section, std::string_view key, std::string_view def) -> std::string {
+    std::string out;
+    if (!Get(section, key, out)) {
+        out = def;
+    }
+    return out;
+}
+
+auto Store::GetLong(std::string_view section, std::string_view key, long def) -> long {
+    std::string out;
+    if (!Get(section, key, out)) {
+        return def;
+    }
+    return ini_parse_getl(out.c_str(), def);
+}
+
+auto Store::GetBool(std::string_view section, std::string_view key, bool def) -> bool {
+    std::string out;
+    if (!Get(section, key, out)) {
+        return def;
+    }
+    return ini_parse_getbool(out.c_str(), def);
+}
+
+bool Store::Has(std::string_view section, std::string_view key) {
+    SCOPED_MUTEX(&m_mutex);
+    LoadInternal();
+    return FindKey(section, key);
+}
+
+void Store::Set(std::string_view section, std::string_view key, std::string_view value) {
+    SCOPED_MUTEX(&m_mutex);
+    LoadInternal();
+
+    if (auto e = FindKey(section, key)) {
+        if (e->value == value) {
+            return;
+        }
+        e->value = value;
+
+        // only the line of the key is rewritten, keeping any comment and a
+        // windows line ending.
+        auto& line = m_chunks[e->chunk].lines[e->line];
+        const auto cr = !line.empty() && line.back() == '\r';
+        const std::string comment{GetComment(line)};
+        line = FormatLine(e->name, value);
+        if (!comment.empty()) {
+            line += ' ';
+            line += comment;
+        }
+        if (cr) {
+            line += '\r';
+        }
+    } else {
+        auto s = FindSection(section);
+        if (!s) {
+            // keys without a section have to be written before any section.
+            if (section.empty()) {
+                s = &*m_sections.emplace(m_sections.begin(), std::string{}, std::vector<Key>{}, 0);
+            } else {
+                // keep a blank line between sections.
+                auto& last = m_chunks.back().lines;
+                if (!last.empty() && !Trim(last.back()).empty()) {
+                    last.emplace_back();
+                }
+
+                m_chunks.emplace_back(std::vector<std::string>{"[" + std::string{section} + "]"}, 1);
+                s = &m_sections.emplace_back(std::string{section}, std::vector<Key>{}, m_chunks.size() - 1);
+            }
+        }
+
+        // lines after insert_pos are never keys, so the lines of the other keys don't move.
+        auto& c = m_chunks[s->chunk];
+        const auto line = c.insert_pos++;
+        c.lines.emplace(c.lines.begin() + line, FormatLine(key, value));
+        s->keys.emplace_back(std::string{key}, std::string{value}, s->chunk, line);
+    }
+
+    m_dirty = true;
+    m_last_set_tick = armGetSystemTick();
+}
+
+void Store::SetLong(std::string_view section, std::string_view key, long value) {
+    Set(section, key, std::to_string(value));
+}
+
+void Store::Browse(const BrowseCallback& cb) {
+    SCOPED_MUTEX(&m_mutex);
+    LoadInternal();
+
+    for (const auto& s : m_sections) {
+        for (const auto& e : s.keys) {
+            if (!cb(s.name.c_str(), e.name.c_str(), e.value.c_str())) {
+                return;
+            }
+        }
+    }
+}
+
+bool Store::IsDirty() {
+    SCOPED_MUTEX(&m_mutex);
+    return m_dirty;
+}
+
+bool Store::IsDirtyAndIdle(u64 idle_ns) {
+    SCOPED_MUTEX(&m_mutex);
+    return m_dirty && armTicksToNs(armGetSystemTick() - m_last_set_tick) >= idle_ns;
+}
+
+Result Store::Flush() {
+    SCOPED_MUTEX(&m_flush_mutex);
+
+    std::string data;
+    {
+        SCOPED_MUTEX(&m_mutex);
+        if (!m_dirty) {
+            R_SUCCEED();
+        }
+
+        data = Serialise();
+        m_dirty = false;
+    }
+
+    const auto rc = Write(data);
+    if (R_FAILED(rc)) {
+        SCOPED_MUTEX(&m_mutex);
+        m_dirty = true;
+    }
+
+    return rc;
+}
+
+Result Store::Write(const std::string& data) {
+    Result rc;
+    fs::FsNativeSd fs;
+    const fs::FsPath path{m_path};
+    fs::FsPath tmp_path;
+    std::snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", m_path.c_str());
+
+    fs.CreateDirectoryRecursivelyWithPath(path);
+    fs.DeleteFile(tmp_path);
+
+    // the old file is only removed once the new one is fully written.
+    {
+        if (R_FAILED(rc = fs.CreateFile(tmp_path, data.size(), 0))) {
+            log_write("[INI] failed to create: %s 0x%X\n", tmp_path.s, rc);
+            return rc;
+        }
+
+        fs::File f;
+        if (R_FAILED(rc = fs.OpenFile(tmp_path, FsOpenMode_Write, &f))) {
+            log_write("[INI] failed to open: %s 0x%X\n", tmp_path.s, rc);
+            return rc;
+        }
+
+        if (R_FAILED(rc = f.Write(0, data.data(), data.size(), FsWriteOption_Flush))) {
+            log_write("[INI] failed to write: %s 0x%X\n", tmp_path.s, rc);
+            return rc;
+        }
+    }
+
+    fs.DeleteFile(path);
+    if (R_FAILED(rc = fs.RenameFile(tmp_path, path))) {
+        log_write("[INI] failed to rename: %s -> %s 0x%X\n", tmp_path.s, path.s, rc);
+        return rc;
+    }
+
+    log_write("[INI] saved: %s size: %zu\n", path.s, data.size());
+    R_SUCCEED();
+}
+
+void Store::LoadInternal() {
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    fs::FsNativeSd fs;
+    const fs::FsPath path{m_path};
+    fs::FsPath tmp_path;
+    std::snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", m_path.c_str());
+
+    // a tmp file is only left behind if a flush was interrupted.
+    // if the old file was already deleted then the tmp file is complete, otherwise
+    // the old file is still intact and the tmp file may not be.
+    if (fs.FileExists(tmp_path)) {
+        if (fs.FileExists(path)) {
+            fs.DeleteFile(tmp_path);
+        } else {
+            log_write("[INI] recovering: %s\n", tmp_path.s);
+            fs.RenameFile(tmp_path, path);
+        }
+    }
+
+    // the lines before the first section.
+    m_chunks.emplace_back(std::vector<std::string>{}, 0);
+
+    std::vector<u8> data;
+    if (R_SUCCEEDED(fs.read_entire_file(path, data))) {
+        Parse({(const char*)data.data(), data.size()});
+    }
+}
+
+void Store::Parse(std::string_view data) {
+    Section* section{};
+
+    while (!data.empty()) {
+        const auto end = data.find('\n');
+        const auto raw = data.substr(0, end);
+        const auto line = Trim(raw);
+        data = end == data.npos ? std::string_view{} : data.substr(end + 1);
+
+        // every line is kept, lines that aren't keys are written back as is.
+        const u32 chunk_index = m_chunks.size() - 1;
+        auto& chunk = m_chunks.back();
+        const u32 line_index = chunk.lines.size();
+        chunk.lines.emplace_back(raw);
+
+        if (line.empty() || line.front() == ';' || line.front() == '#') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            const auto close = line.find(']');
+            if (close == line.npos) {
+                continue;
+            }
+
+            // the header starts a new chunk.
+            chunk.lines.pop_back();
+            m_chunks.emplace_back(std::vector<std::string>{std::string{raw}}, 1);
+
+            const auto name = Trim(line.substr(1, close - 1));
+            section = FindSection(name);
+            if (!section) {
+                section = &m_sections.emplace_back(std::string{name}, std::vector<Key>{}, 0);
+            }
+            section->chunk = m_chunks.size() - 1;
+            continue;
+        }
+
+        // minIni accepts either '=' or ':', whichever comes first.
+        const auto sep = line.find_first_of("=:");
+        if (sep == line.npos) {
+            continue;
+        }
+
+        const auto name = Trim(line.substr(0, sep));
+        const auto value = CleanValue(line.substr(sep + 1));
+
+        // keys before the first section are in the unnamed section.
+        if (!section) {
+            section = FindSection("");
+            if (!section) {
+                section = &m_sections.emplace_back(std::string{}, std::vector<Key>{}, 0);
+            }
+        }
+
+        // same as minIni, the first key wins.
+        const auto it = std::ranges::find_if(section->keys, [name](auto& e) {
+            return IsEqual(e.name, name);
+        });
+
+        if (it == section->keys.end()) {
+            section->keys.emplace_back(std::string{name}, std::string{value}, chunk_index, line_index);
+            chunk.insert_pos = line_index + 1;
+        }
+    }
+}
+
+auto Store::FindSection(std::string_view section) -> Section* {
+    const auto it = std::ranges::find_if(m_sections, [section](auto& e) {
+        return IsEqual(e.name, section);
+    });
+
+    return it == m_sections.end() ? nullptr : &*it;
+}
+
+auto Store::FindKey(std::string_view section, std::string_view key) -> Key* {
+    auto s = FindSection(section);
+    if (!s) {
+        return nullptr;
+    }
+
+    const auto it = std::ranges::find_if(s->keys, [key](auto& e) {
+        return IsEqual(e.name, key);
+    });
+
+    return it == s->keys.end() ? nullptr : &*it;
+}
+
+auto Store::Serialise() const -> std::string {
+    std::string out;
+
+    for (const auto& c : m_chunks) {
+        for (const auto& line : c.lines) {
+            out += line;
+            out += '\n';
+        }
+    }
+
+    return out;
+}
+
+} // namespace sphaira::utils::ini
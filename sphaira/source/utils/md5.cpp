@@ -0,0 +1,143 @@
+#include "utils/md5.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace sphaira::utils {
+namespace {
+
+constexpr u32 K[64]{
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+constexpr int S[4][4]{
+    { 7, 12, 17, 22 },
+    { 5, 9, 14, 20 },
+    { 4, 11, 16, 23 },
+    { 6, 10, 15, 21 },
+};
+
+// the functions are written so that they need the fewest instructions.
+template<int Round>
+inline auto Func(u32 b, u32 c, u32 d) -> u32 {
+    if constexpr (Round == 0) {
+        return d ^ (b & (c ^ d));
+    } else if constexpr (Round == 1) {
+        return c ^ (d & (b ^ c));
+    } else if constexpr (Round == 2) {
+        return b ^ c ^ d;
+    } else {
+        return c ^ (b | ~d);
+    }
+}
+
+template<int Round>
+constexpr auto MessageIndex(int i) -> int {
+    if constexpr (Round == 0) {
+        return i;
+    } else if constexpr (Round == 1) {
+        return (5 * i + 1) % 16;
+    } else if constexpr (Round == 2) {
+        return (3 * i + 5) % 16;
+    } else {
+        return (7 * i) % 16;
+    }
+}
+
+template<int Round>
+inline void DoRound(u32& a, u32& b, u32& c, u32& d, const u32* x) {
+    #pragma GCC unroll 16
+    for (int i = 0; i < 16; i++) {
+        const auto t = a + Func<Round>(b, c, d) + x[MessageIndex<Round>(i)] + K[Round * 16 + i];
+        a = d;
+        d = c;
+        c = b;
+        b += std::rotl(t, S[Round][i % 4]);
+    }
+}
+
+} // namespace
+
+void Md5::ProcessBlocks(const u8* data, u64 count) {
+    auto a = m_state[0];
+    auto b = m_state[1];
+    auto c = m_state[2];
+    auto d = m_state[3];
+
+    for (u64 i = 0; i < count; i++, data += 64) {
+        // the switch is little endian, so the block can be used as is.
+        u32 x[16];
+        std::memcpy(x, data, sizeof(x));
+
+        const auto aa = a, bb = b, cc = c, dd = d;
+        DoRound<0>(a, b, c, d, x);
+        DoRound<1>(a, b, c, d, x);
+        DoRound<2>(a, b, c, d, x);
+        DoRound<3>(a, b, c, d, x);
+        a += aa;
+        b += bb;
+        c += cc;
+        d += dd;
+    }
+
+    m_state[0] = a;
+    m_state[1] = b;
+    m_state[2] = c;
+    m_state[3] = d;
+}
+
+void Md5::Update(const void* _data, u64 size) {
+    auto data = static_cast<const u8*>(_data);
+    m_size += size;
+
+    // fill the partial block first.
+    if (m_buf_size) {
+        const auto copy = std::min<u64>(size, sizeof(m_buf) - m_buf_size);
+        std::memcpy(m_buf + m_buf_size, data, copy);
+        m_buf_size += copy;
+        data += copy;
+        size -= copy;
+
+        if (m_buf_size < sizeof(m_buf)) {
+            return;
+        }
+
+        ProcessBlocks(m_buf, 1);
+        m_buf_size = 0;
+    }
+
+    if (const auto count = size / 64) {
+        ProcessBlocks(data, count);
+        data += count * 64;
+        size -= count * 64;
+    }
+
+    if (size) {
+        std::memcpy(m_buf, data, size);
+        m_buf_size = size;
+    }
+}
+
+void Md5::GetHash(u8 out[HASH_SIZE]) {
+    const u64 bits = m_size * 8;
+
+    // pad with 0x80, then zeros until 8 bytes are left in the block.
+    u8 pad[72]{0x80};
+    const auto pad_size = (m_buf_size < 56 ? 56 : 120) - m_buf_size;
+    Update(pad, pad_size);
+
+    u8 len[8];
+    std::memcpy(len, &bits, sizeof(len));
+    Update(len, sizeof(len));
+
+    std::memcpy(out, m_state, HASH_SIZE);
+}
+
+} // namespace sphaira::utils
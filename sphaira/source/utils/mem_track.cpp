@@ -0,0 +1,224 @@
+#include "utils/mem_track.hpp"
+#include "log.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <malloc.h>
+#include <new>
+
+namespace sphaira::utils::mem {
+namespace {
+
+constexpr const char* TAG_NAMES[] = {
+    "other", "transfer", "cache", "image", "curl", "zstd",
+};
+static_assert(std::size(TAG_NAMES) == Tag_MAX);
+
+// placed before each allocation, the size keeps the returned pointer aligned
+// the same as malloc.
+struct Header {
+    u64 size;
+    u32 tag;
+    u32 pad;
+};
+static_assert(sizeof(Header) == alignof(std::max_align_t));
+
+struct Counter {
+    std::atomic<s64> current{};
+    std::atomic<s64> peak{};
+    std::atomic<u64> allocs{};
+    std::atomic<u64> failed{};
+};
+
+Counter g_counters[Tag_MAX]{};
+// set whilst logging so that a failure inside log_write() doesn't recurse.
+std::atomic_bool g_in_log{};
+
+thread_local Tag t_tag{Tag_Other};
+
+auto ToHeader(void* ptr) -> Header* {
+    return static_cast<Header*>(ptr) - 1;
+}
+
+void OnFailed(Tag tag, std::size_t size) {
+    g_counters[tag].failed++;
+
+    if (!g_in_log.exchange(true)) {
+        log_write("[MEM] failed to allocate: %zu bytes tag: %s\n", size, TAG_NAMES[tag]);
+        LogStats("allocation failed");
+        g_in_log = false;
+    }
+}
+
+} // namespace
+
+void Add(Tag tag, u64 size) {
+    auto& counter = g_counters[tag];
+    const auto current = counter.current += size;
+    counter.allocs++;
+
+    auto peak = counter.peak.load();
+    while (current > peak && !counter.peak.compare_exchange_weak(peak, current)) {
+    }
+}
+
+void Remove(Tag tag, u64 size) {
+    g_counters[tag].current -= size;
+}
+
+auto GetTag() -> Tag {
+    return t_tag;
+}
+
+void SetTag(Tag tag) {
+    t_tag = tag;
+}
+
+auto GetName(Tag tag) -> const char* {
+    return TAG_NAMES[tag];
+}
+
+auto GetStats(Tag tag) -> Stats {
+    const auto& counter = g_counters[tag];
+    return {
+        .current = counter.current,
+        .peak = counter.peak,
+        .allocs = counter.allocs,
+        .failed = counter.failed,
+    };
+}
+
+void LogStats(const char* reason) {
+    const auto info = mallinfo();
+    log_write("[MEM] %s, heap used: %zu free: %zu\n", reason, (size_t)info.uordblks, (size_t)info.fordblks);
+
+    for (u32 i = 0; i < Tag_MAX; i++) {
+        const auto stats = GetStats((Tag)i);
+        log_write("[MEM]\t%s current: %ld peak: %ld allocs: %lu failed: %lu\n", TAG_NAMES[i], stats.current, stats.peak, stats.allocs, stats.failed);
+    }
+}
+
+void* Malloc(Tag tag, std::size_t size) {
+    auto header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+    if (!header) {
+        OnFailed(tag, size);
+        return nullptr;
+    }
+
+    header->size = size;
+    header->tag = tag;
+    Add(tag, size);
+    return header + 1;
+}
+
+void* Calloc(Tag tag, std::size_t count, std::size_t size) {
+    const auto total = count * size;
+    if (size && total / size != count) {
+        OnFailed(tag, SIZE_MAX);
+        return nullptr;
+    }
+
+    auto ptr = Malloc(tag, total);
+    if (ptr) {
+        std::memset(ptr, 0, total);
+    }
+    return ptr;
+}
+
+void* Realloc(Tag tag, void* ptr, std::size_t size) {
+    if (!ptr) {
+        return Malloc(tag, size);
+    }
+
+    // the memory stays charged to the tag it was first allocated with.
+    const auto old = *ToHeader(ptr);
+    auto header = static_cast<Header*>(std::realloc(ToHeader(ptr), sizeof(Header) + size));
+    if (!header) {
+        OnFailed((Tag)old.tag, size);
+        return nullptr;
+    }
+
+    header->size = size;
+    Remove((Tag)old.tag, old.size);
+    Add((Tag)old.tag, size);
+    return header + 1;
+}
+
+char* Strdup(Tag tag, const char* str) {
+    const auto len = std::strlen(str) + 1;
+    auto ptr = static_cast<char*>(Malloc(tag, len));
+    if (ptr) {
+        std::memcpy(ptr, str, len);
+    }
+    return ptr;
+}
+
+void Free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    const auto header = ToHeader(ptr);
+    Remove((Tag)header->tag, header->size);
+    std::free(header);
+}
+
+} // namespace sphaira::utils::mem
+
+// replaces the global operator new / delete so that all c++ allocations are
+// charged to the tag of the calling thread.
+// the aligned overloads are left as is, as they are rarely used.
+using namespace sphaira::utils;
+
+void* operator new(std::size_t size) {
+    for (;;) {
+        if (auto ptr = mem::Malloc(mem::GetTag(), size)) {
+            return ptr;
+        }
+
+        // exceptions are disabled, so there's nothing to throw.
+        const auto handler = std::get_new_handler();
+        if (!handler) {
+            std::abort();
+        }
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return mem::Malloc(mem::GetTag(), size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return mem::Malloc(mem::GetTag(), size);
+}
+
+void operator delete(void* ptr) noexcept {
+    mem::Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    mem::Free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    mem::Free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    mem::Free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    mem::Free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    mem::Free(ptr);
+}
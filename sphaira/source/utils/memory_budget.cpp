@@ -0,0 +1,80 @@
+#include "utils/memory_budget.hpp"
+#include "utils/utils.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+
+extern "C" {
+    // set by libnx when the heap is created.
+    extern char* fake_heap_start;
+    extern char* fake_heap_end;
+} // extern "C"
+
+namespace sphaira::utils::budget {
+namespace {
+
+struct Share {
+    const char* name;
+    // percent of the heap.
+    u32 percent;
+    // size used when the heap is large enough (application mode).
+    u64 max;
+};
+
+// in the same order as Subsystem.
+constexpr Share SHARES[] = {
+    { "transfer", 12, 1024ULL * 1024 * 128 },
+    { "buffer pool", 2, 1024ULL * 1024 * 32 },
+    { "block cache", 2, 1024ULL * 1024 * 16 },
+    { "ncz", 8, 1024ULL * 1024 * 32 },
+    { "nsz compress", 16, 1024ULL * 1024 * 64 },
+};
+static_assert(std::size(SHARES) == Subsystem_MAX);
+
+u64 g_heap_size{};
+u64 g_budgets[Subsystem_MAX]{};
+bool g_init{};
+
+} // namespace
+
+void Init() {
+    if (g_init) {
+        return;
+    }
+
+    g_init = true;
+    g_heap_size = fake_heap_end - fake_heap_start;
+    log_write("[BUDGET] heap size: %s\n", utils::formatSizeStorage(g_heap_size).c_str());
+
+    for (u32 i = 0; i < Subsystem_MAX; i++) {
+        g_budgets[i] = std::min(SHARES[i].max, g_heap_size / 100 * SHARES[i].percent);
+        log_write("[BUDGET] %s: %s\n", SHARES[i].name, utils::formatSizeStorage(g_budgets[i]).c_str());
+    }
+}
+
+auto GetHeapSize() -> u64 {
+    return g_heap_size;
+}
+
+auto Get(Subsystem subsystem) -> u64 {
+    // in case it's used before Init(), ie, from a static.
+    if (!g_init) {
+        return SHARES[subsystem].max;
+    }
+
+    return g_budgets[subsystem];
+}
+
+auto FitBufferSize(Subsystem subsystem, u64 preferred, u32 count, u64 min) -> u64 {
+    const auto budget = Get(subsystem);
+    count = std::max<u32>(count, 1);
+
+    auto size = preferred;
+    while (size > min && size * count > budget) {
+        size /= 2;
+    }
+
+    return std::max(size, min);
+}
+
+} // namespace sphaira::utils::budget
@@ -1,5 +1,8 @@
 #include "utils/nsz_dumper.hpp"
 #include "utils/utils.hpp"
+#include "utils/zstd_pool.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/thread.hpp"
 
 #include "app.hpp"
 #include "log.hpp"
@@ -19,8 +22,11 @@
 #include "yati/nx/crypto.hpp"
 
 #include <utility>
+#include <atomic>
+#include <memory>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 #include <minIni.h>
 #include <zstd.h>
 
@@ -35,6 +41,380 @@ struct NszInfo {
     u8 block_exponent;
 };
 
+// max number of threads used to compress blocks.
+constexpr u32 BLOCK_WORKER_MAX = 4;
+
+// range that the auto level is adjusted between.
+constexpr int AUTO_LEVEL_MIN = 1;
+constexpr int AUTO_LEVEL_MAX = 8;
+// amount of data compressed before the level is re-evaluated.
+constexpr s64 AUTO_LEVEL_WINDOW = 1024 * 1024 * 32;
+
+auto GetSpeed(s64 size, u64 ticks) -> double {
+    const auto seconds = armTicksToNs(ticks) / 1e+9;
+    return seconds ? size / seconds / 1024.0 / 1024.0 : 0.0;
+}
+
+// running totals of each stage, used to find the slowest stage.
+struct StageSample {
+    s64 read_size;
+    u64 read_ticks;
+    s64 compress_in;
+    s64 compress_out;
+    u64 compress_ticks;
+    s64 write_size;
+    u64 write_ticks;
+};
+
+// raises the level whilst compressing is faster than reading / writing,
+// and lowers it once compressing becomes the slowest stage.
+// Update() is only called from the compress thread, Get() from any thread.
+struct AutoLevel {
+    AutoLevel(bool _enabled, int _level) : enabled{_enabled}, level{_level} {}
+
+    auto Get() const -> int {
+        return level;
+    }
+
+    // resets the window, call this when the totals are reset.
+    void Begin() {
+        last = {};
+    }
+
+    void Update(const StageSample& sample) {
+        if (!enabled || sample.compress_in - last.compress_in < AUTO_LEVEL_WINDOW) {
+            return;
+        }
+
+        const auto compress_in = sample.compress_in - last.compress_in;
+        const auto compress_out = sample.compress_out - last.compress_out;
+        const auto read_speed = GetSpeed(sample.read_size - last.read_size, sample.read_ticks - last.read_ticks);
+        const auto compress_speed = GetSpeed(compress_in, sample.compress_ticks - last.compress_ticks);
+        // convert to the rate of uncompressed data that the writer can keep up with.
+        auto write_speed = GetSpeed(sample.write_size - last.write_size, sample.write_ticks - last.write_ticks);
+        if (compress_out) {
+            write_speed = write_speed * compress_in / compress_out;
+        }
+        last = sample;
+
+        // a stage that took no time can't be the bottleneck.
+        const auto io_speed = std::min(read_speed ? read_speed : write_speed, write_speed ? write_speed : read_speed);
+        if (!compress_speed || !io_speed) {
+            return;
+        }
+
+        const auto old_level = level.load();
+        auto new_level = old_level;
+        if (compress_speed < io_speed) {
+            new_level--;
+        } else if (compress_speed > io_speed * 1.3) {
+            // leave some headroom as higher levels get slower quickly.
+            new_level++;
+        }
+
+        new_level = std::clamp(new_level, AUTO_LEVEL_MIN, AUTO_LEVEL_MAX);
+        if (new_level != old_level) {
+            log_write("[NSZ] auto level: %d -> %d read: %.2f MiB/s compress: %.2f MiB/s write: %.2f MiB/s\n", old_level, new_level, read_speed, compress_speed, write_speed);
+            level = new_level;
+        }
+    }
+
+private:
+    const bool enabled;
+    std::atomic<int> level;
+    StageSample last{};
+};
+
+// number of samples read from the nca to estimate how well it compresses.
+constexpr u32 PROBE_SAMPLE_COUNT = 8;
+constexpr s64 PROBE_SAMPLE_SIZE = 1024 * 256;
+// fast level, as this only needs to spot data that is already compressed.
+constexpr int PROBE_LEVEL = 1;
+// ncas that save less than this are stored as a normal nca.
+constexpr double PROBE_MIN_SAVING = 0.02;
+// blocks with a byte entropy above this are stored raw without calling zstd.
+constexpr double BLOCK_RAW_ENTROPY = 7.95;
+// max number of bytes sampled from a block when checking its entropy.
+constexpr u64 BLOCK_ENTROPY_SAMPLE_SIZE = 1024 * 64;
+
+// returns the shannon entropy (bits per byte) of a sample of the data.
+// encrypted / already compressed data is close to 8.
+auto GetEntropy(const u8* data, u64 size) -> double {
+    if (!size) {
+        return 0;
+    }
+
+    // sample chunks spread over the data rather than every byte.
+    constexpr u64 chunk_size = 0x1000;
+    const auto step = std::max<u64>(chunk_size, size / (BLOCK_ENTROPY_SAMPLE_SIZE / chunk_size));
+
+    u32 counts[256]{};
+    u64 total{};
+    for (u64 off = 0; off < size; off += step) {
+        const auto rsize = std::min<u64>(chunk_size, size - off);
+        for (u64 i = 0; i < rsize; i++) {
+            counts[data[off + i]]++;
+        }
+        total += rsize;
+    }
+
+    double entropy{};
+    for (const auto count : counts) {
+        if (count) {
+            const auto p = (double)count / total;
+            entropy -= p * std::log2(p);
+        }
+    }
+
+    return entropy;
+}
+
+// trial compresses samples spread over the nca to estimate the saving.
+Result ProbeNca(nca::NcaReader* nca_reader, s64 nca_size, double& saving) {
+    saving = 1.0;
+
+    const auto data_size = nca_size - NCZ_NORMAL_SIZE;
+    if (data_size <= 0) {
+        R_SUCCEED();
+    }
+
+    utils::zstd::CCtx cctx{utils::zstd::AcquireCCtx()};
+    R_UNLESS(cctx, Result_NszFailedCreateCctx);
+
+    const auto sample_size = std::min<s64>(PROBE_SAMPLE_SIZE, data_size);
+    const auto sample_count = std::min<s64>(PROBE_SAMPLE_COUNT, data_size / sample_size);
+    const auto step = data_size / sample_count;
+
+    std::vector<u8> in(sample_size);
+    std::vector<u8> out(ZSTD_compressBound(sample_size));
+    s64 in_total{};
+    s64 out_total{};
+
+    for (s64 i = 0; i < sample_count; i++) {
+        u64 bytes_read;
+        R_TRY(nca_reader->Read(in.data(), NCZ_NORMAL_SIZE + step * i, in.size(), &bytes_read));
+
+        const auto res = ZSTD_compressCCtx(cctx.get(), out.data(), out.size(), in.data(), bytes_read, PROBE_LEVEL);
+        R_UNLESS(!ZSTD_isError(res), Result_NszFailedCompress2);
+
+        in_total += bytes_read;
+        out_total += std::min<s64>(res, bytes_read);
+    }
+
+    if (in_total) {
+        saving = 1.0 - (double)out_total / in_total;
+    }
+
+    R_SUCCEED();
+}
+
+struct BlockJob {
+    std::vector<u8> in{};
+    std::vector<u8> out{};
+};
+
+// blocks are independent zstd frames, so each block is compressed on its own
+// worker and collected back in order, so that the block size table is in order.
+struct BlockCompressPool {
+    BlockCompressPool(ui::ProgressBox* _pbox, const NszInfo& _info, const AutoLevel& _auto_level, u64 block_size) : pbox{_pbox}, info{_info}, auto_level{_auto_level} {
+        mutexInit(std::addressof(mutex));
+        condvarInit(std::addressof(can_work));
+        condvarInit(std::addressof(can_collect));
+
+        // limits the number of blocks in flight, each block needs an in and out buffer.
+        const auto pool_memory = utils::budget::Get(utils::budget::Subsystem_NszCompress);
+        slot_count = std::clamp<u64>(pool_memory / (block_size * 2), 2, BLOCK_WORKER_MAX * 2);
+        max_workers = std::clamp<u32>(info.threads, 1, std::min<u32>(BLOCK_WORKER_MAX, slot_count));
+        jobs.resize(slot_count);
+        done.resize(slot_count);
+    }
+
+    ~BlockCompressPool() {
+        {
+            SCOPED_MUTEX(std::addressof(mutex));
+            finished = true;
+            condvarWakeAll(std::addressof(can_work));
+        }
+
+        for (u32 i = 0; i < worker_count; i++) {
+            threadWaitForExit(&workers[i]);
+            threadClose(&workers[i]);
+        }
+    }
+
+    Result Start() {
+        for (u32 i = 0; i < max_workers; i++) {
+            R_TRY(utils::CreateThread(&workers[i], workerFunc, this, utils::ThreadRole::Compute));
+            if (R_FAILED(threadStart(&workers[i]))) {
+                threadClose(&workers[i]);
+                break;
+            }
+            worker_count++;
+        }
+
+        R_UNLESS(worker_count, Result_NszFailedCreateCctx);
+        log_write("[NSZ] block pool workers: %u slots: %u\n", worker_count, slot_count);
+        R_SUCCEED();
+    }
+
+    auto GetResults() -> Result {
+        R_TRY(pbox->ShouldExitResult());
+        R_TRY(result.load());
+        R_SUCCEED();
+    }
+
+    auto IsFull() const -> bool {
+        return queued - collected == slot_count;
+    }
+
+    auto IsEmpty() const -> bool {
+        return queued == collected;
+    }
+
+    // swaps the block with an empty buffer.
+    Result Push(std::vector<u8>& in) {
+        R_UNLESS(!IsFull(), Result_NszTooManyBlocks);
+
+        auto& job = jobs[queued % slot_count];
+        std::swap(job.in, in);
+        in.clear();
+
+        SCOPED_MUTEX(std::addressof(mutex));
+        queued++;
+        condvarWakeOne(std::addressof(can_work));
+        R_SUCCEED();
+    }
+
+    // waits for the oldest block to finish and swaps out the data to write.
+    Result Pop(std::vector<u8>& out) {
+        const auto index = collected % slot_count;
+
+        mutexLock(std::addressof(mutex));
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(mutex)));
+
+        while (!done[index] && R_SUCCEEDED(GetResults())) {
+            // timeout so that cancelling is noticed.
+            condvarWaitTimeout(std::addressof(can_collect), std::addressof(mutex), 1e+8); // 100ms
+        }
+
+        R_TRY(GetResults());
+        std::swap(jobs[index].out, out);
+        done[index] = false;
+        collected++;
+        R_SUCCEED();
+    }
+
+    auto GetWorkerCount() const -> u32 {
+        return worker_count;
+    }
+
+    // time spent compressing, summed over all workers.
+    std::atomic<u64> compress_ticks{};
+    // number of blocks that were skipped by the entropy check.
+    std::atomic<u32> raw_blocks{};
+
+private:
+    Result workerFuncInternal() {
+        utils::zstd::CCtx cctx{utils::zstd::AcquireCCtx()};
+        R_UNLESS(cctx, Result_NszFailedCreateCctx);
+
+        // each block is small, so parallelism comes from the pool rather than zstd.
+        auto level = auto_level.Get();
+        R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level)), Result_NszFailedSetCompressionLevel);
+        R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_enableLongDistanceMatching, info.ldm)), Result_NszFailedSetLongDistanceMode);
+
+        for (;;) {
+            mutexLock(std::addressof(mutex));
+            while (next_job == queued && !finished && R_SUCCEEDED(GetResults())) {
+                condvarWaitTimeout(std::addressof(can_work), std::addressof(mutex), 1e+8); // 100ms
+            }
+
+            if (next_job == queued || R_FAILED(GetResults())) {
+                mutexUnlock(std::addressof(mutex));
+                break;
+            }
+
+            const auto index = next_job++ % slot_count;
+            mutexUnlock(std::addressof(mutex));
+
+            // each block is its own frame, so the level can change between blocks.
+            if (const auto new_level = auto_level.Get(); new_level != level) {
+                level = new_level;
+                R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level)), Result_NszFailedSetCompressionLevel);
+            }
+
+            auto& job = jobs[index];
+
+            // skip calling zstd for blocks that won't compress, they're stored raw.
+            if (GetEntropy(job.in.data(), job.in.size()) >= BLOCK_RAW_ENTROPY) {
+                raw_blocks++;
+                std::swap(job.out, job.in);
+
+                SCOPED_MUTEX(std::addressof(mutex));
+                done[index] = true;
+                condvarWakeAll(std::addressof(can_collect));
+                continue;
+            }
+
+            const auto start = armGetSystemTick();
+            job.out.resize(job.in.size());
+            const auto res = ZSTD_compress2(cctx.get(), job.out.data(), job.out.size(), job.in.data(), job.in.size());
+            compress_ticks += armGetSystemTick() - start;
+
+            // check if we got an error, ignoring if the dst buffer was too small.
+            const auto error_code = ZSTD_getErrorCode(res);
+            R_UNLESS(error_code == ZSTD_error_no_error || error_code == ZSTD_error_dstSize_tooSmall, Result_NszFailedCompress2);
+
+            // use src buffer instead if zstd failed to compress.
+            if (error_code == ZSTD_error_dstSize_tooSmall || res >= job.in.size()) {
+                std::swap(job.out, job.in);
+            } else {
+                job.out.resize(res);
+            }
+
+            SCOPED_MUTEX(std::addressof(mutex));
+            done[index] = true;
+            condvarWakeAll(std::addressof(can_collect));
+        }
+
+        R_SUCCEED();
+    }
+
+    static void workerFunc(void* d) {
+        App::ComputeBoost boost;
+        auto pool = static_cast<BlockCompressPool*>(d);
+        if (const auto rc = pool->workerFuncInternal(); R_FAILED(rc)) {
+            pool->result = rc;
+        }
+    }
+
+private:
+    ui::ProgressBox* const pbox;
+    const NszInfo info;
+    const AutoLevel& auto_level;
+    std::vector<BlockJob> jobs{};
+    Thread workers[BLOCK_WORKER_MAX]{};
+    u32 max_workers{};
+    u32 worker_count{};
+    u32 slot_count{};
+
+    Mutex mutex{};
+    // signalled when a block has been queued.
+    CondVar can_work{};
+    // signalled when a block has been compressed.
+    CondVar can_collect{};
+
+    // queued and collected are only modified by the compress thread.
+    u64 queued{};
+    u64 collected{};
+    // protected by mutex.
+    u64 next_job{};
+    std::vector<bool> done{};
+    bool finished{};
+
+    std::atomic<Result> result{};
+};
+
 } // namespace
 
 Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64& read_offset, s64& write_offset, Collections& collections, const keys::Keys& keys, dump::BaseSource* source, dump::WriteSource* writer, const fs::FsPath& path) {
@@ -71,12 +451,14 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
     // enable to use block over solid.
     const auto use_block = App::GetApp()->m_nsz_compress_block.Get();
     const auto block_exponent = App::GetNszBlockExponent();
+    // lives for the whole export so that the level carries over between ncas.
+    AutoLevel auto_level{App::GetNszCompressLevelAuto(), level};
 
     log_write("[NSZ] start\n");
 
-    auto cctx = ZSTD_createCCtx();
-    R_UNLESS(cctx, Result_NszFailedCreateCctx);
-    ON_SCOPE_EXIT(ZSTD_freeCCtx(cctx));
+    utils::zstd::CCtx cctx_handle{utils::zstd::AcquireCCtx()};
+    R_UNLESS(cctx_handle, Result_NszFailedCreateCctx);
+    const auto cctx = cctx_handle.get();
 
     R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level)), Result_NszFailedSetCompressionLevel);
     R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, threads)), Result_NszFailedSetThreadCount);
@@ -97,6 +479,8 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
 
         bool should_compress = false;
         nca::Header header;
+        keys::KeyEntry title_key;
+        std::unique_ptr<nca::NcaReader> nca_reader{};
 
         // check if we can compress this nca.
         if (collection.name.ends_with(".nca") && collection.size > NCZ_NORMAL_SIZE) {
@@ -109,20 +493,24 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
             // nsz only compresses these 2 types.
             // todo: update yati to ensure only these 2 types are compressed, as it currently accepts anything.
             if (header.content_type == nca::ContentType_Program || header.content_type == nca::ContentType_PublicData) {
-                should_compress = true;
+                // todo: add this to nca.hpp
+                R_TRY(nca::GetDecryptedTitleKey(header, keys, title_key));
+
+                nca_reader = nca_creator(header, title_key, collection);
+                R_UNLESS(nca_reader, 3);
+
+                // ncas made of already compressed data (videos, compressed assets)
+                // barely shrink, so store them as is rather than spend the time.
+                double saving;
+                R_TRY(ProbeNca(nca_reader.get(), collection.size, saving));
+                log_write("[NSZ] probe saving: %.2f%%\n", saving * 100);
+                should_compress = saving >= PROBE_MIN_SAVING;
             }
         }
 
         if (should_compress) {
             collection.name = collection.name.substr(0, collection.name.find_last_of('.')) + ".ncz";
 
-            // todo: add this to nca.hpp
-            keys::KeyEntry title_key;
-            R_TRY(nca::GetDecryptedTitleKey(header, keys, title_key));
-
-            auto nca_reader = nca_creator(header, title_key, collection);
-            R_UNLESS(nca_reader, 3);
-
             const ncz::Header ncz_header{NCZ_SECTION_MAGIC, header.GetSectionCount()};
             std::vector<ncz::Section> ncz_sections(ncz_header.total_sections);
 
@@ -167,12 +555,43 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
             std::vector<ncz::Block> ncz_blocks(ncz_block_header.total_blocks);
             u32 ncz_block_index = 0;
 
-            // buffer that zstd compresses into.
+            // buffer that the pool compresses into.
             std::vector<u8> ncz_block_out_buffer;
             // buffer that is written into.
             std::vector<u8> ncz_block_in_buffer;
             ncz_block_in_buffer.reserve(blockSize);
 
+            // blocks are compressed in parallel, this lives for the whole nca
+            // as blocks can span sections.
+            std::unique_ptr<BlockCompressPool> block_pool{};
+            if (use_block) {
+                const NszInfo info{threads, level, ldm, use_block, block_exponent};
+                block_pool = std::make_unique<BlockCompressPool>(pbox, info, auto_level, blockSize);
+                R_TRY(block_pool->Start());
+            }
+
+            // used to report the speed of each stage.
+            const auto nca_start = armGetSystemTick();
+            std::atomic<u64> read_ticks{};
+            std::atomic<u64> compress_ticks{};
+            std::atomic<u64> write_ticks{};
+            std::atomic<s64> read_size{};
+            std::atomic<s64> write_size{};
+            s64 compress_in{};
+            s64 compress_out{};
+            const auto nca_file_off = file_off;
+
+            // samples the speed of each stage, called from the compress thread.
+            const auto update_auto_level = [&]() {
+                auto ticks = compress_ticks.load();
+                if (use_block) {
+                    ticks = block_pool->compress_ticks / block_pool->GetWorkerCount();
+                }
+
+                auto_level.Update({read_size, read_ticks, compress_in, compress_out, ticks, write_size, write_ticks});
+            };
+            auto_level.Begin();
+
             const auto ncz_header_off = file_off + NCZ_NORMAL_SIZE;
             const auto ncz_header_size = sizeof(ncz_header);
 
@@ -229,9 +648,18 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                 pbox->NewTransfer("Section #"_i18n + std::to_string(section_number) + " - " + collection.name);
                 ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
 
+                // apply the level picked during the last section.
+                auto solid_level = auto_level.Get();
+                if (!use_block) {
+                    R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, solid_level)), Result_NszFailedSetCompressionLevel);
+                }
+
                 R_TRY(thread::Transfer(pbox, rsize,
                     [&](void* data, s64 off, s64 size, u64* bytes_read) -> Result {
+                        const auto start = armGetSystemTick();
                         R_TRY(nca_reader->Read(data, nca_off, size, bytes_read));
+                        read_ticks += armGetSystemTick() - start;
+                        read_size += *bytes_read;
                         nca_off += *bytes_read;
                         R_SUCCEED();
                     },
@@ -239,26 +667,28 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                         auto data = (const u8*)_data;
 
                         if (use_block) {
+                            // writes the oldest compressed block, advance the block index.
+                            const auto collect_block = [&]() -> Result {
+                                R_UNLESS(ncz_block_index < ncz_blocks.size(), Result_NszTooManyBlocks);
+                                R_TRY(block_pool->Pop(ncz_block_out_buffer));
+
+                                R_TRY(callback(ncz_block_out_buffer.data(), ncz_block_out_buffer.size()));
+                                ncz_blocks[ncz_block_index++].size = ncz_block_out_buffer.size();
+
+                                compress_in = std::min<s64>(ncz_block_index * blockSize, bytesToCompress);
+                                compress_out += ncz_block_out_buffer.size();
+                                update_auto_level();
+                                R_SUCCEED();
+                            };
+
                             const auto flush_block = [&]() -> Result {
-                                R_UNLESS(ncz_block_index <= ncz_blocks.size(), Result_NszTooManyBlocks);
-                                ncz_block_out_buffer.resize(ncz_block_in_buffer.size());
-                                const auto result = ZSTD_compress2(cctx, ncz_block_out_buffer.data(), ncz_block_out_buffer.size(), ncz_block_in_buffer.data(), ncz_block_in_buffer.size());
-
-                                // check if we got an error, ignoring if the dst buffer was too small.
-                                const auto error_code = ZSTD_getErrorCode(result);
-                                R_UNLESS(error_code == ZSTD_error_no_error || error_code == ZSTD_error_dstSize_tooSmall, Result_NszFailedCompress2);
-
-                                // use src buffer instead if zstd failed to compress.
-                                auto output = std::span{ncz_block_out_buffer.data(), result};
-                                if (error_code == ZSTD_error_dstSize_tooSmall || result >= ncz_block_in_buffer.size()) {
-                                    output = ncz_block_in_buffer;
+                                if (block_pool->IsFull()) {
+                                    R_TRY(collect_block());
                                 }
 
-                                // write block data, advance the block index.
-                                R_TRY(callback(output.data(), output.size()));
-                                ncz_blocks[ncz_block_index++].size = output.size();
-
-                                ncz_block_in_buffer.resize(0);
+                                // this swaps in the buffer of an old block to avoid allocating.
+                                R_TRY(block_pool->Push(ncz_block_in_buffer));
+                                ncz_block_in_buffer.reserve(blockSize);
                                 R_SUCCEED();
                             };
 
@@ -289,6 +719,11 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                                     R_TRY(flush_block());
                                 }
 
+                                // write the remaining blocks.
+                                while (!block_pool->IsEmpty()) {
+                                    R_TRY(collect_block());
+                                }
+
                                 // ensure that we are at the last block.
                                 log_write("block index: %u vs %zu\n", ncz_block_index, ncz_blocks.size());
                                 R_UNLESS(ncz_block_index == ncz_blocks.size(), Result_NszMissingBlocks);
@@ -296,13 +731,22 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                         } else {
                             ZSTD_inBuffer input = { data, (u64)size, 0 };
 
+                            // zstd only allows changing the level mid-frame when using workers,
+                            // otherwise the new level is applied on the next section.
+                            if (threads > 0 && auto_level.Get() != solid_level) {
+                                solid_level = auto_level.Get();
+                                R_UNLESS(!ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, solid_level)), Result_NszFailedSetCompressionLevel);
+                            }
+
                             const auto last_chunk = off + size >= rsize;
                             const auto mode = last_chunk ? ZSTD_e_end : ZSTD_e_continue;
 
                             int finished;
                             do {
                                 ZSTD_outBuffer output = { zstd_out_buf.data(), zstd_out_buf.size(), 0 };
+                                const auto start = armGetSystemTick();
                                 const size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+                                compress_ticks += armGetSystemTick() - start;
 
                                 if (ZSTD_isError(remaining)) {
                                     log_write("[ZSTD] error: %zu %s\n", remaining, ZSTD_getErrorName(remaining));
@@ -310,6 +754,7 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
                                 }
 
                                 if (output.pos) {
+                                    compress_out += output.pos;
                                     R_TRY(callback(output.dst, output.pos));
                                 } else {
                                     log_write("got no output pos so skipping\n");
@@ -317,12 +762,18 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
 
                                 finished = last_chunk ? (remaining == 0) : (input.pos == input.size);
                             } while (!finished);
+
+                            compress_in += size;
+                            update_auto_level();
                         }
 
                         R_SUCCEED();
                     },
                     [&](const void* data, s64 off, s64 size) -> Result {
+                        const auto start = armGetSystemTick();
                         R_TRY(writer->Write(data, file_off, size));
+                        write_ticks += armGetSystemTick() - start;
+                        write_size += size;
                         file_off += size;
                         R_SUCCEED();
                     }
@@ -334,8 +785,22 @@ Result NszExport(ui::ProgressBox* pbox, const NcaReaderCreator& nca_creator, s64
             if (use_block) {
                 // update blocks with new compressed sizes.
                 R_TRY(writer->Write(ncz_blocks.data(), ncz_blocks_off, ncz_blocks_size));
+
+                // the workers run in parallel, so this is the combined speed.
+                compress_ticks = block_pool->compress_ticks / block_pool->GetWorkerCount();
+                log_write("[NSZ] raw blocks: %u / %zu\n", block_pool->raw_blocks.load(), ncz_blocks.size());
             }
 
+            const auto seconds = armTicksToNs(armGetSystemTick() - nca_start) / 1e+9;
+            const auto out_size = file_off - nca_file_off;
+            log_write("[NSZ] %s ratio: %.2f%% took: %.2fs read: %.2f MiB/s compress: %.2f MiB/s write: %.2f MiB/s\n",
+                collection.name.c_str(),
+                collection.size ? out_size * 100.0 / collection.size : 0.0,
+                seconds,
+                GetSpeed(bytesToCompress, read_ticks),
+                GetSpeed(bytesToCompress, compress_ticks),
+                GetSpeed(out_size, write_ticks));
+
             source_off += collection.size;
         } else {
             R_TRY(threaded_write(collection.name, source_off, file_off, collection.size));
@@ -0,0 +1,125 @@
+#include "utils/path_index.hpp"
+
+#include <bit>
+#include <algorithm>
+#include <cstring>
+
+namespace sphaira::utils {
+namespace {
+
+constexpr u32 EMPTY_SLOT = ~0U;
+constexpr u32 MIN_CAPACITY = 16;
+
+} // namespace
+
+// fnv-1a, paths are short so this is fast enough and spreads well.
+auto PathIndex::Hash(std::string_view path) -> u32 {
+    u32 hash = 0x811C9DC5;
+    for (const auto c : path) {
+        hash ^= static_cast<u8>(c);
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+void PathIndex::Reserve(u32 count, u32 arena_size) {
+    // keep the load factor at or below 50%.
+    const auto capacity = std::bit_ceil(std::max<u32>(count * 2, MIN_CAPACITY));
+    if (capacity > m_slots.size()) {
+        Grow(capacity);
+    }
+
+    if (arena_size) {
+        m_arena.reserve(arena_size);
+    }
+}
+
+bool PathIndex::Add(std::string_view path, u32 value) {
+    if ((m_count + 1) * 2 > m_slots.size()) {
+        Grow(std::max<u32>(m_slots.size() * 2, MIN_CAPACITY));
+    }
+
+    const auto hash = Hash(path);
+    const auto mask = m_slots.size() - 1;
+
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto& slot = m_slots[i];
+        if (slot.path_off == EMPTY_SLOT) {
+            slot.hash = hash;
+            slot.path_off = m_arena.size();
+            slot.path_len = path.size();
+            slot.value = value;
+            m_arena.insert(m_arena.end(), path.begin(), path.end());
+            m_count++;
+            return true;
+        }
+
+        if (IsMatch(slot, path, hash)) {
+            return false;
+        }
+    }
+}
+
+bool PathIndex::Find(std::string_view path, u32& out) const {
+    if (m_slots.empty()) {
+        return false;
+    }
+
+    if (const auto slot = FindSlot(path, Hash(path))) {
+        out = slot->value;
+        return true;
+    }
+
+    return false;
+}
+
+void PathIndex::Clear() {
+    m_arena.clear();
+    m_slots.clear();
+    m_count = 0;
+}
+
+auto PathIndex::IsMatch(const Slot& slot, std::string_view path, u32 hash) const -> bool {
+    if (slot.hash != hash || slot.path_len != path.size()) {
+        return false;
+    }
+
+    return path.empty() || !std::memcmp(m_arena.data() + slot.path_off, path.data(), path.size());
+}
+
+void PathIndex::Grow(u32 capacity) {
+    std::vector<Slot> old_slots(capacity, Slot{0, EMPTY_SLOT, 0, 0});
+    // old_slots now holds the current table.
+    std::swap(old_slots, m_slots);
+
+    // the arena is unchanged, so only the slots need to be moved.
+    const auto mask = m_slots.size() - 1;
+    for (const auto& slot : old_slots) {
+        if (slot.path_off == EMPTY_SLOT) {
+            continue;
+        }
+
+        auto i = slot.hash & mask;
+        while (m_slots[i].path_off != EMPTY_SLOT) {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = slot;
+    }
+}
+
+auto PathIndex::FindSlot(std::string_view path, u32 hash) const -> const Slot* {
+    const auto mask = m_slots.size() - 1;
+
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        const auto& slot = m_slots[i];
+        if (slot.path_off == EMPTY_SLOT) {
+            return nullptr;
+        }
+
+        if (IsMatch(slot, path, hash)) {
+            return &slot;
+        }
+    }
+}
+
+} // namespace sphaira::utils
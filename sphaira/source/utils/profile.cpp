@@ -0,0 +1,83 @@
+#include "utils/profile.hpp"
+#include <atomic>
+#include <algorithm>
+
+namespace sphaira::utils::profile {
+namespace {
+
+// weight of the newest sample when averaging the phases.
+constexpr u64 PHASE_SMOOTHING = 8;
+
+u64 g_frame_ns[FRAME_HISTORY]{};
+u32 g_frame_index{};
+u64 g_phase_ns[Phase_MAX]{};
+std::vector<MenuTime> g_menus{};
+std::vector<MenuTime> g_menus_last{};
+
+std::atomic<u64> g_transfer_bytes{};
+std::atomic<u64> g_transfer_active_tick{};
+u64 g_transfer_bytes_last{};
+u64 g_transfer_tick{};
+u64 g_transfer_speed{};
+u64 g_startup_ns{};
+
+} // namespace
+
+void SetPhase(Phase phase, u64 ns) {
+    auto& e = g_phase_ns[phase];
+    e = (e * (PHASE_SMOOTHING - 1) + ns) / PHASE_SMOOTHING;
+}
+
+void AddMenuDraw(const char* name, u64 ns) {
+    g_menus.emplace_back(name, ns);
+}
+
+void EndFrame(u64 frame_ns) {
+    g_frame_ns[g_frame_index] = frame_ns;
+    g_frame_index = (g_frame_index + 1) % FRAME_HISTORY;
+
+    // skipped frames don't draw, so keep the last drawn menus.
+    if (!g_menus.empty()) {
+        std::swap(g_menus, g_menus_last);
+        g_menus.clear();
+    }
+
+    // transfers report their progress often, so it's sampled once a second.
+    const auto tick = armGetSystemTick();
+    const auto elapsed = armTicksToNs(tick - g_transfer_tick);
+    if (elapsed >= 1e+9) {
+        const auto bytes = g_transfer_bytes.load();
+        g_transfer_speed = (bytes - g_transfer_bytes_last) * 1e+9 / elapsed;
+        g_transfer_bytes_last = bytes;
+        g_transfer_tick = tick;
+    }
+}
+
+void AddTransferBytes(s64 bytes) {
+    if (bytes > 0) {
+        g_transfer_bytes += bytes;
+        g_transfer_active_tick = armGetSystemTick();
+    }
+}
+
+bool IsTransferActive() {
+    const auto tick = g_transfer_active_tick.load();
+    return tick && armTicksToNs(armGetSystemTick() - tick) < 1e+9;
+}
+
+void SetStartupTime(u64 ns) {
+    g_startup_ns = ns;
+}
+
+void GetSnapshot(Snapshot& out) {
+    for (u32 i = 0; i < FRAME_HISTORY; i++) {
+        out.frame_ns[i] = g_frame_ns[(g_frame_index + i) % FRAME_HISTORY];
+    }
+
+    std::copy_n(g_phase_ns, Phase_MAX, out.phase_ns);
+    out.menus = g_menus_last;
+    out.transfer_speed = g_transfer_speed;
+    out.startup_ns = g_startup_ns;
+}
+
+} // namespace sphaira::utils::profile
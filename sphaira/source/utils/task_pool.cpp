@@ -0,0 +1,254 @@
+#include "utils/task_pool.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <deque>
+#include <utility>
+
+namespace sphaira::utils::task {
+namespace {
+
+constexpr u32 MAX_WORKERS = 4;
+constexpr size_t WORKER_STACK_SIZE = 1024 * 128;
+// one below the default thread priority, see utils::CreateThread().
+constexpr int WORKER_PRIO = 0x3C;
+
+struct Worker {
+    Mutex mutex{};
+    std::deque<Task> queue[(u32)Priority::MAX]{};
+    Thread thread{};
+    u32 index{};
+    bool started{};
+};
+
+Worker g_workers[MAX_WORKERS]{};
+std::atomic<u32> g_worker_count{};
+// round robin for tasks pushed from outside the pool.
+std::atomic<u32> g_next_worker{};
+
+// workers sleep whilst nothing is queued.
+Mutex g_sleep_mutex{};
+CondVar g_can_work{};
+// can go negative for a moment as it's updated after the task is queued.
+std::atomic<s32> g_queued{};
+bool g_quit{};
+
+// index of the worker the thread is, or -1 if it's not a worker.
+thread_local s32 t_worker_index{-1};
+
+// takes the newest task from its own queue, or steals the oldest one from
+// another worker, highest priority first.
+auto TryPop(s32 self, Task& out) -> bool {
+    const auto count = g_worker_count.load();
+
+    for (u32 prio = 0; prio < (u32)Priority::MAX; prio++) {
+        if (self >= 0) {
+            auto& worker = g_workers[self];
+            SCOPED_MUTEX(&worker.mutex);
+            auto& queue = worker.queue[prio];
+            if (!queue.empty()) {
+                out = std::move(queue.back());
+                queue.pop_back();
+                g_queued--;
+                return true;
+            }
+        }
+
+        for (u32 i = 0; i < count; i++) {
+            const auto victim = (self + 1 + i) % count;
+            if ((s32)victim == self) {
+                continue;
+            }
+
+            auto& worker = g_workers[victim];
+            SCOPED_MUTEX(&worker.mutex);
+            auto& queue = worker.queue[prio];
+            if (!queue.empty()) {
+                out = std::move(queue.front());
+                queue.pop_front();
+                g_queued--;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void WorkerFunc(void* arg) {
+    auto worker = static_cast<Worker*>(arg);
+    t_worker_index = worker->index;
+
+    for (;;) {
+        Task task;
+        if (TryPop(worker->index, task)) {
+            task();
+            continue;
+        }
+
+        SCOPED_MUTEX(&g_sleep_mutex);
+        while (g_queued <= 0 && !g_quit) {
+            condvarWait(&g_can_work, &g_sleep_mutex);
+        }
+
+        // the queue is drained before exiting, as a group may be waiting on it.
+        if (g_queued <= 0 && g_quit) {
+            break;
+        }
+    }
+
+    log_write("[TASK] exited worker: %u\n", worker->index);
+}
+
+} // namespace
+
+Result Init() {
+    if (g_worker_count) {
+        R_SUCCEED();
+    }
+
+    mutexInit(&g_sleep_mutex);
+    condvarInit(&g_can_work);
+    g_quit = false;
+
+    u64 core_mask = 0;
+    R_TRY(svcGetInfo(&core_mask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0));
+
+    // a worker per core, pinned so that the load is spread over all of them.
+    u32 count{};
+    for (u32 core = 0; core < 64 && count < MAX_WORKERS; core++) {
+        if (!(core_mask & (1ULL << core))) {
+            continue;
+        }
+
+        auto& worker = g_workers[count];
+        mutexInit(&worker.mutex);
+        worker.index = count;
+        worker.started = false;
+
+        if (R_FAILED(threadCreate(&worker.thread, WorkerFunc, &worker, nullptr, WORKER_STACK_SIZE, WORKER_PRIO, core))) {
+            log_write("[TASK] failed to create worker on core: %u\n", core);
+            continue;
+        }
+
+        count++;
+    }
+
+    // workers are started once the count is known, as it's used for stealing.
+    // a worker that fails to start still has its queue stolen from.
+    g_worker_count = count;
+    for (u32 i = 0; i < count; i++) {
+        if (R_FAILED(threadStart(&g_workers[i].thread))) {
+            log_write("[TASK] failed to start worker: %u\n", i);
+        } else {
+            g_workers[i].started = true;
+        }
+    }
+
+    log_write("[TASK] started %u workers, core mask: 0x%lX\n", count, core_mask);
+    R_SUCCEED();
+}
+
+void Exit() {
+    const auto count = g_worker_count.load();
+    if (!count) {
+        return;
+    }
+
+    {
+        SCOPED_MUTEX(&g_sleep_mutex);
+        g_quit = true;
+        condvarWakeAll(&g_can_work);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        if (g_workers[i].started) {
+            threadWaitForExit(&g_workers[i].thread);
+        }
+        threadClose(&g_workers[i].thread);
+    }
+
+    // anything pushed whilst the workers were exiting.
+    Task task;
+    while (TryPop(-1, task)) {
+        task();
+    }
+
+    g_worker_count = 0;
+}
+
+auto GetWorkerCount() -> u32 {
+    return g_worker_count;
+}
+
+void Push(Task&& task, Priority prio) {
+    const auto count = g_worker_count.load();
+    if (!count || g_quit) {
+        task();
+        return;
+    }
+
+    // tasks pushed from a worker go to its own queue, as they're likely to
+    // use the same data.
+    const auto index = t_worker_index >= 0 ? (u32)t_worker_index : g_next_worker++ % count;
+
+    {
+        auto& worker = g_workers[index];
+        SCOPED_MUTEX(&worker.mutex);
+        worker.queue[(u32)prio].emplace_back(std::forward<Task>(task));
+    }
+
+    SCOPED_MUTEX(&g_sleep_mutex);
+    g_queued++;
+    condvarWakeOne(&g_can_work);
+}
+
+Group::Group() {
+    mutexInit(&m_mutex);
+    condvarInit(&m_done);
+}
+
+Group::~Group() {
+    Wait();
+}
+
+void Group::Push(Task&& task, Priority prio) {
+    m_pending++;
+    task::Push([this, task = std::forward<Task>(task)]() {
+        task();
+        OnTaskDone();
+    }, prio);
+}
+
+void Group::Wait() {
+    for (;;) {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            if (!m_pending) {
+                return;
+            }
+        }
+
+        // help out rather than sleep, this also means that a group can be
+        // waited on from within a task.
+        Task task;
+        if (TryPop(t_worker_index, task)) {
+            task();
+            continue;
+        }
+
+        SCOPED_MUTEX(&m_mutex);
+        if (m_pending) {
+            condvarWait(&m_done, &m_mutex);
+        }
+    }
+}
+
+void Group::OnTaskDone() {
+    SCOPED_MUTEX(&m_mutex);
+    if (!--m_pending) {
+        condvarWakeAll(&m_done);
+    }
+}
+
+} // namespace sphaira::utils::task
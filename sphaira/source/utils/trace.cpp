@@ -0,0 +1,173 @@
+#include "utils/trace.hpp"
+#include "log.hpp"
+
+#include <atomic>
+#include <string>
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
+
+namespace sphaira::utils::trace {
+namespace {
+
+// spans kept per thread.
+constexpr u32 EVENT_MAX = 2048;
+// threads that can record, threads created after this aren't traced.
+constexpr u32 THREAD_MAX = 64;
+// the json is written in chunks of this size.
+constexpr u64 FLUSH_SIZE = 1024 * 64;
+
+struct Event {
+    const char* name;
+    u64 start;
+    u64 end;
+    bool async;
+};
+
+struct Buffer {
+    u64 tid{};
+    // total number of spans recorded, only written by the owning thread.
+    std::atomic<u64> count{};
+    Event events[EVENT_MAX]{};
+};
+
+std::atomic_bool g_enabled{};
+Mutex g_mutex{};
+Buffer* g_buffers[THREAD_MAX]{};
+std::atomic<u32> g_buffer_count{};
+
+thread_local Buffer* t_buffer{};
+thread_local bool t_no_buffer{};
+
+auto GetBuffer() -> Buffer* {
+    if (t_buffer || t_no_buffer) {
+        return t_buffer;
+    }
+
+    SCOPED_MUTEX(&g_mutex);
+    const auto index = g_buffer_count.load();
+    if (index >= THREAD_MAX) {
+        t_no_buffer = true;
+        return nullptr;
+    }
+
+    // buffers are never freed, as the exporter may be reading them.
+    auto buffer = new Buffer{};
+    svcGetThreadId(&buffer->tid, CUR_THREAD_HANDLE);
+    g_buffers[index] = buffer;
+    g_buffer_count = index + 1;
+
+    t_buffer = buffer;
+    return t_buffer;
+}
+
+void Push(const char* name, u64 start_tick, bool async) {
+    auto buffer = GetBuffer();
+    if (!buffer) {
+        return;
+    }
+
+    const auto count = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[count % EVENT_MAX] = {name, start_tick, armGetSystemTick(), async};
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+struct Writer {
+    Result Write(const char* fmt, ...) __attribute__ ((format (printf, 2, 3))) {
+        char buf[512];
+        va_list v;
+        va_start(v, fmt);
+        const auto len = std::vsnprintf(buf, sizeof(buf), fmt, v);
+        va_end(v);
+
+        if (len > 0) {
+            data.append(buf, std::min<int>(len, sizeof(buf) - 1));
+        }
+
+        if (data.size() >= FLUSH_SIZE) {
+            R_TRY(Flush());
+        }
+
+        R_SUCCEED();
+    }
+
+    Result Flush() {
+        R_TRY(file.Write(offset, data.data(), data.size(), FsWriteOption_None));
+        offset += data.size();
+        data.clear();
+        R_SUCCEED();
+    }
+
+    fs::File file;
+    s64 offset{};
+    std::string data{};
+};
+
+auto ToUs(u64 tick) -> double {
+    return armTicksToNs(tick) / 1e+3;
+}
+
+} // namespace
+
+void SetEnabled(bool enable) {
+    g_enabled = enable;
+}
+
+auto IsEnabled() -> bool {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Record(const char* name, u64 start_tick) {
+    if (IsEnabled()) {
+        Push(name, start_tick, false);
+    }
+}
+
+void RecordAsync(const char* name, u64 start_tick) {
+    if (IsEnabled()) {
+        Push(name, start_tick, true);
+    }
+}
+
+Result Export(const fs::FsPath& path) {
+    fs::FsNativeSd fs;
+    fs.DeleteFile(path);
+    R_TRY(fs.CreateFile(path, 0, 0));
+
+    Writer w;
+    R_TRY(fs.OpenFile(path, FsOpenMode_Write | FsOpenMode_Append, &w.file));
+
+    R_TRY(w.Write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+
+    u64 async_id{};
+    bool first = true;
+    const auto buffer_count = g_buffer_count.load();
+    for (u32 i = 0; i < buffer_count; i++) {
+        const auto buffer = g_buffers[i];
+        // spans recorded whilst exporting may be torn, which is fine for a trace.
+        const auto count = buffer->count.load(std::memory_order_acquire);
+        const auto start = count > EVENT_MAX ? count - EVENT_MAX : 0;
+
+        for (auto j = start; j < count; j++) {
+            const auto& e = buffer->events[j % EVENT_MAX];
+            const auto sep = first ? "" : ",\n";
+            first = false;
+
+            if (e.async) {
+                async_id++;
+                R_TRY(w.Write("%s{\"name\":\"%s\",\"cat\":\"async\",\"ph\":\"b\",\"id\":%lu,\"pid\":1,\"tid\":%lu,\"ts\":%.3f},\n", sep, e.name, async_id, buffer->tid, ToUs(e.start)));
+                R_TRY(w.Write("{\"name\":\"%s\",\"cat\":\"async\",\"ph\":\"e\",\"id\":%lu,\"pid\":1,\"tid\":%lu,\"ts\":%.3f}", e.name, async_id, buffer->tid, ToUs(e.end)));
+            } else {
+                R_TRY(w.Write("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}", sep, e.name, buffer->tid, ToUs(e.start), ToUs(e.end - e.start)));
+            }
+        }
+    }
+
+    R_TRY(w.Write("\n]}\n"));
+    R_TRY(w.Flush());
+
+    log_write("[TRACE] exported %u threads to %s\n", buffer_count, path.s);
+    R_SUCCEED();
+}
+
+} // namespace sphaira::utils::trace
@@ -2,6 +2,13 @@
 
 #include <cstring>
 #include <cstdio>
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C" {
+    // set by libnx when the heap is created, sbrk() grows up to this.
+    extern char* fake_heap_end;
+} // extern "C"
 
 namespace sphaira::utils {
 namespace {
@@ -55,4 +62,11 @@ std::string formatSizeNetwork(u64 size) {
     return formatSizeInetrnal(size, 1000.0);
 }
 
+u64 GetFreeHeapSize() {
+    // free chunks within the arena + memory not yet claimed by sbrk().
+    const auto info = mallinfo();
+    const auto brk = static_cast<char*>(sbrk(0));
+    return info.fordblks + (fake_heap_end - brk);
+}
+
 } // namespace sphaira::utils
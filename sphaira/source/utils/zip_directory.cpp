@@ -0,0 +1,167 @@
+#include "utils/zip_directory.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+namespace sphaira::utils::zip {
+namespace {
+
+#define FILE_HEADER_SIG 0x2014B50
+#define END_RECORD_SIG 0x6054B50
+
+// 46 bytes (0x2E)
+#pragma pack(push,1)
+typedef struct mmz_FileHeader {
+    uint32_t sig;
+    uint16_t version;
+    uint16_t version_needed;
+    uint16_t flags;
+    uint16_t compression;
+    uint16_t modtime;
+    uint16_t moddate;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint16_t filename_len;
+    uint16_t extrafield_len;
+    uint16_t filecomment_len;
+    uint16_t disk_start; // wat
+    uint16_t internal_attr; // wat
+    uint32_t external_attr; // wat
+    uint32_t local_hdr_off;
+} mmz_FileHeader;
+#pragma pack(pop)
+
+#pragma pack(push,1)
+typedef struct mmz_EndRecord {
+    uint32_t sig;
+    uint16_t disk_number;
+    uint16_t disk_wcd;
+    uint16_t disk_entries;
+    uint16_t total_entries;
+    uint32_t central_directory_size;
+    uint32_t file_hdr_off;
+    uint16_t comment_len;
+} mmz_EndRecord;
+#pragma pack(pop)
+
+auto BuildPath(const std::string& path) -> std::string {
+    if (path.starts_with('/')) {
+        return path;
+    }
+    return "/" + path;
+}
+
+void Parse(const FileTableEntries& entries, u32& index, DirectoryEntry& out) {
+    for (; index < entries.size(); index++) {
+        const auto path = BuildPath(entries[index].path);
+
+        // check if this path belongs to this dir, "/dir10" isn't in "/dir1".
+        if (!path.starts_with(out.path) || (out.path.length() > 1 && path[out.path.length()] != '/')) {
+            return;
+        }
+
+        if (path.ends_with('/')) {
+            auto& new_entry = out.dir_child.emplace_back();
+            new_entry.path = path.substr(0, path.length() - 1);
+
+            u32 new_index = index + 1;
+            Parse(entries, new_index, new_entry);
+            index = new_index - 1;
+        } else {
+            // check if this file actually belongs to this folder.
+            const auto idx = path.find_first_of('/', out.path.length() + 1);
+            const auto sub = path.substr(0, idx);
+
+            if (idx != path.npos && out.path != sub) {
+                auto& new_entry = out.dir_child.emplace_back();
+                new_entry.path = sub;
+                Parse(entries, index, new_entry);
+                // index is the first entry not in the new dir, so check it again.
+                index--;
+            } else {
+                auto& new_entry = out.file_child.emplace_back(entries[index]);
+                new_entry.path = path;
+            }
+        }
+    }
+}
+
+Result find_central_dir_offset(yati::source::Base* source, s64 size, mmz_EndRecord* record) {
+    // check if the record is at the end (no extra header).
+    auto offset = size - sizeof(*record);
+    R_TRY(source->Read2(record, offset, sizeof(*record)));
+
+    if (record->sig == END_RECORD_SIG) {
+        R_SUCCEED();
+    }
+
+    // failed, find the sig by reading the last 64k and loop across it.
+    const auto rsize = std::min<u64>(UINT16_MAX, size);
+    offset = size - rsize;
+    std::vector<u8> data(rsize);
+    R_TRY(source->Read2(data.data(), offset, data.size()));
+
+    // check in reverse order as it's more likely at the end.
+    for (s64 i = data.size() - sizeof(*record); i >= 0; i--) {
+        u32 sig;
+        std::memcpy(&sig, data.data() + i, sizeof(sig));
+        if (sig == END_RECORD_SIG) {
+            std::memcpy(record, data.data() + i, sizeof(*record));
+            R_SUCCEED();
+        }
+    }
+
+    R_THROW(0x1);
+}
+
+} // namespace
+
+Result ParseCentralDirectory(yati::source::Base* source, s64 size, FileTableEntries& out) {
+    mmz_EndRecord end_rec;
+    R_TRY(find_central_dir_offset(source, size, &end_rec));
+
+    out.reserve(end_rec.total_entries);
+    auto file_header_off = end_rec.file_hdr_off;
+
+    for (u16 i = 0; i < end_rec.total_entries; i++) {
+        // read the file header.
+        mmz_FileHeader file_hdr{};
+        R_TRY(source->Read2(&file_hdr, file_header_off, sizeof(file_hdr)));
+
+        if (file_hdr.sig != FILE_HEADER_SIG) {
+            log_write("[ZIP] invalid file record\n");
+            R_THROW(0x1);
+        }
+
+        // save all the data hat we care about.
+        auto& new_entry = out.emplace_back();
+        new_entry.flags = file_hdr.flags;
+        new_entry.compression_type = file_hdr.compression;
+        new_entry.modtime = file_hdr.modtime;
+        new_entry.moddate = file_hdr.moddate;
+        new_entry.compressed_size = file_hdr.compressed_size;
+        new_entry.uncompressed_size = file_hdr.uncompressed_size;
+        new_entry.local_file_header_off = file_hdr.local_hdr_off;
+
+        // read the file name.
+        const auto filename_off = file_header_off + sizeof(file_hdr);
+        new_entry.path.resize(file_hdr.filename_len);
+        R_TRY(source->Read2(new_entry.path.data(), filename_off, new_entry.path.size()));
+
+        // advance the offset.
+        file_header_off += sizeof(file_hdr) + file_hdr.filename_len + file_hdr.extrafield_len + file_hdr.filecomment_len;
+    }
+
+    R_SUCCEED();
+}
+
+void BuildTree(const FileTableEntries& entries, DirectoryEntry& out) {
+    u32 index = 0;
+    out.path = "/"; // add root folder.
+    Parse(entries, index, out);
+}
+
+} // namespace sphaira::utils::zip
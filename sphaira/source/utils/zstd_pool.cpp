@@ -0,0 +1,136 @@
+#include "utils/zstd_pool.hpp"
+#include "utils/mem_track.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <vector>
+
+namespace sphaira::utils::zstd {
+namespace {
+
+// the install pipeline uses 1 for streaming + 3 for block ncz.
+constexpr u32 MAX_CACHED_DCTX = 4;
+// cctx are large, and only used by the nsz dumper.
+constexpr u32 MAX_CACHED_CCTX = 1;
+
+Mutex g_mutex{};
+std::vector<ZSTD_DCtx*> g_dctx{};
+std::vector<ZSTD_CCtx*> g_cctx{};
+
+#ifdef ENABLE_MEM_TRACK
+void* ZstdAlloc(void* opaque, size_t size) {
+    return mem::Malloc(mem::Tag_Zstd, size);
+}
+
+void ZstdFree(void* opaque, void* ptr) {
+    mem::Free(ptr);
+}
+
+constexpr ZSTD_customMem ZSTD_MEM{ZstdAlloc, ZstdFree, nullptr};
+
+auto CreateDCtx() -> ZSTD_DCtx* {
+    return ZSTD_createDCtx_advanced(ZSTD_MEM);
+}
+
+auto CreateCCtx() -> ZSTD_CCtx* {
+    return ZSTD_createCCtx_advanced(ZSTD_MEM);
+}
+#else
+auto CreateDCtx() -> ZSTD_DCtx* {
+    return ZSTD_createDCtx();
+}
+
+auto CreateCCtx() -> ZSTD_CCtx* {
+    return ZSTD_createCCtx();
+}
+#endif // ENABLE_MEM_TRACK
+
+} // namespace
+
+auto AcquireDCtx() -> ZSTD_DCtx* {
+    {
+        SCOPED_MUTEX(&g_mutex);
+        if (!g_dctx.empty()) {
+            auto dctx = g_dctx.back();
+            g_dctx.pop_back();
+            return dctx;
+        }
+    }
+
+    return CreateDCtx();
+}
+
+void ReleaseDCtx(ZSTD_DCtx* dctx) {
+    if (!dctx) {
+        return;
+    }
+
+    // drop the context if it's in a bad state.
+    if (ZSTD_isError(ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters))) {
+        ZSTD_freeDCtx(dctx);
+        return;
+    }
+
+    {
+        SCOPED_MUTEX(&g_mutex);
+        if (g_dctx.size() < MAX_CACHED_DCTX) {
+            g_dctx.emplace_back(dctx);
+            return;
+        }
+    }
+
+    ZSTD_freeDCtx(dctx);
+}
+
+auto AcquireCCtx() -> ZSTD_CCtx* {
+    {
+        SCOPED_MUTEX(&g_mutex);
+        if (!g_cctx.empty()) {
+            auto cctx = g_cctx.back();
+            g_cctx.pop_back();
+            return cctx;
+        }
+    }
+
+    return CreateCCtx();
+}
+
+void ReleaseCCtx(ZSTD_CCtx* cctx) {
+    if (!cctx) {
+        return;
+    }
+
+    // resets the parameters so that the next user starts from the defaults.
+    if (ZSTD_isError(ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters))) {
+        ZSTD_freeCCtx(cctx);
+        return;
+    }
+
+    {
+        SCOPED_MUTEX(&g_mutex);
+        if (g_cctx.size() < MAX_CACHED_CCTX) {
+            g_cctx.emplace_back(cctx);
+            return;
+        }
+    }
+
+    ZSTD_freeCCtx(cctx);
+}
+
+void Trim() {
+    SCOPED_MUTEX(&g_mutex);
+
+    for (auto dctx : g_dctx) {
+        ZSTD_freeDCtx(dctx);
+    }
+
+    for (auto cctx : g_cctx) {
+        ZSTD_freeCCtx(cctx);
+    }
+
+    log_write("[ZSTD] trimmed dctx: %zu cctx: %zu\n", g_dctx.size(), g_cctx.size());
+    g_dctx.clear();
+    g_cctx.clear();
+}
+
+} // namespace sphaira::utils::zstd
@@ -0,0 +1,546 @@
+#include "verify.hpp"
+#include "hasher.hpp"
+#include "app.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+#include "i18n.hpp"
+#include "tree_walk.hpp"
+#include "utils/thread.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/path_index.hpp"
+
+#include <yyjson.h>
+#include <atomic>
+#include <algorithm>
+#include <ranges>
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+
+namespace sphaira::verify {
+namespace {
+
+constexpr fs::FsPath RESULTS_DIR{"/switch/sphaira/cache/verify"};
+constexpr s64 READ_CHUNK_SIZE = 1024 * 1024;
+constexpr u32 WORKER_MAX = 4;
+
+constexpr const char* STATUS_STR[]{
+    "ok", "mismatch", "missing", "error",
+};
+
+auto trim(std::string_view str) -> std::string_view {
+    while (!str.empty() && std::isspace((u8)str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && std::isspace((u8)str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+auto is_hex(std::string_view str) -> bool {
+    return !str.empty() && std::ranges::all_of(str, [](char c){
+        return std::isxdigit((u8)c);
+    });
+}
+
+auto to_lower(std::string_view str) -> std::string {
+    std::string out{str};
+    for (auto& c : out) {
+        c = std::tolower((u8)c);
+    }
+    return out;
+}
+
+auto make_path(std::string_view path) -> fs::FsPath {
+    std::string out{trim(path)};
+    std::ranges::replace(out, '\\', '/');
+    while (out.starts_with('/')) {
+        out.erase(0, 1);
+    }
+    return out;
+}
+
+// works out the type from the length of the hash.
+bool set_hash(Entry& e, std::string_view hash) {
+    hash = trim(hash);
+    if (!is_hex(hash)) {
+        return false;
+    }
+
+    switch (hash.length()) {
+        case 8: e.crc32 = to_lower(hash); return true;
+        case 32: e.md5 = to_lower(hash); return true;
+        case 40: e.sha1 = to_lower(hash); return true;
+        case 64: e.sha256 = to_lower(hash); return true;
+    }
+
+    return false;
+}
+
+template<typename F>
+void for_each_line(std::string_view text, F&& func) {
+    for (const auto line : std::views::split(text, '\n')) {
+        const auto view = trim(std::string_view{line.begin(), line.end()});
+        if (!view.empty()) {
+            func(view);
+        }
+    }
+}
+
+// "path crc32", lines starting with ';' are comments.
+void parse_sfv(std::string_view text, std::vector<Entry>& out) {
+    for_each_line(text, [&out](std::string_view line) {
+        const auto space = line.find_last_of(" \t");
+        if (line.starts_with(';') || space == line.npos) {
+            return;
+        }
+
+        Entry e{};
+        e.path = make_path(line.substr(0, space));
+        if (set_hash(e, line.substr(space + 1)) && !e.path.empty()) {
+            out.emplace_back(e);
+        }
+    });
+}
+
+// "hash  path" or "hash *path", as output by md5sum / sha1sum etc.
+void parse_sum(std::string_view text, std::vector<Entry>& out) {
+    for_each_line(text, [&out](std::string_view line) {
+        const auto space = line.find_first_of(" \t");
+        if (line.starts_with('#') || space == line.npos) {
+            return;
+        }
+
+        auto path = trim(line.substr(space + 1));
+        if (path.starts_with('*')) {
+            path.remove_prefix(1);
+        }
+
+        Entry e{};
+        e.path = make_path(path);
+        if (set_hash(e, line.substr(0, space)) && !e.path.empty()) {
+            out.emplace_back(e);
+        }
+    });
+}
+
+auto get_xml_attr(std::string_view tag, std::string_view name) -> std::string {
+    for (size_t pos = 0; (pos = tag.find(name, pos)) != tag.npos; pos += name.length()) {
+        // make sure this is the whole attribute name, ie not "sha1" in "xsha1".
+        if (pos && !std::isspace((u8)tag[pos - 1])) {
+            continue;
+        }
+
+        auto rest = tag.substr(pos + name.length());
+        if (!rest.starts_with("=\"")) {
+            continue;
+        }
+
+        rest.remove_prefix(2);
+        const auto value = rest.substr(0, rest.find('"'));
+
+        std::string out;
+        for (size_t i = 0; i < value.length(); i++) {
+            if (value[i] == '&') {
+                constexpr std::pair<std::string_view, char> ENTITIES[]{
+                    {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''},
+                };
+
+                const auto it = std::ranges::find_if(ENTITIES, [&](const auto& e){
+                    return value.substr(i).starts_with(e.first);
+                });
+
+                if (it != std::end(ENTITIES)) {
+                    out += it->second;
+                    i += it->first.length() - 1;
+                    continue;
+                }
+            }
+            out += value[i];
+        }
+
+        return out;
+    }
+
+    return {};
+}
+
+// logiqx xml dat, as used by no-intro / redump.
+void parse_dat(std::string_view text, std::vector<Entry>& out) {
+    for (size_t pos = 0; (pos = text.find("<rom ", pos)) != text.npos;) {
+        const auto end = text.find('>', pos);
+        if (end == text.npos) {
+            break;
+        }
+
+        const auto tag = text.substr(pos, end - pos);
+        pos = end;
+
+        Entry e{};
+        e.path = make_path(get_xml_attr(tag, "name"));
+        if (e.path.empty()) {
+            continue;
+        }
+
+        if (const auto size = get_xml_attr(tag, "size"); !size.empty()) {
+            e.size = std::strtoll(size.c_str(), nullptr, 10);
+        }
+
+        set_hash(e, get_xml_attr(tag, "crc"));
+        set_hash(e, get_xml_attr(tag, "md5"));
+        set_hash(e, get_xml_attr(tag, "sha1"));
+        set_hash(e, get_xml_attr(tag, "sha256"));
+        out.emplace_back(e);
+    }
+}
+
+// { "path": "hash" } or { "path": { "size": 0, "crc32": "", "md5": "", ... } }
+void parse_json(std::span<u8> data, std::vector<Entry>& out) {
+    auto doc = yyjson_read((const char*)data.data(), data.size(), YYJSON_READ_NOFLAG);
+    if (!doc) {
+        return;
+    }
+    ON_SCOPE_EXIT(yyjson_doc_free(doc));
+
+    const auto root = yyjson_doc_get_root(doc);
+    if (!yyjson_is_obj(root)) {
+        return;
+    }
+
+    yyjson_obj_iter iter;
+    yyjson_obj_iter_init(root, &iter);
+    while (const auto key = yyjson_obj_iter_next(&iter)) {
+        const auto val = yyjson_obj_iter_get_val(key);
+
+        Entry e{};
+        e.path = make_path(yyjson_get_str(key));
+
+        if (yyjson_is_str(val)) {
+            set_hash(e, yyjson_get_str(val));
+        } else if (yyjson_is_obj(val)) {
+            if (const auto size = yyjson_obj_get(val, "size"); yyjson_is_int(size)) {
+                e.size = yyjson_get_sint(size);
+            }
+
+            for (const auto name : { "crc32", "crc", "md5", "sha1", "sha256" }) {
+                if (const auto hash = yyjson_obj_get(val, name); yyjson_is_str(hash)) {
+                    set_hash(e, yyjson_get_str(hash));
+                }
+            }
+        }
+
+        if (!e.path.empty()) {
+            out.emplace_back(e);
+        }
+    }
+}
+
+auto get_extension(std::string_view path) -> std::string {
+    const auto dot = path.find_last_of('.');
+    if (dot == path.npos || path.find('/', dot) != path.npos) {
+        return {};
+    }
+    return to_lower(path.substr(dot + 1));
+}
+
+struct ThreadData {
+    ThreadData(fs::Fs* _fs, const fs::FsPath& _base, std::span<const Entry> _entries)
+    : fs{_fs}
+    , base{_base}
+    , entries{_entries} {
+        mutexInit(std::addressof(mutex));
+    }
+
+    auto VerifyEntry(const Entry& e, std::string& reason) -> Status;
+    void workerFuncInternal();
+
+    fs::Fs* const fs;
+    const fs::FsPath base;
+    const std::span<const Entry> entries;
+    // index of the entries that still need verifying.
+    std::vector<u32> pending{};
+
+    Mutex mutex{};
+    // finished entries that haven't been reported yet, protected by mutex.
+    std::vector<Failure> finished{};
+
+    std::atomic<size_t> next_index{};
+    std::atomic<s64> bytes_done{};
+    std::atomic_bool stop{};
+};
+
+auto ThreadData::VerifyEntry(const Entry& e, std::string& reason) -> Status {
+    const auto path = fs::AppendPath(base, e.path);
+
+    fs::File f;
+    if (R_FAILED(fs->OpenFile(path, FsOpenMode_Read, &f))) {
+        return fs->FileExists(path) ? Status::Error : Status::Missing;
+    }
+
+    s64 size;
+    if (R_FAILED(f.GetSize(&size))) {
+        return Status::Error;
+    }
+
+    if (e.size >= 0 && size != e.size) {
+        reason = "size " + std::to_string(size) + " != " + std::to_string(e.size);
+        return Status::Mismatch;
+    }
+
+    // every listed hash is calculated from a single read of the file.
+    struct Check {
+        hash::Type type;
+        const std::string& expected;
+        std::unique_ptr<hash::HashSource> hash;
+    };
+
+    std::vector<Check> checks;
+    const std::pair<hash::Type, const std::string&> listed[]{
+        { hash::Type::Crc32, e.crc32 }, { hash::Type::Md5, e.md5 }, { hash::Type::Sha1, e.sha1 }, { hash::Type::Sha256, e.sha256 },
+    };
+
+    for (const auto& [type, expected] : listed) {
+        if (!expected.empty()) {
+            checks.emplace_back(type, expected, hash::Create(type));
+        }
+    }
+
+    if (!checks.empty()) {
+        utils::pool::Vector<u8> buf(std::min(READ_CHUNK_SIZE, std::max<s64>(size, 1)));
+        for (s64 off = 0; off < size && !stop;) {
+            u64 bytes_read;
+            if (R_FAILED(f.Read(off, buf.data(), std::min<s64>(buf.size(), size - off), 0, &bytes_read)) || !bytes_read) {
+                return Status::Error;
+            }
+
+            for (auto& c : checks) {
+                c.hash->Update(buf.data(), bytes_read, size);
+            }
+
+            off += bytes_read;
+            bytes_done += bytes_read;
+        }
+
+        if (stop) {
+            return Status::Error;
+        }
+
+        for (auto& c : checks) {
+            std::string got;
+            c.hash->Get(got);
+            if (got != c.expected) {
+                reason = std::string{hash::GetTypeStr(c.type)} + " " + got + " != " + c.expected;
+                return Status::Mismatch;
+            }
+        }
+    }
+
+    return Status::Ok;
+}
+
+void ThreadData::workerFuncInternal() {
+    while (!stop) {
+        const auto index = next_index++;
+        if (index >= pending.size()) {
+            break;
+        }
+
+        const auto& e = entries[pending[index]];
+        Failure result{e.path};
+        result.status = VerifyEntry(e, result.reason);
+
+        // don't store entries that were cut short, so that they're checked next time.
+        if (stop) {
+            break;
+        }
+
+        SCOPED_MUTEX(std::addressof(mutex));
+        finished.emplace_back(std::move(result));
+    }
+}
+
+void workerFunc(void* d) {
+    App::ComputeBoost boost;
+    static_cast<ThreadData*>(d)->workerFuncInternal();
+}
+
+void add_to_report(Report& out, const Failure& result) {
+    switch (result.status) {
+        case Status::Ok: out.ok++; return;
+        case Status::Mismatch: out.mismatch++; break;
+        case Status::Missing: out.missing++; break;
+        case Status::Error: out.error++; break;
+    }
+    out.failures.emplace_back(result);
+}
+
+// loads the results of a previous run, the format is "status\tpath\treason".
+void load_results(const fs::FsPath& path, utils::PathIndex& done, Report& out) {
+    std::vector<u8> data;
+    if (R_FAILED(fs::FsNativeSd().read_entire_file(path, data))) {
+        return;
+    }
+
+    for_each_line(std::string_view{(const char*)data.data(), data.size()}, [&](std::string_view line){
+        const auto tab = line.find('\t');
+        if (tab == line.npos) {
+            return;
+        }
+
+        const auto status = line.substr(0, tab);
+        auto rest = line.substr(tab + 1);
+        const auto tab2 = rest.find('\t');
+        const auto file = rest.substr(0, tab2);
+
+        const auto it = std::ranges::find(STATUS_STR, status);
+        if (it == std::end(STATUS_STR) || !done.Add(file, 0)) {
+            return;
+        }
+
+        Failure result{file};
+        result.status = (Status)(it - std::begin(STATUS_STR));
+        if (tab2 != rest.npos) {
+            result.reason = rest.substr(tab2 + 1);
+        }
+
+        add_to_report(out, result);
+        out.resumed++;
+    });
+}
+
+} // namespace
+
+auto IsManifest(std::string_view path) -> bool {
+    const auto ext = get_extension(path);
+    return ext == "sfv" || ext == "md5" || ext == "sha1" || ext == "sha256" || ext == "dat" || ext == "json";
+}
+
+Result LoadManifest(fs::Fs* fs, const fs::FsPath& path, std::vector<Entry>& out) {
+    std::vector<u8> data;
+    R_TRY(fs->read_entire_file(path, data));
+
+    const std::string_view text{(const char*)data.data(), data.size()};
+    const auto ext = get_extension(path);
+
+    if (ext == "sfv") {
+        parse_sfv(text, out);
+    } else if (ext == "dat") {
+        parse_dat(text, out);
+    } else if (ext == "json") {
+        parse_json(data, out);
+    } else {
+        parse_sum(text, out);
+    }
+
+    log_write("[VERIFY] loaded %zu entries from %s\n", out.size(), path.s);
+    R_UNLESS(!out.empty(), Result_FsEmpty);
+    R_SUCCEED();
+}
+
+auto GetResultsPath(const fs::FsPath& manifest_path) -> fs::FsPath {
+    char path[FS_MAX_PATH];
+    std::snprintf(path, sizeof(path), "%s/%08x.txt", RESULTS_DIR.s, crc32Calculate(manifest_path.s, manifest_path.size()));
+    return path;
+}
+
+Result Verify(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& manifest_path, std::span<const Entry> entries, Report& out) {
+    out = {};
+
+    const auto results_path = GetResultsPath(manifest_path);
+    utils::PathIndex done;
+    load_results(results_path, done, out);
+
+    std::string base{manifest_path.s};
+    base.resize(base.find_last_of('/') + 1);
+
+    ThreadData t_data{fs, base, entries};
+    for (u32 i = 0; i < entries.size(); i++) {
+        u32 value;
+        if (!done.Find(entries[i].path.s, value)) {
+            t_data.pending.emplace_back(i);
+        }
+    }
+
+    log_write("[VERIFY] %zu entries to verify, %u from the last run\n", t_data.pending.size(), out.resumed);
+    if (t_data.pending.empty()) {
+        R_SUCCEED();
+    }
+
+    fs::FsNativeSd sd_fs;
+    sd_fs.CreateDirectoryRecursively(RESULTS_DIR);
+    // this fails if it already exists, which is fine.
+    sd_fs.CreateFile(results_path);
+
+    fs::File results_file;
+    R_TRY(sd_fs.OpenFile(results_path, FsOpenMode_Write | FsOpenMode_Append, &results_file));
+    s64 results_off;
+    R_TRY(results_file.GetSize(&results_off));
+
+    const auto worker_count = std::min<u32>({walk::GetWorkerCount(fs), WORKER_MAX, (u32)t_data.pending.size()});
+    Thread t_workers[WORKER_MAX]{};
+    u32 t_worker_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadClose(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < worker_count; i++) {
+        R_TRY(utils::CreateThread(&t_workers[i], workerFunc, std::addressof(t_data), utils::ThreadRole::Compute));
+        t_worker_count++;
+    }
+
+    ON_SCOPE_EXIT(
+        // ensure the workers exit if we return early.
+        t_data.stop = true;
+        for (u32 i = 0; i < t_worker_count; i++) {
+            threadWaitForExit(&t_workers[i]);
+        }
+    );
+
+    for (u32 i = 0; i < t_worker_count; i++) {
+        R_TRY(threadStart(&t_workers[i]));
+    }
+
+    const auto start = armGetSystemTick();
+    size_t files_done{};
+    pbox->NewTransfer("Verifying files"_i18n);
+
+    while (files_done < t_data.pending.size()) {
+        R_TRY(pbox->ShouldExitResult());
+        svcSleepThread(1e+8); // 100ms
+
+        std::vector<Failure> finished;
+        {
+            SCOPED_MUTEX(std::addressof(t_data.mutex));
+            std::swap(finished, t_data.finished);
+        }
+
+        // results are written as they finish so that the verify can be resumed.
+        std::string lines;
+        for (const auto& result : finished) {
+            lines += std::string{STATUS_STR[(u32)result.status]} + "\t" + result.path.s + "\t" + result.reason + "\n";
+            add_to_report(out, result);
+        }
+
+        if (!lines.empty()) {
+            R_TRY(results_file.Write(results_off, lines.data(), lines.size(), FsWriteOption_None));
+            results_off += lines.size();
+        }
+
+        files_done += finished.size();
+        out.bytes = t_data.bytes_done;
+        out.elapsed_ns = armTicksToNs(armGetSystemTick() - start);
+
+        char str[128];
+        std::snprintf(str, sizeof(str), "%zu / %zu files, %u failed"_i18n.c_str(), files_done + out.resumed, entries.size(), out.mismatch + out.missing + out.error);
+        pbox->SetTitle(str);
+        pbox->UpdateTransfer(files_done, t_data.pending.size());
+    }
+
+    log_write("[VERIFY] verified %zu files, %.2f MiB in %.2fs\n", files_done, out.bytes / 1024.0 / 1024.0, out.elapsed_ns / 1e+9);
+    R_SUCCEED();
+}
+
+} // namespace sphaira::verify
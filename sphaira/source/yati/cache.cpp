@@ -0,0 +1,205 @@
+#include "yati/cache.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sphaira::yati::cache {
+namespace {
+
+constexpr fs::FsPath CACHE_PATH{"/switch/sphaira/cache/install.cache"};
+constexpr u32 CACHE_MAGIC = 0x48434E49; // INCH
+// bump this when the layout changes.
+constexpr u32 CACHE_VERSION = 1;
+// oldest entries are dropped once full.
+constexpr u32 CACHE_MAX_ENTRIES = 16;
+// sanity limit for the number of collections / ncas in an entry.
+constexpr u32 CACHE_MAX_COUNT = 0x1000;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 count;
+};
+
+struct EntryHeader {
+    u8 key[SHA256_HASH_SIZE];
+    u32 collection_count;
+    u32 verified_count;
+};
+
+struct Reader {
+    bool Read(void* out, size_t size) {
+        if (off + size > data.size()) {
+            return false;
+        }
+
+        std::memcpy(out, data.data() + off, size);
+        off += size;
+        return true;
+    }
+
+    const std::vector<u8>& data;
+    size_t off{};
+};
+
+struct Writer {
+    void Write(const void* in, size_t size) {
+        const auto ptr = static_cast<const u8*>(in);
+        data.insert(data.end(), ptr, ptr + size);
+    }
+
+    std::vector<u8>& data;
+};
+
+// zero is the initial state, so it doesn't need an init.
+Mutex g_mutex{};
+
+bool ReadEntry(Reader& r, Entry& out) {
+    EntryHeader header;
+    if (!r.Read(&header, sizeof(header)) || header.collection_count > CACHE_MAX_COUNT || header.verified_count > CACHE_MAX_COUNT) {
+        return false;
+    }
+
+    std::memcpy(out.key, header.key, sizeof(out.key));
+    out.collections.resize(header.collection_count);
+    out.verified.resize(header.verified_count);
+
+    for (auto& e : out.collections) {
+        u32 name_len;
+        if (!r.Read(&name_len, sizeof(name_len)) || name_len > FS_MAX_PATH) {
+            return false;
+        }
+
+        e.name.resize(name_len);
+        if (!r.Read(e.name.data(), name_len) || !r.Read(&e.offset, sizeof(e.offset)) || !r.Read(&e.size, sizeof(e.size))) {
+            return false;
+        }
+    }
+
+    return r.Read(out.verified.data(), out.verified.size() * sizeof(NcmContentId));
+}
+
+void WriteEntry(Writer& w, const Entry& e) {
+    EntryHeader header{};
+    std::memcpy(header.key, e.key, sizeof(header.key));
+    header.collection_count = e.collections.size();
+    header.verified_count = e.verified.size();
+    w.Write(&header, sizeof(header));
+
+    for (const auto& c : e.collections) {
+        const u32 name_len = c.name.size();
+        w.Write(&name_len, sizeof(name_len));
+        w.Write(c.name.data(), name_len);
+        w.Write(&c.offset, sizeof(c.offset));
+        w.Write(&c.size, sizeof(c.size));
+    }
+
+    w.Write(e.verified.data(), e.verified.size() * sizeof(NcmContentId));
+}
+
+// must be called with the lock held.
+auto Load(fs::Fs* fs) -> std::vector<Entry> {
+    std::vector<u8> data;
+    if (R_FAILED(fs->read_entire_file(CACHE_PATH, data))) {
+        return {};
+    }
+
+    Reader r{data};
+    FileHeader header;
+    if (!r.Read(&header, sizeof(header)) || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.count > CACHE_MAX_ENTRIES) {
+        log_write("[CACHE] ignoring invalid cache\n");
+        return {};
+    }
+
+    std::vector<Entry> entries(header.count);
+    for (auto& e : entries) {
+        if (!ReadEntry(r, e)) {
+            log_write("[CACHE] ignoring truncated cache\n");
+            return {};
+        }
+    }
+
+    return entries;
+}
+
+} // namespace
+
+auto Entry::IsVerified(const NcmContentId& content_id) const -> bool {
+    return std::ranges::any_of(verified, [&content_id](auto& e){
+        return !std::memcmp(&e, &content_id, sizeof(content_id));
+    });
+}
+
+bool CreateKey(fs::Fs* fs, const fs::FsPath& path, u8 (&out)[SHA256_HASH_SIZE]) {
+    FsTimeStampRaw ts{};
+    s64 size;
+    if (R_FAILED(fs->FileGetSizeAndTimestamp(path, &ts, &size)) || !ts.is_valid) {
+        return false;
+    }
+
+    const auto root = fs->Root();
+
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
+    sha256ContextUpdate(&ctx, root.s, std::strlen(root));
+    sha256ContextUpdate(&ctx, path.s, std::strlen(path));
+    sha256ContextUpdate(&ctx, &size, sizeof(size));
+    sha256ContextUpdate(&ctx, &ts.modified, sizeof(ts.modified));
+    sha256ContextGetHash(&ctx, out);
+    return true;
+}
+
+bool Find(const u8 (&key)[SHA256_HASH_SIZE], Entry& out) {
+    SCOPED_MUTEX(&g_mutex);
+
+    fs::FsNativeSd fs;
+    auto entries = Load(&fs);
+
+    const auto it = std::ranges::find_if(entries, [&key](auto& e){
+        return !std::memcmp(e.key, key, sizeof(key));
+    });
+
+    if (it == entries.end()) {
+        return false;
+    }
+
+    log_write("[CACHE] found entry, collections: %zu verified: %zu\n", it->collections.size(), it->verified.size());
+    out = std::move(*it);
+    return true;
+}
+
+Result Update(const Entry& entry) {
+    SCOPED_MUTEX(&g_mutex);
+
+    fs::FsNativeSd fs;
+    auto entries = Load(&fs);
+
+    std::erase_if(entries, [&entry](auto& e){
+        return !std::memcmp(e.key, entry.key, sizeof(entry.key));
+    });
+
+    entries.insert(entries.begin(), entry);
+    if (entries.size() > CACHE_MAX_ENTRIES) {
+        entries.resize(CACHE_MAX_ENTRIES);
+    }
+
+    std::vector<u8> data;
+    Writer w{data};
+
+    FileHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.count = entries.size();
+    w.Write(&header, sizeof(header));
+
+    for (const auto& e : entries) {
+        WriteEntry(w, e);
+    }
+
+    fs.CreateDirectoryRecursivelyWithPath(CACHE_PATH);
+    return fs.write_entire_file(CACHE_PATH, data);
+}
+
+} // namespace sphaira::yati::cache
@@ -0,0 +1,56 @@
+#include "yati/container/base.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <cstring>
+
+namespace sphaira::yati::container {
+namespace {
+
+// big enough for the header of most nsp / xci partitions.
+constexpr s64 HEADER_WINDOW_SIZE = 1024 * 64;
+
+// the header shared by pfs0 and hfs0.
+struct PartitionHeader {
+    u32 magic;
+    u32 total_files;
+    u32 string_table_size;
+    u32 padding;
+};
+
+} // namespace
+
+Result Base::ReadPartitionHeader(Source* source, s64 off, u32 magic, Result bad_magic, u64 entry_size, std::vector<u8>& out) {
+    u64 bytes_read{};
+
+    // streams can't seek backwards, so they can't read past the header.
+    if (!source->IsStream()) {
+        out.resize(HEADER_WINDOW_SIZE);
+        // this can fail if the window is past the end of the file.
+        if (R_FAILED(source->Read(out.data(), off, out.size(), &bytes_read))) {
+            bytes_read = 0;
+        }
+    }
+
+    if (bytes_read < sizeof(PartitionHeader)) {
+        out.resize(sizeof(PartitionHeader));
+        R_TRY(source->Read2(out.data(), off, out.size()));
+        bytes_read = out.size();
+    }
+
+    PartitionHeader header;
+    std::memcpy(&header, out.data(), sizeof(header));
+    R_UNLESS(header.magic == magic, bad_magic);
+
+    const auto size = sizeof(header) + header.total_files * entry_size + header.string_table_size;
+    if (bytes_read < size) {
+        log_write("[CONTAINER] header is larger than the window: %zu\n", size);
+        out.resize(size);
+        R_TRY(source->Read2(out.data() + bytes_read, off + bytes_read, size - bytes_read));
+    }
+
+    out.resize(size);
+    R_SUCCEED();
+}
+
+} // namespace sphaira::yati::container
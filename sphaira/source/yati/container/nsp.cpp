@@ -62,28 +62,23 @@ Result Nsp::GetCollections(Collections& out) {
 }
 
 Result Nsp::GetCollections(Collections& out, s64 off) {
-    u64 bytes_read;
+    // get header, file table and string table.
+    std::vector<u8> data;
+    R_TRY(ReadPartitionHeader(m_source, off, PFS0_MAGIC, Result_NspBadMagic, sizeof(Pfs0FileTableEntry), data));
+    off += data.size();
 
-    // get header
-    Pfs0Header header{};
-    R_TRY(m_source->Read(std::addressof(header), off, sizeof(header), std::addressof(bytes_read)));
-    R_UNLESS(header.magic == PFS0_MAGIC, Result_NspBadMagic);
-    off += bytes_read;
+    Pfs0Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
 
-    // get file table
     std::vector<Pfs0FileTableEntry> file_table(header.total_files);
-    R_TRY(m_source->Read(file_table.data(), off, file_table.size() * sizeof(Pfs0FileTableEntry), std::addressof(bytes_read)))
-    off += bytes_read;
+    std::memcpy(file_table.data(), data.data() + sizeof(header), file_table.size() * sizeof(Pfs0FileTableEntry));
 
-    // get string table
-    std::vector<char> string_table(header.string_table_size);
-    R_TRY(m_source->Read(string_table.data(), off, string_table.size(), std::addressof(bytes_read)))
-    off += bytes_read;
+    const auto string_table = reinterpret_cast<const char*>(data.data() + sizeof(header) + file_table.size() * sizeof(Pfs0FileTableEntry));
 
     out.reserve(header.total_files);
     for (u32 i = 0; i < header.total_files; i++) {
         CollectionEntry entry;
-        entry.name = string_table.data() + file_table[i].name_offset;
+        entry.name = string_table + file_table[i].name_offset;
         entry.offset = off + file_table[i].data_offset;
         entry.size = file_table[i].data_size;
         out.emplace_back(entry);
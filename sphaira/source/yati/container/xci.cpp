@@ -3,6 +3,8 @@
 #include "log.hpp"
 
 #include <cstring>
+#include <numeric>
+#include <algorithm>
 
 namespace sphaira::yati::container {
 namespace {
@@ -12,6 +14,16 @@ namespace {
 #define HFS0_ROOT_HEADER_OFFSET 0xF000
 #define HFS0_ROOT_HEADER_OFFSET_WITH_KEY_AREA (HFS0_ROOT_HEADER_OFFSET + 0x1000)
 
+// partitions sorted by offset, so that they can be read from a stream.
+auto GetPartitionOrder(const Xci::Hfs0& root) -> std::vector<u32> {
+    std::vector<u32> order(root.header.total_files);
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&root](u32 a, u32 b) {
+        return root.file_table[a].data_offset < root.file_table[b].data_offset;
+    });
+    return order;
+}
+
 } // namespace
 
 auto Xci::Hfs0::GetHfs0Data() const -> std::vector<u8> {
@@ -33,36 +45,31 @@ auto Xci::Hfs0::GetHfs0Data() const -> std::vector<u8> {
 }
 
 Result Xci::GetRoot(Root& out) {
-    // try and get root at normal offset.
-    s64 offset = HFS0_ROOT_HEADER_OFFSET;
-    auto rc = Hfs0GetPartition(m_source, offset, out.hfs0);
-    if (rc == Result_XciBadMagic) {
-        // otherwise, try and again as maybe the key area pre-prended.
-        offset = HFS0_ROOT_HEADER_OFFSET_WITH_KEY_AREA;
-        rc = Hfs0GetPartition(m_source, offset, out.hfs0);
+    R_TRY(GetRootHfs0(out));
+
+    // the partitions are read in offset order, but kept in table order.
+    out.partitions.resize(out.hfs0.header.total_files);
+    for (const auto i : GetPartitionOrder(out.hfs0)) {
+        auto& partition = out.partitions[i];
+        partition.name = out.hfs0.string_table[i];
+        R_TRY(ReadPartitionFromHfs0(m_source, out.hfs0, i, partition));
     }
 
-    if (R_SUCCEEDED(rc)) {
-        out.hfs0_offset = offset;
-
-        for (u32 i = 0; i < out.hfs0.header.total_files; i++) {
-            Partition partition{out.hfs0.string_table[i]};
-            R_TRY(ReadPartitionFromHfs0(m_source, out.hfs0, i, partition));
-            out.partitions.emplace_back(partition);
-        }
-    }
-
-    return rc;
+    R_SUCCEED();
 }
 
 Result Xci::GetCollections(Collections& out) {
     Root root;
-    R_TRY(GetRoot(root));
+    R_TRY(GetRootHfs0(root));
     log_write("[XCI] got root partition\n");
 
-    for (auto& parition : root.partitions) {
-        if (parition.name == "secure") {
-            out = parition.collections;
+    // only the secure partition is read, so that a stream only has to skip
+    // over the other partitions, rather than read their headers.
+    for (u32 i = 0; i < root.hfs0.header.total_files; i++) {
+        if (root.hfs0.string_table[i] == "secure") {
+            Partition partition{root.hfs0.string_table[i]};
+            R_TRY(ReadPartitionFromHfs0(m_source, root.hfs0, i, partition));
+            out = std::move(partition.collections);
             R_SUCCEED();
         }
     }
@@ -70,27 +77,36 @@ Result Xci::GetCollections(Collections& out) {
     return Result_XciSecurePartitionNotFound;
 }
 
+Result Xci::GetRootHfs0(Root& out) {
+    // try and get root at normal offset.
+    s64 offset = HFS0_ROOT_HEADER_OFFSET;
+    auto rc = Hfs0GetPartition(m_source, offset, out.hfs0);
+    if (rc == Result_XciBadMagic) {
+        // otherwise, try and again as maybe the key area pre-prended.
+        offset = HFS0_ROOT_HEADER_OFFSET_WITH_KEY_AREA;
+        out.hfs0 = {};
+        rc = Hfs0GetPartition(m_source, offset, out.hfs0);
+    }
+
+    R_TRY(rc);
+    out.hfs0_offset = offset;
+    R_SUCCEED();
+}
+
 Result Xci::Hfs0GetPartition(source::Base* source, s64 off, Hfs0& out) {
-    u64 bytes_read;
+    // get header, file table and string table.
+    std::vector<u8> data;
+    R_TRY(ReadPartitionHeader(source, off, HFS0_MAGIC, Result_XciBadMagic, sizeof(Hfs0FileTableEntry), data));
+    off += data.size();
 
-    // get header
-    R_TRY(source->Read(std::addressof(out.header), off, sizeof(out.header), std::addressof(bytes_read)));
-    log_write("checking magic: %X vs %X\n", out.header.magic, HFS0_MAGIC);
-    R_UNLESS(out.header.magic == HFS0_MAGIC, Result_XciBadMagic);
-    off += bytes_read;
+    std::memcpy(&out.header, data.data(), sizeof(out.header));
 
-    // get file table
     out.file_table.resize(out.header.total_files);
-    R_TRY(source->Read(out.file_table.data(), off, out.file_table.size() * sizeof(Hfs0FileTableEntry), std::addressof(bytes_read)))
-    off += bytes_read;
-
-    // get string table
-    std::vector<char> string_table(out.header.string_table_size);
-    R_TRY(source->Read(string_table.data(), off, string_table.size(), std::addressof(bytes_read)))
-    off += bytes_read;
+    std::memcpy(out.file_table.data(), data.data() + sizeof(out.header), out.file_table.size() * sizeof(Hfs0FileTableEntry));
 
+    const auto string_table = reinterpret_cast<const char*>(data.data() + sizeof(out.header) + out.file_table.size() * sizeof(Hfs0FileTableEntry));
     for (u32 i = 0; i < out.header.total_files; i++) {
-        out.string_table.emplace_back(string_table.data() + out.file_table[i].name_offset);
+        out.string_table.emplace_back(string_table + out.file_table[i].name_offset);
     }
 
     out.data_offset = off;
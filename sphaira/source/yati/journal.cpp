@@ -0,0 +1,146 @@
+#include "yati/journal.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sphaira::yati::journal {
+namespace {
+
+constexpr fs::FsPath JOURNAL_PATH{"/switch/sphaira/cache/install.journal"};
+constexpr u32 JOURNAL_MAGIC = 0x4C4E524A; // JRNL
+// bump this when Entry changes.
+constexpr u32 JOURNAL_VERSION = 1;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u8 key[SHA256_HASH_SIZE];
+    u32 storage_id;
+    u32 count;
+};
+
+} // namespace
+
+bool Journal::Load(const u8 (&key)[SHA256_HASH_SIZE], NcmStorageId storage_id, std::vector<Entry>& old, NcmStorageId& old_storage_id) {
+    SCOPED_MUTEX(&m_mutex);
+
+    std::memcpy(m_key, key, sizeof(m_key));
+    m_storage_id = storage_id;
+    m_entries.clear();
+    m_active = true;
+
+    fs::FsNativeSd fs;
+    std::vector<u8> data;
+    if (R_FAILED(fs.read_entire_file(JOURNAL_PATH, data)) || data.size() < sizeof(FileHeader)) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION || data.size() != sizeof(header) + header.count * sizeof(Entry)) {
+        log_write("[JOURNAL] ignoring invalid journal\n");
+        return false;
+    }
+
+    std::vector<Entry> entries(header.count);
+    std::memcpy(entries.data(), data.data() + sizeof(header), entries.size() * sizeof(Entry));
+
+    if (std::memcmp(header.key, key, sizeof(header.key)) || header.storage_id != storage_id) {
+        log_write("[JOURNAL] journal is for a different install, entries: %zu\n", entries.size());
+        old = std::move(entries);
+        old_storage_id = NcmStorageId(header.storage_id);
+        fs.DeleteFile(JOURNAL_PATH);
+        return false;
+    }
+
+    log_write("[JOURNAL] loaded journal, entries: %zu\n", entries.size());
+    m_entries = std::move(entries);
+    return true;
+}
+
+bool Journal::Find(const NcmContentId& content_id, Entry& out) {
+    SCOPED_MUTEX(&m_mutex);
+
+    const auto it = std::ranges::find_if(m_entries, [&content_id](auto& e){
+        return !std::memcmp(&e.content_id, &content_id, sizeof(content_id));
+    });
+
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    out = *it;
+    return true;
+}
+
+Result Journal::Update(const Entry& entry) {
+    SCOPED_MUTEX(&m_mutex);
+
+    auto it = std::ranges::find_if(m_entries, [&entry](auto& e){
+        return !std::memcmp(&e.content_id, &entry.content_id, sizeof(entry.content_id));
+    });
+
+    if (it == m_entries.end()) {
+        m_entries.emplace_back(entry);
+    } else {
+        *it = entry;
+    }
+
+    return Save();
+}
+
+Result Journal::Remove(const NcmContentId& content_id) {
+    SCOPED_MUTEX(&m_mutex);
+
+    std::erase_if(m_entries, [&content_id](auto& e){
+        return !std::memcmp(&e.content_id, &content_id, sizeof(content_id));
+    });
+
+    return Save();
+}
+
+void Journal::Delete() {
+    SCOPED_MUTEX(&m_mutex);
+
+    m_entries.clear();
+    m_active = false;
+
+    fs::FsNativeSd fs;
+    fs.DeleteFile(JOURNAL_PATH);
+}
+
+// must be called with the lock held.
+Result Journal::Save() {
+    FileHeader header{};
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    std::memcpy(header.key, m_key, sizeof(header.key));
+    header.storage_id = m_storage_id;
+    header.count = m_entries.size();
+
+    std::vector<u8> data(sizeof(header) + m_entries.size() * sizeof(Entry));
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), m_entries.data(), m_entries.size() * sizeof(Entry));
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursivelyWithPath(JOURNAL_PATH);
+    return fs.write_entire_file(JOURNAL_PATH, data);
+}
+
+void CreateKey(const container::Collections& collections, NcmStorageId storage_id, u8 (&out)[SHA256_HASH_SIZE]) {
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
+
+    for (const auto& e : collections) {
+        sha256ContextUpdate(&ctx, e.name.data(), e.name.size());
+        sha256ContextUpdate(&ctx, &e.size, sizeof(e.size));
+    }
+
+    const u32 id = storage_id;
+    sha256ContextUpdate(&ctx, &id, sizeof(id));
+    sha256ContextGetHash(&ctx, out);
+}
+
+} // namespace sphaira::yati::journal
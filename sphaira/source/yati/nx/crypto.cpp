@@ -0,0 +1,235 @@
+#include "yati/nx/crypto.hpp"
+
+#include <cstring>
+
+#if defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO)
+    #define HAS_AES_NEON 1
+    #include <arm_neon.h>
+#else
+    #define HAS_AES_NEON 0
+#endif
+
+namespace sphaira::crypto {
+namespace {
+
+// number of blocks that are in flight at once, the aes instructions have a
+// latency of a few cycles so running blocks back to back keeps the pipeline full.
+constexpr u64 INTERLEAVE = 4;
+
+void IncrementCtr(u64& hi, u64& lo) {
+    if (!++lo) {
+        hi++;
+    }
+}
+
+// multiplies the tweak by x in GF(2^128), the tweak is little endian.
+void XtsMulAlpha(u64& lo, u64& hi) {
+    const u64 carry = hi >> 63;
+    hi = (hi << 1) | (lo >> 63);
+    lo = (lo << 1) ^ (carry * 0x87);
+}
+
+#if HAS_AES_NEON
+struct RoundKeys {
+    explicit RoundKeys(const Aes128Context& ctx) {
+        for (u32 i = 0; i < std::size(k); i++) {
+            k[i] = vld1q_u8(ctx.round_keys[i]);
+        }
+    }
+
+    uint8x16_t k[AES_128_NUM_ROUNDS + 1];
+};
+
+template<u64 N>
+inline void EncryptBlocks(const RoundKeys& rk, uint8x16_t (&b)[N]) {
+    for (u32 r = 0; r < AES_128_NUM_ROUNDS - 1; r++) {
+        for (u64 i = 0; i < N; i++) {
+            b[i] = vaesmcq_u8(vaeseq_u8(b[i], rk.k[r]));
+        }
+    }
+
+    for (u64 i = 0; i < N; i++) {
+        b[i] = veorq_u8(vaeseq_u8(b[i], rk.k[AES_128_NUM_ROUNDS - 1]), rk.k[AES_128_NUM_ROUNDS]);
+    }
+}
+
+// the round keys have already been inverse mix column'd by aes128ContextCreate().
+template<u64 N>
+inline void DecryptBlocks(const RoundKeys& rk, uint8x16_t (&b)[N]) {
+    for (u32 r = AES_128_NUM_ROUNDS; r > 1; r--) {
+        for (u64 i = 0; i < N; i++) {
+            b[i] = vaesimcq_u8(vaesdq_u8(b[i], rk.k[r]));
+        }
+    }
+
+    for (u64 i = 0; i < N; i++) {
+        b[i] = veorq_u8(vaesdq_u8(b[i], rk.k[1]), rk.k[0]);
+    }
+}
+
+inline uint8x16_t LoadCtr(u64 hi, u64 lo) {
+    const u64 be[2]{ __builtin_bswap64(hi), __builtin_bswap64(lo) };
+    return vld1q_u8(reinterpret_cast<const u8*>(be));
+}
+
+inline uint8x16_t LoadTweak(u64 lo, u64 hi) {
+    const u64 le[2]{ lo, hi };
+    return vld1q_u8(reinterpret_cast<const u8*>(le));
+}
+
+template<u64 N>
+inline void CtrBlocks(const RoundKeys& rk, u64& hi, u64& lo, u8*& dst, const u8*& src) {
+    uint8x16_t b[N];
+    for (u64 i = 0; i < N; i++) {
+        b[i] = LoadCtr(hi, lo);
+        IncrementCtr(hi, lo);
+    }
+
+    EncryptBlocks(rk, b);
+
+    for (u64 i = 0; i < N; i++) {
+        vst1q_u8(dst, veorq_u8(vld1q_u8(src), b[i]));
+        dst += AES_BLOCK_SIZE;
+        src += AES_BLOCK_SIZE;
+    }
+}
+
+template<u64 N>
+inline void XtsBlocks(const RoundKeys& rk, bool is_encryptor, u64& lo, u64& hi, u8*& dst, const u8*& src) {
+    uint8x16_t t[N], b[N];
+    for (u64 i = 0; i < N; i++) {
+        t[i] = LoadTweak(lo, hi);
+        XtsMulAlpha(lo, hi);
+        b[i] = veorq_u8(vld1q_u8(src + i * AES_BLOCK_SIZE), t[i]);
+    }
+
+    if (is_encryptor) {
+        EncryptBlocks(rk, b);
+    } else {
+        DecryptBlocks(rk, b);
+    }
+
+    for (u64 i = 0; i < N; i++) {
+        vst1q_u8(dst + i * AES_BLOCK_SIZE, veorq_u8(b[i], t[i]));
+    }
+
+    dst += N * AES_BLOCK_SIZE;
+    src += N * AES_BLOCK_SIZE;
+}
+#endif
+
+// crypts whole blocks, updating the big endian counter.
+void CtrCryptBlocks(const Aes128Context& ctx, u8* ctr, u8* dst, const u8* src, u64 blocks) {
+    u64 hi, lo;
+    std::memcpy(&hi, ctr + 0x0, sizeof(hi));
+    std::memcpy(&lo, ctr + 0x8, sizeof(lo));
+    hi = __builtin_bswap64(hi);
+    lo = __builtin_bswap64(lo);
+
+#if HAS_AES_NEON
+    const RoundKeys rk{ctx};
+    for (; blocks >= INTERLEAVE; blocks -= INTERLEAVE) {
+        CtrBlocks<INTERLEAVE>(rk, hi, lo, dst, src);
+    }
+    for (; blocks; blocks--) {
+        CtrBlocks<1>(rk, hi, lo, dst, src);
+    }
+#else
+    for (; blocks; blocks--) {
+        const u64 be[2]{ __builtin_bswap64(hi), __builtin_bswap64(lo) };
+        u8 keystream[AES_BLOCK_SIZE];
+        aes128EncryptBlock(&ctx, keystream, be);
+        for (u64 i = 0; i < AES_BLOCK_SIZE; i++) {
+            dst[i] = src[i] ^ keystream[i];
+        }
+
+        IncrementCtr(hi, lo);
+        dst += AES_BLOCK_SIZE;
+        src += AES_BLOCK_SIZE;
+    }
+#endif
+
+    hi = __builtin_bswap64(hi);
+    lo = __builtin_bswap64(lo);
+    std::memcpy(ctr + 0x0, &hi, sizeof(hi));
+    std::memcpy(ctr + 0x8, &lo, sizeof(lo));
+}
+
+void XtsCryptSector(const Aes128Context& ctx, const Aes128Context& tweak_ctx, bool is_encryptor, u8* dst, const u8* src, u64 sector, u64 size) {
+    // nintendo uses a big endian sector number.
+    const u64 tweak_in[2]{ 0, __builtin_bswap64(sector) };
+    u64 tweak[2];
+    aes128EncryptBlock(&tweak_ctx, tweak, tweak_in);
+    u64 lo = tweak[0], hi = tweak[1];
+
+    auto blocks = size / AES_BLOCK_SIZE;
+
+#if HAS_AES_NEON
+    const RoundKeys rk{ctx};
+    for (; blocks >= INTERLEAVE; blocks -= INTERLEAVE) {
+        XtsBlocks<INTERLEAVE>(rk, is_encryptor, lo, hi, dst, src);
+    }
+    for (; blocks; blocks--) {
+        XtsBlocks<1>(rk, is_encryptor, lo, hi, dst, src);
+    }
+#else
+    for (; blocks; blocks--) {
+        const u64 t[2]{ lo, hi };
+        u64 b[2];
+        std::memcpy(b, src, sizeof(b));
+        b[0] ^= t[0];
+        b[1] ^= t[1];
+
+        if (is_encryptor) {
+            aes128EncryptBlock(&ctx, b, b);
+        } else {
+            aes128DecryptBlock(&ctx, b, b);
+        }
+
+        b[0] ^= t[0];
+        b[1] ^= t[1];
+        std::memcpy(dst, b, sizeof(b));
+
+        XtsMulAlpha(lo, hi);
+        dst += AES_BLOCK_SIZE;
+        src += AES_BLOCK_SIZE;
+    }
+#endif
+}
+
+} // namespace
+
+void Aes128Ctr::Crypt(void* _dst, const void* _src, u64 size) {
+    auto dst = static_cast<u8*>(_dst);
+    auto src = static_cast<const u8*>(_src);
+
+    // use up the keystream left over from the last call.
+    for (; size && m_keystream_offset < sizeof(m_keystream); size--) {
+        *dst++ = *src++ ^ m_keystream[m_keystream_offset++];
+    }
+
+    const auto blocks = size / AES_BLOCK_SIZE;
+    if (blocks) {
+        CtrCryptBlocks(m_ctx, m_ctr, dst, src, blocks);
+        dst += blocks * AES_BLOCK_SIZE;
+        src += blocks * AES_BLOCK_SIZE;
+        size -= blocks * AES_BLOCK_SIZE;
+    }
+
+    // partial block, keep the rest of the keystream for the next call.
+    if (size) {
+        std::memset(m_keystream, 0, sizeof(m_keystream));
+        CtrCryptBlocks(m_ctx, m_ctr, m_keystream, m_keystream, 1);
+        for (m_keystream_offset = 0; m_keystream_offset < size; m_keystream_offset++) {
+            dst[m_keystream_offset] = src[m_keystream_offset] ^ m_keystream[m_keystream_offset];
+        }
+    }
+}
+
+void Aes128Xts::Run(void *dst, const void *src, u64 sector, u64 sector_size, u64 data_size) {
+    for (u64 pos = 0; pos < data_size; pos += sector_size) {
+        XtsCryptSector(m_ctx, m_tweak_ctx, m_is_encryptor, static_cast<u8*>(dst) + pos, static_cast<const u8*>(src) + pos, sector++, sector_size);
+    }
+}
+
+} // namespace sphaira::crypto
@@ -14,6 +14,7 @@
 #include <string_view>
 #include <algorithm>
 #include <ranges>
+#include <map>
 
 namespace sphaira::es {
 namespace {
@@ -134,6 +135,28 @@ void _esCleanup() {
     serviceClose(&g_esSrv);
 }
 
+struct RightsIdLess {
+    bool operator()(const FsRightsId& a, const FsRightsId& b) const {
+        return std::memcmp(&a, &b, sizeof(a)) < 0;
+    }
+};
+
+// tickets only change when one is imported or a title is deleted, so the
+// ticket lists and decrypted title keys are kept for the session, rather than
+// asking es for every title.
+// this is kept after es is closed, as it doesn't depend on the session.
+struct TicketCache {
+    Mutex mutex{};
+    std::vector<FsRightsId> common{};
+    std::vector<FsRightsId> personalised{};
+    bool has_common{};
+    bool has_personalised{};
+    // key is the rights id, which also contains the key generation.
+    std::map<FsRightsId, keys::KeyEntry, RightsIdLess> title_keys{};
+};
+
+TicketCache g_ticket_cache{};
+
 Result ListTicket(u32 cmd_id, s32 *out_entries_written, FsRightsId* out_ids, s32 count) {
     struct {
         u32 num_rights_ids_written;
@@ -244,12 +267,26 @@ Service* GetServiceSession() {
 }
 
 Result ImportTicket(const void* tik_buf, u64 tik_size, const void* cert_buf, u64 cert_size) {
+    // invalidated even on failure, as es may have replaced the old ticket.
+    ON_SCOPE_EXIT(InvalidateTicketCache());
+
     return serviceDispatch(&g_esSrv, 1,
         .buffer_attrs = { SfBufferAttr_HipcMapAlias | SfBufferAttr_In, SfBufferAttr_HipcMapAlias | SfBufferAttr_In },
         .buffers = { { tik_buf, tik_size }, { cert_buf, cert_size } }
     );
 }
 
+void InvalidateTicketCache() {
+    auto& cache = g_ticket_cache;
+    SCOPED_MUTEX(&cache.mutex);
+
+    cache.common.clear();
+    cache.personalised.clear();
+    cache.has_common = false;
+    cache.has_personalised = false;
+    cache.title_keys.clear();
+}
+
 Result CountCommonTicket(s32* count) {
     return serviceDispatchOut(&g_esSrv, 9, *count);
 }
@@ -524,26 +561,40 @@ Result PatchTicket(std::vector<u8>& ticket, std::vector<u8>& cert_chain, u8 key_
 }
 
 Result GetCommonTickets(std::vector<FsRightsId>& out) {
-    s32 count;
-    R_TRY(es::CountCommonTicket(&count));
-
-    s32 written;
-    out.resize(count);
-    R_TRY(es::ListCommonTicket(&written, out.data(), out.size()));
-    out.resize(written);
+    auto& cache = g_ticket_cache;
+    SCOPED_MUTEX(&cache.mutex);
+
+    if (!cache.has_common) {
+        s32 count;
+        R_TRY(es::CountCommonTicket(&count));
+
+        s32 written;
+        cache.common.resize(count);
+        R_TRY(es::ListCommonTicket(&written, cache.common.data(), cache.common.size()));
+        cache.common.resize(written);
+        cache.has_common = true;
+    }
 
+    out = cache.common;
     R_SUCCEED();
 }
 
 Result GetPersonalisedTickets(std::vector<FsRightsId>& out) {
-    s32 count;
-    R_TRY(es::CountPersonalizedTicket(&count));
-
-    s32 written;
-    out.resize(count);
-    R_TRY(es::ListPersonalizedTicket(&written, out.data(), out.size()));
-    out.resize(written);
+    auto& cache = g_ticket_cache;
+    SCOPED_MUTEX(&cache.mutex);
+
+    if (!cache.has_personalised) {
+        s32 count;
+        R_TRY(es::CountPersonalizedTicket(&count));
+
+        s32 written;
+        cache.personalised.resize(count);
+        R_TRY(es::ListPersonalizedTicket(&written, cache.personalised.data(), cache.personalised.size()));
+        cache.personalised.resize(written);
+        cache.has_personalised = true;
+    }
 
+    out = cache.personalised;
     R_SUCCEED();
 }
 
@@ -601,13 +652,27 @@ Result GetPersonalisedTicketAndCertificate(const FsRightsId& rights_id, std::vec
 }
 
 Result GetTitleKeyDecrypted(const FsRightsId& rights_id, u8 key_gen, const keys::Keys& keys, keys::KeyEntry& out) {
+    auto& cache = g_ticket_cache;
+
+    {
+        SCOPED_MUTEX(&cache.mutex);
+        if (const auto it = cache.title_keys.find(rights_id); it != cache.title_keys.end()) {
+            out = it->second;
+            R_SUCCEED();
+        }
+    }
+
     u64 out_size;
     std::array<u8, 0x400> ticket;
     if (R_FAILED(es::GetCommonTicketData(&out_size, ticket.data(), ticket.size(), &rights_id))) {
         R_TRY(es::GetPersonalisedTicketData(&out_size, ticket.data(), ticket.size(), &rights_id));
     }
 
-    return GetTitleKeyDecrypted(ticket, rights_id, key_gen, keys, out);
+    R_TRY(GetTitleKeyDecrypted(ticket, rights_id, key_gen, keys, out));
+
+    SCOPED_MUTEX(&cache.mutex);
+    cache.title_keys[rights_id] = out;
+    R_SUCCEED();
 }
 
 Result GetTitleKeyDecrypted(std::span<const u8> ticket, const FsRightsId& rights_id, u8 key_gen, const keys::Keys& keys, keys::KeyEntry& out) {
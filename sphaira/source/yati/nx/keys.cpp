@@ -32,7 +32,17 @@ void parse_hex_key(void* key, const char* hex) {
     *(u64*)((u8*)key + 8) = std::byteswap(std::strtoul(upp, nullptr, 0x10));
 }
 
-Result parse_keys(Keys& out, bool read_from_file) {
+namespace {
+
+// keys are derived once per session, as they can't change without a reboot.
+// keys from prod.keys are only cached once the file has been read, so that
+// they're picked up if the file is added later.
+Mutex g_mutex{};
+Keys g_keys{};
+bool g_has_keys{};
+bool g_has_file_keys{};
+
+Result parse_keys_internal(Keys& out, bool read_from_file, bool& file_read) {
     static constexpr auto find_key = [](const char* key, const char* value, const char* search_key, KeySection& key_section) -> bool {
         if (!std::strncmp(key, search_key, std::strlen(search_key))) {
             // get key index.
@@ -103,6 +113,8 @@ Result parse_keys(Keys& out, bool read_from_file) {
 
         // it doesn't matter if this fails, its just that title decryption will also fail.
         if (ini_browse(cb, std::addressof(out), "/switch/prod.keys")) {
+            file_read = true;
+
             // decrypt eticket device key.
             if (out.eticket_rsa_kek.IsValid()) {
                 auto rsa_key = (es::EticketRsaDeviceKey*)out.eticket_device_key.key;
@@ -128,4 +140,25 @@ Result parse_keys(Keys& out, bool read_from_file) {
     R_SUCCEED();
 }
 
+} // namespace
+
+Result parse_keys(Keys& out, bool read_from_file) {
+    SCOPED_MUTEX(&g_mutex);
+
+    if (g_has_file_keys || (g_has_keys && !read_from_file)) {
+        out = g_keys;
+        R_SUCCEED();
+    }
+
+    Keys keys{};
+    bool file_read{};
+    R_TRY(parse_keys_internal(keys, read_from_file, file_read));
+
+    g_keys = keys;
+    g_has_keys = true;
+    g_has_file_keys = file_read;
+    out = keys;
+    R_SUCCEED();
+}
+
 } // namespace sphaira::keys
@@ -3,6 +3,7 @@
 #include "yati/nx/es.hpp"
 #include "yati/nx/nxdumptool_rsa.h"
 #include "utils/utils.hpp"
+#include "utils/task_pool.hpp"
 #include "log.hpp"
 
 namespace sphaira::nca {
@@ -18,6 +19,11 @@ constexpr const u8* g_key_area_key[] = {
     g_key_area_key_system_source
 };
 
+// reads at least this big are decrypted on the task workers.
+constexpr s64 PARALLEL_CTR_MIN_SIZE = 1024 * 512;
+// smallest amount given to a single task, so that the task overhead stays small.
+constexpr s64 PARALLEL_CTR_CHUNK_MIN = 1024 * 128;
+
 const unsigned char nca_hdr_fixed_key_moduli_retail[0x2][0x100] = { /* Fixed RSA key used to validate NCA signature 0. */
     {
         0xBF, 0xBE, 0x40, 0x6C, 0xF4, 0xA7, 0x80, 0xE9, 0xF0, 0x7D, 0x0C, 0x99, 0x61, 0x1D, 0x77, 0x2F,
@@ -383,7 +389,8 @@ Result DecyptedData::Read(void *_buf, s64 _off, s64 _size, u64* _bytes_read) {
 DecyptedDataCtr::DecyptedDataCtr(const void* key, u64 ctr, const std::shared_ptr<yati::source::Base>& source)
 : DecyptedData{AES_BLOCK_SIZE, source} {
     SetCtr(ctr);
-    aes128CtrContextCreate(&m_ctx, key, m_ctr);
+    m_ctx.Create(key, m_ctr);
+    std::memcpy(m_key, key, sizeof(m_key));
 }
 
 Result DecyptedDataCtr::SetCtr(u64 ctr) {
@@ -392,9 +399,32 @@ Result DecyptedDataCtr::SetCtr(u64 ctr) {
 }
 
 Result DecyptedDataCtr::Decrypt(void* buf, s64 off, s64 size) {
-    crypto::UpdateCtr(m_ctr, off);
-    aes128CtrContextResetCtr(&m_ctx, m_ctr);
-    aes128CtrCrypt(&m_ctx, buf, buf, size);
+    const auto workers = utils::task::GetWorkerCount();
+    if (size < PARALLEL_CTR_MIN_SIZE || workers < 2) {
+        crypto::UpdateCtr(m_ctr, off);
+        m_ctx.ResetCtr(m_ctr);
+        m_ctx.Crypt(buf, buf, size);
+        R_SUCCEED();
+    }
+
+    // each ctr block only depends on its offset, so the read is split between
+    // the workers, each with its own context starting at the chunk offset.
+    const auto chunk_size = std::max<s64>(PARALLEL_CTR_CHUNK_MIN, utils::AlignUp<s64>((size + workers - 1) / workers, AES_BLOCK_SIZE));
+    const auto data = static_cast<u8*>(buf);
+
+    utils::task::Group group;
+    for (s64 chunk_off = 0; chunk_off < size; chunk_off += chunk_size) {
+        const auto chunk = std::min<s64>(chunk_size, size - chunk_off);
+
+        group.Push([this, data, off, chunk_off, chunk]() {
+            u8 ctr[AES_BLOCK_SIZE];
+            std::memcpy(ctr, m_ctr, sizeof(ctr));
+            crypto::UpdateCtr(ctr, off + chunk_off);
+            crypto::Aes128Ctr{m_key, ctr}.Crypt(data + chunk_off, data + chunk_off, chunk);
+        }, utils::task::Priority::High);
+    }
+
+    group.Wait();
     R_SUCCEED();
 }
 
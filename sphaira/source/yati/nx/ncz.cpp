@@ -1,34 +1,194 @@
 #include "yati/nx/ncz.hpp"
+#include "utils/zstd_pool.hpp"
+#include "utils/memory_budget.hpp"
+#include "utils/mem_track.hpp"
+#include "utils/thread.hpp"
 
 #include "defines.hpp"
 #include "log.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <cstdio>
 
 namespace sphaira::ncz {
+namespace {
+
+// number of sequential reads before the prefetch thread is started.
+constexpr u32 PREFETCH_SEQUENTIAL_COUNT = 2;
+// max number of blocks to load ahead, this is further limited by the lru size.
+constexpr u32 PREFETCH_BLOCK_MAX = 8;
+
+// size of the decompressed chunks kept in the lru for solid ncz.
+constexpr u64 SOLID_CHUNK_SIZE = 1024 * 1024;
+// size of the compressed reads from the source for solid ncz.
+constexpr u64 SOLID_READ_SIZE = 1024 * 512;
+// frames closer than this to the last checkpoint are skipped, as nsz may
+// write many small frames and restarting slightly earlier is cheap.
+constexpr u64 SOLID_CHECKPOINT_DISTANCE = 1024 * 1024 * 8;
+
+// number of blocks kept in the lru.
+// this isn't needed in sphaira as i am usually reading in 4mb chunks.
+auto GetLruCount(const BlockHeader& block_header) -> u32 {
+    const auto max_lru_total_size = utils::budget::Get(utils::budget::Subsystem_Ncz);
+    return std::max<s64>(1, max_lru_total_size / (1UL << block_header.block_size_exponent));
+}
+
+constexpr fs::FsPath INDEX_CACHE_PATH{"/switch/sphaira/cache/ncz"};
+constexpr u32 INDEX_CACHE_MAGIC = 0x5844495A; // ZIDX
+// bump this when the cache layout changes.
+constexpr u32 INDEX_CACHE_VERSION = 1;
+
+// followed by the sections and blocks.
+struct IndexCacheHeader {
+    u32 magic;
+    u32 version;
+    fs::FsPath path;
+    s64 size;
+    u64 modified;
+    Header header;
+    BlockHeader block_header;
+    u64 block_offset;
+};
+
+auto GetIndexCachePath(const fs::FsPath& path) -> fs::FsPath {
+    u8 hash[SHA256_HASH_SIZE];
+    sha256CalculateHash(hash, path.s, std::strlen(path.s));
+
+    u64 id;
+    std::memcpy(&id, hash, sizeof(id));
+
+    fs::FsPath out;
+    std::snprintf(out, sizeof(out), "%s/%016lX.bin", INDEX_CACHE_PATH.s, id);
+    return out;
+}
+
+} // namespace
+
+Result ReadIndex(yati::source::Base* source, const Header& header, Index& out) {
+    out.header = header;
+
+    // read all the sections.
+    s64 offset = NCZ_SECTION_OFFSET;
+    out.sections.resize(out.header.total_sections);
+    R_TRY(source->Read2(out.sections.data(), offset, out.sections.size() * sizeof(Section)));
+
+    offset += out.sections.size() * sizeof(Section);
+    R_TRY(source->Read2(&out.block_header, offset, sizeof(out.block_header)));
+
+    // solid compressed nsz have no block table, the zstd stream starts
+    // straight after the sections.
+    if (out.block_header.magic != NCZ_BLOCK_MAGIC) {
+        out.block_header = {};
+        out.block_offset = offset;
+        out.solid = true;
+        R_SUCCEED();
+    }
+
+    R_TRY(out.block_header.IsValid());
+
+    offset += sizeof(out.block_header);
+    out.blocks.resize(out.block_header.total_blocks);
+    R_TRY(source->Read2(out.blocks.data(), offset, out.blocks.size() * sizeof(Block)));
+
+    offset += out.blocks.size() * sizeof(Block);
+    out.block_offset = offset;
+    R_SUCCEED();
+}
+
+bool LoadIndexCache(const fs::FsPath& path, s64 size, const FsTimeStampRaw& ts, Index& out) {
+    if (!ts.is_valid) {
+        return false;
+    }
+
+    fs::FsNativeSd fs;
+    std::vector<u8> data;
+    if (R_FAILED(fs.read_entire_file(GetIndexCachePath(path), data)) || data.size() < sizeof(IndexCacheHeader)) {
+        return false;
+    }
+
+    IndexCacheHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != INDEX_CACHE_MAGIC || header.version != INDEX_CACHE_VERSION) {
+        return false;
+    }
+
+    // the file was changed since it was cached.
+    if (header.path != path || header.size != size || header.modified != ts.modified) {
+        return false;
+    }
+
+    const auto sections_size = header.header.total_sections * sizeof(Section);
+    const auto blocks_size = header.block_header.total_blocks * sizeof(Block);
+    if (data.size() != sizeof(header) + sections_size + blocks_size || R_FAILED(header.block_header.IsValid())) {
+        return false;
+    }
+
+    out.header = header.header;
+    out.block_header = header.block_header;
+    out.block_offset = header.block_offset;
+    out.sections.resize(header.header.total_sections);
+    out.blocks.resize(header.block_header.total_blocks);
+    std::memcpy(out.sections.data(), data.data() + sizeof(header), sections_size);
+    std::memcpy(out.blocks.data(), data.data() + sizeof(header) + sections_size, blocks_size);
+
+    log_write("[NCZ] loaded index cache: %s blocks: %zu\n", path.s, out.blocks.size());
+    return true;
+}
+
+Result SaveIndexCache(const fs::FsPath& path, s64 size, const FsTimeStampRaw& ts, const Index& index) {
+    if (!ts.is_valid) {
+        R_SUCCEED();
+    }
+
+    IndexCacheHeader header{};
+    header.magic = INDEX_CACHE_MAGIC;
+    header.version = INDEX_CACHE_VERSION;
+    header.path = path;
+    header.size = size;
+    header.modified = ts.modified;
+    header.header = index.header;
+    header.block_header = index.block_header;
+    header.block_offset = index.block_offset;
+
+    const auto sections_size = index.sections.size() * sizeof(Section);
+    const auto blocks_size = index.blocks.size() * sizeof(Block);
+    std::vector<u8> data(sizeof(header) + sections_size + blocks_size);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), index.sections.data(), sections_size);
+    std::memcpy(data.data() + sizeof(header) + sections_size, index.blocks.data(), blocks_size);
+
+    fs::FsNativeSd fs;
+    fs.CreateDirectoryRecursively(INDEX_CACHE_PATH);
+    return fs.write_entire_file(GetIndexCachePath(path), data);
+}
 
 NczBlockReader::NczBlockReader(const Header& header, const Sections& sections, const BlockHeader& block_header, const Blocks& blocks, u64 offset, const std::shared_ptr<yati::source::Base>& source)
 : m_header{header}
 , m_sections{sections}
-, m_block_header{block_header}
-, m_blocks{blocks}
 , m_block_offset{offset}
-, m_source{source} {
-    // calculate the block size.
-    m_block_size = 1UL << m_block_header.block_size_exponent;
+, m_source{source}
+, m_cache{block_header.block_size_exponent, block_header.decompressed_size, blocks, offset, GetLruCount(block_header)} {
+    mutexInit(&m_mutex);
+    mutexInit(&m_source_mutex);
+    condvarInit(&m_can_prefetch);
+    condvarInit(&m_can_read);
 
-    // setup lru block cache.
-    // this isn't needed in sphaira as i am usually reading in 4mb chunks.
-    const auto max_lru_total_size = 1024*1024*32;
-    const auto lru_count = std::max<s64>(1, max_lru_total_size / m_block_size);
-    m_lru_data.resize(lru_count);
-    m_lru.Init(m_lru_data);
+    // only prefetch upto half of the lru so that the blocks being read
+    // are not evicted by the blocks ahead of them.
+    m_prefetch_max = std::min<u32>(PREFETCH_BLOCK_MAX, m_cache.GetLruCount() / 2);
+}
+
+NczBlockReader::~NczBlockReader() {
+    if (m_thread_created) {
+        {
+            SCOPED_MUTEX(&m_mutex);
+            m_exit = true;
+            condvarWakeAll(&m_can_prefetch);
+        }
 
-    // calculate offsets for each block.
-    auto block_offset = offset;
-    for (const auto& block : m_blocks) {
-        m_block_infos.emplace_back(block_offset, block.size);
-        block_offset += block.size;
+        threadWaitForExit(&m_thread);
+        threadClose(&m_thread);
     }
 }
 
@@ -40,62 +200,263 @@ Result NczBlockReader::Read(void *_buf, s64 off, s64 size, u64* bytes_read_out)
     R_UNLESS(off >= NCZ_NORMAL_SIZE, 6);
     off -= NCZ_NORMAL_SIZE;
 
+    if (size) {
+        SCOPED_MUTEX(&m_mutex);
+        UpdatePrefetch(off / m_cache.GetBlockSize(), (off + size - 1) / m_cache.GetBlockSize());
+    }
+
     while (size) {
-        // see if we have a cached block.
-        LruData* lru_data{};
-        for (auto list = m_lru.begin(); list; list = list->next) {
-            if (list->data->InRange(off)) {
-                lru_data = list->data;
-                m_lru.Update(list);
-                break;
-            }
+        // get block id and ensure we are in bounds.
+        const u64 block_id = off / m_cache.GetBlockSize();
+        R_UNLESS(block_id < m_cache.GetBlockCount(), Result_YatiInvalidNczBlockTotal);
+
+        mutexLock(&m_mutex);
+        ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+        // see if we have a cached block, waiting for the prefetch thread
+        // if it's currently loading it.
+        auto lru_data = m_cache.Find(off, true);
+        while (!lru_data && m_inflight_block == block_id) {
+            condvarWait(&m_can_read, &m_mutex);
+            lru_data = m_cache.Find(off, true);
+        }
+
+        const auto buf_off = off % m_cache.GetBlockSize();
+
+        // whole blocks are decompressed straight into the buffer, this saves
+        // a copy and avoids evicting blocks that may be read again.
+        if (!lru_data && !buf_off && size >= m_cache.GetBlockSize(block_id)) {
+            const auto rsize = m_cache.GetBlockSize(block_id);
+            mutexUnlock(&m_mutex);
+            const auto rc = LoadBlock(block_id, buf);
+            mutexLock(&m_mutex);
+            R_TRY(rc);
+
+            size -= rsize;
+            off += rsize;
+            buf += rsize;
+            *bytes_read_out += rsize;
+            continue;
         }
 
         // otherwise, read new block.
         if (!lru_data) {
-            // get block id and ensure we are in bounds.
-            const auto block_id = off / m_block_size;
-            R_UNLESS(block_id < m_block_infos.size(), Result_YatiInvalidNczBlockTotal);
-            const auto& block = m_block_infos[block_id];
+            std::vector<u8> data;
+            mutexUnlock(&m_mutex);
+            const auto rc = LoadBlock(block_id, data);
+            mutexLock(&m_mutex);
+            R_TRY(rc);
+
+            lru_data = m_cache.Insert(block_id, data);
+        }
+
+        const auto rsize = std::min<s64>(size, lru_data->data.size() - buf_off);
+        std::memcpy(buf, lru_data->data.data() + buf_off, rsize);
 
-            // read entire block.
-            std::vector<u8> temp(block.size);
+        size -= rsize;
+        off += rsize;
+        buf += rsize;
+        *bytes_read_out += rsize;
+    }
+
+    R_SUCCEED();
+}
+
+Result NczBlockReader::LoadBlock(u64 block_id, std::vector<u8>& out) {
+    // the vector is kept in the lru.
+    SCOPED_MEM_TAG(utils::mem::Tag_Cache);
+    out.resize(m_cache.GetBlockSize(block_id));
+    return LoadBlock(block_id, out.data());
+}
+
+Result NczBlockReader::LoadBlock(u64 block_id, void* out) {
+    const auto& block = m_cache.GetBlockInfo(block_id);
+    const auto decompressedBlockSize = m_cache.GetBlockSize(block_id);
+
+    // check if this block is compressed.
+    const auto compressed = block.size < decompressedBlockSize;
+
+    if (compressed) {
+        // read entire block.
+        std::vector<u8> temp(block.size);
+        {
+            SCOPED_MUTEX(&m_source_mutex);
             R_TRY(m_source->Read2(temp.data(), block.offset, temp.size()));
+        }
+
+        // decompress block, using a pooled context to avoid
+        // allocating a new one on every cache miss.
+        utils::zstd::DCtx dctx{utils::zstd::AcquireDCtx()};
+        R_UNLESS(dctx, Result_YatiInvalidNczZstdError);
+
+        const auto res = ZSTD_decompressDCtx(dctx.get(), out, decompressedBlockSize, temp.data(), temp.size());
+
+        // the output should be exactly the size of the block.
+        R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
+        R_UNLESS(res == decompressedBlockSize, 3);
+    } else {
+        // stored raw, so read straight into the output.
+        SCOPED_MUTEX(&m_source_mutex);
+        R_TRY(m_source->Read2(out, block.offset, decompressedBlockSize));
+    }
+
+    R_SUCCEED();
+}
+
+void NczBlockReader::UpdatePrefetch(u64 first_block, u64 last_block) {
+    if (!m_prefetch_max) {
+        return;
+    }
 
-            // https://github.com/nicoboss/nsz/issues/79
-            auto decompressedBlockSize = m_block_size;
-            // special handling for the last block to check it's actually compressed
-            if (block_id == m_block_infos.size() - 1) {
-                log_write("[NCZ] last block special handling\n");
-                // https://github.com/nicoboss/nsz/issues/210
-                const auto remainder = m_block_header.decompressed_size % decompressedBlockSize;
-                if (remainder) {
-                    decompressedBlockSize = remainder;
-                }
+    // reads within or straight after the last block are sequential.
+    if (first_block == m_last_block || first_block == m_last_block + 1) {
+        m_sequential_count++;
+    } else {
+        m_sequential_count = 0;
+        m_prefetch_next = m_prefetch_end = 0;
+    }
+
+    m_last_block = last_block;
+
+    if (m_sequential_count < PREFETCH_SEQUENTIAL_COUNT) {
+        return;
+    }
+
+    m_prefetch_next = std::max(m_prefetch_next, last_block + 1);
+    m_prefetch_end = std::min<u64>(last_block + 1 + m_prefetch_max, m_cache.GetBlockCount());
+
+    // only create the thread once it is needed, as most readers are random access.
+    if (!m_thread_created) {
+        if (R_FAILED(utils::CreateThread(&m_thread, PrefetchThreadFunc, this))) {
+            m_prefetch_max = 0;
+            return;
+        }
+
+        if (R_FAILED(threadStart(&m_thread))) {
+            threadClose(&m_thread);
+            m_prefetch_max = 0;
+            return;
+        }
+
+        m_thread_created = true;
+    }
+
+    condvarWakeOne(&m_can_prefetch);
+}
+
+void NczBlockReader::PrefetchThread() {
+    mutexLock(&m_mutex);
+    ON_SCOPE_EXIT(mutexUnlock(&m_mutex));
+
+    for (;;) {
+        while (!m_exit && m_prefetch_next >= m_prefetch_end) {
+            condvarWait(&m_can_prefetch, &m_mutex);
+        }
+
+        if (m_exit) {
+            break;
+        }
+
+        const auto block_id = m_prefetch_next++;
+        if (m_cache.Find(block_id * m_cache.GetBlockSize(), false)) {
+            continue;
+        }
+
+        std::vector<u8> data;
+        m_inflight_block = block_id;
+        mutexUnlock(&m_mutex);
+        const auto rc = LoadBlock(block_id, data);
+        mutexLock(&m_mutex);
+        m_inflight_block = UINT64_MAX;
+
+        if (R_SUCCEEDED(rc)) {
+            // the reader may have loaded it in the meantime.
+            if (!m_cache.Find(block_id * m_cache.GetBlockSize(), false)) {
+                m_cache.Insert(block_id, data);
             }
+        } else {
+            // stop prefetching, the reader will report the error if it reaches the block.
+            log_write("[NCZ] failed to prefetch block: %zu\n", block_id);
+            m_prefetch_next = m_prefetch_end = 0;
+        }
 
-            // new block.
-            lru_data = m_lru.GetNextFree();
-            lru_data->offset = block.offset;
-
-            // check if this block is compressed.
-            const auto compressed = block.size < decompressedBlockSize;
-
-            if (compressed) {
-                // decompress block.
-                lru_data->data.resize(decompressedBlockSize);
-                const auto res = ZSTD_decompress(lru_data->data.data(), lru_data->data.size(), temp.data(), temp.size());
-
-                // the output should be exactly the size of the block.
-                R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
-                R_UNLESS(res == decompressedBlockSize, 3);
-            } else {
-                // saves a copy by swapping the vector.
-                std::swap(lru_data->data, temp);
+        condvarWakeAll(&m_can_read);
+    }
+}
+
+void NczBlockReader::PrefetchThreadFunc(void* arg) {
+    static_cast<NczBlockReader*>(arg)->PrefetchThread();
+}
+
+NczSolidReader::NczSolidReader(const Sections& sections, u64 offset, s64 compressed_end, const std::shared_ptr<yati::source::Base>& source)
+: m_sections{sections}
+, m_offset{offset}
+, m_compressed_end{compressed_end}
+, m_source{source} {
+    mutexInit(&m_mutex);
+
+    // the stream covers everything after the nca header.
+    for (const auto& section : m_sections) {
+        m_size = std::max(m_size, section.offset + section.size);
+    }
+    m_size = m_size > NCZ_NORMAL_SIZE ? m_size - NCZ_NORMAL_SIZE : 0;
+
+    // the start of the stream is always a frame.
+    m_checkpoints.emplace_back(m_offset, 0);
+    m_in_off = m_offset;
+
+    const auto max_lru_total_size = utils::budget::Get(utils::budget::Subsystem_Ncz);
+    const auto lru_count = std::max<s64>(2, max_lru_total_size / SOLID_CHUNK_SIZE);
+    m_lru_data.resize(lru_count);
+    m_lru.Init(m_lru_data);
+}
+
+Result NczSolidReader::Read(void *_buf, s64 off, s64 size, u64* bytes_read_out) {
+    *bytes_read_out = 0;
+    u8* buf = (u8*)_buf;
+
+    // todo: handle case where the read is < 0x4000.
+    R_UNLESS(off >= NCZ_NORMAL_SIZE, 6);
+    off -= NCZ_NORMAL_SIZE;
+
+    SCOPED_MUTEX(&m_mutex);
+    size = std::min<s64>(size, m_size > (u64)off ? m_size - off : 0);
+
+    while (size) {
+        auto lru_data = FindChunk(off);
+        const auto buf_off = off % SOLID_CHUNK_SIZE;
+        const auto chunk_off = off - buf_off;
+        const auto chunk_size = std::min<u64>(SOLID_CHUNK_SIZE, m_size - chunk_off);
+
+        // whole chunks are decompressed straight into the buffer, this saves
+        // a copy and avoids evicting chunks that may be read again.
+        if (!lru_data && !buf_off && (u64)size >= chunk_size) {
+            R_TRY(Seek(off));
+            R_TRY(Decompress(buf, chunk_size));
+
+            size -= chunk_size;
+            off += chunk_size;
+            buf += chunk_size;
+            *bytes_read_out += chunk_size;
+            continue;
+        }
+
+        if (!lru_data) {
+            std::vector<u8> data;
+            {
+                // the vector is kept in the lru.
+                SCOPED_MEM_TAG(utils::mem::Tag_Cache);
+                data.resize(chunk_size);
             }
+
+            R_TRY(Seek(chunk_off));
+            R_TRY(Decompress(data.data(), data.size()));
+
+            lru_data = m_lru.GetNextFree();
+            lru_data->offset = chunk_off;
+            std::swap(lru_data->data, data);
         }
 
-        const auto buf_off = off % m_block_size;
         const auto rsize = std::min<s64>(size, lru_data->data.size() - buf_off);
         std::memcpy(buf, lru_data->data.data() + buf_off, rsize);
 
@@ -108,4 +469,80 @@ Result NczBlockReader::Read(void *_buf, s64 off, s64 size, u64* bytes_read_out)
     R_SUCCEED();
 }
 
+Result NczSolidReader::Seek(u64 off) {
+    if (!m_dctx) {
+        m_dctx.reset(utils::zstd::AcquireDCtx());
+        R_UNLESS(m_dctx, Result_YatiInvalidNczZstdError);
+    }
+
+    // find the last checkpoint before off.
+    const auto it = std::ranges::upper_bound(m_checkpoints, off, {}, &Checkpoint::out_off);
+    const auto& checkpoint = *std::prev(it);
+
+    // restart if seeking backwards, or if a checkpoint is closer than the stream.
+    if (m_out_off > off || checkpoint.out_off > m_out_off) {
+        log_debug(LogCategory_Ncz, "[NCZ] solid restart at: %zu for: %zu\n", checkpoint.out_off, off);
+        R_UNLESS(!ZSTD_isError(ZSTD_DCtx_reset(m_dctx.get(), ZSTD_reset_session_only)), Result_YatiInvalidNczZstdError);
+        m_input = {};
+        m_in_off = checkpoint.in_off;
+        m_out_off = checkpoint.out_off;
+    }
+
+    // decompress and discard upto the offset.
+    std::vector<u8> temp;
+    while (m_out_off < off) {
+        const auto skip = std::min<u64>(off - m_out_off, SOLID_CHUNK_SIZE);
+        temp.resize(skip);
+        R_TRY(Decompress(temp.data(), skip));
+    }
+
+    R_SUCCEED();
+}
+
+Result NczSolidReader::Decompress(void* out, u64 size) {
+    ZSTD_outBuffer output{out, size, 0};
+
+    while (output.pos < output.size) {
+        if (m_input.pos == m_input.size) {
+            R_UNLESS((s64)m_in_off < m_compressed_end, Result_YatiInvalidNczZstdError);
+
+            const auto rsize = std::min<u64>(SOLID_READ_SIZE, m_compressed_end - m_in_off);
+            m_in_buf.resize(rsize);
+            R_TRY(m_source->Read2(m_in_buf.data(), m_in_off, rsize));
+
+            m_input = {m_in_buf.data(), rsize, 0};
+            m_in_buf_off = m_in_off;
+            m_in_off += rsize;
+        }
+
+        const auto res = ZSTD_decompressStream(m_dctx.get(), &output, &m_input);
+        R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
+
+        // a frame has ended, so the next one can be decompressed on its own.
+        // checkpoints are only added past the last one, as replaying
+        // from an earlier checkpoint finds the same frames again.
+        if (!res) {
+            const Checkpoint checkpoint{m_in_buf_off + m_input.pos, m_out_off + output.pos};
+            if (checkpoint.out_off >= m_checkpoints.back().out_off + SOLID_CHECKPOINT_DISTANCE) {
+                log_debug(LogCategory_Ncz, "[NCZ] solid checkpoint in: %zu out: %zu\n", checkpoint.in_off, checkpoint.out_off);
+                m_checkpoints.emplace_back(checkpoint);
+            }
+        }
+    }
+
+    m_out_off += output.pos;
+    R_SUCCEED();
+}
+
+auto NczSolidReader::FindChunk(u64 off) -> LruData* {
+    for (auto list = m_lru.begin(); list; list = list->next) {
+        if (list->data->InRange(off)) {
+            m_lru.Update(list);
+            return list->data;
+        }
+    }
+
+    return nullptr;
+}
+
 } // namespace sphaira::ncz
@@ -0,0 +1,58 @@
+#include "yati/nx/ncz_block_cache.hpp"
+
+#include <utility>
+
+namespace sphaira::ncz {
+
+BlockCache::BlockCache(u8 block_size_exponent, u64 decompressed_size, const Blocks& blocks, u64 offset, u32 lru_count)
+: m_decompressed_size{decompressed_size}
+, m_block_size{(u32)(1UL << block_size_exponent)} {
+    m_lru_data.resize(lru_count);
+    m_lru.Init(m_lru_data);
+
+    // calculate offsets for each block.
+    m_block_infos.reserve(blocks.size());
+    auto block_offset = offset;
+    for (const auto& block : blocks) {
+        m_block_infos.emplace_back(block_offset, block.size);
+        block_offset += block.size;
+    }
+}
+
+auto BlockCache::GetBlockSize(u64 block_id) const -> u64 {
+    // https://github.com/nicoboss/nsz/issues/79
+    u64 decompressedBlockSize = m_block_size;
+    // special handling for the last block to check it's actually compressed
+    if (block_id == m_block_infos.size() - 1) {
+        // https://github.com/nicoboss/nsz/issues/210
+        const auto remainder = m_decompressed_size % decompressedBlockSize;
+        if (remainder) {
+            decompressedBlockSize = remainder;
+        }
+    }
+
+    return decompressedBlockSize;
+}
+
+auto BlockCache::Find(u64 off, bool update) -> Data* {
+    for (auto list = m_lru.begin(); list; list = list->next) {
+        if (list->data->InRange(off)) {
+            if (update) {
+                m_lru.Update(list);
+            }
+            return list->data;
+        }
+    }
+
+    return nullptr;
+}
+
+auto BlockCache::Insert(u64 block_id, std::vector<u8>& data) -> Data* {
+    auto lru_data = m_lru.GetNextFree();
+    // the lru is indexed by the decompressed offset.
+    lru_data->offset = block_id * m_block_size;
+    std::swap(lru_data->data, data);
+    return lru_data;
+}
+
+} // namespace sphaira::ncz
@@ -0,0 +1,132 @@
+#include "yati/source/http.hpp"
+#include "defines.hpp"
+#include "log.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace sphaira::yati::source {
+namespace {
+
+// how much the stream downloads ahead of the install.
+constexpr s64 STREAM_BUFFER_MAX = 1024 * 1024 * 16;
+
+} // namespace
+
+Http::Http(const curl::Api& api) : m_file{api} {
+    if (!m_file.Open()) {
+        m_open_result = Result_YatiHttpOpenFailed;
+    }
+}
+
+Result Http::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
+    R_TRY(GetOpenResult());
+
+    size = std::min(size, m_file.GetSize() - off);
+    R_UNLESS(size >= 0, Result_YatiHttpReadFailed);
+    R_UNLESS(m_file.Read(buf, off, size), Result_YatiHttpReadFailed);
+
+    *bytes_read = size;
+    R_SUCCEED();
+}
+
+void Http::SignalCancel() {
+    m_file.Cancel();
+}
+
+HttpStream::HttpStream(const curl::Api& api) : m_file{api} {
+    mutexInit(&m_mutex);
+    condvarInit(&m_can_read);
+    condvarInit(&m_can_write);
+
+    m_thread = std::make_unique<utils::Async>([this](){
+        const auto result = m_file.ReadAll([this](const void* data, size_t size){
+            return OnData(data, size);
+        });
+
+        SCOPED_MUTEX(&m_mutex);
+        m_done = true;
+        m_failed = !result;
+        condvarWakeAll(&m_can_read);
+    });
+}
+
+HttpStream::~HttpStream() {
+    SignalCancel();
+    m_thread.reset();
+}
+
+auto HttpStream::OnData(const void* data, size_t size) -> bool {
+    SCOPED_MUTEX(&m_mutex);
+
+    while (!m_cancelled && (s64)(m_buffer.size() - m_buffer_off) >= STREAM_BUFFER_MAX) {
+        condvarWait(&m_can_write, &m_mutex);
+    }
+
+    if (m_cancelled) {
+        return false;
+    }
+
+    const auto ptr = static_cast<const u8*>(data);
+    m_buffer.insert(m_buffer.end(), ptr, ptr + size);
+    condvarWakeOne(&m_can_read);
+    return true;
+}
+
+Result HttpStream::ReadChunk(void* buf, s64 size, u64* bytes_read) {
+    SCOPED_MUTEX(&m_mutex);
+
+    while (!m_cancelled && !m_done && m_buffer.size() == m_buffer_off) {
+        condvarWait(&m_can_read, &m_mutex);
+    }
+
+    R_UNLESS(!m_cancelled, Result_TransferCancelled);
+    // either the download failed or the file ended before the install did.
+    if (m_buffer.size() == m_buffer_off) {
+        log_write("[HTTP] stream ended early, failed: %u\n", m_failed);
+        R_THROW(Result_YatiHttpReadFailed);
+    }
+
+    size = std::min<s64>(size, m_buffer.size() - m_buffer_off);
+    std::memcpy(buf, m_buffer.data() + m_buffer_off, size);
+    m_buffer_off += size;
+
+    // only move the data down once a lot has been read, rather than every read.
+    if (m_buffer_off == m_buffer.size()) {
+        m_buffer.clear();
+        m_buffer_off = 0;
+    } else if ((s64)m_buffer_off >= STREAM_BUFFER_MAX / 2) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_buffer_off);
+        m_buffer_off = 0;
+    }
+
+    condvarWakeOne(&m_can_write);
+
+    *bytes_read = size;
+    R_SUCCEED();
+}
+
+void HttpStream::SignalCancel() {
+    m_file.Cancel();
+
+    SCOPED_MUTEX(&m_mutex);
+    m_cancelled = true;
+    condvarWakeAll(&m_can_read);
+    condvarWakeAll(&m_can_write);
+}
+
+Result OpenHttp(const curl::Api& api, std::shared_ptr<Base>& out, s64* size) {
+    auto source = std::make_shared<Http>(api);
+    R_TRY(source->GetOpenResult());
+    *size = source->GetSize();
+
+    if (source->HasRanges()) {
+        out = source;
+    } else {
+        log_write("[HTTP] server doesn't support ranges, streaming instead\n");
+        out = std::make_shared<HttpStream>(api);
+    }
+
+    R_SUCCEED();
+}
+
+} // namespace sphaira::yati::source
@@ -0,0 +1,196 @@
+#include "yati/source/split.hpp"
+#include "yati/source/file.hpp"
+#include "utils/task_pool.hpp"
+#include "log.hpp"
+#include "defines.hpp"
+
+#include <cstring>
+#include <cctype>
+#include <strings.h>
+#include <algorithm>
+
+namespace sphaira::yati::source {
+namespace {
+
+// fat32 can have up to 10 parts with the .xc0 naming, the folder naming has
+// no limit, but no dump is anywhere near 100 parts.
+constexpr u32 MAX_PARTS = 100;
+
+// returns the length of the path before the part number, or 0 if the path
+// isn't the first part of a split file (name.xc0 / name.ns0).
+auto GetPartPrefixLength(const fs::FsPath& path) -> size_t {
+    const auto ext = std::strrchr(path.s, '.');
+    if (!ext) {
+        return 0;
+    }
+
+    if (!strcasecmp(ext, ".xc0") || !strcasecmp(ext, ".ns0")) {
+        return std::strlen(path.s) - 1;
+    }
+
+    return 0;
+}
+
+auto GetPartPaths(fs::Fs* fs, const fs::FsPath& path) -> std::vector<fs::FsPath> {
+    std::vector<fs::FsPath> out;
+
+    if (const auto prefix = GetPartPrefixLength(path)) {
+        for (u32 i = 0; i < 10; i++) {
+            fs::FsPath part_path{path};
+            part_path.s[prefix] = '0' + i;
+            if (!fs->FileExists(part_path)) {
+                break;
+            }
+            out.emplace_back(part_path);
+        }
+    } else if (fs->DirExists(path)) {
+        for (u32 i = 0; i < MAX_PARTS; i++) {
+            fs::FsPath part_path;
+            std::snprintf(part_path, sizeof(part_path), "%s/%02u", path.s, i);
+            if (!fs->FileExists(part_path)) {
+                break;
+            }
+            out.emplace_back(part_path);
+        }
+    }
+
+    return out;
+}
+
+} // namespace
+
+Split::Split(fs::Fs* fs, const fs::FsPath& path) : m_fs{fs} {
+    m_open_result = [&]() -> Result {
+        const auto paths = GetPartPaths(m_fs, path);
+        R_UNLESS(!paths.empty(), Result_YatiContainerNotFound);
+
+        m_parts = std::make_unique<Part[]>(paths.size());
+        m_count = paths.size();
+
+        for (u32 i = 0; i < m_count; i++) {
+            auto& part = m_parts[i];
+            R_TRY(m_fs->OpenFile(paths[i], FsOpenMode_Read, std::addressof(part.file)));
+            R_TRY(part.file.GetSize(&part.size));
+            part.off = m_size;
+            m_size += part.size;
+        }
+
+        log_write("[SPLIT] opened: %s parts: %u size: %zd\n", path.s, m_count, m_size);
+        R_SUCCEED();
+    }();
+}
+
+Result Split::Read(void* buf, s64 off, s64 size, u64* bytes_read) {
+    R_TRY(GetOpenResult());
+    *bytes_read = 0;
+
+    if (off >= m_size || size <= 0) {
+        R_SUCCEED();
+    }
+
+    size = std::min(size, m_size - off);
+
+    // first part that contains the offset.
+    const auto begin = std::upper_bound(m_parts.get(), m_parts.get() + m_count, off, [](s64 off, const Part& part) {
+        return off < part.off + part.size;
+    });
+    u32 index = begin - m_parts.get();
+
+    // fast path, the read is within a single part.
+    const auto& first = m_parts[index];
+    if (off + size <= first.off + first.size) {
+        return ReadPart(index, buf, off - first.off, size, bytes_read);
+    }
+
+    // the read crosses a part boundary, so each part is read at the same time.
+    // on stdio the parts are read one after another, as the fs may not be
+    // thread-safe.
+    struct Chunk {
+        u8* buf;
+        s64 off;
+        s64 size;
+        u64 bytes_read;
+        Result rc;
+    };
+
+    std::vector<Chunk> chunks;
+    for (s64 buf_off = 0; size > 0 && index < m_count; index++) {
+        const auto& part = m_parts[index];
+        const auto part_off = off - part.off;
+        const auto read_size = std::min(size, part.size - part_off);
+
+        chunks.emplace_back((u8*)buf + buf_off, part_off, read_size);
+        buf_off += read_size;
+        off += read_size;
+        size -= read_size;
+    }
+
+    index = begin - m_parts.get();
+    if (CanReadConcurrently()) {
+        utils::task::Group group;
+        for (u32 i = 1; i < chunks.size(); i++) {
+            group.Push([this, &chunk = chunks[i], index = index + i]() {
+                chunk.rc = ReadPart(index, chunk.buf, chunk.off, chunk.size, &chunk.bytes_read);
+            }, utils::task::Priority::High);
+        }
+
+        auto& chunk = chunks[0];
+        chunk.rc = ReadPart(index, chunk.buf, chunk.off, chunk.size, &chunk.bytes_read);
+        group.Wait();
+    } else {
+        for (u32 i = 0; i < chunks.size(); i++) {
+            auto& chunk = chunks[i];
+            chunk.rc = ReadPart(index + i, chunk.buf, chunk.off, chunk.size, &chunk.bytes_read);
+        }
+    }
+
+    for (const auto& chunk : chunks) {
+        R_TRY(chunk.rc);
+        *bytes_read += chunk.bytes_read;
+        // a short read means the data after it is missing.
+        if (chunk.bytes_read != (u64)chunk.size) {
+            break;
+        }
+    }
+
+    R_SUCCEED();
+}
+
+Result Split::GetSize(s64* out) {
+    R_TRY(GetOpenResult());
+    *out = m_size;
+    R_SUCCEED();
+}
+
+bool Split::IsSplit(fs::Fs* fs, const fs::FsPath& path) {
+    if (GetPartPrefixLength(path)) {
+        return true;
+    }
+
+    // the native fs already joins archive bit folders, so it's seen as a file.
+    fs::FsPath part_path;
+    std::snprintf(part_path, sizeof(part_path), "%s/00", path.s);
+    return fs->DirExists(path) && fs->FileExists(part_path);
+}
+
+Result Split::ReadPart(u32 index, void* buf, s64 off, s64 size, u64* bytes_read) {
+    return m_parts[index].file.Read(off, buf, size, 0, bytes_read);
+}
+
+Result OpenFile(fs::Fs* fs, const fs::FsPath& path, std::shared_ptr<Base>& out, s64* size) {
+    if (Split::IsSplit(fs, path)) {
+        auto source = std::make_shared<Split>(fs, path);
+        R_TRY(source->GetOpenResult());
+        R_TRY(source->GetSize(size));
+        out = source;
+    } else {
+        auto source = std::make_shared<File>(fs, path);
+        R_TRY(source->GetOpenResult());
+        R_TRY(source->GetSize(size));
+        out = source;
+    }
+
+    R_SUCCEED();
+}
+
+} // namespace sphaira::yati::source
@@ -1,8 +1,16 @@
 #include "yati/source/stream.hpp"
 #include "defines.hpp"
 #include "log.hpp"
+#include <algorithm>
 
 namespace sphaira::yati::source {
+namespace {
+
+// skipped data is read in chunks of this size, so that skipping a large
+// file (ie, the xci update partition) doesn't buffer all of it.
+constexpr s64 SKIP_CHUNK_SIZE = 1024 * 64;
+
+} // namespace
 
 Result Stream::Read(void* _buf, s64 off, s64 size, u64* bytes_read_out) {
     // streams don't allow for random access (seeking backwards).
@@ -11,14 +19,16 @@ Result Stream::Read(void* _buf, s64 off, s64 size, u64* bytes_read_out) {
     auto buf = static_cast<u8*>(_buf);
     *bytes_read_out = 0;
 
+    std::vector<u8> temp_buf;
+
     // check if we already have some data in the buffer.
     while (size) {
         // while it is invalid to seek backwards, it is valid to seek forwards.
         // this can be done to skip padding, skip undeeded files etc.
         // to handle this, simply read the data into a buffer and discard it.
         if (off > m_offset) {
-            const auto skip_size = off - m_offset;
-            std::vector<u8> temp_buf(skip_size);
+            const auto skip_size = std::min(off - m_offset, SKIP_CHUNK_SIZE);
+            temp_buf.resize(skip_size);
             u64 bytes_read;
             R_TRY(ReadChunk(temp_buf.data(), temp_buf.size(), &bytes_read));
 
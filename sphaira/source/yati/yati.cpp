@@ -1,8 +1,12 @@
 #include "yati/yati.hpp"
 #include "yati/source/file.hpp"
+#include "yati/source/split.hpp"
 #include "yati/source/stream_file.hpp"
+#include "yati/source/http.hpp"
 #include "yati/container/nsp.hpp"
 #include "yati/container/xci.hpp"
+#include "yati/journal.hpp"
+#include "yati/cache.hpp"
 
 #include "yati/nx/ncz.hpp"
 #include "yati/nx/nca.hpp"
@@ -14,10 +18,15 @@
 
 #include "utils/utils.hpp"
 #include "utils/thread.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/zstd_pool.hpp"
+#include "utils/trace.hpp"
 
 #include "ui/progress_box.hpp"
 #include "ui/menus/game_menu.hpp"
 
+#include "threaded_file_transfer.hpp"
 #include "app.hpp"
 #include "i18n.hpp"
 #include "log.hpp"
@@ -36,6 +45,8 @@ constexpr NcmStorageId NCM_STORAGE_IDS[]{
 };
 
 constexpr u32 KEYGEN_LIMIT = 0x20;
+// how often the progress of an nca is saved to the journal.
+constexpr u64 JOURNAL_CHECKPOINT_NS = 3e+9;
 
 struct NcaCollection : container::CollectionEntry {
     nca::Header header{};
@@ -83,12 +94,35 @@ struct Yati;
 
 const u64 INFLATE_BUFFER_MAX = 1024*1024*4;
 
-struct ThreadBuffer {
-    ThreadBuffer() {
-        buf.reserve(INFLATE_BUFFER_MAX);
-    }
+// max number of ncas that are installed at the same time.
+constexpr u32 INSTALL_LANE_COUNT = 2;
+// rough upper bound of memory used by a single nca pipeline, ie the ring
+// buffers plus the buffers held by each thread.
+constexpr u64 INSTALL_LANE_MEMORY = INFLATE_BUFFER_MAX * 14;
+
+// placeholder writes are coalesced to one of these sizes, the best one for
+// each storage is probed on the first install and then saved to the config.
+constexpr s64 WRITE_CHUNK_SIZES[]{
+    1024 * 512,
+    1024 * 1024 * 1,
+    1024 * 1024 * 2,
+    1024 * 1024 * 4,
+};
+// used until the storage has been probed.
+constexpr s64 WRITE_CHUNK_SIZE_DEFAULT = 1024 * 1024 * 4;
+// how much is written with each size whilst probing, so the probe costs
+// nothing as it's part of the install.
+constexpr s64 WRITE_PROBE_SIZE = 1024 * 1024 * 16;
+// ncas smaller than this aren't probed as the writes would be too few.
+constexpr s64 WRITE_PROBE_MIN_NCA_SIZE = WRITE_PROBE_SIZE * std::size(WRITE_CHUNK_SIZES) * 2;
+constexpr const char* INI_SECTION_INSTALL = "install";
+
+// buffers are leased from the shared pool rather than each slot reserving
+// INFLATE_BUFFER_MAX upfront, the (empty) slots get filled by swapping.
+using PoolBuffer = utils::pool::Vector<u8>;
 
-    std::vector<u8> buf;
+struct ThreadBuffer {
+    PoolBuffer buf;
     s64 off;
 };
 
@@ -118,7 +152,7 @@ public:
         return ringbuf_capacity() - ringbuf_size();
     }
 
-    void ringbuf_push(std::vector<u8>& buf_in, s64 off_in) {
+    void ringbuf_push(PoolBuffer& buf_in, s64 off_in) {
         auto& value = this->buf[this->w_index % ringbuf_capacity()];
         value.off = off_in;
         std::swap(value.buf, buf_in);
@@ -126,7 +160,7 @@ public:
         this->w_index = (this->w_index + 1U) % (ringbuf_capacity() * 2U);
     }
 
-    void ringbuf_pop(std::vector<u8>& buf_out, s64& off_out) {
+    void ringbuf_pop(PoolBuffer& buf_out, s64& off_out) {
         auto& value = this->buf[this->r_index % ringbuf_capacity()];
         off_out = value.off;
         std::swap(value.buf, buf_out);
@@ -136,15 +170,18 @@ public:
 };
 
 struct ThreadData {
-    ThreadData(Yati* _yati, std::span<TikCollection> _tik, NcaCollection* _nca)
-    : yati{_yati}, tik{_tik}, nca{_nca} {
+    ThreadData(Yati* _yati, std::span<TikCollection> _tik, NcaCollection* _nca, bool _has_hash, bool _dry_run)
+    : yati{_yati}, tik{_tik}, nca{_nca}, has_hash{_has_hash}, dry_run{_dry_run}, hash_running{_has_hash} {
         mutexInit(std::addressof(read_mutex));
         mutexInit(std::addressof(write_mutex));
+        mutexInit(std::addressof(hash_mutex));
 
         condvarInit(std::addressof(can_read));
         condvarInit(std::addressof(can_decompress));
         condvarInit(std::addressof(can_decompress_write));
         condvarInit(std::addressof(can_write));
+        condvarInit(std::addressof(can_hash));
+        condvarInit(std::addressof(can_write_hash));
 
         ueventCreate(&m_uevent_done, false);
         ueventCreate(&m_uevent_progres, true);
@@ -167,7 +204,7 @@ struct ThreadData {
     void WakeAllThreads();
 
     auto IsAnyRunning() volatile const -> bool {
-        return read_running || decompress_running || write_running;
+        return read_running || decompress_running || write_running || hash_running;
     }
 
     auto GetWriteOffset() volatile const -> s64 {
@@ -178,6 +215,18 @@ struct ThreadData {
         return write_size;
     }
 
+    // returns the offset (and hash state) upto which the data is known to
+    // have been written.
+    void GetCheckpoint(s64& offset, Sha256Context& ctx) {
+        if (has_hash) {
+            SCOPED_MUTEX(std::addressof(hash_mutex));
+            offset = hash_checkpoint_offset;
+            ctx = hash_checkpoint;
+        } else {
+            offset = write_offset;
+        }
+    }
+
     auto GetDoneEvent() {
         return &m_uevent_done;
     }
@@ -186,11 +235,16 @@ struct ThreadData {
         return &m_uevent_progres;
     }
 
+    // the wake ups below take the lock so that they can't be missed by a
+    // thread that is just about to wait.
     void SetReadResult(Result result) {
         read_result = result;
 
         // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress));
+        {
+            SCOPED_MUTEX(std::addressof(read_mutex));
+            condvarWakeOne(std::addressof(can_decompress));
+        }
 
         if (R_FAILED(result)) {
             ueventSignal(GetDoneEvent());
@@ -200,8 +254,17 @@ struct ThreadData {
     void SetDecompressResult(Result result) {
         decompress_result = result;
 
+        // wake up read thread as it may be waiting on a free slot.
+        {
+            SCOPED_MUTEX(std::addressof(read_mutex));
+            condvarWakeOne(std::addressof(can_read));
+        }
+
         // wake up write thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_write));
+        {
+            SCOPED_MUTEX(std::addressof(write_mutex));
+            condvarWakeOne(std::addressof(can_write));
+        }
 
         if (R_FAILED(result)) {
             ueventSignal(GetDoneEvent());
@@ -211,108 +274,195 @@ struct ThreadData {
     void SetWriteResult(Result result) {
         write_result = result;
 
-        // wake up decompress thread as it may be waiting on data that never comes.
-        condvarWakeOne(std::addressof(can_decompress_write));
+        // wake up decompress thread as it may be waiting on a free slot.
+        {
+            SCOPED_MUTEX(std::addressof(write_mutex));
+            condvarWakeOne(std::addressof(can_decompress_write));
+        }
+
+        // wake up hash thread as it may be waiting on data that never comes.
+        {
+            SCOPED_MUTEX(std::addressof(hash_mutex));
+            condvarWakeOne(std::addressof(can_hash));
+        }
 
         ueventSignal(GetDoneEvent());
     }
 
+    void SetHashResult(Result result) {
+        hash_result = result;
+
+        // wake up write thread as it may be waiting on a free slot.
+        {
+            SCOPED_MUTEX(std::addressof(hash_mutex));
+            condvarWakeOne(std::addressof(can_write_hash));
+        }
+
+        if (R_FAILED(result)) {
+            ueventSignal(GetDoneEvent());
+        }
+    }
+
     Result Read(void* buf, s64 size, u64* bytes_read);
 
-    Result SetDecompressBuf(std::vector<u8>& buf, s64 off, s64 size) {
+    Result SetDecompressBuf(PoolBuffer& buf, s64 off, s64 size) {
         buf.resize(size);
 
         mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_free()) {
-            if (!write_running) {
-                R_SUCCEED();
-            }
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
+
+        while (!read_buffers.ringbuf_free() && decompress_running && R_SUCCEEDED(GetResults())) {
             R_TRY(condvarWait(std::addressof(can_read), std::addressof(read_mutex)));
         }
 
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
         R_TRY(GetResults());
+        // the decompress thread has finished, nothing left to do.
+        if (!decompress_running) {
+            R_SUCCEED();
+        }
+
         read_buffers.ringbuf_push(buf, off);
         return condvarWakeOne(std::addressof(can_decompress));
     }
 
-    Result GetDecompressBuf(std::vector<u8>& buf_out, s64& off_out) {
+    Result GetDecompressBuf(PoolBuffer& buf_out, s64& off_out) {
+        const auto start = armGetSystemTick();
+        ON_SCOPE_EXIT(decompress_wait_ticks += armGetSystemTick() - start);
+
         mutexLock(std::addressof(read_mutex));
-        if (!read_buffers.ringbuf_size()) {
-            if (!read_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
+
+        while (!read_buffers.ringbuf_size() && read_running && R_SUCCEEDED(GetResults())) {
             R_TRY(condvarWait(std::addressof(can_decompress), std::addressof(read_mutex)));
         }
 
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(read_mutex)));
         R_TRY(GetResults());
+        if (!read_buffers.ringbuf_size()) {
+            buf_out.resize(0);
+            R_SUCCEED();
+        }
+
         read_buffers.ringbuf_pop(buf_out, off_out);
         return condvarWakeOne(std::addressof(can_read));
     }
 
-    Result SetWriteBuf(std::vector<u8>& buf, s64 size, bool skip_verify) {
+    Result SetWriteBuf(PoolBuffer& buf, s64 size) {
+        const auto start = armGetSystemTick();
+        ON_SCOPE_EXIT(decompress_wait_ticks += armGetSystemTick() - start);
         buf.resize(size);
-        if (!skip_verify) {
-            sha256ContextUpdate(std::addressof(sha256), buf.data(), buf.size());
-        }
 
         mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_free()) {
-            if (!decompress_running) {
-                R_SUCCEED();
-            }
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
+
+        while (!write_buffers.ringbuf_free() && write_running && R_SUCCEEDED(GetResults())) {
             R_TRY(condvarWait(std::addressof(can_decompress_write), std::addressof(write_mutex)));
         }
 
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
         R_TRY(GetResults());
+        // the write thread has finished, nothing left to do.
+        if (!write_running) {
+            R_SUCCEED();
+        }
+
         write_buffers.ringbuf_push(buf, 0);
         return condvarWakeOne(std::addressof(can_write));
     }
 
-    Result GetWriteBuf(std::vector<u8>& buf_out, s64& off_out) {
+    Result GetWriteBuf(PoolBuffer& buf_out, s64& off_out) {
         mutexLock(std::addressof(write_mutex));
-        if (!write_buffers.ringbuf_size()) {
-            if (!decompress_running) {
-                buf_out.resize(0);
-                R_SUCCEED();
-            }
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
+
+        while (!write_buffers.ringbuf_size() && decompress_running && R_SUCCEEDED(GetResults())) {
             R_TRY(condvarWait(std::addressof(can_write), std::addressof(write_mutex)));
         }
 
-        ON_SCOPE_EXIT(mutexUnlock(std::addressof(write_mutex)));
         R_TRY(GetResults());
+        if (!write_buffers.ringbuf_size()) {
+            buf_out.resize(0);
+            R_SUCCEED();
+        }
+
         write_buffers.ringbuf_pop(buf_out, off_out);
         return condvarWakeOne(std::addressof(can_decompress_write));
     }
 
+    // buffers are passed to the hash thread once written, so that hashing
+    // doesn't compete with inflate / aes on the decompress thread.
+    Result SetHashBuf(PoolBuffer& buf) {
+        mutexLock(std::addressof(hash_mutex));
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(hash_mutex)));
+
+        while (!hash_buffers.ringbuf_free() && hash_running && R_SUCCEEDED(GetResults())) {
+            R_TRY(condvarWait(std::addressof(can_write_hash), std::addressof(hash_mutex)));
+        }
+
+        R_TRY(GetResults());
+        if (hash_running) {
+            hash_buffers.ringbuf_push(buf, 0);
+            condvarWakeOne(std::addressof(can_hash));
+        }
+
+        R_SUCCEED();
+    }
+
+    Result GetHashBuf(PoolBuffer& buf_out) {
+        mutexLock(std::addressof(hash_mutex));
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(hash_mutex)));
+
+        while (!hash_buffers.ringbuf_size() && write_running && R_SUCCEEDED(GetResults())) {
+            R_TRY(condvarWait(std::addressof(can_hash), std::addressof(hash_mutex)));
+        }
+
+        R_TRY(GetResults());
+        if (!hash_buffers.ringbuf_size()) {
+            buf_out.resize(0);
+            R_SUCCEED();
+        }
+
+        s64 dummy_off;
+        hash_buffers.ringbuf_pop(buf_out, dummy_off);
+        return condvarWakeOne(std::addressof(can_write_hash));
+    }
+
     // these need to be copied
     Yati* yati{};
     std::span<TikCollection> tik{};
     NcaCollection* nca{};
+    // set if the nca is to be hashed, ie hash verify isn't skipped.
+    const bool has_hash;
+    // set if the output is discarded rather than written to the placeholder.
+    const bool dry_run;
 
     // these need to be created
     Mutex read_mutex{};
     Mutex write_mutex{};
+    Mutex hash_mutex{};
 
     CondVar can_read{};
     CondVar can_decompress{};
     CondVar can_decompress_write{};
     CondVar can_write{};
+    CondVar can_hash{};
+    CondVar can_write_hash{};
 
     UEvent m_uevent_done{};
     UEvent m_uevent_progres{};
 
     RingBuf<4> read_buffers{};
     RingBuf<4> write_buffers{};
+    RingBuf<4> hash_buffers{};
 
     ncz::BlockHeader ncz_block_header{};
     std::vector<ncz::Section> ncz_sections{};
     std::vector<ncz::BlockInfo> ncz_blocks{};
 
     Sha256Context sha256{};
+    // copy of sha256 after each update, protected by hash_mutex.
+    Sha256Context hash_checkpoint{};
+    s64 hash_checkpoint_offset{};
+
+    // offset to continue a partial install from, 0 if not resuming.
+    s64 resume_offset{};
 
     u64 read_buffer_size{};
     u64 max_buffer_size{};
@@ -326,10 +476,96 @@ struct ThreadData {
     std::atomic<Result> read_result{};
     std::atomic<Result> decompress_result{};
     std::atomic<Result> write_result{};
+    std::atomic<Result> hash_result{};
 
     std::atomic_bool read_running{true};
     std::atomic_bool decompress_running{true};
     std::atomic_bool write_running{true};
+    std::atomic_bool hash_running;
+    // set by the read thread once the nca is known to not be ncz.
+    // only plain ncas can be resumed.
+    std::atomic_bool resumable{};
+
+    // ticks each stage spent working rather than waiting on the other stages,
+    // used to find which stage limits the install speed.
+    std::atomic<u64> read_ticks{};
+    std::atomic<u64> decompress_wait_ticks{};
+    std::atomic<u64> decompress_ticks{};
+    std::atomic<u64> write_ticks{};
+    std::atomic<u64> hash_ticks{};
+};
+
+// shared between the files of a batch install.
+struct Batch {
+    auto HasNca(const NcmContentId& content_id) const -> bool {
+        return std::ranges::any_of(ncas, [&content_id](auto& e){
+            return !std::memcmp(&e, &content_id, sizeof(e));
+        });
+    }
+
+    auto HasTicket(const FsRightsId& rights_id) const -> bool {
+        return std::ranges::any_of(tickets, [&rights_id](auto& e){
+            return !std::memcmp(&e, &rights_id, sizeof(e));
+        });
+    }
+
+    // sets the action to the file count and the time left for the whole batch.
+    void UpdateProgress(ui::ProgressBox* pbox) {
+        const auto seconds = armTicksToNs(armGetSystemTick() - start) / 1e+9;
+        const auto done = done_size.load();
+
+        auto action = i18n::Reorder("Installing ", std::to_string(index + 1) + " / " + std::to_string(count));
+        if (done && seconds && done < total_size) {
+            const u64 left_seconds = (total_size - done) / (done / seconds);
+            const auto hours = left_seconds / (60 * 60);
+            const auto minutes = left_seconds % (60 * 60) / 60;
+
+            char time_str[64];
+            if (hours) {
+                std::snprintf(time_str, sizeof(time_str), "%zu hours %zu minutes remaining"_i18n.c_str(), hours, minutes);
+            } else if (minutes) {
+                std::snprintf(time_str, sizeof(time_str), "%zu minutes %zu seconds remaining"_i18n.c_str(), minutes, left_seconds % 60);
+            } else {
+                std::snprintf(time_str, sizeof(time_str), "%zu seconds remaining"_i18n.c_str(), left_seconds);
+            }
+            action += std::string(" (") + time_str + ")";
+        }
+
+        pbox->SetActionName(action);
+    }
+
+    // ncas / tickets installed by a previous file in the batch.
+    std::vector<NcmContentId> ncas{};
+    std::vector<FsRightsId> tickets{};
+
+    u32 index{};
+    u32 count{};
+    s64 total_size{};
+    // updated by the install lanes.
+    std::atomic<s64> done_size{};
+    u64 start{};
+};
+
+// shared between the lanes when installing ncas in parallel.
+struct ParallelInstall {
+    ParallelInstall(Yati* _yati, std::span<TikCollection> _tickets, std::span<NcaCollection> _ncas)
+    : yati{_yati}, tickets{_tickets}, ncas{_ncas} {
+        for (const auto& nca : ncas) {
+            total_size += nca.size;
+        }
+    }
+
+    Result laneFuncInternal();
+
+    Yati* const yati;
+    const std::span<TikCollection> tickets;
+    const std::span<NcaCollection> ncas;
+
+    std::atomic<size_t> next_index{};
+    // progress is the sum of the data read by all lanes.
+    std::atomic<s64> read_offset{};
+    s64 total_size{};
+    std::atomic<Result> result{};
 };
 
 struct Yati {
@@ -337,6 +573,7 @@ struct Yati {
     ~Yati();
 
     Result Setup(const ConfigOverride& override);
+    Result InstallNcas(std::span<TikCollection> tickets, std::span<NcaCollection> ncas);
     Result InstallNca(std::span<TikCollection> tickets, NcaCollection& nca);
     Result InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca);
     Result InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cnmt, const container::Collections& collections);
@@ -344,14 +581,22 @@ struct Yati {
     Result readFuncInternal(ThreadData* t);
     Result decompressFuncInternal(ThreadData* t);
     Result writeFuncInternal(ThreadData* t);
+    Result hashFuncInternal(ThreadData* t);
+
+    // the cnmt is always written as it's parsed after being installed.
+    auto IsDryRun(const NcaCollection& nca) const -> bool {
+        return config.dry_run && nca.type != NcmContentType_Meta;
+    }
 
-    Result ParseTicketsIntoCollection(std::vector<TikCollection>& tickets, const container::Collections& collections, bool read_data);
     Result GetLatestVersion(const CnmtCollection& cnmt, u32& version_out, bool& skip);
     Result ShouldSkip(const CnmtCollection& cnmt, bool& skip);
     Result ImportTickets(std::span<TikCollection> tickets);
     Result RemoveInstalledNcas(const CnmtCollection& cnmt);
     Result RegisterNcasAndPushRecord(const CnmtCollection& cnmt, u32 latest_version_num);
 
+    void LoadWriteChunkSize();
+    void SaveWriteChunkSize(s64 size);
+
 
 // private:
     ui::ProgressBox* pbox{};
@@ -368,13 +613,39 @@ struct Yati {
     std::unique_ptr<container::Base> container{};
     Config config{};
     keys::Keys keys{};
+
+    // set whilst ncas are being installed in parallel.
+    ParallelInstall* parallel{};
+    // tickets are shared between ncas, so lock when installing in parallel.
+    Mutex ticket_mutex{};
+    // only active for installs that can be resumed.
+    journal::Journal journal{};
+    // set when installing multiple files.
+    Batch* batch{};
+    // set when the file was installed before, see cache.hpp.
+    const cache::Entry* cached{};
+    // ncas that passed the sha256 verify, protected by verified_mutex.
+    std::vector<NcmContentId> verified{};
+    Mutex verified_mutex{};
+
+    // size that placeholder writes are coalesced to, shared between lanes.
+    std::atomic<s64> write_chunk_size{WRITE_CHUNK_SIZE_DEFAULT};
+    // set if the storage hasn't been probed yet.
+    std::atomic_bool write_probe_needed{};
+    // taken by the nca that is probing, so that lanes don't probe at once.
+    std::atomic_bool write_probe_claimed{};
 };
 
 auto ThreadData::GetResults() volatile -> Result {
     R_TRY(yati->pbox->ShouldExitResult());
+    // stop early if another lane failed.
+    if (yati->parallel) {
+        R_TRY(yati->parallel->result.load());
+    }
     R_TRY(read_result.load());
     R_TRY(decompress_result.load());
     R_TRY(write_result.load());
+    R_TRY(hash_result.load());
     R_SUCCEED();
 }
 
@@ -383,14 +654,16 @@ void ThreadData::WakeAllThreads() {
     condvarWakeAll(std::addressof(can_decompress));
     condvarWakeAll(std::addressof(can_decompress_write));
     condvarWakeAll(std::addressof(can_write));
-
-    mutexUnlock(std::addressof(read_mutex));
-    mutexUnlock(std::addressof(write_mutex));
+    condvarWakeAll(std::addressof(can_hash));
+    condvarWakeAll(std::addressof(can_write_hash));
 }
 
 Result ThreadData::Read(void* buf, s64 size, u64* bytes_read) {
+    TRACE_SCOPE("yati::read");
     size = std::min<s64>(size, nca->size - read_offset);
+    const auto start = armGetSystemTick();
     const auto rc = yati->source->Read(buf, nca->offset + read_offset, size, bytes_read);
+    read_ticks += armGetSystemTick() - start;
     R_TRY(rc);
 
     R_UNLESS(size == *bytes_read, Result_YatiInvalidNcaReadSize);
@@ -430,17 +703,46 @@ Result HasRequiredTicket(const nca::Header& header, std::span<TikCollection> tik
     return HasRequiredTicket(header, ticket);
 }
 
+Result ParseTicketsIntoCollection(source::Base* source, std::vector<TikCollection>& tickets, const container::Collections& collections, bool read_data) {
+    for (const auto& collection : collections) {
+        if (collection.name.ends_with(".tik")) {
+            TikCollection entry{};
+            keys::parse_hex_key(entry.rights_id.c, collection.name.c_str());
+            const auto str = collection.name.substr(0, collection.name.length() - 4) + ".cert";
+
+            const auto cert = std::ranges::find_if(collections, [&str](auto& e){
+                return e.name.find(str) != e.name.npos;
+            });
+
+            R_UNLESS(cert != collections.cend(), Result_YatiCertNotFound);
+            entry.ticket.resize(collection.size);
+            entry.cert.resize(cert->size);
+
+            // only supported on non-stream installs.
+            if (read_data) {
+                u64 bytes_read;
+                R_TRY(source->Read(entry.ticket.data(), collection.offset, entry.ticket.size(), &bytes_read));
+                R_TRY(source->Read(entry.cert.data(), cert->offset, entry.cert.size(), &bytes_read));
+            }
+
+            tickets.emplace_back(entry);
+        }
+    }
+
+    R_SUCCEED();
+}
+
 // read thread reads all data from the source, it also handles
 // parsing ncz headers, sections and reading ncz blocks
 Result Yati::readFuncInternal(ThreadData* t) {
     ON_SCOPE_EXIT( t->read_running = false; );
 
     // the main buffer which data is read into.
-    std::vector<u8> buf;
+    PoolBuffer buf;
     // workaround ncz block reading ahead. if block isn't found, we usually
     // would seek back to the offset, however this is not possible in stream
     // mode, so we instead store the data to the temp buffer and pre-pend it.
-    std::vector<u8> temp_buf;
+    PoolBuffer temp_buf;
     buf.reserve(t->max_buffer_size);
     temp_buf.reserve(t->max_buffer_size);
 
@@ -505,39 +807,228 @@ Result Yati::readFuncInternal(ThreadData* t) {
                         block_offset += block.size;
                     }
                 }
+            } else {
+                t->resumable = true;
             }
+
+            R_UNLESS(t->resumable || !t->resume_offset, Result_YatiInvalidNcaReadSize);
         }
 
         R_TRY(t->SetDecompressBuf(buf, buffer_offset, buf_size));
+
+        // the header is always read as it's needed by the decompress thread,
+        // after that skip to the data that has yet to be written.
+        if (t->resume_offset && t->read_offset == NCZ_SECTION_OFFSET) {
+            log_write("[JOURNAL] resuming from: %zu\n", t->resume_offset);
+            t->read_offset = t->resume_offset;
+        }
     }
 
     log_write("read success\n");
     R_SUCCEED();
 }
 
+// number of threads used to decompress block ncz.
+constexpr u32 NCZ_BLOCK_WORKER_COUNT = 3;
+constexpr u32 NCZ_BLOCK_SLOT_COUNT = NCZ_BLOCK_WORKER_COUNT * 2;
+// blocks larger than this are decompressed serially to limit memory usage.
+constexpr u32 NCZ_BLOCK_MAX_EXPONENT = 24;
+
+struct NczBlockJob {
+    PoolBuffer in{};
+    PoolBuffer out{};
+    u64 size{};
+    bool compressed{};
+};
+
+// block ncz stores each block as its own zstd frame, so blocks are
+// decompressed by a pool of workers and collected back in order.
+struct NczBlockPool {
+    NczBlockPool(ThreadData* _t) : t{_t} {
+        mutexInit(std::addressof(mutex));
+        condvarInit(std::addressof(can_work));
+        condvarInit(std::addressof(can_collect));
+    }
+
+    ~NczBlockPool() {
+        {
+            SCOPED_MUTEX(std::addressof(mutex));
+            finished = true;
+            condvarWakeAll(std::addressof(can_work));
+        }
+
+        for (u32 i = 0; i < worker_count; i++) {
+            threadWaitForExit(&workers[i]);
+            threadClose(&workers[i]);
+        }
+    }
+
+    Result Start() {
+        for (u32 i = 0; i < NCZ_BLOCK_WORKER_COUNT; i++) {
+            R_TRY(utils::CreateThread(&workers[i], workerFunc, this, utils::ThreadRole::Compute));
+            if (R_FAILED(threadStart(&workers[i]))) {
+                threadClose(&workers[i]);
+                break;
+            }
+            worker_count++;
+        }
+
+        R_UNLESS(worker_count, Result_YatiInvalidNczZstdError);
+        R_SUCCEED();
+    }
+
+    auto GetResults() -> Result {
+        R_TRY(t->GetResults());
+        R_TRY(result.load());
+        R_SUCCEED();
+    }
+
+    auto IsFull() const -> bool {
+        return queued - collected == NCZ_BLOCK_SLOT_COUNT;
+    }
+
+    auto IsEmpty() const -> bool {
+        return queued == collected;
+    }
+
+    // swaps the compressed block with an empty buffer.
+    Result Push(PoolBuffer& in, u64 size, bool compressed) {
+        R_UNLESS(!IsFull(), Result_YatiInvalidNczZstdError);
+
+        auto& job = jobs[queued % NCZ_BLOCK_SLOT_COUNT];
+        std::swap(job.in, in);
+        job.size = size;
+        job.compressed = compressed;
+
+        SCOPED_MUTEX(std::addressof(mutex));
+        queued++;
+        condvarWakeOne(std::addressof(can_work));
+        R_SUCCEED();
+    }
+
+    // waits for the oldest block to finish and swaps out the decompressed data.
+    Result Pop(PoolBuffer& out) {
+        const auto index = collected % NCZ_BLOCK_SLOT_COUNT;
+
+        mutexLock(std::addressof(mutex));
+        ON_SCOPE_EXIT(mutexUnlock(std::addressof(mutex)));
+
+        while (!done[index] && R_SUCCEEDED(GetResults())) {
+            // timeout so that cancelling is noticed.
+            condvarWaitTimeout(std::addressof(can_collect), std::addressof(mutex), 1e+8); // 100ms
+        }
+
+        R_TRY(GetResults());
+        std::swap(jobs[index].out, out);
+        done[index] = false;
+        collected++;
+        R_SUCCEED();
+    }
+
+private:
+    Result workerFuncInternal() {
+        utils::zstd::DCtx dctx{utils::zstd::AcquireDCtx()};
+        R_UNLESS(dctx, Result_YatiInvalidNczZstdError);
+
+        for (;;) {
+            mutexLock(std::addressof(mutex));
+            while (next_job == queued && !finished && R_SUCCEEDED(GetResults())) {
+                condvarWaitTimeout(std::addressof(can_work), std::addressof(mutex), 1e+8); // 100ms
+            }
+
+            if (next_job == queued || R_FAILED(GetResults())) {
+                mutexUnlock(std::addressof(mutex));
+                break;
+            }
+
+            const auto index = next_job++ % NCZ_BLOCK_SLOT_COUNT;
+            mutexUnlock(std::addressof(mutex));
+
+            auto& job = jobs[index];
+            if (job.compressed) {
+                job.out.resize(job.size);
+                const auto res = ZSTD_decompressDCtx(dctx.get(), job.out.data(), job.out.size(), job.in.data(), job.in.size());
+                if (ZSTD_isError(res)) {
+                    log_write("[NCZ] ZSTD_decompressDCtx() size: %zu res: %zd msg: %s\n", job.in.size(), res, ZSTD_getErrorName(res));
+                }
+                R_UNLESS(!ZSTD_isError(res), Result_YatiInvalidNczZstdError);
+                R_UNLESS(res == job.size, Result_YatiInvalidNczZstdError);
+            } else {
+                std::swap(job.out, job.in);
+            }
+
+            SCOPED_MUTEX(std::addressof(mutex));
+            done[index] = true;
+            condvarWakeAll(std::addressof(can_collect));
+        }
+
+        R_SUCCEED();
+    }
+
+    static void workerFunc(void* d) {
+        App::ComputeBoost boost;
+        auto pool = static_cast<NczBlockPool*>(d);
+        if (const auto rc = pool->workerFuncInternal(); R_FAILED(rc)) {
+            pool->result = rc;
+        }
+    }
+
+private:
+    ThreadData* const t;
+    NczBlockJob jobs[NCZ_BLOCK_SLOT_COUNT]{};
+    Thread workers[NCZ_BLOCK_WORKER_COUNT]{};
+    u32 worker_count{};
+
+    Mutex mutex{};
+    // signalled when a block has been queued.
+    CondVar can_work{};
+    // signalled when a block has been decompressed.
+    CondVar can_collect{};
+
+    // queued and collected are only modified by the decompress thread.
+    u64 queued{};
+    u64 collected{};
+    // protected by mutex.
+    u64 next_job{};
+    bool done[NCZ_BLOCK_SLOT_COUNT]{};
+    bool finished{};
+
+    std::atomic<Result> result{};
+};
+
 // decompress thread handles decrypting / modifying the nca header, decompressing ncz
-// and calculating the running sha256.
+// and re-encrypting the ncz sections.
 Result Yati::decompressFuncInternal(ThreadData* t) {
-    ON_SCOPE_EXIT( t->decompress_running = false; );
+    const auto start = armGetSystemTick();
+    ON_SCOPE_EXIT(
+        t->decompress_ticks = armGetSystemTick() - start - t->decompress_wait_ticks;
+        t->decompress_running = false;
+    );
 
     // only used for ncz files.
-    auto dctx = ZSTD_createDCtx();
-    ON_SCOPE_EXIT(ZSTD_freeDCtx(dctx));
+    utils::zstd::DCtx dctx{utils::zstd::AcquireDCtx()};
+    R_UNLESS(dctx, Result_YatiInvalidNczZstdError);
     const auto chunk_size = ZSTD_DStreamOutSize();
     const ncz::Section* ncz_section{};
     const ncz::BlockInfo* ncz_block{};
     bool is_ncz{};
 
     s64 inflate_offset{};
-    Aes128CtrContext ctx{};
-    std::vector<u8> inflate_buf{};
+    crypto::Aes128Ctr ctx{};
+    PoolBuffer inflate_buf{};
     inflate_buf.reserve(t->max_buffer_size);
 
     s64 written{};
     s64 block_offset{};
-    std::vector<u8> buf{};
+    PoolBuffer buf{};
     buf.reserve(t->max_buffer_size);
 
+    // only used for block ncz.
+    std::unique_ptr<NczBlockPool> block_pool{};
+    PoolBuffer block_buf{};
+    PoolBuffer block_out{};
+    u64 block_index{};
+
     // encrypts the nca and passes the buffer to the write thread.
     const auto ncz_flush = [&](s64 size) -> Result {
         if (!inflate_offset) {
@@ -548,7 +1039,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         // the remaining data.
         // rather that copying the entire vector to the write thread,
         // only copy (store) the remaining amount.
-        std::vector<u8> temp_vector{};
+        PoolBuffer temp_vector{};
         if (size < inflate_offset) {
             temp_vector.resize(inflate_offset - size);
             std::memcpy(temp_vector.data(), inflate_buf.data() + size, temp_vector.size());
@@ -556,22 +1047,22 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
 
         for (s64 off = 0; off < size;) {
             if (!ncz_section || !ncz_section->InRange(written)) {
-                log_write("[NCZ] looking for new section: %zu off: %zu size: %zu\n", written, off, size);
+                log_debug(LogCategory_Ncz, "[NCZ] looking for new section: %zu off: %zu size: %zu\n", written, off, size);
                 auto it = std::ranges::find_if(t->ncz_sections, [written](auto& e){
-                    log_write("\t[NCZ] checking offset: %zu size: %zu written: %zu\n", e.offset, e.size, written);
+                    log_debug(LogCategory_Ncz, "\t[NCZ] checking offset: %zu size: %zu written: %zu\n", e.offset, e.size, written);
                     return e.InRange(written);
                 });
 
                 R_UNLESS(it != t->ncz_sections.cend(), Result_YatiNczSectionNotFound);
                 ncz_section = &(*it);
-                log_write("[NCZ] found new section: %zu\n", written);
+                log_debug(LogCategory_Ncz, "[NCZ] found new section: %zu\n", written);
 
                 if (ncz_section->crypto_type >= nca::EncryptionType_AesCtr) {
                     const auto swp = std::byteswap(u64(written) >> 4);
                     u8 counter[0x16];
                     std::memcpy(counter + 0x0, ncz_section->counter, 0x8);
                     std::memcpy(counter + 0x8, &swp, 0x8);
-                    aes128CtrContextCreate(&ctx, ncz_section->key, counter);
+                    ctx.Create(ncz_section->key, counter);
                 }
             }
 
@@ -579,25 +1070,80 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
             const auto chunk_size = std::min<u64>(total_size - written, size - off);
 
             if (ncz_section->crypto_type >= nca::EncryptionType_AesCtr) {
-                aes128CtrCrypt(&ctx, inflate_buf.data() + off, inflate_buf.data() + off, chunk_size);
+                ctx.Crypt(inflate_buf.data() + off, inflate_buf.data() + off, chunk_size);
             }
 
             written += chunk_size;
             off += chunk_size;
         }
 
-        R_TRY(t->SetWriteBuf(inflate_buf, size, config.skip_nca_hash_verify));
+        R_TRY(t->SetWriteBuf(inflate_buf, size));
         inflate_offset -= size;
 
         // restore remaining data to the swapped buffer.
         if (!temp_vector.empty()) {
-            log_write("[NCZ] storing data size: %zu\n", temp_vector.size());
+            log_debug(LogCategory_Ncz, "[NCZ] storing data size: %zu\n", temp_vector.size());
             inflate_buf = temp_vector;
         }
 
         R_SUCCEED();
     };
 
+    const auto block_decompressed_size = [&](u64 index) -> u64 {
+        // https://github.com/nicoboss/nsz/issues/210
+        u64 size = 1ULL << t->ncz_block_header.block_size_exponent;
+        if (index == t->ncz_blocks.size() - 1) {
+            const auto remainder = t->ncz_block_header.decompressed_size % size;
+            if (remainder) {
+                size = remainder;
+            }
+        }
+        return size;
+    };
+
+    // collects the oldest block from the pool and passes it on for encryption.
+    const auto block_collect = [&]() -> Result {
+        R_TRY(block_pool->Pop(block_out));
+
+        inflate_buf.resize(inflate_offset + block_out.size());
+        std::memcpy(inflate_buf.data() + inflate_offset, block_out.data(), block_out.size());
+
+        t->decompress_offset += block_out.size();
+        inflate_offset += block_out.size();
+        while (inflate_offset >= INFLATE_BUFFER_MAX) {
+            R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
+        }
+
+        R_SUCCEED();
+    };
+
+    // gathers whole blocks from the buffer and queues them in the pool.
+    const auto block_submit = [&](std::span<const u8> buffer, s64 buffer_off) -> Result {
+        while (!buffer.empty()) {
+            R_UNLESS(block_index < t->ncz_blocks.size(), Result_YatiNczBlockNotFound);
+            const auto& block = t->ncz_blocks[block_index];
+            R_UNLESS(block.InRange(buffer_off), Result_YatiNczBlockNotFound);
+
+            const auto size = std::min<u64>(buffer.size(), block.size - block_buf.size());
+            block_buf.insert(block_buf.end(), buffer.data(), buffer.data() + size);
+            buffer = buffer.subspan(size);
+            buffer_off += size;
+
+            if (block_buf.size() == block.size) {
+                if (block_pool->IsFull()) {
+                    R_TRY(block_collect());
+                }
+
+                const auto decompressed_size = block_decompressed_size(block_index);
+                R_TRY(block_pool->Push(block_buf, decompressed_size, block.size < decompressed_size));
+                block_buf.clear();
+                block_index++;
+            }
+        }
+
+        R_SUCCEED();
+    };
+
     while (t->decompress_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
         s64 decompress_buf_off{};
         R_TRY(t->GetDecompressBuf(buf, decompress_buf_off));
@@ -609,6 +1155,12 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         if (!is_ncz && !t->ncz_sections.empty()) {
             log_write("YES IT FOUND NCZ\n");
             is_ncz = true;
+
+            if (!t->ncz_blocks.empty() && t->ncz_block_header.block_size_exponent <= NCZ_BLOCK_MAX_EXPONENT) {
+                log_write("[NCZ] using block pool, total blocks: %zu\n", t->ncz_blocks.size());
+                block_pool = std::make_unique<NczBlockPool>(t);
+                R_TRY(block_pool->Start());
+            }
         }
 
         // if we don't have a ncz or it's before the ncz header, pass buffer directly to write
@@ -634,8 +1186,10 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
 
                 t->write_size = header.size;
-                log_write("setting placeholder size: %zu\n", t->write_size.load());
-                R_TRY(ncmContentStorageSetPlaceHolderSize(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_size));
+                if (!t->dry_run) {
+                    log_write("setting placeholder size: %zu\n", t->write_size.load());
+                    R_TRY(ncmContentStorageSetPlaceHolderSize(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_size));
+                }
 
                 if (!config.ignore_distribution_bit && header.distribution_type == nca::DistributionType_GameCard) {
                     header.distribution_type = nca::DistributionType_System;
@@ -643,6 +1197,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
 
                 // try and get the ticket, if the nca requires it.
+                SCOPED_MUTEX(std::addressof(ticket_mutex));
                 auto ticket = GetTicketCollection(header, t->tik);
                 R_TRY(HasRequiredTicket(header, ticket));
 
@@ -675,9 +1230,18 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
             }
 
+            if (!decompress_buf_off && t->resume_offset) {
+                // the header was written by the previous install.
+                written = t->resume_offset;
+                t->decompress_offset = t->resume_offset;
+                continue;
+            }
+
             written += buf.size();
             t->decompress_offset += buf.size();
-            R_TRY(t->SetWriteBuf(buf, buf.size(), config.skip_nca_hash_verify));
+            R_TRY(t->SetWriteBuf(buf, buf.size()));
+        } else if (block_pool) {
+            R_TRY(block_submit(buf, decompress_buf_off));
         } else if (is_ncz) {
             u64 buf_off{};
             while (buf_off < buf.size()) {
@@ -688,13 +1252,13 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 if (t->ncz_blocks.size()) {
                     if (!ncz_block || !ncz_block->InRange(decompress_buf_off)) {
                         block_offset = 0;
-                        log_write("[NCZ] looking for new block: %zu\n", decompress_buf_off);
+                        log_debug(LogCategory_Ncz, "[NCZ] looking for new block: %zu\n", decompress_buf_off);
                         auto it = std::ranges::find_if(t->ncz_blocks, [decompress_buf_off](auto& e){
                             return e.InRange(decompress_buf_off);
                         });
 
                         R_UNLESS(it != t->ncz_blocks.cend(), Result_YatiNczBlockNotFound);
-                        log_write("[NCZ] found new block: %zu off: %zd size: %zd\n", decompress_buf_off, it->offset, it->size);
+                        log_debug(LogCategory_Ncz, "[NCZ] found new block: %zu off: %zd size: %zd\n", decompress_buf_off, it->offset, it->size);
                         ncz_block = &(*it);
                     }
 
@@ -719,14 +1283,18 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                 }
 
                 if (compressed) {
-                    log_write("[NCZ] COMPRESSED block\n");
+                    log_debug(LogCategory_Ncz, "[NCZ] COMPRESSED block\n");
                     ZSTD_inBuffer input = { buffer.data(), buffer.size(), 0 };
                     while (input.pos < input.size) {
                         R_TRY(t->GetResults());
 
                         inflate_buf.resize(inflate_offset + chunk_size);
                         ZSTD_outBuffer output = { inflate_buf.data() + inflate_offset, chunk_size, 0 };
-                        const auto res = ZSTD_decompressStream(dctx, std::addressof(output), std::addressof(input));
+                        size_t res;
+                        {
+                            TRACE_SCOPE("yati::decompress");
+                            res = ZSTD_decompressStream(dctx.get(), std::addressof(output), std::addressof(input));
+                        }
                         if (ZSTD_isError(res)) {
                             log_write("[NCZ] ZSTD_decompressStream() pos: %zu size: %zu res: %zd msg: %s\n", input.pos, input.size, res, ZSTD_getErrorName(res));
                         }
@@ -735,7 +1303,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                         t->decompress_offset += output.pos;
                         inflate_offset += output.pos;
                         if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                            log_write("[NCZ] flushing compressed data: %zd vs %zd diff: %zd\n", inflate_offset, INFLATE_BUFFER_MAX, inflate_offset - INFLATE_BUFFER_MAX);
+                            log_debug(LogCategory_Ncz, "[NCZ] flushing compressed data: %zd vs %zd diff: %zd\n", inflate_offset, INFLATE_BUFFER_MAX, inflate_offset - INFLATE_BUFFER_MAX);
                             R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
                         }
                     }
@@ -746,7 +1314,7 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
                     t->decompress_offset += buffer.size();
                     inflate_offset += buffer.size();
                     if (inflate_offset >= INFLATE_BUFFER_MAX) {
-                        log_write("[NCZ] flushing copy data\n");
+                        log_debug(LogCategory_Ncz, "[NCZ] flushing copy data\n");
                         R_TRY(ncz_flush(INFLATE_BUFFER_MAX));
                     }
                 }
@@ -758,54 +1326,174 @@ Result Yati::decompressFuncInternal(ThreadData* t) {
         }
     }
 
-    // flush remaining data.
-    if (is_ncz && inflate_offset) {
-        log_write("flushing remaining\n");
-        R_TRY(ncz_flush(inflate_offset));
-    }
+    // collect the remaining blocks.
+    while (block_pool && !block_pool->IsEmpty()) {
+        R_TRY(block_collect());
+    }
+
+    // flush remaining data.
+    if (is_ncz && inflate_offset) {
+        log_write("flushing remaining\n");
+        R_TRY(ncz_flush(inflate_offset));
+    }
+
+    log_write("decompress thread done!\n");
+    R_SUCCEED();
+}
+
+// write thread writes data to the nca placeholder.
+// the decompressed buffers vary in size, so they're coalesced into writes of
+// write_chunk_size, with anything left over carried into the next buffer.
+Result Yati::writeFuncInternal(ThreadData* t) {
+    ON_SCOPE_EXIT( t->write_running = false; );
+
+    PoolBuffer buf;
+    PoolBuffer pending;
+    buf.reserve(t->max_buffer_size);
+    pending.reserve(t->max_buffer_size + WRITE_CHUNK_SIZE_DEFAULT);
+    const auto is_file_based_emummc = App::IsFileBaseEmummc();
+
+    // times each chunk size on the real writes of this nca.
+    struct WriteProbe {
+        u64 ticks[std::size(WRITE_CHUNK_SIZES)]{};
+        s64 written{};
+        u32 index{};
+    } probe{};
+
+    bool probing = write_probe_needed && !t->dry_run && t->write_size >= WRITE_PROBE_MIN_NCA_SIZE && !write_probe_claimed.exchange(true);
+    ON_SCOPE_EXIT(
+        // let the next nca try if this one didn't finish the probe.
+        if (probing) {
+            write_probe_claimed = false;
+        }
+    );
+
+    const auto probe_update = [&](s64 wsize, u64 ticks) {
+        probe.ticks[probe.index] += ticks;
+        probe.written += wsize;
+        if (probe.written < WRITE_PROBE_SIZE) {
+            return;
+        }
+
+        probe.written = 0;
+        if (++probe.index < std::size(WRITE_CHUNK_SIZES)) {
+            return;
+        }
+
+        // the same amount is written with each size, so the fastest is the
+        // one that took the least ticks.
+        u32 best{};
+        for (u32 i = 0; i < std::size(WRITE_CHUNK_SIZES); i++) {
+            log_write("[YATI] write probe: size: %zd ticks: %zu\n", WRITE_CHUNK_SIZES[i], probe.ticks[i]);
+            if (probe.ticks[i] < probe.ticks[best]) {
+                best = i;
+            }
+        }
+
+        SaveWriteChunkSize(WRITE_CHUNK_SIZES[best]);
+        probing = false;
+    };
+
+    const auto write_chunk = [&](const u8* data, s64 wsize) -> Result {
+        TRACE_SCOPE("yati::write");
+        const auto start = armGetSystemTick();
+        if (!t->dry_run) {
+            R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, data, wsize));
+        }
+        const auto ticks = armGetSystemTick() - start;
+        t->write_ticks += ticks;
+
+        t->write_offset += wsize;
+        ueventSignal(t->GetProgressEvent());
+
+        if (probing) {
+            probe_update(wsize, ticks);
+        }
+
+        if (is_file_based_emummc && !t->dry_run) {
+            thread::EmummcThrottle(start);
+        }
+
+        R_SUCCEED();
+    };
+
+    bool eof{};
+    while (!eof && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
+        s64 dummy_off;
+        R_TRY(t->GetWriteBuf(buf, dummy_off));
+        eof = buf.empty();
+
+        // swap rather than copy when nothing was left over.
+        if (pending.empty()) {
+            std::swap(pending, buf);
+        } else {
+            pending.insert(pending.end(), buf.begin(), buf.end());
+        }
+
+        // everything is written once the decompress thread is done.
+        const auto flush = eof || t->write_offset + (s64)pending.size() >= t->write_size;
+
+        s64 off{};
+        while (off < pending.size() && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
+            const auto chunk_size = probing ? WRITE_CHUNK_SIZES[probe.index] : write_chunk_size.load();
+            const auto wsize = std::min<s64>(chunk_size, pending.size() - off);
+            if (wsize < chunk_size && !flush) {
+                break;
+            }
+
+            R_TRY(write_chunk(pending.data() + off, wsize));
+            off += wsize;
+        }
+
+        if (!off) {
+            continue;
+        }
 
-    log_write("decompress thread done!\n");
+        // pass on only what has been written, the rest waits for more data.
+        if (off == pending.size()) {
+            buf.resize(0);
+            std::swap(pending, buf);
+        } else {
+            buf.assign(pending.begin(), pending.begin() + off);
+            pending.erase(pending.begin(), pending.begin() + off);
+        }
 
-    // get final hash output.
-    sha256ContextGetHash(std::addressof(t->sha256), t->nca->hash);
+        if (t->has_hash) {
+            R_TRY(t->SetHashBuf(buf));
+        }
+    }
 
+    log_write("finished write thread!\n");
     R_SUCCEED();
 }
 
-// write thread writes data to the nca placeholder.
-Result Yati::writeFuncInternal(ThreadData* t) {
-    ON_SCOPE_EXIT( t->write_running = false; );
+// hash thread calculates the running sha256 of the data written.
+Result Yati::hashFuncInternal(ThreadData* t) {
+    ON_SCOPE_EXIT( t->hash_running = false; );
 
-    std::vector<u8> buf;
+    PoolBuffer buf;
     buf.reserve(t->max_buffer_size);
-    const auto is_file_based_emummc = App::IsFileBaseEmummc();
 
-    while (t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
-        s64 dummy_off;
-        R_TRY(t->GetWriteBuf(buf, dummy_off));
+    for (;;) {
+        R_TRY(t->GetHashBuf(buf));
         if (buf.empty()) {
             break;
         }
 
-        s64 off{};
-        while (off < buf.size() && t->write_offset < t->write_size && R_SUCCEEDED(t->GetResults())) {
-            const auto wsize = std::min<s64>(t->read_buffer_size, buf.size() - off);
-            R_TRY(ncmContentStorageWritePlaceHolder(std::addressof(cs), std::addressof(t->nca->placeholder_id), t->write_offset, buf.data() + off, wsize));
+        TRACE_SCOPE("yati::hash");
+        const auto start = armGetSystemTick();
+        sha256ContextUpdate(std::addressof(t->sha256), buf.data(), buf.size());
+        t->hash_ticks += armGetSystemTick() - start;
 
-            off += wsize;
-            t->write_offset += wsize;
-            ueventSignal(t->GetProgressEvent());
-
-            // todo: check how much time elapsed and sleep the diff
-            // rather than always sleeping a fixed amount.
-            // ie, writing a small buffer (nca header) should not sleep the full 2 ms.
-            if (is_file_based_emummc) {
-                svcSleepThread(2e+6); // 2ms
-            }
-        }
+        SCOPED_MUTEX(std::addressof(t->hash_mutex));
+        t->hash_checkpoint = t->sha256;
+        t->hash_checkpoint_offset += buf.size();
     }
 
-    log_write("finished write thread!\n");
+    // get final hash output.
+    sha256ContextGetHash(std::addressof(t->sha256), t->nca->hash);
+
+    log_write("finished hash thread!\n");
     R_SUCCEED();
 }
 
@@ -817,6 +1505,7 @@ void readFunc(void* d) {
 
 void decompressFunc(void* d) {
     log_write("hello decomp thread func\n");
+    App::ComputeBoost boost;
     auto t = static_cast<ThreadData*>(d);
     t->SetDecompressResult(t->yati->decompressFuncInternal(t));
     log_write("decompress thread returned now\n");
@@ -828,6 +1517,13 @@ void writeFunc(void* d) {
     log_write("write thread returned now\n");
 }
 
+void hashFunc(void* d) {
+    App::ComputeBoost boost;
+    auto t = static_cast<ThreadData*>(d);
+    t->SetHashResult(t->yati->hashFuncInternal(t));
+    log_write("hash thread returned now\n");
+}
+
 // stdio-like wrapper for std::vector
 struct BufHelper {
     BufHelper() = default;
@@ -880,6 +1576,35 @@ Yati::~Yati() {
     ui::menu::game::SignalChange();
 }
 
+auto GetWriteChunkSizeKey(NcmStorageId storage_id) -> const char* {
+    return storage_id == NcmStorageId_SdCard ? "write_size_sd" : "write_size_nand";
+}
+
+void Yati::LoadWriteChunkSize() {
+    write_probe_needed = false;
+
+    // writes are kept small and throttled on file based emummc.
+    if (App::IsFileBaseEmummc()) {
+        write_chunk_size = 1024 * 512;
+        return;
+    }
+
+    const auto size = App::GetConfigStore().GetLong(INI_SECTION_INSTALL, GetWriteChunkSizeKey(storage_id), 0);
+    if (std::ranges::find(WRITE_CHUNK_SIZES, size) != std::end(WRITE_CHUNK_SIZES)) {
+        write_chunk_size = size;
+    } else {
+        write_chunk_size = WRITE_CHUNK_SIZE_DEFAULT;
+        write_probe_needed = true;
+    }
+}
+
+void Yati::SaveWriteChunkSize(s64 size) {
+    log_write("[YATI] using write size: %zd for storage: %u\n", size, storage_id);
+    write_chunk_size = size;
+    write_probe_needed = false;
+    App::GetConfigStore().SetLong(INI_SECTION_INSTALL, GetWriteChunkSizeKey(storage_id), size);
+}
+
 Result Yati::Setup(const ConfigOverride& override) {
     config.sd_card_install = override.sd_card_install.value_or(App::GetApp()->m_install_sd.Get());
     config.allow_downgrade = App::GetApp()->m_allow_downgrade.Get();
@@ -891,6 +1616,7 @@ Result Yati::Setup(const ConfigOverride& override) {
     config.skip_data_patch = App::GetApp()->m_skip_data_patch.Get();
     config.skip_ticket = App::GetApp()->m_skip_ticket.Get();
     config.skip_nca_hash_verify = override.skip_nca_hash_verify.value_or(App::GetApp()->m_skip_nca_hash_verify.Get());
+    config.skip_cached_hash_verify = App::GetApp()->m_skip_cached_hash_verify.Get();
     config.skip_rsa_header_fixed_key_verify = override.skip_rsa_header_fixed_key_verify.value_or(App::GetApp()->m_skip_rsa_header_fixed_key_verify.Get());
     config.skip_rsa_npdm_fixed_key_verify = override.skip_rsa_npdm_fixed_key_verify.value_or(App::GetApp()->m_skip_rsa_npdm_fixed_key_verify.Get());
     config.ignore_distribution_bit = override.ignore_distribution_bit.value_or(App::GetApp()->m_ignore_distribution_bit.Get());
@@ -898,7 +1624,22 @@ Result Yati::Setup(const ConfigOverride& override) {
     config.convert_to_standard_crypto = override.convert_to_standard_crypto.value_or(App::GetApp()->m_convert_to_standard_crypto.Get());
     config.lower_master_key = override.lower_master_key.value_or(App::GetApp()->m_lower_master_key.Get());
     config.lower_system_version = override.lower_system_version.value_or(App::GetApp()->m_lower_system_version.Get());
+    config.dry_run = override.dry_run.value_or(App::GetApp()->m_install_dry_run.Get());
+
+    // always run every stage when benchmarking.
+    if (config.dry_run) {
+        config.skip_if_already_installed = false;
+        config.ticket_only = false;
+        config.allow_downgrade = true;
+        config.skip_base = false;
+        config.skip_patch = false;
+        config.skip_addon = false;
+        config.skip_data_patch = false;
+        config.skip_nca_hash_verify = false;
+        config.skip_cached_hash_verify = false;
+    }
     storage_id = config.sd_card_install ? NcmStorageId_SdCard : NcmStorageId_BuiltInUser;
+    LoadWriteChunkSize();
 
     R_TRY(source->GetOpenResult());
     R_TRY(splCryptoInitialize());
@@ -918,25 +1659,106 @@ Result Yati::Setup(const ConfigOverride& override) {
 }
 
 Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection& nca) {
-    if (config.skip_if_already_installed || config.ticket_only) {
+    // ncas shared between files of a batch are only installed once.
+    if (config.skip_if_already_installed || config.ticket_only || (batch && batch->HasNca(nca.content_id))) {
         R_TRY(ncmContentStorageHas(std::addressof(cs), std::addressof(nca.skipped), std::addressof(nca.content_id)));
         if (nca.skipped) {
             log_write("\tskipped nca as it's already installed ncmContentStorageHas()\n");
             R_TRY(ncmContentStorageReadContentIdFile(std::addressof(cs), std::addressof(nca.header), sizeof(nca.header), std::addressof(nca.content_id), 0));
             crypto::cryptoAes128Xts(std::addressof(nca.header), std::addressof(nca.header), keys.header_key, 0, 0x200, sizeof(nca.header), false);
 
+            if (parallel) {
+                parallel->read_offset += nca.size;
+            }
+
+            SCOPED_MUTEX(std::addressof(ticket_mutex));
             R_TRY(HasRequiredTicket(nca.header, tickets));
             R_SUCCEED();
         }
     }
 
-    log_write("generateing placeholder\n");
-    R_TRY(ncmContentStorageGeneratePlaceHolderId(std::addressof(cs), std::addressof(nca.placeholder_id)));
-    log_write("creating placeholder\n");
-    R_TRY(ncmContentStorageCreatePlaceHolder(std::addressof(cs), std::addressof(nca.content_id), std::addressof(nca.placeholder_id), nca.size));
+    // the same file was verified on a previous install and hasn't changed since.
+    const auto cache_verified = config.skip_cached_hash_verify && cached && cached->IsVerified(nca.content_id);
+    const auto has_hash = !config.skip_nca_hash_verify && !cache_verified;
+
+    // check if a previous install of this nca can be continued.
+    journal::Entry saved{};
+    bool resume{};
+    if (journal.IsActive() && journal.Find(nca.content_id, saved)) {
+        bool has_placeholder{};
+        ncmContentStorageHasPlaceHolder(std::addressof(cs), std::addressof(has_placeholder), std::addressof(saved.placeholder_id));
+
+        // the hash can only be verified if it was calculated last time as well.
+        if (has_placeholder && saved.size == nca.size && (saved.has_hash || !has_hash)) {
+            resume = true;
+        } else {
+            if (has_placeholder) {
+                ncmContentStorageDeletePlaceHolder(std::addressof(cs), std::addressof(saved.placeholder_id));
+            }
+            journal.Remove(nca.content_id);
+        }
+    }
+
+    if (resume && saved.complete) {
+        log_write("[JOURNAL] nca already installed: %s\n", nca.name.c_str());
+        nca.placeholder_id = saved.placeholder_id;
+        nca.header = saved.header;
+        nca.modified = saved.modified;
+        std::memcpy(nca.hash, saved.hash, sizeof(nca.hash));
+
+        if (parallel) {
+            parallel->read_offset += nca.size;
+        }
+
+        SCOPED_MUTEX(std::addressof(ticket_mutex));
+        R_TRY(HasRequiredTicket(nca.header, tickets));
+        R_SUCCEED();
+    }
+
+    if (resume) {
+        log_write("[JOURNAL] resuming nca: %s offset: %zu\n", nca.name.c_str(), saved.offset);
+        nca.placeholder_id = saved.placeholder_id;
+    } else if (IsDryRun(nca)) {
+        log_write("[YATI] dry run, not creating placeholder\n");
+    } else {
+        log_write("generateing placeholder\n");
+        R_TRY(ncmContentStorageGeneratePlaceHolderId(std::addressof(cs), std::addressof(nca.placeholder_id)));
+        log_write("creating placeholder\n");
+        R_TRY(ncmContentStorageCreatePlaceHolder(std::addressof(cs), std::addressof(nca.content_id), std::addressof(nca.placeholder_id), nca.size));
+    }
 
     log_write("opening thread\n");
-    ThreadData t_data{this, tickets, std::addressof(nca)};
+    ThreadData t_data{this, tickets, std::addressof(nca), has_hash, IsDryRun(nca)};
+    if (resume) {
+        t_data.resume_offset = saved.offset;
+        t_data.write_offset = saved.offset;
+        t_data.hash_checkpoint_offset = saved.offset;
+        t_data.sha256 = saved.sha256;
+        t_data.hash_checkpoint = saved.sha256;
+    }
+
+    // stores the progress of the nca so that it can be resumed if the
+    // install fails, the placeholder is flushed first so that the data
+    // recorded is actually on disk.
+    const auto checkpoint = [&]() {
+        if (!t_data.resumable) {
+            return;
+        }
+
+        journal::Entry entry{};
+        entry.content_id = nca.content_id;
+        entry.placeholder_id = nca.placeholder_id;
+        entry.size = nca.size;
+        entry.has_hash = t_data.has_hash;
+        t_data.GetCheckpoint(entry.offset, entry.sha256);
+        if (entry.offset <= NCZ_SECTION_OFFSET) {
+            return;
+        }
+
+        if (R_FAILED(ncmContentStorageFlushPlaceHolder(std::addressof(cs))) || R_FAILED(journal.Update(entry))) {
+            log_write("[JOURNAL] failed to update journal: %s\n", nca.name.c_str());
+        }
+    };
 
     #define READ_THREAD_CORE 1
     #define DECOMPRESS_THREAD_CORE 2
@@ -946,18 +1768,25 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
     // #define WRITE_THREAD_CORE 2
 
     Thread t_read{};
-    R_TRY(utils::CreateThread(&t_read, readFunc, std::addressof(t_data), 1024*64));
+    R_TRY(utils::CreateThread(&t_read, readFunc, std::addressof(t_data), utils::ThreadRole::Io, 1024*64));
     ON_SCOPE_EXIT(threadClose(&t_read));
 
     Thread t_decompress{};
-    R_TRY(utils::CreateThread(&t_decompress, decompressFunc, std::addressof(t_data), 1024*64));
+    R_TRY(utils::CreateThread(&t_decompress, decompressFunc, std::addressof(t_data), utils::ThreadRole::Compute, 1024*64));
     ON_SCOPE_EXIT(threadClose(&t_decompress));
 
     Thread t_write{};
-    R_TRY(utils::CreateThread(&t_write, writeFunc, std::addressof(t_data), 1024*64));
+    R_TRY(utils::CreateThread(&t_write, writeFunc, std::addressof(t_data), utils::ThreadRole::Io, 1024*64));
     ON_SCOPE_EXIT(threadClose(&t_write));
 
+    Thread t_hash{};
+    if (t_data.has_hash) {
+        R_TRY(utils::CreateThread(&t_hash, hashFunc, std::addressof(t_data), utils::ThreadRole::Compute, 1024*64));
+    }
+    ON_SCOPE_EXIT(if (t_data.has_hash) { threadClose(&t_hash); });
+
     log_write("starting threads\n");
+    const auto start = armGetSystemTick();
     R_TRY(threadStart(std::addressof(t_read)));
     ON_SCOPE_EXIT(threadWaitForExit(std::addressof(t_read)));
 
@@ -967,10 +1796,23 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
     R_TRY(threadStart(std::addressof(t_write)));
     ON_SCOPE_EXIT(threadWaitForExit(std::addressof(t_write)));
 
+    if (t_data.has_hash) {
+        R_TRY(threadStart(std::addressof(t_hash)));
+    }
+    ON_SCOPE_EXIT(if (t_data.has_hash) { threadWaitForExit(std::addressof(t_hash)); });
+
     const auto waiter_progress = waiterForUEvent(t_data.GetProgressEvent());
     const auto waiter_cancel = waiterForUEvent(pbox->GetCancelEvent());
     const auto waiter_done = waiterForUEvent(t_data.GetDoneEvent());
 
+    auto last_checkpoint = armGetSystemTick();
+    s64 last_read_offset{};
+    const auto update_parallel_progress = [&](s64 read_offset) {
+        parallel->read_offset += read_offset - last_read_offset;
+        last_read_offset = read_offset;
+        pbox->UpdateTransfer(parallel->read_offset, parallel->total_size);
+    };
+
     for (;;) {
         s32 idx;
         if (R_FAILED(waitMulti(&idx, UINT64_MAX, waiter_progress, waiter_cancel, waiter_done))) {
@@ -978,7 +1820,17 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
         }
 
         if (!idx) {
-            pbox->UpdateTransfer(t_data.GetWriteOffset(), t_data.GetWriteSize());
+            if (parallel) {
+                update_parallel_progress(t_data.read_offset);
+            } else {
+                pbox->UpdateTransfer(t_data.GetWriteOffset(), t_data.GetWriteSize());
+                pbox->UpdateStageTransfer(t_data.read_offset, t_data.decompress_offset, t_data.GetWriteOffset());
+            }
+
+            if (journal.IsActive() && armTicksToNs(armGetSystemTick() - last_checkpoint) >= JOURNAL_CHECKPOINT_NS) {
+                checkpoint();
+                last_checkpoint = armGetSystemTick();
+            }
         } else {
             break;
         }
@@ -996,44 +1848,190 @@ Result Yati::InstallNcaInternal(std::span<TikCollection> tickets, NcaCollection&
             continue;
         } else if (R_FAILED(waitSingleHandle(t_write.handle, 1000))) {
             continue;
+        } else if (t_data.has_hash && R_FAILED(waitSingleHandle(t_hash.handle, 1000))) {
+            continue;
         }
         break;
     }
     log_write("threads closed\n");
+    utils::pool::LogStats("install");
+
+    // used to compare install speed between sources.
+    const auto seconds = armTicksToNs(armGetSystemTick() - start) / 1e+9;
+    log_write("[YATI] nca: %s size: %.2f MiB took: %.2fs speed: %.2f MiB/s\n", nca.name.c_str(), nca.size / 1024.0 / 1024.0, seconds, seconds ? nca.size / seconds / 1024.0 / 1024.0 : 0.0);
+
+    // speed of each stage if it didn't have to wait on the others.
+    const auto stage_speed = [](s64 size, u64 ticks) {
+        const auto seconds = armTicksToNs(ticks) / 1e+9;
+        return seconds ? size / seconds / 1024.0 / 1024.0 : 0.0;
+    };
+
+    log_write("[YATI] stage speed%s read: %.2f MiB/s decompress: %.2f MiB/s write: %.2f MiB/s hash: %.2f MiB/s\n",
+        t_data.dry_run ? " (dry run)" : "",
+        stage_speed(t_data.read_offset, t_data.read_ticks),
+        stage_speed(t_data.decompress_offset, t_data.decompress_ticks),
+        stage_speed(t_data.GetWriteOffset(), t_data.write_ticks),
+        stage_speed(t_data.GetWriteOffset(), t_data.hash_ticks));
 
     // if any of the threads failed, wake up all threads so they can exit.
     if (R_FAILED(t_data.GetResults())) {
+        if (journal.IsActive()) {
+            checkpoint();
+        }
+
         log_write("some reads failed, waking threads: %s\n", nca.name.c_str());
         log_write("returning due to fail: %s\n", nca.name.c_str());
         return t_data.GetResults();
     }
     R_TRY(t_data.GetResults());
 
+    if (parallel) {
+        update_parallel_progress(nca.size);
+    }
+
     NcmContentId content_id{};
     std::memcpy(std::addressof(content_id), nca.hash, sizeof(content_id));
 
     log_write("old id: %s new id: %s\n", utils::hexIdToStr(nca.content_id).str, utils::hexIdToStr(content_id).str);
-    if (!config.skip_nca_hash_verify && !nca.modified) {
+    if (t_data.has_hash && !nca.modified) {
         if (std::memcmp(&nca.content_id, nca.hash, sizeof(nca.content_id))) {
             log_write("nca hash is invalid!!!!\n");
+            // don't resume from bad data.
+            if (journal.IsActive()) {
+                journal.Remove(nca.content_id);
+            }
             R_UNLESS(!std::memcmp(&nca.content_id, nca.hash, sizeof(nca.content_id)), Result_YatiInvalidNcaSha256);
         } else {
             log_write("nca hash is valid!\n");
+            SCOPED_MUTEX(std::addressof(verified_mutex));
+            verified.emplace_back(nca.content_id);
         }
+    } else if (cache_verified) {
+        log_write("skipping nca sha256 verify, verified on a previous install\n");
     } else {
         log_write("skipping nca sha256 verify\n");
     }
 
+    if (journal.IsActive()) {
+        journal::Entry entry{};
+        entry.content_id = nca.content_id;
+        entry.placeholder_id = nca.placeholder_id;
+        entry.size = nca.size;
+        entry.offset = nca.size;
+        entry.has_hash = t_data.has_hash;
+        entry.complete = true;
+        entry.modified = nca.modified;
+        entry.header = nca.header;
+        std::memcpy(entry.hash, nca.hash, sizeof(entry.hash));
+
+        if (R_FAILED(ncmContentStorageFlushPlaceHolder(std::addressof(cs))) || R_FAILED(journal.Update(entry))) {
+            log_write("[JOURNAL] failed to update journal: %s\n", nca.name.c_str());
+        }
+    }
+
+    R_SUCCEED();
+}
+
+Result ParallelInstall::laneFuncInternal() {
+    while (R_SUCCEEDED(result.load())) {
+        R_TRY(yati->pbox->ShouldExitResult());
+
+        const auto index = next_index++;
+        if (index >= ncas.size()) {
+            break;
+        }
+
+        R_TRY(yati->InstallNca(tickets, ncas[index]));
+    }
+
+    R_SUCCEED();
+}
+
+void laneFunc(void* d) {
+    auto t = static_cast<ParallelInstall*>(d);
+    if (const auto rc = t->laneFuncInternal(); R_FAILED(rc)) {
+        t->result = rc;
+    }
+}
+
+// installs the ncas of a cnmt, multiple ncas are installed at the same time
+// if the source allows for it and there's enough memory for each pipeline.
+// registration happens afterwards in the order of the cnmt, so the order
+// the ncas finish in does not matter.
+Result Yati::InstallNcas(std::span<TikCollection> tickets, std::span<NcaCollection> ncas) {
+    u32 lane_count = 1;
+    if (ncas.size() > 1 && source->CanReadConcurrently() && !App::IsFileBaseEmummc()) {
+        const auto available = utils::GetFreeHeapSize() + utils::pool::GetStats().cached;
+        lane_count = std::clamp<u64>(available / INSTALL_LANE_MEMORY, 1, std::min<u64>(INSTALL_LANE_COUNT, ncas.size()));
+    }
+
+    if (lane_count <= 1) {
+        for (auto& nca : ncas) {
+            R_TRY(InstallNca(tickets, nca));
+        }
+        R_SUCCEED();
+    }
+
+    log_write("[YATI] installing %zu ncas using %u lanes\n", ncas.size(), lane_count);
+
+    ParallelInstall t_data{this, tickets, ncas};
+    parallel = std::addressof(t_data);
+    ON_SCOPE_EXIT(parallel = nullptr);
+
+    pbox->NewTransfer(i18n::Reorder("Installing ", std::to_string(ncas.size()) + " NCAs"));
+
+    // the calling thread is used as the first lane.
+    Thread t_lanes[INSTALL_LANE_COUNT - 1]{};
+    u32 t_lane_count{};
+    ON_SCOPE_EXIT(
+        for (u32 i = 0; i < t_lane_count; i++) {
+            threadWaitForExit(&t_lanes[i]);
+            threadClose(&t_lanes[i]);
+        }
+    );
+
+    for (u32 i = 0; i < lane_count - 1; i++) {
+        // fallback to fewer lanes if a thread can't be created.
+        if (R_FAILED(utils::CreateThread(&t_lanes[i], laneFunc, std::addressof(t_data), utils::ThreadRole::Io, 1024*256))) {
+            break;
+        }
+
+        if (R_FAILED(threadStart(&t_lanes[i]))) {
+            threadClose(&t_lanes[i]);
+            break;
+        }
+        t_lane_count++;
+    }
+
+    laneFunc(std::addressof(t_data));
+
+    for (u32 i = 0; i < t_lane_count; i++) {
+        threadWaitForExit(&t_lanes[i]);
+    }
+
+    R_TRY(t_data.result.load());
     R_SUCCEED();
 }
 
 Result Yati::InstallNca(std::span<TikCollection> tickets, NcaCollection& nca) {
     log_write("in install nca\n");
-    pbox->NewTransfer(nca.name);
+    if (!parallel) {
+        pbox->NewTransfer(nca.name);
+    }
     keys::parse_hex_key(std::addressof(nca.content_id), nca.name.c_str());
 
     R_TRY(InstallNcaInternal(tickets, nca));
 
+    if (batch) {
+        batch->done_size += nca.size;
+        batch->UpdateProgress(pbox);
+    }
+
+    // nothing was written, so there's nothing to parse.
+    if (IsDryRun(nca) && !nca.skipped) {
+        R_SUCCEED();
+    }
+
     fs::FsPath path;
     if (nca.skipped) {
         R_TRY(ncmContentStorageGetPath(std::addressof(cs), path, sizeof(path), std::addressof(nca.content_id)));
@@ -1071,6 +2069,13 @@ Result Yati::InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cn
     std::vector<NcmPackagedContentInfo> infos;
     R_TRY(nca::ParseCnmt(path, cnmt.header.program_id, header, cnmt.extended_header, infos));
 
+    // delta fragments are skipped as applying them isn't implemented (TODO).
+    // a patch that only ships fragments for some ncas can't be installed, this
+    // only gives it a clearer error than YatiNcaNotFound.
+    const auto has_delta = std::ranges::any_of(infos, [](auto& e){
+        return e.info.content_type == NcmContentType_DeltaFragment;
+    });
+
     for (const auto& packed_info : infos) {
         const auto& info = packed_info.info;
         if (info.content_type == NcmContentType_DeltaFragment) {
@@ -1082,7 +2087,14 @@ Result Yati::InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cn
             return e.name.find(str.str) != e.name.npos;
         });
 
-        R_UNLESS(it != collections.cend(), Result_YatiNcaNotFound);
+        if (it == collections.cend()) {
+            if (has_delta) {
+                log_write("nca not found: %s, it's only shipped as delta fragments which can't be applied\n", str.str);
+            } else {
+                log_write("nca not found: %s\n", str.str);
+            }
+            R_THROW(has_delta ? Result_YatiDeltaFragmentNotSupported : Result_YatiNcaNotFound);
+        }
 
         log_write("found: %s\n", str.str);
         cnmt.infos.emplace_back(packed_info);
@@ -1128,35 +2140,6 @@ Result Yati::InstallCnmtNca(std::span<TikCollection> tickets, CnmtCollection& cn
     R_SUCCEED();
 }
 
-Result Yati::ParseTicketsIntoCollection(std::vector<TikCollection>& tickets, const container::Collections& collections, bool read_data) {
-    for (const auto& collection : collections) {
-        if (collection.name.ends_with(".tik")) {
-            TikCollection entry{};
-            keys::parse_hex_key(entry.rights_id.c, collection.name.c_str());
-            const auto str = collection.name.substr(0, collection.name.length() - 4) + ".cert";
-
-            const auto cert = std::ranges::find_if(collections, [&str](auto& e){
-                return e.name.find(str) != e.name.npos;
-            });
-
-            R_UNLESS(cert != collections.cend(), Result_YatiCertNotFound);
-            entry.ticket.resize(collection.size);
-            entry.cert.resize(cert->size);
-
-            // only supported on non-stream installs.
-            if (read_data) {
-                u64 bytes_read;
-                R_TRY(source->Read(entry.ticket.data(), collection.offset, entry.ticket.size(), &bytes_read));
-                R_TRY(source->Read(entry.cert.data(), cert->offset, entry.cert.size(), &bytes_read));
-            }
-
-            tickets.emplace_back(entry);
-        }
-    }
-
-    R_SUCCEED();
-}
-
 Result Yati::GetLatestVersion(const CnmtCollection& cnmt, u32& version_out, bool& skip) {
     const auto app_id = ncm::GetAppId(cnmt.key);
     version_out = cnmt.key.version;
@@ -1232,6 +2215,13 @@ Result Yati::ShouldSkip(const CnmtCollection& cnmt, bool& skip) {
 
 Result Yati::ImportTickets(std::span<TikCollection> tickets) {
     for (auto& ticket : tickets) {
+        // already installed by a previous file in the batch.
+        if (batch && batch->HasTicket(ticket.rights_id)) {
+            log_write("skipping ticket, already installed in batch\n");
+            ticket.required = false;
+            continue;
+        }
+
         if (ticket.required || config.ticket_only) {
             if (config.skip_ticket) {
                 log_write("WARNING: skipping ticket install, but it's required!\n");
@@ -1245,6 +2235,10 @@ Result Yati::ImportTickets(std::span<TikCollection> tickets) {
                 log_write("installing ticket\n");
                 R_TRY(es::ImportTicket(ticket.ticket.data(), ticket.ticket.size(), ticket.cert.data(), ticket.cert.size()));
                 ticket.required = false;
+
+                if (batch) {
+                    batch->tickets.emplace_back(ticket.rights_id);
+                }
             }
         }
     }
@@ -1373,12 +2367,28 @@ Result Yati::RegisterNcasAndPushRecord(const CnmtCollection& cnmt, u32 latest_ve
     R_SUCCEED();
 }
 
-Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override) {
+Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, std::vector<TikCollection>& tickets, const ConfigOverride& override, Batch* batch, cache::Entry* cache_entry) {
     auto yati = std::make_unique<Yati>(pbox, source);
     R_TRY(yati->Setup(override));
-
-    std::vector<TikCollection> tickets{};
-    R_TRY(yati->ParseTicketsIntoCollection(tickets, collections, true));
+    yati->batch = batch;
+    yati->cached = cache_entry;
+
+    // converting the crypto modifies the tickets whilst parsing the nca header,
+    // which isn't done for ncas that were already installed, so don't resume.
+    if (!yati->config.convert_to_standard_crypto && !yati->config.lower_master_key && !yati->config.dry_run) {
+        u8 key[SHA256_HASH_SIZE];
+        journal::CreateKey(collections, yati->storage_id, key);
+
+        std::vector<journal::Entry> old{};
+        NcmStorageId old_storage_id{};
+        if (!yati->journal.Load(key, yati->storage_id, old, old_storage_id)) {
+            // delete the placeholders left by the previous install.
+            auto cs = std::addressof(yati->ncm_cs[old_storage_id == NcmStorageId_SdCard]);
+            for (auto& e : old) {
+                ncmContentStorageDeletePlaceHolder(cs, std::addressof(e.placeholder_id));
+            }
+        }
+    }
 
     std::vector<CnmtCollection> cnmts{};
     for (const auto& collection : collections) {
@@ -1390,10 +2400,19 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
     }
 
     for (auto& cnmt : cnmts) {
+        // on failure, keep the placeholders in the journal so they can be resumed.
+        bool keep_placeholders = yati->journal.IsActive();
+        const auto delete_placeholder = [&](NcaCollection& nca) {
+            journal::Entry entry;
+            if (!keep_placeholders || !yati->journal.Find(nca.content_id, entry)) {
+                ncmContentStorageDeletePlaceHolder(std::addressof(yati->cs), std::addressof(nca.placeholder_id));
+            }
+        };
+
         ON_SCOPE_EXIT(
-            ncmContentStorageDeletePlaceHolder(std::addressof(yati->cs), std::addressof(cnmt.placeholder_id));
+            delete_placeholder(cnmt);
             for (auto& nca : cnmt.ncas) {
-                ncmContentStorageDeletePlaceHolder(std::addressof(yati->cs), std::addressof(nca.placeholder_id));
+                delete_placeholder(nca);
             }
         );
 
@@ -1406,23 +2425,59 @@ Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const contai
 
         if (skip) {
             log_write("skipping install!\n");
+            keep_placeholders = false;
             continue;
         }
 
         log_write("installing nca's\n");
-        for (auto& nca : cnmt.ncas) {
-            R_TRY(yati->InstallNca(tickets, nca));
+        R_TRY(yati->InstallNcas(tickets, cnmt.ncas));
+
+        if (yati->config.dry_run) {
+            log_write("[YATI] dry run, skipping register\n");
+            keep_placeholders = false;
+            continue;
         }
 
         R_TRY(yati->ImportTickets(tickets));
         R_TRY(yati->RemoveInstalledNcas(cnmt));
         R_TRY(yati->RegisterNcasAndPushRecord(cnmt, latest_version_num));
+        keep_placeholders = false;
+
+        if (batch) {
+            batch->ncas.emplace_back(cnmt.content_id);
+            for (const auto& nca : cnmt.ncas) {
+                batch->ncas.emplace_back(nca.content_id);
+            }
+        }
+    }
+
+    if (yati->journal.IsActive()) {
+        yati->journal.Delete();
+    }
+
+    // ncas that weren't installed this time (ie, skipped) keep their old entry.
+    if (cache_entry) {
+        for (const auto& e : yati->verified) {
+            if (!cache_entry->IsVerified(e)) {
+                cache_entry->verified.emplace_back(e);
+            }
+        }
+
+        if (R_FAILED(cache::Update(*cache_entry))) {
+            log_write("[CACHE] failed to update install cache\n");
+        }
     }
 
     log_write("success!\n");
     R_SUCCEED();
 }
 
+Result InstallInternal(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override) {
+    std::vector<TikCollection> tickets{};
+    R_TRY(ParseTicketsIntoCollection(source, tickets, collections, true));
+    return InstallInternal(pbox, source, collections, tickets, override, nullptr, nullptr);
+}
+
 Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, container::Collections collections, const ConfigOverride& override) {
     auto yati = std::make_unique<Yati>(pbox, source);
     R_TRY(yati->Setup(override));
@@ -1447,7 +2502,7 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
     );
 
     // fill ticket entries, the data will be filled later on.
-    R_TRY(yati->ParseTicketsIntoCollection(tickets, collections, false));
+    R_TRY(ParseTicketsIntoCollection(source, tickets, collections, false));
 
     // sort based on lowest offset.
     const auto sorter = [](const container::CollectionEntry& lhs, const container::CollectionEntry& rhs) -> bool {
@@ -1505,7 +2560,7 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
         R_TRY(yati->GetLatestVersion(cnmt, latest_version_num, skip));
         R_TRY(yati->ShouldSkip(cnmt, skip));
 
-        if (skip) {
+        if (skip || yati->config.dry_run) {
             log_write("skipping install!\n");
             continue;
         }
@@ -1519,26 +2574,89 @@ Result InstallInternalStream(ui::ProgressBox* pbox, source::Base* source, contai
     R_SUCCEED();
 }
 
+Result CreateContainer(source::Base* source, const fs::FsPath& path, std::unique_ptr<container::Base>& out) {
+    const auto ext = std::strrchr(path.s, '.');
+    R_UNLESS(ext, Result_YatiContainerNotFound);
+
+    if (!strcasecmp(ext, ".nsp") || !strcasecmp(ext, ".nsz") || !strcasecmp(ext, ".ns0")) {
+        out = std::make_unique<container::Nsp>(source);
+    } else if (!strcasecmp(ext, ".xci") || !strcasecmp(ext, ".xcz") || !strcasecmp(ext, ".xc0")) {
+        out = std::make_unique<container::Xci>(source);
+    }
+
+    R_UNLESS(out, Result_YatiContainerNotFound);
+    R_SUCCEED();
+}
+
+// loads the collections from the cache if the file was installed before,
+// otherwise the container is parsed. has_cache is set if the file can be cached.
+Result GetCachedCollections(fs::Fs* fs, const fs::FsPath& path, source::Base* source, cache::Entry& entry, bool& has_cache) {
+    has_cache = cache::CreateKey(fs, path, entry.key);
+    if (has_cache && cache::Find(entry.key, entry)) {
+        R_SUCCEED();
+    }
+
+    std::unique_ptr<container::Base> container;
+    R_TRY(CreateContainer(source, path, container));
+    return container->GetCollections(entry.collections);
+}
+
+// everything read from a file before the install starts.
+struct BatchFile {
+    // opens the container and reads the collections and tickets.
+    Result Parse(fs::Fs* fs, const fs::FsPath& path) {
+        parsed = true;
+        R_TRY(source::OpenFile(fs, path, source, &size));
+        R_TRY(GetCachedCollections(fs, path, source.get(), cache, has_cache));
+        R_TRY(ParseTicketsIntoCollection(source.get(), tickets, cache.collections, true));
+        R_SUCCEED();
+    }
+
+    std::shared_ptr<source::Base> source{};
+    // the collections are stored in the entry.
+    cache::Entry cache{};
+    bool has_cache{};
+    std::vector<TikCollection> tickets{};
+    s64 size{};
+    Result rc{};
+    bool parsed{};
+};
+
 } // namespace
 
 Result InstallFromFile(ui::ProgressBox* pbox, fs::Fs* fs, const fs::FsPath& path, const ConfigOverride& override) {
-    auto source = std::make_unique<source::File>(fs, path);
+    std::shared_ptr<source::Base> source;
+    s64 size;
+    R_TRY(source::OpenFile(fs, path, source, &size));
     // auto source = std::make_unique<source::StreamFile>(fs, path, override); // enable for testing.
+
+    if (source->IsStream()) {
+        return InstallFromSource(pbox, source.get(), path, override);
+    }
+
+    cache::Entry entry{};
+    bool has_cache;
+    R_TRY(GetCachedCollections(fs, path, source.get(), entry, has_cache));
+
+    std::vector<TikCollection> tickets{};
+    R_TRY(ParseTicketsIntoCollection(source.get(), tickets, entry.collections, true));
+    return InstallInternal(pbox, source.get(), entry.collections, tickets, override, nullptr, has_cache ? &entry : nullptr);
+}
+
+Result InstallFromUrl(ui::ProgressBox* pbox, const std::string& url, const ConfigOverride& override) {
+    // the file name is used to find the container, so strip the query.
+    const auto name = url.substr(0, url.find_first_of("?#"));
+    const fs::FsPath path{name.substr(name.find_last_of('/') + 1)};
+
+    std::shared_ptr<source::Base> source;
+    s64 size;
+    R_TRY(source::OpenHttp(curl::Api{curl::Url{url}, curl::StopToken{pbox->GetToken()}}, source, &size));
     return InstallFromSource(pbox, source.get(), path, override);
 }
 
 Result InstallFromSource(ui::ProgressBox* pbox, source::Base* source, const fs::FsPath& path, const ConfigOverride& override) {
-    const auto ext = std::strrchr(path.s, '.');
-    R_UNLESS(ext, Result_YatiContainerNotFound);
-
     std::unique_ptr<container::Base> container;
-    if (!strcasecmp(ext, ".nsp") || !strcasecmp(ext, ".nsz")) {
-        container = std::make_unique<container::Nsp>(source);
-    } else if (!strcasecmp(ext, ".xci") || !strcasecmp(ext, ".xcz")) {
-        container = std::make_unique<container::Xci>(source);
-    }
-
-    R_UNLESS(container, Result_YatiContainerNotFound);
+    R_TRY(CreateContainer(source, path, container));
     return InstallFromContainer(pbox, container.get(), override);
 }
 
@@ -1548,6 +2666,66 @@ Result InstallFromContainer(ui::ProgressBox* pbox, container::Base* container, c
     return InstallFromCollections(pbox, container->GetSource(), collections, override);
 }
 
+Result InstallFromFiles(ui::ProgressBox* pbox, fs::Fs* fs, std::span<const fs::FsPath> paths, const ConfigOverride& override, const BatchCallback& on_installed) {
+    if (paths.empty()) {
+        R_SUCCEED();
+    }
+
+    Batch batch{};
+    batch.count = paths.size();
+    batch.start = armGetSystemTick();
+
+    for (const auto& path : paths) {
+        FsTimeStampRaw ts;
+        s64 size;
+        if (R_SUCCEEDED(fs->FileGetSizeAndTimestamp(path, &ts, &size))) {
+            batch.total_size += size;
+        }
+    }
+
+    auto file = std::make_unique<BatchFile>();
+    file->rc = file->Parse(fs, paths[0]);
+
+    for (u32 i = 0; i < paths.size(); i++) {
+        batch.index = i;
+        batch.UpdateProgress(pbox);
+
+        // parse the next file whilst this one installs.
+        // prefetch is declared after next so that it exits before next is freed.
+        std::unique_ptr<BatchFile> next{};
+        std::unique_ptr<utils::task::Group> prefetch{};
+        if (i + 1 < paths.size()) {
+            next = std::make_unique<BatchFile>();
+            prefetch = std::make_unique<utils::task::Group>();
+            prefetch->Push([fs, &path = paths[i + 1], next = next.get()](){
+                next->rc = next->Parse(fs, path);
+            });
+        }
+
+        R_TRY(file->rc);
+        log_write("[BATCH] installing %u / %zu: %s\n", i + 1, paths.size(), paths[i].s);
+        const auto done_size = batch.done_size.load();
+        R_TRY(InstallInternal(pbox, file->source.get(), file->cache.collections, file->tickets, override, &batch, file->has_cache ? &file->cache : nullptr));
+
+        // skipped ncas aren't counted, so use the size of the file instead.
+        batch.done_size = done_size + file->size;
+        if (on_installed) {
+            on_installed(paths[i]);
+        }
+
+        prefetch.reset();
+        // in case the task didn't run.
+        if (next && !next->parsed) {
+            next->rc = next->Parse(fs, paths[i + 1]);
+        }
+        file = std::move(next);
+    }
+
+    const auto seconds = armTicksToNs(armGetSystemTick() - batch.start) / 1e+9;
+    log_write("[BATCH] installed %zu files in %.2fs\n", paths.size(), seconds);
+    R_SUCCEED();
+}
+
 Result InstallFromCollections(ui::ProgressBox* pbox, source::Base* source, const container::Collections& collections, const ConfigOverride& override) {
     if (source->IsStream()) {
         return InstallInternalStream(pbox, source, collections, override);
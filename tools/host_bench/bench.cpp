@@ -0,0 +1,518 @@
+// microbenchmarks for the parts of sphaira that don't need a console, so that
+// regressions in these inner loops are caught on a pc before a hardware test.
+// each test runs ITERATIONS samples and reports the min / median / max, same
+// as the benchmarks menu. every test also checks its output, a mismatch fails
+// the run (exit code 1) so that ctest catches it.
+// usage: host_bench [filter], only tests whose name contains filter are run.
+
+#include "utils/lru.hpp"
+#include "utils/ring_buf.hpp"
+#include "utils/spsc_ring.hpp"
+#include "utils/md5.hpp"
+#include "utils/buffer_pool.hpp"
+#include "utils/path_index.hpp"
+#include "utils/devoptab_path.hpp"
+#include "utils/zip_directory.hpp"
+#include "yati/nx/ncz_block_cache.hpp"
+#include "yati/source/base.hpp"
+#include "defines.hpp"
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sphaira::host_bench {
+namespace {
+
+// number of samples per test, the min / median / max are taken from these.
+constexpr u32 ITERATIONS = 5;
+
+// lru with as many entries as the ncz reader typically has blocks cached.
+constexpr u32 LRU_COUNT = 64;
+constexpr u32 LRU_LOOKUPS = 1024 * 1024 * 4;
+
+// slots in the transfer queue, same as MAX_SLOT_COUNT.
+constexpr u32 RING_SLOTS = 8;
+constexpr u32 RING_OPS = 1024 * 1024 * 4;
+
+// data moved between two threads in curl sized writes, as done when
+// streaming to / from a network mount.
+constexpr u64 SPSC_SIZE = 1024 * 1024 * 256;
+constexpr u64 SPSC_CAPACITY = 1024 * 64;
+constexpr u64 SPSC_CHUNK_SIZE = CURL_MAX_WRITE_SIZE;
+
+// number of paths in the path tests, each is looked up once.
+constexpr u32 PATH_COUNT = 1024 * 16;
+
+// size of the text run through the decode tests.
+constexpr u64 DECODE_SIZE = 1024 * 1024 * 4;
+
+// hash tests run over the same buffer this many times.
+constexpr u64 COMPUTE_SIZE = 1024 * 1024 * 4;
+constexpr u32 COMPUTE_LOOPS = 8;
+
+// 64KiB blocks, twice as many blocks are read as fit in the lru.
+constexpr u8 NCZ_BLOCK_EXPONENT = 16;
+constexpr u32 NCZ_BLOCK_COUNT = 1024 * 4;
+constexpr u32 NCZ_LRU_COUNT = 64;
+constexpr u32 NCZ_READ_BLOCKS = NCZ_LRU_COUNT * 2;
+constexpr u32 NCZ_LOOKUPS = 1024 * 1024;
+
+// number of files in the zip central directory.
+constexpr u32 ZIP_ENTRIES = 1024 * 32;
+
+// runs a single sample, setting the speed. returns false if the output was wrong.
+using SampleFunc = std::function<bool(double& speed)>;
+
+struct Entry {
+    const char* name;
+    SampleFunc func;
+    // unit of the speed set by the test.
+    const char* unit{"MiB/s"};
+};
+
+struct Stats {
+    double min;
+    double median;
+    double max;
+};
+
+auto GetSpeed(u64 size, u64 start_tick) -> double {
+    const auto seconds = armTicksToNs(armGetSystemTick() - start_tick) / 1e+9;
+    return seconds ? size / seconds / 1024.0 / 1024.0 : 0.0;
+}
+
+// millions of operations per second.
+auto GetRate(u64 count, u64 start_tick) -> double {
+    const auto seconds = armTicksToNs(armGetSystemTick() - start_tick) / 1e+9;
+    return seconds ? count / seconds / 1e+6 : 0.0;
+}
+
+auto NextRandom(u32& seed) -> u32 {
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+// loosely compressible, same as the benchmarks menu.
+auto MakeTestData(u64 size) -> std::vector<u8> {
+    std::vector<u8> data(size);
+    u32 seed = 0x12345678;
+    for (u64 i = 0; i < size; i++) {
+        if (!(i % 64)) {
+            seed = seed * 1664525 + 1013904223;
+        }
+        data[i] = (seed >> 24) ^ (i & 0x7);
+    }
+    return data;
+}
+
+auto MakeTestPaths() -> std::vector<std::string> {
+    std::vector<std::string> paths;
+    for (u32 i = 0; i < PATH_COUNT; i++) {
+        paths.emplace_back("/dir" + std::to_string(i % 64) + "/sub" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".bin");
+    }
+    return paths;
+}
+
+auto CalculateStats(std::vector<double> samples) -> Stats {
+    Stats stats{};
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::ranges::sort(samples);
+    const auto mid = samples.size() / 2;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+    return stats;
+}
+
+// lookups through the optional index, each hit is moved to the front.
+bool LruIndexFind(double& speed) {
+    struct Data {
+        u64 key;
+    };
+
+    std::vector<Data> data(LRU_COUNT);
+    utils::Lru<Data> lru;
+    lru.Init(data);
+
+    for (u64 i = 0; i < LRU_COUNT; i++) {
+        lru.GetNextFree()->key = i;
+        lru.Index(i, lru.begin());
+    }
+
+    u32 seed = 0xDEADBEEF;
+    u64 found{};
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < LRU_LOOKUPS; i++) {
+        const auto key = NextRandom(seed) % LRU_COUNT;
+        if (auto entry = lru.Find(key)) {
+            found += entry->data->key == key;
+            lru.Update(entry);
+        }
+    }
+
+    speed = GetRate(LRU_LOOKUPS, start);
+    return found == LRU_LOOKUPS;
+}
+
+// push / pop of pooled buffers as done by each stage of thread::Transfer().
+bool RingBufPushPop(double& speed) {
+    utils::RingBuf ring{RING_SLOTS, RING_SLOTS};
+    utils::RingBuf::Buffer buf{};
+    s64 next_off{};
+    bool ok = true;
+
+    const auto start = armGetSystemTick();
+    for (s64 i = 0; i < RING_OPS; i++) {
+        if (!ring.ringbuf_free()) {
+            s64 off;
+            ring.ringbuf_pop(buf, off);
+            ok &= off == next_off++;
+        }
+        ring.ringbuf_push(buf, i);
+    }
+
+    speed = GetRate(RING_OPS, start);
+    return ok && ring.ringbuf_size() == RING_SLOTS;
+}
+
+// pushes SPSC_SIZE from a thread whilst reading it on this one.
+bool SpscRingTransfer(double& speed) {
+    utils::SpscRing ring{SPSC_CAPACITY};
+    const auto in = MakeTestData(SPSC_CHUNK_SIZE);
+    std::vector<u8> out(SPSC_CHUNK_SIZE);
+
+    const auto start = armGetSystemTick();
+    std::thread producer{[&ring, &in](){
+        for (u64 off = 0; off < SPSC_SIZE; off += in.size()) {
+            for (u64 written = 0; written < in.size();) {
+                const auto wsize = ring.Write(in.data() + written, in.size() - written);
+                if (!wsize) {
+                    std::this_thread::yield();
+                }
+                written += wsize;
+            }
+        }
+    }};
+
+    u64 total{};
+    bool ok = true;
+    while (total < SPSC_SIZE) {
+        const auto rsize = ring.Read(out.data(), out.size() - total % out.size());
+        if (!rsize) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // the writes are all the same, so each read continues where the last ended.
+        ok &= !std::memcmp(out.data(), in.data() + total % in.size(), rsize);
+        total += rsize;
+    }
+    producer.join();
+
+    speed = GetSpeed(SPSC_SIZE, start);
+    return ok;
+}
+
+bool FixPath(double& speed) {
+    char out[0x301];
+    if (!devoptab::common::fix_path("smb0://dir//sub/file.bin/", out) || std::strcmp(out, "/dir/sub/file.bin")) {
+        return false;
+    }
+
+    std::vector<std::string> paths;
+    for (const auto& path : MakeTestPaths()) {
+        paths.emplace_back("smb0:" + path);
+    }
+
+    u32 fixed{};
+    const auto start = armGetSystemTick();
+    for (const auto& path : paths) {
+        fixed += devoptab::common::fix_path(path.c_str(), out, true);
+    }
+
+    speed = GetRate(paths.size(), start);
+    return fixed == paths.size();
+}
+
+// file names as found in a http / webdav listing.
+auto MakeDecodeText(bool url) -> std::string {
+    const std::string_view word = url ? "Game%20Name%20%5Bv1%5D&amp;DLC&#39;s%20" : "Game Name &lt;v1&gt; &amp; DLC&#39;s ";
+    std::string text;
+    while (text.size() < DECODE_SIZE) {
+        text += word;
+    }
+    return text;
+}
+
+bool HtmlDecode(double& speed) {
+    if (devoptab::common::html_decode("a&amp;b&#39;c&lt;&unknown;") != "a&b'c<&unknown;") {
+        return false;
+    }
+
+    const auto text = MakeDecodeText(false);
+    const auto start = armGetSystemTick();
+    const auto out = devoptab::common::html_decode(text);
+
+    speed = GetSpeed(text.size(), start);
+    return out.size() < text.size();
+}
+
+bool UrlDecode(double& speed) {
+    if (devoptab::common::url_decode("a%20b&amp;c") != "a b&c") {
+        return false;
+    }
+
+    const auto text = MakeDecodeText(true);
+    const auto start = armGetSystemTick();
+    const auto out = devoptab::common::url_decode(text);
+
+    speed = GetSpeed(text.size(), start);
+    return out.size() < text.size();
+}
+
+bool Md5Hash(double& speed) {
+    static constexpr u8 abc_hash[utils::Md5::HASH_SIZE]{
+        0x90, 0x01, 0x50, 0x98, 0x3c, 0xd2, 0x4f, 0xb0, 0xd6, 0x96, 0x3f, 0x7d, 0x28, 0xe1, 0x7f, 0x72,
+    };
+
+    u8 hash[utils::Md5::HASH_SIZE];
+    utils::Md5 abc;
+    abc.Update("abc", 3);
+    abc.GetHash(hash);
+    if (std::memcmp(hash, abc_hash, sizeof(hash))) {
+        return false;
+    }
+
+    const auto data = MakeTestData(COMPUTE_SIZE);
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < COMPUTE_LOOPS; i++) {
+        utils::Md5 ctx;
+        ctx.Update(data.data(), data.size());
+        ctx.GetHash(hash);
+    }
+
+    speed = GetSpeed(COMPUTE_SIZE * COMPUTE_LOOPS, start);
+    return true;
+}
+
+bool PathIndexLookup(double& speed) {
+    const auto paths = MakeTestPaths();
+    utils::PathIndex index;
+    index.Reserve(paths.size());
+    for (u32 i = 0; i < paths.size(); i++) {
+        index.Add(paths[i], i);
+    }
+
+    u32 found{};
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < paths.size(); i++) {
+        u32 value;
+        found += index.Find(paths[i], value) && value == i;
+    }
+
+    speed = GetRate(paths.size(), start);
+    return found == paths.size();
+}
+
+// reads of random offsets as done by NczBlockReader::Read(), a miss replaces
+// the least recently used block.
+bool NczBlockLookup(double& speed) {
+    constexpr u64 block_size = 1ULL << NCZ_BLOCK_EXPONENT;
+    constexpr u64 decompressed_size = block_size * (NCZ_BLOCK_COUNT - 1) + 123;
+
+    u32 seed = 0xCAFEBABE;
+    ncz::Blocks blocks(NCZ_BLOCK_COUNT);
+    for (auto& block : blocks) {
+        block.size = block_size / 2 + NextRandom(seed) % (block_size / 2);
+    }
+
+    ncz::BlockCache cache{NCZ_BLOCK_EXPONENT, decompressed_size, blocks, 0x4000, NCZ_LRU_COUNT};
+    if (cache.GetBlockCount() != NCZ_BLOCK_COUNT || cache.GetBlockSize(NCZ_BLOCK_COUNT - 1) != 123 || cache.GetBlockInfo(1).offset != 0x4000 + blocks[0].size) {
+        return false;
+    }
+
+    std::vector<u8> data;
+    u32 ok{};
+    const auto start = armGetSystemTick();
+    for (u32 i = 0; i < NCZ_LOOKUPS; i++) {
+        const u64 off = (u64)(NextRandom(seed) % NCZ_READ_BLOCKS) * block_size + NextRandom(seed) % block_size;
+        const auto block_id = off / cache.GetBlockSize();
+
+        auto lru_data = cache.Find(off, true);
+        if (!lru_data) {
+            data.resize(cache.GetBlockSize(block_id));
+            lru_data = cache.Insert(block_id, data);
+        }
+
+        ok += lru_data->InRange(off);
+    }
+
+    speed = GetRate(NCZ_LOOKUPS, start);
+    return ok == NCZ_LOOKUPS;
+}
+
+struct MemorySource final : yati::source::Base {
+    explicit MemorySource(std::vector<u8>&& data) : m_data{std::move(data)} {
+    }
+
+    Result Read(void* buf, s64 off, s64 size, u64* bytes_read) override {
+        R_UNLESS(off >= 0 && off + size <= (s64)m_data.size(), 0x1);
+        std::memcpy(buf, m_data.data() + off, size);
+        *bytes_read = size;
+        R_SUCCEED();
+    }
+
+    auto GetSize() const -> s64 {
+        return m_data.size();
+    }
+
+private:
+    std::vector<u8> m_data;
+};
+
+void Write16(std::vector<u8>& out, u16 v) {
+    out.insert(out.end(), { (u8)v, (u8)(v >> 8) });
+}
+
+void Write32(std::vector<u8>& out, u32 v) {
+    Write16(out, v);
+    Write16(out, v >> 16);
+}
+
+// a zip with only a central directory, the file data isn't read when parsing.
+// there are no entries for the dirs and the names are sorted, so "dir10" comes
+// straight after "dir1", to check that the tree is built the same as for zips
+// made by most tools.
+auto MakeZipDirectory() -> std::vector<u8> {
+    std::vector<std::string> names;
+    for (u32 i = 0; i < ZIP_ENTRIES; i++) {
+        names.emplace_back("dir" + std::to_string(i / 1024) + "/sub" + std::to_string(i / 128 % 8) + "/file" + std::to_string(i) + ".bin");
+    }
+    std::ranges::sort(names);
+
+    std::vector<u8> out;
+    for (u32 i = 0; i < ZIP_ENTRIES; i++) {
+        const auto& name = names[i];
+
+        Write32(out, 0x2014B50); // sig
+        Write16(out, 20); // version
+        Write16(out, 20); // version_needed
+        Write16(out, 0); // flags
+        Write16(out, 8); // compression
+        Write16(out, 0); // modtime
+        Write16(out, 0); // moddate
+        Write32(out, 0); // crc32
+        Write32(out, i); // compressed_size
+        Write32(out, i * 2); // uncompressed_size
+        Write16(out, name.size()); // filename_len
+        Write16(out, 0); // extrafield_len
+        Write16(out, 0); // filecomment_len
+        Write16(out, 0); // disk_start
+        Write16(out, 0); // internal_attr
+        Write32(out, 0); // external_attr
+        Write32(out, 0); // local_hdr_off
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    const u32 directory_size = out.size();
+    Write32(out, 0x6054B50); // sig
+    Write16(out, 0); // disk_number
+    Write16(out, 0); // disk_wcd
+    Write16(out, ZIP_ENTRIES); // disk_entries
+    Write16(out, ZIP_ENTRIES); // total_entries
+    Write32(out, directory_size); // central_directory_size
+    Write32(out, 0); // file_hdr_off
+    Write16(out, 0); // comment_len
+    return out;
+}
+
+auto CountFiles(const utils::zip::DirectoryEntry& dir) -> u32 {
+    u32 count = dir.file_child.size();
+    for (const auto& e : dir.dir_child) {
+        count += CountFiles(e);
+    }
+    return count;
+}
+
+// parses the central directory and builds the tree, as done when mounting a zip.
+bool ZipCentralDirectory(double& speed) {
+    static_assert(ZIP_ENTRIES <= UINT16_MAX, "zip64 isn't supported");
+    MemorySource source{MakeZipDirectory()};
+
+    const auto start = armGetSystemTick();
+    utils::zip::FileTableEntries entries;
+    if (R_FAILED(utils::zip::ParseCentralDirectory(&source, source.GetSize(), entries))) {
+        return false;
+    }
+
+    utils::zip::DirectoryEntry root;
+    utils::zip::BuildTree(entries, root);
+
+    speed = GetRate(ZIP_ENTRIES, start);
+    return entries.size() == ZIP_ENTRIES && entries.back().uncompressed_size == (ZIP_ENTRIES - 1) * 2 &&
+        root.dir_child.size() == ZIP_ENTRIES / 1024 && CountFiles(root) == ZIP_ENTRIES;
+}
+
+auto BuildEntries() -> std::vector<Entry> {
+    return {
+        { "Lru index find", LruIndexFind, "M/s" },
+        { "RingBuf push / pop", RingBufPushPop, "M/s" },
+        { "SpscRing 2 threads", SpscRingTransfer },
+        { "fix_path", FixPath, "M/s" },
+        { "html_decode", HtmlDecode },
+        { "url_decode", UrlDecode },
+        { "MD5", Md5Hash },
+        { "PathIndex lookup", PathIndexLookup, "M/s" },
+        { "ncz block lookup", NczBlockLookup, "M/s" },
+        { "zip central directory", ZipCentralDirectory, "M/s" },
+    };
+}
+
+} // namespace
+} // namespace sphaira::host_bench
+
+int main(int argc, char** argv) {
+    using namespace sphaira::host_bench;
+
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+    bool failed{};
+
+    std::printf("%-24s %10s %10s %10s  %s\n", "name", "median", "min", "max", "unit");
+    for (const auto& e : BuildEntries()) {
+        if (!std::string_view{e.name}.contains(filter)) {
+            continue;
+        }
+
+        std::vector<double> samples;
+        bool ok = true;
+        for (u32 i = 0; i < ITERATIONS && ok; i++) {
+            double speed{};
+            if ((ok = e.func(speed))) {
+                samples.emplace_back(speed);
+            }
+        }
+
+        if (!ok) {
+            std::printf("%-24s failed: output mismatch\n", e.name);
+            failed = true;
+            continue;
+        }
+
+        const auto stats = CalculateStats(std::move(samples));
+        std::printf("%-24s %10.2f %10.2f %10.2f  %s\n", e.name, stats.median, stats.min, stats.max, e.unit);
+    }
+
+    // the pool keeps freed buffers cached, free them so leak checkers are happy.
+    sphaira::utils::pool::Trim();
+    return failed;
+}
@@ -0,0 +1,26 @@
+// the sphaira log writes to a file / nxlink, on the host it goes to stderr.
+#include "log.hpp"
+#include <cstdio>
+
+extern "C" {
+
+bool log_is_init() {
+    return true;
+}
+
+void log_write(const char* s, ...) {
+    va_list v;
+    va_start(v, s);
+    log_write_arg(s, &v);
+    va_end(v);
+}
+
+void log_write_arg(const char* s, va_list* v) {
+    std::vfprintf(stderr, s, *v);
+}
+
+bool log_is_category_enabled(unsigned category) {
+    return true;
+}
+
+} // extern "C"
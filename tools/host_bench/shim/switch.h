@@ -0,0 +1,130 @@
+#pragma once
+
+// minimal stand in for libnx, enough to build the modules listed in
+// CMakeLists.txt on a pc. only what those modules (and defines.hpp) use is
+// here, anything else is a compile error so that it's noticed.
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#ifndef BIT
+#define BIT(n) (1U << (n))
+#endif
+
+// result.h
+typedef u32 Result;
+
+#define R_SUCCEEDED(res) ((res) == 0)
+#define R_FAILED(res) ((res) != 0)
+#define R_MODULE(res) ((res) & 0x1FF)
+#define R_DESCRIPTION(res) (((res) >> 9) & 0x1FFF)
+#define R_VALUE(res) ((res) & 0x3FFFFF)
+#define MAKERESULT(module, description) \
+    ((((module) & 0x1FF)) | ((description) & 0x1FFF) << 9)
+
+// arm/counter.h, the tick is in ns so that armTicksToNs() is free.
+static inline u64 armGetSystemTick() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline u64 armGetSystemTickFreq() {
+    return 1000000000;
+}
+
+static inline u64 armTicksToNs(u64 tick) {
+    return tick;
+}
+
+static inline u64 armNsToTicks(u64 ns) {
+    return ns;
+}
+
+// kernel/svc.h
+static inline u64 svcGetSystemTick() {
+    return armGetSystemTick();
+}
+
+static inline void svcSleepThread(s64 ns) {
+    if (ns > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+// kernel/mutex.h
+struct Mutex {
+    std::mutex m;
+};
+
+static inline void mutexInit(Mutex*) {}
+static inline void mutexLock(Mutex* m) { m->m.lock(); }
+static inline bool mutexTryLock(Mutex* m) { return m->m.try_lock(); }
+static inline void mutexUnlock(Mutex* m) { m->m.unlock(); }
+
+struct RMutex {
+    std::recursive_mutex m;
+};
+
+static inline void rmutexInit(RMutex*) {}
+static inline void rmutexLock(RMutex* m) { m->m.lock(); }
+static inline bool rmutexTryLock(RMutex* m) { return m->m.try_lock(); }
+static inline void rmutexUnlock(RMutex* m) { m->m.unlock(); }
+
+// kernel/rwlock.h
+struct RwLock {
+    std::shared_mutex m;
+};
+
+static inline void rwlockInit(RwLock*) {}
+static inline void rwlockReadLock(RwLock* l) { l->m.lock_shared(); }
+static inline void rwlockReadUnlock(RwLock* l) { l->m.unlock_shared(); }
+static inline void rwlockWriteLock(RwLock* l) { l->m.lock(); }
+static inline void rwlockWriteUnlock(RwLock* l) { l->m.unlock(); }
+
+// kernel/condvar.h
+struct CondVar {
+    std::condition_variable_any cv;
+};
+
+#define KERNELRESULT_TIMEDOUT MAKERESULT(1, 117)
+
+static inline void condvarInit(CondVar*) {}
+
+static inline Result condvarWaitTimeout(CondVar* c, Mutex* m, u64 timeout) {
+    std::unique_lock lock{m->m, std::adopt_lock};
+    const auto status = c->cv.wait_for(lock, std::chrono::nanoseconds(timeout));
+    lock.release();
+    return status == std::cv_status::timeout ? KERNELRESULT_TIMEDOUT : 0;
+}
+
+static inline Result condvarWait(CondVar* c, Mutex* m) {
+    std::unique_lock lock{m->m, std::adopt_lock};
+    c->cv.wait(lock);
+    lock.release();
+    return 0;
+}
+
+static inline Result condvarWakeOne(CondVar* c) {
+    c->cv.notify_one();
+    return 0;
+}
+
+static inline Result condvarWakeAll(CondVar* c) {
+    c->cv.notify_all();
+    return 0;
+}
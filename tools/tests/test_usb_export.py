@@ -69,6 +69,30 @@ class FakeUsb:
 	def send_result(self, result):
 		self.results.append(result)
 
+# FakeUsb for CAP_SESSION, plays back the packets and data sphaira sends.
+class FakeSessionUsb:
+	def __init__(self):
+		self.packets = []
+		self.reads = []
+		self.results = []
+
+	def add(self, cmd, arg3=0, arg4=0, arg5=0, data=None):
+		from usb_common import SendPacket
+		self.packets.append(SendPacket.build(cmd, arg3, arg4, arg5))
+		self.reads.append(data)
+
+	def get_send_packet(self):
+		self._data = self.reads.pop(0) or b""
+		return self.packets.pop(0)
+
+	def read(self, size):
+		data = self._data[:size]
+		self._data = self._data[size:]
+		return data
+
+	def send_result(self, result, arg3=0, arg4=0, arg5=0):
+		self.results.append(result)
+
 # test case for usb_export.py
 class TestUsbExport(unittest.TestCase):
 	def setUp(self):
@@ -112,5 +136,66 @@ class TestUsbExport(unittest.TestCase):
 		self.assertEqual(cmd, CMD_QUIT)
 		self.assertIn(RESULT_OK, self.fake_usb.results)
 
+	def test_export_stream(self):
+		from usb_export import get_file_name, create_file_folder, wait_for_input
+		from usb_common import CAP_STREAM
+
+		for filename, data in self.files:
+			cmd, name_len, _ = self.fake_usb.get_send_header()
+			self.assertEqual(cmd, CMD_EXPORT)
+
+			file_name = get_file_name(self.fake_usb, name_len)
+			full_path = create_file_folder(self.root, file_name)
+
+			self.fake_usb.results.clear()
+			wait_for_input(self.fake_usb, full_path, CAP_STREAM)
+
+			# only the data and the end are acked, not the header.
+			self.assertEqual(self.fake_usb.results, [RESULT_OK, RESULT_OK])
+
+			with open(full_path, "rb") as f:
+				filedata = f.read()
+			self.assertEqual(filedata, data)
+
+	def test_export_session(self):
+		from usb_export import create_file_folder, session_loop
+		from usb_common import CMD_EXPORT_OPEN, CMD_EXPORT_DATA, CMD_EXPORT_CLOSE
+
+		fake_usb = FakeSessionUsb()
+		first_path = create_file_folder(self.root, self.files[0][0])
+
+		# the next file is opened and written before the previous one is closed.
+		for i, (filename, data) in enumerate(self.files):
+			if i:
+				name = filename.encode("utf-8")
+				fake_usb.add(CMD_EXPORT_OPEN, i, len(name), data=name)
+			half = len(data) // 2
+			fake_usb.add(CMD_EXPORT_DATA, i, half, crc32c.crc32c(data[:half]), data=data[:half])
+			if i:
+				fake_usb.add(CMD_EXPORT_CLOSE, i - 1)
+			fake_usb.add(CMD_EXPORT_DATA, i, len(data) - half, crc32c.crc32c(data[half:]), data=data[half:])
+		fake_usb.add(CMD_EXPORT_CLOSE, len(self.files) - 1)
+		fake_usb.add(CMD_QUIT)
+
+		self.assertTrue(session_loop(fake_usb, self.root, first_path))
+		self.assertEqual(fake_usb.results, [RESULT_OK])
+
+		for filename, data in self.files:
+			with open(os.path.join(self.root, filename), "rb") as f:
+				self.assertEqual(f.read(), data)
+
+	def test_export_session_bad_crc(self):
+		from usb_export import create_file_folder, session_loop
+		from usb_common import CMD_EXPORT_DATA, CMD_EXPORT_CLOSE
+
+		fake_usb = FakeSessionUsb()
+		first_path = create_file_folder(self.root, "bad.bin")
+		fake_usb.add(CMD_EXPORT_DATA, 0, 4, 0, data=b"data")
+		fake_usb.add(CMD_EXPORT_CLOSE, 0)
+		fake_usb.add(CMD_QUIT)
+
+		self.assertFalse(session_loop(fake_usb, self.root, first_path))
+		self.assertEqual(fake_usb.results, [RESULT_ERROR])
+
 if __name__ == "__main__":
 	unittest.main()
@@ -36,6 +36,66 @@ class FakeUsb:
 	def write(self, data):
 		self.writes.append(data)
 
+# FakeUsb for CAP_STREAM, requests count chunks at a time like sphaira does.
+class FakeStreamUsb:
+	def __init__(self, file_size, chunk_size, count):
+		self.file_size = file_size
+		self.chunk_size = chunk_size
+		self.count = count
+		self.off = 0
+		self.done = False
+		self.chunks = []
+		self.results = []
+		self._pending = None
+
+	def get_send_data_header(self):
+		if self.off >= self.file_size:
+			self.done = True
+			return [0, 0, 0]
+
+		remaining = self.file_size - self.off
+		count = min(self.count, (remaining + self.chunk_size - 1) // self.chunk_size)
+		off = self.off
+		self.off += count * self.chunk_size
+		return [off, self.chunk_size, count]
+
+	def send_result(self, result, arg3=0, arg4=0, arg5=0):
+		self.results.append((result, arg3, arg4, arg5))
+		if not self.done:
+			self._pending = (arg3, arg4, arg5)
+
+	def write(self, data):
+		wire_size, crc, decompressed_size = self._pending
+		data = bytes(data)
+		self.assertTrue(len(data) == wire_size)
+		if decompressed_size:
+			import zstandard
+			data = zstandard.ZstdDecompressor().decompress(data, max_output_size=decompressed_size)
+		self.assertTrue(crc32c.crc32c(data) == crc)
+		self.chunks.append(data)
+
+	def assertTrue(self, v):
+		if not v:
+			raise AssertionError("bad chunk")
+
+# FakeUsb for CMD_BENCH, the switch side sends / reads the data in pieces.
+class FakeBenchUsb:
+	def __init__(self, upload_size=0):
+		self.results = []
+		self.writes = []
+		self.upload_remaining = upload_size
+
+	def read(self, size):
+		size = min(size, self.upload_remaining, 100)
+		self.upload_remaining -= size
+		return bytes(size)
+
+	def send_result(self, result, arg3=0, arg4=0, arg5=0):
+		self.results.append(result)
+
+	def write(self, data):
+		self.writes.append(len(data))
+
 class TestUsbInstall(unittest.TestCase):
 	def setUp(self):
 		import random
@@ -101,5 +161,48 @@ class TestUsbInstall(unittest.TestCase):
 					found = True
 			self.assertTrue(found)
 
+	def test_stream_install(self):
+		from usb_install import add_file_to_install_list, paths, wait_for_input, get_caps
+		from usb_common import CAP_STREAM, CAP_ZSTD
+		paths.clear()
+
+		for fpath in self.filepaths:
+			add_file_to_install_list(fpath)
+
+		caps = get_caps(CAP_STREAM | CAP_ZSTD)
+		self.assertTrue(caps & CAP_STREAM)
+
+		for idx, (fname, data) in enumerate(self.files):
+			fake_usb = FakeStreamUsb(len(data), 256, 3)
+			wait_for_input(fake_usb, idx, caps)
+
+			# the first result is the file info, then one per chunk, then the close.
+			self.assertEqual(fake_usb.results[0][2], len(data))
+			self.assertEqual(b"".join(fake_usb.chunks), data)
+
+	def test_bench(self):
+		from usb_install import bench_loop, get_caps
+		from usb_common import CAP_STREAM, CAP_BENCH, BENCH_DOWNLOAD, BENCH_UPLOAD, RESULT_ERROR
+
+		# only offered in bench mode.
+		self.assertFalse(get_caps(CAP_STREAM | CAP_BENCH) & CAP_BENCH)
+		self.assertTrue(get_caps(CAP_STREAM | CAP_BENCH, True) & CAP_BENCH)
+		self.assertFalse(get_caps(CAP_STREAM, True) & CAP_BENCH)
+
+		fake_usb = FakeBenchUsb()
+		bench_loop(fake_usb, BENCH_DOWNLOAD, 4096, 5)
+		self.assertEqual(fake_usb.results, [RESULT_OK])
+		self.assertEqual(fake_usb.writes, [4096] * 5)
+
+		# acked again once everything was read.
+		fake_usb = FakeBenchUsb(4096 * 5)
+		bench_loop(fake_usb, BENCH_UPLOAD, 4096, 5)
+		self.assertEqual(fake_usb.results, [RESULT_OK, RESULT_OK])
+		self.assertEqual(fake_usb.upload_remaining, 0)
+
+		fake_usb = FakeBenchUsb()
+		bench_loop(fake_usb, 2, 4096, 5)
+		self.assertEqual(fake_usb.results, [RESULT_ERROR])
+
 if __name__ == "__main__":
 	unittest.main()
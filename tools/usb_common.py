@@ -12,6 +12,10 @@ PACKET_SIZE = 24
 CMD_QUIT = 0
 CMD_OPEN = 1
 CMD_EXPORT = 1
+CMD_BENCH = 2
+CMD_EXPORT_OPEN = 3
+CMD_EXPORT_DATA = 4
+CMD_EXPORT_CLOSE = 5
 
 # results
 RESULT_OK = 0
@@ -21,6 +25,30 @@ RESULT_ERROR = 1
 FLAG_NONE = 0
 FLAG_STREAM = 1 << 0
 
+# capabilities, the switch sends the ones it supports and the script replies
+# with the ones that will be used. an old switch sends 0, so nothing changes.
+CAP_NONE = 0
+# install: the switch asks for a number of chunks (in place of the crc32c), which
+# are all sent back to back, each with its own result header.
+# export: the data follows the header straight away and is acked once.
+CAP_STREAM = 1 << 0
+# install: a chunk may be zstd compressed, arg5 of the result is then the
+# decompressed size and arg3 the compressed size.
+CAP_ZSTD = 1 << 1
+# install: CMD_BENCH is accepted, only set in bench mode, the file list is then empty.
+CAP_BENCH = 1 << 2
+
+# export: the file of CMD_EXPORT is file id 0 of a session, other files are
+# opened (id, path length + path), written (id, size, crc32c + data) and closed
+# (id) with the CMD_EXPORT_* commands, none of which get a reply.
+# the result of the whole session is the reply to CMD_QUIT.
+CAP_SESSION = 1 << 3
+
+# CMD_BENCH modes, arg3 is the mode, arg4 the size and arg5 the count.
+# the data is only sent / read, it's not checked or stored.
+BENCH_DOWNLOAD = 0
+BENCH_UPLOAD = 1
+
 class UsbPacket:
     STRUCT_FORMAT = "<6I"  # 6 unsigned 32-bit ints, little-endian
 
@@ -57,8 +85,8 @@ class UsbPacket:
 
 class SendPacket(UsbPacket):
     @classmethod
-    def build(cls, cmd, arg3=0, arg4=0):
-        packet = cls(MAGIC, cmd, arg3, arg4)
+    def build(cls, cmd, arg3=0, arg4=0, arg5=0):
+        packet = cls(MAGIC, cmd, arg3, arg4, arg5)
         packet.generate_crc32c()
         return packet
 
@@ -67,8 +95,8 @@ class SendPacket(UsbPacket):
 
 class ResultPacket(UsbPacket):
     @classmethod
-    def build(cls, result, arg3=0, arg4=0):
-        packet = cls(MAGIC, result, arg3, arg4)
+    def build(cls, result, arg3=0, arg4=0, arg5=0):
+        packet = cls(MAGIC, result, arg3, arg4, arg5)
         packet.generate_crc32c()
         return packet
 
@@ -141,9 +169,13 @@ class Usb:
     def write(self, buf: bytes, timeout: int = 0) -> int:
         return self.__out_ep.write(data=buf, timeout=timeout)
 
-    def get_send_header(self) -> tuple[int, int, int]:
+    def get_send_packet(self) -> SendPacket:
         packet = SendPacket.unpack(self.read(PACKET_SIZE))
         packet.verify()
+        return packet
+
+    def get_send_header(self) -> tuple[int, int, int]:
+        packet = self.get_send_packet()
         return packet.get_cmd(), packet.arg3, packet.arg4
 
     def get_send_data_header(self) -> tuple[int, int, int]:
@@ -151,6 +183,6 @@ class Usb:
         packet.verify()
         return packet.get_offset(), packet.get_size(), packet.get_crc32c()
 
-    def send_result(self, result: int, arg3: int = 0, arg4: int = 0) -> None:
-        send_data = ResultPacket.build(result, arg3, arg4).pack()
+    def send_result(self, result: int, arg3: int = 0, arg4: int = 0, arg5: int = 0) -> None:
+        send_data = ResultPacket.build(result, arg3, arg4, arg5).pack()
         self.write(send_data)
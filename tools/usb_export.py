@@ -1,6 +1,7 @@
 import crc32c
 import sys
 import os
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 from usb_common import *
 
@@ -15,7 +16,7 @@ def create_file_folder(root: Path, file_path: Path) -> Path:
 
     return full_path
 
-def wait_for_input(usb: Usb, path: Path) -> None:
+def wait_for_input(usb: Usb, path: Path, caps: int = CAP_NONE) -> None:
     print("now waiting for intput\n")
 
     with open(path, "wb") as file:
@@ -24,8 +25,9 @@ def wait_for_input(usb: Usb, path: Path) -> None:
         while True:
             [off, size, crc32c_want] = usb.get_send_data_header()
 
-            # todo: this isn't needed really.
-            usb.send_result(RESULT_OK)
+            # with CAP_STREAM the data follows straight away, so only the end is acked.
+            if not (caps & CAP_STREAM) or (off == 0 and size == 0):
+                usb.send_result(RESULT_OK)
 
             # check if we should finish now.
             if (off == 0 and size == 0):
@@ -48,6 +50,84 @@ def wait_for_input(usb: Usb, path: Path) -> None:
                 print("Error: failed to write: {} at: {} size: {} error: {}".format(e.filename, off, size, str(e)))
                 usb.send_result(RESULT_ERROR)
 
+def read_exact(usb: Usb, size: int) -> bytes:
+    buf = bytes()
+    while len(buf) < size:
+        buf += bytes(usb.read(size - len(buf)))
+    return buf
+
+def session_loop(usb: Usb, root_path: str, first_path: Path) -> bool:
+    print("inside session loop now")
+
+    # file id -> file, None once it failed so its data is skipped.
+    files = {}
+    failed = False
+
+    def open_file(file_id: int, path: Path) -> None:
+        nonlocal failed
+        try:
+            files[file_id] = open(path, "wb")
+            print("opened file {}".format(path))
+        except OSError as e:
+            print("Error: failed to open: {} error: {}".format(e.filename, str(e)))
+            files[file_id] = None
+            failed = True
+
+    open_file(0, first_path)
+
+    # files are closed (and flushed) whilst the next one is received.
+    with ThreadPoolExecutor(max_workers=1) as closer:
+        closes = []
+
+        while True:
+            packet = usb.get_send_packet()
+            cmd = packet.get_cmd()
+
+            if cmd == CMD_QUIT:
+                break
+            elif cmd == CMD_EXPORT_OPEN:
+                file_name = get_file_name(usb, packet.arg4)
+                open_file(packet.arg3, create_file_folder(root_path, file_name))
+            elif cmd == CMD_EXPORT_DATA:
+                buf = read_exact(usb, packet.arg4)
+                file = files.get(packet.arg3)
+                if file is None:
+                    continue
+
+                if crc32c.crc32c(buf) != packet.arg5:
+                    print("Error: crc32c mismatch for: {}".format(file.name))
+                    failed = True
+                    continue
+
+                try:
+                    file.write(buf)
+                except OSError as e:
+                    print("Error: failed to write: {} error: {}".format(file.name, str(e)))
+                    failed = True
+            elif cmd == CMD_EXPORT_CLOSE:
+                file = files.pop(packet.arg3, None)
+                if file is not None:
+                    closes.append(closer.submit(file.close))
+            else:
+                print("Error: unknown command in session: {}".format(cmd))
+                failed = True
+                break
+
+        for file in files.values():
+            if file is not None:
+                closes.append(closer.submit(file.close))
+
+        for close in closes:
+            try:
+                close.result()
+            except OSError as e:
+                print("Error: failed to close: {} error: {}".format(e.filename, str(e)))
+                failed = True
+
+    # reply to the quit.
+    usb.send_result(RESULT_ERROR if failed else RESULT_OK)
+    return not failed
+
 if __name__ == '__main__':
     print("hello world")
 
@@ -76,14 +156,21 @@ if __name__ == '__main__':
                 usb.send_result(RESULT_OK)
                 break
             elif (cmd == CMD_EXPORT):
-                usb.send_result(RESULT_OK)
+                # an old switch sends 0, so streaming is only used if asked for.
+                caps = arg4 & (CAP_STREAM | CAP_SESSION)
+                usb.send_result(RESULT_OK, 0, caps)
 
                 # todo: handle and return errors here.
                 file_name = get_file_name(usb, arg3)
                 full_path = create_file_folder(root_path, file_name)
                 usb.send_result(RESULT_OK)
 
-                wait_for_input(usb, full_path)
+                # the session ends with the quit.
+                if caps & CAP_SESSION:
+                    session_loop(usb, root_path, full_path)
+                    break
+
+                wait_for_input(usb, full_path, caps)
             else:
                 usb.send_result(RESULT_ERROR)
                 break
@@ -4,6 +4,7 @@ from io import BufferedReader
 import sys
 import os
 from pathlib import Path
+from typing import Optional
 from usb_common import *
 
 try:
@@ -12,6 +13,15 @@ try:
 except:
     has_rar_support: bool = False
 
+try:
+    import zstandard
+    has_zstd_support: bool = True
+except:
+    has_zstd_support: bool = False
+
+# only use the compressed chunk if it saves at least this much.
+ZSTD_MIN_RATIO = 0.9
+
 # list of installable exts that sphaira supports.
 INSTALLABLE_EXTS = (".nsp", ".xci", ".nsz", ".xcz")
 # list of supported extensions passed via args.
@@ -25,7 +35,86 @@ def send_file_info_result(usb: Usb, result: int, file_size: int, flags: int):
     size_msb = ((file_size >> 32) & 0xFFFF) | (flags << 16)
     usb.send_result(result, size_msb, size_lsb)
 
-def file_transfer_loop(usb: Usb, file: BufferedReader, flags: int) -> None:
+def get_caps(switch_caps: int, bench: bool = False) -> int:
+    caps = CAP_STREAM
+    if has_zstd_support:
+        caps |= CAP_ZSTD
+    if bench:
+        caps |= CAP_BENCH
+    return caps & switch_caps
+
+def bench_loop(usb: Usb, mode: int, size: int, count: int) -> None:
+    if mode not in (BENCH_DOWNLOAD, BENCH_UPLOAD):
+        usb.send_result(RESULT_ERROR)
+        return
+
+    usb.send_result(RESULT_OK)
+
+    if mode == BENCH_DOWNLOAD:
+        buf = bytes(size)
+        for _ in range(count):
+            usb.write(buf)
+    else:
+        for _ in range(count):
+            remaining = size
+            while remaining:
+                remaining -= len(usb.read(remaining))
+
+        # let the switch know that everything arrived.
+        usb.send_result(RESULT_OK)
+
+def send_chunk(usb: Usb, buf: bytes, caps: int) -> None:
+    crc = crc32c.crc32c(buf)
+
+    # the crc32c is always of the decompressed data.
+    if (caps & CAP_ZSTD) and len(buf):
+        compressed = zstandard.ZstdCompressor(level=3).compress(buf)
+        if len(compressed) < len(buf) * ZSTD_MIN_RATIO:
+            usb.send_result(RESULT_OK, len(compressed), crc, len(buf))
+            usb.write(compressed)
+            return
+
+    usb.send_result(RESULT_OK, len(buf), crc)
+    usb.write(buf)
+
+def read_chunk(file: BufferedReader, flags: int, off: int, size: int) -> Optional[bytes]:
+    # if we cannot seek, ensure that sphaira doesn't try to seek backwards.
+    if (flags & FLAG_STREAM) and off < file.tell():
+        print("Error: tried to seek on file without random access.")
+        return None
+
+    try:
+        file.seek(off)
+        return file.read(size)
+    except BlockingIOError as e:
+        print("Error: failed to read: {} at: {} size: {} error: {}".format(e.filename, off, size, str(e)))
+        return None
+
+def file_stream_loop(usb: Usb, file: BufferedReader, flags: int, caps: int) -> None:
+    print("inside file stream loop now")
+
+    while True:
+        # get offset + size + number of chunks.
+        [off, size, count] = usb.get_send_data_header()
+
+        # check if we should finish now.
+        if (off == 0 and size == 0):
+            usb.send_result(RESULT_OK)
+            break
+
+        # send every chunk without waiting for another request.
+        for i in range(max(count, 1)):
+            buf = read_chunk(file, flags, off + i * size, size)
+            if buf is None:
+                usb.send_result(RESULT_ERROR)
+                break
+
+            send_chunk(usb, buf, caps)
+
+def file_transfer_loop(usb: Usb, file: BufferedReader, flags: int, caps: int = CAP_NONE) -> None:
+    if caps & CAP_STREAM:
+        return file_stream_loop(usb, file, flags, caps)
+
     print("inside file transfer loop now")
 
     while True:
@@ -58,7 +147,7 @@ def file_transfer_loop(usb: Usb, file: BufferedReader, flags: int) -> None:
         # send the data.
         usb.write(buf)
 
-def wait_for_input(usb: Usb, file_index: int) -> None:
+def wait_for_input(usb: Usb, file_index: int, caps: int = CAP_NONE) -> None:
     print("now waiting for intput\n")
 
     # open file / rar. (todo: learn how to make a class with inheritance)
@@ -76,14 +165,14 @@ def wait_for_input(usb: Usb, file_index: int) -> None:
 
                     print("opened file: {} flags: {}".format(internal_path, flags))
                     send_file_info_result(usb, RESULT_OK, info.file_size, flags)
-                    file_transfer_loop(usb, file, flags)
+                    file_transfer_loop(usb, file, flags, caps)
         else:
             with open(path, "rb") as file:
                 print("opened file {}".format(path))
                 file.seek(0, os.SEEK_END)
                 file_size = file.tell()
                 send_file_info_result(usb, RESULT_OK, file_size, flags)
-                file_transfer_loop(usb, file, flags)
+                file_transfer_loop(usb, file, flags, caps)
 
     except OSError as e:
         print("Error: failed to open: {} error: {}".format(e.filename, str(e)))
@@ -114,11 +203,15 @@ if __name__ == '__main__':
     args = len(sys.argv)
     if (args != 2):
         print("either run python usb_total.py game.nsp OR drag and drop the game onto the python file (if python is in your path)")
+        print("run python usb_total.py --bench to benchmark usb transfers from the usb menu")
         sys.exit(1)
 
     # build a list of files to install.
     path = sys.argv[1]
-    if os.path.isfile(path):
+    bench = path == "--bench"
+    if bench:
+        print("Bench mode, start the benchmark from the usb menu")
+    elif os.path.isfile(path):
         add_file_to_install_list(path)
     elif os.path.isdir(path):
         for f in glob.glob(path + "/**/*.*", recursive=True):
@@ -139,21 +232,26 @@ if __name__ == '__main__':
             string_table += bytes(Path(path).name.__str__(), 'utf8') + b'\n'
 
         # this reads the send header and checks the magic.
-        usb.get_send_header()
+        [_, switch_caps, _] = usb.get_send_header()
+        caps = get_caps(switch_caps, bench)
+        print("using caps: {}".format(caps))
 
         # send recv and string table.
-        usb.send_result(RESULT_OK, len(string_table))
+        usb.send_result(RESULT_OK, len(string_table), caps)
         usb.write(string_table)
 
         # wait for command.
         while True:
-            [cmd, arg3, arg4] = usb.get_send_header()
+            packet = usb.get_send_packet()
+            cmd = packet.get_cmd()
 
             if cmd == CMD_QUIT:
                 usb.send_result(RESULT_OK)
                 break
             elif cmd == CMD_OPEN:
-                wait_for_input(usb, arg3)
+                wait_for_input(usb, packet.arg3, caps)
+            elif cmd == CMD_BENCH and (caps & CAP_BENCH):
+                bench_loop(usb, packet.arg3, packet.arg4, packet.arg5)
             else:
                 usb.send_result(RESULT_ERROR)
                 break